@@ -0,0 +1,450 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "effect-impl/EffectDsp.h"
+
+namespace aidl::android::hardware::audio::effect {
+
+namespace {
+
+constexpr size_t kLaneCount = 4;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+using Vector = float32x4_t;
+inline Vector vLoad(const float* p) {
+    return vld1q_f32(p);
+}
+inline void vStore(float* p, Vector v) {
+    vst1q_f32(p, v);
+}
+inline Vector vAdd(Vector a, Vector b) {
+    return vaddq_f32(a, b);
+}
+inline Vector vSub(Vector a, Vector b) {
+    return vsubq_f32(a, b);
+}
+inline Vector vMul(Vector a, Vector b) {
+    return vmulq_f32(a, b);
+}
+// a + b * c
+inline Vector vMulAdd(Vector a, Vector b, Vector c) {
+    return vmlaq_f32(a, b, c);
+}
+// a - b * c
+inline Vector vMulSub(Vector a, Vector b, Vector c) {
+    return vmlsq_f32(a, b, c);
+}
+inline Vector vAbs(Vector a) {
+    return vabsq_f32(a);
+}
+// a > b ? c : d
+inline Vector vSelectGreater(Vector a, Vector b, Vector c, Vector d) {
+    return vbslq_f32(vcgtq_f32(a, b), c, d);
+}
+
+#elif defined(__SSE2__)
+
+using Vector = __m128;
+inline Vector vLoad(const float* p) {
+    return _mm_loadu_ps(p);
+}
+inline void vStore(float* p, Vector v) {
+    _mm_storeu_ps(p, v);
+}
+inline Vector vAdd(Vector a, Vector b) {
+    return _mm_add_ps(a, b);
+}
+inline Vector vSub(Vector a, Vector b) {
+    return _mm_sub_ps(a, b);
+}
+inline Vector vMul(Vector a, Vector b) {
+    return _mm_mul_ps(a, b);
+}
+inline Vector vMulAdd(Vector a, Vector b, Vector c) {
+    return _mm_add_ps(a, _mm_mul_ps(b, c));
+}
+inline Vector vMulSub(Vector a, Vector b, Vector c) {
+    return _mm_sub_ps(a, _mm_mul_ps(b, c));
+}
+inline Vector vAbs(Vector a) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+inline Vector vSelectGreater(Vector a, Vector b, Vector c, Vector d) {
+    const Vector mask = _mm_cmpgt_ps(a, b);
+    return _mm_or_ps(_mm_and_ps(mask, c), _mm_andnot_ps(mask, d));
+}
+
+#else
+
+struct Vector {
+    float v[kLaneCount];
+};
+inline Vector vLoad(const float* p) {
+    Vector r;
+    std::copy(p, p + kLaneCount, r.v);
+    return r;
+}
+inline void vStore(float* p, Vector v) {
+    std::copy(v.v, v.v + kLaneCount, p);
+}
+inline Vector vAdd(Vector a, Vector b) {
+    for (size_t i = 0; i < kLaneCount; i++) a.v[i] += b.v[i];
+    return a;
+}
+inline Vector vSub(Vector a, Vector b) {
+    for (size_t i = 0; i < kLaneCount; i++) a.v[i] -= b.v[i];
+    return a;
+}
+inline Vector vMul(Vector a, Vector b) {
+    for (size_t i = 0; i < kLaneCount; i++) a.v[i] *= b.v[i];
+    return a;
+}
+inline Vector vMulAdd(Vector a, Vector b, Vector c) {
+    for (size_t i = 0; i < kLaneCount; i++) a.v[i] += b.v[i] * c.v[i];
+    return a;
+}
+inline Vector vMulSub(Vector a, Vector b, Vector c) {
+    for (size_t i = 0; i < kLaneCount; i++) a.v[i] -= b.v[i] * c.v[i];
+    return a;
+}
+inline Vector vAbs(Vector a) {
+    for (size_t i = 0; i < kLaneCount; i++) a.v[i] = std::fabs(a.v[i]);
+    return a;
+}
+inline Vector vSelectGreater(Vector a, Vector b, Vector c, Vector d) {
+    for (size_t i = 0; i < kLaneCount; i++) c.v[i] = a.v[i] > b.v[i] ? c.v[i] : d.v[i];
+    return c;
+}
+
+#endif
+
+size_t getGroupCount(size_t channelCount) {
+    return (channelCount + kLaneCount - 1) / kLaneCount;
+}
+
+// Loads the channels of one interleaved frame that belong to a group, a partial group is zero
+// padded.
+template <bool kFullGroup>
+inline Vector loadFrame(const float* frame, size_t laneCount) {
+    if constexpr (kFullGroup) {
+        return vLoad(frame);
+    } else {
+        float lanes[kLaneCount] = {};
+        std::copy(frame, frame + laneCount, lanes);
+        return vLoad(lanes);
+    }
+}
+
+template <bool kFullGroup>
+inline void storeFrame(float* frame, Vector v, size_t laneCount) {
+    if constexpr (kFullGroup) {
+        vStore(frame, v);
+    } else {
+        float lanes[kLaneCount];
+        vStore(lanes, v);
+        std::copy(lanes, lanes + laneCount, frame);
+    }
+}
+
+// Runs every stage on a frame before moving to the next one, the recursions of the stages are
+// independent so they overlap in the pipeline.
+template <bool kFullGroup>
+void processBiquads(const float* in, float* out, size_t frameCount, size_t stride,
+                    size_t laneCount, size_t stageCount, const float* coefficients,
+                    float* state) {
+    for (size_t i = 0; i < frameCount; i++) {
+        Vector x = loadFrame<kFullGroup>(in, laneCount);
+        const float* c = coefficients;
+        float* s = state;
+        for (size_t stage = 0; stage < stageCount; stage++) {
+            const Vector y = vMulAdd(vLoad(s), vLoad(c), x);
+            vStore(s, vMulSub(vMulAdd(vLoad(s + kLaneCount), vLoad(c + kLaneCount), x),
+                              vLoad(c + 3 * kLaneCount), y));
+            vStore(s + kLaneCount,
+                   vMulSub(vMul(vLoad(c + 2 * kLaneCount), x), vLoad(c + 4 * kLaneCount), y));
+            x = y;
+            // b0, b1, b2, a1 and a2 of each lane.
+            c += 5 * kLaneCount;
+            s += 2 * kLaneCount;
+        }
+        storeFrame<kFullGroup>(out, x, laneCount);
+        in += stride;
+        out += stride;
+    }
+}
+
+template <bool kFullGroup>
+void processCompressor(float* buffer, size_t frameCount, size_t stride, size_t laneCount,
+                       Vector preGain, Vector attack, Vector release, Vector* envelope,
+                       Vector* gain, Vector gainStep) {
+    Vector env = *envelope;
+    Vector g = *gain;
+    for (size_t i = 0; i < frameCount; i++) {
+        const Vector x = loadFrame<kFullGroup>(buffer, laneCount);
+        const Vector level = vMul(vAbs(x), preGain);
+        // Attack when the level rises above the envelope, release otherwise.
+        const Vector coefficient = vSelectGreater(level, env, attack, release);
+        env = vMulAdd(level, coefficient, vSub(env, level));
+        storeFrame<kFullGroup>(buffer, vMul(x, g), laneCount);
+        g = vAdd(g, gainStep);
+        buffer += stride;
+    }
+    *envelope = env;
+    *gain = g;
+}
+
+BiquadCoefficients normalize(double b0, double b1, double b2, double a0, double a1, double a2) {
+    return {.b0 = static_cast<float>(b0 / a0),
+            .b1 = static_cast<float>(b1 / a0),
+            .b2 = static_cast<float>(b2 / a0),
+            .a1 = static_cast<float>(a1 / a0),
+            .a2 = static_cast<float>(a2 / a0)};
+}
+
+double getOmega(float sampleRate, float frequencyHz) {
+    const double nyquist = sampleRate / 2.0;
+    return M_PI * std::clamp<double>(frequencyHz, 1.0, nyquist * 0.95) / nyquist;
+}
+
+float getSmoothingCoefficient(float sampleRate, float timeMs) {
+    const float frames = timeMs * sampleRate / 1000.0f;
+    return frames > 0 ? std::exp(-1.0f / frames) : 0.0f;
+}
+
+float dbToAmplitude(float db) {
+    return std::pow(10.0f, db / 20.0f);
+}
+
+}  // namespace
+
+BiquadCoefficients BiquadCoefficients::peaking(float sampleRate, float frequencyHz, float q,
+                                               float gainDb) {
+    if (sampleRate <= 0 || q <= 0) return {};
+    const double w0 = getOmega(sampleRate, frequencyHz);
+    const double a = std::pow(10.0, gainDb / 40.0);
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double cosW0 = std::cos(w0);
+    return normalize(1.0 + alpha * a, -2.0 * cosW0, 1.0 - alpha * a, 1.0 + alpha / a, -2.0 * cosW0,
+                     1.0 - alpha / a);
+}
+
+BiquadCoefficients BiquadCoefficients::lowShelf(float sampleRate, float frequencyHz,
+                                                float gainDb) {
+    if (sampleRate <= 0) return {};
+    const double w0 = getOmega(sampleRate, frequencyHz);
+    const double a = std::pow(10.0, gainDb / 40.0);
+    // Shelf slope of 1.
+    const double beta = std::sqrt(a) * std::sin(w0) * M_SQRT1_2 * 2.0;
+    const double cosW0 = std::cos(w0);
+    return normalize(a * ((a + 1.0) - (a - 1.0) * cosW0 + beta),
+                     2.0 * a * ((a - 1.0) - (a + 1.0) * cosW0),
+                     a * ((a + 1.0) - (a - 1.0) * cosW0 - beta),
+                     (a + 1.0) + (a - 1.0) * cosW0 + beta, -2.0 * ((a - 1.0) + (a + 1.0) * cosW0),
+                     (a + 1.0) + (a - 1.0) * cosW0 - beta);
+}
+
+BiquadCoefficients BiquadCoefficients::highShelf(float sampleRate, float frequencyHz,
+                                                 float gainDb) {
+    if (sampleRate <= 0) return {};
+    const double w0 = getOmega(sampleRate, frequencyHz);
+    const double a = std::pow(10.0, gainDb / 40.0);
+    const double beta = std::sqrt(a) * std::sin(w0) * M_SQRT1_2 * 2.0;
+    const double cosW0 = std::cos(w0);
+    return normalize(a * ((a + 1.0) + (a - 1.0) * cosW0 + beta),
+                     -2.0 * a * ((a - 1.0) + (a + 1.0) * cosW0),
+                     a * ((a + 1.0) + (a - 1.0) * cosW0 - beta),
+                     (a + 1.0) - (a - 1.0) * cosW0 + beta, 2.0 * ((a - 1.0) - (a + 1.0) * cosW0),
+                     (a + 1.0) - (a - 1.0) * cosW0 - beta);
+}
+
+BiquadCoefficients BiquadCoefficients::lowPass(float sampleRate, float frequencyHz) {
+    if (sampleRate <= 0) return {};
+    const double w0 = getOmega(sampleRate, frequencyHz);
+    const double alpha = std::sin(w0) * M_SQRT1_2;
+    const double cosW0 = std::cos(w0);
+    return normalize((1.0 - cosW0) / 2.0, 1.0 - cosW0, (1.0 - cosW0) / 2.0, 1.0 + alpha,
+                     -2.0 * cosW0, 1.0 - alpha);
+}
+
+BiquadCoefficients BiquadCoefficients::highPass(float sampleRate, float frequencyHz) {
+    if (sampleRate <= 0) return {};
+    const double w0 = getOmega(sampleRate, frequencyHz);
+    const double alpha = std::sin(w0) * M_SQRT1_2;
+    const double cosW0 = std::cos(w0);
+    return normalize((1.0 + cosW0) / 2.0, -(1.0 + cosW0), (1.0 + cosW0) / 2.0, 1.0 + alpha,
+                     -2.0 * cosW0, 1.0 - alpha);
+}
+
+void BiquadFilterBank::configure(size_t channelCount, size_t stageCount) {
+    mChannelCount = channelCount;
+    mStageCount = stageCount;
+    const size_t size = getGroupCount(channelCount) * stageCount * kLaneCount;
+    mCoefficients.assign(size * kCoefficientCount, 0.0f);
+    for (size_t i = 0; i < size; i++) {
+        // b0 of each lane.
+        mCoefficients[(i / kLaneCount) * kCoefficientCount * kLaneCount + i % kLaneCount] = 1.0f;
+    }
+    mState.assign(size * 2, 0.0f);
+}
+
+void BiquadFilterBank::setCoefficients(size_t channel, size_t stage,
+                                       const BiquadCoefficients& coefficients) {
+    if (channel >= mChannelCount || stage >= mStageCount) return;
+    float* c = &mCoefficients[((channel / kLaneCount) * mStageCount + stage) * kCoefficientCount *
+                                      kLaneCount +
+                              channel % kLaneCount];
+    c[0] = coefficients.b0;
+    c[kLaneCount] = coefficients.b1;
+    c[2 * kLaneCount] = coefficients.b2;
+    c[3 * kLaneCount] = coefficients.a1;
+    c[4 * kLaneCount] = coefficients.a2;
+}
+
+void BiquadFilterBank::clearState() {
+    std::fill(mState.begin(), mState.end(), 0.0f);
+}
+
+void BiquadFilterBank::process(const float* in, float* out, size_t frameCount) {
+    if (mStageCount == 0) {
+        if (in != out) std::memmove(out, in, frameCount * mChannelCount * sizeof(float));
+        return;
+    }
+    const size_t groupCount = getGroupCount(mChannelCount);
+    for (size_t group = 0; group < groupCount; group++) {
+        const size_t firstChannel = group * kLaneCount;
+        const size_t laneCount = std::min(kLaneCount, mChannelCount - firstChannel);
+        const size_t index = group * mStageCount;
+        const float* coefficients = &mCoefficients[index * kCoefficientCount * kLaneCount];
+        float* state = &mState[index * 2 * kLaneCount];
+        if (laneCount == kLaneCount) {
+            processBiquads<true>(in + firstChannel, out + firstChannel, frameCount, mChannelCount,
+                                 laneCount, mStageCount, coefficients, state);
+        } else {
+            processBiquads<false>(in + firstChannel, out + firstChannel, frameCount,
+                                  mChannelCount, laneCount, mStageCount, coefficients, state);
+        }
+    }
+}
+
+void CompressorBank::configure(float sampleRate, size_t channelCount) {
+    mSampleRate = sampleRate;
+    mChannelCount = channelCount;
+    mConfigs.assign(channelCount, {});
+    const size_t size = getGroupCount(channelCount) * kLaneCount;
+    mPreGain.assign(size, 1.0f);
+    mAttack.assign(size, 0.0f);
+    mRelease.assign(size, 0.0f);
+    mEnvelope.assign(size, 0.0f);
+    mGain.assign(size, 1.0f);
+    mGainStep.assign(size, 0.0f);
+}
+
+void CompressorBank::setConfig(size_t channel, const CompressorConfig& config) {
+    if (channel >= mChannelCount) return;
+    mConfigs[channel] = config;
+    if (config.enable) {
+        mPreGain[channel] = dbToAmplitude(config.preGainDb);
+        mAttack[channel] = getSmoothingCoefficient(mSampleRate, config.attackTimeMs);
+        mRelease[channel] = getSmoothingCoefficient(mSampleRate, config.releaseTimeMs);
+    } else {
+        mPreGain[channel] = 1.0f;
+        mAttack[channel] = 0.0f;
+        mRelease[channel] = 0.0f;
+    }
+    updateGainStep(channel);
+}
+
+void CompressorBank::clearState() {
+    std::fill(mEnvelope.begin(), mEnvelope.end(), 0.0f);
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        mGain[channel] = 1.0f;
+        updateGainStep(channel);
+    }
+}
+
+float CompressorBank::computeGainDb(const CompressorConfig& config, float levelDb) {
+    float gainDb = 0.0f;
+    if (config.expanderRatio > 1.0f && levelDb < config.noiseGateThresholdDb) {
+        gainDb += (levelDb - config.noiseGateThresholdDb) * (config.expanderRatio - 1.0f);
+    }
+    if (config.ratio > 1.0f) {
+        const float slope = 1.0f / config.ratio - 1.0f;
+        const float overDb = levelDb - config.thresholdDb;
+        // Soft knee centered on the threshold.
+        const float kneeDb = std::fabs(config.kneeWidthDb);
+        if (2.0f * overDb >= kneeDb) {
+            gainDb += slope * overDb;
+        } else if (2.0f * overDb > -kneeDb) {
+            const float x = overDb + kneeDb / 2.0f;
+            gainDb += slope * x * x / (2.0f * kneeDb);
+        }
+    }
+    return gainDb;
+}
+
+void CompressorBank::updateGainStep(size_t channel) {
+    const CompressorConfig& config = mConfigs[channel];
+    float target = 1.0f;
+    if (config.enable) {
+        const float levelDb = 20.0f * std::log10(std::max(mEnvelope[channel], 1e-9f));
+        target = dbToAmplitude(config.preGainDb + computeGainDb(config, levelDb) +
+                               config.postGainDb);
+    }
+    mGainStep[channel] = (target - mGain[channel]) / kGainIntervalFrames;
+}
+
+void CompressorBank::process(float* buffer, size_t frameCount) {
+    const size_t groupCount = getGroupCount(mChannelCount);
+    for (size_t group = 0; group < groupCount; group++) {
+        const size_t firstChannel = group * kLaneCount;
+        const size_t laneCount = std::min(kLaneCount, mChannelCount - firstChannel);
+        const Vector preGain = vLoad(&mPreGain[firstChannel]);
+        const Vector attack = vLoad(&mAttack[firstChannel]);
+        const Vector release = vLoad(&mRelease[firstChannel]);
+        Vector envelope = vLoad(&mEnvelope[firstChannel]);
+        Vector gain = vLoad(&mGain[firstChannel]);
+        for (size_t frame = 0; frame < frameCount; frame += kGainIntervalFrames) {
+            const size_t count = std::min(kGainIntervalFrames, frameCount - frame);
+            float* data = buffer + frame * mChannelCount + firstChannel;
+            const Vector gainStep = vLoad(&mGainStep[firstChannel]);
+            if (laneCount == kLaneCount) {
+                processCompressor<true>(data, count, mChannelCount, laneCount, preGain, attack,
+                                        release, &envelope, &gain, gainStep);
+            } else {
+                processCompressor<false>(data, count, mChannelCount, laneCount, preGain, attack,
+                                         release, &envelope, &gain, gainStep);
+            }
+            vStore(&mEnvelope[firstChannel], envelope);
+            vStore(&mGain[firstChannel], gain);
+            for (size_t lane = 0; lane < laneCount; lane++) {
+                updateGainStep(firstChannel + lane);
+            }
+        }
+    }
+}
+
+}  // namespace aidl::android::hardware::audio::effect
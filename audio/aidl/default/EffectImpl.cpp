@@ -14,9 +14,12 @@
  * limitations under the License.
  */
 
+#include <chrono>
+#include <inttypes.h>
 #include <memory>
 #define ATRACE_TAG ATRACE_TAG_AUDIO
 #define LOG_TAG "AHAL_EffectImpl"
+#include <android-base/properties.h>
 #include <utils/Trace.h>
 #include "effect-impl/EffectImpl.h"
 #include "effect-impl/EffectTypes.h"
@@ -104,7 +107,8 @@ ndk::ScopedAStatus EffectImpl::open(const Parameter::Common& common,
 
     mState = State::IDLE;
     mImplContext->dupeFmq(ret);
-    RETURN_IF(createThread(getEffectNameWithVersion()) != RetCode::SUCCESS,
+    RETURN_IF(createThread(getEffectNameWithVersion(), ANDROID_PRIORITY_URGENT_AUDIO,
+                           mImplContext->getIoHandle()) != RetCode::SUCCESS,
               EX_UNSUPPORTED_OPERATION, "FailedToCreateWorker");
     LOG(INFO) << getEffectNameWithVersion() << __func__;
     return ndk::ScopedAStatus::ok();
@@ -189,6 +193,18 @@ ndk::ScopedAStatus EffectImpl::getParameter(const Parameter::Id& id, Parameter*
     return ndk::ScopedAStatus::ok();
 }
 
+binder_status_t EffectImpl::dump(int fd, const char** /* args */, uint32_t /* numArgs */) {
+    const ProcessStats stats = getProcessStats();
+    dprintf(fd, "%s: %s, processed %" PRIu64 " times", getEffectNameWithVersion().c_str(),
+            isOnSharedWorker() ? "shared worker" : "own thread", stats.count);
+    if (stats.count != 0) {
+        dprintf(fd, ", process time(us) mean: %" PRId64 ", max: %" PRId64,
+                stats.totalNs / static_cast<int64_t>(stats.count) / 1000, stats.maxNs / 1000);
+    }
+    dprintf(fd, "\n");
+    return STATUS_OK;
+}
+
 ndk::ScopedAStatus EffectImpl::setParameterCommon(const Parameter& param) {
     RETURN_IF(!mImplContext, EX_NULL_POINTER, "nullContext");
 
@@ -281,6 +297,7 @@ ndk::ScopedAStatus EffectImpl::command(CommandId command) {
             break;
         case CommandId::STOP:
             RETURN_OK_IF(mState == State::IDLE);
+            flushStatus();
             mState = State::IDLE;
             RETURN_IF(notifyEventFlag(mDataMqNotEmptyEf) != RetCode::SUCCESS, EX_ILLEGAL_STATE,
                       "notifyEventFlagNotEmptyFailed");
@@ -288,6 +305,7 @@ ndk::ScopedAStatus EffectImpl::command(CommandId command) {
             RETURN_IF_ASTATUS_NOT_OK(commandImpl(command), "commandImplFailed");
             break;
         case CommandId::RESET:
+            flushStatus();
             mState = State::IDLE;
             RETURN_IF(notifyEventFlag(mDataMqNotEmptyEf) != RetCode::SUCCESS, EX_ILLEGAL_STATE,
                       "notifyEventFlagNotEmptyFailed");
@@ -363,48 +381,120 @@ IEffect::Status EffectImpl::status(binder_status_t status, size_t consumed, size
     return ret;
 }
 
-void EffectImpl::process() {
-    ATRACE_NAME(getEffectNameWithVersion().c_str());
+bool EffectImpl::process(int64_t timeoutNs, std::vector<float>* workBuffer) {
     /**
      * wait for the EventFlag without lock, it's ok because the mEfGroup pointer will not change
      * in the life cycle of workerThread (threadLoop).
      */
     uint32_t efState = 0;
-    if (!mEventFlag ||
-        ::android::OK != mEventFlag->wait(mDataMqNotEmptyEf, &efState, 0 /* no timeout */,
-                                          true /* retry */) ||
-        !(efState & mDataMqNotEmptyEf)) {
+    if (!mEventFlag) {
+        LOG(ERROR) << getEffectNameWithVersion() << __func__ << ": StatusEventFlag invalid";
+        return false;
+    }
+    const ::android::status_t ret =
+            mEventFlag->wait(mDataMqNotEmptyEf, &efState, timeoutNs, true /* retry */);
+    if (ret == ::android::TIMED_OUT) {
+        return false;
+    }
+    if (ret != ::android::OK || !(efState & mDataMqNotEmptyEf)) {
         LOG(ERROR) << getEffectNameWithVersion() << __func__ << ": StatusEventFlag - " << mEventFlag
                    << " efState - " << std::hex << efState;
-        return;
+        return false;
     }
 
+    ATRACE_NAME(getEffectNameWithVersion().c_str());
+    const auto start = std::chrono::steady_clock::now();
     {
         std::lock_guard lg(mImplMutex);
         if (mState != State::PROCESSING && mState != State::DRAINING) {
             LOG(DEBUG) << getEffectNameWithVersion()
                        << " skip process in state: " << toString(mState);
-            return;
+            return true;
         }
-        RETURN_VALUE_IF(!mImplContext, void(), "nullContext");
-        auto statusMQ = mImplContext->getStatusFmq();
+        RETURN_VALUE_IF(!mImplContext, true, "nullContext");
         auto inputMQ = mImplContext->getInputDataFmq();
         auto outputMQ = mImplContext->getOutputDataFmq();
-        auto buffer = mImplContext->getWorkBuffer();
         if (!inputMQ || !outputMQ) {
-            return;
+            return true;
+        }
+        bool processedInPlace = false;
+        if (isZeroCopyEnabled()) {
+            auto status = processMemTransactions(
+                    *inputMQ, *outputMQ, mImplContext->getInputFrameSize() / sizeof(float),
+                    mImplContext->getOutputFrameSize() / sizeof(float),
+                    [this](float* in, float* out, int samples) {
+                        ::android::base::ScopedLockAssertion lock_assertion(mImplMutex);
+                        return effectProcessImpl(in, out, samples);
+                    });
+            if (status.has_value()) {
+                if (status->fmqConsumed || status->status != STATUS_OK) {
+                    writeStatus(status.value());
+                }
+                processedInPlace = true;
+            }
+            // Otherwise a queue wraps around within a frame, copy through the work buffer.
         }
 
-        assert(mImplContext->getWorkBufferSize() >=
-               std::max(inputMQ->availableToRead(), outputMQ->availableToWrite()));
-        auto processSamples = std::min(inputMQ->availableToRead(), outputMQ->availableToWrite());
-        if (processSamples) {
-            inputMQ->read(buffer, processSamples);
-            IEffect::Status status = effectProcessImpl(buffer, buffer, processSamples);
-            outputMQ->write(buffer, status.fmqProduced);
-            statusMQ->writeBlocking(&status, 1);
+        if (!processedInPlace) {
+            float* buffer = mImplContext->getWorkBuffer();
+            if (workBuffer) {
+                // Only grows until it fits the largest effect of the worker.
+                if (workBuffer->size() < mImplContext->getWorkBufferSize()) {
+                    workBuffer->resize(mImplContext->getWorkBufferSize());
+                }
+                buffer = workBuffer->data();
+            }
+
+            assert(mImplContext->getWorkBufferSize() >=
+                   std::max(inputMQ->availableToRead(), outputMQ->availableToWrite()));
+            auto processSamples =
+                    std::min(inputMQ->availableToRead(), outputMQ->availableToWrite());
+            if (processSamples) {
+                inputMQ->read(buffer, processSamples);
+                IEffect::Status status = effectProcessImpl(buffer, buffer, processSamples);
+                outputMQ->write(buffer, status.fmqProduced);
+                writeStatus(status);
+            }
         }
     }
+    recordProcessTime(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+    return true;
+}
+
+bool EffectImpl::isZeroCopyEnabled() {
+    static const bool enabled =
+            ::android::base::GetBoolProperty("ro.vendor.audio.effect.fmq_zero_copy", false);
+    return enabled;
+}
+
+int EffectImpl::getStatusBatchBlocks() {
+    static const int blocks =
+            ::android::base::GetIntProperty("ro.vendor.audio.effect.status_batch_blocks", 1, 1);
+    return blocks;
+}
+
+void EffectImpl::writeStatus(const IEffect::Status& status) {
+    mPendingStatus.fmqConsumed += status.fmqConsumed;
+    mPendingStatus.fmqProduced += status.fmqProduced;
+    if (status.status != STATUS_OK) {
+        mPendingStatus.status = status.status;
+    }
+    if (++mPendingStatusBlocks >= getStatusBatchBlocks() || status.status != STATUS_OK) {
+        flushStatus();
+    }
+}
+
+void EffectImpl::flushStatus() {
+    if (mPendingStatusBlocks == 0) {
+        return;
+    }
+    if (auto statusMQ = mImplContext ? mImplContext->getStatusFmq() : nullptr) {
+        statusMQ->writeBlocking(&mPendingStatus, 1);
+    }
+    mPendingStatus = {STATUS_OK, 0, 0};
+    mPendingStatusBlocks = 0;
 }
 
 // A placeholder processing implementation to copy samples from input to output
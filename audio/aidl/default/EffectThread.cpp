@@ -31,8 +31,9 @@ EffectThread::~EffectThread() {
     destroyThread();
 }
 
-RetCode EffectThread::createThread(const std::string& name, int priority) {
-    if (mThread.joinable()) {
+RetCode EffectThread::createThread(const std::string& name, int priority,
+                                   std::optional<int> chainId) {
+    if (mThread.joinable() || mWorker) {
         LOG(WARNING) << mName << __func__ << " thread already created, no-op";
         return RetCode::SUCCESS;
     }
@@ -45,6 +46,12 @@ RetCode EffectThread::createThread(const std::string& name, int priority) {
         mExit = false;
     }
 
+    if (chainId.has_value() && EffectWorkerPool::isEnabled()) {
+        mWorker = EffectWorkerPool::getInstance().attach(this, chainId.value(), mPriority);
+        LOG(VERBOSE) << mName << __func__ << " priority " << mPriority << " on shared worker";
+        return RetCode::SUCCESS;
+    }
+
     mThread = std::thread(&EffectThread::threadLoop, this);
     LOG(VERBOSE) << mName << __func__ << " priority " << mPriority << " done";
     return RetCode::SUCCESS;
@@ -57,6 +64,10 @@ RetCode EffectThread::destroyThread() {
     }
 
     mCv.notify_one();
+    if (mWorker) {
+        EffectWorkerPool::getInstance().detach(this, mWorker);
+        mWorker = nullptr;
+    }
     if (mThread.joinable()) {
         mThread.join();
     }
@@ -75,6 +86,9 @@ RetCode EffectThread::startThread() {
         }
         mCv.notify_one();
     }
+    if (mWorker) {
+        mWorker->wake();
+    }
 
     LOG(VERBOSE) << mName << __func__;
     return RetCode::SUCCESS;
@@ -123,8 +137,28 @@ void EffectThread::threadLoop() {
                 return;
             }
         }
-        process();
+        process(0 /* no timeout */, nullptr /* workBuffer */);
+    }
+}
+
+bool EffectThread::isRunning() {
+    std::lock_guard lg(mThreadMutex);
+    return !mStop && !mExit;
+}
+
+void EffectThread::recordProcessTime(int64_t processNs) {
+    mProcessCount.fetch_add(1, std::memory_order_relaxed);
+    mProcessTotalNs.fetch_add(processNs, std::memory_order_relaxed);
+    int64_t max = mProcessMaxNs.load(std::memory_order_relaxed);
+    while (processNs > max &&
+           !mProcessMaxNs.compare_exchange_weak(max, processNs, std::memory_order_relaxed)) {
     }
 }
 
+EffectThread::ProcessStats EffectThread::getProcessStats() const {
+    return {.count = mProcessCount.load(std::memory_order_relaxed),
+            .totalNs = mProcessTotalNs.load(std::memory_order_relaxed),
+            .maxNs = mProcessMaxNs.load(std::memory_order_relaxed)};
+}
+
 }  // namespace aidl::android::hardware::audio::effect
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <optional>
+
+#define LOG_TAG "AHAL_EffectWorkerPool"
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "effect-impl/EffectThread.h"
+#include "effect-impl/EffectWorkerPool.h"
+
+namespace aidl::android::hardware::audio::effect {
+
+EffectWorkerPool::Worker::Worker(int priority, size_t index)
+    : mPriority(priority), mName("EffectWorker" + std::to_string(index)) {
+    mThread = std::thread(&Worker::threadLoop, this);
+}
+
+EffectWorkerPool::Worker::~Worker() {
+    {
+        std::lock_guard lg(mMutex);
+        mExit = true;
+    }
+    mCv.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+size_t EffectWorkerPool::Worker::getEffectCount() {
+    std::lock_guard lg(mMutex);
+    return mEffects.size();
+}
+
+bool EffectWorkerPool::Worker::hasChain(int chainId) {
+    std::lock_guard lg(mMutex);
+    return std::any_of(mEffects.begin(), mEffects.end(),
+                       [chainId](const Entry& entry) { return entry.chainId == chainId; });
+}
+
+void EffectWorkerPool::Worker::attach(EffectThread* effect, int chainId) {
+    {
+        std::lock_guard lg(mMutex);
+        // Insert after the last effect of the same chain, the framework runs a chain in the order
+        // its effects are created.
+        auto it = std::find_if(mEffects.rbegin(), mEffects.rend(), [chainId](const Entry& entry) {
+                      return entry.chainId == chainId;
+                  }).base();
+        if (it == mEffects.begin()) {
+            it = mEffects.end();
+        }
+        mEffects.insert(it, {.effect = effect, .chainId = chainId});
+        mGeneration++;
+    }
+    mCv.notify_all();
+    LOG(DEBUG) << mName << " " << __func__ << " chain " << chainId << ", effects "
+               << getEffectCount();
+}
+
+void EffectWorkerPool::Worker::detach(EffectThread* effect) {
+    std::unique_lock l(mMutex);
+    ::android::base::ScopedLockAssertion lock_assertion(mMutex);
+    std::erase_if(mEffects, [effect](const Entry& entry) { return entry.effect == effect; });
+    mGeneration++;
+    mCv.notify_all();
+    mCv.wait(l, [&]() REQUIRES(mMutex) { return mRunning != effect; });
+}
+
+void EffectWorkerPool::Worker::wake() {
+    {
+        std::lock_guard lg(mMutex);
+        mWakeCount++;
+    }
+    mCv.notify_all();
+}
+
+EffectWorkerPool::Worker::RunResult EffectWorkerPool::Worker::runEffect(EffectThread* effect,
+                                                                        uint64_t generation,
+                                                                        int64_t timeoutNs) {
+    {
+        std::lock_guard lg(mMutex);
+        // The effect might be detached already.
+        if (generation != mGeneration) {
+            return RunResult::NOT_RUNNING;
+        }
+        mRunning = effect;
+    }
+
+    RunResult result = RunResult::NOT_RUNNING;
+    if (effect->isRunning()) {
+        result = effect->process(timeoutNs, &mWorkBuffer) ? RunResult::PROCESSED
+                                                          : RunResult::NO_DATA;
+    }
+
+    {
+        std::lock_guard lg(mMutex);
+        mRunning = nullptr;
+    }
+    mCv.notify_all();
+    return result;
+}
+
+void EffectWorkerPool::Worker::threadLoop() {
+    pthread_setname_np(pthread_self(), mName.substr(0, kMaxTaskNameLen - 1).c_str());
+    setpriority(PRIO_PROCESS, 0, mPriority);
+
+    std::vector<EffectThread*> effects;
+    uint64_t generation = 0;
+    // The effect expected to get data next, the one after the last processed in the chain.
+    size_t next = 0;
+    while (true) {
+        uint64_t wakeCount;
+        {
+            std::lock_guard lg(mMutex);
+            if (mExit) {
+                LOG(VERBOSE) << mName << " threadLoop EXIT!";
+                return;
+            }
+            if (generation != mGeneration) {
+                effects.clear();
+                for (const auto& entry : mEffects) {
+                    effects.push_back(entry.effect);
+                }
+                generation = mGeneration;
+                next = 0;
+            }
+            wakeCount = mWakeCount;
+        }
+
+        if (!effects.empty()) {
+            const size_t count = effects.size();
+            int64_t timeoutNs = count == 1 ? kSingleEffectWaitNs : kChainWaitNs;
+            RunResult result = runEffect(effects[next], generation, timeoutNs);
+            if (result == RunResult::PROCESSED) {
+                next = (next + 1) % count;
+                continue;
+            }
+
+            // An empty poll is a timed wait, it costs at least the timer slack. Only poll the
+            // other effects once the expected one has no data.
+            std::optional<size_t> firstRunning;
+            if (result != RunResult::NOT_RUNNING) {
+                firstRunning = next;
+            }
+            bool processed = false;
+            for (size_t i = 1; i < count && !processed; i++) {
+                size_t index = (next + i) % count;
+                result = runEffect(effects[index], generation, kPollNs);
+                if (result != RunResult::NOT_RUNNING && !firstRunning.has_value()) {
+                    firstRunning = index;
+                }
+                if (result == RunResult::PROCESSED) {
+                    processed = true;
+                    next = (index + 1) % count;
+                }
+            }
+            if (processed) {
+                continue;
+            }
+            if (firstRunning.has_value()) {
+                next = firstRunning.value() == next ? (next + 1) % count : firstRunning.value();
+                continue;
+            }
+        }
+
+        // Nothing to run until an effect is attached, detached or started.
+        std::unique_lock l(mMutex);
+        ::android::base::ScopedLockAssertion lock_assertion(mMutex);
+        mCv.wait(l, [&]() REQUIRES(mMutex) {
+            return mExit || mGeneration != generation || mWakeCount != wakeCount;
+        });
+    }
+}
+
+EffectWorkerPool& EffectWorkerPool::getInstance() {
+    static EffectWorkerPool pool;
+    return pool;
+}
+
+bool EffectWorkerPool::isEnabled() {
+    static const bool enabled =
+            ::android::base::GetBoolProperty("ro.vendor.audio.effect.shared_worker", false);
+    return enabled;
+}
+
+EffectWorkerPool::Worker* EffectWorkerPool::attach(EffectThread* effect, int chainId,
+                                                   int priority) {
+    std::lock_guard lg(mMutex);
+    Worker* target = nullptr;
+    for (const auto& worker : mWorkers) {
+        if (worker->getPriority() == priority && worker->hasChain(chainId)) {
+            target = worker.get();
+            break;
+        }
+    }
+    if (!target) {
+        size_t workerCount = 0;
+        size_t minEffectCount = SIZE_MAX;
+        Worker* leastBusy = nullptr;
+        for (const auto& worker : mWorkers) {
+            if (worker->getPriority() != priority) {
+                continue;
+            }
+            workerCount++;
+            if (size_t effectCount = worker->getEffectCount(); effectCount < minEffectCount) {
+                minEffectCount = effectCount;
+                leastBusy = worker.get();
+            }
+        }
+        if (workerCount >= kMaxWorkerCount) {
+            target = leastBusy;
+        }
+    }
+    if (!target) {
+        target = mWorkers.emplace_back(std::make_unique<Worker>(priority, mWorkers.size())).get();
+        LOG(INFO) << __func__ << " created worker " << mWorkers.size() << " with priority "
+                  << priority;
+    }
+    target->attach(effect, chainId);
+    return target;
+}
+
+void EffectWorkerPool::detach(EffectThread* effect, Worker* worker) {
+    worker->detach(effect);
+}
+
+size_t EffectWorkerPool::getWorkerCount() {
+    std::lock_guard lg(mMutex);
+    return mWorkers.size();
+}
+
+}  // namespace aidl::android::hardware::audio::effect
@@ -15,6 +15,7 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <set>
 #include <unordered_set>
@@ -269,12 +270,171 @@ RetCode DynamicsProcessingSw::releaseContext() {
 
 // Processing method running in EffectWorker thread.
 IEffect::Status DynamicsProcessingSw::effectProcessImpl(float* in, float* out, int samples) {
-    // TODO: get data buffer and process.
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    for (int i = 0; i < samples; i++) {
-        *out++ = *in++;
+    RETURN_VALUE_IF(!mContext, (IEffect::Status{EX_NULL_POINTER, 0, 0}), "nullContext");
+    return mContext->process(in, out, samples);
+}
+
+IEffect::Status DynamicsProcessingSwContext::process(float* in, float* out, int samples) {
+    RETURN_VALUE_IF(mChannelCount == 0, (IEffect::Status{EX_ILLEGAL_ARGUMENT, 0, 0}),
+                    "invalidChannelCount");
+    const size_t frameCount = samples / mChannelCount;
+    const size_t sampleCount = frameCount * mChannelCount;
+
+    for (size_t i = 0; i < sampleCount; i += mChannelCount) {
+        for (size_t channel = 0; channel < mChannelCount; channel++) {
+            out[i + channel] = in[i + channel] * mInputGains[channel];
+        }
+    }
+    if (mEngineSettings.preEqStage.inUse) {
+        mPreEq.process(out, out, frameCount);
+    }
+    if (mEngineSettings.mbcStage.inUse) {
+        if (mMbcSumBuffer.size() < sampleCount) {
+            mMbcBandBuffer.resize(sampleCount);
+            mMbcSumBuffer.resize(sampleCount);
+        }
+        std::fill_n(mMbcSumBuffer.begin(), sampleCount, 0.0f);
+        for (size_t band = 0; band < mMbcCrossovers.size(); band++) {
+            mMbcCrossovers[band].process(out, mMbcBandBuffer.data(), frameCount);
+            mMbcCompressors[band].process(mMbcBandBuffer.data(), frameCount);
+            for (size_t i = 0; i < sampleCount; i++) {
+                mMbcSumBuffer[i] += mMbcBandBuffer[i];
+            }
+        }
+        std::copy_n(mMbcSumBuffer.begin(), sampleCount, out);
+    }
+    if (mEngineSettings.postEqStage.inUse) {
+        mPostEq.process(out, out, frameCount);
+    }
+    if (mEngineSettings.limiterInUse) {
+        mLimiter.process(out, frameCount);
+    }
+    return {STATUS_OK, static_cast<int32_t>(sampleCount), static_cast<int32_t>(sampleCount)};
+}
+
+void DynamicsProcessingSwContext::configureStages() {
+    const float sampleRate = mCommon.input.base.sampleRate;
+    const auto getBandCount = [](const DynamicsProcessing::StageEnablement& stage) {
+        return stage.inUse ? stage.bandCount : 0;
+    };
+    mInputGains.assign(mChannelCount, 1.0f);
+    mPreEq.configure(mChannelCount, getBandCount(mEngineSettings.preEqStage));
+    mPostEq.configure(mChannelCount, getBandCount(mEngineSettings.postEqStage));
+    mMbcCrossovers.resize(getBandCount(mEngineSettings.mbcStage));
+    for (auto& crossover : mMbcCrossovers) {
+        crossover.configure(mChannelCount, 2 /* stageCount */);
+    }
+    mMbcCompressors.resize(getBandCount(mEngineSettings.mbcStage));
+    for (auto& compressor : mMbcCompressors) {
+        compressor.configure(sampleRate, mChannelCount);
+    }
+    mLimiter.configure(sampleRate, mChannelCount);
+    mMbcBandBuffer.resize(mCommon.input.frameCount * mChannelCount);
+    mMbcSumBuffer.resize(mCommon.input.frameCount * mChannelCount);
+
+    updateInputGains();
+    updateEq(mPreEq, mPreEqChCfgs, mPreEqChBands, mEngineSettings.preEqStage);
+    updateEq(mPostEq, mPostEqChCfgs, mPostEqChBands, mEngineSettings.postEqStage);
+    updateMbc();
+    updateLimiter();
+}
+
+void DynamicsProcessingSwContext::updateInputGains() {
+    for (const auto& cfg : mInputGainCfgs) {
+        if (cfg.channel != kInvalidChannelId && (size_t)cfg.channel < mInputGains.size()) {
+            mInputGains[cfg.channel] = std::pow(10.0f, cfg.gainDb / 20.0f);
+        }
+    }
+}
+
+void DynamicsProcessingSwContext::updateEq(
+        BiquadFilterBank& filters,
+        const std::vector<DynamicsProcessing::ChannelConfig>& channelConfig,
+        const std::vector<DynamicsProcessing::EqBandConfig>& bands,
+        const DynamicsProcessing::StageEnablement& stage) {
+    if (!stage.inUse || bands.size() < mChannelCount * stage.bandCount) return;
+    const float sampleRate = mCommon.input.base.sampleRate;
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        // A band covers from the cutoff of the previous band to its own cutoff, the first one is
+        // a low shelf.
+        float lowerHz = 0;
+        for (int band = 0; band < stage.bandCount; band++) {
+            const auto& cfg = bands[channel * stage.bandCount + band];
+            BiquadCoefficients coefficients;
+            if (channelConfig[channel].enable && cfg.channel != kInvalidChannelId && cfg.enable) {
+                if (band == 0 || cfg.cutoffFrequencyHz <= lowerHz) {
+                    coefficients = BiquadCoefficients::lowShelf(sampleRate, cfg.cutoffFrequencyHz,
+                                                                cfg.gainDb);
+                } else {
+                    const float centerHz = std::sqrt(lowerHz * cfg.cutoffFrequencyHz);
+                    const float q =
+                            std::clamp(centerHz / (cfg.cutoffFrequencyHz - lowerHz), 0.3f, 10.0f);
+                    coefficients =
+                            BiquadCoefficients::peaking(sampleRate, centerHz, q, cfg.gainDb);
+                }
+            }
+            filters.setCoefficients(channel, band, coefficients);
+            if (cfg.channel != kInvalidChannelId) {
+                lowerHz = cfg.cutoffFrequencyHz;
+            }
+        }
+    }
+}
+
+void DynamicsProcessingSwContext::updateMbc() {
+    const int bandCount = mMbcCompressors.size();
+    if (bandCount == 0 || mMbcChBands.size() < mChannelCount * bandCount) return;
+    const float sampleRate = mCommon.input.base.sampleRate;
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        const bool channelEnabled = mMbcChCfgs[channel].enable;
+        for (int band = 0; band < bandCount; band++) {
+            const auto& cfg = mMbcChBands[channel * bandCount + band];
+            auto& crossover = mMbcCrossovers[band];
+            if (!channelEnabled) {
+                // Only the first band passes the channel through.
+                crossover.setCoefficients(
+                        channel, 0, band == 0 ? BiquadCoefficients{} : BiquadCoefficients::mute());
+                crossover.setCoefficients(channel, 1, {});
+                mMbcCompressors[band].setConfig(channel, {.enable = false});
+                continue;
+            }
+            const auto& previous = mMbcChBands[channel * bandCount + std::max(band - 1, 0)];
+            crossover.setCoefficients(
+                    channel, 0,
+                    band == 0 ? BiquadCoefficients{}
+                              : BiquadCoefficients::highPass(sampleRate,
+                                                             previous.cutoffFrequencyHz));
+            crossover.setCoefficients(
+                    channel, 1,
+                    band == bandCount - 1
+                            ? BiquadCoefficients{}
+                            : BiquadCoefficients::lowPass(sampleRate, cfg.cutoffFrequencyHz));
+            mMbcCompressors[band].setConfig(
+                    channel, {.enable = cfg.channel != kInvalidChannelId && cfg.enable,
+                              .attackTimeMs = cfg.attackTimeMs,
+                              .releaseTimeMs = cfg.releaseTimeMs,
+                              .ratio = cfg.ratio,
+                              .thresholdDb = cfg.thresholdDb,
+                              .kneeWidthDb = cfg.kneeWidthDb,
+                              .noiseGateThresholdDb = cfg.noiseGateThresholdDb,
+                              .expanderRatio = cfg.expanderRatio,
+                              .preGainDb = cfg.preGainDb,
+                              .postGainDb = cfg.postGainDb});
+        }
+    }
+}
+
+void DynamicsProcessingSwContext::updateLimiter() {
+    for (size_t channel = 0; channel < mLimiterCfgs.size(); channel++) {
+        const auto& cfg = mLimiterCfgs[channel];
+        mLimiter.setConfig(channel, {.enable = mEngineSettings.limiterInUse &&
+                                               cfg.channel != kInvalidChannelId && cfg.enable,
+                                     .attackTimeMs = cfg.attackTimeMs,
+                                     .releaseTimeMs = cfg.releaseTimeMs,
+                                     .ratio = cfg.ratio,
+                                     .thresholdDb = cfg.thresholdDb,
+                                     .postGainDb = cfg.postGainDb});
     }
-    return {STATUS_OK, samples, samples};
 }
 
 RetCode DynamicsProcessingSwContext::setCommon(const Parameter::Common& common) {
@@ -286,6 +446,7 @@ RetCode DynamicsProcessingSwContext::setCommon(const Parameter::Common& common)
             common.input.base.channelMask);
     resizeChannels();
     resizeBands();
+    configureStages();
     LOG(INFO) << __func__ << mCommon.toString();
     return RetCode::SUCCESS;
 }
@@ -301,6 +462,7 @@ RetCode DynamicsProcessingSwContext::setEngineArchitecture(
     }
     mEngineSettings = cfg;
     resizeBands();
+    configureStages();
     return RetCode::SUCCESS;
 }
 
@@ -331,17 +493,23 @@ RetCode DynamicsProcessingSwContext::setChannelCfgs(
 
 RetCode DynamicsProcessingSwContext::setPreEqChannelCfgs(
         const std::vector<DynamicsProcessing::ChannelConfig>& cfgs) {
-    return setChannelCfgs(cfgs, mPreEqChCfgs, mEngineSettings.preEqStage);
+    RetCode ret = setChannelCfgs(cfgs, mPreEqChCfgs, mEngineSettings.preEqStage);
+    updateEq(mPreEq, mPreEqChCfgs, mPreEqChBands, mEngineSettings.preEqStage);
+    return ret;
 }
 
 RetCode DynamicsProcessingSwContext::setPostEqChannelCfgs(
         const std::vector<DynamicsProcessing::ChannelConfig>& cfgs) {
-    return setChannelCfgs(cfgs, mPostEqChCfgs, mEngineSettings.postEqStage);
+    RetCode ret = setChannelCfgs(cfgs, mPostEqChCfgs, mEngineSettings.postEqStage);
+    updateEq(mPostEq, mPostEqChCfgs, mPostEqChBands, mEngineSettings.postEqStage);
+    return ret;
 }
 
 RetCode DynamicsProcessingSwContext::setMbcChannelCfgs(
         const std::vector<DynamicsProcessing::ChannelConfig>& cfgs) {
-    return setChannelCfgs(cfgs, mMbcChCfgs, mEngineSettings.mbcStage);
+    RetCode ret = setChannelCfgs(cfgs, mMbcChCfgs, mEngineSettings.mbcStage);
+    updateMbc();
+    return ret;
 }
 
 RetCode DynamicsProcessingSwContext::setEqBandCfgs(
@@ -373,12 +541,16 @@ RetCode DynamicsProcessingSwContext::setEqBandCfgs(
 
 RetCode DynamicsProcessingSwContext::setPreEqBandCfgs(
         const std::vector<DynamicsProcessing::EqBandConfig>& cfgs) {
-    return setEqBandCfgs(cfgs, mPreEqChBands, mEngineSettings.preEqStage, mPreEqChCfgs);
+    RetCode ret = setEqBandCfgs(cfgs, mPreEqChBands, mEngineSettings.preEqStage, mPreEqChCfgs);
+    updateEq(mPreEq, mPreEqChCfgs, mPreEqChBands, mEngineSettings.preEqStage);
+    return ret;
 }
 
 RetCode DynamicsProcessingSwContext::setPostEqBandCfgs(
         const std::vector<DynamicsProcessing::EqBandConfig>& cfgs) {
-    return setEqBandCfgs(cfgs, mPostEqChBands, mEngineSettings.postEqStage, mPostEqChCfgs);
+    RetCode ret = setEqBandCfgs(cfgs, mPostEqChBands, mEngineSettings.postEqStage, mPostEqChCfgs);
+    updateEq(mPostEq, mPostEqChCfgs, mPostEqChBands, mEngineSettings.postEqStage);
+    return ret;
 }
 
 RetCode DynamicsProcessingSwContext::setMbcBandCfgs(
@@ -406,6 +578,7 @@ RetCode DynamicsProcessingSwContext::setMbcBandCfgs(
         }
         mMbcChBands[it.channel * bandCount + it.band] = it;
     }
+    updateMbc();
     return ret;
 }
 
@@ -431,6 +604,7 @@ RetCode DynamicsProcessingSwContext::setLimiterCfgs(
         }
         mLimiterCfgs[it.channel] = it;
     }
+    updateLimiter();
     return ret;
 }
 
@@ -474,6 +648,7 @@ RetCode DynamicsProcessingSwContext::setInputGainCfgs(
                         RetCode::ERROR_ILLEGAL_PARAMETER, "invalidChannel");
         mInputGainCfgs[cfg.channel] = cfg;
     }
+    updateInputGains();
     return RetCode::SUCCESS;
 }
 
@@ -24,6 +24,7 @@
 #include <aidl/android/hardware/audio/effect/BnEffect.h>
 #include <fmq/AidlMessageQueue.h>
 
+#include "effect-impl/EffectDsp.h"
 #include "effect-impl/EffectImpl.h"
 
 namespace aidl::android::hardware::audio::effect {
@@ -39,8 +40,11 @@ class DynamicsProcessingSwContext final : public EffectContext {
           mMbcChCfgs(mChannelCount, {.channel = kInvalidChannelId}),
           mLimiterCfgs(mChannelCount, {.channel = kInvalidChannelId}) {
         LOG(DEBUG) << __func__;
+        configureStages();
     }
 
+    IEffect::Status process(float* in, float* out, int samples);
+
     // utils
     RetCode setChannelCfgs(const std::vector<DynamicsProcessing::ChannelConfig>& cfgs,
                            std::vector<DynamicsProcessing::ChannelConfig>& targetCfgs,
@@ -88,6 +92,19 @@ class DynamicsProcessingSwContext final : public EffectContext {
     std::vector<DynamicsProcessing::EqBandConfig> mPreEqChBands;
     std::vector<DynamicsProcessing::EqBandConfig> mPostEqChBands;
     std::vector<DynamicsProcessing::MbcBandConfig> mMbcChBands;
+
+    // Processing stages, in processing order.
+    std::vector<float> mInputGains;
+    BiquadFilterBank mPreEq;
+    // Each MBC band is split from the input with a high pass at the cutoff of the previous band
+    // and a low pass at its own cutoff, compressed, then all bands are summed.
+    std::vector<BiquadFilterBank> mMbcCrossovers;
+    std::vector<CompressorBank> mMbcCompressors;
+    std::vector<float> mMbcBandBuffer;
+    std::vector<float> mMbcSumBuffer;
+    BiquadFilterBank mPostEq;
+    CompressorBank mLimiter;
+
     bool validateStageEnablement(const DynamicsProcessing::StageEnablement& enablement);
     bool validateEngineConfig(const DynamicsProcessing::EngineArchitecture& engine);
     bool validateEqBandConfig(const DynamicsProcessing::EqBandConfig& band, int maxChannel,
@@ -99,6 +116,14 @@ class DynamicsProcessingSwContext final : public EffectContext {
     bool validateLimiterConfig(const DynamicsProcessing::LimiterConfig& limiter, int maxChannel);
     void resizeChannels();
     void resizeBands();
+    void configureStages();
+    void updateInputGains();
+    void updateEq(BiquadFilterBank& filters,
+                  const std::vector<DynamicsProcessing::ChannelConfig>& channelConfig,
+                  const std::vector<DynamicsProcessing::EqBandConfig>& bands,
+                  const DynamicsProcessing::StageEnablement& stage);
+    void updateMbc();
+    void updateLimiter();
 };  // DynamicsProcessingSwContext
 
 class DynamicsProcessingSw final : public EffectImpl {
@@ -207,12 +207,48 @@ RetCode EqualizerSw::releaseContext() {
 
 // Processing method running in EffectWorker thread.
 IEffect::Status EqualizerSw::effectProcessImpl(float* in, float* out, int samples) {
-    // TODO: get data buffer and process.
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    for (int i = 0; i < samples; i++) {
-        *out++ = *in++;
+    RETURN_VALUE_IF(!mContext, (IEffect::Status{EX_NULL_POINTER, 0, 0}), "nullContext");
+    return mContext->process(in, out, samples);
+}
+
+RetCode EqualizerSwContext::setCommon(const Parameter::Common& common) {
+    if (auto ret = EffectContext::setCommon(common); ret != RetCode::SUCCESS) {
+        return ret;
+    }
+    mFilters.configure(mInputChannelCount, kMaxBandNumber);
+    updateFilters();
+    return RetCode::SUCCESS;
+}
+
+void EqualizerSwContext::updateFilters() {
+    constexpr float kPeakingQ = 1.0f;
+    const float sampleRate = mCommon.input.base.sampleRate;
+    for (int band = 0; band < kMaxBandNumber; band++) {
+        const float frequencyHz = kPresetsFrequencies[band];
+        // Band levels are in millibels.
+        const float gainDb = mBandLevels[band] / 100.0f;
+        BiquadCoefficients coefficients;
+        if (band == 0) {
+            coefficients = BiquadCoefficients::lowShelf(sampleRate, frequencyHz, gainDb);
+        } else if (band == kMaxBandNumber - 1) {
+            coefficients = BiquadCoefficients::highShelf(sampleRate, frequencyHz, gainDb);
+        } else {
+            coefficients = BiquadCoefficients::peaking(sampleRate, frequencyHz, kPeakingQ, gainDb);
+        }
+        for (size_t channel = 0; channel < mFilters.getChannelCount(); channel++) {
+            mFilters.setCoefficients(channel, band, coefficients);
+        }
     }
-    return {STATUS_OK, samples, samples};
+}
+
+IEffect::Status EqualizerSwContext::process(float* in, float* out, int samples) {
+    const size_t channelCount = mFilters.getChannelCount();
+    RETURN_VALUE_IF(channelCount == 0, (IEffect::Status{EX_ILLEGAL_ARGUMENT, 0, 0}),
+                    "invalidChannelCount");
+    const size_t frameCount = samples / channelCount;
+    mFilters.process(in, out, frameCount);
+    const int32_t processed = frameCount * channelCount;
+    return {STATUS_OK, processed, processed};
 }
 
 }  // namespace aidl::android::hardware::audio::effect
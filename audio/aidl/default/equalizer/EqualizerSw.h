@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include <memory>
 
+#include "effect-impl/EffectDsp.h"
 #include "effect-impl/EffectImpl.h"
 
 namespace aidl::android::hardware::audio::effect {
@@ -30,8 +31,13 @@ class EqualizerSwContext final : public EffectContext {
     EqualizerSwContext(int statusDepth, const Parameter::Common& common)
         : EffectContext(statusDepth, common) {
         LOG(DEBUG) << __func__;
+        mFilters.configure(mInputChannelCount, kMaxBandNumber);
+        updateFilters();
     }
 
+    RetCode setCommon(const Parameter::Common& common) override;
+    IEffect::Status process(float* in, float* out, int samples);
+
     RetCode setEqPreset(const int& presetIdx) {
         if (presetIdx < 0 || presetIdx >= kMaxPresetNumber) {
             return RetCode::ERROR_ILLEGAL_PARAMETER;
@@ -56,6 +62,7 @@ class EqualizerSwContext final : public EffectContext {
                 mBandLevels[it.index] = it.levelMb;
             }
         }
+        updateFilters();
         return ret;
     }
 
@@ -80,8 +87,10 @@ class EqualizerSwContext final : public EffectContext {
     // preset band level
     int mPreset = kCustomPreset;
     int32_t mBandLevels[kMaxBandNumber] = {3, 0, 0, 0, 3};
+    // A low shelf, peaking filters for the middle bands and a high shelf, one stage per band.
+    BiquadFilterBank mFilters;
 
-    // Add equalizer specific context for processing here
+    void updateFilters();
 };
 
 class EqualizerSw final : public EffectImpl {
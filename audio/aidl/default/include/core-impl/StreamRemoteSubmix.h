@@ -51,11 +51,19 @@ class StreamRemoteSubmix : public StreamCommonImpl {
     size_t getStreamPipeSizeInFrames();
     ::android::status_t outWrite(void* buffer, size_t frameCount, size_t* actualFrameCount);
     ::android::status_t inRead(void* buffer, size_t frameCount, size_t* actualFrameCount);
+    // Used instead of the MonoPipe when 'SubmixRoute::isLockFreePipeEnabled'.
+    r_submix::SubmixRing* getRing();
+    ::android::status_t outWriteRing(void* buffer, size_t frameCount, size_t* actualFrameCount);
+    ::android::status_t inReadRing(void* buffer, size_t frameCount, size_t* actualFrameCount);
 
     const ::aidl::android::media::audio::common::AudioDeviceAddress mDeviceAddress;
     const bool mIsInput;
     r_submix::AudioConfig mStreamConfig;
     std::shared_ptr<r_submix::SubmixRoute> mCurrentRoute = nullptr;
+    // The ring of the current route as of 'mRingGeneration', refreshed when the route recreates
+    // its pipe.
+    std::shared_ptr<r_submix::SubmixRing> mRing;
+    int mRingGeneration = -1;
 
     // Limit for the number of error log entries to avoid spamming the logs.
     static constexpr int kMaxErrorLogs = 5;
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace aidl::android::hardware::audio::effect {
+
+/**
+ * DSP kernels shared by the software reference effects.
+ *
+ * Audio is interleaved float. Channels are processed four at a time with NEON or SSE when
+ * available, with a scalar fallback otherwise. Each channel has its own parameters.
+ */
+
+struct BiquadCoefficients {
+    float b0 = 1.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float a1 = 0.0f;
+    float a2 = 0.0f;
+
+    // Designs from the Audio EQ Cookbook, frequencies are clamped below Nyquist.
+    static BiquadCoefficients peaking(float sampleRate, float frequencyHz, float q, float gainDb);
+    static BiquadCoefficients lowShelf(float sampleRate, float frequencyHz, float gainDb);
+    static BiquadCoefficients highShelf(float sampleRate, float frequencyHz, float gainDb);
+    // Second order Butterworth.
+    static BiquadCoefficients lowPass(float sampleRate, float frequencyHz);
+    static BiquadCoefficients highPass(float sampleRate, float frequencyHz);
+    // Outputs silence.
+    static BiquadCoefficients mute() { return {.b0 = 0.0f}; }
+};
+
+/**
+ * A cascade of biquad filters per channel, transposed direct form II.
+ */
+class BiquadFilterBank {
+  public:
+    // Resets all stages to pass through and clears the filter state.
+    void configure(size_t channelCount, size_t stageCount);
+    void setCoefficients(size_t channel, size_t stage, const BiquadCoefficients& coefficients);
+    void clearState();
+
+    size_t getChannelCount() const { return mChannelCount; }
+    size_t getStageCount() const { return mStageCount; }
+
+    // in and out can be the same buffer.
+    void process(const float* in, float* out, size_t frameCount);
+
+  private:
+    static constexpr size_t kCoefficientCount = 5;
+
+    size_t mChannelCount = 0;
+    size_t mStageCount = 0;
+    // [channel group][stage][coefficient][lane], the last group is padded with pass through.
+    std::vector<float> mCoefficients;
+    // [channel group][stage][2][lane].
+    std::vector<float> mState;
+};
+
+struct CompressorConfig {
+    bool enable = false;
+    float attackTimeMs = 1.0f;
+    float releaseTimeMs = 60.0f;
+    float ratio = 1.0f;
+    float thresholdDb = 0.0f;
+    float kneeWidthDb = 0.0f;
+    float noiseGateThresholdDb = -90.0f;
+    float expanderRatio = 1.0f;
+    float preGainDb = 0.0f;
+    float postGainDb = 0.0f;
+};
+
+/**
+ * Feed-forward compressor with a downward expander below the noise gate threshold.
+ *
+ * The peak envelope is tracked every frame, the gain computer runs in the log domain once every
+ * kGainIntervalFrames frames and the gain is ramped linearly in between. A disabled channel is
+ * passed through.
+ */
+class CompressorBank {
+  public:
+    static constexpr size_t kGainIntervalFrames = 16;
+
+    // Resets all channels to disabled and clears the envelopes.
+    void configure(float sampleRate, size_t channelCount);
+    void setConfig(size_t channel, const CompressorConfig& config);
+    void clearState();
+
+    size_t getChannelCount() const { return mChannelCount; }
+
+    // Processes in place.
+    void process(float* buffer, size_t frameCount);
+
+    // Static gain in dB for an input level in dB, before the pre and post gains.
+    static float computeGainDb(const CompressorConfig& config, float levelDb);
+
+  private:
+    float mSampleRate = 0.0f;
+    size_t mChannelCount = 0;
+    std::vector<CompressorConfig> mConfigs;
+    // [channel group][lane] values, the last group is padded with pass through.
+    std::vector<float> mPreGain;
+    std::vector<float> mAttack;
+    std::vector<float> mRelease;
+    std::vector<float> mEnvelope;
+    std::vector<float> mGain;
+    std::vector<float> mGainStep;
+
+    void updateGainStep(size_t channel);
+};
+
+}  // namespace aidl::android::hardware::audio::effect
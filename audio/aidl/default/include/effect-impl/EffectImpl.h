@@ -25,6 +25,7 @@
 #include "EffectThread.h"
 #include "EffectTypes.h"
 #include "effect-impl/EffectContext.h"
+#include "effect-impl/EffectMemTransaction.h"
 #include "effect-impl/EffectThread.h"
 #include "effect-impl/EffectTypes.h"
 
@@ -49,6 +50,8 @@ class EffectImpl : public BnEffect, public EffectThread {
     virtual ndk::ScopedAStatus setParameter(const Parameter& param) override;
     virtual ndk::ScopedAStatus getParameter(const Parameter::Id& id, Parameter* param) override;
 
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
     virtual ndk::ScopedAStatus setParameterCommon(const Parameter& param) REQUIRES(mImplMutex);
     virtual ndk::ScopedAStatus getParameterCommon(const Parameter::Tag& tag, Parameter* param)
             REQUIRES(mImplMutex);
@@ -86,7 +89,20 @@ class EffectImpl : public BnEffect, public EffectThread {
      * process() get data from data MQs, and call effectProcessImpl() for effect data processing.
      * Its important for the implementation to use mImplMutex for context synchronization.
      */
-    void process() override;
+    bool process(int64_t timeoutNs, std::vector<float>* workBuffer) override;
+
+    /**
+     * When enabled with the ro.vendor.audio.effect.fmq_zero_copy system property, process() hands
+     * effectProcessImpl() the input and output data FMQ memory directly instead of copying the
+     * data through the work buffer, in and out are then different buffers.
+     */
+    static bool isZeroCopyEnabled();
+    /**
+     * Number of processed blocks reported by each status FMQ write, set with the
+     * ro.vendor.audio.effect.status_batch_blocks system property. 1 by default, the client must
+     * expect the batching otherwise. Errors and stop or reset flush the pending status.
+     */
+    static int getStatusBatchBlocks();
 
   protected:
     // current Hal version
@@ -118,5 +134,13 @@ class EffectImpl : public BnEffect, public EffectThread {
     }
 
     ::android::hardware::EventFlag* mEventFlag;
+
+  private:
+    // Status accumulated over the blocks processed since the last status FMQ write.
+    IEffect::Status mPendingStatus GUARDED_BY(mImplMutex) = {STATUS_OK, 0, 0};
+    int mPendingStatusBlocks GUARDED_BY(mImplMutex) = 0;
+
+    void writeStatus(const IEffect::Status& status) REQUIRES(mImplMutex);
+    void flushStatus() REQUIRES(mImplMutex);
 };
 }  // namespace aidl::android::hardware::audio::effect
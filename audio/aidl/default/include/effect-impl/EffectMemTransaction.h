@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <optional>
+
+#include <aidl/android/hardware/audio/effect/IEffect.h>
+
+namespace aidl::android::hardware::audio::effect {
+
+namespace detail {
+
+// Number of messages contiguous in memory from message index in the transaction.
+template <typename MemTransaction>
+size_t getContiguousLength(const MemTransaction& transaction, size_t index) {
+    const size_t firstLength = transaction.getFirstRegion().getLength();
+    return index < firstLength ? firstLength - index
+                               : transaction.getSecondRegion().getLength() - (index - firstLength);
+}
+
+}  // namespace detail
+
+/**
+ * Processes the data available in inputMQ directly into outputMQ, without copying it through a
+ * work buffer.
+ *
+ * Both queues are accessed with memory transactions. process is called with the runs of whole
+ * frames that are contiguous in both queues, a run ends where either queue wraps around. Stops
+ * at the first run that process does not fully consume or that does not return STATUS_OK. Only
+ * what process consumed and produced is committed.
+ *
+ * Returns std::nullopt without touching the queues when a queue wraps around within a frame, the
+ * caller has to fall back to copying the data.
+ */
+template <typename MQ, typename Process>
+std::optional<IEffect::Status> processMemTransactions(MQ& inputMQ, MQ& outputMQ,
+                                                      size_t inputFrameSamples,
+                                                      size_t outputFrameSamples,
+                                                      Process&& process) {
+    const size_t frameCount = std::min(inputMQ.availableToRead() / inputFrameSamples,
+                                       outputMQ.availableToWrite() / outputFrameSamples);
+    IEffect::Status result = {STATUS_OK, 0, 0};
+    if (frameCount == 0) {
+        return result;
+    }
+
+    typename MQ::MemTransaction input, output;
+    if (!inputMQ.beginRead(frameCount * inputFrameSamples, &input) ||
+        !outputMQ.beginWrite(frameCount * outputFrameSamples, &output)) {
+        return std::nullopt;
+    }
+    if (input.getFirstRegion().getLength() % inputFrameSamples != 0 ||
+        output.getFirstRegion().getLength() % outputFrameSamples != 0) {
+        return std::nullopt;
+    }
+
+    size_t consumed = 0;
+    size_t produced = 0;
+    while (consumed < frameCount * inputFrameSamples) {
+        const size_t runFrames =
+                std::min(detail::getContiguousLength(input, consumed) / inputFrameSamples,
+                         detail::getContiguousLength(output, produced) / outputFrameSamples);
+        if (runFrames == 0) {
+            // The effect produced less than a frame per frame consumed.
+            break;
+        }
+        const int samples = runFrames * inputFrameSamples;
+        const IEffect::Status status =
+                process(input.getSlot(consumed), output.getSlot(produced), samples);
+        consumed += status.fmqConsumed;
+        produced += status.fmqProduced;
+        if (status.status != STATUS_OK || status.fmqConsumed < samples) {
+            result.status = status.status;
+            break;
+        }
+    }
+    inputMQ.commitRead(consumed);
+    outputMQ.commitWrite(produced);
+    result.fmqConsumed = consumed;
+    result.fmqProduced = produced;
+    return result;
+}
+
+}  // namespace aidl::android::hardware::audio::effect
@@ -17,8 +17,10 @@
 #pragma once
 #include <atomic>
 #include <memory>
+#include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <android-base/thread_annotations.h>
 #include <fmq/EventFlag.h>
@@ -26,15 +28,25 @@
 
 #include "effect-impl/EffectContext.h"
 #include "effect-impl/EffectTypes.h"
+#include "effect-impl/EffectWorkerPool.h"
 
 namespace aidl::android::hardware::audio::effect {
 
 class EffectThread {
   public:
+    struct ProcessStats {
+        uint64_t count = 0;
+        int64_t totalNs = 0;
+        int64_t maxNs = 0;
+    };
+
     virtual ~EffectThread();
 
     // called by effect implementation
-    RetCode createThread(const std::string& name, int priority = ANDROID_PRIORITY_URGENT_AUDIO);
+    // With a chainId, the effect is run by a shared EffectWorkerPool worker instead of its own
+    // thread if the pool is enabled.
+    RetCode createThread(const std::string& name, int priority = ANDROID_PRIORITY_URGENT_AUDIO,
+                         std::optional<int> chainId = std::nullopt);
     RetCode destroyThread();
     RetCode startThread();
     RetCode stopThread();
@@ -44,16 +56,29 @@ class EffectThread {
     // Will call process() in a loop if the thread is running.
     void threadLoop();
 
+    // Whether the effect is started, used by the shared worker.
+    bool isRunning();
+    bool isOnSharedWorker() const { return mWorker != nullptr; }
+
     /**
-     * process() call effectProcessImpl() for effect data processing, it is necessary for the
-     * processing to be called under Effect thread mutex mThreadMutex, to avoid the effect state
-     * change before/during data processing, and keep the thread and effect state consistent.
+     * process() waits for data for up to timeoutNs (0 means no timeout), then call
+     * effectProcessImpl() for effect data processing, it is necessary for the processing to be
+     * called under Effect thread mutex mThreadMutex, to avoid the effect state change
+     * before/during data processing, and keep the thread and effect state consistent.
+     *
+     * @param workBuffer the buffer of the shared worker, nullptr to use the effect's own buffer.
+     * @return false if no data arrived before the timeout.
      */
-    virtual void process() = 0;
+    virtual bool process(int64_t timeoutNs, std::vector<float>* workBuffer) = 0;
+
+    ProcessStats getProcessStats() const;
 
   protected:
     bool mDraining GUARDED_BY(mThreadMutex) = false;
 
+    // Records the time taken by one process() call, excluding the wait for data.
+    void recordProcessTime(int64_t processNs);
+
   private:
     static constexpr int kMaxTaskNameLen = 15;
 
@@ -63,7 +88,13 @@ class EffectThread {
     bool mExit GUARDED_BY(mThreadMutex) = false;
 
     std::thread mThread;
+    // Set instead of mThread when running on a shared worker.
+    EffectWorkerPool::Worker* mWorker = nullptr;
     int mPriority;
     std::string mName;
+
+    std::atomic<uint64_t> mProcessCount = 0;
+    std::atomic<int64_t> mProcessTotalNs = 0;
+    std::atomic<int64_t> mProcessMaxNs = 0;
 };
 }  // namespace aidl::android::hardware::audio::effect
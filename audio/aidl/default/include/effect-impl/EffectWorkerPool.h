@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+
+namespace aidl::android::hardware::audio::effect {
+
+class EffectThread;
+
+/**
+ * Runs the processing of effect instances on a few shared worker threads instead of one thread
+ * per instance.
+ *
+ * Effects attached with the same chain ID (the ioHandle of the stream they are applied to) are
+ * always run by the same worker, back-to-back in the order they were attached, and share the
+ * worker's work buffer. Effects with different priorities never share a worker.
+ *
+ * A thread can not wait on the event flags of several effects at once. A worker blocks on the
+ * event flag of the effect expected next in the chain, the one after the last processed, for at
+ * most kChainWaitNs. Only when that times out are the other effects polled.
+ *
+ * The bounded waits make chains shorter than 6 effects slower than on dedicated threads, see
+ * audio_effect_worker_pool_benchmark. The pool is only worth enabling on devices running chains
+ * of 6 effects or more, where it saves threads and wakeups for about the same latency.
+ *
+ * Disabled by default, enabled with the ro.vendor.audio.effect.shared_worker system property.
+ * Each effect library has its own pool.
+ */
+class EffectWorkerPool {
+  public:
+    class Worker {
+      public:
+        Worker(int priority, size_t index);
+        ~Worker();
+
+        int getPriority() const { return mPriority; }
+        size_t getEffectCount();
+        bool hasChain(int chainId);
+
+        void attach(EffectThread* effect, int chainId);
+        // Blocks until the worker is not running the effect anymore.
+        void detach(EffectThread* effect);
+        // Called when an attached effect is started.
+        void wake();
+
+      private:
+        // Time spent blocked on the event flag of the effect expected next before polling the
+        // others.
+        static constexpr int64_t kChainWaitNs = 1'000'000;
+        // The same for a worker with a single effect, only bounds the time to notice a newly
+        // attached effect.
+        static constexpr int64_t kSingleEffectWaitNs = 20'000'000;
+        // The shortest EventFlag wait timeout, 0 means no timeout.
+        static constexpr int64_t kPollNs = 1;
+        static constexpr int kMaxTaskNameLen = 15;
+
+        enum class RunResult { NOT_RUNNING, NO_DATA, PROCESSED };
+
+        struct Entry {
+            EffectThread* effect;
+            int chainId;
+        };
+
+        const int mPriority;
+        const std::string mName;
+
+        std::mutex mMutex;
+        std::condition_variable mCv;
+        // Effects of the same chain are kept next to each other, in attach order.
+        std::vector<Entry> mEffects GUARDED_BY(mMutex);
+        // Incremented on every attach and detach.
+        uint64_t mGeneration GUARDED_BY(mMutex) = 0;
+        // Incremented when an attached effect is started.
+        uint64_t mWakeCount GUARDED_BY(mMutex) = 0;
+        EffectThread* mRunning GUARDED_BY(mMutex) = nullptr;
+        bool mExit GUARDED_BY(mMutex) = false;
+
+        // Only used on the worker thread.
+        std::vector<float> mWorkBuffer;
+        std::thread mThread;
+
+        void threadLoop();
+        RunResult runEffect(EffectThread* effect, uint64_t generation, int64_t timeoutNs);
+    };
+
+    // Workers per priority. Past this, new chains share the least busy worker with the same
+    // priority.
+    static constexpr size_t kMaxWorkerCount = 4;
+
+    static EffectWorkerPool& getInstance();
+    static bool isEnabled();
+
+    // Returns the worker the effect is attached to.
+    Worker* attach(EffectThread* effect, int chainId, int priority);
+    void detach(EffectThread* effect, Worker* worker);
+
+    size_t getWorkerCount();
+
+  private:
+    std::mutex mMutex;
+    std::vector<std::unique_ptr<Worker>> mWorkers GUARDED_BY(mMutex);
+};
+
+}  // namespace aidl::android::hardware::audio::effect
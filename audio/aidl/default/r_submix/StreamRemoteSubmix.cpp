@@ -24,6 +24,7 @@
 
 using aidl::android::hardware::audio::common::SinkMetadata;
 using aidl::android::hardware::audio::common::SourceMetadata;
+using aidl::android::hardware::audio::core::r_submix::SubmixRing;
 using aidl::android::hardware::audio::core::r_submix::SubmixRoute;
 using aidl::android::media::audio::common::AudioDeviceAddress;
 using aidl::android::media::audio::common::AudioOffloadInfo;
@@ -60,12 +61,23 @@ StreamRemoteSubmix::~StreamRemoteSubmix() {
         LOG(ERROR) << __func__ << ": invalid stream config";
         return ::android::NO_INIT;
     }
-    sp<MonoPipe> sink = mCurrentRoute->getSink();
-    if (sink == nullptr) {
-        LOG(ERROR) << __func__ << ": nullptr sink when opening stream";
-        return ::android::NO_INIT;
+    bool isPipeShutdown;
+    if (SubmixRoute::isLockFreePipeEnabled()) {
+        std::shared_ptr<SubmixRing> ring = mCurrentRoute->getRing();
+        if (ring == nullptr) {
+            LOG(ERROR) << __func__ << ": nullptr ring when opening stream";
+            return ::android::NO_INIT;
+        }
+        isPipeShutdown = ring->isShutdown();
+    } else {
+        sp<MonoPipe> sink = mCurrentRoute->getSink();
+        if (sink == nullptr) {
+            LOG(ERROR) << __func__ << ": nullptr sink when opening stream";
+            return ::android::NO_INIT;
+        }
+        isPipeShutdown = sink->isShutdown();
     }
-    if ((!mIsInput || mCurrentRoute->isStreamInOpen()) && sink->isShutdown()) {
+    if ((!mIsInput || mCurrentRoute->isStreamInOpen()) && isPipeShutdown) {
         LOG(DEBUG) << __func__ << ": Shut down sink when opening stream";
         if (::android::OK != mCurrentRoute->resetPipe()) {
             LOG(ERROR) << __func__ << ": reset pipe failed";
@@ -104,7 +116,13 @@ StreamRemoteSubmix::~StreamRemoteSubmix() {
 ndk::ScopedAStatus StreamRemoteSubmix::prepareToClose() {
     if (!mIsInput) {
         std::shared_ptr<SubmixRoute> route = SubmixRoute::findRoute(mDeviceAddress);
-        if (route != nullptr) {
+        if (route != nullptr && SubmixRoute::isLockFreePipeEnabled()) {
+            if (std::shared_ptr<SubmixRing> ring = route->getRing(); ring != nullptr) {
+                LOG(DEBUG) << __func__ << ": shutting down the ring";
+                ring->shutdown(true);
+            }
+            route->closeStream(mIsInput);
+        } else if (route != nullptr) {
             sp<MonoPipe> sink = route->getSink();
             if (sink == nullptr) {
                 ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
@@ -132,6 +150,7 @@ void StreamRemoteSubmix::shutdown() {
         LOG(DEBUG) << __func__ << ": pipe destroyed";
         SubmixRoute::removeRoute(mDeviceAddress);
     }
+    mRing.reset();
     mCurrentRoute.reset();
 }
 
@@ -140,8 +159,14 @@ void StreamRemoteSubmix::shutdown() {
     *latencyMs = getDelayInUsForFrameCount(getStreamPipeSizeInFrames()) / 1000;
     LOG(VERBOSE) << __func__ << ": Latency " << *latencyMs << "ms";
     mCurrentRoute->exitStandby(mIsInput);
-    ::android::status_t status = mIsInput ? inRead(buffer, frameCount, actualFrameCount)
-                                          : outWrite(buffer, frameCount, actualFrameCount);
+    ::android::status_t status;
+    if (SubmixRoute::isLockFreePipeEnabled()) {
+        status = mIsInput ? inReadRing(buffer, frameCount, actualFrameCount)
+                          : outWriteRing(buffer, frameCount, actualFrameCount);
+    } else {
+        status = mIsInput ? inRead(buffer, frameCount, actualFrameCount)
+                          : outWrite(buffer, frameCount, actualFrameCount);
+    }
     if ((status != ::android::OK && mIsInput) ||
         ((status != ::android::OK && status != ::android::DEAD_OBJECT) && !mIsInput)) {
         return status;
@@ -165,11 +190,20 @@ void StreamRemoteSubmix::shutdown() {
 }
 
 ::android::status_t StreamRemoteSubmix::refinePosition(StreamDescriptor::Position* position) {
-    sp<MonoPipeReader> source = mCurrentRoute->getSource();
-    if (source == nullptr) {
-        return ::android::NO_INIT;
+    ssize_t framesInPipe;
+    if (SubmixRoute::isLockFreePipeEnabled()) {
+        SubmixRing* ring = getRing();
+        if (ring == nullptr) {
+            return ::android::NO_INIT;
+        }
+        framesInPipe = ring->availableToRead();
+    } else {
+        sp<MonoPipeReader> source = mCurrentRoute->getSource();
+        if (source == nullptr) {
+            return ::android::NO_INIT;
+        }
+        framesInPipe = source->availableToRead();
     }
-    const ssize_t framesInPipe = source->availableToRead();
     if (framesInPipe <= 0) {
         // No need to update the position frames
         return ::android::OK;
@@ -188,6 +222,15 @@ long StreamRemoteSubmix::getDelayInUsForFrameCount(size_t frameCount) {
 
 // Calculate the maximum size of the pipe buffer in frames for the specified stream.
 size_t StreamRemoteSubmix::getStreamPipeSizeInFrames() {
+    if (SubmixRoute::isLockFreePipeEnabled()) {
+        // Avoids taking the route lock for the pipe config on each transfer.
+        SubmixRing* ring = getRing();
+        if (ring == nullptr) {
+            return 0;
+        }
+        const size_t maxFrameSize = std::max(mStreamConfig.frameSize, ring->frameSize());
+        return (ring->maxFrames() * ring->frameSize()) / maxFrameSize;
+    }
     auto pipeConfig = mCurrentRoute->getPipeConfig();
     const size_t maxFrameSize = std::max(mStreamConfig.frameSize, pipeConfig.frameSize);
     return (pipeConfig.frameCount * pipeConfig.frameSize) / maxFrameSize;
@@ -335,6 +378,110 @@ size_t StreamRemoteSubmix::getStreamPipeSizeInFrames() {
     return ::android::OK;
 }
 
+SubmixRing* StreamRemoteSubmix::getRing() {
+    if (const int generation = mCurrentRoute->getPipeGeneration();
+        generation != mRingGeneration) {
+        mRing = mCurrentRoute->getRing();
+        mRingGeneration = generation;
+    }
+    return mRing.get();
+}
+
+::android::status_t StreamRemoteSubmix::outWriteRing(void* buffer, size_t frameCount,
+                                                     size_t* actualFrameCount) {
+    SubmixRing* ring = getRing();
+    if (ring == nullptr) {
+        LOG(FATAL) << __func__ << ": without a pipe!";
+        return ::android::UNKNOWN_ERROR;
+    }
+    if (ring->isShutdown()) {
+        if (++mWriteShutdownCount < kMaxErrorLogs) {
+            LOG(DEBUG) << __func__ << ": pipe shutdown, ignoring the write. (limited logging)";
+        }
+        *actualFrameCount = frameCount;
+        return ::android::DEAD_OBJECT;  // Induce wait in `transfer`.
+    }
+    mWriteShutdownCount = 0;
+
+    LOG(VERBOSE) << __func__ << ": " << mDeviceAddress.toString() << ", " << frameCount
+                 << " frames";
+
+    const uint8_t* data = static_cast<const uint8_t*>(buffer);
+    size_t writtenFrames = 0;
+    if (mCurrentRoute->shouldBlockWrite()) {
+        // Wait for the reader to make space, at most for the duration of the whole pipe.
+        const int64_t timeoutNs =
+                getDelayInUsForFrameCount(ring->maxFrames()) * NANOS_PER_MICROSECOND;
+        while (true) {
+            writtenFrames += ring->write(data + writtenFrames * mStreamConfig.frameSize,
+                                         frameCount - writtenFrames);
+            if (writtenFrames == frameCount ||
+                !ring->waitForWrite(frameCount - writtenFrames, timeoutNs)) {
+                break;
+            }
+        }
+    } else {
+        // Flush the oldest frames from the pipe to make space to write the most recent data.
+        const size_t availableToWrite = ring->availableToWrite();
+        if (availableToWrite < frameCount) {
+            LOG(DEBUG) << __func__ << ": flushing " << frameCount - availableToWrite
+                       << " frames from the pipe to avoid blocking";
+            ring->discard(frameCount - availableToWrite);
+        }
+        writtenFrames = ring->write(data, frameCount);
+    }
+    if (frameCount > writtenFrames) {
+        LOG(WARNING) << __func__ << ": wrote " << writtenFrames << " vs. requested " << frameCount;
+    }
+    *actualFrameCount = writtenFrames;
+    return ::android::OK;
+}
+
+::android::status_t StreamRemoteSubmix::inReadRing(void* buffer, size_t frameCount,
+                                                   size_t* actualFrameCount) {
+    // in any case, it is emulated that data for the entire buffer was available
+    memset(buffer, 0, mStreamConfig.frameSize * frameCount);
+    *actualFrameCount = frameCount;
+
+    SubmixRing* ring = getRing();
+    if (ring == nullptr) {
+        if (++mReadErrorCount < kMaxErrorLogs) {
+            LOG(ERROR) << __func__
+                       << ": no audio pipe yet we're trying to read! (not all errors will be "
+                          "logged)";
+        }
+        return ::android::OK;
+    }
+    mReadErrorCount = 0;
+
+    LOG(VERBOSE) << __func__ << ": " << mDeviceAddress.toString() << ", " << frameCount
+                 << " frames";
+    // Instead of polling, wait for the writer to signal that the missing frames are available,
+    // with the same deadline as 'inRead'.
+    uint8_t* buff = static_cast<uint8_t*>(buffer);
+    const long durationUs =
+            std::max(0L, getDelayInUsForFrameCount(frameCount) - kReadAttemptSleepUs);
+    const int64_t deadlineTimeNs = ::android::uptimeNanos() + durationUs * NANOS_PER_MICROSECOND;
+    size_t actuallyRead = ring->read(buff, frameCount);
+    while (actuallyRead < frameCount) {
+        const int64_t timeoutNs = deadlineTimeNs - ::android::uptimeNanos();
+        const bool ready = timeoutNs > 0 && ring->waitForRead(frameCount - actuallyRead, timeoutNs);
+        actuallyRead += ring->read(buff + actuallyRead * mStreamConfig.frameSize,
+                                   frameCount - actuallyRead);
+        if (!ready) break;
+    }
+    if (actuallyRead < frameCount) {
+        if (++mReadFailureCount < kMaxReadFailureAttempts) {
+            LOG(WARNING) << __func__ << ": read " << actuallyRead << " vs. requested " << frameCount
+                         << " (not all errors will be logged)";
+        }
+    } else {
+        mReadFailureCount = 0;
+    }
+    mCurrentRoute->updateReadCounterFrames(*actualFrameCount);
+    return ::android::OK;
+}
+
 StreamInRemoteSubmix::StreamInRemoteSubmix(StreamContext&& context,
                                            const SinkMetadata& sinkMetadata,
                                            const std::vector<MicrophoneInfo>& microphones)
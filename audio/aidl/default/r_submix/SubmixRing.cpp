@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+
+#include "SubmixRing.h"
+
+namespace aidl::android::hardware::audio::core::r_submix {
+
+SubmixRing::SubmixRing(size_t frameCount, size_t frameSize)
+    : mFrameSize(frameSize),
+      mMask(std::bit_ceil(std::max<size_t>(frameCount, 1)) - 1),
+      mBuffer((mMask + 1) * frameSize) {}
+
+size_t SubmixRing::availableToRead() const {
+    const uint64_t readIndex = mReadIndex.load(std::memory_order_acquire);
+    return mWriteIndex.load(std::memory_order_acquire) - readIndex;
+}
+
+size_t SubmixRing::availableToWrite() const {
+    return maxFrames() - availableToRead();
+}
+
+void SubmixRing::copyIn(uint64_t index, const uint8_t* buffer, size_t frameCount) {
+    const size_t offset = index & mMask;
+    const size_t firstFrames = std::min(frameCount, maxFrames() - offset);
+    memcpy(&mBuffer[offset * mFrameSize], buffer, firstFrames * mFrameSize);
+    memcpy(&mBuffer[0], buffer + firstFrames * mFrameSize, (frameCount - firstFrames) * mFrameSize);
+}
+
+void SubmixRing::copyOut(uint64_t index, uint8_t* buffer, size_t frameCount) const {
+    const size_t offset = index & mMask;
+    const size_t firstFrames = std::min(frameCount, maxFrames() - offset);
+    memcpy(buffer, &mBuffer[offset * mFrameSize], firstFrames * mFrameSize);
+    memcpy(buffer + firstFrames * mFrameSize, &mBuffer[0], (frameCount - firstFrames) * mFrameSize);
+}
+
+size_t SubmixRing::write(const void* buffer, size_t frameCount) {
+    const uint64_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+    if (maxFrames() - (writeIndex - mWriterCachedReadIndex) < frameCount) {
+        mWriterCachedReadIndex = mReadIndex.load(std::memory_order_acquire);
+    }
+    frameCount = std::min(frameCount, maxFrames() - size_t(writeIndex - mWriterCachedReadIndex));
+    if (frameCount == 0) return 0;
+    copyIn(writeIndex, static_cast<const uint8_t*>(buffer), frameCount);
+    mWriteIndex.store(writeIndex + frameCount, std::memory_order_release);
+    wakeIfReached(mReadCv, mReadWatermark, writeIndex + frameCount - mWriterCachedReadIndex);
+    return frameCount;
+}
+
+size_t SubmixRing::discard(size_t frameCount) {
+    const uint64_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+    uint64_t readIndex = mReadIndex.load(std::memory_order_acquire);
+    size_t discarded;
+    do {
+        discarded = std::min<size_t>(frameCount, writeIndex - readIndex);
+    } while (discarded != 0 &&
+             !mReadIndex.compare_exchange_weak(readIndex, readIndex + discarded,
+                                               std::memory_order_acq_rel));
+    mWriterCachedReadIndex = readIndex + discarded;
+    return discarded;
+}
+
+size_t SubmixRing::read(void* buffer, size_t frameCount) {
+    uint64_t readIndex = mReadIndex.load(std::memory_order_acquire);
+    while (true) {
+        // The read index may be ahead of the cached write index after a discard.
+        if (mReaderCachedWriteIndex < readIndex + frameCount) {
+            mReaderCachedWriteIndex = mWriteIndex.load(std::memory_order_acquire);
+        }
+        const size_t readFrames =
+                std::min<size_t>(frameCount, mReaderCachedWriteIndex - readIndex);
+        if (readFrames == 0) return 0;
+        copyOut(readIndex, static_cast<uint8_t*>(buffer), readFrames);
+        // Fails when the writer has discarded frames meanwhile, the copy may then contain data
+        // written after the discard.
+        if (mReadIndex.compare_exchange_strong(readIndex, readIndex + readFrames,
+                                               std::memory_order_acq_rel)) {
+            wakeIfReached(mWriteCv, mWriteWatermark,
+                          maxFrames() - size_t(mReaderCachedWriteIndex - readIndex - readFrames));
+            return readFrames;
+        }
+    }
+}
+
+bool SubmixRing::waitForWrite(size_t frameCount, int64_t timeoutNs) {
+    return wait(mWriteCv, mWriteWatermark, frameCount, timeoutNs, &SubmixRing::availableToWrite);
+}
+
+bool SubmixRing::waitForRead(size_t frameCount, int64_t timeoutNs) {
+    return wait(mReadCv, mReadWatermark, frameCount, timeoutNs, &SubmixRing::availableToRead);
+}
+
+bool SubmixRing::wait(std::condition_variable& cv, std::atomic<size_t>& watermark,
+                      size_t frameCount, int64_t timeoutNs,
+                      size_t (SubmixRing::*available)() const) {
+    frameCount = std::clamp<size_t>(frameCount, 1, maxFrames());
+    std::unique_lock lock(mWaitLock);
+    // Pairs with the fence in 'wakeIfReached': either the other side sees the watermark, or the
+    // predicate sees the other side's update.
+    watermark.store(frameCount, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const bool ready = cv.wait_for(lock, std::chrono::nanoseconds(timeoutNs), [&] {
+        return isShutdown() || (this->*available)() >= frameCount;
+    });
+    watermark.store(0, std::memory_order_relaxed);
+    return ready && !isShutdown();
+}
+
+void SubmixRing::wakeIfReached(std::condition_variable& cv, const std::atomic<size_t>& watermark,
+                               size_t available) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const size_t frameCount = watermark.load(std::memory_order_relaxed);
+    // 'available' may be based on a stale index of the waiting side and be too high, the waiter
+    // rechecks it.
+    if (frameCount != 0 && available >= frameCount) {
+        std::lock_guard lock(mWaitLock);
+        cv.notify_one();
+    }
+}
+
+void SubmixRing::shutdown(bool newState) {
+    mShutdown.store(newState, std::memory_order_release);
+    if (newState) {
+        std::lock_guard lock(mWaitLock);
+        mReadCv.notify_all();
+        mWriteCv.notify_all();
+    }
+}
+
+}  // namespace aidl::android::hardware::audio::core::r_submix
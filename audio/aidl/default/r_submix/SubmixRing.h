@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace aidl::android::hardware::audio::core::r_submix {
+
+// Single producer, single consumer ring of audio frames, the lock free alternative to MonoPipe.
+//
+// The writer and the reader each own an index on a separate cache line and keep a cached copy of
+// the other index, so a transfer only touches the shared cache line when the cached value does not
+// allow it. Waiting is only done on the slow path: a waiting side publishes a watermark, the number
+// of frames it needs, and the other side only takes the wakeup lock once the watermark is reached.
+class SubmixRing {
+  public:
+    // 'frameCount' is rounded up to the nearest power of 2.
+    SubmixRing(size_t frameCount, size_t frameSize);
+
+    size_t maxFrames() const { return mMask + 1; }
+    size_t frameSize() const { return mFrameSize; }
+    size_t availableToRead() const;
+    size_t availableToWrite() const;
+    int64_t framesRead() const { return mReadIndex.load(std::memory_order_relaxed); }
+    int64_t framesWritten() const { return mWriteIndex.load(std::memory_order_relaxed); }
+
+    // Writer side. Neither call blocks, they return the number of frames written or dropped.
+    size_t write(const void* buffer, size_t frameCount);
+    // Drops the oldest frames to make space for the most recent ones. Safe to use concurrently
+    // with read(), which then retries.
+    size_t discard(size_t frameCount);
+    // Waits until 'frameCount' frames can be written. Returns false on timeout or shutdown.
+    bool waitForWrite(size_t frameCount, int64_t timeoutNs);
+
+    // Reader side. Does not block, returns the number of frames read.
+    size_t read(void* buffer, size_t frameCount);
+    // Waits until 'frameCount' frames can be read. Returns false on timeout or shutdown.
+    bool waitForRead(size_t frameCount, int64_t timeoutNs);
+
+    // Wakes up the waiting sides, which keep failing to wait until the shutdown is cleared.
+    void shutdown(bool newState);
+    bool isShutdown() const { return mShutdown.load(std::memory_order_acquire); }
+
+  private:
+    static constexpr size_t kCacheLineSize = 64;
+
+    void copyIn(uint64_t index, const uint8_t* buffer, size_t frameCount);
+    void copyOut(uint64_t index, uint8_t* buffer, size_t frameCount) const;
+    bool wait(std::condition_variable& cv, std::atomic<size_t>& watermark, size_t frameCount,
+              int64_t timeoutNs, size_t (SubmixRing::*available)() const);
+    void wakeIfReached(std::condition_variable& cv, const std::atomic<size_t>& watermark,
+                       size_t available);
+
+    const size_t mFrameSize;
+    const size_t mMask;
+    std::vector<uint8_t> mBuffer;
+
+    // Written by the writer only.
+    alignas(kCacheLineSize) std::atomic<uint64_t> mWriteIndex = 0;
+    uint64_t mWriterCachedReadIndex = 0;
+    // Written by the reader, and by the writer when it discards frames.
+    alignas(kCacheLineSize) std::atomic<uint64_t> mReadIndex = 0;
+    uint64_t mReaderCachedWriteIndex = 0;
+
+    // Slow path, only used while a side is waiting.
+    alignas(kCacheLineSize) std::atomic<size_t> mReadWatermark = 0;
+    std::atomic<size_t> mWriteWatermark = 0;
+    std::atomic<bool> mShutdown = false;
+    std::mutex mWaitLock;
+    std::condition_variable mReadCv;
+    std::condition_variable mWriteCv;
+};
+
+}  // namespace aidl::android::hardware::audio::core::r_submix
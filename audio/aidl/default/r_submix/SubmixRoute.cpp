@@ -18,6 +18,7 @@
 
 #define LOG_TAG "AHAL_SubmixRoute"
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 #include <media/AidlConversionCppNdk.h>
 
 #include <Utils.h>
@@ -26,6 +27,7 @@
 
 using aidl::android::hardware::audio::common::getChannelCount;
 using aidl::android::media::audio::common::AudioDeviceAddress;
+using android::base::GetBoolProperty;
 
 namespace aidl::android::hardware::audio::core::r_submix {
 
@@ -84,6 +86,13 @@ std::string SubmixRoute::dumpRoutes() {
     return result;
 }
 
+// static
+bool SubmixRoute::isLockFreePipeEnabled() {
+    static const bool kLockFreePipe =
+            GetBoolProperty("ro.vendor.audio.r_submix.lock_free_pipe", false);
+    return kLockFreePipe;
+}
+
 // Verify a submix input or output stream can be opened.
 bool SubmixRoute::isStreamConfigValid(bool isInput, const AudioConfig& streamConfig) {
     // If the stream is already open, don't open it again.
@@ -125,7 +134,6 @@ bool SubmixRoute::isStreamConfigCompatible(const AudioConfig& streamConfig) {
 }
 
 bool SubmixRoute::hasAtleastOneStreamOpen() {
-    std::lock_guard guard(mLock);
     return (mStreamInOpen || mStreamOutOpen);
 }
 
@@ -136,14 +144,11 @@ bool SubmixRoute::hasAtleastOneStreamOpen() {
 // - the input was never activated to avoid discarding first frames in the pipe in case capture
 //   start was delayed
 bool SubmixRoute::shouldBlockWrite() {
-    std::lock_guard guard(mLock);
     return mStreamInOpen && (!mStreamInStandby || mReadCounterFrames == 0);
 }
 
 long SubmixRoute::updateReadCounterFrames(size_t frameCount) {
-    std::lock_guard guard(mLock);
-    mReadCounterFrames += frameCount;
-    return mReadCounterFrames;
+    return mReadCounterFrames += frameCount;
 }
 
 void SubmixRoute::openStream(bool isInput) {
@@ -160,6 +165,9 @@ void SubmixRoute::openStream(bool isInput) {
         if (mSink != nullptr) {
             mSink->shutdown(false);
         }
+        if (mRing != nullptr) {
+            mRing->shutdown(false);
+        }
     } else {
         mStreamOutOpen = true;
     }
@@ -173,6 +181,9 @@ void SubmixRoute::closeStream(bool isInput) {
             if (mSink != nullptr) {
                 mSink->shutdown(true);
             }
+            if (mRing != nullptr) {
+                mRing->shutdown(true);
+            }
         }
     } else {
         mStreamOutOpen = false;
@@ -196,6 +207,16 @@ void SubmixRoute::closeStream(bool isInput) {
     LOG(VERBOSE) << __func__ << ": creating pipe, rate : " << streamConfig.sampleRate
                  << ", pipe size : " << pipeSizeInFrames;
 
+    if (isLockFreePipeEnabled()) {
+        auto ring = std::make_shared<SubmixRing>(pipeSizeInFrames, streamConfig.frameSize);
+        std::lock_guard guard(mLock);
+        mPipeConfig = streamConfig;
+        mPipeConfig.frameCount = ring->maxFrames();
+        mRing = std::move(ring);
+        mPipeGeneration++;
+        return ::android::OK;
+    }
+
     // Create a MonoPipe with optional blocking set to true.
     sp<MonoPipe> sink = sp<MonoPipe>::make(pipeSizeInFrames, format, true /*writeCanBlock*/);
     if (sink == nullptr) {
@@ -231,6 +252,7 @@ void SubmixRoute::closeStream(bool isInput) {
         mPipeConfig.frameCount = sink->maxFrames();
         mSink = std::move(sink);
         mSource = std::move(source);
+        mPipeGeneration++;
     }
 
     return ::android::OK;
@@ -241,6 +263,8 @@ AudioConfig SubmixRoute::releasePipe() {
     std::lock_guard guard(mLock);
     mSink.clear();
     mSource.clear();
+    mRing.reset();
+    mPipeGeneration++;
     return mPipeConfig;
 }
 
@@ -260,6 +284,10 @@ void SubmixRoute::standby(bool isInput) {
 }
 
 void SubmixRoute::exitStandby(bool isInput) {
+    // Called on each transfer, only take the lock for a transition.
+    if (isInput ? !mStreamInStandby && !mStreamOutStandbyTransition : !mStreamOutStandby) {
+        return;
+    }
     std::lock_guard guard(mLock);
 
     if (isInput) {
@@ -278,6 +306,14 @@ void SubmixRoute::exitStandby(bool isInput) {
 
 std::string SubmixRoute::dump() NO_THREAD_SAFETY_ANALYSIS {
     const bool isLocked = mLock.try_lock();
+    std::string framesRead = "<null>", framesWritten = "<null>";
+    if (mSource && mSink) {
+        framesRead = std::to_string(mSource->framesRead());
+        framesWritten = std::to_string(mSink->framesWritten());
+    } else if (mRing) {
+        framesRead = std::to_string(mRing->framesRead());
+        framesWritten = std::to_string(mRing->framesWritten());
+    }
     std::string result = std::string(isLocked ? "" : "! ")
                                  .append("Input ")
                                  .append(mStreamInOpen ? "open" : "closed")
@@ -285,12 +321,12 @@ std::string SubmixRoute::dump() NO_THREAD_SAFETY_ANALYSIS {
                                  .append(", refcount: ")
                                  .append(std::to_string(mInputRefCount))
                                  .append(", framesRead: ")
-                                 .append(mSource ? std::to_string(mSource->framesRead()) : "<null>")
+                                 .append(framesRead)
                                  .append("; Output ")
                                  .append(mStreamOutOpen ? "open" : "closed")
                                  .append(mStreamOutStandby ? ", standby" : ", active")
                                  .append(", framesWritten: ")
-                                 .append(mSink ? std::to_string(mSink->framesWritten()) : "<null>");
+                                 .append(framesWritten);
     if (isLocked) mLock.unlock();
     return result;
 }
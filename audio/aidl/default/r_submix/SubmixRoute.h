@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
 #include <string>
 
@@ -29,6 +30,8 @@
 #include <aidl/android/media/audio/common/AudioDeviceAddress.h>
 #include <aidl/android/media/audio/common/AudioFormatDescription.h>
 
+#include "SubmixRing.h"
+
 using aidl::android::media::audio::common::AudioChannelLayout;
 using aidl::android::media::audio::common::AudioFormatDescription;
 using aidl::android::media::audio::common::AudioFormatType;
@@ -70,27 +73,15 @@ class SubmixRoute {
     static void removeRoute(
             const ::aidl::android::media::audio::common::AudioDeviceAddress& deviceAddress);
     static std::string dumpRoutes();
-
-    bool isStreamInOpen() {
-        std::lock_guard guard(mLock);
-        return mStreamInOpen;
-    }
-    bool getStreamInStandby() {
-        std::lock_guard guard(mLock);
-        return mStreamInStandby;
-    }
-    bool isStreamOutOpen() {
-        std::lock_guard guard(mLock);
-        return mStreamOutOpen;
-    }
-    bool getStreamOutStandby() {
-        std::lock_guard guard(mLock);
-        return mStreamOutStandby;
-    }
-    long getReadCounterFrames() {
-        std::lock_guard guard(mLock);
-        return mReadCounterFrames;
-    }
+    // Whether routes use a SubmixRing instead of a MonoPipe, enabled with the
+    // ro.vendor.audio.r_submix.lock_free_pipe system property.
+    static bool isLockFreePipeEnabled();
+
+    bool isStreamInOpen() { return mStreamInOpen; }
+    bool getStreamInStandby() { return mStreamInStandby; }
+    bool isStreamOutOpen() { return mStreamOutOpen; }
+    bool getStreamOutStandby() { return mStreamOutStandby; }
+    long getReadCounterFrames() { return mReadCounterFrames; }
     sp<MonoPipe> getSink() {
         std::lock_guard guard(mLock);
         return mSink;
@@ -99,6 +90,14 @@ class SubmixRoute {
         std::lock_guard guard(mLock);
         return mSource;
     }
+    // Only set when 'isLockFreePipeEnabled', instead of the sink and the source.
+    std::shared_ptr<SubmixRing> getRing() {
+        std::lock_guard guard(mLock);
+        return mRing;
+    }
+    // Changes each time the pipe is created or released, lets the streams keep the ring without
+    // taking the lock on each transfer.
+    int getPipeGeneration() const { return mPipeGeneration; }
     AudioConfig getPipeConfig() {
         std::lock_guard guard(mLock);
         return mPipeConfig;
@@ -140,14 +139,17 @@ class SubmixRoute {
 
     std::mutex mLock;
     AudioConfig mPipeConfig GUARDED_BY(mLock);
-    bool mStreamInOpen GUARDED_BY(mLock) = false;
     int mInputRefCount GUARDED_BY(mLock) = 0;
-    bool mStreamInStandby GUARDED_BY(mLock) = true;
-    bool mStreamOutStandbyTransition GUARDED_BY(mLock) = false;
-    bool mStreamOutOpen GUARDED_BY(mLock) = false;
-    bool mStreamOutStandby GUARDED_BY(mLock) = true;
+    // The stream state is only changed with mLock held, but is read without it by the streams on
+    // each transfer.
+    std::atomic<bool> mStreamInOpen = false;
+    std::atomic<bool> mStreamInStandby = true;
+    std::atomic<bool> mStreamOutStandbyTransition = false;
+    std::atomic<bool> mStreamOutOpen = false;
+    std::atomic<bool> mStreamOutStandby = true;
     // how many frames have been requested to be read since standby
-    long mReadCounterFrames GUARDED_BY(mLock) = 0;
+    std::atomic<long> mReadCounterFrames = 0;
+    std::atomic<int> mPipeGeneration = 0;
 
     // Pipe variables: they handle the ring buffer that "pipes" audio:
     //  - from the submix virtual audio output == what needs to be played
@@ -159,6 +161,7 @@ class SubmixRoute {
     // TV with Wifi Display capabilities), or to a wireless audio player.
     sp<MonoPipe> mSink GUARDED_BY(mLock);
     sp<MonoPipeReader> mSource GUARDED_BY(mLock);
+    std::shared_ptr<SubmixRing> mRing GUARDED_BY(mLock);
 };
 
 }  // namespace aidl::android::hardware::audio::core::r_submix
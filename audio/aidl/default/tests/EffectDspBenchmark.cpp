@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "effect-impl/EffectDsp.h"
+
+using aidl::android::hardware::audio::effect::BiquadCoefficients;
+using aidl::android::hardware::audio::effect::BiquadFilterBank;
+using aidl::android::hardware::audio::effect::CompressorBank;
+using aidl::android::hardware::audio::effect::CompressorConfig;
+
+namespace {
+
+constexpr float kSampleRate = 48000;
+// 10ms, the usual mixer period.
+constexpr size_t kFrameCount = 480;
+constexpr int kEqBandCount = 5;
+constexpr float kEqFrequencies[kEqBandCount] = {60, 230, 910, 3600, 14000};
+constexpr int kMbcBandCount = 3;
+constexpr float kMbcCutoffs[kMbcBandCount - 1] = {200, 2000};
+
+std::vector<float> makeInput(size_t channelCount) {
+    std::vector<float> buffer(channelCount * kFrameCount);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = 0.5f * std::sin(i * 0.01f);
+    }
+    return buffer;
+}
+
+// Items are frames, so items_per_second is frames per second for the channel count.
+void setFramesProcessed(benchmark::State& state) {
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+}
+
+// The EqualizerSw configuration: a low shelf, three peaking bands and a high shelf.
+void BM_Equalizer(benchmark::State& state) {
+    const size_t channelCount = state.range(0);
+    BiquadFilterBank eq;
+    eq.configure(channelCount, kEqBandCount);
+    for (size_t c = 0; c < channelCount; c++) {
+        eq.setCoefficients(c, 0, BiquadCoefficients::lowShelf(kSampleRate, kEqFrequencies[0], 3));
+        for (int band = 1; band < kEqBandCount - 1; band++) {
+            eq.setCoefficients(c, band,
+                               BiquadCoefficients::peaking(kSampleRate, kEqFrequencies[band], 1,
+                                                           -2));
+        }
+        eq.setCoefficients(c, kEqBandCount - 1,
+                           BiquadCoefficients::highShelf(kSampleRate, kEqFrequencies[4], 3));
+    }
+    const std::vector<float> in = makeInput(channelCount);
+    std::vector<float> out(in.size());
+
+    for (auto _ : state) {
+        eq.process(in.data(), out.data(), kFrameCount);
+        benchmark::DoNotOptimize(out.data());
+    }
+    setFramesProcessed(state);
+}
+BENCHMARK(BM_Equalizer)->Arg(1)->Arg(2)->Arg(6)->Arg(8);
+
+// The DynamicsProcessingSw pipeline with every stage in use: pre EQ, a three band compressor,
+// post EQ and limiter.
+void BM_DynamicsProcessing(benchmark::State& state) {
+    const size_t channelCount = state.range(0);
+    BiquadFilterBank preEq, postEq;
+    preEq.configure(channelCount, kEqBandCount);
+    postEq.configure(channelCount, kEqBandCount);
+    std::vector<BiquadFilterBank> crossovers(kMbcBandCount);
+    std::vector<CompressorBank> compressors(kMbcBandCount);
+    CompressorBank limiter;
+    limiter.configure(kSampleRate, channelCount);
+    for (int band = 0; band < kMbcBandCount; band++) {
+        crossovers[band].configure(channelCount, 2);
+        compressors[band].configure(kSampleRate, channelCount);
+    }
+    for (size_t c = 0; c < channelCount; c++) {
+        for (int band = 0; band < kEqBandCount; band++) {
+            preEq.setCoefficients(
+                    c, band, BiquadCoefficients::peaking(kSampleRate, kEqFrequencies[band], 1, 2));
+            postEq.setCoefficients(
+                    c, band, BiquadCoefficients::peaking(kSampleRate, kEqFrequencies[band], 1, -2));
+        }
+        for (int band = 0; band < kMbcBandCount; band++) {
+            if (band > 0) {
+                crossovers[band].setCoefficients(
+                        c, 0, BiquadCoefficients::highPass(kSampleRate, kMbcCutoffs[band - 1]));
+            }
+            if (band < kMbcBandCount - 1) {
+                crossovers[band].setCoefficients(
+                        c, 1, BiquadCoefficients::lowPass(kSampleRate, kMbcCutoffs[band]));
+            }
+            compressors[band].setConfig(
+                    c, {.enable = true, .ratio = 4, .thresholdDb = -20, .kneeWidthDb = 6});
+        }
+        limiter.setConfig(c, {.enable = true, .ratio = 10, .thresholdDb = -3});
+    }
+    const std::vector<float> in = makeInput(channelCount);
+    std::vector<float> buffer(in.size());
+    std::vector<float> band(in.size());
+    std::vector<float> sum(in.size());
+
+    for (auto _ : state) {
+        preEq.process(in.data(), buffer.data(), kFrameCount);
+        std::fill(sum.begin(), sum.end(), 0.0f);
+        for (int b = 0; b < kMbcBandCount; b++) {
+            crossovers[b].process(buffer.data(), band.data(), kFrameCount);
+            compressors[b].process(band.data(), kFrameCount);
+            for (size_t i = 0; i < sum.size(); i++) {
+                sum[i] += band[i];
+            }
+        }
+        postEq.process(sum.data(), buffer.data(), kFrameCount);
+        limiter.process(buffer.data(), kFrameCount);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    setFramesProcessed(state);
+}
+BENCHMARK(BM_DynamicsProcessing)->Arg(1)->Arg(2)->Arg(6)->Arg(8);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "effect-impl/EffectDsp.h"
+
+using aidl::android::hardware::audio::effect::BiquadCoefficients;
+using aidl::android::hardware::audio::effect::BiquadFilterBank;
+using aidl::android::hardware::audio::effect::CompressorBank;
+using aidl::android::hardware::audio::effect::CompressorConfig;
+
+namespace {
+
+constexpr float kSampleRate = 48000;
+
+std::vector<float> makeSine(size_t channelCount, size_t frameCount, float frequencyHz,
+                            float amplitude) {
+    std::vector<float> buffer(channelCount * frameCount);
+    for (size_t i = 0; i < frameCount; i++) {
+        for (size_t c = 0; c < channelCount; c++) {
+            buffer[i * channelCount + c] =
+                    amplitude * std::sin(2 * M_PI * frequencyHz * i / kSampleRate + c);
+        }
+    }
+    return buffer;
+}
+
+float getPeak(const std::vector<float>& buffer, size_t channelCount, size_t channel,
+              size_t firstFrame) {
+    float peak = 0;
+    for (size_t i = firstFrame * channelCount + channel; i < buffer.size(); i += channelCount) {
+        peak = std::max(peak, std::fabs(buffer[i]));
+    }
+    return peak;
+}
+
+float toDb(float amplitude) {
+    return 20 * std::log10(amplitude);
+}
+
+// Direct form I in double precision.
+std::vector<float> referenceBiquad(const std::vector<float>& in, size_t channelCount,
+                                   size_t channel, const BiquadCoefficients& c) {
+    std::vector<float> out;
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    for (size_t i = channel; i < in.size(); i += channelCount) {
+        const double x = in[i];
+        const double y = c.b0 * x + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2;
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        out.push_back(y);
+    }
+    return out;
+}
+
+}  // namespace
+
+class BiquadFilterBankTest : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(BiquadFilterBankTest, MatchesReference) {
+    const size_t channelCount = GetParam();
+    constexpr size_t kFrameCount = 1000;
+    BiquadFilterBank bank;
+    bank.configure(channelCount, 1);
+    std::vector<BiquadCoefficients> coefficients;
+    for (size_t c = 0; c < channelCount; c++) {
+        coefficients.push_back(
+                BiquadCoefficients::peaking(kSampleRate, 100.0f * (c + 1), 1.0f, 6.0f - c));
+        bank.setCoefficients(c, 0, coefficients.back());
+    }
+    std::vector<float> in = makeSine(channelCount, kFrameCount, 440, 0.5f);
+    std::vector<float> out(in.size());
+
+    // Split in two calls to cover the state carried across buffers.
+    bank.process(in.data(), out.data(), kFrameCount / 2);
+    bank.process(in.data() + in.size() / 2, out.data() + out.size() / 2, kFrameCount / 2);
+
+    for (size_t c = 0; c < channelCount; c++) {
+        std::vector<float> expected = referenceBiquad(in, channelCount, c, coefficients[c]);
+        for (size_t i = 0; i < kFrameCount; i++) {
+            ASSERT_NEAR(expected[i], out[i * channelCount + c], 1e-4)
+                    << "channel " << c << " frame " << i;
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(ChannelCounts, BiquadFilterBankTest, ::testing::Values(1, 2, 4, 6, 8));
+
+TEST(BiquadFilterBankTest, PassThroughByDefault) {
+    BiquadFilterBank bank;
+    bank.configure(3 /* channelCount */, 4 /* stageCount */);
+    std::vector<float> buffer = makeSine(3, 100, 1000, 0.5f);
+    const std::vector<float> in = buffer;
+
+    bank.process(buffer.data(), buffer.data(), 100);
+
+    EXPECT_EQ(in, buffer);
+}
+
+TEST(BiquadFilterBankTest, PeakingGainAtCenter) {
+    BiquadFilterBank bank;
+    bank.configure(1, 1);
+    bank.setCoefficients(0, 0, BiquadCoefficients::peaking(kSampleRate, 1000, 1.0f, 6.0f));
+    std::vector<float> buffer = makeSine(1, 4800, 1000, 0.1f);
+
+    bank.process(buffer.data(), buffer.data(), 4800);
+
+    EXPECT_NEAR(6.0f, toDb(getPeak(buffer, 1, 0, 2400) / 0.1f), 0.1f);
+}
+
+TEST(BiquadFilterBankTest, ShelvesAndPasses) {
+    struct Case {
+        BiquadCoefficients coefficients;
+        float frequencyHz;
+        float expectedDb;
+    };
+    const std::vector<Case> cases = {
+            {BiquadCoefficients::lowShelf(kSampleRate, 200, -12), 30, -12},
+            {BiquadCoefficients::highShelf(kSampleRate, 5000, 6), 18000, 6},
+            {BiquadCoefficients::lowPass(kSampleRate, 1000), 100, 0},
+            {BiquadCoefficients::highPass(kSampleRate, 1000), 100, -40},
+    };
+    for (const auto& c : cases) {
+        BiquadFilterBank bank;
+        bank.configure(1, 1);
+        bank.setCoefficients(0, 0, c.coefficients);
+        std::vector<float> buffer = makeSine(1, 9600, c.frequencyHz, 0.1f);
+
+        bank.process(buffer.data(), buffer.data(), 9600);
+
+        EXPECT_NEAR(c.expectedDb, toDb(getPeak(buffer, 1, 0, 4800) / 0.1f), 0.5f)
+                << c.frequencyHz;
+    }
+}
+
+TEST(CompressorBankTest, StaticCurve) {
+    CompressorConfig config{.enable = true, .ratio = 4, .thresholdDb = -20};
+
+    EXPECT_FLOAT_EQ(0, CompressorBank::computeGainDb(config, -30));
+    EXPECT_FLOAT_EQ(-15, CompressorBank::computeGainDb(config, 0));
+
+    config.kneeWidthDb = 10;
+    EXPECT_FLOAT_EQ(0, CompressorBank::computeGainDb(config, -25));
+    EXPECT_LT(CompressorBank::computeGainDb(config, -20), 0);
+    EXPECT_FLOAT_EQ(-7.5f, CompressorBank::computeGainDb(config, -10));
+
+    config.noiseGateThresholdDb = -60;
+    config.expanderRatio = 2;
+    EXPECT_FLOAT_EQ(-10, CompressorBank::computeGainDb(config, -70));
+}
+
+TEST(CompressorBankTest, CompressesLoudChannelOnly) {
+    CompressorBank bank;
+    bank.configure(kSampleRate, 2);
+    bank.setConfig(0, {.enable = true, .ratio = 10, .thresholdDb = -20, .postGainDb = 0});
+    std::vector<float> buffer = makeSine(2, 9600, 1000, 0.5f);
+    const std::vector<float> in = buffer;
+
+    bank.process(buffer.data(), 9600);
+
+    // About -20 + (-6 + 20) / 10 dB, the peak envelope ripples a little.
+    EXPECT_NEAR(-18.6f, toDb(getPeak(buffer, 2, 0, 4800)), 1.0f);
+    EXPECT_FLOAT_EQ(getPeak(in, 2, 1, 4800), getPeak(buffer, 2, 1, 4800));
+}
+
+TEST(CompressorBankTest, DisabledIsPassThrough) {
+    CompressorBank bank;
+    bank.configure(kSampleRate, 5);
+    bank.setConfig(1, {.enable = false, .ratio = 10, .thresholdDb = -40});
+    std::vector<float> buffer = makeSine(5, 1000, 1000, 0.5f);
+    const std::vector<float> in = buffer;
+
+    bank.process(buffer.data(), 1000);
+
+    EXPECT_EQ(in, buffer);
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <aidl/android/hardware/audio/effect/IEffect.h>
+#include <benchmark/benchmark.h>
+#include <fmq/AidlMessageQueue.h>
+
+#include "effect-impl/EffectMemTransaction.h"
+
+using aidl::android::hardware::audio::effect::IEffect;
+using aidl::android::hardware::audio::effect::processMemTransactions;
+using ::android::AidlMessageQueue;
+using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
+
+namespace {
+
+using DataMQ = AidlMessageQueue<float, SynchronizedReadWrite>;
+
+// 10ms at 48kHz, the usual mixer period.
+constexpr size_t kFrameCount = 480;
+// Not a multiple of the block size, so that the blocks wrap around the queues at varying offsets.
+constexpr size_t kQueueFrameCount = 2 * kFrameCount + 96;
+
+IEffect::Status applyGain(float* in, float* out, int samples) {
+    for (int i = 0; i < samples; i++) {
+        out[i] = 0.5f * in[i];
+    }
+    return {STATUS_OK, samples, samples};
+}
+
+// Bytes are the data read from the input queue and written to the output queue, time per
+// iteration is the latency of a block.
+void setBytesProcessed(benchmark::State& state, size_t channelCount) {
+    state.SetBytesProcessed(state.iterations() * 2 * kFrameCount * channelCount * sizeof(float));
+}
+
+// What EffectImpl::process() does by default: copy the block into a work buffer, process it in
+// place and copy it into the output queue.
+void BM_ProcessCopy(benchmark::State& state) {
+    const size_t channelCount = state.range(0);
+    const size_t samples = kFrameCount * channelCount;
+    DataMQ inputMQ(kQueueFrameCount * channelCount), outputMQ(kQueueFrameCount * channelCount);
+    const std::vector<float> in(samples, 0.25f);
+    std::vector<float> workBuffer(samples), out(samples);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        inputMQ.write(in.data(), samples);
+        state.ResumeTiming();
+
+        inputMQ.read(workBuffer.data(), samples);
+        const IEffect::Status status = applyGain(workBuffer.data(), workBuffer.data(), samples);
+        outputMQ.write(workBuffer.data(), status.fmqProduced);
+
+        state.PauseTiming();
+        outputMQ.read(out.data(), samples);
+        state.ResumeTiming();
+    }
+    setBytesProcessed(state, channelCount);
+}
+BENCHMARK(BM_ProcessCopy)->Arg(2)->Arg(8)->Arg(16);
+
+// The zero copy mode: process the block from the input queue straight into the output queue.
+void BM_ProcessMemTransactions(benchmark::State& state) {
+    const size_t channelCount = state.range(0);
+    const size_t samples = kFrameCount * channelCount;
+    DataMQ inputMQ(kQueueFrameCount * channelCount), outputMQ(kQueueFrameCount * channelCount);
+    const std::vector<float> in(samples, 0.25f);
+    std::vector<float> out(samples);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        inputMQ.write(in.data(), samples);
+        state.ResumeTiming();
+
+        auto status = processMemTransactions(inputMQ, outputMQ, channelCount, channelCount,
+                                             applyGain);
+        benchmark::DoNotOptimize(status);
+
+        state.PauseTiming();
+        outputMQ.read(out.data(), samples);
+        state.ResumeTiming();
+    }
+    setBytesProcessed(state, channelCount);
+}
+BENCHMARK(BM_ProcessMemTransactions)->Arg(2)->Arg(8)->Arg(16);
+
+}  // namespace
+
+BENCHMARK_MAIN();
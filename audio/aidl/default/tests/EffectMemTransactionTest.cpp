@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <functional>
+#include <vector>
+
+#include <aidl/android/hardware/audio/effect/IEffect.h>
+#include <fmq/AidlMessageQueue.h>
+#include <gtest/gtest.h>
+
+#include "effect-impl/EffectMemTransaction.h"
+
+using aidl::android::hardware::audio::effect::IEffect;
+using aidl::android::hardware::audio::effect::processMemTransactions;
+using ::android::AidlMessageQueue;
+using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
+
+namespace {
+
+using DataMQ = AidlMessageQueue<float, SynchronizedReadWrite>;
+
+constexpr size_t kChannelCount = 2;
+
+std::vector<float> makeRamp(size_t samples, float start) {
+    std::vector<float> buffer(samples);
+    for (size_t i = 0; i < samples; i++) {
+        buffer[i] = start + i;
+    }
+    return buffer;
+}
+
+// Doubles every sample, counting the calls.
+struct Doubler {
+    int calls = 0;
+    IEffect::Status operator()(float* in, float* out, int samples) {
+        calls++;
+        for (int i = 0; i < samples; i++) {
+            out[i] = 2 * in[i];
+        }
+        return {STATUS_OK, samples, samples};
+    }
+};
+
+}  // namespace
+
+TEST(EffectMemTransactionTest, ProcessesAcrossWrapAround) {
+    // 5 frames, after 4 frames went through both queues wrap around after the next frame.
+    DataMQ inputMQ(5 * kChannelCount), outputMQ(5 * kChannelCount);
+    std::vector<float> scratch(4 * kChannelCount);
+    ASSERT_TRUE(inputMQ.write(scratch.data(), scratch.size()));
+    ASSERT_TRUE(inputMQ.read(scratch.data(), scratch.size()));
+    ASSERT_TRUE(outputMQ.write(scratch.data(), scratch.size()));
+    ASSERT_TRUE(outputMQ.read(scratch.data(), scratch.size()));
+
+    const std::vector<float> in = makeRamp(4 * kChannelCount, 1);
+    ASSERT_TRUE(inputMQ.write(in.data(), in.size()));
+    Doubler doubler;
+    auto status = processMemTransactions(inputMQ, outputMQ, kChannelCount, kChannelCount,
+                                         std::ref(doubler));
+
+    ASSERT_TRUE(status.has_value());
+    EXPECT_EQ(STATUS_OK, status->status);
+    EXPECT_EQ(static_cast<int>(in.size()), status->fmqConsumed);
+    EXPECT_EQ(static_cast<int>(in.size()), status->fmqProduced);
+    EXPECT_EQ(2, doubler.calls);
+    EXPECT_EQ(0u, inputMQ.availableToRead());
+    std::vector<float> out(in.size());
+    ASSERT_TRUE(outputMQ.read(out.data(), out.size()));
+    for (size_t i = 0; i < in.size(); i++) {
+        EXPECT_EQ(2 * in[i], out[i]) << i;
+    }
+}
+
+TEST(EffectMemTransactionTest, WrapWithinFrameNeedsCopy) {
+    // After 7 samples went through, the stereo queue wraps around within the next frame.
+    DataMQ inputMQ(4 * kChannelCount), outputMQ(4 * kChannelCount);
+    std::vector<float> scratch(7);
+    ASSERT_TRUE(inputMQ.write(scratch.data(), scratch.size()));
+    ASSERT_TRUE(inputMQ.read(scratch.data(), scratch.size()));
+
+    const std::vector<float> in = makeRamp(2 * kChannelCount, 1);
+    ASSERT_TRUE(inputMQ.write(in.data(), in.size()));
+    Doubler doubler;
+    auto status = processMemTransactions(inputMQ, outputMQ, kChannelCount, kChannelCount,
+                                         std::ref(doubler));
+
+    EXPECT_FALSE(status.has_value());
+    EXPECT_EQ(0, doubler.calls);
+    EXPECT_EQ(in.size(), inputMQ.availableToRead());
+}
+
+TEST(EffectMemTransactionTest, CommitsOnlyWhatWasConsumed) {
+    DataMQ inputMQ(8 * kChannelCount), outputMQ(8 * kChannelCount);
+    const std::vector<float> in = makeRamp(4 * kChannelCount, 1);
+    ASSERT_TRUE(inputMQ.write(in.data(), in.size()));
+
+    auto status = processMemTransactions(
+            inputMQ, outputMQ, kChannelCount, kChannelCount,
+            [](float* in, float* out, int samples) -> IEffect::Status {
+                std::copy(in, in + samples / 2, out);
+                return {STATUS_OK, samples / 2, samples / 2};
+            });
+
+    ASSERT_TRUE(status.has_value());
+    EXPECT_EQ(static_cast<int>(in.size() / 2), status->fmqConsumed);
+    EXPECT_EQ(in.size() / 2, inputMQ.availableToRead());
+    EXPECT_EQ(in.size() / 2, outputMQ.availableToRead());
+}
+
+TEST(EffectMemTransactionTest, NothingToProcess) {
+    DataMQ inputMQ(4 * kChannelCount), outputMQ(4 * kChannelCount);
+    // Less than a frame.
+    const float sample = 1;
+    ASSERT_TRUE(inputMQ.write(&sample, 1));
+    Doubler doubler;
+
+    auto status = processMemTransactions(inputMQ, outputMQ, kChannelCount, kChannelCount,
+                                         std::ref(doubler));
+
+    ASSERT_TRUE(status.has_value());
+    EXPECT_EQ(0, status->fmqConsumed);
+    EXPECT_EQ(0, doubler.calls);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "effect-impl/EffectThread.h"
+#include "effect-impl/EffectWorkerPool.h"
+
+using aidl::android::hardware::audio::effect::EffectThread;
+using aidl::android::hardware::audio::effect::EffectWorkerPool;
+
+namespace {
+
+constexpr int kChainCount = 4;
+
+// A chain element: processing one buffer posts to the next effect of the chain, the last one
+// signals the benchmark. Mimics the framework running a chain effect by effect.
+class ChainEffect : public EffectThread {
+  public:
+    explicit ChainEffect(ChainEffect* next) : mNext(next) {}
+
+    void post() {
+        {
+            std::lock_guard lg(mMutex);
+            mPending++;
+        }
+        mCv.notify_all();
+    }
+
+    bool process(int64_t timeoutNs, std::vector<float>* /* workBuffer */) override {
+        {
+            std::unique_lock l(mMutex);
+            auto hasData = [this] { return mPending > 0; };
+            if (timeoutNs == 0) {
+                mCv.wait(l, hasData);
+            } else if (!mCv.wait_for(l, std::chrono::nanoseconds(timeoutNs), hasData)) {
+                return false;
+            }
+            mPending--;
+            mDone++;
+        }
+        mCv.notify_all();
+        if (mNext) {
+            mNext->post();
+        }
+        return true;
+    }
+
+    void waitForDone(int count) {
+        std::unique_lock l(mMutex);
+        mCv.wait(l, [&] { return mDone >= count; });
+    }
+
+  private:
+    ChainEffect* const mNext;
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    int mPending = 0;
+    int mDone = 0;
+};
+
+struct Chains {
+    std::vector<std::vector<std::unique_ptr<ChainEffect>>> chains;
+    std::vector<std::pair<ChainEffect*, EffectWorkerPool::Worker*>> attached;
+};
+
+// Creates kChainCount chains of 'length' effects, the effects are stored last to first.
+Chains createChains(int length) {
+    Chains result;
+    for (int c = 0; c < kChainCount; c++) {
+        auto& chain = result.chains.emplace_back();
+        ChainEffect* next = nullptr;
+        for (int i = 0; i < length; i++) {
+            next = chain.emplace_back(std::make_unique<ChainEffect>(next)).get();
+        }
+    }
+    return result;
+}
+
+// Runs one buffer through each chain, back to back.
+void runChains(benchmark::State& state, Chains& chains) {
+    int count = 0;
+    for (auto _ : state) {
+        count++;
+        for (auto& chain : chains.chains) {
+            chain.back()->post();
+            chain.front()->waitForDone(count);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kChainCount);
+}
+
+// One thread per effect, the current default.
+void BM_ChainLatencyOwnThread(benchmark::State& state) {
+    Chains chains = createChains(state.range(0));
+    for (auto& chain : chains.chains) {
+        for (auto& effect : chain) {
+            effect->createThread("ChainEffect");
+            effect->startThread();
+        }
+    }
+
+    runChains(state, chains);
+
+    for (auto& chain : chains.chains) {
+        for (auto& effect : chain) {
+            effect->stopThread();
+            // Unblock the thread waiting for data.
+            effect->post();
+            effect->destroyThread();
+        }
+    }
+    state.counters["threads"] = kChainCount * state.range(0);
+}
+BENCHMARK(BM_ChainLatencyOwnThread)->Arg(1)->Arg(3)->Arg(6);
+
+// One shared worker per chain.
+void BM_ChainLatencySharedWorker(benchmark::State& state) {
+    EffectWorkerPool pool;
+    Chains chains = createChains(state.range(0));
+    for (int c = 0; c < kChainCount; c++) {
+        // Attach in processing order.
+        for (auto it = chains.chains[c].rbegin(); it != chains.chains[c].rend(); it++) {
+            (*it)->startThread();
+            chains.attached.emplace_back(it->get(), pool.attach(it->get(), c, 0 /* priority */));
+        }
+    }
+
+    runChains(state, chains);
+
+    for (auto& [effect, worker] : chains.attached) {
+        effect->stopThread();
+        pool.detach(effect, worker);
+    }
+    state.counters["threads"] = pool.getWorkerCount();
+}
+BENCHMARK(BM_ChainLatencySharedWorker)->Arg(1)->Arg(3)->Arg(6);
+
+}  // namespace
+
+BENCHMARK_MAIN();
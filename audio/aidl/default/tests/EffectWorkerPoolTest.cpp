@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include <gtest/gtest.h>
+#define LOG_TAG "AHAL_EffectWorkerPoolTest"
+#include <android-base/logging.h>
+
+#include "effect-impl/EffectThread.h"
+#include "effect-impl/EffectWorkerPool.h"
+
+using aidl::android::hardware::audio::effect::EffectThread;
+using aidl::android::hardware::audio::effect::EffectWorkerPool;
+
+namespace {
+
+constexpr auto kTimeout = std::chrono::seconds(1);
+
+// An effect whose data is posted by the test, and which posts to the next effect of its chain
+// once processed.
+class FakeEffect : public EffectThread {
+  public:
+    explicit FakeEffect(FakeEffect* next = nullptr) : mNext(next) {}
+
+    void post() {
+        {
+            std::lock_guard lg(mMutex);
+            mPending++;
+        }
+        mCv.notify_all();
+    }
+
+    bool process(int64_t timeoutNs, std::vector<float>* workBuffer) override {
+        {
+            std::unique_lock l(mMutex);
+            auto hasData = [this] { return mPending > 0; };
+            if (timeoutNs == 0) {
+                mCv.wait(l, hasData);
+            } else if (!mCv.wait_for(l, std::chrono::nanoseconds(timeoutNs), hasData)) {
+                return false;
+            }
+            mPending--;
+            mProcessed++;
+            mUsedWorkBuffer = workBuffer != nullptr;
+        }
+        mCv.notify_all();
+        if (mNext) {
+            mNext->post();
+        }
+        return true;
+    }
+
+    bool waitForProcessed(int count) {
+        std::unique_lock l(mMutex);
+        return mCv.wait_for(l, kTimeout, [&] { return mProcessed >= count; });
+    }
+
+    int getProcessed() {
+        std::lock_guard lg(mMutex);
+        return mProcessed;
+    }
+
+    bool usedWorkBuffer() {
+        std::lock_guard lg(mMutex);
+        return mUsedWorkBuffer;
+    }
+
+  private:
+    FakeEffect* const mNext;
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    int mPending = 0;
+    int mProcessed = 0;
+    bool mUsedWorkBuffer = false;
+};
+
+constexpr int kPriority = 0;
+
+}  // namespace
+
+TEST(EffectWorkerPoolTest, SameChainSharesWorker) {
+    EffectWorkerPool pool;
+    FakeEffect effect1, effect2, effect3;
+
+    auto worker1 = pool.attach(&effect1, 1 /* chainId */, kPriority);
+    auto worker2 = pool.attach(&effect2, 1 /* chainId */, kPriority);
+    auto worker3 = pool.attach(&effect3, 2 /* chainId */, kPriority);
+
+    EXPECT_EQ(worker1, worker2);
+    EXPECT_NE(worker1, worker3);
+    EXPECT_EQ(2u, pool.getWorkerCount());
+    pool.detach(&effect1, worker1);
+    pool.detach(&effect2, worker2);
+    pool.detach(&effect3, worker3);
+}
+
+TEST(EffectWorkerPoolTest, DifferentPriorityNotShared) {
+    EffectWorkerPool pool;
+    FakeEffect effect1, effect2;
+
+    auto worker1 = pool.attach(&effect1, 1 /* chainId */, kPriority);
+    auto worker2 = pool.attach(&effect2, 1 /* chainId */, kPriority + 1);
+
+    EXPECT_NE(worker1, worker2);
+    pool.detach(&effect1, worker1);
+    pool.detach(&effect2, worker2);
+}
+
+TEST(EffectWorkerPoolTest, WorkerCountLimited) {
+    EffectWorkerPool pool;
+    std::vector<std::unique_ptr<FakeEffect>> effects;
+    std::vector<EffectWorkerPool::Worker*> workers;
+
+    for (size_t i = 0; i < EffectWorkerPool::kMaxWorkerCount * 2; i++) {
+        effects.push_back(std::make_unique<FakeEffect>());
+        workers.push_back(pool.attach(effects.back().get(), i /* chainId */, kPriority));
+    }
+
+    EXPECT_EQ(EffectWorkerPool::kMaxWorkerCount, pool.getWorkerCount());
+    // The extra chains are spread over the existing workers.
+    for (size_t i = 0; i < effects.size(); i++) {
+        EXPECT_EQ(2u, workers[i]->getEffectCount());
+    }
+    for (size_t i = 0; i < effects.size(); i++) {
+        pool.detach(effects[i].get(), workers[i]);
+    }
+}
+
+TEST(EffectWorkerPoolTest, WorkerCountLimitedPerPriority) {
+    EffectWorkerPool pool;
+    std::vector<std::unique_ptr<FakeEffect>> effects;
+    std::vector<EffectWorkerPool::Worker*> workers;
+
+    // Fills the pool with the workers of one priority, then attaches chains of another one.
+    for (size_t i = 0; i < EffectWorkerPool::kMaxWorkerCount * 3; i++) {
+        const int priority = i < EffectWorkerPool::kMaxWorkerCount ? kPriority : kPriority + 1;
+        effects.push_back(std::make_unique<FakeEffect>());
+        workers.push_back(pool.attach(effects.back().get(), i /* chainId */, priority));
+    }
+
+    EXPECT_EQ(EffectWorkerPool::kMaxWorkerCount * 2, pool.getWorkerCount());
+    for (size_t i = 0; i < effects.size(); i++) {
+        EXPECT_EQ(i < EffectWorkerPool::kMaxWorkerCount ? 1u : 2u, workers[i]->getEffectCount());
+    }
+    for (size_t i = 0; i < effects.size(); i++) {
+        pool.detach(effects[i].get(), workers[i]);
+    }
+}
+
+TEST(EffectWorkerPoolTest, ProcessChain) {
+    EffectWorkerPool pool;
+    FakeEffect effect3;
+    FakeEffect effect2(&effect3);
+    FakeEffect effect1(&effect2);
+    effect1.startThread();
+    effect2.startThread();
+    effect3.startThread();
+    auto worker1 = pool.attach(&effect1, 1 /* chainId */, kPriority);
+    auto worker2 = pool.attach(&effect2, 1 /* chainId */, kPriority);
+    auto worker3 = pool.attach(&effect3, 1 /* chainId */, kPriority);
+
+    for (int i = 1; i <= 10; i++) {
+        effect1.post();
+        ASSERT_TRUE(effect3.waitForProcessed(i));
+    }
+
+    EXPECT_EQ(10, effect1.getProcessed());
+    EXPECT_EQ(10, effect2.getProcessed());
+    EXPECT_TRUE(effect3.usedWorkBuffer());
+    pool.detach(&effect1, worker1);
+    pool.detach(&effect2, worker2);
+    pool.detach(&effect3, worker3);
+}
+
+TEST(EffectWorkerPoolTest, StoppedEffectNotProcessed) {
+    EffectWorkerPool pool;
+    FakeEffect effect;
+    // Runs on the same worker, the worker goes past the slot of effect before processing the
+    // sentinel twice in a row.
+    FakeEffect sentinel;
+    sentinel.startThread();
+    auto worker = pool.attach(&effect, 1 /* chainId */, kPriority);
+    auto sentinelWorker = pool.attach(&sentinel, 1 /* chainId */, kPriority);
+    ASSERT_EQ(worker, sentinelWorker);
+    int sentinelCount = 0;
+    auto passSentinel = [&] {
+        for (int i = 0; i < 2; i++) {
+            sentinel.post();
+            ASSERT_TRUE(sentinel.waitForProcessed(++sentinelCount));
+        }
+    };
+
+    effect.post();
+    passSentinel();
+    EXPECT_EQ(0, effect.getProcessed());
+
+    effect.startThread();
+    worker->wake();
+    EXPECT_TRUE(effect.waitForProcessed(1));
+
+    effect.stopThread();
+    // A wait on effect started before the stop ends before the worker processes the sentinel.
+    passSentinel();
+    effect.post();
+    passSentinel();
+    EXPECT_EQ(1, effect.getProcessed());
+    pool.detach(&effect, worker);
+    pool.detach(&sentinel, sentinelWorker);
+}
+
+TEST(EffectWorkerPoolTest, DedicatedThreadWithoutChain) {
+    FakeEffect effect;
+    ASSERT_EQ(aidl::android::hardware::audio::effect::RetCode::SUCCESS,
+              effect.createThread("FakeEffect"));
+    EXPECT_FALSE(effect.isOnSharedWorker());
+    effect.startThread();
+
+    effect.post();
+    EXPECT_TRUE(effect.waitForProcessed(1));
+    EXPECT_FALSE(effect.usedWorkBuffer());
+
+    // Unblock the thread so that it sees the exit request.
+    effect.stopThread();
+    effect.post();
+    effect.destroyThread();
+}
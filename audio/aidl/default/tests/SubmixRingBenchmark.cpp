@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <media/nbaio/MonoPipe.h>
+#include <media/nbaio/MonoPipeReader.h>
+
+#include "r_submix/SubmixRing.h"
+
+using aidl::android::hardware::audio::core::r_submix::SubmixRing;
+using ::android::MonoPipe;
+using ::android::MonoPipeReader;
+using ::android::sp;
+
+namespace {
+
+constexpr int kSampleRate = 48000;
+constexpr int kChannelCount = 8;
+constexpr size_t kFrameSize = kChannelCount * sizeof(int16_t);
+// 2ms bursts.
+constexpr size_t kBurstFrames = kSampleRate / 500;
+constexpr auto kBurstDuration = std::chrono::milliseconds(2);
+// The default r_submix pipe size.
+constexpr size_t kPipeFrames = 4096;
+// What StreamRemoteSubmix::inRead sleeps for when the MonoPipe is empty.
+constexpr auto kReadAttemptSleep = std::chrono::milliseconds(5);
+
+using Clock = std::chrono::steady_clock;
+
+// The MonoPipe as used by SubmixRoute: the sink and the source are fetched under the route lock
+// for each transfer.
+class MonoPipeTransport {
+  public:
+    MonoPipeTransport() {
+        const ::android::NBAIO_Format format =
+                ::android::Format_from_SR_C(kSampleRate, kChannelCount, AUDIO_FORMAT_PCM_16_BIT);
+        const ::android::NBAIO_Format offers[1] = {format};
+        size_t numCounterOffers = 0;
+        mSink = sp<MonoPipe>::make(kPipeFrames, format, false /*writeCanBlock*/);
+        mSink->negotiate(offers, 1, nullptr, numCounterOffers);
+        mSource = sp<MonoPipeReader>::make(mSink.get());
+        numCounterOffers = 0;
+        mSource->negotiate(offers, 1, nullptr, numCounterOffers);
+    }
+    size_t write(const void* buffer, size_t frameCount) {
+        sp<MonoPipe> sink = getSink();
+        return std::max<ssize_t>(0, sink->write(buffer, frameCount));
+    }
+    size_t read(void* buffer, size_t frameCount) {
+        sp<MonoPipeReader> source = getSource();
+        return std::max<ssize_t>(0, source->read(buffer, frameCount));
+    }
+    void waitForRead(size_t) { std::this_thread::sleep_for(kReadAttemptSleep); }
+    void waitForWrite(size_t) { std::this_thread::yield(); }
+
+  private:
+    sp<MonoPipe> getSink() {
+        std::lock_guard guard(mLock);
+        return mSink;
+    }
+    sp<MonoPipeReader> getSource() {
+        std::lock_guard guard(mLock);
+        return mSource;
+    }
+
+    std::mutex mLock;
+    sp<MonoPipe> mSink;
+    sp<MonoPipeReader> mSource;
+};
+
+class RingTransport {
+  public:
+    size_t write(const void* buffer, size_t frameCount) {
+        return mRing.write(buffer, frameCount);
+    }
+    size_t read(void* buffer, size_t frameCount) { return mRing.read(buffer, frameCount); }
+    void waitForRead(size_t frameCount) { mRing.waitForRead(frameCount, kTimeoutNs); }
+    void waitForWrite(size_t frameCount) { mRing.waitForWrite(frameCount, kTimeoutNs); }
+
+  private:
+    static constexpr int64_t kTimeoutNs = 100'000'000;
+    SubmixRing mRing{kPipeFrames, kFrameSize};
+};
+
+template <typename Transport>
+void writeBurst(Transport& transport, const uint8_t* burst) {
+    size_t written = 0;
+    while (written < kBurstFrames) {
+        written += transport.write(burst + written * kFrameSize, kBurstFrames - written);
+        if (written < kBurstFrames) transport.waitForWrite(kBurstFrames - written);
+    }
+}
+
+template <typename Transport>
+void readBurst(Transport& transport, uint8_t* burst) {
+    size_t read = 0;
+    while (read < kBurstFrames) {
+        read += transport.read(burst + read * kFrameSize, kBurstFrames - read);
+        if (read < kBurstFrames) transport.waitForRead(kBurstFrames - read);
+    }
+}
+
+// Throughput with a writer thread writing bursts as fast as the reader consumes them.
+template <typename Transport>
+void BM_Throughput(benchmark::State& state) {
+    Transport transport;
+    std::atomic<bool> done = false;
+    std::thread writer([&] {
+        std::vector<uint8_t> burst(kBurstFrames * kFrameSize, 1);
+        while (!done) {
+            writeBurst(transport, burst.data());
+        }
+    });
+    std::vector<uint8_t> burst(kBurstFrames * kFrameSize);
+
+    for (auto _ : state) {
+        readBurst(transport, burst.data());
+    }
+    done = true;
+    // Unblocks the writer.
+    for (size_t i = 0; i < 2 * kPipeFrames / kBurstFrames; i++) {
+        transport.read(burst.data(), kBurstFrames);
+    }
+    writer.join();
+    state.SetItemsProcessed(state.iterations() * kBurstFrames);
+    state.SetBytesProcessed(state.iterations() * kBurstFrames * kFrameSize);
+}
+BENCHMARK(BM_Throughput<MonoPipeTransport>)->UseRealTime();
+BENCHMARK(BM_Throughput<RingTransport>)->UseRealTime();
+
+// Jitter with a writer thread writing a burst every 2ms, like a real time source: the delay
+// between a burst being written and read, reported as mean, 99th percentile and max.
+template <typename Transport>
+void BM_BurstLatency(benchmark::State& state) {
+    Transport transport;
+    std::atomic<bool> done = false;
+    std::thread writer([&] {
+        std::vector<uint8_t> burst(kBurstFrames * kFrameSize);
+        auto next = Clock::now();
+        while (!done) {
+            const int64_t nowNs = Clock::now().time_since_epoch().count();
+            memcpy(burst.data(), &nowNs, sizeof(nowNs));
+            writeBurst(transport, burst.data());
+            next += kBurstDuration;
+            std::this_thread::sleep_until(next);
+        }
+    });
+    std::vector<uint8_t> burst(kBurstFrames * kFrameSize);
+    std::vector<double> latenciesUs;
+
+    for (auto _ : state) {
+        readBurst(transport, burst.data());
+        int64_t writtenNs;
+        memcpy(&writtenNs, burst.data(), sizeof(writtenNs));
+        latenciesUs.push_back((Clock::now().time_since_epoch().count() - writtenNs) / 1000.0);
+    }
+    done = true;
+    writer.join();
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    double sum = 0;
+    for (double latencyUs : latenciesUs) sum += latencyUs;
+    state.counters["mean_us"] = sum / latenciesUs.size();
+    state.counters["p99_us"] = latenciesUs[latenciesUs.size() * 99 / 100];
+    state.counters["max_us"] = latenciesUs.back();
+}
+BENCHMARK(BM_BurstLatency<MonoPipeTransport>)->UseRealTime()->Iterations(1000);
+BENCHMARK(BM_BurstLatency<RingTransport>)->UseRealTime()->Iterations(1000);
+
+}  // namespace
+
+BENCHMARK_MAIN();
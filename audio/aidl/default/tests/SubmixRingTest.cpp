@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "r_submix/SubmixRing.h"
+
+using aidl::android::hardware::audio::core::r_submix::SubmixRing;
+
+namespace {
+
+constexpr int64_t kTimeoutNs = 5'000'000'000;
+
+std::vector<int32_t> makeFrames(size_t frameCount, int32_t start) {
+    std::vector<int32_t> frames(frameCount);
+    std::iota(frames.begin(), frames.end(), start);
+    return frames;
+}
+
+}  // namespace
+
+TEST(SubmixRingTest, RoundsUpToPowerOfTwo) {
+    SubmixRing ring(1000, sizeof(int32_t));
+    EXPECT_EQ(1024u, ring.maxFrames());
+    EXPECT_EQ(0u, ring.availableToRead());
+    EXPECT_EQ(1024u, ring.availableToWrite());
+}
+
+TEST(SubmixRingTest, WrapsAround) {
+    SubmixRing ring(8, sizeof(int32_t));
+    std::vector<int32_t> out(8);
+    // Moves both indices to the middle of the ring.
+    ASSERT_EQ(5u, ring.write(makeFrames(5, 0).data(), 5));
+    ASSERT_EQ(5u, ring.read(out.data(), 5));
+
+    const std::vector<int32_t> in = makeFrames(8, 100);
+    EXPECT_EQ(8u, ring.write(in.data(), 10));
+    EXPECT_EQ(0u, ring.write(in.data(), 1));
+    EXPECT_EQ(8u, ring.read(out.data(), 8));
+    EXPECT_EQ(in, out);
+    EXPECT_EQ(13, ring.framesRead());
+    EXPECT_EQ(13, ring.framesWritten());
+}
+
+TEST(SubmixRingTest, DiscardDropsOldest) {
+    SubmixRing ring(8, sizeof(int32_t));
+    ASSERT_EQ(8u, ring.write(makeFrames(8, 0).data(), 8));
+
+    EXPECT_EQ(3u, ring.discard(3));
+    EXPECT_EQ(3u, ring.write(makeFrames(3, 8).data(), 3));
+
+    std::vector<int32_t> out(8);
+    EXPECT_EQ(8u, ring.read(out.data(), 8));
+    EXPECT_EQ(makeFrames(8, 3), out);
+    EXPECT_EQ(0u, ring.discard(1));
+}
+
+TEST(SubmixRingTest, WaitForReadWakesAtWatermark) {
+    SubmixRing ring(1024, sizeof(int32_t));
+    std::thread writer([&] {
+        for (int i = 0; i < 4; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            ring.write(makeFrames(96, i * 96).data(), 96);
+        }
+    });
+
+    EXPECT_TRUE(ring.waitForRead(4 * 96, kTimeoutNs));
+    EXPECT_EQ(4u * 96, ring.availableToRead());
+    writer.join();
+}
+
+TEST(SubmixRingTest, WaitForWriteWakesWhenRead) {
+    SubmixRing ring(16, sizeof(int32_t));
+    ASSERT_EQ(16u, ring.write(makeFrames(16, 0).data(), 16));
+    std::thread reader([&] {
+        std::vector<int32_t> out(8);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ring.read(out.data(), 8);
+    });
+
+    EXPECT_TRUE(ring.waitForWrite(8, kTimeoutNs));
+    reader.join();
+}
+
+TEST(SubmixRingTest, WaitTimesOutAndShutdownWakes) {
+    SubmixRing ring(16, sizeof(int32_t));
+    EXPECT_FALSE(ring.waitForRead(1, 1'000'000));
+
+    std::thread closer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ring.shutdown(true);
+    });
+    EXPECT_FALSE(ring.waitForRead(1, kTimeoutNs));
+    closer.join();
+    EXPECT_TRUE(ring.isShutdown());
+    EXPECT_FALSE(ring.waitForRead(1, kTimeoutNs));
+
+    ring.shutdown(false);
+    ASSERT_EQ(1u, ring.write(makeFrames(1, 0).data(), 1));
+    EXPECT_TRUE(ring.waitForRead(1, kTimeoutNs));
+}
+
+TEST(SubmixRingTest, ConcurrentTransferKeepsOrder) {
+    constexpr int32_t kFrameCount = 1'000'000;
+    constexpr size_t kBurstFrames = 96;
+    SubmixRing ring(256, sizeof(int32_t));
+    std::thread writer([&] {
+        for (int32_t written = 0; written < kFrameCount;) {
+            const std::vector<int32_t> burst = makeFrames(kBurstFrames, written);
+            const size_t frames = std::min<size_t>(kBurstFrames, kFrameCount - written);
+            size_t burstWritten = 0;
+            while (burstWritten < frames) {
+                burstWritten += ring.write(burst.data() + burstWritten, frames - burstWritten);
+                if (burstWritten < frames) ring.waitForWrite(frames - burstWritten, kTimeoutNs);
+            }
+            written += frames;
+        }
+    });
+
+    std::vector<int32_t> burst(kBurstFrames);
+    int32_t expected = 0;
+    while (expected < kFrameCount) {
+        const size_t frames = ring.read(burst.data(), kBurstFrames);
+        for (size_t i = 0; i < frames; i++) {
+            ASSERT_EQ(expected++, burst[i]);
+        }
+        if (frames == 0) ring.waitForRead(1, kTimeoutNs);
+    }
+    writer.join();
+}
+
+TEST(SubmixRingTest, ConcurrentDiscardKeepsOrder) {
+    constexpr int32_t kFrameCount = 1'000'000;
+    constexpr size_t kBurstFrames = 96;
+    SubmixRing ring(256, sizeof(int32_t));
+    std::thread writer([&] {
+        for (int32_t written = 0; written < kFrameCount; written += kBurstFrames) {
+            const std::vector<int32_t> burst = makeFrames(kBurstFrames, written);
+            // Never blocks, like the output stream when the input is in standby.
+            if (ring.availableToWrite() < kBurstFrames) {
+                ring.discard(kBurstFrames - ring.availableToWrite());
+            }
+            ring.write(burst.data(), kBurstFrames);
+        }
+    });
+
+    // Frames may be dropped, but the frames read must be increasing.
+    std::vector<int32_t> burst(kBurstFrames);
+    int32_t last = -1;
+    while (last < kFrameCount - 1) {
+        const size_t frames = ring.read(burst.data(), kBurstFrames);
+        for (size_t i = 0; i < frames; i++) {
+            ASSERT_LT(last, burst[i]);
+            last = burst[i];
+        }
+        if (frames == 0) ring.waitForRead(1, 10'000'000);
+    }
+    writer.join();
+}
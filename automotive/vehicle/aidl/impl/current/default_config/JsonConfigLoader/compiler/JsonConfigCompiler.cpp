@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compiles a VHAL JSON config file into a config image, see ConfigImage.h.
+//
+// Usage: VehicleHalJsonConfigCompiler <input.json> <output.img>
+
+#include <ConfigImage.h>
+#include <JsonConfigLoader.h>
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+using ::android::hardware::automotive::vehicle::ConfigImage;
+using ::android::hardware::automotive::vehicle::JsonConfigLoader;
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " <input.json> <output.img>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream ifs(argv[1]);
+    if (!ifs) {
+        std::cerr << "failed to open " << argv[1] << std::endl;
+        return 1;
+    }
+    std::string jsonContent((std::istreambuf_iterator<char>(ifs)),
+                            std::istreambuf_iterator<char>());
+
+    JsonConfigLoader loader;
+    std::istringstream iss(jsonContent);
+    auto configsResult = loader.loadPropConfig(iss);
+    if (!configsResult.ok()) {
+        std::cerr << "failed to parse " << argv[1] << ": " << configsResult.error().message()
+                  << std::endl;
+        return 1;
+    }
+
+    auto imageResult = ConfigImage::serialize(configsResult.value(), jsonContent);
+    if (!imageResult.ok()) {
+        std::cerr << "failed to compile " << argv[1] << ": " << imageResult.error().message()
+                  << std::endl;
+        return 1;
+    }
+
+    std::ofstream ofs(argv[2], std::ios::binary | std::ios::trunc);
+    ofs.write(imageResult->data(), imageResult->size());
+    if (!ofs) {
+        std::cerr << "failed to write " << argv[2] << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_default_config_JsonConfigLoader_include_ConfigImage_H_
+#define android_hardware_automotive_vehicle_aidl_impl_default_config_JsonConfigLoader_include_ConfigImage_H_
+
+#include <ConfigDeclaration.h>
+
+#include <android-base/result.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+// A compact binary image of the config declarations parsed from one JSON config file.
+//
+// The images are generated at build time by VehicleHalJsonConfigCompiler and installed next to
+// the JSON files, so that the JSON parsing and the constant name lookups could be skipped during
+// start up. Each image records the hash of the JSON content it was compiled from and is rejected
+// if the JSON file has changed since.
+//
+// Layout, all integers are in native (little endian) byte order:
+//   header:      magic "VHALCFG\0", uint32 version, uint32 declaration count,
+//                uint64 JSON size, uint64 JSON hash
+//   declaration: parcelable config, parcelable initialValue,
+//                uint32 count, {int32 areaId, parcelable initialAreaValue} * count,
+//                uint32 count, {int32 areaId, uint32 n, float * n} * count
+//   parcelable:  uint32 size, marshaled AParcel bytes
+class ConfigImage final {
+  public:
+    static constexpr uint32_t VERSION = 1;
+    // The file extension of a config image. The image for "X.json" is "X.json.img".
+    inline static const std::string FILE_EXTENSION = ".img";
+
+    // Returns the hash of the JSON content recorded in the image.
+    static uint64_t hashJsonContent(std::string_view jsonContent);
+
+    // Serializes the config declarations parsed from jsonContent into an image.
+    static android::base::Result<std::string> serialize(
+            const std::unordered_map<int32_t, ConfigDeclaration>& configsByPropId,
+            std::string_view jsonContent);
+
+    // Parses an image. Returns error if the image is malformed or is not compiled from
+    // jsonContent.
+    static android::base::Result<std::unordered_map<int32_t, ConfigDeclaration>> parse(
+            const uint8_t* data, size_t size, std::string_view jsonContent);
+
+    // Maps the image file and parses it. Returns error if the image does not exist, is malformed
+    // or is not compiled from jsonContent.
+    static android::base::Result<std::unordered_map<int32_t, ConfigDeclaration>> load(
+            const std::string& imagePath, std::string_view jsonContent);
+};
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_default_config_JsonConfigLoader_include_ConfigImage_H_
@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ConfigImage.h>
+
+#include <android-base/unique_fd.h>
+#include <android/binder_parcel.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::RawPropValues;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropConfig;
+using ::android::base::Error;
+using ::android::base::ErrnoError;
+using ::android::base::Result;
+using ::android::base::unique_fd;
+
+constexpr char MAGIC[8] = {'V', 'H', 'A', 'L', 'C', 'F', 'G', '\0'};
+
+using ScopedAParcel = std::unique_ptr<AParcel, decltype(&AParcel_delete)>;
+
+template <class T>
+void appendPod(const T& value, std::string* out) {
+    out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+Result<void> appendParcelable(const T& parcelable, std::string* out) {
+    ScopedAParcel parcel(AParcel_create(), &AParcel_delete);
+    if (binder_status_t status = parcelable.writeToParcel(parcel.get()); status != STATUS_OK) {
+        return Error() << "failed to write parcelable, status: " << status;
+    }
+    int32_t size = AParcel_getDataSize(parcel.get());
+    appendPod(static_cast<uint32_t>(size), out);
+    size_t offset = out->size();
+    out->resize(offset + size);
+    if (binder_status_t status = AParcel_marshal(
+                parcel.get(), reinterpret_cast<uint8_t*>(out->data() + offset), 0, size);
+        status != STATUS_OK) {
+        return Error() << "failed to marshal parcelable, status: " << status;
+    }
+    return {};
+}
+
+// Reads the fields of an image in order, failing on any out-of-bounds access.
+class ImageReader final {
+  public:
+    ImageReader(const uint8_t* data, size_t size) : mData(data), mSize(size) {}
+
+    template <class T>
+    Result<T> readPod() {
+        T value;
+        if (mSize - mOffset < sizeof(T)) {
+            return Error() << "unexpected end of image at offset: " << mOffset;
+        }
+        std::memcpy(&value, mData + mOffset, sizeof(T));
+        mOffset += sizeof(T);
+        return value;
+    }
+
+    template <class T>
+    Result<T> readParcelable() {
+        auto sizeResult = readPod<uint32_t>();
+        if (!sizeResult.ok()) {
+            return sizeResult.error();
+        }
+        size_t size = *sizeResult;
+        if (mSize - mOffset < size) {
+            return Error() << "unexpected end of image at offset: " << mOffset;
+        }
+        ScopedAParcel parcel(AParcel_create(), &AParcel_delete);
+        if (binder_status_t status = AParcel_unmarshal(parcel.get(), mData + mOffset, size);
+            status != STATUS_OK) {
+            return Error() << "failed to unmarshal parcelable, status: " << status;
+        }
+        AParcel_setDataPosition(parcel.get(), 0);
+        T parcelable;
+        if (binder_status_t status = parcelable.readFromParcel(parcel.get());
+            status != STATUS_OK) {
+            return Error() << "failed to read parcelable, status: " << status;
+        }
+        mOffset += size;
+        return parcelable;
+    }
+
+    Result<std::vector<float>> readFloats(uint32_t count) {
+        if ((mSize - mOffset) / sizeof(float) < count) {
+            return Error() << "unexpected end of image at offset: " << mOffset;
+        }
+        std::vector<float> values(count);
+        std::memcpy(values.data(), mData + mOffset, count * sizeof(float));
+        mOffset += count * sizeof(float);
+        return values;
+    }
+
+    bool atEnd() const { return mOffset == mSize; }
+
+  private:
+    const uint8_t* mData;
+    const size_t mSize;
+    size_t mOffset = 0;
+};
+
+Result<ConfigDeclaration> readConfigDeclaration(ImageReader* reader) {
+    ConfigDeclaration configDeclaration;
+    auto configResult = reader->readParcelable<VehiclePropConfig>();
+    if (!configResult.ok()) {
+        return configResult.error();
+    }
+    configDeclaration.config = std::move(*configResult);
+    auto initialValueResult = reader->readParcelable<RawPropValues>();
+    if (!initialValueResult.ok()) {
+        return initialValueResult.error();
+    }
+    configDeclaration.initialValue = std::move(*initialValueResult);
+
+    auto areaValueCountResult = reader->readPod<uint32_t>();
+    if (!areaValueCountResult.ok()) {
+        return areaValueCountResult.error();
+    }
+    for (uint32_t i = 0; i < *areaValueCountResult; i++) {
+        auto areaIdResult = reader->readPod<int32_t>();
+        if (!areaIdResult.ok()) {
+            return areaIdResult.error();
+        }
+        auto valueResult = reader->readParcelable<RawPropValues>();
+        if (!valueResult.ok()) {
+            return valueResult.error();
+        }
+        configDeclaration.initialAreaValues[*areaIdResult] = std::move(*valueResult);
+    }
+
+    auto supportedValuesCountResult = reader->readPod<uint32_t>();
+    if (!supportedValuesCountResult.ok()) {
+        return supportedValuesCountResult.error();
+    }
+    for (uint32_t i = 0; i < *supportedValuesCountResult; i++) {
+        auto areaIdResult = reader->readPod<int32_t>();
+        if (!areaIdResult.ok()) {
+            return areaIdResult.error();
+        }
+        auto countResult = reader->readPod<uint32_t>();
+        if (!countResult.ok()) {
+            return countResult.error();
+        }
+        auto valuesResult = reader->readFloats(*countResult);
+        if (!valuesResult.ok()) {
+            return valuesResult.error();
+        }
+        configDeclaration.supportedValuesForAreaId[*areaIdResult] = std::move(*valuesResult);
+    }
+    return configDeclaration;
+}
+
+// Returns the keys of the map in ascending order so that the image is reproducible.
+template <class T>
+std::vector<int32_t> getSortedKeys(const std::unordered_map<int32_t, T>& map) {
+    std::vector<int32_t> keys;
+    keys.reserve(map.size());
+    for (const auto& [key, _] : map) {
+        keys.push_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+}  // namespace
+
+uint64_t ConfigImage::hashJsonContent(std::string_view jsonContent) {
+    // 64-bit FNV-1a.
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : jsonContent) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+Result<std::string> ConfigImage::serialize(
+        const std::unordered_map<int32_t, ConfigDeclaration>& configsByPropId,
+        std::string_view jsonContent) {
+    std::string out;
+    out.append(MAGIC, sizeof(MAGIC));
+    appendPod(VERSION, &out);
+    appendPod(static_cast<uint32_t>(configsByPropId.size()), &out);
+    appendPod(static_cast<uint64_t>(jsonContent.size()), &out);
+    appendPod(hashJsonContent(jsonContent), &out);
+
+    for (int32_t propId : getSortedKeys(configsByPropId)) {
+        const ConfigDeclaration& configDeclaration = configsByPropId.at(propId);
+        if (auto result = appendParcelable(configDeclaration.config, &out); !result.ok()) {
+            return Error() << "failed to serialize config for property: " << propId << ", "
+                           << result.error().message();
+        }
+        if (auto result = appendParcelable(configDeclaration.initialValue, &out); !result.ok()) {
+            return Error() << "failed to serialize initial value for property: " << propId
+                           << ", " << result.error().message();
+        }
+        appendPod(static_cast<uint32_t>(configDeclaration.initialAreaValues.size()), &out);
+        for (int32_t areaId : getSortedKeys(configDeclaration.initialAreaValues)) {
+            appendPod(areaId, &out);
+            if (auto result =
+                        appendParcelable(configDeclaration.initialAreaValues.at(areaId), &out);
+                !result.ok()) {
+                return Error() << "failed to serialize initial area value for property: "
+                               << propId << ", " << result.error().message();
+            }
+        }
+        appendPod(static_cast<uint32_t>(configDeclaration.supportedValuesForAreaId.size()), &out);
+        for (int32_t areaId : getSortedKeys(configDeclaration.supportedValuesForAreaId)) {
+            const auto& values = configDeclaration.supportedValuesForAreaId.at(areaId);
+            appendPod(areaId, &out);
+            appendPod(static_cast<uint32_t>(values.size()), &out);
+            out.append(reinterpret_cast<const char*>(values.data()),
+                       values.size() * sizeof(float));
+        }
+    }
+    return out;
+}
+
+Result<std::unordered_map<int32_t, ConfigDeclaration>> ConfigImage::parse(
+        const uint8_t* data, size_t size, std::string_view jsonContent) {
+    if (size < sizeof(MAGIC) || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+        return Error() << "not a VHAL config image";
+    }
+    ImageReader reader(data + sizeof(MAGIC), size - sizeof(MAGIC));
+    auto versionResult = reader.readPod<uint32_t>();
+    if (!versionResult.ok()) {
+        return versionResult.error();
+    }
+    if (*versionResult != VERSION) {
+        return Error() << "unsupported image version: " << *versionResult;
+    }
+    auto countResult = reader.readPod<uint32_t>();
+    auto jsonSizeResult = reader.readPod<uint64_t>();
+    auto jsonHashResult = reader.readPod<uint64_t>();
+    if (!countResult.ok() || !jsonSizeResult.ok() || !jsonHashResult.ok()) {
+        return Error() << "truncated image header";
+    }
+    if (*jsonSizeResult != jsonContent.size() || *jsonHashResult != hashJsonContent(jsonContent)) {
+        return Error() << "image is not compiled from the current JSON config";
+    }
+
+    std::unordered_map<int32_t, ConfigDeclaration> configsByPropId;
+    configsByPropId.reserve(*countResult);
+    for (uint32_t i = 0; i < *countResult; i++) {
+        auto result = readConfigDeclaration(&reader);
+        if (!result.ok()) {
+            return Error() << "failed to parse config declaration: " << i << ", "
+                           << result.error().message();
+        }
+        int32_t propId = result->config.prop;
+        configsByPropId[propId] = std::move(*result);
+    }
+    if (!reader.atEnd()) {
+        return Error() << "unexpected trailing data in image";
+    }
+    return configsByPropId;
+}
+
+Result<std::unordered_map<int32_t, ConfigDeclaration>> ConfigImage::load(
+        const std::string& imagePath, std::string_view jsonContent) {
+    unique_fd fd(TEMP_FAILURE_RETRY(open(imagePath.c_str(), O_RDONLY | O_CLOEXEC)));
+    if (!fd.ok()) {
+        return ErrnoError() << "failed to open " << imagePath;
+    }
+    struct stat st;
+    if (fstat(fd.get(), &st) != 0) {
+        return ErrnoError() << "failed to stat " << imagePath;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        return Error() << imagePath << " is empty";
+    }
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (address == MAP_FAILED) {
+        return ErrnoError() << "failed to map " << imagePath;
+    }
+    auto result = parse(static_cast<const uint8_t*>(address), size, jsonContent);
+    munmap(address, size);
+    return result;
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -14,10 +14,13 @@
  * limitations under the License.
  */
 
+#define LOG_TAG "JsonConfigLoader"
+
 #include <JsonConfigLoader.h>
 
 #include <AccessForVehicleProperty.h>
 #include <ChangeModeForVehicleProperty.h>
+#include <ConfigImage.h>
 #include <PropertyUtils.h>
 
 #ifdef ENABLE_VEHICLE_HAL_TEST_PROPERTIES
@@ -25,7 +28,11 @@
 #endif  // ENABLE_VEHICLE_HAL_TEST_PROPERTIES
 
 #include <android-base/strings.h>
+#include <utils/Log.h>
+
 #include <fstream>
+#include <iterator>
+#include <sstream>
 
 namespace android {
 namespace hardware {
@@ -839,8 +846,19 @@ JsonConfigLoader::loadPropConfig(const std::string& configPath) {
     if (!ifs) {
         return android::base::Error() << "couldn't open " << configPath << " for parsing.";
     }
+    std::string jsonContent((std::istreambuf_iterator<char>(ifs)),
+                            std::istreambuf_iterator<char>());
+
+    // Use the image compiled at build time if it is still up to date with the JSON file.
+    auto imageResult = ConfigImage::load(configPath + ConfigImage::FILE_EXTENSION, jsonContent);
+    if (imageResult.ok()) {
+        return imageResult;
+    }
+    ALOGD("not using config image for %s: %s, parsing JSON instead", configPath.c_str(),
+          imageResult.error().message().c_str());
 
-    return loadPropConfig(ifs);
+    std::istringstream iss(jsonContent);
+    return loadPropConfig(iss);
 }
 
 }  // namespace vehicle
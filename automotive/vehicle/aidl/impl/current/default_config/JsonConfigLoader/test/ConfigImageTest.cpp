@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ConfigImage.h>
+#include <JsonConfigLoader.h>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+using ::aidl::android::hardware::automotive::vehicle::RawPropValues;
+using ::aidl::android::hardware::automotive::vehicle::VehicleProperty;
+
+namespace {
+
+constexpr char TEST_JSON[] = R"(
+{
+    "properties": [
+        {
+            "property": "VehicleProperty::INFO_FUEL_CAPACITY",
+            "defaultValue": {
+                "floatValues": [
+                    15000.0
+                ]
+            }
+        },
+        {
+            "property": "VehicleProperty::HVAC_FAN_SPEED",
+            "defaultValue": {
+                "int32Values": [
+                    3
+                ]
+            },
+            "areas": [
+                {
+                    "areaId": 1,
+                    "minInt32Value": 1,
+                    "maxInt32Value": 7,
+                    "supportedValues": [1, 3, 5]
+                },
+                {
+                    "areaId": 4,
+                    "defaultValue": {
+                        "int32Values": [
+                            5
+                        ]
+                    },
+                    "minInt32Value": 1,
+                    "maxInt32Value": 7
+                }
+            ]
+        }
+    ]
+}
+)";
+
+void expectSameConfigs(const std::unordered_map<int32_t, ConfigDeclaration>& actual,
+                       const std::unordered_map<int32_t, ConfigDeclaration>& expected) {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (const auto& [propId, expectedDeclaration] : expected) {
+        auto it = actual.find(propId);
+        ASSERT_NE(it, actual.end()) << "missing property: " << propId;
+        EXPECT_EQ(it->second.config, expectedDeclaration.config);
+        EXPECT_EQ(it->second.initialValue, expectedDeclaration.initialValue);
+        EXPECT_EQ(it->second.initialAreaValues, expectedDeclaration.initialAreaValues);
+        EXPECT_EQ(it->second.supportedValuesForAreaId,
+                  expectedDeclaration.supportedValuesForAreaId);
+    }
+}
+
+}  // namespace
+
+class ConfigImageTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::istringstream iss(TEST_JSON);
+        auto result = mLoader.loadPropConfig(iss);
+        ASSERT_TRUE(result.ok()) << result.error().message();
+        mConfigs = std::move(result.value());
+    }
+
+    JsonConfigLoader mLoader;
+    std::unordered_map<int32_t, ConfigDeclaration> mConfigs;
+};
+
+TEST_F(ConfigImageTest, testSerializeParseRoundTrip) {
+    auto imageResult = ConfigImage::serialize(mConfigs, TEST_JSON);
+    ASSERT_TRUE(imageResult.ok()) << imageResult.error().message();
+
+    auto result = ConfigImage::parse(reinterpret_cast<const uint8_t*>(imageResult->data()),
+                                     imageResult->size(), TEST_JSON);
+
+    ASSERT_TRUE(result.ok()) << result.error().message();
+    expectSameConfigs(result.value(), mConfigs);
+    const auto& declaration = result.value().at(toInt(VehicleProperty::HVAC_FAN_SPEED));
+    EXPECT_EQ(declaration.initialAreaValues.at(4), RawPropValues{.int32Values = {5}});
+    EXPECT_EQ(declaration.supportedValuesForAreaId.at(1), std::vector<float>({1, 3, 5}));
+}
+
+TEST_F(ConfigImageTest, testSerializeIsDeterministic) {
+    auto imageResult1 = ConfigImage::serialize(mConfigs, TEST_JSON);
+    auto imageResult2 = ConfigImage::serialize(mConfigs, TEST_JSON);
+
+    ASSERT_TRUE(imageResult1.ok());
+    ASSERT_TRUE(imageResult2.ok());
+    EXPECT_EQ(imageResult1.value(), imageResult2.value());
+}
+
+TEST_F(ConfigImageTest, testParseStaleImage) {
+    auto imageResult = ConfigImage::serialize(mConfigs, TEST_JSON);
+    ASSERT_TRUE(imageResult.ok()) << imageResult.error().message();
+    std::string updatedJson = std::string(TEST_JSON) + " ";
+
+    auto result = ConfigImage::parse(reinterpret_cast<const uint8_t*>(imageResult->data()),
+                                     imageResult->size(), updatedJson);
+
+    EXPECT_FALSE(result.ok()) << "image compiled from a different JSON must be rejected";
+}
+
+TEST_F(ConfigImageTest, testParseTruncatedImage) {
+    auto imageResult = ConfigImage::serialize(mConfigs, TEST_JSON);
+    ASSERT_TRUE(imageResult.ok()) << imageResult.error().message();
+
+    for (size_t size = 0; size < imageResult->size(); size++) {
+        auto result = ConfigImage::parse(reinterpret_cast<const uint8_t*>(imageResult->data()),
+                                         size, TEST_JSON);
+
+        ASSERT_FALSE(result.ok()) << "image truncated to " << size << " bytes must be rejected";
+    }
+}
+
+TEST_F(ConfigImageTest, testLoadPropConfigPrefersImage) {
+    TemporaryDir tempDir;
+    std::string jsonPath = std::string(tempDir.path) + "/Test.json";
+    ASSERT_TRUE(base::WriteStringToFile(TEST_JSON, jsonPath));
+    // Compile the image from a JSON with a single property, so that we could tell whether the
+    // image is used.
+    std::unordered_map<int32_t, ConfigDeclaration> imageConfigs;
+    int32_t propId = toInt(VehicleProperty::INFO_FUEL_CAPACITY);
+    imageConfigs[propId] = mConfigs.at(propId);
+    auto imageResult = ConfigImage::serialize(imageConfigs, TEST_JSON);
+    ASSERT_TRUE(imageResult.ok()) << imageResult.error().message();
+    ASSERT_TRUE(base::WriteStringToFile(imageResult.value(),
+                                        jsonPath + ConfigImage::FILE_EXTENSION));
+
+    auto result = mLoader.loadPropConfig(jsonPath);
+
+    ASSERT_TRUE(result.ok()) << result.error().message();
+    expectSameConfigs(result.value(), imageConfigs);
+}
+
+TEST_F(ConfigImageTest, testLoadPropConfigFallbackToJsonForStaleImage) {
+    TemporaryDir tempDir;
+    std::string jsonPath = std::string(tempDir.path) + "/Test.json";
+    ASSERT_TRUE(base::WriteStringToFile(TEST_JSON, jsonPath));
+    auto imageResult = ConfigImage::serialize({}, "{}");
+    ASSERT_TRUE(imageResult.ok()) << imageResult.error().message();
+    ASSERT_TRUE(base::WriteStringToFile(imageResult.value(),
+                                        jsonPath + ConfigImage::FILE_EXTENSION));
+
+    auto result = mLoader.loadPropConfig(jsonPath);
+
+    ASSERT_TRUE(result.ok()) << result.error().message();
+    expectSameConfigs(result.value(), mConfigs);
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ConfigImage.h>
+#include <JsonConfigLoader.h>
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+#include <string>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+constexpr char kDefaultPropertiesConfigFile[] = "DefaultProperties.json";
+
+std::string getConfigPath() {
+    return android::base::GetExecutableDirectory() + "/" + kDefaultPropertiesConfigFile;
+}
+
+// The config loading cost on VHAL start up when only the JSON file is available, excluding reading
+// the file.
+void BM_LoadDefaultPropertiesFromJson(benchmark::State& state) {
+    std::string jsonContent;
+    if (!android::base::ReadFileToString(getConfigPath(), &jsonContent)) {
+        state.SkipWithError("failed to read DefaultProperties.json");
+        return;
+    }
+    JsonConfigLoader loader;
+    for (auto _ : state) {
+        std::istringstream iss(jsonContent);
+        auto result = loader.loadPropConfig(iss);
+        if (!result.ok()) {
+            state.SkipWithError(result.error().message().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_LoadDefaultPropertiesFromJson);
+
+// The config loading cost on VHAL start up when the compiled image is available. This includes
+// reading and hashing the JSON file to verify that the image is up to date.
+void BM_LoadDefaultPropertiesFromImage(benchmark::State& state) {
+    std::string configPath = getConfigPath();
+    std::string jsonContent;
+    if (!android::base::ReadFileToString(configPath, &jsonContent)) {
+        state.SkipWithError("failed to read DefaultProperties.json");
+        return;
+    }
+    if (!ConfigImage::load(configPath + ConfigImage::FILE_EXTENSION, jsonContent).ok()) {
+        state.SkipWithError("DefaultProperties.json.img is missing or out of date");
+        return;
+    }
+    JsonConfigLoader loader;
+    for (auto _ : state) {
+        auto result = loader.loadPropConfig(configPath);
+        if (!result.ok()) {
+            state.SkipWithError(result.error().message().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_LoadDefaultPropertiesFromImage);
+
+}  // namespace
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -14,12 +14,14 @@
  * limitations under the License.
  */
 
+#include <ConfigImage.h>
 #include <JsonConfigLoader.h>
 #include <VehicleUtils.h>
 #include <android-base/file.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <fstream>
+#include <sstream>
 #include <unordered_map>
 
 namespace android {
@@ -63,6 +65,30 @@ TEST(DefaultConfigTest, TestloadDefaultProperties) {
     ASSERT_TRUE(result.ok()) << result.error().message();
 }
 
+TEST(DefaultConfigTest, TestDefaultPropertiesImageUpToDate) {
+    std::string configPath = getTestFilePath(kDefaultPropertiesConfigFile);
+    std::string jsonContent;
+    ASSERT_TRUE(android::base::ReadFileToString(configPath, &jsonContent));
+    JsonConfigLoader loader;
+    std::istringstream iss(jsonContent);
+    auto jsonResult = loader.loadPropConfig(iss);
+    ASSERT_TRUE(jsonResult.ok()) << jsonResult.error().message();
+
+    auto imageResult = ConfigImage::load(configPath + ConfigImage::FILE_EXTENSION, jsonContent);
+
+    ASSERT_TRUE(imageResult.ok()) << imageResult.error().message();
+    ASSERT_EQ(imageResult->size(), jsonResult->size());
+    for (const auto& [propId, configDeclaration] : jsonResult.value()) {
+        auto it = imageResult->find(propId);
+        ASSERT_NE(it, imageResult->end()) << "missing property in image: " << propId;
+        EXPECT_EQ(it->second.config, configDeclaration.config);
+        EXPECT_EQ(it->second.initialValue, configDeclaration.initialValue);
+        EXPECT_EQ(it->second.initialAreaValues, configDeclaration.initialAreaValues);
+        EXPECT_EQ(it->second.supportedValuesForAreaId,
+                  configDeclaration.supportedValuesForAreaId);
+    }
+}
+
 #ifdef ENABLE_VEHICLE_HAL_TEST_PROPERTIES
 
 TEST(DefaultConfigTest, TestloadTestProperties) {
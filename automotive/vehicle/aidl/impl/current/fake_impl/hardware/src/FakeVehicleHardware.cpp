@@ -377,12 +377,13 @@ FakeVehicleHardware::FakeVehicleHardware(std::string defaultConfigDir,
                                          std::string overrideConfigDir, bool forceOverride,
                                          int32_t s2rS2dConfig)
     : mValuePool(std::make_unique<VehiclePropValuePool>()),
-      mServerSidePropStore(new VehiclePropertyStore(mValuePool)),
+      mServerSidePropStore(
+              new VehiclePropertyStore(mValuePool, VehiclePropertyStore::LockMode::SHARDED)),
       mDefaultConfigDir(defaultConfigDir),
       mOverrideConfigDir(overrideConfigDir),
       mFakeObd2Frame(new obd2frame::FakeObd2Frame(mServerSidePropStore)),
       mFakeUserHal(new FakeUserHal(mValuePool)),
-      mRecurrentTimer(new RecurrentTimer()),
+      mRecurrentTimer(new RecurrentTimer(RecurrentTimer::Backend::TIMER_WHEEL)),
       mGeneratorHub(new GeneratorHub(
               [this](const VehiclePropValue& value) { eventFromVehicleBus(value); })),
       mPendingGetValueRequests(this),
@@ -404,6 +405,7 @@ bool FakeVehicleHardware::UseOverrideConfigDir() {
 
 std::unordered_map<int32_t, ConfigDeclaration> FakeVehicleHardware::loadConfigDeclarations() {
     std::unordered_map<int32_t, ConfigDeclaration> configsByPropId;
+    int64_t startTime = elapsedRealtimeNano();
     bool defaultConfigLoaded = loadPropConfigsFromDir(mDefaultConfigDir, &configsByPropId);
     if (!defaultConfigLoaded) {
         // This cannot work without a valid default config.
@@ -413,6 +415,8 @@ std::unordered_map<int32_t, ConfigDeclaration> FakeVehicleHardware::loadConfigDe
     if (UseOverrideConfigDir()) {
         loadPropConfigsFromDir(mOverrideConfigDir, &configsByPropId);
     }
+    ALOGI("loaded %zu property configs in %" PRId64 " us", configsByPropId.size(),
+          (elapsedRealtimeNano() - startTime) / 1000);
     return configsByPropId;
 }
 
@@ -1940,6 +1944,7 @@ std::string FakeVehicleHardware::dumpSubscriptions() {
         result += StringPrintf("OnChange{property: %s, areaId: %d}\n",
                                PROP_ID_TO_CSTR(propIdAreaId.propId), propIdAreaId.areaId);
     }
+    result += "Recurrent timer drift: " + mRecurrentTimer->getDriftStats().toString() + "\n";
     return result;
 }
 
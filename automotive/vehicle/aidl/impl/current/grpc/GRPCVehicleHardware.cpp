@@ -38,6 +38,10 @@ using ::grpc::Status;
 namespace {
 
 constexpr size_t MAX_RETRY_COUNT = 5;
+// The delay before reconnecting a broken vehicle stream.
+constexpr auto VEHICLE_STREAM_RETRY_INTERVAL = std::chrono::milliseconds(100);
+// The timeout for a subscribe or unsubscribe status on the vehicle stream.
+constexpr auto VEHICLE_STREAM_STATUS_TIMEOUT = std::chrono::seconds(1);
 
 std::shared_ptr<ChannelCredentials> getChannelCredentials() {
     return InsecureChannelCredentials();
@@ -63,19 +67,38 @@ std::vector<AidlResultType> convertSupportedValueProtoResultToAidlResults(
     return aidlResults;
 }
 
+template <class AidlResultType>
+std::vector<AidlResultType> getFailedResults(const std::unordered_set<int64_t>& requestIds,
+                                             aidlvhal::StatusCode status) {
+    std::vector<AidlResultType> results;
+    for (int64_t requestId : requestIds) {
+        auto& result = results.emplace_back();
+        result.requestId = requestId;
+        result.status = status;
+    }
+    return results;
+}
+
 }  // namespace
 
 GRPCVehicleHardware::GRPCVehicleHardware(std::string service_addr)
+    : GRPCVehicleHardware(std::move(service_addr), /*useVehicleStream=*/true) {}
+
+GRPCVehicleHardware::GRPCVehicleHardware(std::string service_addr, bool useVehicleStream)
     : mServiceAddr(std::move(service_addr)),
       mGrpcChannel(CreateChannel(mServiceAddr, getChannelCredentials())),
       mGrpcStub(proto::VehicleServer::NewStub(mGrpcChannel)),
-      mValuePollingThread([this] { ValuePollingLoop(); }) {}
+      mUseVehicleStream(useVehicleStream) {
+    mStreamWriterThread = std::thread([this] { StreamWriterLoop(); });
+    mValuePollingThread = std::thread([this] { ValuePollingLoop(); });
+}
 
 // Only used for unit testing.
 GRPCVehicleHardware::GRPCVehicleHardware(std::unique_ptr<proto::VehicleServer::StubInterface> stub,
                                          bool startValuePollingLoop)
     : mServiceAddr(""), mGrpcChannel(nullptr), mGrpcStub(std::move(stub)) {
     if (startValuePollingLoop) {
+        mStreamWriterThread = std::thread([this] { StreamWriterLoop(); });
         mValuePollingThread = std::thread([this] { ValuePollingLoop(); });
     }
 }
@@ -84,11 +107,18 @@ GRPCVehicleHardware::~GRPCVehicleHardware() {
     {
         std::lock_guard lck(mShutdownMutex);
         mShuttingDownFlag.store(true);
+        if (mVehicleStreamContext != nullptr) {
+            mVehicleStreamContext->TryCancel();
+        }
     }
     mShutdownCV.notify_all();
     if (mValuePollingThread.joinable()) {
         mValuePollingThread.join();
     }
+    mStreamWriteQueue.deactivate();
+    if (mStreamWriterThread.joinable()) {
+        mStreamWriterThread.join();
+    }
 }
 
 std::vector<aidlvhal::VehiclePropConfig> GRPCVehicleHardware::getAllPropertyConfigs() const {
@@ -131,6 +161,19 @@ aidlvhal::StatusCode GRPCVehicleHardware::setValues(
         protoRequest.set_request_id(request.requestId);
         proto_msg_converter::aidlToProto(request.value, protoRequest.mutable_value());
     }
+    if (isVehicleStreamReady()) {
+        proto::VehicleStreamRequest streamRequest;
+        PendingStreamRequest pending;
+        pending.setValuesCallback = callback;
+        for (const auto& request : requests) {
+            pending.pendingRequestIds.insert(request.requestId);
+        }
+        streamRequest.mutable_set_values()->Swap(&protoRequests);
+        if (sendStreamRequest(&streamRequest, &pending)) {
+            return aidlvhal::StatusCode::OK;
+        }
+        streamRequest.mutable_set_values()->Swap(&protoRequests);
+    }
     // TODO(chenhaosjtuacm): Make it Async.
     auto grpc_status = mGrpcStub->SetValues(&context, protoRequests, &protoResults);
     if (!grpc_status.ok()) {
@@ -156,6 +199,9 @@ aidlvhal::StatusCode GRPCVehicleHardware::setValues(
 aidlvhal::StatusCode GRPCVehicleHardware::getValues(
         std::shared_ptr<const GetValuesCallback> callback,
         const std::vector<aidlvhal::GetValueRequest>& requests) const {
+    if (isVehicleStreamReady() && sendGetValuesOnStream(callback, requests, /*retryCount=*/0)) {
+        return aidlvhal::StatusCode::OK;
+    }
     std::vector<aidlvhal::GetValueResult> results;
     auto status = getValuesWithRetry(requests, &results, /*retryCount=*/0);
     if (status != aidlvhal::StatusCode::OK) {
@@ -322,6 +368,30 @@ aidlvhal::StatusCode GRPCVehicleHardware::subscribe(aidlvhal::SubscribeOptions o
     ClientContext context;
     proto::VehicleHalCallStatus protoStatus;
     proto_msg_converter::aidlToProto(options, request.mutable_options());
+    if (mUseVehicleStream.load()) {
+        // Recorded before sending, so that a vehicle stream started concurrently either resends
+        // this subscription or is already used to send it.
+        std::lock_guard lck(mStreamSubscriptionsMutex);
+        for (int32_t areaId : options.areaIds) {
+            auto& areaOptions = mStreamSubscriptions[{.propId = options.propId, .areaId = areaId}];
+            areaOptions = options;
+            areaOptions.areaIds = {areaId};
+        }
+    }
+    if (isVehicleStreamReady()) {
+        proto::VehicleStreamRequest streamRequest;
+        streamRequest.mutable_subscribe()->Swap(&request);
+        if (auto status = sendStatusRequestOnStream(&streamRequest); status.has_value()) {
+            if (*status != aidlvhal::StatusCode::OK) {
+                std::lock_guard lck(mStreamSubscriptionsMutex);
+                for (int32_t areaId : options.areaIds) {
+                    mStreamSubscriptions.erase({.propId = options.propId, .areaId = areaId});
+                }
+            }
+            return *status;
+        }
+        streamRequest.mutable_subscribe()->Swap(&request);
+    }
     auto grpc_status = mGrpcStub->Subscribe(&context, request, &protoStatus);
     if (!grpc_status.ok()) {
         if (grpc_status.error_code() == ::grpc::StatusCode::UNIMPLEMENTED) {
@@ -341,6 +411,18 @@ aidlvhal::StatusCode GRPCVehicleHardware::unsubscribe(int32_t propId, int32_t ar
     proto::VehicleHalCallStatus protoStatus;
     request.set_prop_id(propId);
     request.set_area_id(areaId);
+    {
+        std::lock_guard lck(mStreamSubscriptionsMutex);
+        mStreamSubscriptions.erase({.propId = propId, .areaId = areaId});
+    }
+    if (isVehicleStreamReady()) {
+        proto::VehicleStreamRequest streamRequest;
+        streamRequest.mutable_unsubscribe()->Swap(&request);
+        if (auto status = sendStatusRequestOnStream(&streamRequest); status.has_value()) {
+            return *status;
+        }
+        streamRequest.mutable_unsubscribe()->Swap(&request);
+    }
     auto grpc_status = mGrpcStub->Unsubscribe(&context, request, &protoStatus);
     if (!grpc_status.ok()) {
         if (grpc_status.error_code() == ::grpc::StatusCode::UNIMPLEMENTED) {
@@ -375,13 +457,363 @@ bool GRPCVehicleHardware::waitForConnected(std::chrono::milliseconds waitTime) {
             gpr_now(GPR_CLOCK_MONOTONIC), gpr_time_from_millis(waitTime.count(), GPR_TIMESPAN)));
 }
 
+bool GRPCVehicleHardware::isVehicleStreamReady() const {
+    return mVehicleStreamReady.load();
+}
+
 void GRPCVehicleHardware::ValuePollingLoop() {
     while (!mShuttingDownFlag.load()) {
+        if (mUseVehicleStream.load()) {
+            if (!runVehicleStream()) {
+                LOG(INFO) << __func__
+                          << ": GRPC vehicle stream is not supported by the server, use unary RPCs";
+                mUseVehicleStream.store(false);
+                continue;
+            }
+            // Do not busy-loop while the server is unreachable.
+            std::unique_lock lck(mShutdownMutex);
+            mShutdownCV.wait_for(lck, VEHICLE_STREAM_RETRY_INTERVAL,
+                                 [this] { return mShuttingDownFlag.load(); });
+            continue;
+        }
         pollValue();
         // try to reconnect
     }
 }
 
+bool GRPCVehicleHardware::runVehicleStream() {
+    ClientContext context;
+    {
+        std::lock_guard lck(mShutdownMutex);
+        if (mShuttingDownFlag.load()) {
+            return true;
+        }
+        mVehicleStreamContext = &context;
+    }
+
+    std::unique_ptr<VehicleStream> stream = mGrpcStub->StartVehicleStream(&context);
+    proto::VehicleStreamResponse response;
+    // The server sends an empty response first if it supports the vehicle stream.
+    bool started = stream->Read(&response);
+    if (started) {
+        LOG(INFO) << __func__ << ": GRPC Vehicle Stream Started";
+        {
+            std::lock_guard lck(mVehicleStreamWriteMutex);
+            mVehicleStream = stream.get();
+            mVehicleStreamReady.store(true);
+        }
+        // The server only sends the events subscribed on this stream.
+        std::vector<aidlvhal::SubscribeOptions> subscriptions;
+        {
+            std::lock_guard lck(mStreamSubscriptionsMutex);
+            for (const auto& [_, options] : mStreamSubscriptions) {
+                subscriptions.push_back(options);
+            }
+        }
+        std::vector<QueuedStreamRequest> subscribeRequests;
+        for (const auto& options : subscriptions) {
+            auto& queued = subscribeRequests.emplace_back();
+            proto_msg_converter::aidlToProto(options,
+                                             queued.request.mutable_subscribe()->mutable_options());
+        }
+        mStreamWriteQueue.push(std::move(subscribeRequests));
+
+        while (stream->Read(&response)) {
+            handleVehicleStreamResponse(response);
+        }
+
+        {
+            std::lock_guard lck(mVehicleStreamWriteMutex);
+            mVehicleStream = nullptr;
+            mVehicleStreamReady.store(false);
+        }
+        failPendingStreamRequests();
+    }
+
+    {
+        std::lock_guard lck(mShutdownMutex);
+        mVehicleStreamContext = nullptr;
+    }
+    auto grpc_status = stream->Finish();
+    if (!started && grpc_status.error_code() == ::grpc::StatusCode::UNIMPLEMENTED) {
+        return false;
+    }
+    LOG(ERROR) << __func__ << ": GRPC Vehicle Stream Failed: " << grpc_status.error_message();
+    return true;
+}
+
+void GRPCVehicleHardware::handleVehicleStreamResponse(
+        const proto::VehicleStreamResponse& response) {
+    int64_t streamRequestId = response.stream_request_id();
+    switch (response.response_case()) {
+        case proto::VehicleStreamResponse::kPropertyEvents:
+            onPropertyEvents(response.property_events());
+            return;
+        case proto::VehicleStreamResponse::kGetValueResults:
+            handleStreamGetValueResults(streamRequestId, response.get_value_results());
+            return;
+        case proto::VehicleStreamResponse::kSetValueResults:
+            handleStreamSetValueResults(streamRequestId, response.set_value_results());
+            return;
+        case proto::VehicleStreamResponse::kStatus: {
+            std::shared_ptr<std::promise<aidlvhal::StatusCode>> statusPromise;
+            {
+                std::lock_guard lck(mPendingStreamRequestsMutex);
+                auto it = mPendingStreamRequests.find(streamRequestId);
+                if (it == mPendingStreamRequests.end()) {
+                    return;
+                }
+                statusPromise = std::move(it->second.statusPromise);
+                mPendingStreamRequests.erase(it);
+            }
+            if (statusPromise) {
+                statusPromise->set_value(
+                        static_cast<aidlvhal::StatusCode>(response.status().status_code()));
+            }
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+void GRPCVehicleHardware::handleStreamGetValueResults(int64_t streamRequestId,
+                                                      const proto::GetValueResults& protoResults) {
+    std::shared_ptr<const GetValuesCallback> callback;
+    std::vector<aidlvhal::GetValueResult> results;
+    std::vector<aidlvhal::GetValueRequest> retryRequests;
+    size_t retryCount = 0;
+    {
+        std::lock_guard lck(mPendingStreamRequestsMutex);
+        auto it = mPendingStreamRequests.find(streamRequestId);
+        if (it == mPendingStreamRequests.end() || !it->second.getValuesCallback) {
+            LOG(ERROR) << __func__
+                       << ": getValue results with unknown stream request ID: " << streamRequestId
+                       << ", ignore";
+            return;
+        }
+        PendingStreamRequest& pending = it->second;
+        callback = pending.getValuesCallback;
+        retryCount = pending.retryCount;
+        for (const auto& protoResult : protoResults.results()) {
+            int64_t requestId = protoResult.request_id();
+            if (pending.pendingRequestIds.erase(requestId) == 0) {
+                LOG(ERROR) << __func__
+                           << ": Invalid getValue result with unknown request ID: " << requestId
+                           << ", ignore";
+                continue;
+            }
+            auto& result = results.emplace_back();
+            result.requestId = requestId;
+            result.status = static_cast<aidlvhal::StatusCode>(protoResult.status());
+            if (!protoResult.has_value()) {
+                continue;
+            }
+            aidlvhal::VehiclePropValue value;
+            proto_msg_converter::protoToAidl(protoResult.value(), &value);
+            // See getValuesWithRetry.
+            if (!setAndroidTimestamp(&value)) {
+                LOG(WARNING) << __func__ << ": getValue result for propId: " << value.prop
+                             << " areaId: " << value.areaId << " is outdated, retry";
+                results.pop_back();
+                retryRequests.push_back(pending.getRequests[requestId]);
+                continue;
+            }
+            result.prop = std::move(value);
+        }
+        if (pending.pendingRequestIds.empty()) {
+            mPendingStreamRequests.erase(it);
+        }
+    }
+
+    if (!retryRequests.empty()) {
+        if (retryCount + 1 == MAX_RETRY_COUNT) {
+            LOG(ERROR) << __func__ << ": failed to get the latest value after " << MAX_RETRY_COUNT
+                       << " retries";
+            for (const auto& request : retryRequests) {
+                results.push_back({
+                        .requestId = request.requestId,
+                        .status = aidlvhal::StatusCode::TRY_AGAIN,
+                });
+            }
+        } else {
+            // This runs on the reader thread, which must not block on a write.
+            QueuedStreamRequest queued;
+            queued.pending = makeGetValuesStreamRequest(callback, retryRequests, retryCount + 1,
+                                                        &queued.request);
+            mStreamWriteQueue.push(std::move(queued));
+        }
+    }
+    if (!results.empty()) {
+        (*callback)(std::move(results));
+    }
+}
+
+void GRPCVehicleHardware::handleStreamSetValueResults(int64_t streamRequestId,
+                                                      const proto::SetValueResults& protoResults) {
+    std::shared_ptr<const SetValuesCallback> callback;
+    std::vector<aidlvhal::SetValueResult> results;
+    {
+        std::lock_guard lck(mPendingStreamRequestsMutex);
+        auto it = mPendingStreamRequests.find(streamRequestId);
+        if (it == mPendingStreamRequests.end() || !it->second.setValuesCallback) {
+            LOG(ERROR) << __func__
+                       << ": setValue results with unknown stream request ID: " << streamRequestId
+                       << ", ignore";
+            return;
+        }
+        PendingStreamRequest& pending = it->second;
+        callback = pending.setValuesCallback;
+        for (const auto& protoResult : protoResults.results()) {
+            if (pending.pendingRequestIds.erase(protoResult.request_id()) == 0) {
+                continue;
+            }
+            results.push_back({
+                    .requestId = protoResult.request_id(),
+                    .status = static_cast<aidlvhal::StatusCode>(protoResult.status()),
+            });
+        }
+        if (pending.pendingRequestIds.empty()) {
+            mPendingStreamRequests.erase(it);
+        }
+    }
+    if (!results.empty()) {
+        (*callback)(std::move(results));
+    }
+}
+
+void GRPCVehicleHardware::failPendingStreamRequests() {
+    std::unordered_map<int64_t, PendingStreamRequest> pendingRequests;
+    {
+        std::lock_guard lck(mPendingStreamRequestsMutex);
+        pendingRequests.swap(mPendingStreamRequests);
+    }
+    for (const auto& [_, pending] : pendingRequests) {
+        failPendingStreamRequest(pending);
+    }
+}
+
+void GRPCVehicleHardware::failPendingStreamRequest(const PendingStreamRequest& pending) {
+    if (pending.getValuesCallback) {
+        (*pending.getValuesCallback)(getFailedResults<aidlvhal::GetValueResult>(
+                pending.pendingRequestIds, aidlvhal::StatusCode::TRY_AGAIN));
+    } else if (pending.setValuesCallback) {
+        (*pending.setValuesCallback)(getFailedResults<aidlvhal::SetValueResult>(
+                pending.pendingRequestIds, aidlvhal::StatusCode::TRY_AGAIN));
+    } else if (pending.statusPromise) {
+        pending.statusPromise->set_value(aidlvhal::StatusCode::TRY_AGAIN);
+    }
+}
+
+void GRPCVehicleHardware::StreamWriterLoop() {
+    while (mStreamWriteQueue.waitForItems()) {
+        for (auto& queued : mStreamWriteQueue.flush()) {
+            if (!sendStreamRequest(&queued.request, &queued.pending)) {
+                failPendingStreamRequest(queued.pending);
+            }
+        }
+    }
+    // Fail the requests which were never sent.
+    for (const auto& queued : mStreamWriteQueue.flush()) {
+        failPendingStreamRequest(queued.pending);
+    }
+}
+
+bool GRPCVehicleHardware::sendStreamRequest(proto::VehicleStreamRequest* request,
+                                            PendingStreamRequest* pending) const {
+    std::lock_guard lck(mVehicleStreamWriteMutex);
+    if (mVehicleStream == nullptr) {
+        return false;
+    }
+    int64_t streamRequestId = mNextStreamRequestId++;
+    request->set_stream_request_id(streamRequestId);
+    {
+        // Registered before writing, the response might arrive before Write returns.
+        std::lock_guard pendingLck(mPendingStreamRequestsMutex);
+        mPendingStreamRequests[streamRequestId] = std::move(*pending);
+    }
+    if (mVehicleStream->Write(*request)) {
+        return true;
+    }
+    LOG(ERROR) << __func__ << ": GRPC Vehicle Stream Write Failed";
+    std::lock_guard pendingLck(mPendingStreamRequestsMutex);
+    // Give the state back to the caller, no result will come for this request.
+    *pending = std::move(mPendingStreamRequests.extract(streamRequestId).mapped());
+    return false;
+}
+
+bool GRPCVehicleHardware::sendGetValuesOnStream(
+        std::shared_ptr<const GetValuesCallback> callback,
+        const std::vector<aidlvhal::GetValueRequest>& requests, size_t retryCount) const {
+    proto::VehicleStreamRequest streamRequest;
+    PendingStreamRequest pending =
+            makeGetValuesStreamRequest(std::move(callback), requests, retryCount, &streamRequest);
+    return sendStreamRequest(&streamRequest, &pending);
+}
+
+GRPCVehicleHardware::PendingStreamRequest GRPCVehicleHardware::makeGetValuesStreamRequest(
+        std::shared_ptr<const GetValuesCallback> callback,
+        const std::vector<aidlvhal::GetValueRequest>& requests, size_t retryCount,
+        proto::VehicleStreamRequest* streamRequest) {
+    PendingStreamRequest pending;
+    pending.getValuesCallback = std::move(callback);
+    pending.retryCount = retryCount;
+    auto* protoRequests = streamRequest->mutable_get_values();
+    for (const auto& request : requests) {
+        auto& protoRequest = *protoRequests->add_requests();
+        protoRequest.set_request_id(request.requestId);
+        proto_msg_converter::aidlToProto(request.prop, protoRequest.mutable_value());
+        pending.pendingRequestIds.insert(request.requestId);
+        pending.getRequests[request.requestId] = request;
+    }
+    return pending;
+}
+
+std::optional<aidlvhal::StatusCode> GRPCVehicleHardware::sendStatusRequestOnStream(
+        proto::VehicleStreamRequest* request) {
+    auto statusPromise = std::make_shared<std::promise<aidlvhal::StatusCode>>();
+    std::future<aidlvhal::StatusCode> statusFuture = statusPromise->get_future();
+    PendingStreamRequest pending;
+    pending.statusPromise = std::move(statusPromise);
+    if (!sendStreamRequest(request, &pending)) {
+        return std::nullopt;
+    }
+    if (statusFuture.wait_for(VEHICLE_STREAM_STATUS_TIMEOUT) != std::future_status::ready) {
+        LOG(ERROR) << __func__ << ": timeout waiting for the GRPC Vehicle Stream status";
+        std::lock_guard lck(mPendingStreamRequestsMutex);
+        mPendingStreamRequests.erase(request->stream_request_id());
+        return aidlvhal::StatusCode::TRY_AGAIN;
+    }
+    return statusFuture.get();
+}
+
+void GRPCVehicleHardware::onPropertyEvents(const proto::VehiclePropValues& protoValues) {
+    std::vector<aidlvhal::VehiclePropValue> values;
+    values.reserve(protoValues.values_size());
+    for (const auto& protoValue : protoValues.values()) {
+        aidlvhal::VehiclePropValue aidlValue = {};
+        proto_msg_converter::protoToAidl(protoValue, &aidlValue);
+
+        // VHAL proxy server uses a different timestamp then AAOS timestamp, so we have to
+        // reset the timestamp.
+        // TODO(b/350822044): Remove this once we use timestamp from proxy server.
+        if (!setAndroidTimestamp(&aidlValue)) {
+            LOG(WARNING) << __func__ << ": property event for propId: " << aidlValue.prop
+                         << " areaId: " << aidlValue.areaId << " is outdated, ignore";
+            continue;
+        }
+
+        values.push_back(std::move(aidlValue));
+    }
+    if (values.empty()) {
+        return;
+    }
+    std::shared_lock lck(mCallbackMutex);
+    if (mOnPropChange) {
+        (*mOnPropChange)(values);
+    }
+}
+
 void GRPCVehicleHardware::pollValue() {
     ClientContext context;
 
@@ -397,29 +829,7 @@ void GRPCVehicleHardware::pollValue() {
     LOG(INFO) << __func__ << ": GRPC Value Streaming Started";
     proto::VehiclePropValues protoValues;
     while (!mShuttingDownFlag.load() && value_stream->Read(&protoValues)) {
-        std::vector<aidlvhal::VehiclePropValue> values;
-        for (const auto protoValue : protoValues.values()) {
-            aidlvhal::VehiclePropValue aidlValue = {};
-            proto_msg_converter::protoToAidl(protoValue, &aidlValue);
-
-            // VHAL proxy server uses a different timestamp then AAOS timestamp, so we have to
-            // reset the timestamp.
-            // TODO(b/350822044): Remove this once we use timestamp from proxy server.
-            if (!setAndroidTimestamp(&aidlValue)) {
-                LOG(WARNING) << __func__ << ": property event for propId: " << aidlValue.prop
-                             << " areaId: " << aidlValue.areaId << " is outdated, ignore";
-                continue;
-            }
-
-            values.push_back(std::move(aidlValue));
-        }
-        if (values.empty()) {
-            continue;
-        }
-        std::shared_lock lck(mCallbackMutex);
-        if (mOnPropChange) {
-            (*mOnPropChange)(values);
-        }
+        onPropertyEvents(protoValues);
     }
 
     {
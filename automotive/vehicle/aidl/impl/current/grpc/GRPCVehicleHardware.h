@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <ConcurrentQueue.h>
 #include <IVehicleHardware.h>
 #include <VehicleHalTypes.h>
 #include <VehicleUtils.h>
@@ -30,11 +31,15 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace android::hardware::automotive::vehicle::virtualization {
@@ -45,6 +50,11 @@ class GRPCVehicleHardware : public IVehicleHardware {
   public:
     explicit GRPCVehicleHardware(std::string service_addr);
 
+    // If useVehicleStream is true, getValues, setValues, subscribe and unsubscribe are sent over
+    // one long-lived bidirectional stream and the server only pushes the subscribed property
+    // events. Falls back to the unary RPCs if the server does not support the vehicle stream.
+    GRPCVehicleHardware(std::string service_addr, bool useVehicleStream);
+
     ~GRPCVehicleHardware();
 
     // Get all the property configs.
@@ -98,6 +108,9 @@ class GRPCVehicleHardware : public IVehicleHardware {
 
     bool waitForConnected(std::chrono::milliseconds waitTime);
 
+    // Whether requests are currently sent over the vehicle stream.
+    bool isVehicleStreamReady() const;
+
   protected:
     std::shared_mutex mCallbackMutex;
     std::unique_ptr<const PropertyChangeCallback> mOnPropChange;
@@ -116,6 +129,57 @@ class GRPCVehicleHardware : public IVehicleHardware {
     std::condition_variable mShutdownCV;
     std::atomic<bool> mShuttingDownFlag{false};
 
+    // The state for one request sent over the vehicle stream, until all its results are received.
+    struct PendingStreamRequest {
+        // Only one of the callbacks or statusPromise is set, depending on the request type.
+        std::shared_ptr<const GetValuesCallback> getValuesCallback;
+        std::shared_ptr<const SetValuesCallback> setValuesCallback;
+        std::shared_ptr<std::promise<aidlvhal::StatusCode>> statusPromise;
+        // The get requests by request ID, kept to retry the outdated results.
+        std::unordered_map<int64_t, aidlvhal::GetValueRequest> getRequests;
+        // The request IDs of the get or set requests still waiting for results.
+        std::unordered_set<int64_t> pendingRequestIds;
+        size_t retryCount = 0;
+    };
+
+    using VehicleStream = ::grpc::ClientReaderWriterInterface<proto::VehicleStreamRequest,
+                                                              proto::VehicleStreamResponse>;
+
+    // Cleared if the server does not support the vehicle stream.
+    std::atomic<bool> mUseVehicleStream{false};
+    std::atomic<bool> mVehicleStreamReady{false};
+
+    // The context for the current vehicle stream, so the destructor can cancel it.
+    ::grpc::ClientContext* mVehicleStreamContext GUARDED_BY(mShutdownMutex) = nullptr;
+
+    // Serializes the writes to the vehicle stream. The stream is only set after the server
+    // confirms it supports the vehicle stream.
+    mutable std::mutex mVehicleStreamWriteMutex;
+    VehicleStream* mVehicleStream GUARDED_BY(mVehicleStreamWriteMutex) = nullptr;
+    mutable int64_t mNextStreamRequestId GUARDED_BY(mVehicleStreamWriteMutex) = 1;
+
+    // A request the vehicle stream reader thread wants to send. A write blocks when the server
+    // is blocked writing responses, which the reader thread must keep reading, so the reader
+    // thread hands its writes to the stream writer thread instead.
+    struct QueuedStreamRequest {
+        proto::VehicleStreamRequest request;
+        PendingStreamRequest pending;
+    };
+
+    // ConcurrentQueue is thread-safe.
+    ConcurrentQueue<QueuedStreamRequest> mStreamWriteQueue;
+    std::thread mStreamWriterThread;
+
+    mutable std::mutex mPendingStreamRequestsMutex;
+    mutable std::unordered_map<int64_t, PendingStreamRequest> mPendingStreamRequests
+            GUARDED_BY(mPendingStreamRequestsMutex);
+
+    // The subscribe options per [propId, areaId] which are resent when a new vehicle stream
+    // starts. Each value has one area ID.
+    std::mutex mStreamSubscriptionsMutex;
+    std::unordered_map<PropIdAreaId, aidlvhal::SubscribeOptions, PropIdAreaIdHash>
+            mStreamSubscriptions GUARDED_BY(mStreamSubscriptionsMutex);
+
     mutable std::mutex mLatestUpdateTimestampsMutex;
 
     // A map from [propId, areaId] to the latest timestamp this property is updated.
@@ -131,6 +195,41 @@ class GRPCVehicleHardware : public IVehicleHardware {
     void ValuePollingLoop();
     void pollValue();
 
+    // Runs one vehicle stream until it breaks. Returns false if the server does not support the
+    // vehicle stream.
+    bool runVehicleStream();
+    void handleVehicleStreamResponse(const proto::VehicleStreamResponse& response);
+    void handleStreamGetValueResults(int64_t streamRequestId,
+                                     const proto::GetValueResults& protoResults);
+    void handleStreamSetValueResults(int64_t streamRequestId,
+                                     const proto::SetValueResults& protoResults);
+    // Fails all the requests waiting for results on a broken vehicle stream.
+    void failPendingStreamRequests();
+    // Fails the request, e.g. if it could not be sent.
+    static void failPendingStreamRequest(const PendingStreamRequest& pending);
+    // Sends the requests queued by the vehicle stream reader thread.
+    void StreamWriterLoop();
+
+    // Sends the request over the vehicle stream and tracks it until all its results are received.
+    // Returns false if the vehicle stream is not available, in which case the caller should use
+    // the unary RPC. 'pending' is only moved from if the request is sent.
+    bool sendStreamRequest(proto::VehicleStreamRequest* request,
+                           PendingStreamRequest* pending) const;
+    bool sendGetValuesOnStream(std::shared_ptr<const GetValuesCallback> callback,
+                               const std::vector<aidlvhal::GetValueRequest>& requests,
+                               size_t retryCount) const;
+    // Fills 'streamRequest' with the get requests and returns the state to track them.
+    static PendingStreamRequest makeGetValuesStreamRequest(
+            std::shared_ptr<const GetValuesCallback> callback,
+            const std::vector<aidlvhal::GetValueRequest>& requests, size_t retryCount,
+            proto::VehicleStreamRequest* streamRequest);
+    // Sends a subscribe or unsubscribe request over the vehicle stream and waits for its status.
+    // Returns std::nullopt if the vehicle stream is not available.
+    std::optional<aidlvhal::StatusCode> sendStatusRequestOnStream(
+            proto::VehicleStreamRequest* request);
+    // Converts the events and sends them to the property change callback.
+    void onPropertyEvents(const proto::VehiclePropValues& protoValues);
+
     aidlvhal::StatusCode getValuesWithRetry(const std::vector<aidlvhal::GetValueRequest>& requests,
                                             std::vector<aidlvhal::GetValueResult>* results,
                                             size_t retryCount) const;
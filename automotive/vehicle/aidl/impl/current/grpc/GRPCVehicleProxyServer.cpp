@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <condition_variable>
+#include <optional>
 #include <mutex>
 #include <unordered_set>
 #include <utility>
@@ -32,6 +33,11 @@
 namespace android::hardware::automotive::vehicle::virtualization {
 
 namespace {
+
+// Continuous property events arrive with some jitter, an event slightly earlier than the sample
+// interval is still forwarded.
+constexpr double kSampleIntervalJitterRatio = 0.1;
+
 std::shared_ptr<::grpc::ServerCredentials> getServerCredentials() {
     return ::grpc::InsecureServerCredentials();
 }
@@ -54,9 +60,32 @@ void aidlResultsToProtoResults(const AidlResultType& aidlResults, ProtoResultTyp
         proto_msg_converter::aidlToProto(aidlResult, protoResult);
     }
 }
+
+void getValueResultsToProto(const std::vector<aidlvhal::GetValueResult>& aidlResults,
+                            proto::GetValueResults* protoResults) {
+    for (const auto& aidlResult : aidlResults) {
+        auto& protoResult = *protoResults->add_results();
+        protoResult.set_request_id(aidlResult.requestId);
+        protoResult.set_status(static_cast<proto::StatusCode>(aidlResult.status));
+        if (aidlResult.prop) {
+            proto_msg_converter::aidlToProto(*aidlResult.prop, protoResult.mutable_value());
+        }
+    }
+}
+
+void setValueResultsToProto(const std::vector<aidlvhal::SetValueResult>& aidlResults,
+                            proto::SetValueResults* protoResults) {
+    for (const auto& aidlResult : aidlResults) {
+        auto& protoResult = *protoResults->add_results();
+        protoResult.set_request_id(aidlResult.requestId);
+        protoResult.set_status(static_cast<proto::StatusCode>(aidlResult.status));
+    }
+}
+
 }  // namespace
 
 std::atomic<uint64_t> GrpcVehicleProxyServer::ConnectionDescriptor::connection_id_counter_{0};
+std::atomic<uint64_t> GrpcVehicleProxyServer::VehicleStreamConnection::connection_id_counter_{0};
 
 GrpcVehicleProxyServer::GrpcVehicleProxyServer(std::string serverAddr,
                                                std::unique_ptr<IVehicleHardware>&& hardware)
@@ -216,7 +245,13 @@ GrpcVehicleProxyServer::GrpcVehicleProxyServer(std::vector<std::string> serverAd
     const auto& protoSubscribeOptions = request->options();
     aidlvhal::SubscribeOptions aidlSubscribeOptions = {};
     proto_msg_converter::protoToAidl(protoSubscribeOptions, &aidlSubscribeOptions);
-    const auto status_code = mHardware->subscribe(aidlSubscribeOptions);
+    // Tracked together with the vehicle stream subscriptions, so that a vehicle stream
+    // unsubscribing does not stop the events the unary clients subscribed to, and vice versa.
+    // Without area IDs there is nothing to track per area, leave it to the hardware.
+    const auto status_code =
+            aidlSubscribeOptions.areaIds.empty()
+                    ? mHardware->subscribe(aidlSubscribeOptions)
+                    : AddSubscription(kUnarySubscriberId, aidlSubscribeOptions, /*conn=*/nullptr);
     status->set_status_code(static_cast<proto::StatusCode>(status_code));
     return ::grpc::Status::OK;
 }
@@ -224,9 +259,11 @@ GrpcVehicleProxyServer::GrpcVehicleProxyServer(std::vector<std::string> serverAd
 ::grpc::Status GrpcVehicleProxyServer::Unsubscribe(::grpc::ServerContext* context,
                                                    const proto::UnsubscribeRequest* request,
                                                    proto::VehicleHalCallStatus* status) {
-    int32_t propId = request->prop_id();
-    int32_t areaId = request->area_id();
-    const auto status_code = mHardware->unsubscribe(propId, areaId);
+    PropIdAreaId propIdAreaId = {
+            .propId = request->prop_id(),
+            .areaId = request->area_id(),
+    };
+    const auto status_code = RemoveSubscription(kUnarySubscriberId, propIdAreaId, /*conn=*/nullptr);
     status->set_status_code(static_cast<proto::StatusCode>(status_code));
     return ::grpc::Status::OK;
 }
@@ -283,6 +320,261 @@ GrpcVehicleProxyServer::GrpcVehicleProxyServer(std::vector<std::string> serverAd
     return ::grpc::Status::OK;
 }
 
+::grpc::Status GrpcVehicleProxyServer::StartVehicleStream(
+        ::grpc::ServerContext* context,
+        ::grpc::ServerReaderWriter<proto::VehicleStreamResponse, proto::VehicleStreamRequest>*
+                stream) {
+    auto conn = std::make_shared<VehicleStreamConnection>(context, stream);
+    {
+        std::lock_guard lck(mConnectionMutex);
+        mVehicleStreamConnections.push_back(conn);
+    }
+    // An empty response tells the client that this server supports the vehicle stream.
+    conn->Write(proto::VehicleStreamResponse());
+    LOG(INFO) << __func__ << ": Vehicle stream started, ID: " << conn->ID();
+
+    proto::VehicleStreamRequest request;
+    while (stream->Read(&request)) {
+        HandleVehicleStreamRequest(conn, request);
+    }
+
+    conn->Close();
+    {
+        std::lock_guard lck(mConnectionMutex);
+        mVehicleStreamConnections.erase(std::remove(mVehicleStreamConnections.begin(),
+                                                    mVehicleStreamConnections.end(), conn),
+                                        mVehicleStreamConnections.end());
+    }
+    for (const auto& propIdAreaId : conn->GetSubscriptions()) {
+        RemoveSubscription(conn->ID(), propIdAreaId, conn.get());
+    }
+    LOG(INFO) << __func__ << ": Vehicle stream closed, ID: " << conn->ID();
+    return ::grpc::Status::OK;
+}
+
+void GrpcVehicleProxyServer::HandleVehicleStreamRequest(
+        const std::shared_ptr<VehicleStreamConnection>& conn,
+        const proto::VehicleStreamRequest& request) {
+    int64_t streamRequestId = request.stream_request_id();
+    proto::VehicleStreamResponse response;
+    response.set_stream_request_id(streamRequestId);
+
+    switch (request.request_case()) {
+        case proto::VehicleStreamRequest::kGetValues: {
+            std::vector<aidlvhal::GetValueRequest> aidlRequests;
+            for (const auto& protoRequest : request.get_values().requests()) {
+                auto& aidlRequest = aidlRequests.emplace_back();
+                aidlRequest.requestId = protoRequest.request_id();
+                proto_msg_converter::protoToAidl(protoRequest.value(), &aidlRequest.prop);
+            }
+            // Unlike GetValues, the results are written back as they come, without blocking the
+            // stream.
+            auto aidlStatus = mHardware->getValues(
+                    std::make_shared<const IVehicleHardware::GetValuesCallback>(
+                            [conn, streamRequestId](
+                                    std::vector<aidlvhal::GetValueResult> getValueResults) {
+                                proto::VehicleStreamResponse response;
+                                response.set_stream_request_id(streamRequestId);
+                                getValueResultsToProto(getValueResults,
+                                                       response.mutable_get_value_results());
+                                conn->Write(response);
+                            }),
+                    aidlRequests);
+            if (aidlStatus != aidlvhal::StatusCode::OK) {
+                auto* protoResults = response.mutable_get_value_results();
+                for (const auto& aidlRequest : aidlRequests) {
+                    auto& protoResult = *protoResults->add_results();
+                    protoResult.set_request_id(aidlRequest.requestId);
+                    protoResult.set_status(static_cast<proto::StatusCode>(aidlStatus));
+                }
+                conn->Write(response);
+            }
+            return;
+        }
+        case proto::VehicleStreamRequest::kSetValues: {
+            std::vector<aidlvhal::SetValueRequest> aidlRequests;
+            for (const auto& protoRequest : request.set_values().requests()) {
+                auto& aidlRequest = aidlRequests.emplace_back();
+                aidlRequest.requestId = protoRequest.request_id();
+                proto_msg_converter::protoToAidl(protoRequest.value(), &aidlRequest.value);
+            }
+            auto aidlStatus = mHardware->setValues(
+                    std::make_shared<const IVehicleHardware::SetValuesCallback>(
+                            [conn, streamRequestId](
+                                    std::vector<aidlvhal::SetValueResult> setValueResults) {
+                                proto::VehicleStreamResponse response;
+                                response.set_stream_request_id(streamRequestId);
+                                setValueResultsToProto(setValueResults,
+                                                       response.mutable_set_value_results());
+                                conn->Write(response);
+                            }),
+                    aidlRequests);
+            if (aidlStatus != aidlvhal::StatusCode::OK) {
+                auto* protoResults = response.mutable_set_value_results();
+                for (const auto& aidlRequest : aidlRequests) {
+                    auto& protoResult = *protoResults->add_results();
+                    protoResult.set_request_id(aidlRequest.requestId);
+                    protoResult.set_status(static_cast<proto::StatusCode>(aidlStatus));
+                }
+                conn->Write(response);
+            }
+            return;
+        }
+        case proto::VehicleStreamRequest::kSubscribe: {
+            aidlvhal::SubscribeOptions aidlSubscribeOptions = {};
+            proto_msg_converter::protoToAidl(request.subscribe().options(), &aidlSubscribeOptions);
+            // Without area IDs, all the areas are subscribed, as the VHAL does. They are tracked
+            // per area like the others, so that their events are sent on this stream.
+            if (aidlSubscribeOptions.areaIds.empty()) {
+                aidlSubscribeOptions.areaIds = GetAllAreaIds(aidlSubscribeOptions.propId);
+            }
+            // As the unary Subscribe, leave it to the hardware if the areas are still unknown.
+            auto statusCode =
+                    aidlSubscribeOptions.areaIds.empty()
+                            ? mHardware->subscribe(aidlSubscribeOptions)
+                            : AddSubscription(conn->ID(), aidlSubscribeOptions, conn.get());
+            response.mutable_status()->set_status_code(static_cast<proto::StatusCode>(statusCode));
+            conn->Write(response);
+            return;
+        }
+        case proto::VehicleStreamRequest::kUnsubscribe: {
+            PropIdAreaId propIdAreaId = {
+                    .propId = request.unsubscribe().prop_id(),
+                    .areaId = request.unsubscribe().area_id(),
+            };
+            auto statusCode = RemoveSubscription(conn->ID(), propIdAreaId, conn.get());
+            response.mutable_status()->set_status_code(static_cast<proto::StatusCode>(statusCode));
+            conn->Write(response);
+            return;
+        }
+        default:
+            LOG(WARNING) << __func__ << ": Unknown vehicle stream request, ID: " << streamRequestId;
+            return;
+    }
+}
+
+std::vector<int32_t> GrpcVehicleProxyServer::GetAllAreaIds(int32_t propId) {
+    if (isGlobalProp(propId)) {
+        return {0};
+    }
+    std::vector<int32_t> areaIds;
+    if (auto config = mHardware->getPropertyConfig(propId); config.has_value()) {
+        for (const auto& areaConfig : config->areaConfigs) {
+            areaIds.push_back(areaConfig.areaId);
+        }
+    }
+    return areaIds;
+}
+
+aidlvhal::StatusCode GrpcVehicleProxyServer::AddSubscription(
+        uint64_t subscriberId, const aidlvhal::SubscribeOptions& options,
+        VehicleStreamConnection* conn) {
+    std::lock_guard lck(mSubscriptionMutex);
+    // The areas subscribed so far and their previous options, rolled back if a later area fails.
+    std::vector<std::pair<PropIdAreaId, std::optional<aidlvhal::SubscribeOptions>>> subscribedAreas;
+    for (int32_t areaId : options.areaIds) {
+        PropIdAreaId propIdAreaId = {
+                .propId = options.propId,
+                .areaId = areaId,
+        };
+        auto& subscriberOptions = mSubscriptions[propIdAreaId];
+        std::optional<aidlvhal::SubscribeOptions> previousOptions;
+        if (auto it = subscriberOptions.find(subscriberId); it != subscriberOptions.end()) {
+            previousOptions = it->second;
+        }
+        aidlvhal::SubscribeOptions areaOptions = options;
+        areaOptions.areaIds = {areaId};
+        subscriberOptions[subscriberId] = std::move(areaOptions);
+
+        if (auto status = UpdateHardwareSubscriptionLocked(propIdAreaId);
+            status != aidlvhal::StatusCode::OK) {
+            // The hardware subscription of this area did not change.
+            RestoreSubscriptionLocked(subscriberId, propIdAreaId, previousOptions);
+            for (auto it = subscribedAreas.rbegin(); it != subscribedAreas.rend(); it++) {
+                const auto& [subscribedArea, subscribedAreaPreviousOptions] = *it;
+                RestoreSubscriptionLocked(subscriberId, subscribedArea,
+                                          subscribedAreaPreviousOptions);
+                if (auto rollbackStatus = UpdateHardwareSubscriptionLocked(subscribedArea);
+                    rollbackStatus != aidlvhal::StatusCode::OK) {
+                    LOG(WARNING) << __func__ << ": Failed to roll back the subscription to prop: "
+                                 << subscribedArea.propId << ", area: " << subscribedArea.areaId
+                                 << ", status: " << static_cast<int>(rollbackStatus);
+                }
+                if (conn == nullptr) {
+                    continue;
+                }
+                if (subscribedAreaPreviousOptions.has_value()) {
+                    conn->AddSubscription(subscribedArea,
+                                          subscribedAreaPreviousOptions->sampleRate);
+                } else {
+                    conn->RemoveSubscription(subscribedArea);
+                }
+            }
+            return status;
+        }
+        if (conn != nullptr) {
+            conn->AddSubscription(propIdAreaId, options.sampleRate);
+        }
+        subscribedAreas.emplace_back(propIdAreaId, std::move(previousOptions));
+    }
+    return aidlvhal::StatusCode::OK;
+}
+
+void GrpcVehicleProxyServer::RestoreSubscriptionLocked(
+        uint64_t subscriberId, const PropIdAreaId& propIdAreaId,
+        const std::optional<aidlvhal::SubscribeOptions>& previousOptions) {
+    auto& subscriberOptions = mSubscriptions[propIdAreaId];
+    if (previousOptions.has_value()) {
+        subscriberOptions[subscriberId] = *previousOptions;
+        return;
+    }
+    subscriberOptions.erase(subscriberId);
+    if (subscriberOptions.empty()) {
+        mSubscriptions.erase(propIdAreaId);
+    }
+}
+
+aidlvhal::StatusCode GrpcVehicleProxyServer::RemoveSubscription(uint64_t subscriberId,
+                                                                const PropIdAreaId& propIdAreaId,
+                                                                VehicleStreamConnection* conn) {
+    std::lock_guard lck(mSubscriptionMutex);
+    if (conn != nullptr) {
+        conn->RemoveSubscription(propIdAreaId);
+    }
+    auto it = mSubscriptions.find(propIdAreaId);
+    if (it == mSubscriptions.end()) {
+        // Not tracked here, e.g. subscribed without area IDs, let the hardware decide.
+        return subscriberId == kUnarySubscriberId
+                       ? mHardware->unsubscribe(propIdAreaId.propId, propIdAreaId.areaId)
+                       : aidlvhal::StatusCode::OK;
+    }
+    if (it->second.erase(subscriberId) == 0) {
+        return aidlvhal::StatusCode::OK;
+    }
+    if (it->second.empty()) {
+        mSubscriptions.erase(it);
+    }
+    return UpdateHardwareSubscriptionLocked(propIdAreaId);
+}
+
+aidlvhal::StatusCode GrpcVehicleProxyServer::UpdateHardwareSubscriptionLocked(
+        const PropIdAreaId& propIdAreaId) {
+    auto it = mSubscriptions.find(propIdAreaId);
+    if (it == mSubscriptions.end()) {
+        return mHardware->unsubscribe(propIdAreaId.propId, propIdAreaId.areaId);
+    }
+    // The hardware has to produce events for the most demanding subscriber, each stream then only
+    // gets what it asked for.
+    aidlvhal::SubscribeOptions mergedOptions = it->second.begin()->second;
+    for (const auto& [_, options] : it->second) {
+        mergedOptions.sampleRate = std::max(mergedOptions.sampleRate, options.sampleRate);
+        mergedOptions.resolution = std::min(mergedOptions.resolution, options.resolution);
+        mergedOptions.enableVariableUpdateRate =
+                mergedOptions.enableVariableUpdateRate && options.enableVariableUpdateRate;
+    }
+    return mHardware->subscribe(mergedOptions);
+}
+
 void GrpcVehicleProxyServer::OnVehiclePropChange(
         const std::vector<aidlvhal::VehiclePropValue>& values) {
     std::unordered_set<uint64_t> brokenConn;
@@ -301,6 +593,14 @@ void GrpcVehicleProxyServer::OnVehiclePropChange(
                 brokenConn.insert(connection->ID());
             }
         }
+        for (auto& connection : mVehicleStreamConnections) {
+            if (!connection->WriteEvents(values, protoValues)) {
+                LOG(ERROR) << __func__
+                           << ": Vehicle stream write failed, ID: " << connection->ID();
+                // The stream handler cleans up once the pending Read fails.
+                connection->Cancel();
+            }
+        }
     }
     if (brokenConn.empty()) {
         return;
@@ -335,6 +635,9 @@ GrpcVehicleProxyServer& GrpcVehicleProxyServer::Shutdown() {
     for (auto& conn : mValueStreamingConnections) {
         conn->Shutdown();
     }
+    for (auto& conn : mVehicleStreamConnections) {
+        conn->Cancel();
+    }
     if (mServer) {
         mServer->Shutdown();
     }
@@ -383,4 +686,91 @@ void GrpcVehicleProxyServer::ConnectionDescriptor::Shutdown() {
     mCV->notify_all();
 }
 
+GrpcVehicleProxyServer::VehicleStreamConnection::VehicleStreamConnection(
+        ::grpc::ServerContext* context, Stream* stream)
+    : mStream(stream), mConnectionID(connection_id_counter_.fetch_add(1) + 1), mContext(context) {}
+
+bool GrpcVehicleProxyServer::VehicleStreamConnection::Write(
+        const proto::VehicleStreamResponse& response) {
+    std::lock_guard lck(mWriteMutex);
+    if (mClosed) {
+        return false;
+    }
+    return mStream->Write(response);
+}
+
+bool GrpcVehicleProxyServer::VehicleStreamConnection::WriteEvents(
+        const std::vector<aidlvhal::VehiclePropValue>& values,
+        const proto::VehiclePropValues& protoValues) {
+    proto::VehicleStreamResponse response;
+    auto* protoEvents = response.mutable_property_events();
+    {
+        std::lock_guard lck(mSubscriptionMutex);
+        if (mSubscriptions.empty()) {
+            return true;
+        }
+        for (size_t i = 0; i < values.size(); i++) {
+            const auto& value = values[i];
+            auto it = mSubscriptions.find({.propId = value.prop, .areaId = value.areaId});
+            if (it == mSubscriptions.end()) {
+                continue;
+            }
+            Subscription& subscription = it->second;
+            if (subscription.intervalNanos != 0 && subscription.lastEventTimestamp != 0 &&
+                value.timestamp - subscription.lastEventTimestamp < subscription.intervalNanos) {
+                continue;
+            }
+            subscription.lastEventTimestamp = value.timestamp;
+            *protoEvents->add_values() = protoValues.values(i);
+        }
+    }
+    if (protoEvents->values_size() == 0) {
+        return true;
+    }
+    return Write(response);
+}
+
+void GrpcVehicleProxyServer::VehicleStreamConnection::AddSubscription(
+        const PropIdAreaId& propIdAreaId, float sampleRate) {
+    Subscription subscription = {};
+    if (sampleRate > 0) {
+        subscription.intervalNanos =
+                static_cast<int64_t>(1'000'000'000 / sampleRate * (1 - kSampleIntervalJitterRatio));
+    }
+    std::lock_guard lck(mSubscriptionMutex);
+    mSubscriptions[propIdAreaId] = subscription;
+}
+
+void GrpcVehicleProxyServer::VehicleStreamConnection::RemoveSubscription(
+        const PropIdAreaId& propIdAreaId) {
+    std::lock_guard lck(mSubscriptionMutex);
+    mSubscriptions.erase(propIdAreaId);
+}
+
+std::vector<PropIdAreaId> GrpcVehicleProxyServer::VehicleStreamConnection::GetSubscriptions() {
+    std::vector<PropIdAreaId> propIdAreaIds;
+    std::lock_guard lck(mSubscriptionMutex);
+    for (const auto& [propIdAreaId, _] : mSubscriptions) {
+        propIdAreaIds.push_back(propIdAreaId);
+    }
+    return propIdAreaIds;
+}
+
+void GrpcVehicleProxyServer::VehicleStreamConnection::Cancel() {
+    std::lock_guard lck(mContextMutex);
+    // The context is only valid until the stream handler returns.
+    if (mContext != nullptr) {
+        mContext->TryCancel();
+    }
+}
+
+void GrpcVehicleProxyServer::VehicleStreamConnection::Close() {
+    {
+        std::lock_guard lck(mContextMutex);
+        mContext = nullptr;
+    }
+    std::lock_guard lck(mWriteMutex);
+    mClosed = true;
+}
+
 }  // namespace android::hardware::automotive::vehicle::virtualization
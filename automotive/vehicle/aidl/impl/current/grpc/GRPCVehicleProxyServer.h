@@ -17,10 +17,12 @@
 #pragma once
 
 #include "IVehicleHardware.h"
+#include "VehicleUtils.h"
 
 #include "VehicleServer.grpc.pb.h"
 #include "VehicleServer.pb.h"
 
+#include <android-base/thread_annotations.h>
 #include <grpc++/grpc++.h>
 
 #include <atomic>
@@ -28,9 +30,13 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace android::hardware::automotive::vehicle::virtualization {
 
@@ -85,6 +91,11 @@ class GrpcVehicleProxyServer : public proto::VehicleServer::Service {
                                            const proto::GetSupportedValuesListsRequest* requests,
                                            proto::GetSupportedValuesListsResult* results) override;
 
+    ::grpc::Status StartVehicleStream(
+            ::grpc::ServerContext* context,
+            ::grpc::ServerReaderWriter<proto::VehicleStreamResponse, proto::VehicleStreamRequest>*
+                    stream) override;
+
     GrpcVehicleProxyServer& Start();
 
     GrpcVehicleProxyServer& Shutdown();
@@ -127,12 +138,110 @@ class GrpcVehicleProxyServer : public proto::VehicleServer::Service {
         static std::atomic<uint64_t> connection_id_counter_;
     };
 
+    // A long-lasting bidirectional vehicle stream. Responses are written from the hardware callback
+    // threads as well as the property event thread, so the writes are serialized. Writes after the
+    // stream is closed are dropped.
+    class VehicleStreamConnection {
+      public:
+        using Stream = ::grpc::ServerReaderWriter<proto::VehicleStreamResponse,
+                                                  proto::VehicleStreamRequest>;
+
+        VehicleStreamConnection(::grpc::ServerContext* context, Stream* stream);
+
+        uint64_t ID() const { return mConnectionID; }
+
+        bool Write(const proto::VehicleStreamResponse& response);
+
+        // Writes the events subscribed on this stream. The subscribed continuous properties are
+        // decimated to the sample rate requested on this stream. 'protoValues' must be the
+        // converted 'values'.
+        bool WriteEvents(const std::vector<aidlvhal::VehiclePropValue>& values,
+                         const proto::VehiclePropValues& protoValues);
+
+        void AddSubscription(const PropIdAreaId& propIdAreaId, float sampleRate);
+
+        void RemoveSubscription(const PropIdAreaId& propIdAreaId);
+
+        std::vector<PropIdAreaId> GetSubscriptions();
+
+        // Cancels the stream, the pending Read returns false.
+        void Cancel();
+
+        // Stops all the writes, must be called before the stream handler returns.
+        void Close();
+
+      private:
+        struct Subscription {
+            // The minimum interval between two forwarded events, 0 for on-change properties which
+            // are never decimated.
+            int64_t intervalNanos = 0;
+            int64_t lastEventTimestamp = 0;
+        };
+
+        Stream* mStream;
+        const uint64_t mConnectionID;
+
+        // Separate from mWriteMutex so that a write blocked on flow control does not block Cancel.
+        std::mutex mContextMutex;
+        ::grpc::ServerContext* mContext GUARDED_BY(mContextMutex);
+
+        std::mutex mWriteMutex;
+        bool mClosed GUARDED_BY(mWriteMutex) = false;
+
+        std::mutex mSubscriptionMutex;
+        std::unordered_map<PropIdAreaId, Subscription, PropIdAreaIdHash> mSubscriptions
+                GUARDED_BY(mSubscriptionMutex);
+
+        static std::atomic<uint64_t> connection_id_counter_;
+    };
+
+    void HandleVehicleStreamRequest(const std::shared_ptr<VehicleStreamConnection>& conn,
+                                    const proto::VehicleStreamRequest& request);
+
+    // Returns the area IDs of the property, {0} if it is global, empty if it is unknown.
+    std::vector<int32_t> GetAllAreaIds(int32_t propId);
+
+    // Adds the subscription of a vehicle stream, or of the unary clients if 'conn' is nullptr, and
+    // updates the hardware subscription. If an area fails, the areas subscribed before it are
+    // rolled back, so that nothing changes.
+    aidlvhal::StatusCode AddSubscription(uint64_t subscriberId,
+                                         const aidlvhal::SubscribeOptions& options,
+                                         VehicleStreamConnection* conn);
+
+    // Removes the subscription of a vehicle stream, or of the unary clients if 'conn' is nullptr.
+    // The hardware is only unsubscribed once no one else subscribes to the [propId, areaId].
+    aidlvhal::StatusCode RemoveSubscription(uint64_t subscriberId, const PropIdAreaId& propIdAreaId,
+                                            VehicleStreamConnection* conn);
+
+    // Restores the options of the subscriber for the [propId, areaId], removes them if there were
+    // no previous options.
+    void RestoreSubscriptionLocked(uint64_t subscriberId, const PropIdAreaId& propIdAreaId,
+                                   const std::optional<aidlvhal::SubscribeOptions>& previousOptions)
+            REQUIRES(mSubscriptionMutex);
+
+    // Subscribes to, or unsubscribes from, the underlying hardware with the merged options of all
+    // the subscribers of the [propId, areaId].
+    aidlvhal::StatusCode UpdateHardwareSubscriptionLocked(const PropIdAreaId& propIdAreaId)
+            REQUIRES(mSubscriptionMutex);
+
     std::vector<std::string> mServiceAddrs;
     std::unique_ptr<::grpc::Server> mServer{nullptr};
     std::unique_ptr<IVehicleHardware> mHardware;
 
     std::shared_mutex mConnectionMutex;
     std::vector<std::shared_ptr<ConnectionDescriptor>> mValueStreamingConnections;
+    std::vector<std::shared_ptr<VehicleStreamConnection>> mVehicleStreamConnections;
+
+    // The subscriptions made through the unary Subscribe RPC are shared by all the unary clients,
+    // they use this subscriber ID. Vehicle stream connection IDs start from 1.
+    static constexpr uint64_t kUnarySubscriberId = 0;
+
+    // The subscribe options for each subscriber, per [propId, areaId]. The subscribers are the
+    // vehicle streams and the unary clients. Each value has one area ID.
+    std::mutex mSubscriptionMutex;
+    std::unordered_map<PropIdAreaId, std::unordered_map<uint64_t, aidlvhal::SubscribeOptions>,
+                       PropIdAreaIdHash>
+            mSubscriptions GUARDED_BY(mSubscriptionMutex);
 
     static constexpr auto kHardwareOpTimeout = std::chrono::seconds(1);
 };
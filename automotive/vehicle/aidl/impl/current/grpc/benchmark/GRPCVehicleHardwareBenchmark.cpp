@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GRPCVehicleHardware.h"
+#include "GRPCVehicleProxyServer.h"
+#include "IVehicleHardware.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android::hardware::automotive::vehicle::virtualization {
+
+namespace {
+
+namespace aidlvhal = ::aidl::android::hardware::automotive::vehicle;
+
+// Compares the unary RPCs with the vehicle stream over a loopback connection.
+
+const std::string kBenchmarkServerAddr = "127.0.0.1:54322";
+constexpr auto kWaitForConnectionMaxTime = std::chrono::seconds(5);
+
+// Answers every request right away, so the benchmark only measures the transport.
+class LoopbackVehicleHardware : public IVehicleHardware {
+  public:
+    std::vector<aidlvhal::VehiclePropConfig> getAllPropertyConfigs() const override { return {}; }
+
+    aidlvhal::StatusCode setValues(
+            std::shared_ptr<const SetValuesCallback> callback,
+            const std::vector<aidlvhal::SetValueRequest>& requests) override {
+        std::vector<aidlvhal::SetValueResult> results;
+        for (const auto& request : requests) {
+            results.push_back({
+                    .requestId = request.requestId,
+                    .status = aidlvhal::StatusCode::OK,
+            });
+        }
+        (*callback)(std::move(results));
+        return aidlvhal::StatusCode::OK;
+    }
+
+    aidlvhal::StatusCode getValues(
+            std::shared_ptr<const GetValuesCallback> callback,
+            const std::vector<aidlvhal::GetValueRequest>& requests) const override {
+        std::vector<aidlvhal::GetValueResult> results;
+        for (const auto& request : requests) {
+            aidlvhal::VehiclePropValue value = request.prop;
+            value.timestamp = 1;
+            value.value.int32Values = {1};
+            results.push_back({
+                    .requestId = request.requestId,
+                    .status = aidlvhal::StatusCode::OK,
+                    .prop = std::move(value),
+            });
+        }
+        (*callback)(std::move(results));
+        return aidlvhal::StatusCode::OK;
+    }
+
+    DumpResult dump(const std::vector<std::string>& options) override { return {}; }
+
+    aidlvhal::StatusCode checkHealth() override { return aidlvhal::StatusCode::OK; }
+
+    void registerOnPropertyChangeEvent(
+            std::unique_ptr<const PropertyChangeCallback> callback) override {}
+
+    void registerOnPropertySetErrorEvent(
+            std::unique_ptr<const PropertySetErrorCallback> callback) override {}
+};
+
+class LoopbackFixture : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State& state) override {
+        mServer = std::make_unique<GrpcVehicleProxyServer>(
+                kBenchmarkServerAddr, std::make_unique<LoopbackVehicleHardware>());
+        mServer->Start();
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        mServer->Shutdown().Wait();
+        mServer.reset();
+    }
+
+  protected:
+    // Returns nullptr if the client fails to connect.
+    std::unique_ptr<GRPCVehicleHardware> connect(bool useVehicleStream) {
+        auto hardware =
+                std::make_unique<GRPCVehicleHardware>(kBenchmarkServerAddr, useVehicleStream);
+        if (!hardware->waitForConnected(kWaitForConnectionMaxTime)) {
+            return nullptr;
+        }
+        auto deadline = std::chrono::steady_clock::now() + kWaitForConnectionMaxTime;
+        while (useVehicleStream && !hardware->isVehicleStreamReady()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return nullptr;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return hardware;
+    }
+
+    // Argument is the number of requests in one getValues call.
+    void runGetValues(benchmark::State& state, bool useVehicleStream) {
+        auto hardware = connect(useVehicleStream);
+        if (hardware == nullptr) {
+            state.SkipWithError("failed to connect to the loopback server");
+            return;
+        }
+        std::vector<aidlvhal::GetValueRequest> requests;
+        for (int64_t i = 0; i < state.range(0); i++) {
+            requests.push_back({
+                    .requestId = i,
+                    .prop = {.prop = static_cast<int32_t>(i)},
+            });
+        }
+        for (auto _ : state) {
+            std::promise<void> done;
+            auto callback = std::make_shared<const IVehicleHardware::GetValuesCallback>(
+                    [&done](std::vector<aidlvhal::GetValueResult> results) { done.set_value(); });
+            if (hardware->getValues(callback, requests) != aidlvhal::StatusCode::OK) {
+                state.SkipWithError("getValues failed");
+                break;
+            }
+            done.get_future().wait();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // Argument is the number of requests in one setValues call.
+    void runSetValues(benchmark::State& state, bool useVehicleStream) {
+        auto hardware = connect(useVehicleStream);
+        if (hardware == nullptr) {
+            state.SkipWithError("failed to connect to the loopback server");
+            return;
+        }
+        std::vector<aidlvhal::SetValueRequest> requests;
+        for (int64_t i = 0; i < state.range(0); i++) {
+            requests.push_back({
+                    .requestId = i,
+                    .value = {.prop = static_cast<int32_t>(i), .value = {.int32Values = {1}}},
+            });
+        }
+        for (auto _ : state) {
+            std::promise<void> done;
+            auto callback = std::make_shared<const IVehicleHardware::SetValuesCallback>(
+                    [&done](std::vector<aidlvhal::SetValueResult> results) { done.set_value(); });
+            if (hardware->setValues(callback, requests) != aidlvhal::StatusCode::OK) {
+                state.SkipWithError("setValues failed");
+                break;
+            }
+            done.get_future().wait();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+  private:
+    std::unique_ptr<GrpcVehicleProxyServer> mServer;
+};
+
+BENCHMARK_DEFINE_F(LoopbackFixture, BM_GetValuesUnary)(benchmark::State& state) {
+    runGetValues(state, /*useVehicleStream=*/false);
+}
+BENCHMARK_REGISTER_F(LoopbackFixture, BM_GetValuesUnary)->Arg(1)->Arg(10)->Arg(100);
+
+BENCHMARK_DEFINE_F(LoopbackFixture, BM_GetValuesVehicleStream)(benchmark::State& state) {
+    runGetValues(state, /*useVehicleStream=*/true);
+}
+BENCHMARK_REGISTER_F(LoopbackFixture, BM_GetValuesVehicleStream)->Arg(1)->Arg(10)->Arg(100);
+
+BENCHMARK_DEFINE_F(LoopbackFixture, BM_SetValuesUnary)(benchmark::State& state) {
+    runSetValues(state, /*useVehicleStream=*/false);
+}
+BENCHMARK_REGISTER_F(LoopbackFixture, BM_SetValuesUnary)->Arg(1)->Arg(10)->Arg(100);
+
+BENCHMARK_DEFINE_F(LoopbackFixture, BM_SetValuesVehicleStream)(benchmark::State& state) {
+    runSetValues(state, /*useVehicleStream=*/true);
+}
+BENCHMARK_REGISTER_F(LoopbackFixture, BM_SetValuesVehicleStream)->Arg(1)->Arg(10)->Arg(100);
+
+}  // namespace
+
+}  // namespace android::hardware::automotive::vehicle::virtualization
+
+BENCHMARK_MAIN();
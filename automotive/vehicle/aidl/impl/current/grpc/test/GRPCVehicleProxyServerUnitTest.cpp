@@ -23,10 +23,14 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 namespace android::hardware::automotive::vehicle::virtualization {
 
@@ -52,8 +56,15 @@ class VehicleHardwareForTest : public IVehicleHardware {
         }
     }
 
+    std::vector<aidlvhal::VehiclePropConfig> getAllPropertyConfigs() const override {
+        return mConfigs;
+    }
+
+    void setPropertyConfigs(std::vector<aidlvhal::VehiclePropConfig> configs) {
+        mConfigs = std::move(configs);
+    }
+
     // Functions that we do not care.
-    std::vector<aidlvhal::VehiclePropConfig> getAllPropertyConfigs() const override { return {}; }
 
     aidlvhal::StatusCode setValues(
             std::shared_ptr<const SetValuesCallback> callback,
@@ -61,9 +72,22 @@ class VehicleHardwareForTest : public IVehicleHardware {
         return aidlvhal::StatusCode::OK;
     }
 
+    // Returns the requested property with the area ID as the value.
     aidlvhal::StatusCode getValues(
             std::shared_ptr<const GetValuesCallback> callback,
             const std::vector<aidlvhal::GetValueRequest>& requests) const override {
+        std::vector<aidlvhal::GetValueResult> results;
+        for (const auto& request : requests) {
+            aidlvhal::VehiclePropValue value = request.prop;
+            value.timestamp = 1;
+            value.value.int32Values = {request.prop.areaId};
+            results.push_back({
+                    .requestId = request.requestId,
+                    .status = aidlvhal::StatusCode::OK,
+                    .prop = std::move(value),
+            });
+        }
+        (*callback)(std::move(results));
         return aidlvhal::StatusCode::OK;
     }
 
@@ -74,10 +98,84 @@ class VehicleHardwareForTest : public IVehicleHardware {
     void registerOnPropertySetErrorEvent(
             std::unique_ptr<const PropertySetErrorCallback> callback) override {}
 
+    aidlvhal::StatusCode subscribe(aidlvhal::SubscribeOptions options) override {
+        std::lock_guard lck(mLock);
+        for (int32_t areaId : options.areaIds) {
+            if (areaId == mFailedSubscribeAreaId) {
+                return aidlvhal::StatusCode::INTERNAL_ERROR;
+            }
+        }
+        mSubscribeOptions.push_back(std::move(options));
+        return aidlvhal::StatusCode::OK;
+    }
+
+    // Subscribing to the area fails.
+    void setFailedSubscribeAreaId(int32_t areaId) {
+        std::lock_guard lck(mLock);
+        mFailedSubscribeAreaId = areaId;
+    }
+
+    aidlvhal::StatusCode unsubscribe(int32_t propId, int32_t areaId) override {
+        std::lock_guard lck(mLock);
+        mUnsubscribed.push_back({.propId = propId, .areaId = areaId});
+        return aidlvhal::StatusCode::OK;
+    }
+
+    std::vector<aidlvhal::SubscribeOptions> getSubscribeOptions() {
+        std::lock_guard lck(mLock);
+        return mSubscribeOptions;
+    }
+
+    std::vector<PropIdAreaId> getUnsubscribed() {
+        std::lock_guard lck(mLock);
+        return mUnsubscribed;
+    }
+
   private:
     std::unique_ptr<const PropertyChangeCallback> mOnProp;
+    std::mutex mLock;
+    std::vector<aidlvhal::SubscribeOptions> mSubscribeOptions;
+    std::vector<PropIdAreaId> mUnsubscribed;
+    std::optional<int32_t> mFailedSubscribeAreaId;
+    std::vector<aidlvhal::VehiclePropConfig> mConfigs;
+};
+
+// Collects the property events received by a GRPCVehicleHardware.
+class PropertyEventCollector {
+  public:
+    std::unique_ptr<const IVehicleHardware::PropertyChangeCallback> getCallback() {
+        return std::make_unique<const IVehicleHardware::PropertyChangeCallback>(
+                [this](std::vector<aidlvhal::VehiclePropValue> values) {
+                    std::lock_guard lck(mLock);
+                    for (auto& value : values) {
+                        mValues.push_back(std::move(value));
+                    }
+                });
+    }
+
+    std::vector<aidlvhal::VehiclePropValue> takeValues() {
+        std::lock_guard lck(mLock);
+        return std::move(mValues);
+    }
+
+  private:
+    std::mutex mLock;
+    std::vector<aidlvhal::VehiclePropValue> mValues;
 };
 
+bool waitForVehicleStreamReady(const GRPCVehicleHardware& hardware) {
+    constexpr auto kWaitForStreamStartMaxTime = std::chrono::seconds(5);
+    constexpr auto kPollInterval = std::chrono::milliseconds(10);
+    auto deadline = std::chrono::steady_clock::now() + kWaitForStreamStartMaxTime;
+    while (!hardware.isVehicleStreamReady()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(kPollInterval);
+    }
+    return true;
+}
+
 class MockVehicleHardware : public IVehicleHardware {
   public:
     // Mock methods from IVehicleHardware
@@ -123,8 +221,10 @@ TEST(GRPCVehicleProxyServerUnitTest, ClientConnectDisconnect) {
     constexpr auto kWaitForStreamStartTime = std::chrono::seconds(1);
     constexpr auto kWaitForUpdateDeliveryTime = std::chrono::seconds(1);
 
+    // The legacy value stream sends all the events to all the clients.
     auto updateReceived1 = std::make_shared<bool>(false);
-    auto vehicleHardware1 = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    auto vehicleHardware1 =
+            std::make_unique<GRPCVehicleHardware>(kFakeServerAddr, /*useVehicleStream=*/false);
     vehicleHardware1->registerOnPropertyChangeEvent(
             std::make_unique<const IVehicleHardware::PropertyChangeCallback>(
                     [updateReceived1](const auto&) { *updateReceived1 = true; }));
@@ -142,7 +242,8 @@ TEST(GRPCVehicleProxyServerUnitTest, ClientConnectDisconnect) {
     *updateReceived1 = false;
 
     auto updateReceived2 = std::make_shared<bool>(false);
-    auto vehicleHardware2 = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    auto vehicleHardware2 =
+            std::make_unique<GRPCVehicleHardware>(kFakeServerAddr, /*useVehicleStream=*/false);
     vehicleHardware2->registerOnPropertyChangeEvent(
             std::make_unique<const IVehicleHardware::PropertyChangeCallback>(
                     [updateReceived2](const auto&) { *updateReceived2 = true; }));
@@ -176,6 +277,302 @@ TEST(GRPCVehicleProxyServerUnitTest, ClientConnectDisconnect) {
     vehicleServer->Shutdown().Wait();
 }
 
+TEST(GRPCVehicleProxyServerUnitTest, VehicleStreamOnlySendsSubscribedEvents) {
+    auto testHardware = std::make_unique<VehicleHardwareForTest>();
+    auto* testHardwareRaw = testHardware.get();
+    auto vehicleServer =
+            std::make_unique<GrpcVehicleProxyServer>(kFakeServerAddr, std::move(testHardware));
+    vehicleServer->Start();
+
+    constexpr auto kWaitForUpdateDeliveryTime = std::chrono::seconds(1);
+
+    PropertyEventCollector collector1;
+    auto vehicleHardware1 = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    vehicleHardware1->registerOnPropertyChangeEvent(collector1.getCallback());
+    PropertyEventCollector collector2;
+    auto vehicleHardware2 = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    vehicleHardware2->registerOnPropertyChangeEvent(collector2.getCallback());
+    ASSERT_TRUE(waitForVehicleStreamReady(*vehicleHardware1));
+    ASSERT_TRUE(waitForVehicleStreamReady(*vehicleHardware2));
+
+    EXPECT_EQ(vehicleHardware1->subscribe({.propId = 1, .areaIds = {0}}),
+              aidlvhal::StatusCode::OK);
+    EXPECT_EQ(vehicleHardware2->subscribe({.propId = 2, .areaIds = {0}}),
+              aidlvhal::StatusCode::OK);
+    ASSERT_THAT(testHardwareRaw->getSubscribeOptions(), ::testing::SizeIs(2));
+
+    testHardwareRaw->onPropertyEvent({
+            aidlvhal::VehiclePropValue{.timestamp = 1, .prop = 1},
+            aidlvhal::VehiclePropValue{.timestamp = 1, .prop = 2},
+            aidlvhal::VehiclePropValue{.timestamp = 1, .prop = 3},
+    });
+    std::this_thread::sleep_for(kWaitForUpdateDeliveryTime);
+
+    auto values1 = collector1.takeValues();
+    ASSERT_THAT(values1, ::testing::SizeIs(1));
+    EXPECT_EQ(values1[0].prop, 1);
+    auto values2 = collector2.takeValues();
+    ASSERT_THAT(values2, ::testing::SizeIs(1));
+    EXPECT_EQ(values2[0].prop, 2);
+
+    EXPECT_EQ(vehicleHardware1->unsubscribe(1, 0), aidlvhal::StatusCode::OK);
+    EXPECT_THAT(testHardwareRaw->getUnsubscribed(),
+                ::testing::ElementsAre(PropIdAreaId{.propId = 1, .areaId = 0}));
+
+    testHardwareRaw->onPropertyEvent({aidlvhal::VehiclePropValue{.timestamp = 2, .prop = 1}});
+    std::this_thread::sleep_for(kWaitForUpdateDeliveryTime);
+
+    EXPECT_THAT(collector1.takeValues(), ::testing::IsEmpty());
+
+    // The remaining subscription is removed from the hardware when the client disconnects.
+    vehicleHardware2.reset();
+    std::this_thread::sleep_for(kWaitForUpdateDeliveryTime);
+
+    EXPECT_THAT(testHardwareRaw->getUnsubscribed(),
+                ::testing::ElementsAre(PropIdAreaId{.propId = 1, .areaId = 0},
+                                       PropIdAreaId{.propId = 2, .areaId = 0}));
+
+    vehicleHardware1.reset();
+    vehicleServer->Shutdown().Wait();
+}
+
+TEST(GRPCVehicleProxyServerUnitTest, VehicleStreamSubscribesAllAreasWithoutAreaIds) {
+    auto testHardware = std::make_unique<VehicleHardwareForTest>();
+    auto* testHardwareRaw = testHardware.get();
+    testHardwareRaw->setPropertyConfigs({{
+            .prop = 1,
+            .areaConfigs = {{.areaId = 1}, {.areaId = 2}},
+    }});
+    auto vehicleServer =
+            std::make_unique<GrpcVehicleProxyServer>(kFakeServerAddr, std::move(testHardware));
+    vehicleServer->Start();
+
+    constexpr auto kWaitForUpdateDeliveryTime = std::chrono::seconds(1);
+
+    PropertyEventCollector collector;
+    auto vehicleHardware = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    vehicleHardware->registerOnPropertyChangeEvent(collector.getCallback());
+    ASSERT_TRUE(waitForVehicleStreamReady(*vehicleHardware));
+
+    EXPECT_EQ(vehicleHardware->subscribe({.propId = 1}), aidlvhal::StatusCode::OK);
+    auto subscribeOptions = testHardwareRaw->getSubscribeOptions();
+    ASSERT_THAT(subscribeOptions, ::testing::SizeIs(2));
+    EXPECT_THAT(subscribeOptions[0].areaIds, ::testing::ElementsAre(1));
+    EXPECT_THAT(subscribeOptions[1].areaIds, ::testing::ElementsAre(2));
+
+    testHardwareRaw->onPropertyEvent({aidlvhal::VehiclePropValue{
+            .timestamp = 1,
+            .areaId = 2,
+            .prop = 1,
+    }});
+    std::this_thread::sleep_for(kWaitForUpdateDeliveryTime);
+
+    auto values = collector.takeValues();
+    ASSERT_THAT(values, ::testing::SizeIs(1));
+    EXPECT_EQ(values[0].areaId, 2);
+
+    vehicleHardware.reset();
+    vehicleServer->Shutdown().Wait();
+}
+
+TEST(GRPCVehicleProxyServerUnitTest, VehicleStreamRollsBackFailedSubscription) {
+    auto testHardware = std::make_unique<VehicleHardwareForTest>();
+    auto* testHardwareRaw = testHardware.get();
+    testHardwareRaw->setFailedSubscribeAreaId(2);
+    auto vehicleServer =
+            std::make_unique<GrpcVehicleProxyServer>(kFakeServerAddr, std::move(testHardware));
+    vehicleServer->Start();
+
+    constexpr auto kWaitForUpdateDeliveryTime = std::chrono::seconds(1);
+
+    PropertyEventCollector collector;
+    auto vehicleHardware = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    vehicleHardware->registerOnPropertyChangeEvent(collector.getCallback());
+    ASSERT_TRUE(waitForVehicleStreamReady(*vehicleHardware));
+
+    EXPECT_EQ(vehicleHardware->subscribe({.propId = 1, .areaIds = {1, 2}}),
+              aidlvhal::StatusCode::INTERNAL_ERROR);
+    // Area 1 was subscribed before area 2 failed, it is unsubscribed again.
+    EXPECT_THAT(testHardwareRaw->getSubscribeOptions(), ::testing::SizeIs(1));
+    EXPECT_THAT(testHardwareRaw->getUnsubscribed(),
+                ::testing::ElementsAre(PropIdAreaId{.propId = 1, .areaId = 1}));
+
+    testHardwareRaw->onPropertyEvent({aidlvhal::VehiclePropValue{
+            .timestamp = 1,
+            .areaId = 1,
+            .prop = 1,
+    }});
+    std::this_thread::sleep_for(kWaitForUpdateDeliveryTime);
+
+    EXPECT_THAT(collector.takeValues(), ::testing::IsEmpty());
+
+    vehicleHardware.reset();
+    vehicleServer->Shutdown().Wait();
+}
+
+TEST(GRPCVehicleProxyServerUnitTest, VehicleStreamDecimatesContinuousEvents) {
+    auto testHardware = std::make_unique<VehicleHardwareForTest>();
+    auto* testHardwareRaw = testHardware.get();
+    auto vehicleServer =
+            std::make_unique<GrpcVehicleProxyServer>(kFakeServerAddr, std::move(testHardware));
+    vehicleServer->Start();
+
+    constexpr auto kWaitForUpdateDeliveryTime = std::chrono::seconds(1);
+    constexpr int64_t kMillisToNanos = 1'000'000;
+
+    PropertyEventCollector collector1;
+    auto vehicleHardware1 = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    vehicleHardware1->registerOnPropertyChangeEvent(collector1.getCallback());
+    PropertyEventCollector collector2;
+    auto vehicleHardware2 = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    vehicleHardware2->registerOnPropertyChangeEvent(collector2.getCallback());
+    ASSERT_TRUE(waitForVehicleStreamReady(*vehicleHardware1));
+    ASSERT_TRUE(waitForVehicleStreamReady(*vehicleHardware2));
+
+    EXPECT_EQ(vehicleHardware1->subscribe({.propId = 1, .areaIds = {0}, .sampleRate = 5}),
+              aidlvhal::StatusCode::OK);
+    EXPECT_EQ(vehicleHardware2->subscribe({.propId = 1, .areaIds = {0}, .sampleRate = 20}),
+              aidlvhal::StatusCode::OK);
+
+    // The hardware runs at the highest sample rate among the clients.
+    auto subscribeOptions = testHardwareRaw->getSubscribeOptions();
+    ASSERT_FALSE(subscribeOptions.empty());
+    EXPECT_FLOAT_EQ(subscribeOptions.back().sampleRate, 20);
+
+    // 2 seconds of events at 20Hz, with some jitter.
+    std::vector<aidlvhal::VehiclePropValue> values;
+    for (int64_t i = 1; i <= 40; i++) {
+        int64_t jitter = (i % 2 == 0) ? 1 : -1;
+        values.push_back({.timestamp = i * 50 * kMillisToNanos + jitter, .prop = 1});
+    }
+    testHardwareRaw->onPropertyEvent(values);
+    std::this_thread::sleep_for(kWaitForUpdateDeliveryTime);
+
+    EXPECT_THAT(collector1.takeValues(), ::testing::SizeIs(10));
+    EXPECT_THAT(collector2.takeValues(), ::testing::SizeIs(40));
+
+    vehicleHardware1.reset();
+    vehicleHardware2.reset();
+    vehicleServer->Shutdown().Wait();
+}
+
+TEST(GRPCVehicleProxyServerUnitTest, VehicleStreamGetValues) {
+    auto vehicleServer = std::make_unique<GrpcVehicleProxyServer>(
+            kFakeServerAddr, std::make_unique<VehicleHardwareForTest>());
+    vehicleServer->Start();
+
+    constexpr auto kWaitForResultTime = std::chrono::seconds(1);
+
+    auto vehicleHardware = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    ASSERT_TRUE(waitForVehicleStreamReady(*vehicleHardware));
+
+    std::promise<std::vector<aidlvhal::GetValueResult>> resultsPromise;
+    auto resultsFuture = resultsPromise.get_future();
+    auto status = vehicleHardware->getValues(
+            std::make_shared<const IVehicleHardware::GetValuesCallback>(
+                    [&resultsPromise](std::vector<aidlvhal::GetValueResult> results) {
+                        resultsPromise.set_value(std::move(results));
+                    }),
+            {{.requestId = 1, .prop = {.areaId = 7, .prop = 1}}});
+
+    ASSERT_EQ(status, aidlvhal::StatusCode::OK);
+    ASSERT_EQ(resultsFuture.wait_for(kWaitForResultTime), std::future_status::ready);
+    auto results = resultsFuture.get();
+    ASSERT_THAT(results, ::testing::SizeIs(1));
+    EXPECT_EQ(results[0].requestId, 1);
+    EXPECT_EQ(results[0].status, aidlvhal::StatusCode::OK);
+    ASSERT_TRUE(results[0].prop.has_value());
+    EXPECT_EQ(results[0].prop->value.int32Values, std::vector<int32_t>{7});
+
+    vehicleHardware.reset();
+    vehicleServer->Shutdown().Wait();
+}
+
+TEST(GRPCVehicleProxyServerUnitTest, VehicleStreamGetValuesRetriesOutdatedResults) {
+    auto testHardware = std::make_unique<VehicleHardwareForTest>();
+    auto* testHardwareRaw = testHardware.get();
+    auto vehicleServer =
+            std::make_unique<GrpcVehicleProxyServer>(kFakeServerAddr, std::move(testHardware));
+    vehicleServer->Start();
+
+    constexpr auto kWaitForUpdateDeliveryTime = std::chrono::seconds(1);
+    constexpr auto kWaitForResultTime = std::chrono::seconds(5);
+
+    auto vehicleHardware = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    ASSERT_TRUE(waitForVehicleStreamReady(*vehicleHardware));
+    ASSERT_EQ(vehicleHardware->subscribe({.propId = 1, .areaIds = {7}}),
+              aidlvhal::StatusCode::OK);
+
+    // The test hardware returns values with timestamp 1, which are older than this event, so
+    // every get result is outdated and retried.
+    testHardwareRaw->onPropertyEvent(
+            {aidlvhal::VehiclePropValue{.timestamp = 2, .areaId = 7, .prop = 1}});
+    std::this_thread::sleep_for(kWaitForUpdateDeliveryTime);
+
+    std::promise<std::vector<aidlvhal::GetValueResult>> resultsPromise;
+    auto resultsFuture = resultsPromise.get_future();
+    auto status = vehicleHardware->getValues(
+            std::make_shared<const IVehicleHardware::GetValuesCallback>(
+                    [&resultsPromise](std::vector<aidlvhal::GetValueResult> results) {
+                        resultsPromise.set_value(std::move(results));
+                    }),
+            {{.requestId = 1, .prop = {.areaId = 7, .prop = 1}}});
+
+    ASSERT_EQ(status, aidlvhal::StatusCode::OK);
+    ASSERT_EQ(resultsFuture.wait_for(kWaitForResultTime), std::future_status::ready);
+    auto results = resultsFuture.get();
+    ASSERT_THAT(results, ::testing::SizeIs(1));
+    EXPECT_EQ(results[0].requestId, 1);
+    EXPECT_EQ(results[0].status, aidlvhal::StatusCode::TRY_AGAIN);
+
+    vehicleHardware.reset();
+    vehicleServer->Shutdown().Wait();
+}
+
+TEST(GRPCVehicleProxyServerUnitTest, VehicleStreamAndUnarySubscriptionsAreShared) {
+    auto testHardware = std::make_unique<VehicleHardwareForTest>();
+    auto* testHardwareRaw = testHardware.get();
+    auto vehicleServer =
+            std::make_unique<GrpcVehicleProxyServer>(kFakeServerAddr, std::move(testHardware));
+    vehicleServer->Start();
+
+    auto vehicleHardware = std::make_unique<GRPCVehicleHardware>(kFakeServerAddr);
+    ASSERT_TRUE(waitForVehicleStreamReady(*vehicleHardware));
+
+    ::grpc::ServerContext context;
+    proto::VehicleHalCallStatus status;
+    proto::SubscribeRequest subscribeRequest;
+    subscribeRequest.mutable_options()->set_prop_id(1);
+    subscribeRequest.mutable_options()->add_area_ids(0);
+    proto::UnsubscribeRequest unsubscribeRequest;
+    unsubscribeRequest.set_prop_id(1);
+    unsubscribeRequest.set_area_id(0);
+
+    ASSERT_TRUE(vehicleServer->Subscribe(&context, &subscribeRequest, &status).ok());
+    EXPECT_EQ(status.status_code(), proto::StatusCode::OK);
+    EXPECT_EQ(vehicleHardware->subscribe({.propId = 1, .areaIds = {0}}),
+              aidlvhal::StatusCode::OK);
+
+    // The unary clients still subscribe to the property.
+    EXPECT_EQ(vehicleHardware->unsubscribe(1, 0), aidlvhal::StatusCode::OK);
+    EXPECT_THAT(testHardwareRaw->getUnsubscribed(), ::testing::IsEmpty());
+
+    ASSERT_TRUE(vehicleServer->Unsubscribe(&context, &unsubscribeRequest, &status).ok());
+    EXPECT_EQ(status.status_code(), proto::StatusCode::OK);
+    EXPECT_THAT(testHardwareRaw->getUnsubscribed(),
+                ::testing::ElementsAre(PropIdAreaId{.propId = 1, .areaId = 0}));
+
+    // The vehicle stream still subscribes to the property.
+    EXPECT_EQ(vehicleHardware->subscribe({.propId = 1, .areaIds = {0}}),
+              aidlvhal::StatusCode::OK);
+    ASSERT_TRUE(vehicleServer->Subscribe(&context, &subscribeRequest, &status).ok());
+    ASSERT_TRUE(vehicleServer->Unsubscribe(&context, &unsubscribeRequest, &status).ok());
+    EXPECT_THAT(testHardwareRaw->getUnsubscribed(), ::testing::SizeIs(1));
+
+    vehicleHardware.reset();
+    vehicleServer->Shutdown().Wait();
+}
+
 TEST(GRPCVehicleProxyServerUnitTest, Subscribe) {
     auto mockHardware = std::make_unique<MockVehicleHardware>();
     // We make sure this is alive inside the function scope.
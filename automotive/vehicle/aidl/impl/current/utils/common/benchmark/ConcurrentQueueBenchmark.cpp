@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ConcurrentQueue.h>
+#include <VehicleHalTypes.h>
+
+#include <benchmark/benchmark.h>
+#include <utils/SystemClock.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+
+constexpr int32_t kTestPropId = 0x21600207;
+constexpr int kEventsPerProducer = 20000;
+// Mimics the bursts of property updates from the hardware layer.
+constexpr int kBurstSize = 16;
+constexpr std::chrono::milliseconds kBatchInterval(1);
+constexpr size_t kMaxBatchSize = 256;
+
+VehiclePropValue createEvent() {
+    return VehiclePropValue{
+            .timestamp = elapsedRealtimeNano(),
+            .prop = kTestPropId,
+            .value = {.floatValues = {1.0f}},
+    };
+}
+
+// Measures the raw push throughput with the benchmark threads as producers and one thread
+// draining the queue.
+template <typename QueueType>
+void BM_Push(benchmark::State& state) {
+    static QueueType* queue;
+    static std::thread* consumer;
+    if (state.thread_index() == 0) {
+        queue = new QueueType();
+        consumer = new std::thread([] {
+            while (queue->waitForItems()) {
+                benchmark::DoNotOptimize(queue->flush());
+            }
+        });
+    }
+
+    for (auto _ : state) {
+        queue->push(createEvent());
+    }
+
+    if (state.thread_index() == 0) {
+        queue->deactivate();
+        consumer->join();
+        delete consumer;
+        delete queue;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Measures the delivery latency from push to the batch callback through a BatchingConsumer with
+// state.range(0) producer threads.
+template <typename QueueType>
+void BM_BatchingLatency(benchmark::State& state) {
+    int numProducers = state.range(0);
+    std::vector<int64_t> latencies;
+    latencies.reserve(numProducers * kEventsPerProducer);
+    int64_t totalEvents = 0;
+
+    for (auto _ : state) {
+        QueueType queue;
+        BatchingConsumer<VehiclePropValue, QueueType> consumer;
+        std::mutex lock;
+        std::condition_variable cv;
+        int64_t receivedEvents = 0;
+        latencies.clear();
+
+        consumer.run(
+                &queue, kBatchInterval,
+                [&](std::vector<VehiclePropValue> events) {
+                    int64_t now = elapsedRealtimeNano();
+                    std::scoped_lock<std::mutex> lockGuard(lock);
+                    for (const auto& event : events) {
+                        latencies.push_back(now - event.timestamp);
+                    }
+                    receivedEvents += events.size();
+                    cv.notify_one();
+                },
+                kMaxBatchSize);
+
+        std::vector<std::thread> producers;
+        for (int i = 0; i < numProducers; i++) {
+            producers.emplace_back([&queue] {
+                for (int j = 0; j < kEventsPerProducer / kBurstSize; j++) {
+                    std::vector<VehiclePropValue> burst;
+                    for (int k = 0; k < kBurstSize; k++) {
+                        burst.push_back(createEvent());
+                    }
+                    queue.push(std::move(burst));
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        {
+            std::unique_lock<std::mutex> lockGuard(lock);
+            cv.wait(lockGuard, [&] { return receivedEvents == numProducers * kEventsPerProducer; });
+        }
+
+        queue.deactivate();
+        consumer.requestStop();
+        consumer.waitStopped();
+        totalEvents += receivedEvents;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    state.counters["p50_us"] = latencies[latencies.size() / 2] / 1000.0;
+    state.counters["p99_us"] = latencies[latencies.size() * 99 / 100] / 1000.0;
+    state.counters["events_per_sec"] =
+            benchmark::Counter(totalEvents, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_TEMPLATE(BM_Push, ConcurrentQueue<VehiclePropValue>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Push, MpscConcurrentQueue<VehiclePropValue>)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_BatchingLatency, ConcurrentQueue<VehiclePropValue>)
+        ->Arg(1)
+        ->Arg(4)
+        ->Iterations(5)
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BatchingLatency, MpscConcurrentQueue<VehiclePropValue>)
+        ->Arg(1)
+        ->Arg(4)
+        ->Iterations(5)
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <RecurrentTimer.h>
+
+#include <benchmark/benchmark.h>
+
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using Backend = RecurrentTimer::Backend;
+
+// The sample rates used by continuous subscriptions: 1, 5, 10, 20, 50 and 100 Hz.
+constexpr int64_t kIntervalsInNanos[] = {1'000'000'000, 200'000'000, 100'000'000,
+                                         50'000'000,    20'000'000,  10'000'000};
+constexpr auto kMeasureDuration = std::chrono::seconds(2);
+
+int64_t getProcessCpuTimeNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+}
+
+// Arguments are {backend, numCallbacks}. Registers the callbacks with mixed intervals and reports
+// the CPU time used by the process while the timer runs, the number of wakeups and the drift.
+void BM_RecurrentTimer(benchmark::State& state) {
+    Backend backend = static_cast<Backend>(state.range(0));
+    int64_t numCallbacks = state.range(1);
+    std::atomic<int64_t> callbackCount = 0;
+    RecurrentTimer::DriftStats stats;
+    int64_t cpuTimeNanos = 0;
+
+    for (auto _ : state) {
+        RecurrentTimer timer(backend);
+        std::vector<std::shared_ptr<RecurrentTimer::Callback>> callbacks;
+        for (int64_t i = 0; i < numCallbacks; i++) {
+            callbacks.push_back(std::make_shared<RecurrentTimer::Callback>(
+                    [&callbackCount] { callbackCount++; }));
+            timer.registerTimerCallback(kIntervalsInNanos[i % std::size(kIntervalsInNanos)],
+                                        callbacks.back());
+        }
+
+        int64_t cpuTimeStart = getProcessCpuTimeNanos();
+        std::this_thread::sleep_for(kMeasureDuration);
+        cpuTimeNanos += getProcessCpuTimeNanos() - cpuTimeStart;
+
+        for (const auto& callback : callbacks) {
+            timer.unregisterTimerCallback(callback);
+        }
+        stats = timer.getDriftStats();
+    }
+
+    double seconds = std::chrono::duration<double>(kMeasureDuration).count() * state.iterations();
+    state.counters["cpu_ms_per_sec"] = cpuTimeNanos / 1'000'000.0 / seconds;
+    state.counters["wakeups_per_sec"] = stats.wakeUpCount / seconds;
+    state.counters["callbacks_per_sec"] = callbackCount / seconds;
+    state.counters["missed_intervals"] = stats.missedIntervalCount;
+    state.counters["avg_drift_us"] =
+            stats.callbackCount == 0 ? 0 : stats.totalDriftInNanos / stats.callbackCount / 1000.0;
+    state.counters["max_drift_us"] = stats.maxDriftInNanos / 1000.0;
+}
+
+void recurrentTimerArgs(benchmark::internal::Benchmark* b) {
+    for (int64_t backend :
+         {static_cast<int64_t>(Backend::LOOPER), static_cast<int64_t>(Backend::TIMER_WHEEL)}) {
+        for (int64_t numCallbacks : {1'000, 10'000}) {
+            b->Args({backend, numCallbacks});
+        }
+    }
+    b->ArgNames({"backend", "callbacks"});
+}
+
+BENCHMARK(BM_RecurrentTimer)
+        ->Apply(recurrentTimerArgs)
+        ->Iterations(1)
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <VehicleHalTypes.h>
+#include <VehicleObjectPool.h>
+#include <VehicleUtils.h>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyType;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+
+// Mimics the bursts of property updates from the hardware layer. Larger than the per-thread
+// magazine so that the shared pool is used too.
+constexpr int kBurstSize = 32;
+
+VehiclePropValuePool* getPool() {
+    static VehiclePropValuePool pool;
+    return &pool;
+}
+
+// Obtains and releases one value at a time, served from the calling thread's magazine.
+void BM_ObtainRecycle(benchmark::State& state) {
+    VehiclePropValuePool* pool = getPool();
+    for (auto _ : state) {
+        auto value = pool->obtain(VehiclePropertyType::INT32);
+        benchmark::DoNotOptimize(value.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ObtainRecycle)->Threads(1)->Threads(4)->Threads(8);
+
+// Baseline without the pool.
+void BM_CreateDelete(benchmark::State& state) {
+    for (auto _ : state) {
+        auto value = createVehiclePropValue(VehiclePropertyType::INT32);
+        benchmark::DoNotOptimize(value.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CreateDelete)->Threads(1)->Threads(4)->Threads(8);
+
+// Holds a burst of values before releasing them, so the magazine is refilled from and spilled to
+// the shared pool.
+void BM_ObtainRecycleBurst(benchmark::State& state) {
+    VehiclePropValuePool* pool = getPool();
+    std::vector<VehiclePropValuePool::RecyclableType> values;
+    values.reserve(kBurstSize);
+    for (auto _ : state) {
+        for (int i = 0; i < kBurstSize; i++) {
+            values.push_back(pool->obtain(VehiclePropertyType::FLOAT));
+        }
+        values.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * kBurstSize);
+}
+BENCHMARK(BM_ObtainRecycleBurst)->Threads(1)->Threads(4)->Threads(8);
+
+// Vector values whose size changes within one size class share the same objects.
+void BM_ObtainRecycleVector(benchmark::State& state) {
+    VehiclePropValuePool* pool = getPool();
+    size_t vectorSize = 3;
+    for (auto _ : state) {
+        auto value = pool->obtain(VehiclePropertyType::FLOAT_VEC, vectorSize);
+        benchmark::DoNotOptimize(value.get());
+        vectorSize = vectorSize == 3 ? 4 : 3;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ObtainRecycleVector)->Threads(1)->Threads(4)->Threads(8);
+
+}  // namespace
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
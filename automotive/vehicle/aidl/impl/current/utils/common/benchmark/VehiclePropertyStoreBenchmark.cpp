@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <VehicleHalTypes.h>
+#include <VehiclePropertyStore.h>
+#include <VehicleUtils.h>
+
+#include <benchmark/benchmark.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehicleArea;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropConfig;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyAccess;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyChangeMode;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyGroup;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyType;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+
+using LockMode = VehiclePropertyStore::LockMode;
+
+// Roughly the number of continuous properties refreshed by a cluster build.
+constexpr int32_t kNumProperties = 64;
+
+int32_t getPropId(int32_t index) {
+    return (index + 1) | toInt(VehiclePropertyGroup::VENDOR) | toInt(VehicleArea::GLOBAL) |
+           toInt(VehiclePropertyType::FLOAT);
+}
+
+// All the benchmark threads share one store per lock mode.
+VehiclePropertyStore* getStore(LockMode lockMode) {
+    static auto createStore = [](LockMode mode) {
+        auto store = new VehiclePropertyStore(std::make_shared<VehiclePropValuePool>(), mode);
+        for (int32_t i = 0; i < kNumProperties; i++) {
+            int32_t propId = getPropId(i);
+            store->registerProperty(VehiclePropConfig{
+                    .prop = propId,
+                    .access = VehiclePropertyAccess::READ,
+                    .changeMode = VehiclePropertyChangeMode::CONTINUOUS,
+            });
+            auto value = store->getValuePool()->obtain(VehiclePropValue{
+                    .prop = propId,
+                    .value = {.floatValues = {0.0f}},
+            });
+            store->writeValue(std::move(value));
+        }
+        return store;
+    };
+    static VehiclePropertyStore* globalStore = createStore(LockMode::GLOBAL);
+    static VehiclePropertyStore* shardedStore = createStore(LockMode::SHARDED);
+    return lockMode == LockMode::GLOBAL ? globalStore : shardedStore;
+}
+
+// Arguments are {lockMode, numWriters}, the rest of the benchmark threads are readers. Writers
+// behave like the continuous property generators, readers behave like getValues calls.
+void BM_ReadWrite(benchmark::State& state) {
+    VehiclePropertyStore* store = getStore(static_cast<LockMode>(state.range(0)));
+    bool isWriter = state.thread_index() < state.range(1);
+    int32_t index = state.thread_index();
+    float floatValue = 0.0f;
+
+    for (auto _ : state) {
+        int32_t propId = getPropId(index++ % kNumProperties);
+        if (isWriter) {
+            auto value = store->getValuePool()->obtain(VehiclePropValue{
+                    .prop = propId,
+                    .value = {.floatValues = {floatValue++}},
+            });
+            store->writeValue(std::move(value), /*updateStatus=*/false,
+                              VehiclePropertyStore::EventMode::NEVER,
+                              /*useCurrentTimestamp=*/true);
+        } else {
+            auto result = store->readValue(propId);
+            benchmark::DoNotOptimize(result);
+        }
+    }
+    state.counters["ops"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+
+void readWriteArgs(benchmark::internal::Benchmark* b) {
+    for (int64_t lockMode : {static_cast<int64_t>(LockMode::GLOBAL),
+                             static_cast<int64_t>(LockMode::SHARDED)}) {
+        for (int64_t numWriters : {1, 4}) {
+            b->Args({lockMode, numWriters});
+        }
+    }
+    b->ArgNames({"lockMode", "writers"});
+}
+
+BENCHMARK(BM_ReadWrite)->Apply(readWriteArgs)->Threads(4)->Threads(8)->Threads(16)->UseRealTime();
+
+}  // namespace
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
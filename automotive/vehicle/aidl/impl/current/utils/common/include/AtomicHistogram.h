@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_utils_common_include_AtomicHistogram_H_
+#define android_hardware_automotive_vehicle_aidl_impl_utils_common_include_AtomicHistogram_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+// A lock-free histogram with power-of-two buckets.
+//
+// Bucket 0 counts values <= 0, bucket i (i >= 1) counts values in [2^(i-1), 2^i - 1]. Recording a
+// value is a few relaxed atomic operations and never blocks, so it is cheap enough to be always
+// on in the binder and callback paths.
+//
+// This class is thread-safe. A snapshot taken while values are being recorded is not atomic as a
+// whole: the total count might not exactly match the sum of the bucket counts.
+class AtomicHistogram final {
+  public:
+    static constexpr size_t NUM_BUCKETS = 64;
+
+    struct Snapshot {
+        std::array<uint64_t, NUM_BUCKETS> bucketCounts = {};
+        uint64_t count = 0;
+        int64_t sum = 0;
+        int64_t max = 0;
+
+        // Returns the average of the recorded values, or 0 if there are no values.
+        int64_t getMean() const;
+
+        // Returns an upper bound for the value at 'percentile' (in [0, 100]). The result is the
+        // upper bound of the bucket containing the percentile, capped at the max recorded value.
+        // Returns 0 if there are no values.
+        int64_t getPercentile(double percentile) const;
+    };
+
+    void record(int64_t value);
+
+    Snapshot getSnapshot() const;
+
+    void reset();
+
+    static size_t getBucketIndex(int64_t value);
+
+    // Returns the largest value that falls into the bucket.
+    static int64_t getBucketUpperBound(size_t index);
+
+  private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> mBucketCounts = {};
+    std::atomic<uint64_t> mCount = 0;
+    std::atomic<int64_t> mSum = 0;
+    std::atomic<int64_t> mMax = 0;
+};
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_utils_common_include_AtomicHistogram_H_
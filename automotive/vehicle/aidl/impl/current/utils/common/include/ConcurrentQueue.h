@@ -20,10 +20,16 @@
 #include <android-base/thread_annotations.h>
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <queue>
 #include <thread>
+#include <vector>
 
 namespace android {
 namespace hardware {
@@ -42,6 +48,21 @@ class ConcurrentQueue {
         return mIsActive;
     }
 
+    // Waits until there are at least 'count' items in the queue, the deadline has passed or the
+    // queue is deactivated. Returns whether the queue is still active.
+    bool waitForItems(size_t count, std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lockGuard(mLock);
+        android::base::ScopedLockAssertion lockAssertion(mLock);
+        mWakeUpCount = count;
+        while (mQueue.size() < count && mIsActive) {
+            if (mCond.wait_until(lockGuard, deadline) == std::cv_status::timeout) {
+                break;
+            }
+        }
+        mWakeUpCount = 1;
+        return mIsActive;
+    }
+
     std::vector<T> flush() {
         std::vector<T> items;
 
@@ -65,6 +86,9 @@ class ConcurrentQueue {
                 return;
             }
             mQueue.push(std::move(item));
+            if (mQueue.size() < mWakeUpCount) {
+                return;
+            }
         }
         mCond.notify_one();
     }
@@ -78,6 +102,9 @@ class ConcurrentQueue {
             for (T& item : items) {
                 mQueue.push(std::move(item));
             }
+            if (mQueue.size() < mWakeUpCount) {
+                return;
+            }
         }
         mCond.notify_one();
     }
@@ -101,11 +128,230 @@ class ConcurrentQueue {
   private:
     mutable std::mutex mLock;
     bool mIsActive GUARDED_BY(mLock) = true;
+    // The waiting consumer is only notified once the queue holds this many items.
+    size_t mWakeUpCount GUARDED_BY(mLock) = 1;
     std::condition_variable mCond;
     std::queue<T> mQueue GUARDED_BY(mLock);
 };
 
+// A multi-producer single-consumer queue with the same interface as {@code ConcurrentQueue}.
+//
+// Items are pushed into a bounded lock-free ring buffer, so producers never take a lock unless the
+// consumer is waiting for items or the ring buffer is full. If the ring buffer is full, items go
+// to a mutex-guarded overflow queue until the consumer drains it, so items are never dropped and
+// the items pushed by one producer are always flushed in order.
+//
+// Only one thread may call waitForItems and flush at a time.
 template <typename T>
+class MpscConcurrentQueue {
+  public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    // 'capacity' is rounded up to a power of 2.
+    explicit MpscConcurrentQueue(size_t capacity = DEFAULT_CAPACITY)
+        : mCapacity(roundUpToPowerOf2(capacity)),
+          mMask(mCapacity - 1),
+          mCells(new Cell[mCapacity]) {
+        for (size_t i = 0; i < mCapacity; i++) {
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscConcurrentQueue(const MpscConcurrentQueue&) = delete;
+    MpscConcurrentQueue& operator=(const MpscConcurrentQueue&) = delete;
+
+    bool waitForItems() {
+        return waitForItems(/*count=*/1, std::chrono::steady_clock::time_point::max());
+    }
+
+    // Waits until there are at least 'count' items in the queue, the deadline has passed or the
+    // queue is deactivated. Returns whether the queue is still active.
+    bool waitForItems(size_t count, std::chrono::steady_clock::time_point deadline) {
+        if (mSize.load() >= count || !mIsActive.load()) {
+            return mIsActive.load();
+        }
+        std::unique_lock<std::mutex> lockGuard(mWaitLock);
+        mWakeUpCount.store(count);
+        mHasWaiter.store(true);
+        while (mSize.load() < count && mIsActive.load()) {
+            if (deadline == std::chrono::steady_clock::time_point::max()) {
+                mWaitCond.wait(lockGuard);
+            } else if (mWaitCond.wait_until(lockGuard, deadline) == std::cv_status::timeout) {
+                break;
+            }
+        }
+        mHasWaiter.store(false);
+        return mIsActive.load();
+    }
+
+    std::vector<T> flush() {
+        std::vector<T> items;
+        items.reserve(mSize.load(std::memory_order_relaxed));
+        // Even if the queue is deactivated, we should still flush all the remaining values in the
+        // queue.
+        while (std::optional<T> item = tryPop()) {
+            items.push_back(std::move(*item));
+        }
+        // tryPop stops at a cell that a producer claimed but has not written yet. The items behind
+        // it, and so the overflow queue, must wait for the next flush or they would be flushed
+        // before older items of the same producer.
+        if (mOverflowing.load(std::memory_order_acquire) &&
+            mDequeuePos == mEnqueuePos.load(std::memory_order_acquire)) {
+            std::scoped_lock<std::mutex> lockGuard(mOverflowLock);
+            for (T& item : mOverflow) {
+                items.push_back(std::move(item));
+            }
+            mOverflow.clear();
+            // Producers may use the ring buffer again since all the older items are flushed.
+            mOverflowing.store(false, std::memory_order_release);
+        }
+        mSize.fetch_sub(items.size());
+        return items;
+    }
+
+    void push(T&& item) {
+        if (!mIsActive.load(std::memory_order_relaxed)) {
+            return;
+        }
+        // Counted before the item becomes visible so that flush never observes more items than
+        // mSize.
+        mSize.fetch_add(1);
+        pushInternal(std::move(item));
+        notifyIfNeeded();
+    }
+
+    void push(std::vector<T>&& items) {
+        if (!mIsActive.load(std::memory_order_relaxed)) {
+            return;
+        }
+        mSize.fetch_add(items.size());
+        for (T& item : items) {
+            pushInternal(std::move(item));
+        }
+        notifyIfNeeded();
+    }
+
+    // Deactivates the queue, thus no one can push items to it, also notifies all waiting thread.
+    // The items already in the queue could still be flushed even after the queue is deactivated.
+    void deactivate() {
+        {
+            std::scoped_lock<std::mutex> lockGuard(mWaitLock);
+            mIsActive.store(false);
+        }
+        // To unblock all waiting consumers.
+        mWaitCond.notify_all();
+    }
+
+    // Returns the approximate number of items in the queue.
+    size_t size() const { return mSize.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return mCapacity; }
+
+  private:
+    // Keeps the consumer-owned and producer-owned positions on different cache lines.
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::optional<T> item;
+    };
+
+    static size_t roundUpToPowerOf2(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // Pushes the item into the ring buffer, or the overflow queue if the ring buffer is full or
+    // older items are still in the overflow queue.
+    void pushInternal(T&& item) {
+        if (!mOverflowing.load(std::memory_order_acquire) && tryPush(item)) {
+            return;
+        }
+        std::scoped_lock<std::mutex> lockGuard(mOverflowLock);
+        mOverflowing.store(true, std::memory_order_release);
+        mOverflow.push_back(std::move(item));
+    }
+
+    // Bounded MPMC ring buffer insertion (Vyukov). 'item' is only moved from on success.
+    bool tryPush(T& item) {
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = mCells[pos & mMask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.item.emplace(std::move(item));
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // The ring buffer is full.
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Only called by the single consumer.
+    std::optional<T> tryPop() {
+        Cell& cell = mCells[mDequeuePos & mMask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(mDequeuePos + 1) < 0) {
+            // Empty, or the producer that claimed this cell has not finished writing it.
+            return std::nullopt;
+        }
+        std::optional<T> item = std::move(cell.item);
+        cell.item.reset();
+        cell.sequence.store(mDequeuePos + mCapacity, std::memory_order_release);
+        mDequeuePos++;
+        return item;
+    }
+
+    void notifyIfNeeded() {
+        // Producers update mSize before checking mHasWaiter and the consumer sets mHasWaiter before
+        // checking mSize, both sequentially consistent, so at least one side observes the other.
+        if (!mHasWaiter.load() || mSize.load() < mWakeUpCount.load()) {
+            return;
+        }
+        {
+            // Taking the lock makes sure the consumer is either before its size check or already
+            // waiting.
+            std::scoped_lock<std::mutex> lockGuard(mWaitLock);
+        }
+        mWaitCond.notify_one();
+    }
+
+    const size_t mCapacity;
+    const size_t mMask;
+    const std::unique_ptr<Cell[]> mCells;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> mEnqueuePos = 0;
+    alignas(CACHE_LINE_SIZE) size_t mDequeuePos = 0;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> mSize = 0;
+    std::atomic<bool> mIsActive = true;
+    std::atomic<bool> mOverflowing = false;
+    std::atomic<bool> mHasWaiter = false;
+    std::atomic<size_t> mWakeUpCount = 1;
+
+    std::mutex mOverflowLock;
+    std::vector<T> mOverflow GUARDED_BY(mOverflowLock);
+
+    std::mutex mWaitLock;
+    std::condition_variable mWaitCond;
+};
+
+// Consumes the items from a {@code ConcurrentQueue} or a {@code MpscConcurrentQueue} in batches.
+//
+// Once an item arrives, the consumer waits until either the batch interval has elapsed or
+// 'maxBatchSize' items are in the queue, whichever comes first, then delivers all the queued items
+// as one batch. This bounds the delivery latency to the batch interval and avoids waiting for the
+// rest of the interval during a burst.
+template <typename T, typename QueueType = ConcurrentQueue<T>>
 class BatchingConsumer {
   private:
     enum class State {
@@ -123,12 +369,14 @@ class BatchingConsumer {
 
     using OnBatchReceivedFunc = std::function<void(std::vector<T> vec)>;
 
-    void run(ConcurrentQueue<T>* queue, std::chrono::nanoseconds batchInterval,
-             const OnBatchReceivedFunc& func) {
+    // 'maxBatchSize' of 0 means the batch is only delivered after the batch interval.
+    void run(QueueType* queue, std::chrono::nanoseconds batchInterval,
+             const OnBatchReceivedFunc& func, size_t maxBatchSize = 0) {
         mQueue = queue;
         mBatchInterval = batchInterval;
+        mMaxBatchSize = maxBatchSize == 0 ? SIZE_MAX : maxBatchSize;
 
-        mWorkerThread = std::thread(&BatchingConsumer<T>::runInternal, this, func);
+        mWorkerThread = std::thread(&BatchingConsumer<T, QueueType>::runInternal, this, func);
     }
 
     void requestStop() { mState = State::STOP_REQUESTED; }
@@ -146,7 +394,8 @@ class BatchingConsumer {
                 mQueue->waitForItems();
                 if (State::STOP_REQUESTED == mState) break;
 
-                std::this_thread::sleep_for(mBatchInterval);
+                mQueue->waitForItems(mMaxBatchSize,
+                                     std::chrono::steady_clock::now() + mBatchInterval);
                 if (State::STOP_REQUESTED == mState) break;
 
                 std::vector<T> items = mQueue->flush();
@@ -165,7 +414,8 @@ class BatchingConsumer {
 
     std::atomic<State> mState;
     std::chrono::nanoseconds mBatchInterval;
-    ConcurrentQueue<T>* mQueue;
+    size_t mMaxBatchSize;
+    QueueType* mQueue;
 };
 
 }  // namespace vehicle
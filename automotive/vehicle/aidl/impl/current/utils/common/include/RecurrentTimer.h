@@ -17,13 +17,16 @@
 #ifndef android_hardware_automotive_vehicle_aidl_impl_vhal_include_RecurrentTimer_H_
 #define android_hardware_automotive_vehicle_aidl_impl_vhal_include_RecurrentTimer_H_
 
+#include <TimerWheel.h>
 #include <android-base/thread_annotations.h>
 
 #include <utils/Looper.h>
 #include <atomic>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
@@ -42,8 +45,38 @@ class RecurrentTimer final {
     // The class for the function that would be called recurrently.
     using Callback = std::function<void()>;
 
+    enum class Backend {
+        // Posts one Looper message for every callback invocation.
+        LOOPER,
+        // Keeps the callbacks in a hierarchical timer wheel with a fixed tick. All the callbacks
+        // due in the same tick are invoked in a single wakeup, so the cost of the timer thread
+        // scales with the number of distinct ticks instead of the number of callbacks. Callbacks
+        // may be invoked up to one tick later than their scheduled time.
+        TIMER_WHEEL,
+    };
+
+    // Statistics about how late the callbacks are invoked compared to their scheduled time.
+    struct DriftStats {
+        // The number of times the timer thread woke up.
+        int64_t wakeUpCount = 0;
+        // The number of callback invocations.
+        int64_t callbackCount = 0;
+        // The number of scheduled invocations skipped because the timer was too late.
+        int64_t missedIntervalCount = 0;
+        int64_t totalDriftInNanos = 0;
+        int64_t maxDriftInNanos = 0;
+
+        std::string toString() const;
+    };
+
+    // 1ms.
+    static constexpr int64_t DEFAULT_TICK_IN_NANOS = 1'000'000;
+
     RecurrentTimer();
 
+    // 'tickInNanos' is only used by Backend::TIMER_WHEEL.
+    explicit RecurrentTimer(Backend backend, int64_t tickInNanos = DEFAULT_TICK_IN_NANOS);
+
     ~RecurrentTimer();
 
     // Registers a recurrent callback for a given interval.
@@ -53,6 +86,9 @@ class RecurrentTimer final {
     // Unregisters a previously registered recurrent callback.
     void unregisterTimerCallback(std::shared_ptr<Callback> callback);
 
+    // Gets the drift statistics since the timer was created.
+    DriftStats getDriftStats() EXCLUDES(mLock);
+
   private:
     friend class RecurrentMessageHandler;
 
@@ -65,6 +101,9 @@ class RecurrentTimer final {
         int64_t nextTimeInNanos;
     };
 
+    const Backend mBackend;
+    const int64_t mTickInNanos;
+
     android::sp<Looper> mLooper;
     android::sp<RecurrentMessageHandler> mHandler;
 
@@ -74,9 +113,20 @@ class RecurrentTimer final {
     std::thread mThread;
     std::unordered_map<std::shared_ptr<Callback>, int> mIdByCallback GUARDED_BY(mLock);
     std::unordered_map<int, std::unique_ptr<CallbackInfo>> mCallbackInfoById GUARDED_BY(mLock);
+    DriftStats mDriftStats GUARDED_BY(mLock);
+    // Only used by Backend::TIMER_WHEEL.
+    std::unique_ptr<TimerWheel> mTimerWheel GUARDED_BY(mLock);
+    // The tick for the pending wakeup message, only used by Backend::TIMER_WHEEL.
+    std::optional<uint64_t> mScheduledTick GUARDED_BY(mLock);
 
     void handleMessage(const android::Message& message) EXCLUDES(mLock);
+    void handleTimerWheelMessage() EXCLUDES(mLock);
     int getCallbackIdLocked(std::shared_ptr<Callback> callback) REQUIRES(mLock);
+    // Advances the next time for the callback past 'nowNanos' and records the drift.
+    void advanceNextTimeLocked(CallbackInfo* callbackInfo, int64_t nowNanos) REQUIRES(mLock);
+    // Posts the wakeup message for the next tick the timer wheel has work to do.
+    void scheduleTimerWheelLocked() REQUIRES(mLock);
+    uint64_t toTick(int64_t timeInNanos) const;
 };
 
 class RecurrentMessageHandler final : public android::MessageHandler {
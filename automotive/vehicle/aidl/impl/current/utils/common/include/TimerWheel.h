@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_utils_common_include_TimerWheel_H_
+#define android_hardware_automotive_vehicle_aidl_impl_utils_common_include_TimerWheel_H_
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+// A hierarchical timer wheel that tracks the expiry tick for timer IDs.
+//
+// Level 0 has one slot per tick, each higher level has one slot per a full rotation of the level
+// below it. Timers are moved to lower levels ("cascaded") when the wheel reaches the start of
+// their slot, so adding, removing and expiring a timer are O(1) regardless of the number of
+// timers, and all the timers expiring in the same tick are returned together.
+//
+// This class is not thread-safe.
+class TimerWheel final {
+  public:
+    explicit TimerWheel(uint64_t currentTick);
+
+    // Adds a timer that expires at 'expiryTick'. If 'expiryTick' is not after the current tick, the
+    // timer expires at the next tick. Adding an existing ID replaces its expiry tick.
+    void add(uint64_t id, uint64_t expiryTick);
+
+    // Removes the timer. Returns false if it does not exist.
+    bool remove(uint64_t id);
+
+    // Advances the current tick to 'tick' and appends the IDs for all the timers that expired to
+    // 'expiredIds'. The expired timers are removed from the wheel.
+    void advance(uint64_t tick, std::vector<uint64_t>* expiredIds);
+
+    // Returns the next tick at which the wheel has work to do, either expiring timers or cascading
+    // timers to a lower level. This is never later than the earliest expiry tick. Returns
+    // std::nullopt if there are no timers.
+    std::optional<uint64_t> getNextTick() const;
+
+    uint64_t getCurrentTick() const { return mCurrentTick; }
+
+    size_t size() const { return mTimers.size(); }
+
+  private:
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int NUM_SLOTS = 1 << SLOT_BITS;
+    static constexpr uint64_t SLOT_MASK = NUM_SLOTS - 1;
+    static constexpr int NUM_LEVELS = 4;
+
+    struct Timer {
+        uint64_t expiryTick;
+        int level;
+        int slot;
+        size_t index;
+    };
+
+    struct Level {
+        // Bit i is set if slots[i] is not empty.
+        uint64_t occupied = 0;
+        std::array<std::vector<uint64_t>, NUM_SLOTS> slots;
+    };
+
+    uint64_t mCurrentTick;
+    std::array<Level, NUM_LEVELS> mLevels;
+    std::unordered_map<uint64_t, Timer> mTimers;
+
+    void insert(uint64_t id, Timer* timer);
+    void unlink(const Timer& timer);
+    void cascade(int level);
+};
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_utils_common_include_TimerWheel_H_
@@ -17,10 +17,13 @@
 #ifndef android_hardware_automotive_vehicle_utils_include_VehicleObjectPool_H_
 #define android_hardware_automotive_vehicle_utils_include_VehicleObjectPool_H_
 
-#include <deque>
-#include <map>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include <VehicleHalTypes.h>
 
@@ -39,6 +42,10 @@ struct PoolStats {
     std::atomic<uint32_t> Created{0};
     std::atomic<uint32_t> Recycled{0};
     std::atomic<uint32_t> Deleted{0};
+    // Obtained from the calling thread's magazine without taking any lock.
+    std::atomic<uint32_t> MagazineHit{0};
+    // The calling thread's magazine was empty, it was refilled from the shared pool.
+    std::atomic<uint32_t> MagazineMiss{0};
 
     static PoolStats* instance() {
         static PoolStats inst;
@@ -68,6 +75,12 @@ using recyclable_ptr = typename std::unique_ptr<T, Deleter<T>>;
 
 // Generic abstract object pool class. Users of this class must implement {@Code createObject}.
 //
+// Each thread keeps a small free list (a magazine) per pool. {@Code obtain} and {@Code recycle}
+// only use the calling thread's magazine, without any lock, and the other threads only touch it
+// to steal from it. The shared pool is only locked to refill an empty magazine or to spill a full
+// one, {@Code kMagazineBatchSize} objects at a time. When the shared pool is empty, an object is
+// stolen from the magazine of another thread before a new one is created.
+//
 // This class is thread-safe. Concurrent calls to {@Code obtain} from multiple threads is OK, also
 // client can obtain an object in one thread and then move ownership to another thread.
 template <typename T>
@@ -75,22 +88,46 @@ class ObjectPool {
   public:
     using GetSizeFunc = std::function<size_t(const T&)>;
 
+    // The maximum number of free objects each thread keeps for one pool. These are counted in
+    // maxPoolObjectsSize like the other free objects.
+    static constexpr size_t kMagazineCapacity = 16;
+    static constexpr size_t kMagazineBatchSize = kMagazineCapacity / 2;
+
     ObjectPool(size_t maxPoolObjectsSize, GetSizeFunc getSizeFunc)
-        : mMaxPoolObjectsSize(maxPoolObjectsSize), mGetSizeFunc(getSizeFunc) {};
-    virtual ~ObjectPool() = default;
+        : mMaxPoolObjectsSize(maxPoolObjectsSize),
+          mPoolId(sNextPoolId.fetch_add(1, std::memory_order_relaxed)),
+          mDepot(std::make_shared<Depot>(maxPoolObjectsSize, getSizeFunc)),
+          mGetSizeFunc(getSizeFunc),
+          mDeleter(std::bind(&ObjectPool::recycle, this, std::placeholders::_1)) {};
+
+    virtual ~ObjectPool() {
+        // The magazines of the other threads are released when these threads exit, or the next
+        // time they use a new pool.
+        if (MagazineCache* cache = getMagazineCache(); cache != nullptr) {
+            cache->release(mPoolId);
+        }
+    }
 
     virtual recyclable_ptr<T> obtain() {
-        std::scoped_lock<std::mutex> lock(mLock);
         INC_METRIC_IF_DEBUG(Obtained)
-        if (mObjects.empty()) {
+        Magazine* magazine = getMagazine();
+        if (magazine == nullptr) {
             INC_METRIC_IF_DEBUG(Created)
             return wrap(createObject());
         }
-
-        auto o = wrap(mObjects.front().release());
-        mObjects.pop_front();
-        mPoolObjectsSize -= mGetSizeFunc(*o);
-        return o;
+        T* o = magazine->pop();
+        if (o == nullptr) {
+            INC_METRIC_IF_DEBUG(MagazineMiss)
+            o = mDepot->refill(magazine);
+            if (o == nullptr) {
+                INC_METRIC_IF_DEBUG(Created)
+                return wrap(createObject());
+            }
+        } else {
+            INC_METRIC_IF_DEBUG(MagazineHit)
+            magazine->objectsSize -= mGetSizeFunc(*o);
+        }
+        return wrap(o);
     }
 
     ObjectPool& operator=(const ObjectPool&) = delete;
@@ -100,43 +137,313 @@ class ObjectPool {
     virtual T* createObject() = 0;
 
     virtual void recycle(T* o) {
-        std::scoped_lock<std::mutex> lock(mLock);
+        Magazine* magazine = getMagazine();
         size_t objectSize = mGetSizeFunc(*o);
-
-        if (objectSize > mMaxPoolObjectsSize ||
-            mPoolObjectsSize > mMaxPoolObjectsSize - objectSize) {
+        if (magazine == nullptr || objectSize > mMaxPoolObjectsSize) {
             INC_METRIC_IF_DEBUG(Deleted)
-
-            // We have no space left in the pool.
             delete o;
             return;
         }
 
-        INC_METRIC_IF_DEBUG(Recycled)
+        if (magazine->objectsSize + objectSize > magazine->maxObjectsSize || !magazine->push(o)) {
+            if (!mDepot->recycle(magazine, o, objectSize)) {
+                INC_METRIC_IF_DEBUG(Deleted)
+
+                // We have no space left in the pool.
+                delete o;
+                return;
+            }
+        } else {
+            magazine->objectsSize += objectSize;
+        }
 
-        mObjects.push_back(std::unique_ptr<T>{o});
-        mPoolObjectsSize += objectSize;
+        INC_METRIC_IF_DEBUG(Recycled)
     }
 
     const size_t mMaxPoolObjectsSize;
 
   private:
-    const Deleter<T>& getDeleter() {
-        if (!mDeleter.get()) {
-            Deleter<T>* d =
-                    new Deleter<T>(std::bind(&ObjectPool::recycle, this, std::placeholders::_1));
-            mDeleter.reset(d);
+    struct Depot;
+
+    // A bounded work-stealing deque (Chase-Lev). The owner thread pushes and pops the most recently
+    // recycled object at the bottom without a lock. The other threads only steal the least
+    // recently recycled object at the top, while holding the depot lock.
+    struct Magazine {
+        Magazine(uint64_t poolId, const std::shared_ptr<Depot>& depot)
+            : poolId(poolId), depot(depot) {}
+
+        // Owner thread only. Returns false if the magazine is full.
+        bool push(T* o) {
+            int64_t b = bottom.load(std::memory_order_relaxed);
+            int64_t t = top.load(std::memory_order_acquire);
+            if (b - t >= static_cast<int64_t>(kMagazineCapacity)) {
+                return false;
+            }
+            slots[b % kMagazineCapacity].store(o, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Owner thread only. Returns nullptr if the magazine is empty.
+        T* pop() {
+            int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+            if (t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            T* o = slots[b % kMagazineCapacity].load(std::memory_order_relaxed);
+            if (t == b) {
+                // The last object, a thief may be taking it.
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed)) {
+                    o = nullptr;
+                }
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return o;
+        }
+
+        // Requires the depot lock. Returns nullptr if the magazine is empty.
+        T* steal() {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom.load(std::memory_order_acquire);
+            if (t >= b) {
+                return nullptr;
+            }
+            T* o = slots[t % kMagazineCapacity].load(std::memory_order_relaxed);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            return o;
         }
-        return *mDeleter.get();
+
+        // Owner thread only.
+        size_t size() const {
+            return bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_relaxed);
+        }
+
+        const uint64_t poolId;
+        const std::weak_ptr<Depot> depot;
+        std::array<std::atomic<T*>, kMagazineCapacity> slots = {};
+        std::atomic<int64_t> top{0};
+        std::atomic<int64_t> bottom{0};
+        // Owner thread only. The size of the objects pushed and not popped yet, including the
+        // stolen ones until the next time the depot is used, and the part of the depot's
+        // maxObjectsSize reserved for them.
+        size_t objectsSize = 0;
+        size_t maxObjectsSize = 0;
+        // Requires the depot lock. The size of the objects stolen from this magazine.
+        size_t stolenSize = 0;
+    };
+
+    // The objects shared by all the threads, and the magazines of the threads using the pool.
+    //
+    // The size of the free objects here plus the sizes reserved by the magazines never exceeds
+    // maxObjectsSize. The reservations only change under the lock, in batches.
+    struct Depot {
+        Depot(size_t maxObjectsSize, GetSizeFunc getSizeFunc)
+            : maxObjectsSize(maxObjectsSize), getSizeFunc(getSizeFunc) {}
+
+        // Moves up to kMagazineBatchSize objects to an empty magazine and takes one of them.
+        // Steals one from another magazine if there is no object left here. Returns nullptr if
+        // there is no free object.
+        T* refill(Magazine* magazine) {
+            std::scoped_lock<std::mutex> lockGuard(lock);
+            reconcileLocked(magazine);
+            while (magazine->size() < kMagazineBatchSize && !objects.empty()) {
+                T* o = objects.back().release();
+                objects.pop_back();
+                size_t objectSize = getSizeFunc(*o);
+                moveReservationLocked(objectSize, magazine);
+                magazine->push(o);
+                magazine->objectsSize += objectSize;
+            }
+            if (T* o = magazine->pop(); o != nullptr) {
+                magazine->objectsSize -= getSizeFunc(*o);
+                return o;
+            }
+            for (Magazine* other : magazines) {
+                if (T* o = other->steal(); o != nullptr) {
+                    // Still reserved by the other magazine until it uses the depot again.
+                    other->stolenSize += getSizeFunc(*o);
+                    return o;
+                }
+            }
+            return nullptr;
+        }
+
+        // Adds the object to the magazine which is full or has not reserved enough for it, after
+        // spilling kMagazineBatchSize objects here if it is full. Returns false if there is no
+        // space left for it.
+        bool recycle(Magazine* magazine, T* o, size_t objectSize) {
+            std::scoped_lock<std::mutex> lockGuard(lock);
+            reconcileLocked(magazine);
+            if (magazine->size() == kMagazineCapacity) {
+                spillLocked(magazine, kMagazineBatchSize);
+            }
+            // Reserve for a batch of objects, so that the next ones don't take the lock.
+            reservedSize -= magazine->maxObjectsSize;
+            size_t available = maxObjectsSize - objectsSize - reservedSize - magazine->objectsSize;
+            magazine->maxObjectsSize =
+                    magazine->objectsSize + std::min(available, objectSize * kMagazineBatchSize);
+            reservedSize += magazine->maxObjectsSize;
+            if (available < objectSize) {
+                return false;
+            }
+            magazine->push(o);
+            magazine->objectsSize += objectSize;
+            return true;
+        }
+
+        void attach(Magazine* magazine) {
+            std::scoped_lock<std::mutex> lockGuard(lock);
+            magazines.push_back(magazine);
+        }
+
+        // Moves all the objects of the magazine here, and stops stealing from it. Called by the
+        // owner thread.
+        void detach(Magazine* magazine) {
+            std::scoped_lock<std::mutex> lockGuard(lock);
+            reconcileLocked(magazine);
+            spillLocked(magazine, kMagazineCapacity);
+            reservedSize -= magazine->maxObjectsSize;
+            magazine->maxObjectsSize = 0;
+            magazines.erase(std::find(magazines.begin(), magazines.end(), magazine));
+        }
+
+        // Releases the reservations of the objects stolen from the magazine.
+        void reconcileLocked(Magazine* magazine) REQUIRES(lock) {
+            magazine->objectsSize -= magazine->stolenSize;
+            magazine->stolenSize = 0;
+        }
+
+        // Moves the reservation of an object leaving the depot to the magazine.
+        void moveReservationLocked(size_t objectSize, Magazine* magazine) REQUIRES(lock) {
+            objectsSize -= objectSize;
+            magazine->maxObjectsSize += objectSize;
+            reservedSize += objectSize;
+        }
+
+        // Moves up to 'count' objects, the least recently recycled first, from the magazine along
+        // with their reservations.
+        void spillLocked(Magazine* magazine, size_t count) REQUIRES(lock) {
+            for (size_t i = 0; i < count; i++) {
+                T* o = magazine->steal();
+                if (o == nullptr) {
+                    break;
+                }
+                size_t objectSize = getSizeFunc(*o);
+                objects.push_back(std::unique_ptr<T>{o});
+                objectsSize += objectSize;
+                magazine->objectsSize -= objectSize;
+                magazine->maxObjectsSize -= objectSize;
+                reservedSize -= objectSize;
+            }
+        }
+
+        const size_t maxObjectsSize;
+        const GetSizeFunc getSizeFunc;
+        std::mutex lock;
+        std::vector<std::unique_ptr<T>> objects GUARDED_BY(lock);
+        size_t objectsSize GUARDED_BY(lock) = 0;
+        // The sum of the maxObjectsSize of the magazines.
+        size_t reservedSize GUARDED_BY(lock) = 0;
+        std::vector<Magazine*> magazines GUARDED_BY(lock);
+    };
+
+    // The magazines of one thread, for all the pools of type T it has used.
+    struct MagazineCache {
+        ~MagazineCache() {
+            for (auto& magazine : magazines) {
+                flush(magazine.get());
+            }
+            sMagazineCacheDestroyed = true;
+        }
+
+        // Returns the objects to the pool if it still exists, deletes them otherwise.
+        static void flush(Magazine* magazine) {
+            if (auto depot = magazine->depot.lock(); depot != nullptr) {
+                depot->detach(magazine);
+                return;
+            }
+            while (T* o = magazine->pop()) {
+                delete o;
+            }
+        }
+
+        // Drops the magazine for the pool, or the magazines for the destroyed pools if 'poolId'
+        // is 0.
+        void release(uint64_t poolId) {
+            for (auto it = magazines.begin(); it != magazines.end();) {
+                Magazine* magazine = it->get();
+                if (magazine->poolId == poolId || (poolId == 0 && magazine->depot.expired())) {
+                    flush(magazine);
+                    if (last == magazine) {
+                        last = nullptr;
+                    }
+                    it = magazines.erase(it);
+                } else {
+                    it++;
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<Magazine>> magazines;
+        // Most threads keep using the same pool, skip the search for it.
+        Magazine* last = nullptr;
+    };
+
+    // Set once the calling thread's cache is destroyed at thread exit. This is trivially
+    // destructible, so it can still be read after that, e.g. by the destructors of static pools
+    // running on the main thread.
+    static inline thread_local bool sMagazineCacheDestroyed = false;
+
+    // Returns nullptr if called during or after the calling thread's exit.
+    static MagazineCache* getMagazineCache() {
+        if (sMagazineCacheDestroyed) {
+            return nullptr;
+        }
+        thread_local MagazineCache cache;
+        return &cache;
     }
 
-    recyclable_ptr<T> wrap(T* raw) { return recyclable_ptr<T>{raw, getDeleter()}; }
+    Magazine* getMagazine() {
+        MagazineCache* cache = getMagazineCache();
+        if (cache == nullptr) {
+            return nullptr;
+        }
+        if (cache->last != nullptr && cache->last->poolId == mPoolId) {
+            return cache->last;
+        }
+        for (auto& magazine : cache->magazines) {
+            if (magazine->poolId == mPoolId) {
+                cache->last = magazine.get();
+                return cache->last;
+            }
+        }
+        // First time this thread uses this pool, also a good time to clean up.
+        cache->release(/*poolId=*/0);
+        auto& magazine = cache->magazines.emplace_back(std::make_unique<Magazine>(mPoolId, mDepot));
+        mDepot->attach(magazine.get());
+        cache->last = magazine.get();
+        return cache->last;
+    }
 
-    mutable std::mutex mLock;
-    std::deque<std::unique_ptr<T>> mObjects GUARDED_BY(mLock);
-    std::unique_ptr<Deleter<T>> mDeleter;
-    size_t mPoolObjectsSize GUARDED_BY(mLock);
-    GetSizeFunc mGetSizeFunc;
+    recyclable_ptr<T> wrap(T* raw) { return recyclable_ptr<T>{raw, mDeleter}; }
+
+    // Pool IDs are never reused, unlike addresses, so a magazine left behind by a destroyed pool
+    // never matches a new pool. 0 is not a valid ID.
+    static inline std::atomic<uint64_t> sNextPoolId{1};
+
+    const uint64_t mPoolId;
+    const std::shared_ptr<Depot> mDepot;
+    const GetSizeFunc mGetSizeFunc;
+    const Deleter<T> mDeleter;
 };
 
 #undef INC_METRIC_IF_DEBUG
@@ -155,6 +462,9 @@ class ObjectPool {
 // immediately once the go out of scope. There's no synchronization penalty for these objects since
 // we do not store them in the pool.
 //
+// Vector values are pooled by size class: the sizes in (2^(n-1), 2^n] share one pool, whose
+// objects have room for 2^n elements, so values whose size changes a little reuse the same objects.
+//
 // This class is thread-safe. Users can obtain an object in one thread and pass it to another.
 //
 // Sample usage:
@@ -178,11 +488,12 @@ class VehiclePropValuePool {
     // unique pointer instead of a recyclable pointer. The object would not be recycled once it
     // goes out of scope, but would be deleted.
     // @param maxPoolObjectsSize - The approximate upper bound of memory each internal recycling
-    // pool could take. We have 4 different type pools, each with 4 different vector size, so
-    // approximately this pool would at-most take 4 * 4 * 10240 = 160k memory.
-    VehiclePropValuePool(size_t maxRecyclableVectorSize = 4, size_t maxPoolObjectsSize = 10240)
-        : mMaxRecyclableVectorSize(maxRecyclableVectorSize),
-          mMaxPoolObjectsSize(maxPoolObjectsSize) {};
+    // pool could take. We have 8 different type pools, each with 3 different vector size classes
+    // by default, so approximately this pool would at-most take 8 * 3 * 10240 = 240k memory,
+    // including the objects cached by each thread.
+    VehiclePropValuePool(size_t maxRecyclableVectorSize = 4, size_t maxPoolObjectsSize = 10240);
+
+    ~VehiclePropValuePool();
 
     // Obtain a recyclable VehiclePropertyValue object from the pool for the given type. If the
     // given type is not MIXED or STRING, the internal value vector size would be set to 1.
@@ -218,7 +529,14 @@ class VehiclePropValuePool {
     VehiclePropValuePool(VehiclePropValuePool&) = delete;
     VehiclePropValuePool& operator=(VehiclePropValuePool&) = delete;
 
+    // Returns the size class for the vector size, the smallest n such that vectorSize <= 2^n.
+    static size_t getSizeClass(size_t vectorSize);
+
   private:
+    // The number of recyclable property types: BOOLEAN, INT32, INT32_VEC, INT64, INT64_VEC,
+    // FLOAT, FLOAT_VEC and BYTES.
+    static constexpr size_t NUM_RECYCLABLE_TYPES = 8;
+
     static inline bool isSingleValueType(
             aidl::android::hardware::automotive::vehicle::VehiclePropertyType type) {
         return type == aidl::android::hardware::automotive::vehicle::VehiclePropertyType::BOOLEAN ||
@@ -245,15 +563,25 @@ class VehiclePropValuePool {
             aidl::android::hardware::automotive::vehicle::VehiclePropertyType type,
             size_t vectorSize);
 
+    // Returns the index of a recyclable type in [0, NUM_RECYCLABLE_TYPES).
+    static size_t getTypeIndex(
+            aidl::android::hardware::automotive::vehicle::VehiclePropertyType type);
+
+    // Holds the values with the given type and a vector size in [minVectorSize, maxVectorSize].
+    // Its objects are created with maxVectorSize elements.
     class InternalPool
         : public ObjectPool<aidl::android::hardware::automotive::vehicle::VehiclePropValue> {
       public:
         InternalPool(aidl::android::hardware::automotive::vehicle::VehiclePropertyType type,
-                     size_t vectorSize, size_t maxPoolObjectsSize,
+                     size_t minVectorSize, size_t maxVectorSize, size_t maxPoolObjectsSize,
                      ObjectPool::GetSizeFunc getSizeFunc)
             : ObjectPool(maxPoolObjectsSize, getSizeFunc),
               mPropType(type),
-              mVectorSize(vectorSize) {}
+              mMinVectorSize(minVectorSize),
+              mMaxVectorSize(maxVectorSize) {}
+
+        // Obtains a value whose vector for the pool type has exactly vectorSize elements.
+        RecyclableType obtain(size_t vectorSize);
 
       protected:
         aidl::android::hardware::automotive::vehicle::VehiclePropValue* createObject() override;
@@ -264,12 +592,23 @@ class VehiclePropValuePool {
 
         template <typename VecType>
         bool check(std::vector<VecType>* vec, bool isVectorType) {
-            return vec->size() == (isVectorType ? mVectorSize : 0);
+            if (!isVectorType) {
+                return vec->size() == 0;
+            }
+            return vec->size() >= mMinVectorSize && vec->size() <= mMaxVectorSize;
+        }
+
+        template <typename VecType>
+        void resize(std::vector<VecType>* vec, bool isVectorType, size_t vectorSize) {
+            if (isVectorType) {
+                vec->resize(vectorSize);
+            }
         }
 
       private:
         aidl::android::hardware::automotive::vehicle::VehiclePropertyType mPropType;
-        size_t mVectorSize;
+        size_t mMinVectorSize;
+        size_t mMaxVectorSize;
     };
     const Deleter<aidl::android::hardware::automotive::vehicle::VehiclePropValue>
             mDisposableDeleter{
@@ -277,12 +616,12 @@ class VehiclePropValuePool {
                         delete v;
                     }};
 
-    mutable std::mutex mLock;
     const size_t mMaxRecyclableVectorSize;
     const size_t mMaxPoolObjectsSize;
-    // A map with 'property_type' | 'value_vector_size' as key and a recyclable object pool as
-    // value. We would create a recyclable pool for each property type and vector size combination.
-    std::map<int32_t, std::unique_ptr<InternalPool>> mValueTypePools GUARDED_BY(mLock);
+    const size_t mNumSizeClasses;
+    // The recyclable object pools, indexed by type index * mNumSizeClasses + size class. A pool is
+    // created the first time it is used and is never removed, so looking it up takes no lock.
+    const std::unique_ptr<std::atomic<InternalPool*>[]> mValueTypePools;
 };
 
 }  // namespace vehicle
@@ -17,10 +17,12 @@
 #ifndef android_hardware_automotive_vehicle_aidl_impl_utils_common_include_VehiclePropertyStore_H_
 #define android_hardware_automotive_vehicle_aidl_impl_utils_common_include_VehiclePropertyStore_H_
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 
 #include <VehicleHalTypes.h>
@@ -40,12 +42,30 @@ namespace vehicle {
 // VehiclePropertyValues stored in a sorted map thus it makes easier to get range of values, e.g.
 // to get value for all areas for particular property.
 //
-// This class is thread-safe, however it uses blocking synchronization across all methods.
+// This class is thread-safe. By default it uses blocking synchronization across all methods, see
+// {@code LockMode} for a mode that allows concurrent access to different properties.
 class VehiclePropertyStore final {
   public:
     using ValueResultType = VhalResult<VehiclePropValuePool::RecyclableType>;
     using ValuesResultType = VhalResult<std::vector<VehiclePropValuePool::RecyclableType>>;
 
+    enum class LockMode : uint8_t {
+        /**
+         * One lock serializes all the operations, including reads.
+         */
+        GLOBAL,
+        /**
+         * The registered configs are protected by a reader-writer lock that is only taken
+         * exclusively by registerProperty and the callback setters. Property values are
+         * protected by reader-writer locks sharded by property ID, so readers never block each
+         * other and writes to properties in different shards do not serialize.
+         *
+         * This should be used when many clients read properties while continuous properties are
+         * refreshed at a high rate.
+         */
+        SHARDED,
+    };
+
     enum class EventMode : uint8_t {
         /**
          * Only invoke OnValueChangeCallback or OnValuesChangeCallback if the new property value
@@ -73,8 +93,9 @@ class VehiclePropertyStore final {
         NEVER,
     };
 
-    explicit VehiclePropertyStore(std::shared_ptr<VehiclePropValuePool> valuePool)
-        : mValuePool(valuePool) {}
+    explicit VehiclePropertyStore(std::shared_ptr<VehiclePropValuePool> valuePool,
+                                  LockMode lockMode = LockMode::GLOBAL)
+        : mValuePool(valuePool), mLockMode(lockMode) {}
 
     ~VehiclePropertyStore();
 
@@ -176,7 +197,12 @@ class VehiclePropertyStore final {
 
     inline std::shared_ptr<VehiclePropValuePool> getValuePool() { return mValuePool; }
 
+    inline LockMode getLockMode() const { return mLockMode; }
+
   private:
+    // Must be a power of 2.
+    static constexpr size_t kNumShards = 32;
+
     struct RecordId {
         int32_t area;
         int64_t token;
@@ -193,24 +219,57 @@ class VehiclePropertyStore final {
     struct Record {
         aidl::android::hardware::automotive::vehicle::VehiclePropConfig propConfig;
         TokenFunction tokenFunction;
-        std::unordered_map<RecordId, VehiclePropValuePool::RecyclableType, RecordIdHash> values;
+        // The values are guarded by the shard lock for the property rather than mLock, so they
+        // may be modified while mLock is only held shared.
+        mutable std::unordered_map<RecordId, VehiclePropValuePool::RecyclableType, RecordIdHash>
+                values;
+    };
+
+    // Holds mLock while accessing mRecordsByPropId. In LockMode::GLOBAL, mLock is held
+    // exclusively, otherwise it is held shared.
+    class SCOPED_CAPABILITY RecordsLockGuard final {
+      public:
+        explicit RecordsLockGuard(const VehiclePropertyStore& store) ACQUIRE_SHARED(store.mLock);
+        ~RecordsLockGuard() RELEASE();
+
+        RecordsLockGuard(const RecordsLockGuard&) = delete;
+        RecordsLockGuard& operator=(const RecordsLockGuard&) = delete;
+
+      private:
+        const VehiclePropertyStore& mStore;
+    };
+
+    // Holds the shard lock for the values of one property. Does nothing in LockMode::GLOBAL since
+    // the values are already protected by mLock held exclusively.
+    class ShardLockGuard final {
+      public:
+        ShardLockGuard(const VehiclePropertyStore& store, int32_t propId, bool exclusive);
+        ~ShardLockGuard();
+
+        ShardLockGuard(const ShardLockGuard&) = delete;
+        ShardLockGuard& operator=(const ShardLockGuard&) = delete;
+
+      private:
+        std::shared_mutex* mShardLock = nullptr;
+        bool mExclusive;
     };
 
     // {@code VehiclePropValuePool} is thread-safe.
     std::shared_ptr<VehiclePropValuePool> mValuePool;
-    mutable std::mutex mLock;
+    const LockMode mLockMode;
+    mutable std::shared_mutex mLock;
+    mutable std::array<std::shared_mutex, kNumShards> mShardLocks;
     std::unordered_map<int32_t, Record> mRecordsByPropId GUARDED_BY(mLock);
     OnValueChangeCallback mOnValueChangeCallback GUARDED_BY(mLock);
     OnValuesChangeCallback mOnValuesChangeCallback GUARDED_BY(mLock);
 
-    const Record* getRecordLocked(int32_t propId) const;
-
-    Record* getRecordLocked(int32_t propId);
+    const Record* getRecordLocked(int32_t propId) const REQUIRES_SHARED(mLock);
 
     RecordId getRecordIdLocked(
             const aidl::android::hardware::automotive::vehicle::VehiclePropValue& propValue,
             const Record& record) const;
 
+    // The shard lock for record's property must be held.
     ValueResultType readValueLocked(const RecordId& recId, const Record& record) const;
 };
 
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AtomicHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+size_t AtomicHistogram::getBucketIndex(int64_t value) {
+    if (value <= 0) {
+        return 0;
+    }
+    return 64 - __builtin_clzll(static_cast<uint64_t>(value));
+}
+
+int64_t AtomicHistogram::getBucketUpperBound(size_t index) {
+    if (index == 0) {
+        return 0;
+    }
+    if (index >= NUM_BUCKETS - 1) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    return (static_cast<int64_t>(1) << index) - 1;
+}
+
+void AtomicHistogram::record(int64_t value) {
+    mBucketCounts[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(value, std::memory_order_relaxed);
+    int64_t currentMax = mMax.load(std::memory_order_relaxed);
+    while (value > currentMax &&
+           !mMax.compare_exchange_weak(currentMax, value, std::memory_order_relaxed)) {
+    }
+}
+
+AtomicHistogram::Snapshot AtomicHistogram::getSnapshot() const {
+    Snapshot snapshot;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        snapshot.bucketCounts[i] = mBucketCounts[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = mCount.load(std::memory_order_relaxed);
+    snapshot.sum = mSum.load(std::memory_order_relaxed);
+    snapshot.max = mMax.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void AtomicHistogram::reset() {
+    for (auto& bucketCount : mBucketCounts) {
+        bucketCount.store(0, std::memory_order_relaxed);
+    }
+    mCount.store(0, std::memory_order_relaxed);
+    mSum.store(0, std::memory_order_relaxed);
+    mMax.store(0, std::memory_order_relaxed);
+}
+
+int64_t AtomicHistogram::Snapshot::getMean() const {
+    if (count == 0) {
+        return 0;
+    }
+    return sum / static_cast<int64_t>(count);
+}
+
+int64_t AtomicHistogram::Snapshot::getPercentile(double percentile) const {
+    uint64_t total = 0;
+    for (uint64_t bucketCount : bucketCounts) {
+        total += bucketCount;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * total));
+    if (target == 0) {
+        target = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += bucketCounts[i];
+        if (seen >= target) {
+            return std::min(getBucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
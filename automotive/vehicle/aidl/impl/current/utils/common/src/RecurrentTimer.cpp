@@ -16,12 +16,14 @@
 
 #include "RecurrentTimer.h"
 
+#include <android-base/stringprintf.h>
 #include <utils/Log.h>
 #include <utils/Looper.h>
 #include <utils/SystemClock.h>
 
 #include <inttypes.h>
 #include <math.h>
+#include <algorithm>
 
 namespace android {
 namespace hardware {
@@ -31,12 +33,31 @@ namespace vehicle {
 namespace {
 
 using ::android::base::ScopedLockAssertion;
+using ::android::base::StringPrintf;
 
 constexpr int INVALID_ID = -1;
+// The message ID for the timer wheel wakeup, which is shared by all the callbacks.
+constexpr int TIMER_WHEEL_MESSAGE_ID = -2;
 
 }  // namespace
 
-RecurrentTimer::RecurrentTimer() {
+std::string RecurrentTimer::DriftStats::toString() const {
+    return StringPrintf("{wakeUpCount: %" PRId64 ", callbackCount: %" PRId64
+                        ", missedIntervalCount: %" PRId64 ", averageDriftInNanos: %" PRId64
+                        ", maxDriftInNanos: %" PRId64 "}",
+                        wakeUpCount, callbackCount, missedIntervalCount,
+                        callbackCount == 0 ? 0 : totalDriftInNanos / callbackCount,
+                        maxDriftInNanos);
+}
+
+RecurrentTimer::RecurrentTimer() : RecurrentTimer(Backend::LOOPER) {}
+
+RecurrentTimer::RecurrentTimer(Backend backend, int64_t tickInNanos)
+    : mBackend(backend), mTickInNanos(tickInNanos) {
+    if (mBackend == Backend::TIMER_WHEEL) {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        mTimerWheel = std::make_unique<TimerWheel>(toTick(uptimeNanos()));
+    }
     mHandler = sp<RecurrentMessageHandler>::make(this);
     mLooper = sp<Looper>::make(/*allowNonCallbacks=*/false);
     mThread = std::thread([this] {
@@ -57,6 +78,41 @@ RecurrentTimer::~RecurrentTimer() {
     }
 }
 
+uint64_t RecurrentTimer::toTick(int64_t timeInNanos) const {
+    // Round up so that callbacks are never invoked earlier than scheduled.
+    return static_cast<uint64_t>((timeInNanos + mTickInNanos - 1) / mTickInNanos);
+}
+
+RecurrentTimer::DriftStats RecurrentTimer::getDriftStats() {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    return mDriftStats;
+}
+
+void RecurrentTimer::advanceNextTimeLocked(CallbackInfo* callbackInfo, int64_t nowNanos) {
+    int64_t driftInNanos = std::max<int64_t>(nowNanos - callbackInfo->nextTimeInNanos, 0);
+    // intervalCount is the number of interval we have to advance until we pass now.
+    size_t intervalCount = driftInNanos / callbackInfo->intervalInNanos + 1;
+    callbackInfo->nextTimeInNanos += intervalCount * callbackInfo->intervalInNanos;
+
+    mDriftStats.callbackCount++;
+    mDriftStats.missedIntervalCount += intervalCount - 1;
+    mDriftStats.totalDriftInNanos += driftInNanos;
+    mDriftStats.maxDriftInNanos = std::max(mDriftStats.maxDriftInNanos, driftInNanos);
+}
+
+void RecurrentTimer::scheduleTimerWheelLocked() {
+    std::optional<uint64_t> nextTick = mTimerWheel->getNextTick();
+    if (nextTick == mScheduledTick) {
+        return;
+    }
+    mLooper->removeMessages(mHandler, TIMER_WHEEL_MESSAGE_ID);
+    mScheduledTick = nextTick;
+    if (nextTick.has_value()) {
+        mLooper->sendMessageAtTime(*nextTick * mTickInNanos, mHandler,
+                                   Message(TIMER_WHEEL_MESSAGE_ID));
+    }
+}
+
 int RecurrentTimer::getCallbackIdLocked(std::shared_ptr<RecurrentTimer::Callback> callback) {
     const auto& it = mIdByCallback.find(callback);
     if (it != mIdByCallback.end()) {
@@ -79,7 +135,9 @@ void RecurrentTimer::registerTimerCallback(int64_t intervalInNanos,
             ALOGI("Replacing an existing timer callback with a new interval, current: %" PRId64
                   " ns, new: %" PRId64 " ns",
                   mCallbackInfoById[callbackId]->intervalInNanos, intervalInNanos);
-            mLooper->removeMessages(mHandler, callbackId);
+            if (mBackend == Backend::LOOPER) {
+                mLooper->removeMessages(mHandler, callbackId);
+            }
         }
 
         // Aligns the nextTime to multiply of interval.
@@ -89,9 +147,14 @@ void RecurrentTimer::registerTimerCallback(int64_t intervalInNanos,
         info->callback = callback;
         info->intervalInNanos = intervalInNanos;
         info->nextTimeInNanos = nextTimeInNanos;
-        mCallbackInfoById.insert({callbackId, std::move(info)});
+        mCallbackInfoById[callbackId] = std::move(info);
 
-        mLooper->sendMessageAtTime(nextTimeInNanos, mHandler, Message(callbackId));
+        if (mBackend == Backend::TIMER_WHEEL) {
+            mTimerWheel->add(callbackId, toTick(nextTimeInNanos));
+            scheduleTimerWheelLocked();
+        } else {
+            mLooper->sendMessageAtTime(nextTimeInNanos, mHandler, Message(callbackId));
+        }
     }
 }
 
@@ -106,13 +169,23 @@ void RecurrentTimer::unregisterTimerCallback(std::shared_ptr<RecurrentTimer::Cal
             return;
         }
 
-        mLooper->removeMessages(mHandler, callbackId);
+        if (mBackend == Backend::TIMER_WHEEL) {
+            // The pending wakeup is kept, at worst it wakes up the timer thread once for nothing.
+            mTimerWheel->remove(callbackId);
+        } else {
+            mLooper->removeMessages(mHandler, callbackId);
+        }
         mCallbackInfoById.erase(callbackId);
         mIdByCallback.erase(callback);
     }
 }
 
 void RecurrentTimer::handleMessage(const Message& message) {
+    if (message.what == TIMER_WHEEL_MESSAGE_ID) {
+        handleTimerWheelMessage();
+        return;
+    }
+
     std::shared_ptr<RecurrentTimer::Callback> callback;
     {
         std::scoped_lock<std::mutex> lockGuard(mLock);
@@ -127,11 +200,8 @@ void RecurrentTimer::handleMessage(const Message& message) {
 
         CallbackInfo* callbackInfo = it->second.get();
         callback = callbackInfo->callback;
-        int64_t nowNanos = uptimeNanos();
-        // intervalCount is the number of interval we have to advance until we pass now.
-        size_t intervalCount =
-                (nowNanos - callbackInfo->nextTimeInNanos) / callbackInfo->intervalInNanos + 1;
-        callbackInfo->nextTimeInNanos += intervalCount * callbackInfo->intervalInNanos;
+        mDriftStats.wakeUpCount++;
+        advanceNextTimeLocked(callbackInfo, uptimeNanos());
 
         mLooper->sendMessageAtTime(callbackInfo->nextTimeInNanos, mHandler, Message(callbackId));
     }
@@ -139,6 +209,37 @@ void RecurrentTimer::handleMessage(const Message& message) {
     (*callback)();
 }
 
+void RecurrentTimer::handleTimerWheelMessage() {
+    std::vector<std::shared_ptr<RecurrentTimer::Callback>> callbacks;
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+
+        mScheduledTick.reset();
+        mDriftStats.wakeUpCount++;
+        int64_t nowNanos = uptimeNanos();
+        std::vector<uint64_t> expiredIds;
+        mTimerWheel->advance(nowNanos / mTickInNanos, &expiredIds);
+
+        callbacks.reserve(expiredIds.size());
+        for (uint64_t id : expiredIds) {
+            auto it = mCallbackInfoById.find(static_cast<int>(id));
+            if (it == mCallbackInfoById.end()) {
+                continue;
+            }
+            CallbackInfo* callbackInfo = it->second.get();
+            callbacks.push_back(callbackInfo->callback);
+            advanceNextTimeLocked(callbackInfo, nowNanos);
+            mTimerWheel->add(id, toTick(callbackInfo->nextTimeInNanos));
+        }
+
+        scheduleTimerWheelLocked();
+    }
+
+    for (const auto& callback : callbacks) {
+        (*callback)();
+    }
+}
+
 void RecurrentMessageHandler::handleMessage(const Message& message) {
     mTimer->handleMessage(message);
 }
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+// Returns the offset from 'pos' + 1 to the next set bit in 'bits', wrapping around.
+int nextSetBitAfter(uint64_t bits, int pos) {
+    int shift = (pos + 1) & 63;
+    uint64_t rotated = shift == 0 ? bits : (bits >> shift) | (bits << (64 - shift));
+    return __builtin_ctzll(rotated);
+}
+
+}  // namespace
+
+TimerWheel::TimerWheel(uint64_t currentTick) : mCurrentTick(currentTick) {}
+
+void TimerWheel::add(uint64_t id, uint64_t expiryTick) {
+    remove(id);
+    Timer& timer = mTimers[id];
+    timer.expiryTick = std::max(expiryTick, mCurrentTick + 1);
+    insert(id, &timer);
+}
+
+bool TimerWheel::remove(uint64_t id) {
+    auto it = mTimers.find(id);
+    if (it == mTimers.end()) {
+        return false;
+    }
+    unlink(it->second);
+    mTimers.erase(it);
+    return true;
+}
+
+void TimerWheel::insert(uint64_t id, Timer* timer) {
+    // A timer due at the current tick is only inserted while cascading, right before the level 0
+    // slot for the current tick is expired.
+    uint64_t delta = timer->expiryTick > mCurrentTick ? timer->expiryTick - mCurrentTick : 0;
+    int level = 0;
+    while (level < NUM_LEVELS - 1 && delta >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    uint64_t slotTick = timer->expiryTick;
+    if (delta >= (uint64_t{1} << (SLOT_BITS * NUM_LEVELS))) {
+        // Beyond the range of the wheel, park the timer in the furthest slot of the top level, it
+        // is inserted again when the slot is cascaded.
+        slotTick = mCurrentTick + ((uint64_t{NUM_SLOTS} - 1) << (SLOT_BITS * level));
+    }
+    Level& wheelLevel = mLevels[level];
+    timer->level = level;
+    timer->slot = static_cast<int>((slotTick >> (SLOT_BITS * level)) & SLOT_MASK);
+    std::vector<uint64_t>& slot = wheelLevel.slots[timer->slot];
+    timer->index = slot.size();
+    slot.push_back(id);
+    wheelLevel.occupied |= uint64_t{1} << timer->slot;
+}
+
+void TimerWheel::unlink(const Timer& timer) {
+    Level& wheelLevel = mLevels[timer.level];
+    std::vector<uint64_t>& slot = wheelLevel.slots[timer.slot];
+    // Swap with the last ID in the slot so removal is O(1).
+    uint64_t lastId = slot.back();
+    slot[timer.index] = lastId;
+    mTimers[lastId].index = timer.index;
+    slot.pop_back();
+    if (slot.empty()) {
+        wheelLevel.occupied &= ~(uint64_t{1} << timer.slot);
+    }
+}
+
+void TimerWheel::cascade(int level) {
+    Level& wheelLevel = mLevels[level];
+    int slotIndex = static_cast<int>((mCurrentTick >> (SLOT_BITS * level)) & SLOT_MASK);
+    if ((wheelLevel.occupied & (uint64_t{1} << slotIndex)) == 0) {
+        return;
+    }
+    std::vector<uint64_t> ids;
+    ids.swap(wheelLevel.slots[slotIndex]);
+    wheelLevel.occupied &= ~(uint64_t{1} << slotIndex);
+    for (uint64_t id : ids) {
+        insert(id, &mTimers[id]);
+    }
+}
+
+void TimerWheel::advance(uint64_t tick, std::vector<uint64_t>* expiredIds) {
+    while (mCurrentTick < tick) {
+        std::optional<uint64_t> nextTick = getNextTick();
+        if (!nextTick.has_value() || *nextTick > tick) {
+            // Nothing happens in between, so the wheel can jump directly to 'tick'.
+            mCurrentTick = tick;
+            return;
+        }
+        mCurrentTick = *nextTick;
+        // Cascade from the top so that timers may move down more than one level.
+        for (int level = NUM_LEVELS - 1; level > 0; level--) {
+            if ((mCurrentTick & ((uint64_t{1} << (SLOT_BITS * level)) - 1)) == 0) {
+                cascade(level);
+            }
+        }
+        Level& levelZero = mLevels[0];
+        int slotIndex = static_cast<int>(mCurrentTick & SLOT_MASK);
+        if ((levelZero.occupied & (uint64_t{1} << slotIndex)) == 0) {
+            continue;
+        }
+        std::vector<uint64_t> ids;
+        ids.swap(levelZero.slots[slotIndex]);
+        levelZero.occupied &= ~(uint64_t{1} << slotIndex);
+        for (uint64_t id : ids) {
+            mTimers.erase(id);
+            expiredIds->push_back(id);
+        }
+    }
+}
+
+std::optional<uint64_t> TimerWheel::getNextTick() const {
+    std::optional<uint64_t> nextTick;
+    for (int level = 0; level < NUM_LEVELS; level++) {
+        const Level& wheelLevel = mLevels[level];
+        if (wheelLevel.occupied == 0) {
+            continue;
+        }
+        int shift = SLOT_BITS * level;
+        uint64_t block = mCurrentTick >> shift;
+        int offset = nextSetBitAfter(wheelLevel.occupied, static_cast<int>(block & SLOT_MASK));
+        // The first tick of the next block that maps to an occupied slot.
+        uint64_t tick = (block + 1 + offset) << shift;
+        if (!nextTick.has_value() || tick < *nextTick) {
+            nextTick = tick;
+        }
+    }
+    return nextTick;
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -23,6 +23,9 @@
 #include <assert.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+#include <bit>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -33,6 +36,50 @@ using ::aidl::android::hardware::automotive::vehicle::VehicleProperty;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyType;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
 
+VehiclePropValuePool::VehiclePropValuePool(size_t maxRecyclableVectorSize,
+                                           size_t maxPoolObjectsSize)
+    : mMaxRecyclableVectorSize(maxRecyclableVectorSize),
+      mMaxPoolObjectsSize(maxPoolObjectsSize),
+      mNumSizeClasses(getSizeClass(maxRecyclableVectorSize) + 1),
+      mValueTypePools(
+              std::make_unique<std::atomic<InternalPool*>[]>(NUM_RECYCLABLE_TYPES *
+                                                             mNumSizeClasses)) {}
+
+VehiclePropValuePool::~VehiclePropValuePool() {
+    for (size_t i = 0; i < NUM_RECYCLABLE_TYPES * mNumSizeClasses; i++) {
+        delete mValueTypePools[i].load(std::memory_order_relaxed);
+    }
+}
+
+size_t VehiclePropValuePool::getSizeClass(size_t vectorSize) {
+    if (vectorSize <= 1) {
+        return 0;
+    }
+    return std::bit_width(vectorSize - 1);
+}
+
+size_t VehiclePropValuePool::getTypeIndex(VehiclePropertyType type) {
+    switch (type) {
+        case VehiclePropertyType::BOOLEAN:
+            return 0;
+        case VehiclePropertyType::INT32:
+            return 1;
+        case VehiclePropertyType::INT32_VEC:
+            return 2;
+        case VehiclePropertyType::INT64:
+            return 3;
+        case VehiclePropertyType::INT64_VEC:
+            return 4;
+        case VehiclePropertyType::FLOAT:
+            return 5;
+        case VehiclePropertyType::FLOAT_VEC:
+            return 6;
+        default:
+            assert(type == VehiclePropertyType::BYTES);
+            return 7;
+    }
+}
+
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtain(VehiclePropertyType type) {
     if (isComplexType(type)) {
         return obtain(type, 0);
@@ -96,19 +143,26 @@ VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainComplex() {
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainRecyclable(
         VehiclePropertyType type, size_t vectorSize) {
-    std::scoped_lock<std::mutex> lock(mLock);
     assert(vectorSize > 0);
 
-    // VehiclePropertyType is not overlapping with vectorSize.
-    int32_t key = static_cast<int32_t>(type) | static_cast<int32_t>(vectorSize);
-    auto it = mValueTypePools.find(key);
-
-    if (it == mValueTypePools.end()) {
-        auto newPool(std::make_unique<InternalPool>(type, vectorSize, mMaxPoolObjectsSize,
-                                                    getVehiclePropValueSize));
-        it = mValueTypePools.emplace(key, std::move(newPool)).first;
+    size_t sizeClass = getSizeClass(vectorSize);
+    std::atomic<InternalPool*>& entry =
+            mValueTypePools[getTypeIndex(type) * mNumSizeClasses + sizeClass];
+    InternalPool* pool = entry.load(std::memory_order_acquire);
+    if (pool == nullptr) {
+        size_t minVectorSize = sizeClass == 0 ? 1 : (size_t{1} << (sizeClass - 1)) + 1;
+        size_t maxVectorSize = std::min(size_t{1} << sizeClass, mMaxRecyclableVectorSize);
+        InternalPool* newPool = new InternalPool(type, minVectorSize, maxVectorSize,
+                                                 mMaxPoolObjectsSize, getVehiclePropValueSize);
+        if (entry.compare_exchange_strong(pool, newPool, std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+            pool = newPool;
+        } else {
+            // Another thread created the pool first, 'pool' now points to it.
+            delete newPool;
+        }
     }
-    return it->second->obtain();
+    return pool->obtain(vectorSize);
 }
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainBoolean(bool value) {
@@ -121,6 +175,25 @@ VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainDisposable(
                           mDisposableDeleter};
 }
 
+VehiclePropValuePool::RecyclableType VehiclePropValuePool::InternalPool::obtain(
+        size_t vectorSize) {
+    RecyclableType o = ObjectPool<VehiclePropValue>::obtain();
+    // Shrinking or growing within the size class never reallocates.
+    RawPropValues* v = &o->value;
+    resize(&v->int32Values, (VehiclePropertyType::INT32_VEC == mPropType ||
+                             VehiclePropertyType::INT32 == mPropType ||
+                             VehiclePropertyType::BOOLEAN == mPropType),
+           vectorSize);
+    resize(&v->floatValues, (VehiclePropertyType::FLOAT == mPropType ||
+                             VehiclePropertyType::FLOAT_VEC == mPropType),
+           vectorSize);
+    resize(&v->int64Values, (VehiclePropertyType::INT64 == mPropType ||
+                             VehiclePropertyType::INT64_VEC == mPropType),
+           vectorSize);
+    resize(&v->byteValues, VehiclePropertyType::BYTES == mPropType, vectorSize);
+    return o;
+}
+
 void VehiclePropValuePool::InternalPool::recycle(VehiclePropValue* o) {
     if (o == nullptr) {
         ALOGE("Attempt to recycle nullptr");
@@ -130,8 +203,8 @@ void VehiclePropValuePool::InternalPool::recycle(VehiclePropValue* o) {
     if (!check(&o->value)) {
         ALOGE("Discarding value for prop 0x%x because it contains "
               "data that is not consistent with this pool. "
-              "Expected type: %d, vector size: %zu",
-              o->prop, toInt(mPropType), mVectorSize);
+              "Expected type: %d, vector size: [%zu, %zu]",
+              o->prop, toInt(mPropType), mMinVectorSize, mMaxVectorSize);
         delete o;
     } else {
         ObjectPool<VehiclePropValue>::recycle(o);
@@ -151,7 +224,7 @@ bool VehiclePropValuePool::InternalPool::check(RawPropValues* v) {
 }
 
 VehiclePropValue* VehiclePropValuePool::InternalPool::createObject() {
-    return createVehiclePropValueVec(mPropType, mVectorSize).release();
+    return createVehiclePropValueVec(mPropType, mMaxVectorSize).release();
 }
 
 }  // namespace vehicle
@@ -55,29 +55,63 @@ size_t VehiclePropertyStore::RecordIdHash::operator()(RecordId const& recordId)
     return res;
 }
 
+VehiclePropertyStore::RecordsLockGuard::RecordsLockGuard(const VehiclePropertyStore& store)
+        NO_THREAD_SAFETY_ANALYSIS : mStore(store) {
+    if (mStore.mLockMode == LockMode::GLOBAL) {
+        mStore.mLock.lock();
+    } else {
+        mStore.mLock.lock_shared();
+    }
+}
+
+VehiclePropertyStore::RecordsLockGuard::~RecordsLockGuard() NO_THREAD_SAFETY_ANALYSIS {
+    if (mStore.mLockMode == LockMode::GLOBAL) {
+        mStore.mLock.unlock();
+    } else {
+        mStore.mLock.unlock_shared();
+    }
+}
+
+VehiclePropertyStore::ShardLockGuard::ShardLockGuard(const VehiclePropertyStore& store,
+                                                     int32_t propId, bool exclusive)
+    : mExclusive(exclusive) {
+    if (store.mLockMode == LockMode::GLOBAL) {
+        return;
+    }
+    mShardLock = &store.mShardLocks[static_cast<uint32_t>(propId) & (kNumShards - 1)];
+    if (mExclusive) {
+        mShardLock->lock();
+    } else {
+        mShardLock->lock_shared();
+    }
+}
+
+VehiclePropertyStore::ShardLockGuard::~ShardLockGuard() {
+    if (mShardLock == nullptr) {
+        return;
+    }
+    if (mExclusive) {
+        mShardLock->unlock();
+    } else {
+        mShardLock->unlock_shared();
+    }
+}
+
 VehiclePropertyStore::~VehiclePropertyStore() {
-    std::scoped_lock<std::mutex> lockGuard(mLock);
+    std::scoped_lock<std::shared_mutex> lockGuard(mLock);
 
     // Recycling record requires mValuePool, so need to recycle them before destroying mValuePool.
     mRecordsByPropId.clear();
     mValuePool.reset();
 }
 
-const VehiclePropertyStore::Record* VehiclePropertyStore::getRecordLocked(int32_t propId) const
-        REQUIRES(mLock) {
-    auto RecordIt = mRecordsByPropId.find(propId);
-    return RecordIt == mRecordsByPropId.end() ? nullptr : &RecordIt->second;
-}
-
-VehiclePropertyStore::Record* VehiclePropertyStore::getRecordLocked(int32_t propId)
-        REQUIRES(mLock) {
+const VehiclePropertyStore::Record* VehiclePropertyStore::getRecordLocked(int32_t propId) const {
     auto RecordIt = mRecordsByPropId.find(propId);
     return RecordIt == mRecordsByPropId.end() ? nullptr : &RecordIt->second;
 }
 
 VehiclePropertyStore::RecordId VehiclePropertyStore::getRecordIdLocked(
-        const VehiclePropValue& propValue, const VehiclePropertyStore::Record& record) const
-        REQUIRES(mLock) {
+        const VehiclePropValue& propValue, const VehiclePropertyStore::Record& record) const {
     VehiclePropertyStore::RecordId recId{
             .area = isGlobalProp(propValue.prop) ? 0 : propValue.areaId, .token = 0};
 
@@ -88,7 +122,7 @@ VehiclePropertyStore::RecordId VehiclePropertyStore::getRecordIdLocked(
 }
 
 VhalResult<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readValueLocked(
-        const RecordId& recId, const Record& record) const REQUIRES(mLock) {
+        const RecordId& recId, const Record& record) const {
     if (auto it = record.values.find(recId); it != record.values.end()) {
         return mValuePool->obtain(*(it->second));
     }
@@ -98,7 +132,7 @@ VhalResult<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readValue
 
 void VehiclePropertyStore::registerProperty(const VehiclePropConfig& config,
                                             VehiclePropertyStore::TokenFunction tokenFunc) {
-    std::scoped_lock<std::mutex> g(mLock);
+    std::scoped_lock<std::shared_mutex> g(mLock);
 
     mRecordsByPropId[config.prop] = Record{
             .propConfig = config,
@@ -117,7 +151,11 @@ VhalResult<void> VehiclePropertyStore::writeValue(VehiclePropValuePool::Recyclab
     int32_t propId;
     int32_t areaId;
     {
-        std::scoped_lock<std::mutex> g(mLock);
+        propId = propValue->prop;
+        areaId = propValue->areaId;
+
+        RecordsLockGuard g(*this);
+        ShardLockGuard shardGuard(*this, propId, /*exclusive=*/true);
 
         // Must set timestamp inside the lock to make sure no other writeValue will update the
         // the timestamp to a newer one while we are writing this value.
@@ -125,10 +163,7 @@ VhalResult<void> VehiclePropertyStore::writeValue(VehiclePropValuePool::Recyclab
             propValue->timestamp = elapsedRealtimeNano();
         }
 
-        propId = propValue->prop;
-        areaId = propValue->areaId;
-
-        VehiclePropertyStore::Record* record = getRecordLocked(propId);
+        const VehiclePropertyStore::Record* record = getRecordLocked(propId);
         if (record == nullptr) {
             return StatusError(StatusCode::INVALID_ARG)
                    << "property: " << propId << " not registered";
@@ -203,7 +238,7 @@ void VehiclePropertyStore::refreshTimestamps(
     OnValuesChangeCallback onValuesChangeCallback = nullptr;
     OnValueChangeCallback onValueChangeCallback = nullptr;
     {
-        std::scoped_lock<std::mutex> g(mLock);
+        RecordsLockGuard g(*this);
 
         onValuesChangeCallback = mOnValuesChangeCallback;
         onValueChangeCallback = mOnValueChangeCallback;
@@ -211,7 +246,8 @@ void VehiclePropertyStore::refreshTimestamps(
         for (const auto& [propIdAreaId, eventMode] : eventModeByPropIdAreaId) {
             int32_t propId = propIdAreaId.propId;
             int32_t areaId = propIdAreaId.areaId;
-            VehiclePropertyStore::Record* record = getRecordLocked(propId);
+            ShardLockGuard shardGuard(*this, propId, /*exclusive=*/true);
+            const VehiclePropertyStore::Record* record = getRecordLocked(propId);
             if (record == nullptr) {
                 continue;
             }
@@ -258,9 +294,10 @@ void VehiclePropertyStore::refreshTimestamps(
 }
 
 void VehiclePropertyStore::removeValue(const VehiclePropValue& propValue) {
-    std::scoped_lock<std::mutex> g(mLock);
+    RecordsLockGuard g(*this);
+    ShardLockGuard shardGuard(*this, propValue.prop, /*exclusive=*/true);
 
-    VehiclePropertyStore::Record* record = getRecordLocked(propValue.prop);
+    const VehiclePropertyStore::Record* record = getRecordLocked(propValue.prop);
     if (record == nullptr) {
         return;
     }
@@ -272,9 +309,10 @@ void VehiclePropertyStore::removeValue(const VehiclePropValue& propValue) {
 }
 
 void VehiclePropertyStore::removeValuesForProperty(int32_t propId) {
-    std::scoped_lock<std::mutex> g(mLock);
+    RecordsLockGuard g(*this);
+    ShardLockGuard shardGuard(*this, propId, /*exclusive=*/true);
 
-    VehiclePropertyStore::Record* record = getRecordLocked(propId);
+    const VehiclePropertyStore::Record* record = getRecordLocked(propId);
     if (record == nullptr) {
         return;
     }
@@ -283,11 +321,12 @@ void VehiclePropertyStore::removeValuesForProperty(int32_t propId) {
 }
 
 std::vector<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readAllValues() const {
-    std::scoped_lock<std::mutex> g(mLock);
+    RecordsLockGuard g(*this);
 
     std::vector<VehiclePropValuePool::RecyclableType> allValues;
 
-    for (auto const& [_, record] : mRecordsByPropId) {
+    for (auto const& [propId, record] : mRecordsByPropId) {
+        ShardLockGuard shardGuard(*this, propId, /*exclusive=*/false);
         for (auto const& [_, value] : record.values) {
             allValues.push_back(mValuePool->obtain(*value));
         }
@@ -298,7 +337,8 @@ std::vector<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readAllV
 
 VehiclePropertyStore::ValuesResultType VehiclePropertyStore::readValuesForProperty(
         int32_t propId) const {
-    std::scoped_lock<std::mutex> g(mLock);
+    RecordsLockGuard g(*this);
+    ShardLockGuard shardGuard(*this, propId, /*exclusive=*/false);
 
     std::vector<VehiclePropValuePool::RecyclableType> values;
 
@@ -315,9 +355,11 @@ VehiclePropertyStore::ValuesResultType VehiclePropertyStore::readValuesForProper
 
 VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(
         const VehiclePropValue& propValue) const {
-    std::scoped_lock<std::mutex> g(mLock);
-
     int32_t propId = propValue.prop;
+
+    RecordsLockGuard g(*this);
+    ShardLockGuard shardGuard(*this, propId, /*exclusive=*/false);
+
     const VehiclePropertyStore::Record* record = getRecordLocked(propId);
     if (record == nullptr) {
         return StatusError(StatusCode::INVALID_ARG) << "property: " << propId << " not registered";
@@ -330,7 +372,8 @@ VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(
 VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(int32_t propId,
                                                                       int32_t areaId,
                                                                       int64_t token) const {
-    std::scoped_lock<std::mutex> g(mLock);
+    RecordsLockGuard g(*this);
+    ShardLockGuard shardGuard(*this, propId, /*exclusive=*/false);
 
     const VehiclePropertyStore::Record* record = getRecordLocked(propId);
     if (record == nullptr) {
@@ -342,7 +385,7 @@ VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(int32_t pr
 }
 
 std::vector<VehiclePropConfig> VehiclePropertyStore::getAllConfigs() const {
-    std::scoped_lock<std::mutex> g(mLock);
+    RecordsLockGuard g(*this);
 
     std::vector<VehiclePropConfig> configs;
     configs.reserve(mRecordsByPropId.size());
@@ -353,7 +396,7 @@ std::vector<VehiclePropConfig> VehiclePropertyStore::getAllConfigs() const {
 }
 
 VhalResult<const VehiclePropConfig*> VehiclePropertyStore::getConfig(int32_t propId) const {
-    std::scoped_lock<std::mutex> g(mLock);
+    RecordsLockGuard g(*this);
 
     const VehiclePropertyStore::Record* record = getRecordLocked(propId);
     if (record == nullptr) {
@@ -364,7 +407,7 @@ VhalResult<const VehiclePropConfig*> VehiclePropertyStore::getConfig(int32_t pro
 }
 
 VhalResult<VehiclePropConfig> VehiclePropertyStore::getPropConfig(int32_t propId) const {
-    std::scoped_lock<std::mutex> g(mLock);
+    RecordsLockGuard g(*this);
 
     const VehiclePropertyStore::Record* record = getRecordLocked(propId);
     if (record == nullptr) {
@@ -376,14 +419,14 @@ VhalResult<VehiclePropConfig> VehiclePropertyStore::getPropConfig(int32_t propId
 
 void VehiclePropertyStore::setOnValueChangeCallback(
         const VehiclePropertyStore::OnValueChangeCallback& callback) {
-    std::scoped_lock<std::mutex> g(mLock);
+    std::scoped_lock<std::shared_mutex> g(mLock);
 
     mOnValueChangeCallback = callback;
 }
 
 void VehiclePropertyStore::setOnValuesChangeCallback(
         const VehiclePropertyStore::OnValuesChangeCallback& callback) {
-    std::scoped_lock<std::mutex> g(mLock);
+    std::scoped_lock<std::shared_mutex> g(mLock);
 
     mOnValuesChangeCallback = callback;
 }
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AtomicHistogram.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+TEST(AtomicHistogramTest, testGetBucketIndex) {
+    ASSERT_EQ(AtomicHistogram::getBucketIndex(-1), 0u);
+    ASSERT_EQ(AtomicHistogram::getBucketIndex(0), 0u);
+    ASSERT_EQ(AtomicHistogram::getBucketIndex(1), 1u);
+    ASSERT_EQ(AtomicHistogram::getBucketIndex(2), 2u);
+    ASSERT_EQ(AtomicHistogram::getBucketIndex(3), 2u);
+    ASSERT_EQ(AtomicHistogram::getBucketIndex(4), 3u);
+    ASSERT_EQ(AtomicHistogram::getBucketIndex(1023), 10u);
+    ASSERT_EQ(AtomicHistogram::getBucketIndex(1024), 11u);
+    ASSERT_EQ(AtomicHistogram::getBucketIndex(std::numeric_limits<int64_t>::max()),
+              AtomicHistogram::NUM_BUCKETS - 1);
+}
+
+TEST(AtomicHistogramTest, testGetBucketUpperBound) {
+    ASSERT_EQ(AtomicHistogram::getBucketUpperBound(0), 0);
+    ASSERT_EQ(AtomicHistogram::getBucketUpperBound(1), 1);
+    ASSERT_EQ(AtomicHistogram::getBucketUpperBound(2), 3);
+    ASSERT_EQ(AtomicHistogram::getBucketUpperBound(11), 2047);
+    ASSERT_EQ(AtomicHistogram::getBucketUpperBound(AtomicHistogram::NUM_BUCKETS - 1),
+              std::numeric_limits<int64_t>::max());
+}
+
+TEST(AtomicHistogramTest, testRecord) {
+    AtomicHistogram histogram;
+
+    histogram.record(1);
+    histogram.record(5);
+    histogram.record(6);
+    histogram.record(100);
+
+    AtomicHistogram::Snapshot snapshot = histogram.getSnapshot();
+
+    ASSERT_EQ(snapshot.count, 4u);
+    ASSERT_EQ(snapshot.sum, 112);
+    ASSERT_EQ(snapshot.max, 100);
+    ASSERT_EQ(snapshot.getMean(), 28);
+    ASSERT_EQ(snapshot.bucketCounts[1], 1u);
+    ASSERT_EQ(snapshot.bucketCounts[3], 2u);
+    ASSERT_EQ(snapshot.bucketCounts[7], 1u);
+}
+
+TEST(AtomicHistogramTest, testGetPercentile) {
+    AtomicHistogram histogram;
+
+    for (int i = 0; i < 99; i++) {
+        histogram.record(10);
+    }
+    histogram.record(1000);
+
+    AtomicHistogram::Snapshot snapshot = histogram.getSnapshot();
+
+    // 10 is in bucket [8, 15].
+    ASSERT_EQ(snapshot.getPercentile(50), 15);
+    ASSERT_EQ(snapshot.getPercentile(99), 15);
+    // Capped at the max recorded value.
+    ASSERT_EQ(snapshot.getPercentile(100), 1000);
+}
+
+TEST(AtomicHistogramTest, testEmpty) {
+    AtomicHistogram histogram;
+
+    AtomicHistogram::Snapshot snapshot = histogram.getSnapshot();
+
+    ASSERT_EQ(snapshot.count, 0u);
+    ASSERT_EQ(snapshot.getMean(), 0);
+    ASSERT_EQ(snapshot.getPercentile(50), 0);
+}
+
+TEST(AtomicHistogramTest, testReset) {
+    AtomicHistogram histogram;
+    histogram.record(10);
+
+    histogram.reset();
+
+    AtomicHistogram::Snapshot snapshot = histogram.getSnapshot();
+    ASSERT_EQ(snapshot.count, 0u);
+    ASSERT_EQ(snapshot.sum, 0);
+    ASSERT_EQ(snapshot.max, 0);
+    ASSERT_EQ(snapshot.bucketCounts[4], 0u);
+}
+
+TEST(AtomicHistogramTest, testConcurrentRecord) {
+    AtomicHistogram histogram;
+    constexpr int threadCount = 8;
+    constexpr int recordCount = 10000;
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back([&histogram, i] {
+            for (int j = 0; j < recordCount; j++) {
+                histogram.record(i + 1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    AtomicHistogram::Snapshot snapshot = histogram.getSnapshot();
+    ASSERT_EQ(snapshot.count, static_cast<uint64_t>(threadCount * recordCount));
+    ASSERT_EQ(snapshot.sum, static_cast<int64_t>(recordCount * threadCount * (threadCount + 1) / 2));
+    ASSERT_EQ(snapshot.max, threadCount);
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -31,7 +31,7 @@ namespace vehicle {
 
 using ::android::base::ScopedLockAssertion;
 
-class RecurrentTimerTest : public testing::Test {
+class RecurrentTimerTest : public testing::TestWithParam<RecurrentTimer::Backend> {
   public:
     std::shared_ptr<RecurrentTimer::Callback> getCallback(size_t token) {
         return std::make_shared<RecurrentTimer::Callback>([this, token] {
@@ -76,8 +76,8 @@ class RecurrentTimerTest : public testing::Test {
     std::vector<size_t> mCallbacks GUARDED_BY(mLock);
 };
 
-TEST_F(RecurrentTimerTest, testRegisterCallback) {
-    RecurrentTimer timer;
+TEST_P(RecurrentTimerTest, testRegisterCallback) {
+    RecurrentTimer timer(GetParam());
     // 0.1s
     int64_t interval = 100000000;
 
@@ -91,8 +91,8 @@ TEST_F(RecurrentTimerTest, testRegisterCallback) {
     timer.unregisterTimerCallback(action);
 }
 
-TEST_F(RecurrentTimerTest, testRegisterUnregisterRegister) {
-    RecurrentTimer timer;
+TEST_P(RecurrentTimerTest, testRegisterUnregisterRegister) {
+    RecurrentTimer timer(GetParam());
     // 0.1s
     int64_t interval = 100000000;
 
@@ -119,8 +119,8 @@ TEST_F(RecurrentTimerTest, testRegisterUnregisterRegister) {
     ASSERT_EQ(countIdByCallback(&timer), 0u);
 }
 
-TEST_F(RecurrentTimerTest, testDestroyTimerWithCallback) {
-    std::unique_ptr<RecurrentTimer> timer = std::make_unique<RecurrentTimer>();
+TEST_P(RecurrentTimerTest, testDestroyTimerWithCallback) {
+    std::unique_ptr<RecurrentTimer> timer = std::make_unique<RecurrentTimer>(GetParam());
     // 0.1s
     int64_t interval = 100000000;
 
@@ -140,8 +140,8 @@ TEST_F(RecurrentTimerTest, testDestroyTimerWithCallback) {
     ASSERT_LE(getCalledCallbacks().size(), 1u);
 }
 
-TEST_F(RecurrentTimerTest, testRegisterMultipleCallbacks) {
-    RecurrentTimer timer;
+TEST_P(RecurrentTimerTest, testRegisterMultipleCallbacks) {
+    RecurrentTimer timer(GetParam());
     // 0.1s
     int64_t interval1 = 100000000;
     auto action1 = getCallback(1);
@@ -185,8 +185,8 @@ TEST_F(RecurrentTimerTest, testRegisterMultipleCallbacks) {
     ASSERT_GE(action3Count, static_cast<size_t>(33));
 }
 
-TEST_F(RecurrentTimerTest, testRegisterSameCallbackMultipleTimes) {
-    RecurrentTimer timer;
+TEST_P(RecurrentTimerTest, testRegisterSameCallbackMultipleTimes) {
+    RecurrentTimer timer(GetParam());
     // 0.2s
     int64_t interval1 = 200'000'000;
     // 0.1s
@@ -210,7 +210,7 @@ TEST_F(RecurrentTimerTest, testRegisterSameCallbackMultipleTimes) {
     ASSERT_EQ(countIdByCallback(&timer), 0u);
 }
 
-TEST_F(RecurrentTimerTest, testRegisterCallbackMultipleTimesNoDeadLock) {
+TEST_P(RecurrentTimerTest, testRegisterCallbackMultipleTimesNoDeadLock) {
     // We want to avoid the following situation:
     // Caller holds a lock while calling registerTimerCallback, registerTimerCallback will try
     // to obtain an internal lock inside timer.
@@ -218,7 +218,7 @@ TEST_F(RecurrentTimerTest, testRegisterCallbackMultipleTimesNoDeadLock) {
     // tries to obtain the lock currently hold by the caller.
     // The solution is that while calling recurrent actions, timer must not hold the internal lock.
 
-    std::unique_ptr<RecurrentTimer> timer = std::make_unique<RecurrentTimer>();
+    std::unique_ptr<RecurrentTimer> timer = std::make_unique<RecurrentTimer>(GetParam());
     std::mutex lock;
     for (size_t i = 0; i < 1000; i++) {
         std::scoped_lock<std::mutex> lockGuard(lock);
@@ -237,6 +237,44 @@ TEST_F(RecurrentTimerTest, testRegisterCallbackMultipleTimesNoDeadLock) {
     timer.reset();
 }
 
+TEST_P(RecurrentTimerTest, testDriftStats) {
+    RecurrentTimer timer(GetParam());
+    // 10ms
+    int64_t interval = 10'000'000;
+    std::vector<std::shared_ptr<RecurrentTimer::Callback>> actions;
+    for (size_t i = 0; i < 10; i++) {
+        actions.push_back(getCallback(i));
+        timer.registerTimerCallback(interval, actions.back());
+    }
+
+    // Should only takes 0.1s, use 5s as timeout to be safe.
+    ASSERT_TRUE(waitForCalledCallbacks(/* count= */ 100u, /* timeoutInMs= */ 5000))
+            << "Not enough callbacks called before timeout";
+
+    for (const auto& action : actions) {
+        timer.unregisterTimerCallback(action);
+    }
+
+    RecurrentTimer::DriftStats stats = timer.getDriftStats();
+
+    ASSERT_GE(stats.callbackCount, 100);
+    ASSERT_GE(stats.maxDriftInNanos, 0);
+    if (GetParam() == RecurrentTimer::Backend::TIMER_WHEEL) {
+        // All the callbacks have the same interval so they must share wakeups.
+        ASSERT_LT(stats.wakeUpCount, stats.callbackCount);
+    } else {
+        ASSERT_EQ(stats.wakeUpCount, stats.callbackCount);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, RecurrentTimerTest,
+                         testing::Values(RecurrentTimer::Backend::LOOPER,
+                                         RecurrentTimer::Backend::TIMER_WHEEL),
+                         [](const testing::TestParamInfo<RecurrentTimer::Backend>& info) {
+                             return info.param == RecurrentTimer::Backend::LOOPER ? "Looper"
+                                                                                   : "TimerWheel";
+                         });
+
 }  // namespace vehicle
 }  // namespace automotive
 }  // namespace hardware
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TimerWheel.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+}  // namespace
+
+TEST(TimerWheelTest, testExpireAtTick) {
+    TimerWheel wheel(/*currentTick=*/100);
+    std::vector<uint64_t> expiredIds;
+
+    wheel.add(/*id=*/1, /*expiryTick=*/110);
+
+    ASSERT_EQ(wheel.getNextTick(), 110u);
+
+    wheel.advance(109, &expiredIds);
+
+    ASSERT_THAT(expiredIds, IsEmpty());
+
+    wheel.advance(110, &expiredIds);
+
+    ASSERT_THAT(expiredIds, ElementsAre(1u));
+    ASSERT_EQ(wheel.size(), 0u);
+    ASSERT_EQ(wheel.getNextTick(), std::nullopt);
+}
+
+TEST(TimerWheelTest, testExpireSameTickTogether) {
+    TimerWheel wheel(/*currentTick=*/0);
+    std::vector<uint64_t> expiredIds;
+
+    wheel.add(/*id=*/1, /*expiryTick=*/5000);
+    wheel.add(/*id=*/2, /*expiryTick=*/5000);
+    wheel.add(/*id=*/3, /*expiryTick=*/5001);
+
+    wheel.advance(5000, &expiredIds);
+
+    ASSERT_THAT(expiredIds, UnorderedElementsAre(1u, 2u));
+}
+
+TEST(TimerWheelTest, testExpiryInThePast) {
+    TimerWheel wheel(/*currentTick=*/100);
+    std::vector<uint64_t> expiredIds;
+
+    wheel.add(/*id=*/1, /*expiryTick=*/50);
+    wheel.advance(101, &expiredIds);
+
+    ASSERT_THAT(expiredIds, ElementsAre(1u));
+}
+
+TEST(TimerWheelTest, testExpiryBeyondWheelRange) {
+    TimerWheel wheel(/*currentTick=*/0);
+    std::vector<uint64_t> expiredIds;
+    uint64_t expiryTick = uint64_t{1} << 30;
+
+    wheel.add(/*id=*/1, expiryTick);
+    wheel.advance(expiryTick - 1, &expiredIds);
+
+    ASSERT_THAT(expiredIds, IsEmpty());
+
+    wheel.advance(expiryTick, &expiredIds);
+
+    ASSERT_THAT(expiredIds, ElementsAre(1u));
+}
+
+TEST(TimerWheelTest, testRemove) {
+    TimerWheel wheel(/*currentTick=*/0);
+    std::vector<uint64_t> expiredIds;
+
+    wheel.add(/*id=*/1, /*expiryTick=*/10);
+    wheel.add(/*id=*/2, /*expiryTick=*/10);
+
+    ASSERT_TRUE(wheel.remove(1));
+    ASSERT_FALSE(wheel.remove(1));
+
+    wheel.advance(10, &expiredIds);
+
+    ASSERT_THAT(expiredIds, ElementsAre(2u));
+}
+
+TEST(TimerWheelTest, testAddReplacesExpiryTick) {
+    TimerWheel wheel(/*currentTick=*/0);
+    std::vector<uint64_t> expiredIds;
+
+    wheel.add(/*id=*/1, /*expiryTick=*/10);
+    wheel.add(/*id=*/1, /*expiryTick=*/20);
+    wheel.advance(10, &expiredIds);
+
+    ASSERT_THAT(expiredIds, IsEmpty());
+
+    wheel.advance(20, &expiredIds);
+
+    ASSERT_THAT(expiredIds, ElementsAre(1u));
+}
+
+TEST(TimerWheelTest, testRandomTimersExpireAtTheirTick) {
+    std::mt19937_64 random(/*seed=*/1234);
+    std::uniform_int_distribution<uint64_t> delayDist(1, 1'000'000);
+    std::uniform_int_distribution<uint64_t> stepDist(1, 5000);
+    TimerWheel wheel(/*currentTick=*/12345);
+    std::map<uint64_t, uint64_t> expiryTickById;
+
+    for (uint64_t id = 0; id < 2000; id++) {
+        uint64_t expiryTick = wheel.getCurrentTick() + delayDist(random);
+        wheel.add(id, expiryTick);
+        expiryTickById[id] = expiryTick;
+    }
+
+    while (!expiryTickById.empty()) {
+        uint64_t tick = wheel.getCurrentTick() + stepDist(random);
+        std::vector<uint64_t> expiredIds;
+        wheel.advance(tick, &expiredIds);
+        for (uint64_t id : expiredIds) {
+            ASSERT_LE(expiryTickById[id], tick) << "timer " << id << " expired too early";
+            expiryTickById.erase(id);
+        }
+        for (const auto& [id, expiryTick] : expiryTickById) {
+            ASSERT_GT(expiryTick, tick) << "timer " << id << " did not expire in time";
+        }
+    }
+    ASSERT_EQ(wheel.size(), 0u);
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -137,6 +137,8 @@ class VehicleObjectPoolTest : public ::testing::Test {
         mStats->Created = 0;
         mStats->Recycled = 0;
         mStats->Deleted = 0;
+        mStats->MagazineHit = 0;
+        mStats->MagazineMiss = 0;
     }
 };
 
@@ -375,6 +377,83 @@ TEST_F(VehicleObjectPoolTest, testMultithreaded) {
     ASSERT_LE(mStats->Created, static_cast<uint32_t>(T * O));
 }
 
+TEST_F(VehicleObjectPoolTest, testMagazineHit) {
+    mValuePool->obtain(VehiclePropertyType::INT32);
+    mValuePool->obtain(VehiclePropertyType::INT32);
+
+    // The first obtain finds the magazine empty, the second gets the recycled object from it.
+    ASSERT_EQ(mStats->MagazineMiss, 1u);
+    ASSERT_EQ(mStats->MagazineHit, 1u);
+}
+
+TEST_F(VehicleObjectPoolTest, testGetSizeClass) {
+    ASSERT_EQ(VehiclePropValuePool::getSizeClass(1), 0u);
+    ASSERT_EQ(VehiclePropValuePool::getSizeClass(2), 1u);
+    ASSERT_EQ(VehiclePropValuePool::getSizeClass(3), 2u);
+    ASSERT_EQ(VehiclePropValuePool::getSizeClass(4), 2u);
+    ASSERT_EQ(VehiclePropValuePool::getSizeClass(5), 3u);
+    ASSERT_EQ(VehiclePropValuePool::getSizeClass(8), 3u);
+}
+
+TEST_F(VehicleObjectPoolTest, testSizeClassReuse) {
+    auto value = mValuePool->obtain(VehiclePropertyType::INT32_VEC, 3);
+    void* raw = value.get();
+    value.reset();
+
+    // 3 and 4 are in the same size class.
+    value = mValuePool->obtain(VehiclePropertyType::INT32_VEC, 4);
+
+    ASSERT_EQ(value.get(), raw);
+    ASSERT_EQ(value->value.int32Values.size(), 4u);
+
+    value.reset();
+    value = mValuePool->obtain(VehiclePropertyType::INT32_VEC, 3);
+
+    ASSERT_EQ(value.get(), raw);
+    ASSERT_EQ(value->value.int32Values.size(), 3u);
+    // 2 is in a different size class.
+    ASSERT_NE(mValuePool->obtain(VehiclePropertyType::INT32_VEC, 2).get(), raw);
+    ASSERT_EQ(mStats->Created, 2u);
+}
+
+TEST_F(VehicleObjectPoolTest, testThreadExitReturnsObjects) {
+    const size_t count = ObjectPool<VehiclePropValue>::kMagazineCapacity + 4;
+
+    std::thread t([this, count] {
+        std::vector<recyclable_ptr<VehiclePropValue>> vec;
+        for (size_t i = 0; i < count; i++) {
+            vec.push_back(mValuePool->obtain(VehiclePropertyType::INT32));
+        }
+    });
+    t.join();
+
+    // The objects cached by the exited thread are back in the shared pool.
+    std::vector<recyclable_ptr<VehiclePropValue>> vec;
+    for (size_t i = 0; i < count; i++) {
+        vec.push_back(mValuePool->obtain(VehiclePropertyType::INT32));
+    }
+
+    ASSERT_EQ(mStats->Created, count);
+}
+
+TEST_F(VehicleObjectPoolTest, testMagazineCountedInMemoryLimitation) {
+    const size_t count = 4;
+    auto value = mValuePool->obtain(VehiclePropertyType::INT32);
+    VehiclePropValuePool pool(/*maxRecyclableVectorSize=*/4,
+                              /*maxPoolObjectsSize=*/count * getVehiclePropValueSize(*value));
+    value.reset();
+
+    std::vector<recyclable_ptr<VehiclePropValue>> vec;
+    for (size_t i = 0; i < count * 2; i++) {
+        vec.push_back(pool.obtain(VehiclePropertyType::INT32));
+    }
+    // The magazine has room for all of them, but the pool only for 'count'.
+    vec.clear();
+
+    ASSERT_EQ(mStats->Recycled, count + 1);
+    ASSERT_EQ(mStats->Deleted, count);
+}
+
 TEST_F(VehicleObjectPoolTest, testMemoryLimitation) {
     std::vector<recyclable_ptr<VehiclePropValue>> vec;
     for (size_t i = 0; i < 10000; i++) {
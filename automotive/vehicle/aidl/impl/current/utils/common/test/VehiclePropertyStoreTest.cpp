@@ -22,6 +22,8 @@
 #include <gtest/gtest.h>
 #include <utils/SystemClock.h>
 
+#include <thread>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -68,7 +70,8 @@ std::vector<VehiclePropValue> convertValuePtrsToValues(
 
 }  // namespace
 
-class VehiclePropertyStoreTest : public ::testing::Test {
+class VehiclePropertyStoreTest
+    : public ::testing::TestWithParam<VehiclePropertyStore::LockMode> {
   protected:
     void SetUp() override {
         mConfigFuelCapacity = {
@@ -86,7 +89,7 @@ class VehiclePropertyStoreTest : public ::testing::Test {
                                 VehicleAreaConfig{.areaId = WHEEL_REAR_RIGHT}},
         };
         mValuePool = std::make_shared<VehiclePropValuePool>();
-        mStore.reset(new VehiclePropertyStore(mValuePool));
+        mStore.reset(new VehiclePropertyStore(mValuePool, GetParam()));
         mStore->registerProperty(mConfigFuelCapacity);
         mStore->registerProperty(configTirePressure);
     }
@@ -96,13 +99,13 @@ class VehiclePropertyStoreTest : public ::testing::Test {
     std::unique_ptr<VehiclePropertyStore> mStore;
 };
 
-TEST_F(VehiclePropertyStoreTest, testGetAllConfigs) {
+TEST_P(VehiclePropertyStoreTest, testGetAllConfigs) {
     std::vector<VehiclePropConfig> configs = mStore->getAllConfigs();
 
     ASSERT_EQ(configs.size(), static_cast<size_t>(2));
 }
 
-TEST_F(VehiclePropertyStoreTest, testGetPropConfig) {
+TEST_P(VehiclePropertyStoreTest, testGetPropConfig) {
     VhalResult<VehiclePropConfig> result =
             mStore->getPropConfig(toInt(VehicleProperty::INFO_FUEL_CAPACITY));
 
@@ -110,7 +113,7 @@ TEST_F(VehiclePropertyStoreTest, testGetPropConfig) {
     ASSERT_EQ(result.value(), mConfigFuelCapacity);
 }
 
-TEST_F(VehiclePropertyStoreTest, testGetPropConfigWithInvalidPropId) {
+TEST_P(VehiclePropertyStoreTest, testGetPropConfigWithInvalidPropId) {
     VhalResult<VehiclePropConfig> result = mStore->getPropConfig(INVALID_PROP_ID);
 
     EXPECT_FALSE(result.ok()) << "expect error when getting a config for an invalid property ID";
@@ -138,13 +141,13 @@ std::vector<VehiclePropValue> getTestPropValues() {
     return {fuelCapacity, leftTirePressure, rightTirePressure};
 }
 
-TEST_F(VehiclePropertyStoreTest, testWriteValueOk) {
+TEST_P(VehiclePropertyStoreTest, testWriteValueOk) {
     auto values = getTestPropValues();
 
     ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(values[0])));
 }
 
-TEST_F(VehiclePropertyStoreTest, testReadAllValues) {
+TEST_P(VehiclePropertyStoreTest, testReadAllValues) {
     auto values = getTestPropValues();
     for (const auto& value : values) {
         ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(value)));
@@ -155,7 +158,7 @@ TEST_F(VehiclePropertyStoreTest, testReadAllValues) {
     ASSERT_THAT(convertValuePtrsToValues(gotValues), WhenSortedBy(propValueCmp, Eq(values)));
 }
 
-TEST_F(VehiclePropertyStoreTest, testReadValuesForPropertyOneValue) {
+TEST_P(VehiclePropertyStoreTest, testReadValuesForPropertyOneValue) {
     auto values = getTestPropValues();
     for (const auto& value : values) {
         ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(value)));
@@ -167,7 +170,7 @@ TEST_F(VehiclePropertyStoreTest, testReadValuesForPropertyOneValue) {
     ASSERT_THAT(convertValuePtrsToValues(result.value()), ElementsAre(values[0]));
 }
 
-TEST_F(VehiclePropertyStoreTest, testReadValuesForPropertyMultipleValues) {
+TEST_P(VehiclePropertyStoreTest, testReadValuesForPropertyMultipleValues) {
     auto values = getTestPropValues();
     for (const auto& value : values) {
         ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(value)));
@@ -180,14 +183,14 @@ TEST_F(VehiclePropertyStoreTest, testReadValuesForPropertyMultipleValues) {
                 WhenSortedBy(propValueCmp, ElementsAre(values[1], values[2])));
 }
 
-TEST_F(VehiclePropertyStoreTest, testReadValuesForPropertyError) {
+TEST_P(VehiclePropertyStoreTest, testReadValuesForPropertyError) {
     auto result = mStore->readValuesForProperty(INVALID_PROP_ID);
 
     EXPECT_FALSE(result.ok()) << "expect error when reading values for an invalid property";
     EXPECT_EQ(result.error().code(), StatusCode::INVALID_ARG);
 }
 
-TEST_F(VehiclePropertyStoreTest, testReadValueOk) {
+TEST_P(VehiclePropertyStoreTest, testReadValueOk) {
     auto values = getTestPropValues();
     for (const auto& value : values) {
         ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(value)));
@@ -204,7 +207,7 @@ TEST_F(VehiclePropertyStoreTest, testReadValueOk) {
     ASSERT_EQ(*(result.value()), values[1]);
 }
 
-TEST_F(VehiclePropertyStoreTest, testReadValueByPropIdOk) {
+TEST_P(VehiclePropertyStoreTest, testReadValueByPropIdOk) {
     auto values = getTestPropValues();
     for (const auto& value : values) {
         ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(value)));
@@ -215,7 +218,7 @@ TEST_F(VehiclePropertyStoreTest, testReadValueByPropIdOk) {
     ASSERT_EQ(*(result.value()), values[2]);
 }
 
-TEST_F(VehiclePropertyStoreTest, testReadValueError) {
+TEST_P(VehiclePropertyStoreTest, testReadValueError) {
     auto values = getTestPropValues();
     for (const auto& value : values) {
         ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(value)));
@@ -227,7 +230,7 @@ TEST_F(VehiclePropertyStoreTest, testReadValueError) {
     EXPECT_EQ(result.error().code(), StatusCode::NOT_AVAILABLE);
 }
 
-TEST_F(VehiclePropertyStoreTest, testWriteValueError) {
+TEST_P(VehiclePropertyStoreTest, testWriteValueError) {
     auto v = mValuePool->obtain(VehiclePropertyType::FLOAT);
     v->prop = INVALID_PROP_ID;
     v->value.floatValues = {1.0};
@@ -238,7 +241,7 @@ TEST_F(VehiclePropertyStoreTest, testWriteValueError) {
     EXPECT_EQ(result.error().code(), StatusCode::INVALID_ARG);
 }
 
-TEST_F(VehiclePropertyStoreTest, testWriteValueNoAreaConfig) {
+TEST_P(VehiclePropertyStoreTest, testWriteValueNoAreaConfig) {
     auto v = mValuePool->obtain(VehiclePropertyType::FLOAT);
     v->prop = toInt(VehicleProperty::TIRE_PRESSURE);
     v->value.floatValues = {1.0};
@@ -251,7 +254,7 @@ TEST_F(VehiclePropertyStoreTest, testWriteValueNoAreaConfig) {
     EXPECT_EQ(result.error().code(), StatusCode::INVALID_ARG);
 }
 
-TEST_F(VehiclePropertyStoreTest, testWriteOutdatedValue) {
+TEST_P(VehiclePropertyStoreTest, testWriteOutdatedValue) {
     auto v = mValuePool->obtain(VehiclePropertyType::FLOAT);
     v->timestamp = 1;
     v->prop = toInt(VehicleProperty::TIRE_PRESSURE);
@@ -272,7 +275,7 @@ TEST_F(VehiclePropertyStoreTest, testWriteOutdatedValue) {
     EXPECT_EQ(result.error().code(), StatusCode::INVALID_ARG);
 }
 
-TEST_F(VehiclePropertyStoreTest, testToken) {
+TEST_P(VehiclePropertyStoreTest, testToken) {
     int propId = toInt(VehicleProperty::INFO_FUEL_CAPACITY);
     VehiclePropConfig config = {
             .prop = propId,
@@ -307,7 +310,7 @@ TEST_F(VehiclePropertyStoreTest, testToken) {
     ASSERT_EQ(*(tokenResult.value()), fuelCapacityValueToken2);
 }
 
-TEST_F(VehiclePropertyStoreTest, testRemoveValue) {
+TEST_P(VehiclePropertyStoreTest, testRemoveValue) {
     auto values = getTestPropValues();
     for (const auto& value : values) {
         ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(value)));
@@ -325,7 +328,7 @@ TEST_F(VehiclePropertyStoreTest, testRemoveValue) {
     ASSERT_EQ(*(leftTirePressureResult.value()), values[1]);
 }
 
-TEST_F(VehiclePropertyStoreTest, testRemoveValuesForProperty) {
+TEST_P(VehiclePropertyStoreTest, testRemoveValuesForProperty) {
     auto values = getTestPropValues();
     for (const auto& value : values) {
         ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(value)));
@@ -338,7 +341,7 @@ TEST_F(VehiclePropertyStoreTest, testRemoveValuesForProperty) {
     ASSERT_TRUE(gotValues.empty());
 }
 
-TEST_F(VehiclePropertyStoreTest, testWriteValueUpdateStatus) {
+TEST_P(VehiclePropertyStoreTest, testWriteValueUpdateStatus) {
     VehiclePropValue fuelCapacity = {
             .prop = toInt(VehicleProperty::INFO_FUEL_CAPACITY),
             .value = {.floatValues = {1.0}},
@@ -359,7 +362,7 @@ TEST_F(VehiclePropertyStoreTest, testWriteValueUpdateStatus) {
     ASSERT_EQ(result.value()->status, VehiclePropertyStatus::UNAVAILABLE);
 }
 
-TEST_F(VehiclePropertyStoreTest, testWriteValueNoUpdateStatus) {
+TEST_P(VehiclePropertyStoreTest, testWriteValueNoUpdateStatus) {
     VehiclePropValue fuelCapacity = {
             .prop = toInt(VehicleProperty::INFO_FUEL_CAPACITY),
             .value = {.floatValues = {1.0}},
@@ -380,7 +383,7 @@ TEST_F(VehiclePropertyStoreTest, testWriteValueNoUpdateStatus) {
     ASSERT_EQ(result.value()->status, VehiclePropertyStatus::AVAILABLE);
 }
 
-TEST_F(VehiclePropertyStoreTest, testWriteValueNoUpdateStatusForNewValue) {
+TEST_P(VehiclePropertyStoreTest, testWriteValueNoUpdateStatusForNewValue) {
     VehiclePropValue fuelCapacity = {
             .prop = toInt(VehicleProperty::INFO_FUEL_CAPACITY),
             .value = {.floatValues = {1.0}},
@@ -398,7 +401,7 @@ TEST_F(VehiclePropertyStoreTest, testWriteValueNoUpdateStatusForNewValue) {
     ASSERT_EQ(result.value()->status, VehiclePropertyStatus::AVAILABLE);
 }
 
-TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackNewValue) {
+TEST_P(VehiclePropertyStoreTest, testPropertyChangeCallbackNewValue) {
     VehiclePropValue updatedValue;
     mStore->setOnValueChangeCallback(
             [&updatedValue](const VehiclePropValue& value) { updatedValue = value; });
@@ -411,7 +414,7 @@ TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackNewValue) {
     ASSERT_EQ(updatedValue, fuelCapacity);
 }
 
-TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackUpdateValue) {
+TEST_P(VehiclePropertyStoreTest, testPropertyChangeCallbackUpdateValue) {
     VehiclePropValue updatedValue;
     VehiclePropValue fuelCapacity = {
             .prop = toInt(VehicleProperty::INFO_FUEL_CAPACITY),
@@ -430,7 +433,7 @@ TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackUpdateValue) {
     ASSERT_EQ(updatedValue, fuelCapacity);
 }
 
-TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackNoUpdate) {
+TEST_P(VehiclePropertyStoreTest, testPropertyChangeCallbackNoUpdate) {
     VehiclePropValue updatedValue{
             .prop = INVALID_PROP_ID,
     };
@@ -449,7 +452,7 @@ TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackNoUpdate) {
     ASSERT_EQ(updatedValue.prop, INVALID_PROP_ID);
 }
 
-TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackNoUpdateForTimestampChange) {
+TEST_P(VehiclePropertyStoreTest, testPropertyChangeCallbackNoUpdateForTimestampChange) {
     VehiclePropValue updatedValue{
             .prop = INVALID_PROP_ID,
     };
@@ -469,7 +472,7 @@ TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackNoUpdateForTimestampC
     ASSERT_EQ(updatedValue.prop, INVALID_PROP_ID);
 }
 
-TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackForceUpdate) {
+TEST_P(VehiclePropertyStoreTest, testPropertyChangeCallbackForceUpdate) {
     VehiclePropValue updatedValue{
             .prop = INVALID_PROP_ID,
     };
@@ -489,7 +492,7 @@ TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackForceUpdate) {
     ASSERT_EQ(updatedValue, fuelCapacity);
 }
 
-TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackForceNoUpdate) {
+TEST_P(VehiclePropertyStoreTest, testPropertyChangeCallbackForceNoUpdate) {
     VehiclePropValue updatedValue{
             .prop = INVALID_PROP_ID,
     };
@@ -510,7 +513,7 @@ TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackForceNoUpdate) {
     ASSERT_EQ(updatedValue.prop, INVALID_PROP_ID);
 }
 
-TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackUseVehiclePropertyStore_noDeadLock) {
+TEST_P(VehiclePropertyStoreTest, testPropertyChangeCallbackUseVehiclePropertyStore_noDeadLock) {
     VehiclePropValue fuelCapacity = {
             .prop = toInt(VehicleProperty::INFO_FUEL_CAPACITY),
             .value = {.floatValues = {1.0}},
@@ -528,7 +531,7 @@ TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackUseVehiclePropertySto
     ASSERT_EQ(configs.size(), static_cast<size_t>(2));
 }
 
-TEST_F(VehiclePropertyStoreTest, testOnValuesChangeCallback) {
+TEST_P(VehiclePropertyStoreTest, testOnValuesChangeCallback) {
     std::vector<VehiclePropValue> updatedValues;
     VehiclePropValue fuelCapacity = {
             .prop = toInt(VehicleProperty::INFO_FUEL_CAPACITY),
@@ -547,7 +550,7 @@ TEST_F(VehiclePropertyStoreTest, testOnValuesChangeCallback) {
     ASSERT_THAT(updatedValues, ElementsAre(fuelCapacity));
 }
 
-TEST_F(VehiclePropertyStoreTest, testRefreshTimestamp) {
+TEST_P(VehiclePropertyStoreTest, testRefreshTimestamp) {
     std::vector<VehiclePropValue> updatedValues;
     mStore->setOnValuesChangeCallback(
             [&updatedValues](std::vector<VehiclePropValue> values) { updatedValues = values; });
@@ -578,7 +581,7 @@ TEST_F(VehiclePropertyStoreTest, testRefreshTimestamp) {
     ASSERT_EQ((result.value())->timestamp, timestamp);
 }
 
-TEST_F(VehiclePropertyStoreTest, testRefreshTimestamp_eventModeOnValueChange) {
+TEST_P(VehiclePropertyStoreTest, testRefreshTimestamp_eventModeOnValueChange) {
     std::vector<VehiclePropValue> updatedValues;
     mStore->setOnValuesChangeCallback(
             [&updatedValues](std::vector<VehiclePropValue> values) { updatedValues = values; });
@@ -606,7 +609,7 @@ TEST_F(VehiclePropertyStoreTest, testRefreshTimestamp_eventModeOnValueChange) {
             << "Even though event mode is on value change, the store timestamp must be updated";
 }
 
-TEST_F(VehiclePropertyStoreTest, testRefreshTimestamps) {
+TEST_P(VehiclePropertyStoreTest, testRefreshTimestamps) {
     std::vector<VehiclePropValue> updatedValues;
     mStore->setOnValuesChangeCallback(
             [&updatedValues](std::vector<VehiclePropValue> values) { updatedValues = values; });
@@ -655,6 +658,61 @@ TEST_F(VehiclePropertyStoreTest, testRefreshTimestamps) {
     ASSERT_GE(updatedValues[1].timestamp, now);
 }
 
+TEST_P(VehiclePropertyStoreTest, testConcurrentReadWrite) {
+    constexpr int kNumIterations = 1000;
+    int32_t fuelCapacityPropId = toInt(VehicleProperty::INFO_FUEL_CAPACITY);
+    int32_t tirePressurePropId = toInt(VehicleProperty::TIRE_PRESSURE);
+    for (const auto& value : getTestPropValues()) {
+        ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(value)));
+    }
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([this, fuelCapacityPropId] {
+        for (int i = 0; i < kNumIterations; i++) {
+            auto value = mValuePool->obtain(VehiclePropValue{
+                    .prop = fuelCapacityPropId,
+                    .value = {.floatValues = {static_cast<float>(i)}},
+            });
+            EXPECT_TRUE(mStore->writeValue(std::move(value), /*updateStatus=*/false,
+                                           VehiclePropertyStore::EventMode::ON_VALUE_CHANGE,
+                                           /*useCurrentTimestamp=*/true)
+                                .ok());
+        }
+    });
+    threads.emplace_back([this, tirePressurePropId] {
+        for (int i = 0; i < kNumIterations; i++) {
+            mStore->refreshTimestamp(tirePressurePropId, WHEEL_FRONT_LEFT,
+                                     VehiclePropertyStore::EventMode::NEVER);
+        }
+    });
+    for (int i = 0; i < 2; i++) {
+        threads.emplace_back([this, fuelCapacityPropId, tirePressurePropId] {
+            for (int j = 0; j < kNumIterations; j++) {
+                EXPECT_TRUE(mStore->readValue(fuelCapacityPropId).ok());
+                EXPECT_TRUE(mStore->readValue(tirePressurePropId, WHEEL_FRONT_LEFT).ok());
+                EXPECT_EQ(mStore->readAllValues().size(), 3u);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto result = mStore->readValue(fuelCapacityPropId);
+
+    ASSERT_RESULT_OK(result);
+    ASSERT_EQ(result.value()->value.floatValues[0], static_cast<float>(kNumIterations - 1));
+}
+
+INSTANTIATE_TEST_SUITE_P(LockModes, VehiclePropertyStoreTest,
+                         ::testing::Values(VehiclePropertyStore::LockMode::GLOBAL,
+                                           VehiclePropertyStore::LockMode::SHARDED),
+                         [](const ::testing::TestParamInfo<VehiclePropertyStore::LockMode>& info) {
+                             return info.param == VehiclePropertyStore::LockMode::GLOBAL
+                                            ? "Global"
+                                            : "Sharded";
+                         });
+
 }  // namespace vehicle
 }  // namespace automotive
 }  // namespace hardware
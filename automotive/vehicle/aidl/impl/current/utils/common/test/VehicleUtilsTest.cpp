@@ -764,6 +764,193 @@ TEST(VehicleUtilsTest, testConcurrentQueueDeactivateNotifyWaitingThread) {
     t.join();
 }
 
+TEST(VehicleUtilsTest, testMpscConcurrentQueueOneThread) {
+    MpscConcurrentQueue<int> queue;
+
+    queue.push(1);
+    queue.push(std::vector<int>({2, 3}));
+    auto result = queue.flush();
+
+    ASSERT_EQ(result, std::vector<int>({1, 2, 3}));
+    ASSERT_EQ(queue.size(), 0u);
+}
+
+TEST(VehicleUtilsTest, testMpscConcurrentQueueOverflowKeepsOrder) {
+    MpscConcurrentQueue<int> queue(/*capacity=*/4);
+    std::vector<int> expected;
+
+    for (int i = 0; i < 10; i++) {
+        int value = i;
+        queue.push(std::move(value));
+        expected.push_back(i);
+    }
+
+    ASSERT_EQ(queue.flush(), expected);
+
+    // The ring buffer must be used again after the overflow queue is drained.
+    queue.push(10);
+
+    ASSERT_EQ(queue.flush(), std::vector<int>({10}));
+}
+
+// An item whose move constructor blocks while 'stall' is set, to stop a producer after it claimed a
+// ring buffer cell and before it wrote the item.
+struct StallingItem {
+    int value;
+    std::atomic<bool>* stall = nullptr;
+    std::atomic<bool>* stalled = nullptr;
+
+    StallingItem(int value, std::atomic<bool>* stall = nullptr,
+                 std::atomic<bool>* stalled = nullptr)
+        : value(value), stall(stall), stalled(stalled) {}
+
+    StallingItem(StallingItem&& other) : value(other.value) {
+        if (other.stall != nullptr) {
+            other.stalled->store(true);
+            while (other.stall->load()) {
+                std::this_thread::yield();
+            }
+            other.stall = nullptr;
+        }
+    }
+
+    StallingItem& operator=(StallingItem&& other) {
+        value = other.value;
+        return *this;
+    }
+};
+
+TEST(VehicleUtilsTest, testMpscConcurrentQueueOverflowBehindStalledProducerKeepsOrder) {
+    MpscConcurrentQueue<StallingItem> queue(/*capacity=*/2);
+    std::atomic<bool> stall = true;
+    std::atomic<bool> stalled = false;
+
+    // Claims the first cell and stops before writing it.
+    std::thread stalledProducer(
+            [&queue, &stall, &stalled]() { queue.push(StallingItem(-1, &stall, &stalled)); });
+    while (!stalled.load()) {
+        std::this_thread::yield();
+    }
+
+    // Fills the ring buffer, the other items go to the overflow queue.
+    for (int i = 0; i < 4; i++) {
+        queue.push(StallingItem(i));
+    }
+
+    // Item 0 is behind the claimed cell, so items 1 to 3 must not be flushed yet.
+    std::vector<int> flushed;
+    for (StallingItem& item : queue.flush()) {
+        flushed.push_back(item.value);
+    }
+    // Not an assertion, the stalled producer has to be released.
+    EXPECT_TRUE(flushed.empty());
+
+    stall.store(false);
+    stalledProducer.join();
+    queue.push(StallingItem(4));
+
+    for (StallingItem& item : queue.flush()) {
+        flushed.push_back(item.value);
+    }
+    ASSERT_EQ(flushed, std::vector<int>({-1, 0, 1, 2, 3, 4}));
+    ASSERT_EQ(queue.size(), 0u);
+}
+
+TEST(VehicleUtilsTest, testMpscConcurrentQueueMultipleThreads) {
+    MpscConcurrentQueue<int> queue(/*capacity=*/16);
+    std::vector<int> results;
+    std::atomic<bool> stop = false;
+
+    std::thread t1([&queue]() {
+        for (int i = 0; i < 1000; i++) {
+            queue.push(0);
+        }
+    });
+    std::thread t2([&queue]() {
+        for (int i = 0; i < 1000; i++) {
+            queue.push(1);
+        }
+    });
+    std::thread t3([&queue, &results, &stop]() {
+        while (!stop) {
+            queue.waitForItems();
+            for (int i : queue.flush()) {
+                results.push_back(i);
+            }
+        }
+
+        // After we stop, get all the remaining values in the queue.
+        for (int i : queue.flush()) {
+            results.push_back(i);
+        }
+    });
+
+    t1.join();
+    t2.join();
+
+    stop = true;
+    queue.deactivate();
+    t3.join();
+
+    EXPECT_EQ(results.size(), static_cast<size_t>(2000));
+    EXPECT_EQ(std::count(results.begin(), results.end(), 0), 1000);
+    EXPECT_EQ(std::count(results.begin(), results.end(), 1), 1000);
+}
+
+TEST(VehicleUtilsTest, testMpscConcurrentQueuePushAfterDeactivate) {
+    MpscConcurrentQueue<int> queue;
+
+    queue.deactivate();
+    queue.push(1);
+
+    ASSERT_TRUE(queue.flush().empty());
+}
+
+TEST(VehicleUtilsTest, testMpscConcurrentQueueDeactivateNotifyWaitingThread) {
+    MpscConcurrentQueue<int> queue;
+
+    std::thread t([&queue]() {
+        // This would block until queue is deactivated.
+        queue.waitForItems();
+    });
+
+    queue.deactivate();
+
+    t.join();
+}
+
+TEST(VehicleUtilsTest, testBatchingConsumerFlushOnMaxBatchSize) {
+    MpscConcurrentQueue<int> queue;
+    BatchingConsumer<int, MpscConcurrentQueue<int>> consumer;
+    std::mutex lock;
+    std::condition_variable cv;
+    std::vector<std::vector<int>> batches;
+
+    // The batch interval is long enough that only reaching the max batch size would deliver the
+    // batch within the test timeout.
+    consumer.run(
+            &queue, std::chrono::seconds(100),
+            [&](std::vector<int> batch) {
+                std::scoped_lock<std::mutex> lockGuard(lock);
+                batches.push_back(std::move(batch));
+                cv.notify_one();
+            },
+            /*maxBatchSize=*/4);
+
+    queue.push(std::vector<int>({1, 2, 3, 4}));
+
+    {
+        std::unique_lock<std::mutex> lockGuard(lock);
+        ASSERT_TRUE(cv.wait_for(lockGuard, std::chrono::seconds(5),
+                                [&batches] { return !batches.empty(); }));
+        ASSERT_EQ(batches[0], std::vector<int>({1, 2, 3, 4}));
+    }
+
+    queue.deactivate();
+    consumer.requestStop();
+    consumer.waitStopped();
+}
+
 TEST(VehicleUtilsTest, testVhalError) {
     VhalResult<void> result = Error<VhalError>(StatusCode::INVALID_ARG) << "error message";
 
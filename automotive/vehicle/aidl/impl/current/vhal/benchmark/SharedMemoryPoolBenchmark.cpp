@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ParcelableUtils.h>
+#include <SharedMemoryPool.h>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+namespace aidlvhal = ::aidl::android::hardware::automotive::vehicle;
+
+// Each value is roughly the size of an OBD2 freeze frame.
+std::vector<aidlvhal::VehiclePropValue> getTestValues(int64_t count) {
+    std::vector<aidlvhal::VehiclePropValue> values;
+    for (int64_t i = 0; i < count; i++) {
+        aidlvhal::VehiclePropValue value;
+        value.prop = static_cast<int32_t>(i);
+        value.value.int32Values = std::vector<int32_t>(32, static_cast<int32_t>(i));
+        value.value.floatValues = std::vector<float>(72, static_cast<float>(i));
+        values.push_back(std::move(value));
+    }
+    return values;
+}
+
+// Argument is the number of values in one batch. Creates a new shared memory file for every batch.
+void BM_PerCallSharedMemoryFile(benchmark::State& state) {
+    auto values = getTestValues(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto valuesCopy = values;
+        state.ResumeTiming();
+
+        aidlvhal::VehiclePropValues output;
+        auto status = vectorToStableLargeParcelable(std::move(valuesCopy), &output);
+        if (!status.isOk()) {
+            state.SkipWithError(status.getMessage());
+            break;
+        }
+        benchmark::DoNotOptimize(output);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PerCallSharedMemoryFile)->Arg(100)->Arg(1000)->Arg(5000);
+
+// Argument is the number of values in one batch. Writes every batch into a pooled shared memory
+// file, which is returned right away as a well-behaved client would do.
+void BM_PooledSharedMemoryFile(benchmark::State& state) {
+    SharedMemoryPool pool(/*maxFileCount=*/2);
+    auto values = getTestValues(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto valuesCopy = values;
+        state.ResumeTiming();
+
+        aidlvhal::VehiclePropValues output;
+        auto status = pool.toStableLargeParcelable(std::move(valuesCopy), &output);
+        if (!status.isOk()) {
+            state.SkipWithError(status.getMessage());
+            break;
+        }
+        benchmark::DoNotOptimize(output);
+        pool.returnSharedMemory(output.sharedMemoryId);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PooledSharedMemoryFile)->Arg(100)->Arg(1000)->Arg(5000);
+
+}  // namespace
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
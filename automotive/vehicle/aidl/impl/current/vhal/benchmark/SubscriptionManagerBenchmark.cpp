@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <IVehicleHardware.h>
+#include <SubscriptionManager.h>
+
+#include <aidl/android/hardware/automotive/vehicle/BnVehicleCallback.h>
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+namespace aidlvhal = ::aidl::android::hardware::automotive::vehicle;
+
+using ::ndk::ScopedAStatus;
+using ::ndk::SpAIBinder;
+
+constexpr int32_t kNumClients = 50;
+constexpr int32_t kNumProps = 500;
+// The number of properties each client subscribes to, chosen so that every property has
+// multiple subscribers.
+constexpr int32_t kNumPropsPerClient = 100;
+constexpr size_t kEventsPerBatch = 64;
+
+// An IVehicleHardware that accepts all the subscriptions and does nothing else.
+class NoOpVehicleHardware final : public IVehicleHardware {
+  public:
+    std::vector<aidlvhal::VehiclePropConfig> getAllPropertyConfigs() const override { return {}; }
+    aidlvhal::StatusCode setValues(std::shared_ptr<const SetValuesCallback>,
+                                   const std::vector<aidlvhal::SetValueRequest>&) override {
+        return aidlvhal::StatusCode::OK;
+    }
+    aidlvhal::StatusCode getValues(std::shared_ptr<const GetValuesCallback>,
+                                   const std::vector<aidlvhal::GetValueRequest>&) const override {
+        return aidlvhal::StatusCode::OK;
+    }
+    DumpResult dump(const std::vector<std::string>&) override { return {}; }
+    aidlvhal::StatusCode checkHealth() override { return aidlvhal::StatusCode::OK; }
+    void registerOnPropertyChangeEvent(std::unique_ptr<const PropertyChangeCallback>) override {}
+    void registerOnPropertySetErrorEvent(
+            std::unique_ptr<const PropertySetErrorCallback>) override {}
+    aidlvhal::StatusCode subscribe(aidlvhal::SubscribeOptions) override {
+        return aidlvhal::StatusCode::OK;
+    }
+    aidlvhal::StatusCode unsubscribe(int32_t, int32_t) override {
+        return aidlvhal::StatusCode::OK;
+    }
+};
+
+class NoOpVehicleCallback final : public aidlvhal::BnVehicleCallback {
+  public:
+    ScopedAStatus onGetValues(const aidlvhal::GetValueResults&) override {
+        return ScopedAStatus::ok();
+    }
+    ScopedAStatus onSetValues(const aidlvhal::SetValueResults&) override {
+        return ScopedAStatus::ok();
+    }
+    ScopedAStatus onPropertyEvent(const aidlvhal::VehiclePropValues&, int32_t) override {
+        return ScopedAStatus::ok();
+    }
+    ScopedAStatus onPropertySetError(const aidlvhal::VehiclePropErrors&) override {
+        return ScopedAStatus::ok();
+    }
+    ScopedAStatus onSupportedValueChange(const std::vector<aidlvhal::PropIdAreaId>&) override {
+        return ScopedAStatus::ok();
+    }
+};
+
+class SubscriptionManagerFixture : public benchmark::Fixture {
+  public:
+    void SetUp(benchmark::State&) override {
+        mManager = std::make_unique<SubscriptionManager>(&mHardware);
+        for (int32_t i = 0; i < kNumClients; i++) {
+            SpAIBinder binder = ndk::SharedRefBase::make<NoOpVehicleCallback>()->asBinder();
+            mClients.push_back(aidlvhal::IVehicleCallback::fromBinder(binder));
+            mBinders.push_back(std::move(binder));
+        }
+        for (int32_t i = 0; i < kNumClients; i++) {
+            std::vector<aidlvhal::SubscribeOptions> continuousOptions;
+            std::vector<aidlvhal::SubscribeOptions> onChangeOptions;
+            for (int32_t j = 0; j < kNumPropsPerClient; j++) {
+                int32_t propId = (i * 7 + j) % kNumProps;
+                // Half of the properties are continuous, with mixed VUR and resolution settings
+                // so that both the filtering and the sanitizing paths are exercised.
+                if (propId % 2 == 0) {
+                    continuousOptions.push_back({
+                            .propId = propId,
+                            .areaIds = {0},
+                            .sampleRate = 10.0f,
+                            .resolution = (i % 3 == 0) ? 0.1f : 0.0f,
+                            .enableVariableUpdateRate = (i % 2 == 0),
+                    });
+                } else {
+                    onChangeOptions.push_back({
+                            .propId = propId,
+                            .areaIds = {0},
+                    });
+                }
+            }
+            mManager->subscribe(mClients[i], continuousOptions, /*isContinuousProperty=*/true);
+            mManager->subscribe(mClients[i], onChangeOptions, /*isContinuousProperty=*/false);
+        }
+        for (size_t i = 0; i < kEventsPerBatch; i++) {
+            mEvents.push_back({
+                    .prop = static_cast<int32_t>(i * 7 % kNumProps),
+                    .areaId = 0,
+                    .value = {.floatValues = {static_cast<float>(i)}},
+            });
+        }
+    }
+
+    void TearDown(benchmark::State&) override {
+        mManager.reset();
+        mClients.clear();
+        mBinders.clear();
+        mEvents.clear();
+    }
+
+  protected:
+    NoOpVehicleHardware mHardware;
+    std::unique_ptr<SubscriptionManager> mManager;
+    std::vector<std::shared_ptr<aidlvhal::IVehicleCallback>> mClients;
+    std::vector<SpAIBinder> mBinders;
+    std::vector<aidlvhal::VehiclePropValue> mEvents;
+
+    // Returns a new batch of events, with an increasing timestamp and a changed value so that VUR
+    // filtering does not drop them.
+    std::vector<aidlvhal::VehiclePropValue> nextEvents() {
+        mTimestamp++;
+        std::vector<aidlvhal::VehiclePropValue> events = mEvents;
+        for (auto& event : events) {
+            event.timestamp = mTimestamp;
+            event.value.floatValues[0] += static_cast<float>(mTimestamp);
+        }
+        return events;
+    }
+
+  private:
+    int64_t mTimestamp = 0;
+};
+
+// The cost of dispatching one batch of property events to 50 clients subscribed to 500
+// properties.
+BENCHMARK_DEFINE_F(SubscriptionManagerFixture, BM_GetSubscribedClients)(benchmark::State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto events = nextEvents();
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(mManager->getSubscribedClients(std::move(events)));
+    }
+    state.SetItemsProcessed(state.iterations() * kEventsPerBatch);
+}
+BENCHMARK_REGISTER_F(SubscriptionManagerFixture, BM_GetSubscribedClients);
+
+// Same as BM_GetSubscribedClients, but another thread keeps subscribing and unsubscribing a client,
+// which used to block the event path on the subscription lock.
+BENCHMARK_DEFINE_F(SubscriptionManagerFixture, BM_GetSubscribedClientsWithSubscriptionChurn)
+(benchmark::State& state) {
+    std::atomic<bool> stop = false;
+    std::thread churnThread([this, &stop] {
+        SpAIBinder binder = ndk::SharedRefBase::make<NoOpVehicleCallback>()->asBinder();
+        auto client = aidlvhal::IVehicleCallback::fromBinder(binder);
+        std::vector<aidlvhal::SubscribeOptions> options;
+        for (int32_t propId = 0; propId < kNumProps; propId += 2) {
+            options.push_back({
+                    .propId = propId,
+                    .areaIds = {0},
+                    .sampleRate = 20.0f,
+            });
+        }
+        while (!stop) {
+            mManager->subscribe(client, options, /*isContinuousProperty=*/true);
+            mManager->unsubscribe(binder.get());
+        }
+    });
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto events = nextEvents();
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(mManager->getSubscribedClients(std::move(events)));
+    }
+    state.SetItemsProcessed(state.iterations() * kEventsPerBatch);
+
+    stop = true;
+    churnThread.join();
+}
+BENCHMARK_REGISTER_F(SubscriptionManagerFixture, BM_GetSubscribedClientsWithSubscriptionChurn)
+        ->UseRealTime();
+
+}  // namespace
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -18,6 +18,7 @@
 #define android_hardware_automotive_vehicle_aidl_impl_vhal_include_ConnectedClient_H_
 
 #include "PendingRequestPool.h"
+#include "SharedMemoryPool.h"
 
 #include <IVehicleHardware.h>
 #include <VehicleHalTypes.h>
@@ -105,11 +106,13 @@ class SubscriptionClient {
             std::shared_ptr<aidl::android::hardware::automotive::vehicle::IVehicleCallback>;
 
     // Marshals the updated values into largeParcelable and sends it through {@code onPropertyEvent}
-    // callback.
+    // callback. If sharedMemoryPool is not null, large values are written into one of its pooled
+    // shared memory files.
     static void sendUpdatedValues(
             CallbackType callback,
             std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&&
-                    updatedValues);
+                    updatedValues,
+            SharedMemoryPool* sharedMemoryPool = nullptr);
     // Marshals the set property error events into largeParcelable and sends it through
     // {@code onPropertySetError} callback.
     static void sendPropertySetErrors(
@@ -20,6 +20,7 @@
 #include <ConnectedClient.h>
 #include <ParcelableUtils.h>
 #include <PendingRequestPool.h>
+#include <PropertyStats.h>
 #include <RecurrentTimer.h>
 #include <SubscriptionManager.h>
 
@@ -134,6 +135,13 @@ class DefaultVehicleHal final : public aidlvhal::BnVehicle {
     static constexpr int64_t TIMEOUT_IN_NANO = 30'000'000'000;
     // heart beat event interval: 3s
     static constexpr int64_t HEART_BEAT_INTERVAL_IN_NANO = 3'000'000'000;
+    // The batched property change events are delivered once the batching window has passed or
+    // this many events are queued, whichever comes first.
+    static constexpr size_t MAX_BATCHED_EVENT_COUNT = 256;
+    // The dump option handled by DefaultVehicleHal itself to show the per-property stats.
+    static constexpr char DUMP_PROPERTY_STATS_OPTION[] = "--vhal-stats";
+    // Used together with DUMP_PROPERTY_STATS_OPTION to reset the stats after dumping them.
+    static constexpr char DUMP_RESET_OPTION[] = "--reset";
     bool mShouldRefreshPropertyConfigs;
     std::unique_ptr<IVehicleHardware> mVehicleHardware;
 
@@ -141,13 +149,16 @@ class DefaultVehicleHal final : public aidlvhal::BnVehicle {
     std::shared_ptr<PendingRequestPool> mPendingRequestPool;
     // SubscriptionManager is thread-safe.
     std::shared_ptr<SubscriptionManager> mSubscriptionManager;
-    // ConcurrentQueue is thread-safe.
-    std::shared_ptr<ConcurrentQueue<aidlvhal::VehiclePropValue>> mBatchedEventQueue;
+    // MpscConcurrentQueue is thread-safe.
+    std::shared_ptr<MpscConcurrentQueue<aidlvhal::VehiclePropValue>> mBatchedEventQueue;
     // BatchingConsumer is thread-safe.
-    std::shared_ptr<BatchingConsumer<aidlvhal::VehiclePropValue>>
+    std::shared_ptr<BatchingConsumer<aidlvhal::VehiclePropValue,
+                                     MpscConcurrentQueue<aidlvhal::VehiclePropValue>>>
             mPropertyChangeEventsBatchingConsumer;
     // Only set once during initialization.
     std::chrono::nanoseconds mEventBatchingWindow;
+    // PropertyStatsCollector is thread-safe.
+    std::shared_ptr<PropertyStatsCollector> mPropertyStats;
     // Only used for testing.
     int32_t mTestInterfaceVersion = 0;
 
@@ -239,7 +250,8 @@ class DefaultVehicleHal final : public aidlvhal::BnVehicle {
             int32_t propId, int32_t areaId) const;
     // Puts the property change events into a queue so that they can handled in batch.
     static void batchPropertyChangeEvent(
-            const std::weak_ptr<ConcurrentQueue<aidlvhal::VehiclePropValue>>& batchedEventQueue,
+            const std::weak_ptr<MpscConcurrentQueue<aidlvhal::VehiclePropValue>>&
+                    batchedEventQueue,
             std::vector<aidlvhal::VehiclePropValue>&& updatedValues);
 
     // Gets or creates a {@code T} object for the client to or from {@code clients}.
@@ -249,6 +261,7 @@ class DefaultVehicleHal final : public aidlvhal::BnVehicle {
             const CallbackType& callback, std::shared_ptr<PendingRequestPool> pendingRequestPool);
 
     static void onPropertyChangeEvent(const std::weak_ptr<SubscriptionManager>& subscriptionManager,
+                                      PropertyStatsCollector* propertyStats,
                                       std::vector<aidlvhal::VehiclePropValue>&& updatedValues);
 
     static void onPropertySetErrorEvent(
@@ -260,7 +273,8 @@ class DefaultVehicleHal final : public aidlvhal::BnVehicle {
             const std::vector<PropIdAreaId>& updatedPropIdAreaIds);
 
     static void checkHealth(IVehicleHardware* hardware,
-                            std::weak_ptr<SubscriptionManager> subscriptionManager);
+                            std::weak_ptr<SubscriptionManager> subscriptionManager,
+                            PropertyStatsCollector* propertyStats);
 
     static void onBinderDied(void* cookie);
 
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_vhal_include_PropertyStats_H_
+#define android_hardware_automotive_vehicle_aidl_impl_vhal_include_PropertyStats_H_
+
+#include <AtomicHistogram.h>
+#include <VehicleHalTypes.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+// The counters for one property.
+struct PropertyStats {
+    explicit PropertyStats(int32_t propId) : propId(propId) {}
+
+    const int32_t propId;
+    // The number of getValue/setValue requests sent to IVehicleHardware. Requests failing the
+    // config or permission checks are not counted, so that clients cannot fill the table with
+    // unknown property IDs.
+    std::atomic<uint64_t> getCount = 0;
+    std::atomic<uint64_t> setCount = 0;
+    // The latency from the IVehicle getValues/setValues entry to the IVehicleHardware result
+    // callback, in nanoseconds.
+    AtomicHistogram getLatencyNanos;
+    AtomicHistogram setLatencyNanos;
+    // The number of property change events from IVehicleHardware.
+    std::atomic<uint64_t> eventsProduced = 0;
+    // The number of property change events sent to clients, after the VUR filtering. One event
+    // sent to two clients counts as two.
+    std::atomic<uint64_t> eventsDelivered = 0;
+
+    void reset();
+};
+
+// Always-on, per-property performance counters for DefaultVehicleHal.
+//
+// The per-property entries are kept in a fixed-size open addressing table which is only ever
+// appended to, so recording never takes a lock. A new entry is allocated the first time a property
+// is seen. The table is kept at most half full so that a lookup, which stops at the first empty
+// slot, only probes a few slots.
+//
+// This class is thread-safe.
+class PropertyStatsCollector final {
+  public:
+    PropertyStatsCollector() = default;
+
+    ~PropertyStatsCollector();
+
+    PropertyStatsCollector(const PropertyStatsCollector&) = delete;
+    PropertyStatsCollector& operator=(const PropertyStatsCollector&) = delete;
+
+    void recordGetRequest(int32_t propId);
+    void recordSetRequest(int32_t propId);
+    void recordGetLatency(int32_t propId, int64_t latencyInNanos);
+    void recordSetLatency(int32_t propId, int64_t latencyInNanos);
+    void recordEventsProduced(
+            const std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&
+                    values);
+    void recordEventsDelivered(
+            const std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&
+                    values);
+    // Records the number of events handled in one handleBatchedPropertyEvents call.
+    void recordEventBatchSize(size_t batchSize);
+
+    // Returns the stats for the property, or nullptr if the property has not been seen.
+    const PropertyStats* getStats(int32_t propId) const;
+
+    AtomicHistogram::Snapshot getEventBatchSizeSnapshot() const;
+
+    // Resets all the counters. Properties already seen keep their entries.
+    void reset();
+
+    // Returns a human-readable table of all the properties with non-zero counters.
+    std::string dump() const;
+
+  private:
+    // The table is larger than the number of properties any VHAL implementation is expected to
+    // support. Properties beyond this are not tracked.
+    static constexpr int TABLE_BITS = 12;
+    static constexpr size_t TABLE_SIZE = 1 << TABLE_BITS;
+    static constexpr size_t MAX_ENTRY_COUNT = TABLE_SIZE / 2;
+
+    std::array<std::atomic<PropertyStats*>, TABLE_SIZE> mTable = {};
+    std::atomic<size_t> mEntryCount = 0;
+    // Only warn once about the table being full, not on every record.
+    std::atomic<bool> mFullWarned = false;
+    AtomicHistogram mEventBatchSizes;
+
+    // Gets the entry for the property, allocating it if it does not exist. Returns nullptr if the
+    // table already has MAX_ENTRY_COUNT entries.
+    PropertyStats* getOrCreateStats(int32_t propId);
+
+    static size_t getSlot(int32_t propId);
+};
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_vhal_include_PropertyStats_H_
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_vhal_include_SharedMemoryPool_H_
+#define android_hardware_automotive_vehicle_aidl_impl_vhal_include_SharedMemoryPool_H_
+
+#include <VehicleHalTypes.h>
+#include <VehicleUtils.h>
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <android/binder_auto_utils.h>
+
+#include <mutex>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+// A pool of shared memory files for one subscription client.
+//
+// Property events that do not fit into a binder transaction are written into one of the pooled
+// files instead of a newly created one. The file is lent to the client together with a
+// sharedMemoryId and is only written again after the client calls
+// {@code IVehicle#returnSharedMemory} with that ID. The pool never holds more than
+// maxSharedMemoryFileCount files. If all of them are lent out, a one-off shared memory file is
+// used, same as {@code vectorToStableLargeParcelable}.
+//
+// This class is thread-safe.
+class SharedMemoryPool final {
+  public:
+    // Parcelables larger than this are sent through a shared memory file.
+    static constexpr size_t MAX_DIRECT_PAYLOAD_SIZE = 4096;
+
+    explicit SharedMemoryPool(int32_t maxFileCount);
+
+    ~SharedMemoryPool();
+
+    // Updates the max number of pooled files. If the new limit is smaller, the extra files are
+    // released once they are returned.
+    void setMaxFileCount(int32_t maxFileCount);
+
+    // Marshals the values into output. Small values are put into output.payloads. Larger values
+    // are written into a pooled file, in which case output.sharedMemoryId is set and the file must
+    // be returned through {@code returnSharedMemory}.
+    ndk::ScopedAStatus toStableLargeParcelable(
+            std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&& values,
+            aidl::android::hardware::automotive::vehicle::VehiclePropValues* output);
+
+    // Marks the file as no longer used by the client so that it could be reused.
+    // Returns {@code INVALID_ARG} if the ID is not lent out by this pool.
+    VhalResult<void> returnSharedMemory(int64_t sharedMemoryId);
+
+    // Returns the number of files currently allocated by the pool.
+    int32_t getFileCount() const;
+
+    // Returns the number of files currently lent to the client.
+    int32_t getInUseFileCount() const;
+
+  private:
+    struct MemoryFile {
+        int64_t id;
+        android::base::unique_fd fd;
+        uint8_t* address;
+        size_t capacity;
+        bool inUse;
+    };
+
+    mutable std::mutex mLock;
+    int32_t mMaxFileCount GUARDED_BY(mLock);
+    int64_t mNextId GUARDED_BY(mLock);
+    std::vector<MemoryFile> mFiles GUARDED_BY(mLock);
+
+    // Finds or allocates a free file with at least 'size' bytes and marks it in use. Returns
+    // nullptr if the pool is exhausted.
+    MemoryFile* acquireFileLocked(size_t size) REQUIRES(mLock);
+
+    static android::base::Result<MemoryFile> createFile(int64_t id, size_t size);
+    static void destroyFile(MemoryFile* file);
+};
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_vhal_include_SharedMemoryPool_H_
@@ -18,6 +18,7 @@
 #define android_hardware_automotive_vehicle_aidl_impl_vhal_include_SubscriptionManager_H_
 
 #include <IVehicleHardware.h>
+#include <SharedMemoryPool.h>
 #include <VehicleHalTypes.h>
 #include <VehicleUtils.h>
 
@@ -27,6 +28,7 @@
 
 #include <cmath>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
@@ -109,6 +111,10 @@ class SubscriptionManager final {
     // For a list of updated properties, returns a map that maps clients subscribing to
     // the updated properties to a list of updated values. This would only return on-change property
     // clients that should be informed for the given updated values.
+    //
+    // This does not take the subscription lock. It reads an immutable dispatch snapshot that is
+    // rebuilt every time the subscriptions change, so it never waits on subscribe/unsubscribe
+    // calls into IVehicleHardware.
     std::unordered_map<CallbackType, std::vector<VehiclePropValue>> getSubscribedClients(
             std::vector<VehiclePropValue>&& updatedValues);
 
@@ -131,6 +137,16 @@ class SubscriptionManager final {
     VhalResult<void> unsubscribeSupportedValueChange(
             ClientIdType client, const std::vector<PropIdAreaId>& propIdAreaIds);
 
+    // Sets the max number of shared memory files used to deliver property events to the client.
+    // The shared memory pool for the client is created on first call.
+    void setMaxSharedMemoryFileCount(ClientIdType client, int32_t maxSharedMemoryFileCount);
+
+    // Returns the shared memory pool for the client or nullptr if the client has never subscribed.
+    std::shared_ptr<SharedMemoryPool> getSharedMemoryPool(ClientIdType client);
+
+    // Returns a shared memory file lent to the client through {@code onPropertyEvent}.
+    VhalResult<void> returnSharedMemory(ClientIdType client, int64_t sharedMemoryId);
+
     // Returns the number of subscribed property change clients.
     size_t countPropertyChangeClients();
 
@@ -165,7 +181,28 @@ class SubscriptionManager final {
         }
     };
 
+    // One client to deliver the events for a [propId, areaId] to, with the per-client options
+    // already resolved.
+    struct DispatchTarget {
+        CallbackType callback;
+        float resolution;
+        // Whether the client enables VUR but IVehicleHardware does not (because another client
+        // does not), so unchanged values must be filtered out here.
+        bool filterUnchangedValues;
+    };
+
+    // An immutable snapshot of the subscriptions, built under mLock and then published as a whole.
+    using DispatchTable =
+            std::unordered_map<PropIdAreaId, std::vector<DispatchTarget>, PropIdAreaIdHash>;
+
     mutable std::mutex mLock;
+    // Only guards swapping or copying mDispatchTable, never held while building the table.
+    mutable std::mutex mDispatchTableLock;
+    // Only guards the last delivered values used for VUR filtering.
+    std::mutex mContSubValuesLock;
+    // Guards the shared memory pools, which are used on the event path.
+    std::mutex mSharedMemoryPoolsLock;
+    std::shared_ptr<const DispatchTable> mDispatchTable GUARDED_BY(mDispatchTableLock);
     std::unordered_map<PropIdAreaId, std::unordered_map<ClientIdType, CallbackType>,
                        PropIdAreaIdHash>
             mClientsByPropIdAreaId GUARDED_BY(mLock);
@@ -176,12 +213,28 @@ class SubscriptionManager final {
     std::unordered_map<CallbackType,
                        std::unordered_set<VehiclePropValue, VehiclePropValueHashPropIdAreaId,
                                           VehiclePropValueEqualPropIdAreaId>>
-            mContSubValuesByCallback GUARDED_BY(mLock);
+            mContSubValuesByCallback GUARDED_BY(mContSubValuesLock);
     std::unordered_map<PropIdAreaId, std::unordered_map<ClientIdType, CallbackType>,
                        PropIdAreaIdHash>
             mSupportedValueChangeClientsByPropIdAreaId GUARDED_BY(mLock);
     std::unordered_map<ClientIdType, std::unordered_set<PropIdAreaId, PropIdAreaIdHash>>
             mSupportedValueChangePropIdAreaIdsByClient GUARDED_BY(mLock);
+    std::unordered_map<ClientIdType, std::shared_ptr<SharedMemoryPool>> mSharedMemoryPoolsByClient
+            GUARDED_BY(mSharedMemoryPoolsLock);
+
+    VhalResult<void> subscribeLocked(
+            const CallbackType& callback,
+            const std::vector<aidl::android::hardware::automotive::vehicle::SubscribeOptions>&
+                    options,
+            bool isContinuousProperty) REQUIRES(mLock);
+    VhalResult<void> unsubscribeLocked(ClientIdType clientId, const std::vector<int32_t>& propIds)
+            REQUIRES(mLock);
+    VhalResult<void> unsubscribeLocked(ClientIdType clientId) REQUIRES(mLock);
+
+    // Rebuilds the dispatch table from the current subscriptions and publishes it. Must be called
+    // after every change to mClientsByPropIdAreaId or mContSubConfigsByPropIdArea.
+    void refreshDispatchTableLocked() REQUIRES(mLock);
+    std::shared_ptr<const DispatchTable> getDispatchTable() const EXCLUDES(mDispatchTableLock);
 
     VhalResult<void> addContinuousSubscriberLocked(const ClientIdType& clientId,
                                                    const PropIdAreaId& propIdAreaId,
@@ -210,7 +263,7 @@ class SubscriptionManager final {
     bool isEmpty();
 
     bool isValueUpdatedLocked(const CallbackType& callback, const VehiclePropValue& value)
-            REQUIRES(mLock);
+            REQUIRES(mContSubValuesLock);
 
     // Get the interval in nanoseconds accroding to sample rate.
     static android::base::Result<int64_t> getIntervalNanos(float sampleRateHz);
@@ -251,16 +251,22 @@ template class GetSetValuesClient<GetValueResult, GetValueResults>;
 template class GetSetValuesClient<SetValueResult, SetValueResults>;
 
 void SubscriptionClient::sendUpdatedValues(std::shared_ptr<IVehicleCallback> callback,
-                                           std::vector<VehiclePropValue>&& updatedValues) {
+                                           std::vector<VehiclePropValue>&& updatedValues,
+                                           SharedMemoryPool* sharedMemoryPool) {
     if (updatedValues.empty()) {
         return;
     }
 
-    // TODO(b/205189110): Use memory pool here and fill in sharedMemoryId.
     VehiclePropValues vehiclePropValues;
     int32_t sharedMemoryFileCount = 0;
-    ScopedAStatus status =
-            vectorToStableLargeParcelable(std::move(updatedValues), &vehiclePropValues);
+    ScopedAStatus status;
+    if (sharedMemoryPool != nullptr) {
+        status = sharedMemoryPool->toStableLargeParcelable(std::move(updatedValues),
+                                                          &vehiclePropValues);
+        sharedMemoryFileCount = sharedMemoryPool->getFileCount();
+    } else {
+        status = vectorToStableLargeParcelable(std::move(updatedValues), &vehiclePropValues);
+    }
     if (!status.isOk()) {
         int statusCode = status.getServiceSpecificError();
         ALOGE("subscribe: failed to marshal result into large parcelable, error: "
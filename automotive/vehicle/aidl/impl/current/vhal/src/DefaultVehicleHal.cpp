@@ -27,6 +27,7 @@
 #include <android-base/logging.h>
 #include <android-base/result.h>
 #include <android-base/stringprintf.h>
+#include <android-base/strings.h>
 #include <android/binder_ibinder.h>
 #include <private/android_filesystem_config.h>
 #include <utils/Log.h>
@@ -34,6 +35,7 @@
 #include <utils/Trace.h>
 
 #include <inttypes.h>
+#include <algorithm>
 #include <chrono>
 #include <set>
 #include <unordered_set>
@@ -71,6 +73,7 @@ using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyStatus;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
 using ::aidl::android::hardware::automotive::vehicle::VersionForVehicleProperty;
 using ::android::automotive::car_binder_lib::LargeParcelableBase;
+using ::android::base::EqualsIgnoreCase;
 using ::android::base::Error;
 using ::android::base::expected;
 using ::android::base::Result;
@@ -103,6 +106,48 @@ float getDefaultSampleRateHz(float sampleRateHz, float minSampleRateHz, float ma
     return sampleRateHz;
 }
 
+// (request ID, property ID) pairs sorted by request ID. A sorted vector is a single allocation
+// per request, unlike a hash map which allocates a node per entry.
+using PropIdByRequestId = std::vector<std::pair<int64_t, int32_t>>;
+
+template <class RequestType, class GetPropIdFunc>
+PropIdByRequestId getPropIdByRequestId(const std::vector<RequestType>& requests,
+                                       GetPropIdFunc getPropId) {
+    PropIdByRequestId propIdByRequestId;
+    propIdByRequestId.reserve(requests.size());
+    for (const auto& request : requests) {
+        propIdByRequestId.emplace_back(request.requestId, getPropId(request));
+    }
+    std::sort(propIdByRequestId.begin(), propIdByRequestId.end());
+    return propIdByRequestId;
+}
+
+// Wraps the hardware result callback to record the latency from 'startTimeInNanos' to when the
+// hardware returns the result, for the property of each request.
+template <class ResultType>
+std::shared_ptr<const std::function<void(std::vector<ResultType>)>> withLatencyRecording(
+        std::shared_ptr<const std::function<void(std::vector<ResultType>)>> resultCallback,
+        PropIdByRequestId&& propIdByRequestId, int64_t startTimeInNanos,
+        std::shared_ptr<PropertyStatsCollector> propertyStats,
+        void (PropertyStatsCollector::*recordLatency)(int32_t, int64_t)) {
+    return std::make_shared<const std::function<void(std::vector<ResultType>)>>(
+            [resultCallback, propIdByRequestId = std::move(propIdByRequestId), startTimeInNanos,
+             propertyStats, recordLatency](std::vector<ResultType> results) {
+                int64_t latencyInNanos = elapsedRealtimeNano() - startTimeInNanos;
+                for (const auto& result : results) {
+                    auto it = std::lower_bound(
+                            propIdByRequestId.begin(), propIdByRequestId.end(), result.requestId,
+                            [](const auto& entry, int64_t requestId) {
+                                return entry.first < requestId;
+                            });
+                    if (it != propIdByRequestId.end() && it->first == result.requestId) {
+                        (propertyStats.get()->*recordLatency)(it->second, latencyInNanos);
+                    }
+                }
+                (*resultCallback)(std::move(results));
+            });
+}
+
 class SCOPED_CAPABILITY SharedScopedLockAssertion {
   public:
     SharedScopedLockAssertion(std::shared_timed_mutex& mutex) ACQUIRE_SHARED(mutex) {}
@@ -124,34 +169,39 @@ DefaultVehicleHal::DefaultVehicleHal(std::unique_ptr<IVehicleHardware> vehicleHa
                                      int32_t testInterfaceVersion)
     : mVehicleHardware(std::move(vehicleHardware)),
       mPendingRequestPool(std::make_shared<PendingRequestPool>(TIMEOUT_IN_NANO)),
+      mPropertyStats(std::make_shared<PropertyStatsCollector>()),
       mTestInterfaceVersion(testInterfaceVersion) {
     ALOGD("DefaultVehicleHal init");
     IVehicleHardware* vehicleHardwarePtr = mVehicleHardware.get();
     mSubscriptionManager = std::make_shared<SubscriptionManager>(vehicleHardwarePtr);
     mEventBatchingWindow = mVehicleHardware->getPropertyOnChangeEventBatchingWindow();
     if (mEventBatchingWindow != std::chrono::nanoseconds(0)) {
-        mBatchedEventQueue = std::make_shared<ConcurrentQueue<VehiclePropValue>>();
-        mPropertyChangeEventsBatchingConsumer =
-                std::make_shared<BatchingConsumer<VehiclePropValue>>();
+        mBatchedEventQueue = std::make_shared<MpscConcurrentQueue<VehiclePropValue>>();
+        mPropertyChangeEventsBatchingConsumer = std::make_shared<
+                BatchingConsumer<VehiclePropValue, MpscConcurrentQueue<VehiclePropValue>>>();
         mPropertyChangeEventsBatchingConsumer->run(
                 mBatchedEventQueue.get(), mEventBatchingWindow,
                 [this](std::vector<VehiclePropValue> batchedEvents) {
                     handleBatchedPropertyEvents(std::move(batchedEvents));
-                });
+                },
+                MAX_BATCHED_EVENT_COUNT);
     }
 
-    std::weak_ptr<ConcurrentQueue<VehiclePropValue>> batchedEventQueueCopy = mBatchedEventQueue;
+    std::weak_ptr<MpscConcurrentQueue<VehiclePropValue>> batchedEventQueueCopy =
+            mBatchedEventQueue;
     std::chrono::nanoseconds eventBatchingWindow = mEventBatchingWindow;
     std::weak_ptr<SubscriptionManager> subscriptionManagerCopy = mSubscriptionManager;
+    std::shared_ptr<PropertyStatsCollector> propertyStatsCopy = mPropertyStats;
     mVehicleHardware->registerOnPropertyChangeEvent(
             std::make_unique<IVehicleHardware::PropertyChangeCallback>(
-                    [subscriptionManagerCopy, batchedEventQueueCopy,
+                    [subscriptionManagerCopy, propertyStatsCopy, batchedEventQueueCopy,
                      eventBatchingWindow](std::vector<VehiclePropValue> updatedValues) {
                         if (eventBatchingWindow != std::chrono::nanoseconds(0)) {
                             batchPropertyChangeEvent(batchedEventQueueCopy,
                                                      std::move(updatedValues));
                         } else {
                             onPropertyChangeEvent(subscriptionManagerCopy,
+                                                  propertyStatsCopy.get(),
                                                   std::move(updatedValues));
                         }
                     }));
@@ -168,8 +218,8 @@ DefaultVehicleHal::DefaultVehicleHal(std::unique_ptr<IVehicleHardware> vehicleHa
 
     // Register heartbeat event.
     mRecurrentAction = std::make_shared<std::function<void()>>(
-            [vehicleHardwarePtr, subscriptionManagerCopy]() {
-                checkHealth(vehicleHardwarePtr, subscriptionManagerCopy);
+            [vehicleHardwarePtr, subscriptionManagerCopy, propertyStatsCopy]() {
+                checkHealth(vehicleHardwarePtr, subscriptionManagerCopy, propertyStatsCopy.get());
             });
     mRecurrentTimer.registerTimerCallback(HEART_BEAT_INTERVAL_IN_NANO, mRecurrentAction);
 
@@ -208,7 +258,7 @@ DefaultVehicleHal::~DefaultVehicleHal() {
 }
 
 void DefaultVehicleHal::batchPropertyChangeEvent(
-        const std::weak_ptr<ConcurrentQueue<VehiclePropValue>>& batchedEventQueue,
+        const std::weak_ptr<MpscConcurrentQueue<VehiclePropValue>>& batchedEventQueue,
         std::vector<VehiclePropValue>&& updatedValues) {
     auto batchedEventQueueStrong = batchedEventQueue.lock();
     if (batchedEventQueueStrong == nullptr) {
@@ -220,21 +270,26 @@ void DefaultVehicleHal::batchPropertyChangeEvent(
 }
 
 void DefaultVehicleHal::handleBatchedPropertyEvents(std::vector<VehiclePropValue>&& batchedEvents) {
-    onPropertyChangeEvent(mSubscriptionManager, std::move(batchedEvents));
+    mPropertyStats->recordEventBatchSize(batchedEvents.size());
+    onPropertyChangeEvent(mSubscriptionManager, mPropertyStats.get(), std::move(batchedEvents));
 }
 
 void DefaultVehicleHal::onPropertyChangeEvent(
         const std::weak_ptr<SubscriptionManager>& subscriptionManager,
-        std::vector<VehiclePropValue>&& updatedValues) {
+        PropertyStatsCollector* propertyStats, std::vector<VehiclePropValue>&& updatedValues) {
     ATRACE_CALL();
     auto manager = subscriptionManager.lock();
     if (manager == nullptr) {
         ALOGW("%s: the SubscriptionManager is destroyed, DefaultVehicleHal is ending", __func__);
         return;
     }
+    propertyStats->recordEventsProduced(updatedValues);
     auto updatedValuesByClients = manager->getSubscribedClients(std::move(updatedValues));
     for (auto& [callback, values] : updatedValuesByClients) {
-        SubscriptionClient::sendUpdatedValues(callback, std::move(values));
+        propertyStats->recordEventsDelivered(values);
+        std::shared_ptr<SharedMemoryPool> sharedMemoryPool =
+                manager->getSharedMemoryPool(callback->asBinder().get());
+        SubscriptionClient::sendUpdatedValues(callback, std::move(values), sharedMemoryPool.get());
     }
 }
 
@@ -520,6 +575,7 @@ Result<void> DefaultVehicleHal::checkProperty(const VehiclePropValue& propValue)
 ScopedAStatus DefaultVehicleHal::getValues(const CallbackType& callback,
                                            const GetValueRequests& requests) {
     ATRACE_CALL();
+    int64_t startTimeInNanos = elapsedRealtimeNano();
     if (callback == nullptr) {
         return ScopedAStatus::fromExceptionCode(EX_NULL_POINTER);
     }
@@ -553,6 +609,9 @@ ScopedAStatus DefaultVehicleHal::getValues(const CallbackType& callback,
             });
             continue;
         }
+        // Only record the properties that have a config, so unknown property IDs from clients
+        // do not take entries.
+        mPropertyStats->recordGetRequest(request.prop.prop);
         hardwareRequests.push_back(request);
     }
 
@@ -590,8 +649,12 @@ ScopedAStatus DefaultVehicleHal::getValues(const CallbackType& callback,
         return ScopedAStatus::ok();
     }
 
-    if (StatusCode status =
-                mVehicleHardware->getValues(client->getResultCallback(), hardwareRequests);
+    auto resultCallback = withLatencyRecording(
+            client->getResultCallback(),
+            getPropIdByRequestId(hardwareRequests,
+                                 [](const GetValueRequest& request) { return request.prop.prop; }),
+            startTimeInNanos, mPropertyStats, &PropertyStatsCollector::recordGetLatency);
+    if (StatusCode status = mVehicleHardware->getValues(resultCallback, hardwareRequests);
         status != StatusCode::OK) {
         // If the hardware returns error, finish all the pending requests for this request because
         // we never expect hardware to call callback for these requests.
@@ -607,6 +670,7 @@ ScopedAStatus DefaultVehicleHal::getValues(const CallbackType& callback,
 ScopedAStatus DefaultVehicleHal::setValues(const CallbackType& callback,
                                            const SetValueRequests& requests) {
     ATRACE_CALL();
+    int64_t startTimeInNanos = elapsedRealtimeNano();
     if (callback == nullptr) {
         return ScopedAStatus::fromExceptionCode(EX_NULL_POINTER);
     }
@@ -650,6 +714,7 @@ ScopedAStatus DefaultVehicleHal::setValues(const CallbackType& callback,
             continue;
         }
 
+        mPropertyStats->recordSetRequest(request.value.prop);
         hardwareRequests.push_back(request);
     }
 
@@ -686,8 +751,12 @@ ScopedAStatus DefaultVehicleHal::setValues(const CallbackType& callback,
         return ScopedAStatus::ok();
     }
 
-    if (StatusCode status =
-                mVehicleHardware->setValues(client->getResultCallback(), hardwareRequests);
+    auto resultCallback = withLatencyRecording(
+            client->getResultCallback(),
+            getPropIdByRequestId(hardwareRequests,
+                                 [](const SetValueRequest& request) { return request.value.prop; }),
+            startTimeInNanos, mPropertyStats, &PropertyStatsCollector::recordSetLatency);
+    if (StatusCode status = mVehicleHardware->setValues(resultCallback, hardwareRequests);
         status != StatusCode::OK) {
         // If the hardware returns error, finish all the pending requests for this request because
         // we never expect hardware to call callback for these requests.
@@ -926,11 +995,19 @@ void DefaultVehicleHal::parseSubscribeOptions(
 
 ScopedAStatus DefaultVehicleHal::subscribe(const CallbackType& callback,
                                            const std::vector<SubscribeOptions>& options,
-                                           [[maybe_unused]] int32_t maxSharedMemoryFileCount) {
-    // TODO(b/205189110): Use shared memory file count.
+                                           int32_t maxSharedMemoryFileCount) {
     if (callback == nullptr) {
         return ScopedAStatus::fromExceptionCode(EX_NULL_POINTER);
     }
+    if (maxSharedMemoryFileCount < 0) {
+        return ScopedAStatus::fromServiceSpecificErrorWithMessage(
+                toInt(StatusCode::INVALID_ARG), "maxSharedMemoryFileCount must be >= 0");
+    }
+    if (maxSharedMemoryFileCount >= IVehicle::MAX_SHARED_MEMORY_FILES_PER_CLIENT) {
+        ALOGW("subscribe: maxSharedMemoryFileCount: %" PRId32 " is too large, use %" PRId32,
+              maxSharedMemoryFileCount, IVehicle::MAX_SHARED_MEMORY_FILES_PER_CLIENT - 1);
+        maxSharedMemoryFileCount = IVehicle::MAX_SHARED_MEMORY_FILES_PER_CLIENT - 1;
+    }
     std::vector<SubscribeOptions> onChangeSubscriptions;
     std::vector<SubscribeOptions> continuousSubscriptions;
     ScopedAStatus returnStatus = ScopedAStatus::ok();
@@ -975,6 +1052,8 @@ ScopedAStatus DefaultVehicleHal::subscribe(const CallbackType& callback,
                 return toScopedAStatus(result);
             }
         }
+        mSubscriptionManager->setMaxSharedMemoryFileCount(callback->asBinder().get(),
+                                                          maxSharedMemoryFileCount);
     }
     return ScopedAStatus::ok();
 }
@@ -987,9 +1066,13 @@ ScopedAStatus DefaultVehicleHal::unsubscribe(const CallbackType& callback,
     return toScopedAStatus(mSubscriptionManager->unsubscribe(callback->asBinder().get(), propIds));
 }
 
-ScopedAStatus DefaultVehicleHal::returnSharedMemory(const CallbackType&, int64_t) {
-    // TODO(b/200737967): implement this.
-    return ScopedAStatus::ok();
+ScopedAStatus DefaultVehicleHal::returnSharedMemory(const CallbackType& callback,
+                                                    int64_t sharedMemoryId) {
+    if (callback == nullptr) {
+        return ScopedAStatus::fromExceptionCode(EX_NULL_POINTER);
+    }
+    return toScopedAStatus(
+            mSubscriptionManager->returnSharedMemory(callback->asBinder().get(), sharedMemoryId));
 }
 
 Result<VehicleAreaConfig> DefaultVehicleHal::getAreaConfigForPropIdAreaId(int32_t propId,
@@ -1265,7 +1348,8 @@ VhalResult<void> DefaultVehicleHal::checkReadPermission(const VehiclePropValue&
 }
 
 void DefaultVehicleHal::checkHealth(IVehicleHardware* vehicleHardware,
-                                    std::weak_ptr<SubscriptionManager> subscriptionManager) {
+                                    std::weak_ptr<SubscriptionManager> subscriptionManager,
+                                    PropertyStatsCollector* propertyStats) {
     StatusCode status = vehicleHardware->checkHealth();
     if (status != StatusCode::OK) {
         ALOGE("VHAL check health returns non-okay status");
@@ -1277,7 +1361,7 @@ void DefaultVehicleHal::checkHealth(IVehicleHardware* vehicleHardware,
             .status = VehiclePropertyStatus::AVAILABLE,
             .value.int64Values = {uptimeMillis()},
     }};
-    onPropertyChangeEvent(subscriptionManager, std::move(values));
+    onPropertyChangeEvent(subscriptionManager, propertyStats, std::move(values));
     return;
 }
 
@@ -1314,11 +1398,25 @@ binder_status_t DefaultVehicleHal::dump(int fd, const char** args, uint32_t numA
         // Ignore "-a" option. Bugreport will call with this option.
         options.clear();
     }
+    if (!options.empty() && EqualsIgnoreCase(options[0], DUMP_PROPERTY_STATS_OPTION)) {
+        dprintf(fd, "%s", mPropertyStats->dump().c_str());
+        if (options.size() == 2 && EqualsIgnoreCase(options[1], DUMP_RESET_OPTION)) {
+            mPropertyStats->reset();
+            dprintf(fd, "Property stats reset\n");
+        }
+        return STATUS_OK;
+    }
     DumpResult result = mVehicleHardware->dump(options);
     if (result.refreshPropertyConfigs) {
         getAllPropConfigsFromHardwareLocked();
     }
     dprintf(fd, "%s", (result.buffer + "\n").c_str());
+    if (!options.empty() && EqualsIgnoreCase(options[0], "--help")) {
+        dprintf(fd,
+                "%s [%s]: dumps the per-property request counts, latencies and event counts "
+                "collected by DefaultVehicleHal, optionally resets them afterwards\n",
+                DUMP_PROPERTY_STATS_OPTION, DUMP_RESET_OPTION);
+    }
     if (!result.callerShouldDumpState) {
         return STATUS_OK;
     }
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PropertyStats"
+
+#include "PropertyStats.h"
+
+#include <VehicleUtils.h>
+
+#include <android-base/stringprintf.h>
+#include <utils/Log.h>
+
+#include <inttypes.h>
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+using ::android::base::StringAppendF;
+
+constexpr int64_t NANOS_PER_MICRO = 1'000;
+
+// Appends "count, mean/p50/p99/max" for a latency histogram, in microseconds.
+void appendLatency(std::string* out, const char* name, uint64_t count,
+                   const AtomicHistogram::Snapshot& latency) {
+    StringAppendF(out, "  %s: %" PRIu64 " requests", name, count);
+    if (latency.count != 0) {
+        StringAppendF(out,
+                      ", latency(us) mean: %" PRId64 ", p50: %" PRId64 ", p99: %" PRId64
+                      ", max: %" PRId64,
+                      latency.getMean() / NANOS_PER_MICRO,
+                      latency.getPercentile(50) / NANOS_PER_MICRO,
+                      latency.getPercentile(99) / NANOS_PER_MICRO, latency.max / NANOS_PER_MICRO);
+    }
+    out->append("\n");
+}
+
+}  // namespace
+
+void PropertyStats::reset() {
+    getCount.store(0, std::memory_order_relaxed);
+    setCount.store(0, std::memory_order_relaxed);
+    getLatencyNanos.reset();
+    setLatencyNanos.reset();
+    eventsProduced.store(0, std::memory_order_relaxed);
+    eventsDelivered.store(0, std::memory_order_relaxed);
+}
+
+PropertyStatsCollector::~PropertyStatsCollector() {
+    for (auto& slot : mTable) {
+        delete slot.load(std::memory_order_relaxed);
+    }
+}
+
+size_t PropertyStatsCollector::getSlot(int32_t propId) {
+    // Fibonacci hashing, property IDs mostly differ in their low bits.
+    uint32_t hash = static_cast<uint32_t>(propId) * 2654435769u;
+    return hash >> (32 - TABLE_BITS);
+}
+
+PropertyStats* PropertyStatsCollector::getOrCreateStats(int32_t propId) {
+    size_t slot = getSlot(propId);
+    for (size_t i = 0; i < TABLE_SIZE; i++) {
+        std::atomic<PropertyStats*>& entry = mTable[(slot + i) & (TABLE_SIZE - 1)];
+        PropertyStats* stats = entry.load(std::memory_order_acquire);
+        if (stats == nullptr) {
+            if (mEntryCount.fetch_add(1, std::memory_order_relaxed) >= MAX_ENTRY_COUNT) {
+                mEntryCount.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            PropertyStats* newStats = new PropertyStats(propId);
+            if (entry.compare_exchange_strong(stats, newStats, std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+                return newStats;
+            }
+            // Another thread took this slot first, 'stats' now points to its entry.
+            mEntryCount.fetch_sub(1, std::memory_order_relaxed);
+            delete newStats;
+        }
+        if (stats->propId == propId) {
+            return stats;
+        }
+    }
+    if (!mFullWarned.exchange(true, std::memory_order_relaxed)) {
+        ALOGW("property stats table is full, not tracking property: %s and later new properties",
+              propIdToString(propId).c_str());
+    }
+    return nullptr;
+}
+
+const PropertyStats* PropertyStatsCollector::getStats(int32_t propId) const {
+    size_t slot = getSlot(propId);
+    for (size_t i = 0; i < TABLE_SIZE; i++) {
+        const PropertyStats* stats =
+                mTable[(slot + i) & (TABLE_SIZE - 1)].load(std::memory_order_acquire);
+        if (stats == nullptr) {
+            return nullptr;
+        }
+        if (stats->propId == propId) {
+            return stats;
+        }
+    }
+    return nullptr;
+}
+
+void PropertyStatsCollector::recordGetRequest(int32_t propId) {
+    if (PropertyStats* stats = getOrCreateStats(propId); stats != nullptr) {
+        stats->getCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void PropertyStatsCollector::recordSetRequest(int32_t propId) {
+    if (PropertyStats* stats = getOrCreateStats(propId); stats != nullptr) {
+        stats->setCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void PropertyStatsCollector::recordGetLatency(int32_t propId, int64_t latencyInNanos) {
+    if (PropertyStats* stats = getOrCreateStats(propId); stats != nullptr) {
+        stats->getLatencyNanos.record(latencyInNanos);
+    }
+}
+
+void PropertyStatsCollector::recordSetLatency(int32_t propId, int64_t latencyInNanos) {
+    if (PropertyStats* stats = getOrCreateStats(propId); stats != nullptr) {
+        stats->setLatencyNanos.record(latencyInNanos);
+    }
+}
+
+void PropertyStatsCollector::recordEventsProduced(const std::vector<VehiclePropValue>& values) {
+    PropertyStats* stats = nullptr;
+    for (const auto& value : values) {
+        // Events often come in runs of the same property, skip the lookup for those.
+        if (stats == nullptr || stats->propId != value.prop) {
+            stats = getOrCreateStats(value.prop);
+            if (stats == nullptr) {
+                continue;
+            }
+        }
+        stats->eventsProduced.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void PropertyStatsCollector::recordEventsDelivered(const std::vector<VehiclePropValue>& values) {
+    PropertyStats* stats = nullptr;
+    for (const auto& value : values) {
+        if (stats == nullptr || stats->propId != value.prop) {
+            stats = getOrCreateStats(value.prop);
+            if (stats == nullptr) {
+                continue;
+            }
+        }
+        stats->eventsDelivered.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void PropertyStatsCollector::recordEventBatchSize(size_t batchSize) {
+    mEventBatchSizes.record(static_cast<int64_t>(batchSize));
+}
+
+AtomicHistogram::Snapshot PropertyStatsCollector::getEventBatchSizeSnapshot() const {
+    return mEventBatchSizes.getSnapshot();
+}
+
+void PropertyStatsCollector::reset() {
+    for (auto& slot : mTable) {
+        if (PropertyStats* stats = slot.load(std::memory_order_acquire); stats != nullptr) {
+            stats->reset();
+        }
+    }
+    mEventBatchSizes.reset();
+}
+
+std::string PropertyStatsCollector::dump() const {
+    std::vector<const PropertyStats*> allStats;
+    for (const auto& slot : mTable) {
+        if (const PropertyStats* stats = slot.load(std::memory_order_acquire); stats != nullptr) {
+            allStats.push_back(stats);
+        }
+    }
+    std::sort(allStats.begin(), allStats.end(),
+              [](const PropertyStats* a, const PropertyStats* b) { return a->propId < b->propId; });
+
+    std::string out = "Property stats:\n";
+    AtomicHistogram::Snapshot batchSizes = mEventBatchSizes.getSnapshot();
+    if (batchSizes.count != 0) {
+        StringAppendF(&out,
+                      "Event batches: %" PRIu64 ", size mean: %" PRId64 ", p50: %" PRId64
+                      ", p99: %" PRId64 ", max: %" PRId64 "\n",
+                      batchSizes.count, batchSizes.getMean(), batchSizes.getPercentile(50),
+                      batchSizes.getPercentile(99), batchSizes.max);
+    }
+    for (const PropertyStats* stats : allStats) {
+        uint64_t getCount = stats->getCount.load(std::memory_order_relaxed);
+        uint64_t setCount = stats->setCount.load(std::memory_order_relaxed);
+        uint64_t eventsProduced = stats->eventsProduced.load(std::memory_order_relaxed);
+        uint64_t eventsDelivered = stats->eventsDelivered.load(std::memory_order_relaxed);
+        if (getCount == 0 && setCount == 0 && eventsProduced == 0 && eventsDelivered == 0) {
+            continue;
+        }
+        StringAppendF(&out, "%s (0x%" PRIx32 "):\n", propIdToString(stats->propId).c_str(),
+                      static_cast<uint32_t>(stats->propId));
+        if (getCount != 0) {
+            appendLatency(&out, "get", getCount, stats->getLatencyNanos.getSnapshot());
+        }
+        if (setCount != 0) {
+            appendLatency(&out, "set", setCount, stats->setLatencyNanos.getSnapshot());
+        }
+        if (eventsProduced != 0 || eventsDelivered != 0) {
+            StringAppendF(&out, "  events produced: %" PRIu64 ", delivered: %" PRIu64 "\n",
+                          eventsProduced, eventsDelivered);
+        }
+    }
+    return out;
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SharedMemoryPool.h"
+#include "ParcelableUtils.h"
+
+#include <aidl/android/hardware/automotive/vehicle/IVehicle.h>
+#include <android/binder_parcel.h>
+#include <cutils/ashmem.h>
+#include <utils/Log.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::IVehicle;
+using ::aidl::android::hardware::automotive::vehicle::StatusCode;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValues;
+using ::android::base::ErrnoError;
+using ::android::base::Result;
+using ::android::base::unique_fd;
+using ::ndk::ScopedAStatus;
+using ::ndk::ScopedFileDescriptor;
+
+constexpr char SHARED_MEMORY_NAME[] = "VehicleHalSharedMemory";
+
+// Rounds the size up to a power of two, and at least one page, so that a file that grows does not
+// need to be recreated for every slightly larger batch.
+size_t getCapacityForSize(size_t size) {
+    size_t capacity = static_cast<size_t>(getpagesize());
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+}  // namespace
+
+SharedMemoryPool::SharedMemoryPool(int32_t maxFileCount)
+    : mMaxFileCount(maxFileCount), mNextId(IVehicle::INVALID_MEMORY_ID + 1) {}
+
+SharedMemoryPool::~SharedMemoryPool() {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    for (auto& file : mFiles) {
+        destroyFile(&file);
+    }
+}
+
+void SharedMemoryPool::setMaxFileCount(int32_t maxFileCount) {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    mMaxFileCount = maxFileCount;
+    for (auto it = mFiles.begin();
+         it != mFiles.end() && mFiles.size() > static_cast<size_t>(mMaxFileCount);) {
+        if (it->inUse) {
+            it++;
+            continue;
+        }
+        destroyFile(&(*it));
+        it = mFiles.erase(it);
+    }
+}
+
+ScopedAStatus SharedMemoryPool::toStableLargeParcelable(std::vector<VehiclePropValue>&& values,
+                                                        VehiclePropValues* output) {
+    output->payloads = std::move(values);
+    output->sharedMemoryId = IVehicle::INVALID_MEMORY_ID;
+    output->sharedMemoryFd = ScopedFileDescriptor();
+
+    std::unique_ptr<AParcel, decltype(&AParcel_delete)> parcel(AParcel_create(), &AParcel_delete);
+    if (binder_status_t status = output->writeToParcel(parcel.get()); status != STATUS_OK) {
+        return ScopedAStatus::fromServiceSpecificErrorWithMessage(
+                toInt(StatusCode::INTERNAL_ERROR),
+                ("failed to write VehiclePropValues to parcel, status: " + std::to_string(status))
+                        .c_str());
+    }
+    size_t size = static_cast<size_t>(AParcel_getDataSize(parcel.get()));
+    if (size <= MAX_DIRECT_PAYLOAD_SIZE) {
+        return ScopedAStatus::ok();
+    }
+
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        MemoryFile* file = acquireFileLocked(size);
+        if (file != nullptr) {
+            if (binder_status_t status = AParcel_marshal(parcel.get(), file->address, 0, size);
+                status != STATUS_OK) {
+                file->inUse = false;
+                return ScopedAStatus::fromServiceSpecificErrorWithMessage(
+                        toInt(StatusCode::INTERNAL_ERROR),
+                        ("failed to marshal parcel into shared memory, status: " +
+                         std::to_string(status))
+                                .c_str());
+            }
+            int fd = dup(file->fd.get());
+            if (fd < 0) {
+                file->inUse = false;
+                return ScopedAStatus::fromServiceSpecificErrorWithMessage(
+                        toInt(StatusCode::INTERNAL_ERROR), "failed to dup shared memory file");
+            }
+            output->payloads.clear();
+            output->sharedMemoryId = file->id;
+            output->sharedMemoryFd = ScopedFileDescriptor(fd);
+            return ScopedAStatus::ok();
+        }
+    }
+
+    // The pool is disabled or all the pooled files are lent out, fall back to a one-off file.
+    std::vector<VehiclePropValue> payloads = std::move(output->payloads);
+    return vectorToStableLargeParcelable(std::move(payloads), output);
+}
+
+VhalResult<void> SharedMemoryPool::returnSharedMemory(int64_t sharedMemoryId) {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    for (auto it = mFiles.begin(); it != mFiles.end(); it++) {
+        if (it->id != sharedMemoryId) {
+            continue;
+        }
+        if (!it->inUse) {
+            return StatusError(StatusCode::INVALID_ARG)
+                   << "shared memory ID: " << sharedMemoryId << " is already returned";
+        }
+        it->inUse = false;
+        if (mFiles.size() > static_cast<size_t>(mMaxFileCount)) {
+            // The max file count was reduced while this file was lent out.
+            destroyFile(&(*it));
+            mFiles.erase(it);
+        }
+        return {};
+    }
+    return StatusError(StatusCode::INVALID_ARG)
+           << "unknown shared memory ID: " << sharedMemoryId;
+}
+
+int32_t SharedMemoryPool::getFileCount() const {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    return static_cast<int32_t>(mFiles.size());
+}
+
+int32_t SharedMemoryPool::getInUseFileCount() const {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    int32_t count = 0;
+    for (const auto& file : mFiles) {
+        if (file.inUse) {
+            count++;
+        }
+    }
+    return count;
+}
+
+SharedMemoryPool::MemoryFile* SharedMemoryPool::acquireFileLocked(size_t size) {
+    MemoryFile* smallFreeFile = nullptr;
+    for (auto& file : mFiles) {
+        if (file.inUse) {
+            continue;
+        }
+        if (file.capacity >= size) {
+            file.inUse = true;
+            return &file;
+        }
+        if (smallFreeFile == nullptr) {
+            smallFreeFile = &file;
+        }
+    }
+
+    if (smallFreeFile == nullptr && mFiles.size() >= static_cast<size_t>(mMaxFileCount)) {
+        return nullptr;
+    }
+
+    auto result = createFile(mNextId, getCapacityForSize(size));
+    if (!result.ok()) {
+        ALOGE("failed to create shared memory file of size: %zu, error: %s", size,
+              result.error().message().c_str());
+        return nullptr;
+    }
+    mNextId++;
+    MemoryFile* file = smallFreeFile;
+    if (file != nullptr) {
+        // Replace the free file that is too small, so that the file count stays the same.
+        destroyFile(file);
+        *file = std::move(result.value());
+    } else {
+        mFiles.push_back(std::move(result.value()));
+        file = &mFiles.back();
+    }
+    file->inUse = true;
+    return file;
+}
+
+Result<SharedMemoryPool::MemoryFile> SharedMemoryPool::createFile(int64_t id, size_t size) {
+    unique_fd fd(ashmem_create_region(SHARED_MEMORY_NAME, size));
+    if (!fd.ok()) {
+        return ErrnoError() << "failed to create shared memory region";
+    }
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (address == MAP_FAILED) {
+        return ErrnoError() << "failed to map shared memory region";
+    }
+    return MemoryFile{
+            .id = id,
+            .fd = std::move(fd),
+            .address = static_cast<uint8_t*>(address),
+            .capacity = size,
+            .inUse = false,
+    };
+}
+
+void SharedMemoryPool::destroyFile(MemoryFile* file) {
+    if (file->address != nullptr) {
+        munmap(file->address, file->capacity);
+        file->address = nullptr;
+    }
+    file->fd.reset();
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
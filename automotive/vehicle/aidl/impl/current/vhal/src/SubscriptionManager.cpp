@@ -59,7 +59,7 @@ SubscribeOptions newSubscribeOptions(int32_t propId, int32_t areaId, float sampl
 }  // namespace
 
 SubscriptionManager::SubscriptionManager(IVehicleHardware* vehicleHardware)
-    : mVehicleHardware(vehicleHardware) {}
+    : mVehicleHardware(vehicleHardware), mDispatchTable(std::make_shared<const DispatchTable>()) {}
 
 SubscriptionManager::~SubscriptionManager() {
     std::scoped_lock<std::mutex> lockGuard(mLock);
@@ -262,6 +262,15 @@ VhalResult<void> SubscriptionManager::subscribe(const std::shared_ptr<IVehicleCa
                                                 bool isContinuousProperty) {
     std::scoped_lock<std::mutex> lockGuard(mLock);
 
+    auto result = subscribeLocked(callback, options, isContinuousProperty);
+    // Part of the properties might be subscribed even if the result is not ok.
+    refreshDispatchTableLocked();
+    return result;
+}
+
+VhalResult<void> SubscriptionManager::subscribeLocked(
+        const std::shared_ptr<IVehicleCallback>& callback,
+        const std::vector<SubscribeOptions>& options, bool isContinuousProperty) {
     for (const auto& option : options) {
         float sampleRateHz = option.sampleRate;
 
@@ -346,6 +355,13 @@ VhalResult<void> SubscriptionManager::unsubscribe(SubscriptionManager::ClientIdT
                                                   const std::vector<int32_t>& propIds) {
     std::scoped_lock<std::mutex> lockGuard(mLock);
 
+    auto result = unsubscribeLocked(clientId, propIds);
+    refreshDispatchTableLocked();
+    return result;
+}
+
+VhalResult<void> SubscriptionManager::unsubscribeLocked(SubscriptionManager::ClientIdType clientId,
+                                                        const std::vector<int32_t>& propIds) {
     if (mSubscribedPropsByClient.find(clientId) == mSubscribedPropsByClient.end()) {
         ALOGW("No property was subscribed for the callback, unsubscribe does nothing");
         return {};
@@ -379,6 +395,18 @@ VhalResult<void> SubscriptionManager::unsubscribe(SubscriptionManager::ClientIdT
 VhalResult<void> SubscriptionManager::unsubscribe(SubscriptionManager::ClientIdType clientId) {
     std::scoped_lock<std::mutex> lockGuard(mLock);
 
+    auto result = unsubscribeLocked(clientId);
+    refreshDispatchTableLocked();
+    return result;
+}
+
+VhalResult<void> SubscriptionManager::unsubscribeLocked(
+        SubscriptionManager::ClientIdType clientId) {
+    {
+        std::scoped_lock<std::mutex> lockGuard(mSharedMemoryPoolsLock);
+        mSharedMemoryPoolsByClient.erase(clientId);
+    }
+
     if (mSubscribedPropsByClient.find(clientId) == mSubscribedPropsByClient.end()) {
         ALOGW("No property was subscribed for this client, unsubscribe does nothing");
     } else {
@@ -517,9 +545,56 @@ bool SubscriptionManager::isValueUpdatedLocked(const std::shared_ptr<IVehicleCal
     return true;
 }
 
+void SubscriptionManager::refreshDispatchTableLocked() {
+    auto table = std::make_shared<DispatchTable>();
+    table->reserve(mClientsByPropIdAreaId.size());
+    for (const auto& [propIdAreaId, callbackByClient] : mClientsByPropIdAreaId) {
+        // On-change properties do not have ContSubConfigs, so resolution is 0 and VUR is disabled.
+        const ContSubConfigs* subConfigs = nullptr;
+        if (auto it = mContSubConfigsByPropIdArea.find(propIdAreaId);
+            it != mContSubConfigsByPropIdArea.end()) {
+            subConfigs = &(it->second);
+        }
+        auto& targets = (*table)[propIdAreaId];
+        targets.reserve(callbackByClient.size());
+        for (const auto& [client, callback] : callbackByClient) {
+            DispatchTarget target = {
+                    .callback = callback,
+                    .resolution = 0.0f,
+                    .filterUnchangedValues = false,
+            };
+            if (subConfigs != nullptr) {
+                target.resolution = subConfigs->getResolutionForClient(client);
+                // If client wants VUR (and VUR is supported as checked in DefaultVehicleHal), it is
+                // possible that VUR is not enabled in IVehicleHardware because another client does
+                // not enable VUR. We will implement VUR filtering here for the client that enables
+                // it.
+                target.filterUnchangedValues =
+                        subConfigs->isVurEnabledForClient(client) && !subConfigs->isVurEnabled();
+            }
+            targets.push_back(std::move(target));
+        }
+    }
+
+    std::shared_ptr<const DispatchTable> oldTable;
+    {
+        std::scoped_lock<std::mutex> lockGuard(mDispatchTableLock);
+        oldTable = std::move(mDispatchTable);
+        mDispatchTable = std::move(table);
+    }
+    // The old table is released here, outside mDispatchTableLock, unless an event is still being
+    // dispatched with it.
+}
+
+std::shared_ptr<const SubscriptionManager::DispatchTable> SubscriptionManager::getDispatchTable()
+        const {
+    std::scoped_lock<std::mutex> lockGuard(mDispatchTableLock);
+    return mDispatchTable;
+}
+
 std::unordered_map<std::shared_ptr<IVehicleCallback>, std::vector<VehiclePropValue>>
 SubscriptionManager::getSubscribedClients(std::vector<VehiclePropValue>&& updatedValues) {
-    std::scoped_lock<std::mutex> lockGuard(mLock);
+    std::shared_ptr<const DispatchTable> table = getDispatchTable();
     std::unordered_map<std::shared_ptr<IVehicleCallback>, std::vector<VehiclePropValue>> clients;
 
     for (auto& value : updatedValues) {
@@ -527,29 +602,23 @@ SubscriptionManager::getSubscribedClients(std::vector<VehiclePropValue>&& update
                 .propId = value.prop,
                 .areaId = value.areaId,
         };
-        if (mClientsByPropIdAreaId.find(propIdAreaId) == mClientsByPropIdAreaId.end()) {
+        auto it = table->find(propIdAreaId);
+        if (it == table->end()) {
             continue;
         }
 
-        for (const auto& [client, callback] : mClientsByPropIdAreaId[propIdAreaId]) {
-            // if propId is on-change, propIdAreaId will not exist in mContSubConfigsByPropIdArea,
-            // returning an empty ContSubConfigs value for subConfigs i.e. with resolution = 0 and
-            // enableVur = false.
-            auto& subConfigs = mContSubConfigsByPropIdArea[propIdAreaId];
+        for (const auto& target : it->second) {
             // Clients must be sent different VehiclePropValues with different levels of granularity
             // as requested by the client using resolution.
             VehiclePropValue newValue = value;
-            sanitizeByResolution(&(newValue.value), subConfigs.getResolutionForClient(client));
-            // If client wants VUR (and VUR is supported as checked in DefaultVehicleHal), it is
-            // possible that VUR is not enabled in IVehicleHardware because another client does not
-            // enable VUR. We will implement VUR filtering here for the client that enables it.
-            if (subConfigs.isVurEnabledForClient(client) && !subConfigs.isVurEnabled()) {
-                if (isValueUpdatedLocked(callback, newValue)) {
-                    clients[callback].push_back(newValue);
+            sanitizeByResolution(&(newValue.value), target.resolution);
+            if (target.filterUnchangedValues) {
+                std::scoped_lock<std::mutex> lockGuard(mContSubValuesLock);
+                if (!isValueUpdatedLocked(target.callback, newValue)) {
+                    continue;
                 }
-            } else {
-                clients[callback].push_back(newValue);
             }
+            clients[target.callback].push_back(std::move(newValue));
         }
     }
     return clients;
@@ -558,7 +627,7 @@ SubscriptionManager::getSubscribedClients(std::vector<VehiclePropValue>&& update
 std::unordered_map<std::shared_ptr<IVehicleCallback>, std::vector<VehiclePropError>>
 SubscriptionManager::getSubscribedClientsForErrorEvents(
         const std::vector<SetValueErrorEvent>& errorEvents) {
-    std::scoped_lock<std::mutex> lockGuard(mLock);
+    std::shared_ptr<const DispatchTable> table = getDispatchTable();
     std::unordered_map<std::shared_ptr<IVehicleCallback>, std::vector<VehiclePropError>> clients;
 
     for (const auto& errorEvent : errorEvents) {
@@ -566,12 +635,13 @@ SubscriptionManager::getSubscribedClientsForErrorEvents(
                 .propId = errorEvent.propId,
                 .areaId = errorEvent.areaId,
         };
-        if (mClientsByPropIdAreaId.find(propIdAreaId) == mClientsByPropIdAreaId.end()) {
+        auto it = table->find(propIdAreaId);
+        if (it == table->end()) {
             continue;
         }
 
-        for (const auto& [_, client] : mClientsByPropIdAreaId[propIdAreaId]) {
-            clients[client].push_back({
+        for (const auto& target : it->second) {
+            clients[target.callback].push_back({
                     .propId = errorEvent.propId,
                     .areaId = errorEvent.areaId,
                     .errorCode = errorEvent.errorCode,
@@ -600,6 +670,38 @@ SubscriptionManager::getSubscribedClientsForSupportedValueChange(
     return propIdAreaIdsByClient;
 }
 
+void SubscriptionManager::setMaxSharedMemoryFileCount(SubscriptionManager::ClientIdType clientId,
+                                                      int32_t maxSharedMemoryFileCount) {
+    std::scoped_lock<std::mutex> lockGuard(mSharedMemoryPoolsLock);
+    auto it = mSharedMemoryPoolsByClient.find(clientId);
+    if (it == mSharedMemoryPoolsByClient.end()) {
+        mSharedMemoryPoolsByClient[clientId] =
+                std::make_shared<SharedMemoryPool>(maxSharedMemoryFileCount);
+        return;
+    }
+    it->second->setMaxFileCount(maxSharedMemoryFileCount);
+}
+
+std::shared_ptr<SharedMemoryPool> SubscriptionManager::getSharedMemoryPool(
+        SubscriptionManager::ClientIdType clientId) {
+    std::scoped_lock<std::mutex> lockGuard(mSharedMemoryPoolsLock);
+    auto it = mSharedMemoryPoolsByClient.find(clientId);
+    if (it == mSharedMemoryPoolsByClient.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+VhalResult<void> SubscriptionManager::returnSharedMemory(SubscriptionManager::ClientIdType clientId,
+                                                         int64_t sharedMemoryId) {
+    std::shared_ptr<SharedMemoryPool> pool = getSharedMemoryPool(clientId);
+    if (pool == nullptr) {
+        return StatusError(StatusCode::INVALID_ARG)
+               << "no shared memory was lent to the client, ID: " << sharedMemoryId;
+    }
+    return pool->returnSharedMemory(sharedMemoryId);
+}
+
 bool SubscriptionManager::isEmpty() {
     std::scoped_lock<std::mutex> lockGuard(mLock);
     return mSubscribedPropsByClient.empty() && mClientsByPropIdAreaId.empty() &&
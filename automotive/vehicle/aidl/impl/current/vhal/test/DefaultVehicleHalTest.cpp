@@ -1385,6 +1385,85 @@ TEST_F(DefaultVehicleHalTest, testSubscribeGlobalOnChangeNormal) {
             << "expect 2 clients, 1 subscribe client and 1 setvalue client";
 }
 
+TEST_F(DefaultVehicleHalTest, testSubscribeLargeEventUsesPooledSharedMemory) {
+    std::vector<SubscribeOptions> options = {
+            {
+                    .propId = GLOBAL_ON_CHANGE_PROP,
+            },
+    };
+
+    auto status = getClient()->subscribe(getCallbackClient(), options,
+                                         /*maxSharedMemoryFileCount=*/1);
+
+    ASSERT_TRUE(status.isOk()) << "subscribe failed: " << status.getMessage();
+
+    VehiclePropValue testValue{
+            .prop = GLOBAL_ON_CHANGE_PROP,
+            .value.int32Values = std::vector<int32_t>(5000, 1),
+    };
+    SetValueRequests setValueRequests = {
+            .payloads =
+                    {
+                            SetValueRequest{
+                                    .requestId = 0,
+                                    .value = testValue,
+                            },
+                    },
+    };
+    std::vector<SetValueResult> setValueResults = {{
+            .requestId = 0,
+            .status = StatusCode::OK,
+    }};
+
+    // Set the value to trigger a property change event.
+    getHardware()->addSetValueResponses(setValueResults);
+    status = getClient()->setValues(getCallbackClient(), setValueRequests);
+
+    ASSERT_TRUE(status.isOk()) << "setValues failed: " << status.getMessage();
+
+    auto maybeResults = getCallback()->nextOnPropertyEventResults();
+    ASSERT_TRUE(maybeResults.has_value()) << "no results in callback";
+    const VehiclePropValues& results = maybeResults.value();
+    ASSERT_TRUE(results.payloads.empty())
+            << "payload should be empty, shared memory file should be used";
+    ASSERT_NE(results.sharedMemoryId, IVehicle::INVALID_MEMORY_ID)
+            << "shared memory file must come from the pool";
+
+    auto result = LargeParcelableBase::stableLargeParcelableToParcelable(results);
+    ASSERT_TRUE(result.ok()) << "failed to parse shared memory file";
+    ASSERT_THAT(result.value().getObject()->payloads, ElementsAre(testValue));
+
+    status = getClient()->returnSharedMemory(getCallbackClient(), results.sharedMemoryId);
+
+    ASSERT_TRUE(status.isOk()) << "returnSharedMemory failed: " << status.getMessage();
+
+    status = getClient()->returnSharedMemory(getCallbackClient(), results.sharedMemoryId);
+
+    ASSERT_FALSE(status.isOk()) << "returning the same shared memory twice must fail";
+    ASSERT_EQ(status.getServiceSpecificError(), toInt(StatusCode::INVALID_ARG));
+}
+
+TEST_F(DefaultVehicleHalTest, testSubscribeInvalidMaxSharedMemoryFileCount) {
+    std::vector<SubscribeOptions> options = {
+            {
+                    .propId = GLOBAL_ON_CHANGE_PROP,
+            },
+    };
+
+    auto status = getClient()->subscribe(getCallbackClient(), options,
+                                         /*maxSharedMemoryFileCount=*/-1);
+
+    ASSERT_FALSE(status.isOk()) << "negative maxSharedMemoryFileCount must fail";
+    ASSERT_EQ(status.getServiceSpecificError(), toInt(StatusCode::INVALID_ARG));
+}
+
+TEST_F(DefaultVehicleHalTest, testReturnSharedMemoryUnknownId) {
+    auto status = getClient()->returnSharedMemory(getCallbackClient(), 1);
+
+    ASSERT_FALSE(status.isOk()) << "returning an unknown shared memory ID must fail";
+    ASSERT_EQ(status.getServiceSpecificError(), toInt(StatusCode::INVALID_ARG));
+}
+
 TEST_F(DefaultVehicleHalTest, testSubscribeGlobalOnchangeUnrelatedEventIgnored) {
     std::vector<SubscribeOptions> options = {
             {
@@ -2002,6 +2081,85 @@ TEST_F(DefaultVehicleHalTest, testDumpCallerShouldNotDump) {
     ASSERT_EQ(msg.find("Vehicle HAL State: "), std::string::npos);
 }
 
+TEST_F(DefaultVehicleHalTest, testDumpPropertyStats) {
+    GetValueRequests requests;
+    std::vector<GetValueResult> expectedResults;
+    std::vector<GetValueRequest> expectedHardwareRequests;
+
+    ASSERT_TRUE(getValuesTestCases(1, requests, expectedResults, expectedHardwareRequests).ok());
+
+    getHardware()->addGetValueResponses(expectedResults);
+
+    auto status = getClient()->getValues(getCallbackClient(), requests);
+
+    ASSERT_TRUE(status.isOk()) << "getValues failed: " << status.getMessage();
+    ASSERT_TRUE(getCallback()->nextGetValueResults().has_value()) << "no results in callback";
+
+    std::string buffer = "Dump from hardware";
+    getHardware()->setDumpResult({
+            .callerShouldDumpState = true,
+            .buffer = buffer,
+    });
+    int fd = memfd_create("memfile", 0);
+    const char* args[] = {"--vhal-stats", "--reset"};
+    getClient()->dump(fd, args, 2);
+
+    lseek(fd, 0, SEEK_SET);
+    char buf[10240] = {};
+    read(fd, buf, sizeof(buf));
+    close(fd);
+
+    std::string msg(buf);
+
+    ASSERT_THAT(msg, ContainsRegex("get: 1 requests, latency\\(us\\) mean: [0-9]+"));
+    ASSERT_THAT(msg, ContainsRegex("Property stats reset"));
+    ASSERT_EQ(msg.find(buffer), std::string::npos) << "stats dump must not be passed to hardware";
+
+    fd = memfd_create("memfile", 0);
+    getClient()->dump(fd, args, 1);
+
+    lseek(fd, 0, SEEK_SET);
+    char bufAfterReset[10240] = {};
+    read(fd, bufAfterReset, sizeof(bufAfterReset));
+    close(fd);
+
+    ASSERT_EQ(std::string(bufAfterReset).find("get:"), std::string::npos)
+            << "stats must be empty after reset";
+}
+
+TEST_F(DefaultVehicleHalTest, testDumpPropertyStatsSkipsInvalidRequests) {
+    GetValueRequests requests = {
+            .sharedMemoryFd = {},
+            .payloads =
+                    {
+                            {
+                                    .requestId = 0,
+                                    .prop =
+                                            {
+                                                    .prop = INVALID_PROP_ID,
+                                            },
+                            },
+                    },
+    };
+
+    auto status = getClient()->getValues(getCallbackClient(), requests);
+
+    ASSERT_TRUE(status.isOk()) << "getValues failed: " << status.getMessage();
+    ASSERT_TRUE(getCallback()->nextGetValueResults().has_value()) << "no results in callback";
+
+    int fd = memfd_create("memfile", 0);
+    const char* args[] = {"--vhal-stats"};
+    getClient()->dump(fd, args, 1);
+
+    lseek(fd, 0, SEEK_SET);
+    char buf[10240] = {};
+    read(fd, buf, sizeof(buf));
+    close(fd);
+
+    ASSERT_EQ(std::string(buf).find("get:"), std::string::npos)
+            << "requests failing the config check must not be recorded";
+}
+
 TEST_F(DefaultVehicleHalTest, testOnPropertySetErrorEvent) {
     std::vector<SubscribeOptions> options = {
             {
@@ -48,6 +48,20 @@ static ScopedAStatus storeResults(const T& results, std::list<T>* storedResults)
     return ScopedAStatus::ok();
 }
 
+static ScopedAStatus storeResults(const VehiclePropValues& results,
+                                  std::list<VehiclePropValues>* storedResults) {
+    VehiclePropValues resultsCopy{
+            .payloads = results.payloads,
+            .sharedMemoryId = results.sharedMemoryId,
+    };
+    int fd = results.sharedMemoryFd.get();
+    if (fd != -1) {
+        resultsCopy.sharedMemoryFd = ScopedFileDescriptor(dup(fd));
+    }
+    storedResults->push_back(std::move(resultsCopy));
+    return ScopedAStatus::ok();
+}
+
 }  // namespace
 
 ScopedAStatus MockVehicleCallback::onGetValues(const GetValueResults& results) {
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PropertyStats.h"
+
+#include <VehicleUtils.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehicleProperty;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+constexpr int32_t PROP_1 = toInt(VehicleProperty::PERF_VEHICLE_SPEED);
+constexpr int32_t PROP_2 = toInt(VehicleProperty::HVAC_FAN_SPEED);
+
+}  // namespace
+
+TEST(PropertyStatsTest, testGetStatsUnknownProperty) {
+    PropertyStatsCollector collector;
+
+    ASSERT_EQ(collector.getStats(PROP_1), nullptr);
+}
+
+TEST(PropertyStatsTest, testRecordRequests) {
+    PropertyStatsCollector collector;
+
+    collector.recordGetRequest(PROP_1);
+    collector.recordGetRequest(PROP_1);
+    collector.recordSetRequest(PROP_2);
+    collector.recordGetLatency(PROP_1, 1000);
+    collector.recordSetLatency(PROP_2, 2000);
+
+    const PropertyStats* stats1 = collector.getStats(PROP_1);
+    ASSERT_NE(stats1, nullptr);
+    ASSERT_EQ(stats1->getCount, 2u);
+    ASSERT_EQ(stats1->setCount, 0u);
+    ASSERT_EQ(stats1->getLatencyNanos.getSnapshot().count, 1u);
+    ASSERT_EQ(stats1->getLatencyNanos.getSnapshot().max, 1000);
+
+    const PropertyStats* stats2 = collector.getStats(PROP_2);
+    ASSERT_NE(stats2, nullptr);
+    ASSERT_EQ(stats2->setCount, 1u);
+    ASSERT_EQ(stats2->setLatencyNanos.getSnapshot().max, 2000);
+}
+
+TEST(PropertyStatsTest, testRecordEvents) {
+    PropertyStatsCollector collector;
+    std::vector<VehiclePropValue> produced = {
+            {.prop = PROP_1}, {.prop = PROP_1}, {.prop = PROP_2}, {.prop = PROP_1}};
+    std::vector<VehiclePropValue> delivered = {{.prop = PROP_1}};
+
+    collector.recordEventBatchSize(produced.size());
+    collector.recordEventsProduced(produced);
+    collector.recordEventsDelivered(delivered);
+
+    ASSERT_EQ(collector.getStats(PROP_1)->eventsProduced, 3u);
+    ASSERT_EQ(collector.getStats(PROP_1)->eventsDelivered, 1u);
+    ASSERT_EQ(collector.getStats(PROP_2)->eventsProduced, 1u);
+    ASSERT_EQ(collector.getStats(PROP_2)->eventsDelivered, 0u);
+    ASSERT_EQ(collector.getEventBatchSizeSnapshot().count, 1u);
+    ASSERT_EQ(collector.getEventBatchSizeSnapshot().max, 4);
+}
+
+TEST(PropertyStatsTest, testReset) {
+    PropertyStatsCollector collector;
+    collector.recordGetRequest(PROP_1);
+    collector.recordGetLatency(PROP_1, 1000);
+    collector.recordEventBatchSize(1);
+
+    collector.reset();
+
+    const PropertyStats* stats = collector.getStats(PROP_1);
+    ASSERT_NE(stats, nullptr);
+    ASSERT_EQ(stats->getCount, 0u);
+    ASSERT_EQ(stats->getLatencyNanos.getSnapshot().count, 0u);
+    ASSERT_EQ(collector.getEventBatchSizeSnapshot().count, 0u);
+}
+
+TEST(PropertyStatsTest, testDump) {
+    PropertyStatsCollector collector;
+    collector.recordGetRequest(PROP_1);
+    collector.recordGetLatency(PROP_1, 5000);
+    collector.recordSetRequest(PROP_2);
+    collector.reset();
+    collector.recordGetRequest(PROP_1);
+    collector.recordGetLatency(PROP_1, 5000);
+
+    std::string dump = collector.dump();
+
+    ASSERT_THAT(dump, HasSubstr("PERF_VEHICLE_SPEED"));
+    ASSERT_THAT(dump, HasSubstr("get: 1 requests, latency(us) mean: 5"));
+    // Properties without activity since the reset are not shown.
+    ASSERT_THAT(dump, Not(HasSubstr("HVAC_FAN_SPEED")));
+}
+
+TEST(PropertyStatsTest, testConcurrentRecord) {
+    PropertyStatsCollector collector;
+    constexpr int threadCount = 8;
+    constexpr int propCount = 100;
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back([&collector] {
+            for (int propId = 1; propId <= propCount; propId++) {
+                collector.recordGetRequest(propId);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (int propId = 1; propId <= propCount; propId++) {
+        const PropertyStats* stats = collector.getStats(propId);
+        ASSERT_NE(stats, nullptr);
+        ASSERT_EQ(stats->getCount, static_cast<uint64_t>(threadCount));
+    }
+}
+
+TEST(PropertyStatsTest, testTableFull) {
+    PropertyStatsCollector collector;
+    constexpr int propCount = 5000;
+
+    for (int propId = 1; propId <= propCount; propId++) {
+        collector.recordGetRequest(propId);
+    }
+
+    int trackedCount = 0;
+    for (int propId = 1; propId <= propCount; propId++) {
+        if (collector.getStats(propId) != nullptr) {
+            trackedCount++;
+        }
+    }
+    // The table stops taking new properties when it is half full.
+    ASSERT_EQ(trackedCount, 2048);
+    ASSERT_NE(collector.getStats(1), nullptr);
+    ASSERT_EQ(collector.getStats(propCount), nullptr);
+
+    // Properties already in the table are still recorded.
+    collector.recordGetRequest(1);
+    ASSERT_EQ(collector.getStats(1)->getCount, 2u);
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SharedMemoryPool.h"
+
+#include <LargeParcelableBase.h>
+#include <aidl/android/hardware/automotive/vehicle/IVehicle.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+using ::aidl::android::hardware::automotive::vehicle::IVehicle;
+using ::aidl::android::hardware::automotive::vehicle::StatusCode;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValues;
+using ::android::automotive::car_binder_lib::LargeParcelableBase;
+
+namespace {
+
+std::vector<VehiclePropValue> getTestValues(size_t count) {
+    std::vector<VehiclePropValue> values;
+    for (size_t i = 0; i < count; i++) {
+        values.push_back({
+                .prop = static_cast<int32_t>(i),
+                .value.int32Values = {static_cast<int32_t>(i)},
+        });
+    }
+    return values;
+}
+
+}  // namespace
+
+TEST(SharedMemoryPoolTest, testSmallValuesInPayloads) {
+    SharedMemoryPool pool(/*maxFileCount=*/2);
+    auto values = getTestValues(1);
+    VehiclePropValues output;
+
+    auto status = pool.toStableLargeParcelable(std::vector<VehiclePropValue>(values), &output);
+
+    ASSERT_TRUE(status.isOk()) << status.getMessage();
+    EXPECT_EQ(output.payloads, values);
+    EXPECT_EQ(output.sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    EXPECT_EQ(output.sharedMemoryFd.get(), -1);
+    EXPECT_EQ(pool.getFileCount(), 0);
+}
+
+TEST(SharedMemoryPoolTest, testLargeValuesInPooledFile) {
+    SharedMemoryPool pool(/*maxFileCount=*/2);
+    auto values = getTestValues(1000);
+    VehiclePropValues output;
+
+    auto status = pool.toStableLargeParcelable(std::vector<VehiclePropValue>(values), &output);
+
+    ASSERT_TRUE(status.isOk()) << status.getMessage();
+    EXPECT_TRUE(output.payloads.empty());
+    EXPECT_NE(output.sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    EXPECT_EQ(pool.getFileCount(), 1);
+    EXPECT_EQ(pool.getInUseFileCount(), 1);
+
+    auto result = LargeParcelableBase::stableLargeParcelableToParcelable(output);
+    ASSERT_TRUE(result.ok()) << "failed to parse shared memory file";
+    EXPECT_EQ(result.value().getObject()->payloads, values);
+}
+
+TEST(SharedMemoryPoolTest, testReuseReturnedFile) {
+    SharedMemoryPool pool(/*maxFileCount=*/1);
+    VehiclePropValues output1;
+    VehiclePropValues output2;
+
+    ASSERT_TRUE(pool.toStableLargeParcelable(getTestValues(1000), &output1).isOk());
+    ASSERT_TRUE(pool.returnSharedMemory(output1.sharedMemoryId).ok());
+
+    auto values = getTestValues(500);
+    ASSERT_TRUE(pool.toStableLargeParcelable(std::vector<VehiclePropValue>(values), &output2)
+                        .isOk());
+
+    EXPECT_EQ(output2.sharedMemoryId, output1.sharedMemoryId)
+            << "the returned file must be reused";
+    EXPECT_EQ(pool.getFileCount(), 1);
+
+    auto result = LargeParcelableBase::stableLargeParcelableToParcelable(output2);
+    ASSERT_TRUE(result.ok()) << "failed to parse shared memory file";
+    EXPECT_EQ(result.value().getObject()->payloads, values);
+}
+
+TEST(SharedMemoryPoolTest, testGrowReturnedFile) {
+    SharedMemoryPool pool(/*maxFileCount=*/1);
+    VehiclePropValues output1;
+    VehiclePropValues output2;
+
+    ASSERT_TRUE(pool.toStableLargeParcelable(getTestValues(500), &output1).isOk());
+    ASSERT_TRUE(pool.returnSharedMemory(output1.sharedMemoryId).ok());
+
+    auto values = getTestValues(20000);
+    ASSERT_TRUE(pool.toStableLargeParcelable(std::vector<VehiclePropValue>(values), &output2)
+                        .isOk());
+
+    EXPECT_NE(output2.sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    EXPECT_EQ(pool.getFileCount(), 1) << "the small file must be replaced";
+
+    auto result = LargeParcelableBase::stableLargeParcelableToParcelable(output2);
+    ASSERT_TRUE(result.ok()) << "failed to parse shared memory file";
+    EXPECT_EQ(result.value().getObject()->payloads, values);
+}
+
+TEST(SharedMemoryPoolTest, testFallbackWhenExhausted) {
+    SharedMemoryPool pool(/*maxFileCount=*/1);
+    VehiclePropValues output1;
+    VehiclePropValues output2;
+
+    ASSERT_TRUE(pool.toStableLargeParcelable(getTestValues(1000), &output1).isOk());
+    auto values = getTestValues(1000);
+    ASSERT_TRUE(pool.toStableLargeParcelable(std::vector<VehiclePropValue>(values), &output2)
+                        .isOk());
+
+    EXPECT_EQ(output2.sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    EXPECT_NE(output2.sharedMemoryFd.get(), -1) << "must fall back to a one-off file";
+    EXPECT_EQ(pool.getFileCount(), 1);
+
+    auto result = LargeParcelableBase::stableLargeParcelableToParcelable(output2);
+    ASSERT_TRUE(result.ok()) << "failed to parse shared memory file";
+    EXPECT_EQ(result.value().getObject()->payloads, values);
+}
+
+TEST(SharedMemoryPoolTest, testZeroMaxFileCount) {
+    SharedMemoryPool pool(/*maxFileCount=*/0);
+    VehiclePropValues output;
+
+    ASSERT_TRUE(pool.toStableLargeParcelable(getTestValues(1000), &output).isOk());
+
+    EXPECT_EQ(output.sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    EXPECT_NE(output.sharedMemoryFd.get(), -1);
+    EXPECT_EQ(pool.getFileCount(), 0);
+}
+
+TEST(SharedMemoryPoolTest, testReturnInvalidId) {
+    SharedMemoryPool pool(/*maxFileCount=*/1);
+    VehiclePropValues output;
+
+    ASSERT_TRUE(pool.toStableLargeParcelable(getTestValues(1000), &output).isOk());
+
+    auto result = pool.returnSharedMemory(output.sharedMemoryId + 1);
+    ASSERT_FALSE(result.ok());
+    EXPECT_EQ(getErrorCode(result), StatusCode::INVALID_ARG);
+
+    ASSERT_TRUE(pool.returnSharedMemory(output.sharedMemoryId).ok());
+    result = pool.returnSharedMemory(output.sharedMemoryId);
+    ASSERT_FALSE(result.ok()) << "returning a file twice must fail";
+    EXPECT_EQ(getErrorCode(result), StatusCode::INVALID_ARG);
+}
+
+TEST(SharedMemoryPoolTest, testReduceMaxFileCount) {
+    SharedMemoryPool pool(/*maxFileCount=*/2);
+    VehiclePropValues output1;
+    VehiclePropValues output2;
+
+    ASSERT_TRUE(pool.toStableLargeParcelable(getTestValues(1000), &output1).isOk());
+    ASSERT_TRUE(pool.toStableLargeParcelable(getTestValues(1000), &output2).isOk());
+    ASSERT_EQ(pool.getFileCount(), 2);
+
+    pool.setMaxFileCount(1);
+
+    EXPECT_EQ(pool.getFileCount(), 2) << "files lent out must not be released";
+
+    ASSERT_TRUE(pool.returnSharedMemory(output1.sharedMemoryId).ok());
+
+    EXPECT_EQ(pool.getFileCount(), 1);
+    EXPECT_EQ(pool.getInUseFileCount(), 1);
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
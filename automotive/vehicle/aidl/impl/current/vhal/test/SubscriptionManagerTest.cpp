@@ -25,6 +25,7 @@
 #include <gtest/gtest.h>
 
 #include <float.h>
+#include <atomic>
 #include <chrono>
 #include <list>
 #include <memory>
@@ -41,6 +42,7 @@ using ::aidl::android::hardware::automotive::vehicle::BnVehicleCallback;
 using ::aidl::android::hardware::automotive::vehicle::GetValueResults;
 using ::aidl::android::hardware::automotive::vehicle::IVehicleCallback;
 using ::aidl::android::hardware::automotive::vehicle::SetValueResults;
+using ::aidl::android::hardware::automotive::vehicle::StatusCode;
 using ::aidl::android::hardware::automotive::vehicle::SubscribeOptions;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropErrors;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyStatus;
@@ -520,6 +522,89 @@ TEST_F(SubscriptionManagerTest, testUnsubscribeOnchange) {
                 UnorderedElementsAre(std::pair<int32_t, int32_t>(1, 0)));
 }
 
+TEST_F(SubscriptionManagerTest, testGetSubscribedClientsForErrorEventsAfterUnsubscribe) {
+    std::vector<SubscribeOptions> options = {
+            {
+                    .propId = 0,
+                    .areaIds = {0},
+            },
+            {
+                    .propId = 1,
+                    .areaIds = {0},
+            },
+    };
+
+    auto result = getManager()->subscribe(getCallbackClient(), options, false);
+    ASSERT_TRUE(result.ok()) << "failed to subscribe: " << result.error().message();
+
+    result = getManager()->unsubscribe(getCallbackClient()->asBinder().get(),
+                                       std::vector<int32_t>({0}));
+    ASSERT_TRUE(result.ok()) << "failed to unsubscribe: " << result.error().message();
+
+    auto clients = getManager()->getSubscribedClientsForErrorEvents({
+            {
+                    .errorCode = StatusCode::INTERNAL_ERROR,
+                    .propId = 0,
+                    .areaId = 0,
+            },
+            {
+                    .errorCode = StatusCode::INTERNAL_ERROR,
+                    .propId = 1,
+                    .areaId = 0,
+            },
+    });
+
+    ASSERT_EQ(clients.size(), 1u);
+    ASSERT_EQ(clients[getCallbackClient()].size(), 1u);
+    EXPECT_EQ(clients[getCallbackClient()][0].propId, 1);
+}
+
+TEST_F(SubscriptionManagerTest, testGetSubscribedClientsConcurrentWithSubscribe) {
+    SpAIBinder binder1 = ndk::SharedRefBase::make<PropertyCallback>()->asBinder();
+    std::shared_ptr<IVehicleCallback> client1 = IVehicleCallback::fromBinder(binder1);
+    SpAIBinder binder2 = ndk::SharedRefBase::make<PropertyCallback>()->asBinder();
+    std::shared_ptr<IVehicleCallback> client2 = IVehicleCallback::fromBinder(binder2);
+
+    auto result = getManager()->subscribe(client1, {{.propId = 0, .areaIds = {0}}}, false);
+    ASSERT_TRUE(result.ok()) << "failed to subscribe: " << result.error().message();
+
+    std::atomic<bool> stop = false;
+    std::thread subscribeThread([this, client2, &stop] {
+        while (!stop) {
+            getManager()->subscribe(client2, {{.propId = 0, .areaIds = {0}}}, false);
+            getManager()->subscribe(client2, {{.propId = 1, .areaIds = {0}}}, false);
+            getManager()->unsubscribe(client2->asBinder().get());
+        }
+    });
+
+    std::vector<VehiclePropValue> updatedValues = {
+            {
+                    .prop = 0,
+                    .areaId = 0,
+            },
+            {
+                    .prop = 1,
+                    .areaId = 0,
+            },
+    };
+    for (size_t i = 0; i < 1000; i++) {
+        auto clients =
+                getManager()->getSubscribedClients(std::vector<VehiclePropValue>(updatedValues));
+
+        // client1 is subscribed the whole time, it must always receive the event regardless of
+        // which snapshot is used.
+        ASSERT_THAT(clients[client1], ElementsAre(updatedValues[0]));
+        // client2 only ever subscribes to [1, 0] after [0, 0] and each snapshot is consistent,
+        // so it must never see [1, 0] without [0, 0].
+        if (clients.find(client2) != clients.end()) {
+            ASSERT_THAT(clients[client2], Contains(updatedValues[0]));
+        }
+    }
+
+    stop = true;
+    subscribeThread.join();
+}
+
 TEST_F(SubscriptionManagerTest, testCheckSampleRateHzValid) {
     ASSERT_TRUE(SubscriptionManager::checkSampleRateHz(1.0));
 }
@@ -37,6 +37,7 @@
 #include <linux/videodev2.h>
 #include <sync/sync.h>
 #include <utils/Trace.h>
+#include <algorithm>
 #include <deque>
 
 #define HAVE_JPEG  // required for libyuv.h to export MJPEG decode APIs
@@ -1017,14 +1018,21 @@ status_t ExternalCameraDeviceSession::initDefaultRequests() {
     return OK;
 }
 
-status_t ExternalCameraDeviceSession::fillCaptureResult(common::V1_0::helper::CameraMetadata& md,
-                                                        nsecs_t timestamp) {
+status_t ExternalCameraDeviceSession::fillCaptureResult(
+        const common::V1_0::helper::CameraMetadata& settings, nsecs_t timestamp) {
+    const camera_metadata_t* rawSettings = settings.getAndLock();
+    status_t res = mResultMetadataBuilder.reset(rawSettings);
+    settings.unlock(rawSettings);
+    if (res != OK) {
+        return res;
+    }
+
     bool afTrigger = false;
     {
         std::lock_guard<std::mutex> lk(mAfTriggerLock);
         afTrigger = mAfTrigger;
-        if (md.exists(ANDROID_CONTROL_AF_TRIGGER)) {
-            camera_metadata_entry entry = md.find(ANDROID_CONTROL_AF_TRIGGER);
+        if (settings.exists(ANDROID_CONTROL_AF_TRIGGER)) {
+            camera_metadata_ro_entry entry = settings.find(ANDROID_CONTROL_AF_TRIGGER);
             if (entry.data.u8[0] == ANDROID_CONTROL_AF_TRIGGER_START) {
                 mAfTrigger = afTrigger = true;
             } else if (entry.data.u8[0] == ANDROID_CONTROL_AF_TRIGGER_CANCEL) {
@@ -1042,12 +1050,12 @@ status_t ExternalCameraDeviceSession::fillCaptureResult(common::V1_0::helper::Ca
     } else {
         afState = ANDROID_CONTROL_AF_STATE_INACTIVE;
     }
-    UPDATE(md, ANDROID_CONTROL_AF_STATE, &afState, 1);
+    mResultMetadataBuilder.set(RESULT_AF_STATE, &afState);
 
     camera_metadata_ro_entry activeArraySize =
             mCameraCharacteristics.find(ANDROID_SENSOR_INFO_ACTIVE_ARRAY_SIZE);
 
-    return fillCaptureResultCommon(md, timestamp, activeArraySize);
+    return fillCaptureResultCommon(mResultMetadataBuilder, timestamp, activeArraySize);
 }
 
 int ExternalCameraDeviceSession::configureV4l2StreamLocked(const SupportedV4L2Format& v4l2Fmt,
@@ -1547,7 +1555,7 @@ void ExternalCameraDeviceSession::notifyError(int32_t frameNumber, int32_t strea
 }
 
 void ExternalCameraDeviceSession::invokeProcessCaptureResultCallback(
-        std::vector<CaptureResult>& results, bool tryWriteFmq) {
+        std::vector<CaptureResult>& results, bool tryWriteFmq, const camera_metadata_t* rawResult) {
     if (mProcessCaptureResultLock.tryLock() != OK) {
         const nsecs_t NS_TO_SECOND = 1000000000;
         ALOGV("%s: previous call is not finished! waiting 1s...", __FUNCTION__);
@@ -1556,7 +1564,21 @@ void ExternalCameraDeviceSession::invokeProcessCaptureResultCallback(
             return;
         }
     }
-    if (tryWriteFmq && mResultMetadataQueue->availableToWrite() > 0) {
+    if (rawResult != nullptr) {
+        CaptureResult& result = results[0];
+        const size_t size = get_camera_metadata_size(rawResult);
+        result.fmqResultSize = 0;
+        if (tryWriteFmq && mResultMetadataQueue->availableToWrite() >= size) {
+            if (mResultMetadataQueue->write(reinterpret_cast<const int8_t*>(rawResult), size)) {
+                result.fmqResultSize = size;
+            } else {
+                ALOGW("%s: couldn't utilize fmq, fall back to hwbinder", __FUNCTION__);
+            }
+        }
+        if (result.fmqResultSize == 0) {
+            convertToAidl(rawResult, &result.result);
+        }
+    } else if (tryWriteFmq && mResultMetadataQueue->availableToWrite() > 0) {
         for (CaptureResult& result : results) {
             CameraMetadata& md = result.result;
             if (!md.metadata.empty()) {
@@ -1824,11 +1846,16 @@ Status ExternalCameraDeviceSession::processCaptureResult(std::shared_ptr<HalRequ
         }
     }
 
-    // Fill capture result metadata
-    fillCaptureResult(req->setting, req->shutterTs);
-    const camera_metadata_t* rawResult = req->setting.getAndLock();
-    convertToAidl(rawResult, &result.result);
-    req->setting.unlock(rawResult);
+    // Fill capture result metadata, it's written to the FMQ with the callback
+    const camera_metadata_t* rawResult = nullptr;
+    if (fillCaptureResult(req->setting, req->shutterTs) == OK) {
+        rawResult = mResultMetadataBuilder.get();
+    } else {
+        ALOGE("%s: cannot fill the result metadata of frame %d", __FUNCTION__, req->frameNumber);
+        const camera_metadata_t* rawSettings = req->setting.getAndLock();
+        convertToAidl(rawSettings, &result.result);
+        req->setting.unlock(rawSettings);
+    }
 
     // update inflight records
     {
@@ -1837,7 +1864,7 @@ Status ExternalCameraDeviceSession::processCaptureResult(std::shared_ptr<HalRequ
     }
 
     // Callback into framework
-    invokeProcessCaptureResultCallback(results, /* tryWriteFmq */ true);
+    invokeProcessCaptureResultCallback(results, /* tryWriteFmq */ true, rawResult);
     freeReleaseFences(results);
     return Status::OK;
 }
@@ -2162,6 +2189,7 @@ ExternalCameraDeviceSession::OutputThread::OutputThread(
     : mParent(parent),
       mCroppingType(ct),
       mCameraCharacteristics(chars),
+      mScaledYu12Frames(ct),
       mBufferRequestThread(bufReqThread) {}
 
 ExternalCameraDeviceSession::OutputThread::~OutputThread() {}
@@ -2187,6 +2215,16 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
             return Status::INTERNAL_ERROR;
         }
     }
+    if (mNextYu12Frame == nullptr || mNextYu12Frame->mWidth != v4lSize.width ||
+        mNextYu12Frame->mHeight != v4lSize.height) {
+        mNextYu12Frame.reset();
+        mNextYu12Frame = std::make_shared<AllocatedFrame>(v4lSize.width, v4lSize.height);
+        int ret = mNextYu12Frame->allocate(&mNextYu12FrameLayout);
+        if (ret != 0) {
+            ALOGE("%s: allocating next YU12 frame failed!", __FUNCTION__);
+            return Status::INTERNAL_ERROR;
+        }
+    }
 
     // Allocating intermediate YU12 thumbnail frame
     if (mYu12ThumbFrame == nullptr || mYu12ThumbFrame->mWidth != thumbSize.width ||
@@ -2265,12 +2303,15 @@ void ExternalCameraDeviceSession::OutputThread::flush() {
     std::unique_lock<std::mutex> lk(mRequestListLock);
     std::list<std::shared_ptr<HalRequest>> reqs = std::move(mRequestList);
     mRequestList.clear();
-    if (mProcessingRequest) {
-        auto timeout = std::chrono::seconds(kFlushWaitTimeoutSec);
-        auto st = mRequestDoneCond.wait_for(lk, timeout);
-        if (st == std::cv_status::timeout) {
-            ALOGE("%s: wait for inflight request finish timeout!", __FUNCTION__);
-        }
+    auto timeout = std::chrono::seconds(kFlushWaitTimeoutSec);
+    if (!mRequestDoneCond.wait_for(lk, timeout, [this] { return !mProcessingRequest; })) {
+        ALOGE("%s: wait for inflight request finish timeout!", __FUNCTION__);
+    }
+    // The requests popped for decoding while the inflight one was processed come first
+    reqs.splice(reqs.begin(), mRequestList);
+    if (mDecodedRequest != nullptr) {
+        reqs.push_front(std::move(mDecodedRequest));
+        mDecodedRequest.reset();
     }
 
     ALOGV("%s: flushing inflight requests", __FUNCTION__);
@@ -2287,11 +2328,50 @@ void ExternalCameraDeviceSession::OutputThread::dump(int fd) {
     } else {
         dprintf(fd, "OutputThread not processing any frames\n");
     }
+    if (mDecodedRequest != nullptr) {
+        dprintf(fd, "OutputThread decoded frame %d\n", mDecodedRequest->frameNumber);
+    }
     dprintf(fd, "OutputThread request list contains frame: ");
     for (const auto& req : mRequestList) {
         dprintf(fd, "%d, ", req->frameNumber);
     }
     dprintf(fd, "\n");
+
+    std::lock_guard<std::mutex> timingLk(mTimingLock);
+    dprintf(fd, "OutputThread stage timing (%" PRIu64 " decodes overlapped with a request):\n",
+            mPrefetchedDecodes);
+    mDecodeTiming.dump(fd, "MJPG decode");
+    mScaleConvertTiming.dump(fd, "crop, scale and convert");
+    mJpegTiming.dump(fd, "JPEG encode");
+    mResultTiming.dump(fd, "capture result");
+    mRequestTiming.dump(fd, "whole request");
+
+    ScaledFrameCache::Stats scaled = mScaledYu12Frames.getStats();
+    dprintf(fd,
+            "OutputThread scaled frames: %" PRIu64 " from the full frame, %" PRIu64
+            " from a larger scaled frame, %" PRIu64 " reused\n",
+            scaled.fromInput, scaled.chained, scaled.shared);
+}
+
+void ExternalCameraDeviceSession::OutputThread::StageTiming::add(nsecs_t ns) {
+    count++;
+    totalNs += ns;
+    maxNs = std::max(maxNs, ns);
+}
+
+void ExternalCameraDeviceSession::OutputThread::StageTiming::dump(int fd, const char* name) const {
+    if (count == 0) {
+        dprintf(fd, "  %s: no samples\n", name);
+        return;
+    }
+    dprintf(fd, "  %s: avg %.2f ms, max %.2f ms over %" PRIu64 " samples\n", name,
+            totalNs / 1e6 / count, maxNs / 1e6, count);
+}
+
+void ExternalCameraDeviceSession::OutputThread::addTiming(StageTiming* timing, nsecs_t startNs) {
+    nsecs_t ns = systemTime(SYSTEM_TIME_MONOTONIC) - startNs;
+    std::lock_guard<std::mutex> lk(mTimingLock);
+    timing->add(ns);
 }
 
 void ExternalCameraDeviceSession::OutputThread::setExifMakeModel(const std::string& make,
@@ -2312,12 +2392,15 @@ ExternalCameraDeviceSession::OutputThread::switchToOffline() {
     std::unique_lock<std::mutex> lk(mRequestListLock);
     std::list<std::shared_ptr<HalRequest>> reqs = std::move(mRequestList);
     mRequestList.clear();
-    if (mProcessingRequest) {
-        auto timeout = std::chrono::seconds(kFlushWaitTimeoutSec);
-        auto st = mRequestDoneCond.wait_for(lk, timeout);
-        if (st == std::cv_status::timeout) {
-            ALOGE("%s: wait for inflight request finish timeout!", __FUNCTION__);
-        }
+    auto timeout = std::chrono::seconds(kFlushWaitTimeoutSec);
+    if (!mRequestDoneCond.wait_for(lk, timeout, [this] { return !mProcessingRequest; })) {
+        ALOGE("%s: wait for inflight request finish timeout!", __FUNCTION__);
+    }
+    // The offline session decodes the requests again from their V4L2 frames
+    reqs.splice(reqs.begin(), mRequestList);
+    if (mDecodedRequest != nullptr) {
+        reqs.push_front(std::move(mDecodedRequest));
+        mDecodedRequest.reset();
     }
     lk.unlock();
     clearIntermediateBuffers();
@@ -2342,7 +2425,7 @@ int ExternalCameraDeviceSession::OutputThread::waitForBufferRequestDone(
 }
 
 void ExternalCameraDeviceSession::OutputThread::waitForNextRequest(
-        std::shared_ptr<HalRequest>* out) {
+        std::shared_ptr<HalRequest>* out, bool* decoded) {
     ATRACE_CALL();
     if (out == nullptr) {
         ALOGE("%s: out is null", __FUNCTION__);
@@ -2350,6 +2433,16 @@ void ExternalCameraDeviceSession::OutputThread::waitForNextRequest(
     }
 
     std::unique_lock<std::mutex> lk(mRequestListLock);
+    if (mDecodedRequest != nullptr) {
+        *out = std::move(mDecodedRequest);
+        mDecodedRequest.reset();
+        mProcessingRequest = true;
+        mProcessingFrameNumber = (*out)->frameNumber;
+        if (decoded != nullptr) {
+            *decoded = true;
+        }
+        return;
+    }
     int waitTimes = 0;
     while (mRequestList.empty()) {
         if (exitPending()) {
@@ -2369,94 +2462,40 @@ void ExternalCameraDeviceSession::OutputThread::waitForNextRequest(
     mRequestList.pop_front();
     mProcessingRequest = true;
     mProcessingFrameNumber = (*out)->frameNumber;
+    if (decoded != nullptr) {
+        *decoded = false;
+    }
 }
 
-void ExternalCameraDeviceSession::OutputThread::signalRequestDone() {
+void ExternalCameraDeviceSession::OutputThread::signalRequestDone(
+        std::shared_ptr<HalRequest> nextDecoded) {
     std::unique_lock<std::mutex> lk(mRequestListLock);
     mProcessingRequest = false;
     mProcessingFrameNumber = 0;
+    mDecodedRequest = std::move(nextDecoded);
     lk.unlock();
     mRequestDoneCond.notify_one();
 }
 
-int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
-        std::shared_ptr<AllocatedFrame>& in, const Size& outSz, YCbCrLayout* out) {
-    Size inSz = {in->mWidth, in->mHeight};
-
-    int ret;
-    if (inSz == outSz) {
-        ret = in->getLayout(out);
-        if (ret != 0) {
-            ALOGE("%s: failed to get input image layout", __FUNCTION__);
-            return ret;
-        }
-        return ret;
-    }
-
-    // Cropping to output aspect ratio
-    IMapper::Rect inputCrop;
-    ret = getCropRect(mCroppingType, inSz, outSz, &inputCrop);
-    if (ret != 0) {
-        ALOGE("%s: failed to compute crop rect for output size %dx%d", __FUNCTION__, outSz.width,
-              outSz.height);
-        return ret;
-    }
-
-    YCbCrLayout croppedLayout;
-    ret = in->getCroppedLayout(inputCrop, &croppedLayout);
-    if (ret != 0) {
-        ALOGE("%s: failed to crop input image %dx%d to output size %dx%d", __FUNCTION__, inSz.width,
-              inSz.height, outSz.width, outSz.height);
-        return ret;
-    }
-
-    if ((mCroppingType == VERTICAL && inSz.width == outSz.width) ||
-        (mCroppingType == HORIZONTAL && inSz.height == outSz.height)) {
-        // No scale is needed
-        *out = croppedLayout;
-        return 0;
-    }
-
-    auto it = mScaledYu12Frames.find(outSz);
-    std::shared_ptr<AllocatedFrame> scaledYu12Buf;
-    if (it != mScaledYu12Frames.end()) {
-        scaledYu12Buf = it->second;
-    } else {
-        it = mIntermediateBuffers.find(outSz);
-        if (it == mIntermediateBuffers.end()) {
-            ALOGE("%s: failed to find intermediate buffer size %dx%d", __FUNCTION__, outSz.width,
-                  outSz.height);
-            return -1;
-        }
-        scaledYu12Buf = it->second;
-    }
-    // Scale
-    YCbCrLayout outLayout;
-    ret = scaledYu12Buf->getLayout(&outLayout);
-    if (ret != 0) {
-        ALOGE("%s: failed to get output buffer layout", __FUNCTION__);
-        return ret;
+std::shared_ptr<HalRequest> ExternalCameraDeviceSession::OutputThread::popRequestToPrefetch() {
+    std::lock_guard<std::mutex> lk(mRequestListLock);
+    if (mRequestList.empty()) {
+        return nullptr;
     }
+    std::shared_ptr<HalRequest> req = mRequestList.front();
+    mRequestList.pop_front();
+    return req;
+}
 
-    ret = libyuv::I420Scale(
-            static_cast<uint8_t*>(croppedLayout.y), croppedLayout.yStride,
-            static_cast<uint8_t*>(croppedLayout.cb), croppedLayout.cStride,
-            static_cast<uint8_t*>(croppedLayout.cr), croppedLayout.cStride, inputCrop.width,
-            inputCrop.height, static_cast<uint8_t*>(outLayout.y), outLayout.yStride,
-            static_cast<uint8_t*>(outLayout.cb), outLayout.cStride,
-            static_cast<uint8_t*>(outLayout.cr), outLayout.cStride, outSz.width, outSz.height,
-            // TODO: b/72261744 see if we can use better filter without losing too much perf
-            libyuv::FilterMode::kFilterNone);
-
-    if (ret != 0) {
-        ALOGE("%s: failed to scale buffer from %dx%d to %dx%d. Ret %d", __FUNCTION__,
-              inputCrop.width, inputCrop.height, outSz.width, outSz.height, ret);
-        return ret;
-    }
+void ExternalCameraDeviceSession::OutputThread::requeueRequest(
+        const std::shared_ptr<HalRequest>& req) {
+    std::lock_guard<std::mutex> lk(mRequestListLock);
+    mRequestList.push_front(req);
+}
 
-    *out = outLayout;
-    mScaledYu12Frames.insert({outSz, scaledYu12Buf});
-    return 0;
+int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
+        std::shared_ptr<AllocatedFrame>& in, const Size& outSz, YCbCrLayout* out) {
+    return mScaledYu12Frames.get(in, mIntermediateBuffers, outSz, out);
 }
 
 int ExternalCameraDeviceSession::OutputThread::cropAndScaleThumbLocked(
@@ -2653,15 +2692,43 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
     size_t thumbCodeSize = 0, jpegCodeSize = 0;
     /* Temporary thumbnail code buffer */
     std::vector<uint8_t> thumbCode(outputThumbnail ? maxThumbCodeSize : 0);
+    std::unique_ptr<ExifUtils> utils(ExifUtils::create());
 
-    YCbCrLayout yu12Thumb;
-    if (outputThumbnail) {
-        ret = cropAndScaleThumbLocked(mYu12Frame, thumbSize, &yu12Thumb);
+    /* Encode the thumbnail and generate the EXIF APP1 segment it is embedded in */
+    auto generateApp1 = [&]() {
+        if (outputThumbnail) {
+            YCbCrLayout yu12Thumb;
+            int res = cropAndScaleThumbLocked(mYu12Frame, thumbSize, &yu12Thumb);
 
-        if (ret != 0) {
-            return lfail("%s: crop and scale thumbnail failed!", __FUNCTION__);
+            if (res != 0) {
+                return lfail("%s: crop and scale thumbnail failed!", __FUNCTION__);
+            }
+
+            res = encodeJpegYU12(thumbSize, yu12Thumb, thumbQuality, 0, 0, &thumbCode[0],
+                                 maxThumbCodeSize, thumbCodeSize);
+
+            if (res != 0) {
+                return lfail("%s: thumbnail encodeJpegYU12 failed with %d", __FUNCTION__, res);
+            }
         }
-    }
+
+        /* Combine camera characteristics with request settings to form EXIF
+         * metadata */
+        common::V1_0::helper::CameraMetadata meta(mCameraCharacteristics);
+        meta.append(setting);
+
+        /* Make sure it's initialized */
+        utils->initialize();
+
+        utils->setFromMetadata(meta, jpegSize.width, jpegSize.height);
+        utils->setMake(mExifMake);
+        utils->setModel(mExifModel);
+
+        if (!utils->generateApp1(outputThumbnail ? &thumbCode[0] : nullptr, thumbCodeSize)) {
+            return lfail("%s: generating APP1 failed", __FUNCTION__);
+        }
+        return 0;
+    };
 
     /* Scale and crop main jpeg */
     ret = cropAndScaleLocked(mYu12Frame, jpegSize, &yu12Main);
@@ -2670,34 +2737,23 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
         return lfail("%s: crop and scale main failed!", __FUNCTION__);
     }
 
-    /* Encode the thumbnail image */
-    if (outputThumbnail) {
-        ret = encodeJpegYU12(thumbSize, yu12Thumb, thumbQuality, 0, 0, &thumbCode[0],
-                             maxThumbCodeSize, thumbCodeSize);
-
-        if (ret != 0) {
-            return lfail("%s: thumbnail encodeJpegYU12 failed with %d", __FUNCTION__, ret);
-        }
+    /* Large images are encoded in strips by the workers, while the thumbnail and EXIF are
+     * generated. The strips are joined once the APP1 segment is ready. */
+    size_t numStrips = 1;
+    if (mWorkerPool != nullptr) {
+        numStrips = mJpegEncoder.init(jpegSize, yu12Main, jpegQuality, maxJpegCodeSize,
+                                      2 * (mWorkerPool->size() + 1));
+    }
+    if (numStrips > 1) {
+        ret = mWorkerPool->parallelFor(numStrips + 1, [&](size_t i) {
+            return i == numStrips ? generateApp1() : mJpegEncoder.encodeStrip(i);
+        });
+    } else {
+        ret = generateApp1();
     }
 
-    /* Combine camera characteristics with request settings to form EXIF
-     * metadata */
-    common::V1_0::helper::CameraMetadata meta(mCameraCharacteristics);
-    meta.append(setting);
-
-    /* Generate EXIF object */
-    std::unique_ptr<ExifUtils> utils(ExifUtils::create());
-    /* Make sure it's initialized */
-    utils->initialize();
-
-    utils->setFromMetadata(meta, jpegSize.width, jpegSize.height);
-    utils->setMake(mExifMake);
-    utils->setModel(mExifModel);
-
-    ret = utils->generateApp1(outputThumbnail ? &thumbCode[0] : nullptr, thumbCodeSize);
-
-    if (!ret) {
-        return lfail("%s: generating APP1 failed", __FUNCTION__);
+    if (ret != 0) {
+        return lfail("%s: encoding JPEG strips or APP1 failed", __FUNCTION__);
     }
 
     /* Get internal buffer */
@@ -2712,9 +2768,13 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
         return lfail("%s: could not lock %zu bytes", __FUNCTION__, maxJpegCodeSize);
     }
 
-    /* Encode the main jpeg image */
-    ret = encodeJpegYU12(jpegSize, yu12Main, jpegQuality, exifData, exifDataSize, bufPtr,
-                         maxJpegCodeSize, jpegCodeSize);
+    /* Encode the main jpeg image, or join its strips */
+    if (numStrips > 1) {
+        ret = mJpegEncoder.join(exifData, exifDataSize, bufPtr, maxJpegCodeSize, jpegCodeSize);
+    } else {
+        ret = encodeJpegYU12(jpegSize, yu12Main, jpegQuality, exifData, exifDataSize, bufPtr,
+                             maxJpegCodeSize, jpegCodeSize);
+    }
 
     /* TODO: Not sure this belongs here, maybe better to pass jpegCodeSize out
      * and do this when returning buffer to parent */
@@ -2743,12 +2803,227 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
 void ExternalCameraDeviceSession::OutputThread::clearIntermediateBuffers() {
     std::lock_guard<std::mutex> lk(mBufferLock);
     mYu12Frame.reset();
+    mNextYu12Frame.reset();
     mYu12ThumbFrame.reset();
+    mJpegEncoder.clear();
     mIntermediateBuffers.clear();
     mMuteTestPatternFrame.clear();
     mBlobBufferSize = 0;
 }
 
+int ExternalCameraDeviceSession::OutputThread::decodeFrameLocked(
+        const HalRequest& req, uint8_t* inData, size_t inDataSize,
+        const std::shared_ptr<AllocatedFrame>& frame, const YCbCrLayout& layout) {
+    // Process camera mute state
+    auto testPatternMode = req.setting.find(ANDROID_SENSOR_TEST_PATTERN_MODE);
+    if (testPatternMode.count == 1) {
+        if (mCameraMuted != (testPatternMode.data.u8[0] != ANDROID_SENSOR_TEST_PATTERN_MODE_OFF)) {
+            mCameraMuted = !mCameraMuted;
+            // Get solid color for test pattern, if any was set
+            if (testPatternMode.data.u8[0] == ANDROID_SENSOR_TEST_PATTERN_MODE_SOLID_COLOR) {
+                auto entry = req.setting.find(ANDROID_SENSOR_TEST_PATTERN_DATA);
+                if (entry.count == 4) {
+                    // Update the mute frame if the pattern color has changed
+                    if (memcmp(entry.data.i32, mTestPatternData, sizeof(mTestPatternData)) != 0) {
+                        memcpy(mTestPatternData, entry.data.i32, sizeof(mTestPatternData));
+                        // Fill the mute frame with the solid color, use only 8 MSB of RGGB as RGB
+                        for (int i = 0; i < mMuteTestPatternFrame.size(); i += 3) {
+                            mMuteTestPatternFrame[i] = entry.data.i32[0] >> 24;
+                            mMuteTestPatternFrame[i + 1] = entry.data.i32[1] >> 24;
+                            mMuteTestPatternFrame[i + 2] = entry.data.i32[3] >> 24;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // TODO: in some special case maybe we can decode jpg directly to gralloc output?
+    if (req.frameIn->mFourcc != V4L2_PIX_FMT_MJPEG) {
+        return 0;
+    }
+    ATRACE_BEGIN("MJPGtoI420");
+    nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    int res = 0;
+    if (mCameraMuted) {
+        res = libyuv::ConvertToI420(
+                mMuteTestPatternFrame.data(), mMuteTestPatternFrame.size(),
+                static_cast<uint8_t*>(layout.y), layout.yStride, static_cast<uint8_t*>(layout.cb),
+                layout.cStride, static_cast<uint8_t*>(layout.cr), layout.cStride, 0, 0,
+                frame->mWidth, frame->mHeight, frame->mWidth, frame->mHeight, libyuv::kRotate0,
+                libyuv::FOURCC_RAW);
+    } else {
+        res = libyuv::MJPGToI420(inData, inDataSize, static_cast<uint8_t*>(layout.y),
+                                 layout.yStride, static_cast<uint8_t*>(layout.cb), layout.cStride,
+                                 static_cast<uint8_t*>(layout.cr), layout.cStride, frame->mWidth,
+                                 frame->mHeight, frame->mWidth, frame->mHeight);
+    }
+    addTiming(&mDecodeTiming, startNs);
+    ATRACE_END();
+    return res;
+}
+
+int ExternalCameraDeviceSession::OutputThread::processOutputBufferLocked(
+        HalStreamBuffer& halBuf, const HalRequest& req, uint8_t* inData, size_t inDataSize) {
+    const int kSyncWaitTimeoutMs = 500;
+    if (*(halBuf.bufPtr) == nullptr) {
+        ALOGW("%s: buffer for stream %d missing", __FUNCTION__, halBuf.streamId);
+        halBuf.fenceTimeout = true;
+    } else if (halBuf.acquireFence >= 0) {
+        int ret = sync_wait(halBuf.acquireFence, kSyncWaitTimeoutMs);
+        if (ret) {
+            halBuf.fenceTimeout = true;
+        } else {
+            ::close(halBuf.acquireFence);
+            halBuf.acquireFence = -1;
+        }
+    }
+
+    if (halBuf.fenceTimeout) {
+        return 0;
+    }
+
+    // Gralloc lockYCbCr the buffer
+    switch (halBuf.format) {
+        case PixelFormat::BLOB: {
+            nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+            int ret = createJpegLocked(halBuf, req.setting);
+            addTiming(&mJpegTiming, startNs);
+
+            if (ret != 0) {
+                ALOGE("%s: createJpegLocked failed with %d", __FUNCTION__, ret);
+                return ret;
+            }
+        } break;
+        case PixelFormat::Y16: {
+            void* outLayout = sHandleImporter.lock(
+                    *(halBuf.bufPtr), static_cast<uint64_t>(halBuf.usage), inDataSize);
+
+            std::memcpy(outLayout, inData, inDataSize);
+
+            int relFence = sHandleImporter.unlock(*(halBuf.bufPtr));
+            if (relFence >= 0) {
+                halBuf.acquireFence = relFence;
+            }
+        } break;
+        case PixelFormat::YCBCR_420_888:
+        case PixelFormat::YV12: {
+            nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+            android::Rect outRect{0, 0, static_cast<int32_t>(halBuf.width),
+                                  static_cast<int32_t>(halBuf.height)};
+            android_ycbcr result = sHandleImporter.lockYCbCr(
+                    *(halBuf.bufPtr), static_cast<uint64_t>(halBuf.usage), outRect);
+            ALOGV("%s: outLayout y %p cb %p cr %p y_str %zu c_str %zu c_step %zu", __FUNCTION__,
+                  result.y, result.cb, result.cr, result.ystride, result.cstride,
+                  result.chroma_step);
+            if (result.ystride > UINT32_MAX || result.cstride > UINT32_MAX ||
+                result.chroma_step > UINT32_MAX) {
+                ALOGE("%s: lockYCbCr failed. Unexpected values!", __FUNCTION__);
+                return -1;
+            }
+            YCbCrLayout outLayout = {.y = result.y,
+                                     .cb = result.cb,
+                                     .cr = result.cr,
+                                     .yStride = static_cast<uint32_t>(result.ystride),
+                                     .cStride = static_cast<uint32_t>(result.cstride),
+                                     .chromaStep = static_cast<uint32_t>(result.chroma_step)};
+
+            // Convert to output buffer size/format
+            uint32_t outputFourcc = getFourCcFromLayout(outLayout);
+            ALOGV("%s: converting to format %c%c%c%c", __FUNCTION__, outputFourcc & 0xFF,
+                  (outputFourcc >> 8) & 0xFF, (outputFourcc >> 16) & 0xFF,
+                  (outputFourcc >> 24) & 0xFF);
+
+            YCbCrLayout cropAndScaled;
+            ATRACE_BEGIN("cropAndScaleLocked");
+            int ret = cropAndScaleLocked(mYu12Frame, Size{halBuf.width, halBuf.height},
+                                         &cropAndScaled);
+            ATRACE_END();
+            if (ret != 0) {
+                ALOGE("%s: crop and scale failed!", __FUNCTION__);
+                return ret;
+            }
+
+            Size sz{halBuf.width, halBuf.height};
+            ATRACE_BEGIN("formatConvert");
+            ret = formatConvert(cropAndScaled, outLayout, sz, outputFourcc);
+            ATRACE_END();
+            if (ret != 0) {
+                ALOGE("%s: format conversion failed!", __FUNCTION__);
+                return ret;
+            }
+            int relFence = sHandleImporter.unlock(*(halBuf.bufPtr));
+            if (relFence >= 0) {
+                halBuf.acquireFence = relFence;
+            }
+            addTiming(&mScaleConvertTiming, startNs);
+        } break;
+        default:
+            ALOGE("%s: unknown output format %x", __FUNCTION__, halBuf.format);
+            return -1;
+    }
+    return 0;
+}
+
+int ExternalCameraDeviceSession::OutputThread::processOutputBuffersLocked(HalRequest& req,
+                                                                         uint8_t* inData,
+                                                                         size_t inDataSize) {
+    // Buffers of the same size are scaled into the same intermediate buffer so they are filled
+    // by the same task. A JPEG also scales its thumbnail into mYu12ThumbFrame, which is safe as
+    // there is at most one stall stream.
+    std::vector<std::vector<HalStreamBuffer*>> groups;
+    std::unordered_map<Size, size_t, SizeHasher> groupIndices;
+    for (auto& halBuf : req.buffers) {
+        if (halBuf.format == PixelFormat::Y16) {
+            groups.push_back({&halBuf});
+            continue;
+        }
+        auto [it, inserted] =
+                groupIndices.try_emplace(Size{halBuf.width, halBuf.height}, groups.size());
+        if (inserted) {
+            groups.emplace_back();
+        }
+        groups[it->second].push_back(&halBuf);
+    }
+
+    // Plan the sizes together, for the smaller ones to be scaled from the larger ones
+    std::vector<Size> sizes;
+    for (const auto& [size, index] : groupIndices) {
+        sizes.push_back(size);
+    }
+    mScaledYu12Frames.plan(mYu12Frame, mIntermediateBuffers, sizes);
+
+    auto processGroup = [this, &req, inData, inDataSize](std::vector<HalStreamBuffer*>& group) {
+        for (HalStreamBuffer* halBuf : group) {
+            int ret = processOutputBufferLocked(*halBuf, req, inData, inDataSize);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+        return 0;
+    };
+
+    // This thread fills the first group while the workers fill the others
+    size_t numInline = mWorkerPool == nullptr ? groups.size() : std::min<size_t>(1, groups.size());
+    std::vector<std::future<int>> results;
+    for (size_t i = numInline; i < groups.size(); i++) {
+        auto& group = groups[i];
+        results.push_back(
+                mWorkerPool->submit([&processGroup, &group] { return processGroup(group); }));
+    }
+    int ret = 0;
+    for (size_t i = 0; i < numInline && ret == 0; i++) {
+        ret = processGroup(groups[i]);
+    }
+    for (auto& result : results) {
+        int res = result.get();
+        if (ret == 0) {
+            ret = res;
+        }
+    }
+    return ret;
+}
+
 bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
     std::shared_ptr<HalRequest> req;
     auto parent = mParent.lock();
@@ -2760,14 +3035,33 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
     // TODO: maybe we need to setup a sensor thread to dq/enq v4l frames
     //       regularly to prevent v4l buffer queue filled with stale buffers
     //       when app doesn't program a preview request
-    waitForNextRequest(&req);
+    bool decoded = false;
+    waitForNextRequest(&req, &decoded);
     if (req == nullptr) {
         // No new request, wait again
         return true;
     }
+    nsecs_t requestStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    // The next request, decoded on a worker thread while this one is processed
+    std::shared_ptr<HalRequest> nextReq;
+    std::future<int> nextDecode;
+    bool nextDecoded = false;
+
+    auto requeueNextRequest = [&]() {
+        if (nextReq == nullptr) {
+            return;
+        }
+        if (nextDecode.valid()) {
+            nextDecode.wait();
+        }
+        requeueRequest(nextReq);
+        nextReq.reset();
+    };
 
     auto onDeviceError = [&](auto... args) {
         ALOGE(args...);
+        requeueNextRequest();
         parent->notifyError(req->frameNumber, /*stream*/ -1, ErrorCode::ERROR_DEVICE);
         signalRequestDone();
         return false;
@@ -2796,52 +3090,8 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
         return onDeviceError("%s: V4L2 buffer map failed", __FUNCTION__);
     }
 
-    // Process camera mute state
-    auto testPatternMode = req->setting.find(ANDROID_SENSOR_TEST_PATTERN_MODE);
-    if (testPatternMode.count == 1) {
-        if (mCameraMuted != (testPatternMode.data.u8[0] != ANDROID_SENSOR_TEST_PATTERN_MODE_OFF)) {
-            mCameraMuted = !mCameraMuted;
-            // Get solid color for test pattern, if any was set
-            if (testPatternMode.data.u8[0] == ANDROID_SENSOR_TEST_PATTERN_MODE_SOLID_COLOR) {
-                auto entry = req->setting.find(ANDROID_SENSOR_TEST_PATTERN_DATA);
-                if (entry.count == 4) {
-                    // Update the mute frame if the pattern color has changed
-                    if (memcmp(entry.data.i32, mTestPatternData, sizeof(mTestPatternData)) != 0) {
-                        memcpy(mTestPatternData, entry.data.i32, sizeof(mTestPatternData));
-                        // Fill the mute frame with the solid color, use only 8 MSB of RGGB as RGB
-                        for (int i = 0; i < mMuteTestPatternFrame.size(); i += 3) {
-                            mMuteTestPatternFrame[i] = entry.data.i32[0] >> 24;
-                            mMuteTestPatternFrame[i + 1] = entry.data.i32[1] >> 24;
-                            mMuteTestPatternFrame[i + 2] = entry.data.i32[3] >> 24;
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    // TODO: in some special case maybe we can decode jpg directly to gralloc output?
-    if (req->frameIn->mFourcc == V4L2_PIX_FMT_MJPEG) {
-        ATRACE_BEGIN("MJPGtoI420");
-        res = 0;
-        if (mCameraMuted) {
-            res = libyuv::ConvertToI420(
-                    mMuteTestPatternFrame.data(), mMuteTestPatternFrame.size(),
-                    static_cast<uint8_t*>(mYu12FrameLayout.y), mYu12FrameLayout.yStride,
-                    static_cast<uint8_t*>(mYu12FrameLayout.cb), mYu12FrameLayout.cStride,
-                    static_cast<uint8_t*>(mYu12FrameLayout.cr), mYu12FrameLayout.cStride, 0, 0,
-                    mYu12Frame->mWidth, mYu12Frame->mHeight, mYu12Frame->mWidth,
-                    mYu12Frame->mHeight, libyuv::kRotate0, libyuv::FOURCC_RAW);
-        } else {
-            res = libyuv::MJPGToI420(
-                    inData, inDataSize, static_cast<uint8_t*>(mYu12FrameLayout.y),
-                    mYu12FrameLayout.yStride, static_cast<uint8_t*>(mYu12FrameLayout.cb),
-                    mYu12FrameLayout.cStride, static_cast<uint8_t*>(mYu12FrameLayout.cr),
-                    mYu12FrameLayout.cStride, mYu12Frame->mWidth, mYu12Frame->mHeight,
-                    mYu12Frame->mWidth, mYu12Frame->mHeight);
-        }
-        ATRACE_END();
-
+    if (!decoded) {
+        res = decodeFrameLocked(*req, inData, inDataSize, mYu12Frame, mYu12FrameLayout);
         if (res != 0) {
             // For some webcam, the first few V4L2 frames might be malformed...
             ALOGE("%s: Convert V4L2 frame to YU12 failed! res %d", __FUNCTION__, res);
@@ -2860,6 +3110,46 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
         }
     }
 
+    // Overlap the decode of the next request, if already submitted, with the buffer request and
+    // output buffers of this one
+    if (mWorkerPool == nullptr) {
+        size_t numThreads = std::thread::hardware_concurrency();
+        numThreads = std::clamp<size_t>(numThreads > 1 ? numThreads - 1 : 1, 1, kMaxWorkerThreads);
+        mWorkerPool = std::make_unique<WorkerPool>(numThreads);
+    }
+    nextReq = popRequestToPrefetch();
+    if (nextReq != nullptr) {
+        nextDecode = mWorkerPool->submit([this, nextReq] {
+            uint8_t* nextData;
+            size_t nextDataSize;
+            if (nextReq->frameIn->getData(&nextData, &nextDataSize) != 0) {
+                return -1;
+            }
+            return decodeFrameLocked(*nextReq, nextData, nextDataSize, mNextYu12Frame,
+                                     mNextYu12FrameLayout);
+        });
+    }
+
+    // Waits for the next request to be decoded, and makes it the frame the next loop processes
+    auto finishNextDecode = [&]() {
+        if (nextReq == nullptr) {
+            return;
+        }
+        int ret = nextDecode.get();
+        if (ret != 0) {
+            // Decode it again when it is processed, to go through the error handling
+            ALOGW("%s: decode of frame %d failed! res %d", __FUNCTION__, nextReq->frameNumber,
+                  ret);
+            requeueNextRequest();
+            return;
+        }
+        std::swap(mYu12Frame, mNextYu12Frame);
+        std::swap(mYu12FrameLayout, mNextYu12FrameLayout);
+        nextDecoded = true;
+        std::lock_guard<std::mutex> timingLk(mTimingLock);
+        mPrefetchedDecodes++;
+    };
+
     ATRACE_BEGIN("Wait for BufferRequest done");
     res = waitForBufferRequestDone(&req->buffers);
     ATRACE_END();
@@ -2867,119 +3157,35 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
     if (res != 0) {
         // HAL buffer management buffer request can fail
         ALOGE("%s: wait for BufferRequest done failed! res %d", __FUNCTION__, res);
+        finishNextDecode();
         lk.unlock();
         Status st = parent->processCaptureRequestError(req);
         if (st != Status::OK) {
             return onDeviceError("%s: failed to process capture request error!", __FUNCTION__);
         }
-        signalRequestDone();
+        signalRequestDone(nextDecoded ? nextReq : nullptr);
         return true;
     }
 
     ALOGV("%s processing new request", __FUNCTION__);
-    const int kSyncWaitTimeoutMs = 500;
-    for (auto& halBuf : req->buffers) {
-        if (*(halBuf.bufPtr) == nullptr) {
-            ALOGW("%s: buffer for stream %d missing", __FUNCTION__, halBuf.streamId);
-            halBuf.fenceTimeout = true;
-        } else if (halBuf.acquireFence >= 0) {
-            int ret = sync_wait(halBuf.acquireFence, kSyncWaitTimeoutMs);
-            if (ret) {
-                halBuf.fenceTimeout = true;
-            } else {
-                ::close(halBuf.acquireFence);
-                halBuf.acquireFence = -1;
-            }
-        }
-
-        if (halBuf.fenceTimeout) {
-            continue;
-        }
-
-        // Gralloc lockYCbCr the buffer
-        switch (halBuf.format) {
-            case PixelFormat::BLOB: {
-                int ret = createJpegLocked(halBuf, req->setting);
-
-                if (ret != 0) {
-                    lk.unlock();
-                    return onDeviceError("%s: createJpegLocked failed with %d", __FUNCTION__, ret);
-                }
-            } break;
-            case PixelFormat::Y16: {
-                void* outLayout = sHandleImporter.lock(
-                        *(halBuf.bufPtr), static_cast<uint64_t>(halBuf.usage), inDataSize);
-
-                std::memcpy(outLayout, inData, inDataSize);
-
-                int relFence = sHandleImporter.unlock(*(halBuf.bufPtr));
-                if (relFence >= 0) {
-                    halBuf.acquireFence = relFence;
-                }
-            } break;
-            case PixelFormat::YCBCR_420_888:
-            case PixelFormat::YV12: {
-                android::Rect outRect{0, 0, static_cast<int32_t>(halBuf.width),
-                                      static_cast<int32_t>(halBuf.height)};
-                android_ycbcr result = sHandleImporter.lockYCbCr(
-                        *(halBuf.bufPtr), static_cast<uint64_t>(halBuf.usage), outRect);
-                ALOGV("%s: outLayout y %p cb %p cr %p y_str %zu c_str %zu c_step %zu", __FUNCTION__,
-                      result.y, result.cb, result.cr, result.ystride, result.cstride,
-                      result.chroma_step);
-                if (result.ystride > UINT32_MAX || result.cstride > UINT32_MAX ||
-                    result.chroma_step > UINT32_MAX) {
-                    return onDeviceError("%s: lockYCbCr failed. Unexpected values!", __FUNCTION__);
-                }
-                YCbCrLayout outLayout = {.y = result.y,
-                                         .cb = result.cb,
-                                         .cr = result.cr,
-                                         .yStride = static_cast<uint32_t>(result.ystride),
-                                         .cStride = static_cast<uint32_t>(result.cstride),
-                                         .chromaStep = static_cast<uint32_t>(result.chroma_step)};
-
-                // Convert to output buffer size/format
-                uint32_t outputFourcc = getFourCcFromLayout(outLayout);
-                ALOGV("%s: converting to format %c%c%c%c", __FUNCTION__, outputFourcc & 0xFF,
-                      (outputFourcc >> 8) & 0xFF, (outputFourcc >> 16) & 0xFF,
-                      (outputFourcc >> 24) & 0xFF);
-
-                YCbCrLayout cropAndScaled;
-                ATRACE_BEGIN("cropAndScaleLocked");
-                int ret = cropAndScaleLocked(mYu12Frame, Size{halBuf.width, halBuf.height},
-                                             &cropAndScaled);
-                ATRACE_END();
-                if (ret != 0) {
-                    lk.unlock();
-                    return onDeviceError("%s: crop and scale failed!", __FUNCTION__);
-                }
-
-                Size sz{halBuf.width, halBuf.height};
-                ATRACE_BEGIN("formatConvert");
-                ret = formatConvert(cropAndScaled, outLayout, sz, outputFourcc);
-                ATRACE_END();
-                if (ret != 0) {
-                    lk.unlock();
-                    return onDeviceError("%s: format conversion failed!", __FUNCTION__);
-                }
-                int relFence = sHandleImporter.unlock(*(halBuf.bufPtr));
-                if (relFence >= 0) {
-                    halBuf.acquireFence = relFence;
-                }
-            } break;
-            default:
-                lk.unlock();
-                return onDeviceError("%s: unknown output format %x", __FUNCTION__, halBuf.format);
-        }
-    }  // for each buffer
+    res = processOutputBuffersLocked(*req, inData, inDataSize);
     mScaledYu12Frames.clear();
+    finishNextDecode();
+    if (res != 0) {
+        lk.unlock();
+        return onDeviceError("%s: failed to fill output buffers! res %d", __FUNCTION__, res);
+    }
 
     // Don't hold the lock while calling back to parent
     lk.unlock();
+    nsecs_t resultStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
     Status st = parent->processCaptureResult(req);
     if (st != Status::OK) {
         return onDeviceError("%s: failed to process capture result!", __FUNCTION__);
     }
-    signalRequestDone();
+    addTiming(&mResultTiming, resultStartNs);
+    addTiming(&mRequestTiming, requestStartNs);
+    signalRequestDone(nextDecoded ? nextReq : nullptr);
     return true;
 }
 
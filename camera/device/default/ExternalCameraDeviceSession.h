@@ -191,8 +191,30 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
         int waitForBufferRequestDone(
                 /*out*/ std::vector<HalStreamBuffer>*);
 
-        void waitForNextRequest(std::shared_ptr<HalRequest>* out);
-        void signalRequestDone();
+        // decoded is set to true if out was decoded into mYu12Frame while the previous request was
+        // being processed.
+        void waitForNextRequest(std::shared_ptr<HalRequest>* out, bool* decoded = nullptr);
+        // nextDecoded is a request popped and decoded into mYu12Frame while processing the
+        // current one, it is handed to the next waitForNextRequest.
+        void signalRequestDone(std::shared_ptr<HalRequest> nextDecoded = nullptr);
+
+        // Pops the next request if it is already submitted, for its decode to overlap with the
+        // processing of the current one.
+        std::shared_ptr<HalRequest> popRequestToPrefetch();
+        // Puts back a request popped by popRequestToPrefetch that could not be decoded
+        void requeueRequest(const std::shared_ptr<HalRequest>& req);
+
+        // Decodes the V4L2 frame of req into frame. Also updates the camera mute state from the
+        // request settings, so the requests must be decoded in order.
+        int decodeFrameLocked(const HalRequest& req, uint8_t* inData, size_t inDataSize,
+                              const std::shared_ptr<AllocatedFrame>& frame,
+                              const YCbCrLayout& layout);
+
+        // Fills the output buffers of req from mYu12Frame. Buffers of different sizes don't share
+        // intermediate buffers and are filled in parallel on the worker pool.
+        int processOutputBuffersLocked(HalRequest& req, uint8_t* inData, size_t inDataSize);
+        int processOutputBufferLocked(HalStreamBuffer& halBuf, const HalRequest& req,
+                                      uint8_t* inData, size_t inDataSize);
 
         int cropAndScaleLocked(std::shared_ptr<AllocatedFrame>& in, const Size& outSize,
                                YCbCrLayout* out);
@@ -210,24 +232,32 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
         const common::V1_0::helper::CameraMetadata mCameraCharacteristics;
 
         mutable std::mutex mRequestListLock;       // Protect access to mRequestList,
-                                                   // mProcessingRequest and mProcessingFrameNumber
+                                                   // mProcessingRequest, mProcessingFrameNumber
+                                                   // and mDecodedRequest
         std::condition_variable mRequestCond;      // signaled when a new request is submitted
         std::condition_variable mRequestDoneCond;  // signaled when a request is done processing
         std::list<std::shared_ptr<HalRequest>> mRequestList;
         bool mProcessingRequest = false;
         uint32_t mProcessingFrameNumber = 0;
+        // Popped from mRequestList and decoded, processed before mRequestList
+        std::shared_ptr<HalRequest> mDecodedRequest;
 
         // V4L2 frameIn
         // (MJPG decode)-> mYu12Frame
         // (Scale)-> mScaledYu12Frames
         // (Format convert) -> output gralloc frames
+        // While a request is processed from mYu12Frame the next one is decoded into
+        // mNextYu12Frame, the two are swapped when both are done.
         mutable std::mutex mBufferLock;  // Protect access to intermediate buffers
         std::shared_ptr<AllocatedFrame> mYu12Frame;
+        std::shared_ptr<AllocatedFrame> mNextYu12Frame;
         std::shared_ptr<AllocatedFrame> mYu12ThumbFrame;
-        std::unordered_map<Size, std::shared_ptr<AllocatedFrame>, SizeHasher> mIntermediateBuffers;
-        std::unordered_map<Size, std::shared_ptr<AllocatedFrame>, SizeHasher> mScaledYu12Frames;
+        IntermediateBuffers mIntermediateBuffers;
+        ScaledFrameCache mScaledYu12Frames;  // mYu12Frame scaled into mIntermediateBuffers
         YCbCrLayout mYu12FrameLayout;
+        YCbCrLayout mNextYu12FrameLayout;
         YCbCrLayout mYu12ThumbFrameLayout;
+        JpegStripEncoder mJpegEncoder;  // Encodes the main JPEG image on mWorkerPool
         std::vector<uint8_t> mMuteTestPatternFrame;
         uint32_t mTestPatternData[4] = {0, 0, 0, 0};
         bool mCameraMuted = false;
@@ -237,6 +267,29 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
         std::string mExifModel;
 
         const std::shared_ptr<BufferRequestThread> mBufferRequestThread;
+
+        // Time spent in each stage of the processing of a request
+        struct StageTiming {
+            uint64_t count = 0;
+            nsecs_t totalNs = 0;
+            nsecs_t maxNs = 0;
+
+            void add(nsecs_t ns);
+            void dump(int fd, const char* name) const;
+        };
+        void addTiming(StageTiming* timing, nsecs_t startNs);
+        std::mutex mTimingLock;  // Protect the timings below, updated by the worker threads
+        StageTiming mDecodeTiming;
+        StageTiming mScaleConvertTiming;
+        StageTiming mJpegTiming;
+        StageTiming mResultTiming;
+        StageTiming mRequestTiming;  // From the request popped to its result sent
+        uint64_t mPrefetchedDecodes = 0;
+
+        // Created on the first request, so an offline session processing its requests serially
+        // doesn't start any worker.
+        static constexpr size_t kMaxWorkerThreads = 3;
+        std::unique_ptr<WorkerPool> mWorkerPool;
     };
 
   private:
@@ -250,7 +303,9 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
     Status initStatus() const;
     status_t initDefaultRequests();
 
-    status_t fillCaptureResult(common::V1_0::helper::CameraMetadata& md, nsecs_t timestamp);
+    // Builds the result metadata of a request with settings in mResultMetadataBuilder
+    status_t fillCaptureResult(const common::V1_0::helper::CameraMetadata& settings,
+                               nsecs_t timestamp);
     int configureV4l2StreamLocked(const SupportedV4L2Format& fmt, double fps = 0.0);
     int v4l2StreamOffLocked();
 
@@ -276,7 +331,10 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
     Status processOneCaptureRequest(const CaptureRequest& request);
     void notifyShutter(int32_t frameNumber, nsecs_t shutterTs);
 
-    void invokeProcessCaptureResultCallback(std::vector<CaptureResult>& results, bool tryWriteFmq);
+    // If rawResult is set it holds the metadata of the only result, written to the FMQ straight
+    // from rawResult and only copied in the result if it doesn't fit
+    void invokeProcessCaptureResultCallback(std::vector<CaptureResult>& results, bool tryWriteFmq,
+                                            const camera_metadata_t* rawResult = nullptr);
     Size getMaxJpegResolution() const;
 
     Size getMaxThumbResolution() const;
@@ -356,6 +414,9 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
     std::mutex mAfTriggerLock;  // protect mAfTrigger
     bool mAfTrigger = false;
 
+    // Result metadata of the requests, only used by processCaptureResult on the OutputThread
+    ResultMetadataBuilder mResultMetadataBuilder{getCaptureResultTags()};
+
     uint32_t mBlobBufferSize = 0;
 
     static HandleImporter sHandleImporter;
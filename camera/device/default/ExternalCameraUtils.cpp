@@ -24,6 +24,7 @@
 #include <linux/videodev2.h>
 #include <log/log.h>
 #include <algorithm>
+#include <atomic>
 #include <cinttypes>
 #include <cmath>
 
@@ -567,9 +568,9 @@ int formatConvert(const YCbCrLayout& in, const YCbCrLayout& out, Size sz, uint32
     return 0;
 }
 
-int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
-                   const void* app1Buffer, size_t app1Size, void* out, size_t maxOutSize,
-                   size_t& actualCodeSize) {
+int encodeJpegYU12Rows(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
+                       const void* app1Buffer, size_t app1Size, int restartInRows, void* out,
+                       size_t maxOutSize, size_t& actualCodeSize) {
     /* libjpeg is a C library so we use C-style "inheritance" by
      * putting libjpeg's jpeg_destination_mgr first in our custom
      * struct. This allows us to cast jpeg_destination_mgr* to
@@ -652,6 +653,7 @@ int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQualit
     jpeg_set_colorspace(&cinfo, JCS_YCbCr);
     cinfo.raw_data_in = 1;
     cinfo.dct_method = JDCT_IFAST;
+    cinfo.restart_in_rows = restartInRows;
 
     /* Configure sampling factors. The sampling factor is JPEG subsampling 420
      * because the source format is YUV420. Note that libjpeg sampling factors
@@ -718,12 +720,14 @@ int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQualit
         if (done != batchSize) {
             ALOGE("%s: compressed %u lines, expected %u (total %u/%u)", __FUNCTION__, done,
                   batchSize, cinfo.next_scanline, cinfo.image_height);
+            jpeg_destroy_compress(&cinfo);
             return -1;
         }
     }
 
     /* This will flush everything */
     jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
 
     /* Grab the actual code size and set it */
     actualCodeSize = dmgr.mEncodedSize;
@@ -731,6 +735,179 @@ int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQualit
     return 0;
 }
 
+namespace {
+
+constexpr uint8_t kMarkerSof0 = 0xC0;
+constexpr uint8_t kMarkerRst0 = 0xD0;
+constexpr uint8_t kMarkerSoi = 0xD8;
+constexpr uint8_t kMarkerEoi = 0xD9;
+constexpr uint8_t kMarkerSos = 0xDA;
+
+// Offsets of the segments of a JPEG header the strips are joined with
+struct JpegHeader {
+    size_t app0End;   // Where the APP1 segment goes, after SOI and the JFIF APP0 segment
+    size_t sofStart;  // The SOF0 segment holding the image height
+    size_t sosEnd;    // Where the entropy coded data starts
+};
+
+bool parseJpegHeader(const uint8_t* code, size_t size, JpegHeader* header) {
+    if (size < 4 || code[0] != 0xFF || code[1] != kMarkerSoi) {
+        return false;
+    }
+    *header = {.app0End = 2, .sofStart = 0, .sosEnd = 0};
+    size_t pos = 2;
+    while (pos + 4 <= size && code[pos] == 0xFF) {
+        uint8_t marker = code[pos + 1];
+        size_t end = pos + 2 + ((code[pos + 2] << 8) | code[pos + 3]);
+        if (end > size) {
+            return false;
+        }
+        if (marker == JPEG_APP0) {
+            header->app0End = end;
+        } else if (marker == kMarkerSof0) {
+            header->sofStart = pos;
+        } else if (marker == kMarkerSos) {
+            header->sosEnd = end;
+            return header->sofStart != 0;
+        }
+        pos = end;
+    }
+    return false;
+}
+
+}  // anonymous namespace
+
+int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
+                   const void* app1Buffer, size_t app1Size, void* out, size_t maxOutSize,
+                   size_t& actualCodeSize) {
+    return encodeJpegYU12Rows(inSz, inLayout, jpegQuality, app1Buffer, app1Size,
+                              /*restartInRows*/ 0, out, maxOutSize, actualCodeSize);
+}
+
+size_t JpegStripEncoder::init(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
+                              size_t maxOutSize, size_t maxStrips) {
+    mSize = inSz;
+    mLayout = inLayout;
+    mQuality = jpegQuality;
+
+    // YU12 is encoded with 16 lines high MCUs
+    const int32_t mcuRows = (inSz.height + 2 * DCTSIZE - 1) / (2 * DCTSIZE);
+    const int32_t maxStripCount =
+            std::max<int32_t>(1, std::min<int32_t>(maxStrips, mcuRows / kStripMcuRows));
+    int32_t stripMcuRows = (mcuRows + maxStripCount - 1) / maxStripCount;
+    stripMcuRows = (stripMcuRows + kStripMcuRows - 1) / kStripMcuRows * kStripMcuRows;
+    const int32_t stripHeight = stripMcuRows * 2 * DCTSIZE;
+    mNumStrips = (inSz.height + stripHeight - 1) / stripHeight;
+    if (mNumStrips <= 1) {
+        mNumStrips = 1;
+        return mNumStrips;
+    }
+
+    if (mStrips.size() < mNumStrips) {
+        mStrips.resize(mNumStrips);
+    }
+    for (size_t i = 0; i < mNumStrips; i++) {
+        Strip& strip = mStrips[i];
+        strip.top = i * stripHeight;
+        strip.height = std::min(stripHeight, inSz.height - strip.top);
+        strip.codeSize = 0;
+        // A share of the output proportional to the strip height, plus the headers and tables
+        // every strip is encoded with
+        size_t codeSize = 1024 + maxOutSize * strip.height / inSz.height;
+        if (strip.code.size() < codeSize) {
+            strip.code.resize(codeSize);
+        }
+    }
+    return mNumStrips;
+}
+
+int JpegStripEncoder::encodeStrip(size_t index) {
+    if (index >= mNumStrips) {
+        ALOGE("%s: strip %zu out of %zu", __FUNCTION__, index, mNumStrips);
+        return -1;
+    }
+    Strip& strip = mStrips[index];
+    YCbCrLayout layout = mLayout;
+    layout.y = static_cast<uint8_t*>(mLayout.y) + strip.top * mLayout.yStride;
+    layout.cb = static_cast<uint8_t*>(mLayout.cb) + strip.top / 2 * mLayout.cStride;
+    layout.cr = static_cast<uint8_t*>(mLayout.cr) + strip.top / 2 * mLayout.cStride;
+    return encodeJpegYU12Rows(Size{mSize.width, strip.height}, layout, mQuality, nullptr, 0,
+                              /*restartInRows*/ 1, strip.code.data(), strip.code.size(),
+                              strip.codeSize);
+}
+
+int JpegStripEncoder::join(const void* app1Buffer, size_t app1Size, void* out, size_t maxOutSize,
+                           size_t& actualCodeSize) const {
+    if (mNumStrips <= 1) {
+        ALOGE("%s: no strips to join", __FUNCTION__);
+        return -1;
+    }
+    if (app1Size + 2 > UINT16_MAX) {
+        ALOGE("%s: APP1 segment too large: %zu", __FUNCTION__, app1Size);
+        return -1;
+    }
+
+    // The header and tables are taken from the first strip, all the strips are encoded with the
+    // same ones. The entropy coded data of each strip is between its header and its EOI marker.
+    std::vector<JpegHeader> headers(mNumStrips);
+    size_t totalSize = app1Size > 0 ? app1Size + 4 : 0;
+    for (size_t i = 0; i < mNumStrips; i++) {
+        const Strip& strip = mStrips[i];
+        if (!parseJpegHeader(strip.code.data(), strip.codeSize, &headers[i]) ||
+            strip.codeSize < headers[i].sosEnd + 2 || strip.code[strip.codeSize - 2] != 0xFF ||
+            strip.code[strip.codeSize - 1] != kMarkerEoi) {
+            ALOGE("%s: strip %zu is not a valid JPEG", __FUNCTION__, i);
+            return -1;
+        }
+        // The first strip is kept whole, the others are preceded by a restart marker instead
+        totalSize += i == 0 ? strip.codeSize : strip.codeSize - headers[i].sosEnd;
+    }
+    if (totalSize > maxOutSize) {
+        ALOGE("%s: JPEG of %zu bytes does not fit in %zu", __FUNCTION__, totalSize, maxOutSize);
+        return -1;
+    }
+
+    uint8_t* dst = static_cast<uint8_t*>(out);
+    const Strip& first = mStrips[0];
+    const JpegHeader& header = headers[0];
+    memcpy(dst, first.code.data(), header.app0End);
+    dst += header.app0End;
+    if (app1Size > 0) {
+        *dst++ = 0xFF;
+        *dst++ = JPEG_APP0 + 1;
+        *dst++ = (app1Size + 2) >> 8;
+        *dst++ = (app1Size + 2) & 0xFF;
+        memcpy(dst, app1Buffer, app1Size);
+        dst += app1Size;
+    }
+    uint8_t* sof = dst + header.sofStart - header.app0End;
+    memcpy(dst, first.code.data() + header.app0End, first.codeSize - 2 - header.app0End);
+    dst += first.codeSize - 2 - header.app0End;
+    // The SOF0 segment has the height of the first strip, make it the height of the image
+    sof[5] = mSize.height >> 8;
+    sof[6] = mSize.height & 0xFF;
+
+    // The last MCU row of a strip of kStripMcuRows rows is followed by the 8th restart marker
+    for (size_t i = 1; i < mNumStrips; i++) {
+        const Strip& strip = mStrips[i];
+        *dst++ = 0xFF;
+        *dst++ = kMarkerRst0 + kStripMcuRows - 1;
+        size_t dataSize = strip.codeSize - 2 - headers[i].sosEnd;
+        memcpy(dst, strip.code.data() + headers[i].sosEnd, dataSize);
+        dst += dataSize;
+    }
+    *dst++ = 0xFF;
+    *dst++ = kMarkerEoi;
+
+    actualCodeSize = dst - static_cast<uint8_t*>(out);
+    return 0;
+}
+
+void JpegStripEncoder::clear() {
+    mNumStrips = 0;
+    mStrips.clear();
+}
+
 Size getMaxThumbnailResolution(const common::V1_0::helper::CameraMetadata& chars) {
     Size thumbSize{0, 0};
     camera_metadata_ro_entry entry = chars.find(ANDROID_JPEG_AVAILABLE_THUMBNAIL_SIZES);
@@ -761,16 +938,21 @@ void freeReleaseFences(std::vector<CaptureResult>& results) {
 }
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
-#define UPDATE(md, tag, data, size)               \
-    do {                                          \
-        if ((md).update((tag), (data), (size))) { \
-            ALOGE("Update " #tag " failed!");     \
-            return BAD_VALUE;                     \
-        }                                         \
+#define UPDATE(set, index, tag, data, size)          \
+    do {                                             \
+        if ((set)((index), (tag), (data), (size))) { \
+            ALOGE("Update " #tag " failed!");        \
+            return BAD_VALUE;                        \
+        }                                            \
     } while (0)
 
-status_t fillCaptureResultCommon(CameraMetadata& md, nsecs_t timestamp,
-                                 camera_metadata_ro_entry& activeArraySize) {
+namespace {
+
+// Sets the result tags of fillCaptureResultCommon with set(index, tag, data, count), which returns
+// non zero on error
+template <typename Setter>
+status_t setCommonResultTags(Setter&& set, nsecs_t timestamp,
+                             const camera_metadata_ro_entry& activeArraySize) {
     if (activeArraySize.count < 4) {
         ALOGE("%s: cannot find active array size!", __FUNCTION__);
         return -EINVAL;
@@ -780,24 +962,25 @@ status_t fillCaptureResultCommon(CameraMetadata& md, nsecs_t timestamp,
     // indicate the frame should be good to use. Then apps don't have to wait the
     // AE state.
     const uint8_t aeState = ANDROID_CONTROL_AE_STATE_CONVERGED;
-    UPDATE(md, ANDROID_CONTROL_AE_STATE, &aeState, 1);
+    UPDATE(set, RESULT_AE_STATE, ANDROID_CONTROL_AE_STATE, &aeState, 1);
 
     const uint8_t ae_lock = ANDROID_CONTROL_AE_LOCK_OFF;
-    UPDATE(md, ANDROID_CONTROL_AE_LOCK, &ae_lock, 1);
+    UPDATE(set, RESULT_AE_LOCK, ANDROID_CONTROL_AE_LOCK, &ae_lock, 1);
 
     // Set AWB state to converged to indicate the frame should be good to use.
     const uint8_t awbState = ANDROID_CONTROL_AWB_STATE_CONVERGED;
-    UPDATE(md, ANDROID_CONTROL_AWB_STATE, &awbState, 1);
+    UPDATE(set, RESULT_AWB_STATE, ANDROID_CONTROL_AWB_STATE, &awbState, 1);
 
     const uint8_t awbLock = ANDROID_CONTROL_AWB_LOCK_OFF;
-    UPDATE(md, ANDROID_CONTROL_AWB_LOCK, &awbLock, 1);
+    UPDATE(set, RESULT_AWB_LOCK, ANDROID_CONTROL_AWB_LOCK, &awbLock, 1);
 
     const uint8_t flashState = ANDROID_FLASH_STATE_UNAVAILABLE;
-    UPDATE(md, ANDROID_FLASH_STATE, &flashState, 1);
+    UPDATE(set, RESULT_FLASH_STATE, ANDROID_FLASH_STATE, &flashState, 1);
 
     // This means pipeline latency of X frame intervals. The maximum number is 4.
     const uint8_t requestPipelineMaxDepth = 4;
-    UPDATE(md, ANDROID_REQUEST_PIPELINE_DEPTH, &requestPipelineMaxDepth, 1);
+    UPDATE(set, RESULT_PIPELINE_DEPTH, ANDROID_REQUEST_PIPELINE_DEPTH, &requestPipelineMaxDepth,
+           1);
 
     // android.scaler
     const int32_t crop_region[] = {
@@ -806,18 +989,184 @@ status_t fillCaptureResultCommon(CameraMetadata& md, nsecs_t timestamp,
             activeArraySize.data.i32[2],
             activeArraySize.data.i32[3],
     };
-    UPDATE(md, ANDROID_SCALER_CROP_REGION, crop_region, ARRAY_SIZE(crop_region));
+    UPDATE(set, RESULT_CROP_REGION, ANDROID_SCALER_CROP_REGION, crop_region,
+           ARRAY_SIZE(crop_region));
 
     // android.sensor
-    UPDATE(md, ANDROID_SENSOR_TIMESTAMP, &timestamp, 1);
+    UPDATE(set, RESULT_SENSOR_TIMESTAMP, ANDROID_SENSOR_TIMESTAMP, &timestamp, 1);
 
     // android.statistics
     const uint8_t lensShadingMapMode = ANDROID_STATISTICS_LENS_SHADING_MAP_MODE_OFF;
-    UPDATE(md, ANDROID_STATISTICS_LENS_SHADING_MAP_MODE, &lensShadingMapMode, 1);
+    UPDATE(set, RESULT_LENS_SHADING_MAP_MODE, ANDROID_STATISTICS_LENS_SHADING_MAP_MODE,
+           &lensShadingMapMode, 1);
 
     const uint8_t sceneFlicker = ANDROID_STATISTICS_SCENE_FLICKER_NONE;
-    UPDATE(md, ANDROID_STATISTICS_SCENE_FLICKER, &sceneFlicker, 1);
+    UPDATE(set, RESULT_SCENE_FLICKER, ANDROID_STATISTICS_SCENE_FLICKER, &sceneFlicker, 1);
+
+    return OK;
+}
+
+}  // anonymous namespace
+
+std::vector<ResultMetadataBuilder::ResultTag> getCaptureResultTags() {
+    std::vector<ResultMetadataBuilder::ResultTag> tags(RESULT_TAG_COUNT);
+    tags[RESULT_AF_STATE] = {ANDROID_CONTROL_AF_STATE, 1};
+    tags[RESULT_AE_STATE] = {ANDROID_CONTROL_AE_STATE, 1};
+    tags[RESULT_AE_LOCK] = {ANDROID_CONTROL_AE_LOCK, 1};
+    tags[RESULT_AWB_STATE] = {ANDROID_CONTROL_AWB_STATE, 1};
+    tags[RESULT_AWB_LOCK] = {ANDROID_CONTROL_AWB_LOCK, 1};
+    tags[RESULT_FLASH_STATE] = {ANDROID_FLASH_STATE, 1};
+    tags[RESULT_PIPELINE_DEPTH] = {ANDROID_REQUEST_PIPELINE_DEPTH, 1};
+    tags[RESULT_CROP_REGION] = {ANDROID_SCALER_CROP_REGION, 4};
+    tags[RESULT_SENSOR_TIMESTAMP] = {ANDROID_SENSOR_TIMESTAMP, 1};
+    tags[RESULT_LENS_SHADING_MAP_MODE] = {ANDROID_STATISTICS_LENS_SHADING_MAP_MODE, 1};
+    tags[RESULT_SCENE_FLICKER] = {ANDROID_STATISTICS_SCENE_FLICKER, 1};
+    return tags;
+}
+
+status_t fillCaptureResultCommon(CameraMetadata& md, nsecs_t timestamp,
+                                 camera_metadata_ro_entry& activeArraySize) {
+    return setCommonResultTags(
+            [&md](size_t, uint32_t tag, const auto* data, size_t count) {
+                return md.update(tag, data, count);
+            },
+            timestamp, activeArraySize);
+}
+
+status_t fillCaptureResultCommon(ResultMetadataBuilder& builder, nsecs_t timestamp,
+                                 camera_metadata_ro_entry& activeArraySize) {
+    return setCommonResultTags(
+            [&builder](size_t index, uint32_t, const void* data, size_t) {
+                builder.set(index, data);
+                return OK;
+            },
+            timestamp, activeArraySize);
+}
+
+ResultMetadataBuilder::ResultMetadataBuilder(std::vector<ResultTag> resultTags)
+    : mResultTags(std::move(resultTags)),
+      mResultData(mResultTags.size(), nullptr),
+      mResultSizes(mResultTags.size(), 0) {}
+
+ResultMetadataBuilder::~ResultMetadataBuilder() {
+    if (mResult != nullptr) {
+        free_camera_metadata(mResult);
+    }
+}
+
+status_t ResultMetadataBuilder::reset(const camera_metadata_t* settings) {
+    if (settings == nullptr) {
+        ALOGE("%s: no settings", __FUNCTION__);
+        return BAD_VALUE;
+    }
+    const size_t count = get_camera_metadata_entry_count(settings);
+    if (mResult == nullptr || count != mSettings.size()) {
+        return layOut(settings);
+    }
+    for (size_t i = 0; i < count; i++) {
+        camera_metadata_ro_entry entry;
+        get_camera_metadata_ro_entry(settings, i, &entry);
+        const SettingSlot& slot = mSettings[i];
+        if (entry.tag != slot.tag || entry.type != slot.type || entry.count != slot.count) {
+            return layOut(settings);
+        }
+        if (slot.data != nullptr) {
+            memcpy(slot.data, entry.data.u8, slot.size);
+        }
+    }
+    return OK;
+}
+
+void ResultMetadataBuilder::set(size_t index, const void* data) {
+    if (mResultData[index] != nullptr) {
+        memcpy(mResultData[index], data, mResultSizes[index]);
+    }
+}
+
+status_t ResultMetadataBuilder::layOut(const camera_metadata_t* settings) {
+    mLayoutCount++;
+    if (mResult != nullptr) {
+        free_camera_metadata(mResult);
+        mResult = nullptr;
+    }
+    mSettings.clear();
+    std::fill(mResultData.begin(), mResultData.end(), nullptr);
+
+    // Put the settings and the result tags together in a buffer with room for both, the result is
+    // a sorted copy of it with no unused space
+    size_t entryCapacity = get_camera_metadata_entry_count(settings) + mResultTags.size();
+    size_t dataCapacity = get_camera_metadata_data_count(settings);
+    for (const auto& resultTag : mResultTags) {
+        dataCapacity += calculate_camera_metadata_entry_data_size(
+                get_camera_metadata_tag_type(resultTag.tag), resultTag.count);
+    }
+    camera_metadata_t* draft = allocate_camera_metadata(entryCapacity, dataCapacity);
+    if (draft == nullptr) {
+        ALOGE("%s: cannot allocate %zu entries, %zu bytes", __FUNCTION__, entryCapacity,
+              dataCapacity);
+        return NO_MEMORY;
+    }
+    int res = append_camera_metadata(draft, settings);
+    std::vector<uint8_t> zeros;
+    for (size_t i = 0; i < mResultTags.size() && res == OK; i++) {
+        const ResultTag& resultTag = mResultTags[i];
+        int type = get_camera_metadata_tag_type(resultTag.tag);
+        if (type < 0) {
+            ALOGE("%s: unknown result tag 0x%x", __FUNCTION__, resultTag.tag);
+            res = BAD_VALUE;
+            break;
+        }
+        mResultSizes[i] = resultTag.count * camera_metadata_type_size[type];
+        zeros.assign(mResultSizes[i], 0);
+        camera_metadata_entry entry;
+        if (find_camera_metadata_entry(draft, resultTag.tag, &entry) == OK) {
+            res = update_camera_metadata_entry(draft, entry.index, zeros.data(), resultTag.count,
+                                               nullptr);
+        } else {
+            res = add_camera_metadata_entry(draft, resultTag.tag, zeros.data(), resultTag.count);
+        }
+    }
+    if (res == OK) {
+        mResult = clone_camera_metadata(draft);
+        res = mResult == nullptr ? NO_MEMORY : sort_camera_metadata(mResult);
+    }
+    free_camera_metadata(draft);
+    if (res != OK) {
+        ALOGE("%s: cannot lay out the result: %d", __FUNCTION__, res);
+        if (mResult != nullptr) {
+            free_camera_metadata(mResult);
+            mResult = nullptr;
+        }
+        return res;
+    }
 
+    // The data of each entry stays where it is in the result from now on
+    for (size_t i = 0; i < mResultTags.size(); i++) {
+        camera_metadata_entry entry;
+        find_camera_metadata_entry(mResult, mResultTags[i].tag, &entry);
+        mResultData[i] = entry.data.u8;
+    }
+    const size_t count = get_camera_metadata_entry_count(settings);
+    mSettings.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        camera_metadata_ro_entry src;
+        get_camera_metadata_ro_entry(settings, i, &src);
+        SettingSlot& slot = mSettings[i];
+        slot = {.tag = src.tag,
+                .type = src.type,
+                .count = src.count,
+                .data = nullptr,
+                .size = src.count * camera_metadata_type_size[src.type]};
+        bool isResultTag = std::any_of(mResultTags.begin(), mResultTags.end(),
+                                       [&src](const ResultTag& tag) { return tag.tag == src.tag; });
+        if (!isResultTag) {
+            camera_metadata_entry dst;
+            find_camera_metadata_entry(mResult, src.tag, &dst);
+            slot.data = dst.data.u8;
+        }
+    }
+    ALOGV("%s: %zu settings and %zu result tags in %zu bytes", __FUNCTION__, count,
+          mResultTags.size(), get_camera_metadata_size(mResult));
     return OK;
 }
 
@@ -850,6 +1199,296 @@ int AllocatedV4L2Frame::getData(uint8_t** outData, size_t* dataSize) {
     return 0;
 }
 
+void ScaledFrameCache::resetLocked(const std::shared_ptr<AllocatedFrame>& in) {
+    if (mIn != in) {
+        mIn = in;
+        mLevels.clear();
+    }
+}
+
+int ScaledFrameCache::addLevelLocked(const Size& outSize) {
+    Size inSize = {mIn->mWidth, mIn->mHeight};
+    Level level;
+    if (inSize == outSize) {
+        level.crop = {0, 0, inSize.width, inSize.height};
+        level.needsScale = false;
+    } else {
+        // Cropping to output aspect ratio
+        int ret = getCropRect(mCroppingType, inSize, outSize, &level.crop);
+        if (ret != 0) {
+            ALOGE("%s: failed to compute crop rect for output size %dx%d", __FUNCTION__,
+                  outSize.width, outSize.height);
+            return ret;
+        }
+        level.needsScale = !((mCroppingType == VERTICAL && inSize.width == outSize.width) ||
+                             (mCroppingType == HORIZONTAL && inSize.height == outSize.height));
+    }
+    mLevels.emplace(outSize, level);
+    return 0;
+}
+
+void ScaledFrameCache::plan(const std::shared_ptr<AllocatedFrame>& in,
+                            const IntermediateBuffers& buffers, const std::vector<Size>& sizes) {
+    std::lock_guard<std::mutex> lk(mLock);
+    resetLocked(in);
+    for (const auto& size : sizes) {
+        if (mLevels.count(size) == 0) {
+            // A size that can't be cropped fails again when its buffers are filled
+            addLevelLocked(size);
+        }
+    }
+
+    // Maps a length in the input frame to a size scaled from cropExtent to extent, rounded down to
+    // an even length
+    auto toCandidate = [](int32_t length, int32_t extent, int32_t cropExtent) {
+        return static_cast<int32_t>(static_cast<int64_t>(length) * extent / cropExtent) & ~0x1;
+    };
+    for (auto& [size, level] : mLevels) {
+        if (!level.needsScale || level.state != State::PENDING) {
+            continue;
+        }
+        level.parent.reset();
+        int64_t parentArea = 0;
+        for (const auto& [candidateSize, candidate] : mLevels) {
+            int64_t area = static_cast<int64_t>(candidateSize.width) * candidateSize.height;
+            // Only chain from a larger downscale covering the whole crop
+            if (!candidate.needsScale || buffers.count(candidateSize) == 0 ||
+                area <= static_cast<int64_t>(size.width) * size.height ||
+                (level.parent.has_value() && area >= parentArea) ||
+                candidateSize.width > candidate.crop.width ||
+                candidateSize.height > candidate.crop.height ||
+                level.crop.left < candidate.crop.left || level.crop.top < candidate.crop.top ||
+                level.crop.left + level.crop.width > candidate.crop.left + candidate.crop.width ||
+                level.crop.top + level.crop.height > candidate.crop.top + candidate.crop.height) {
+                continue;
+            }
+            // The crop of level in the candidate, which has to be downscaled to size too
+            IMapper::Rect crop;
+            crop.left = toCandidate(level.crop.left - candidate.crop.left, candidateSize.width,
+                                    candidate.crop.width);
+            crop.top = toCandidate(level.crop.top - candidate.crop.top, candidateSize.height,
+                                   candidate.crop.height);
+            crop.width = std::min(toCandidate(level.crop.width, candidateSize.width,
+                                              candidate.crop.width),
+                                  candidateSize.width - crop.left);
+            crop.height = std::min(toCandidate(level.crop.height, candidateSize.height,
+                                               candidate.crop.height),
+                                   candidateSize.height - crop.top);
+            if (crop.width < size.width || crop.height < size.height) {
+                continue;
+            }
+            level.parent = candidateSize;
+            level.parentCrop = crop;
+            parentArea = area;
+        }
+    }
+}
+
+int ScaledFrameCache::get(const std::shared_ptr<AllocatedFrame>& in,
+                          const IntermediateBuffers& buffers, const Size& outSize,
+                          YCbCrLayout* out) {
+    std::unique_lock<std::mutex> lk(mLock);
+    resetLocked(in);
+    auto it = mLevels.find(outSize);
+    if (it == mLevels.end()) {
+        int ret = addLevelLocked(outSize);
+        if (ret != 0) {
+            return ret;
+        }
+        it = mLevels.find(outSize);
+    }
+    Level& level = it->second;
+    if (!level.needsScale) {
+        IMapper::Rect crop = level.crop;
+        lk.unlock();
+        int ret = in->getCroppedLayout(crop, out);
+        if (ret != 0) {
+            ALOGE("%s: failed to crop input image %dx%d to output size %dx%d", __FUNCTION__,
+                  in->mWidth, in->mHeight, outSize.width, outSize.height);
+        }
+        return ret;
+    }
+
+    if (level.state == State::PENDING) {
+        level.state = State::SCALING;
+        lk.unlock();
+        int ret = scale(in, buffers, outSize, &level);
+        lk.lock();
+        level.result = ret;
+        level.state = State::DONE;
+        if (level.parent.has_value()) {
+            mStats.chained++;
+        } else {
+            mStats.fromInput++;
+        }
+        mScaledCond.notify_all();
+    } else {
+        mScaledCond.wait(lk, [&level] { return level.state == State::DONE; });
+        mStats.shared++;
+    }
+    if (level.result != 0) {
+        return level.result;
+    }
+    *out = level.layout;
+    return 0;
+}
+
+int ScaledFrameCache::scale(const std::shared_ptr<AllocatedFrame>& in,
+                            const IntermediateBuffers& buffers, const Size& outSize,
+                            Level* level) {
+    auto it = buffers.find(outSize);
+    if (it == buffers.end()) {
+        ALOGE("%s: failed to find intermediate buffer size %dx%d", __FUNCTION__, outSize.width,
+              outSize.height);
+        return -1;
+    }
+
+    // Only the thread scaling level reads or writes its crops and layout until it is done
+    IMapper::Rect inputCrop = level->crop;
+    std::shared_ptr<AllocatedFrame> input = in;
+    if (level->parent.has_value()) {
+        YCbCrLayout parentLayout;
+        int ret = get(in, buffers, *level->parent, &parentLayout);
+        if (ret != 0) {
+            return ret;
+        }
+        inputCrop = level->parentCrop;
+        input = buffers.at(*level->parent);
+    }
+    YCbCrLayout croppedLayout;
+    int ret = input->getCroppedLayout(inputCrop, &croppedLayout);
+    if (ret != 0) {
+        ALOGE("%s: failed to crop input image %dx%d to output size %dx%d", __FUNCTION__,
+              input->mWidth, input->mHeight, outSize.width, outSize.height);
+        return ret;
+    }
+
+    YCbCrLayout outLayout;
+    ret = it->second->getLayout(&outLayout);
+    if (ret != 0) {
+        ALOGE("%s: failed to get output buffer layout", __FUNCTION__);
+        return ret;
+    }
+
+    ret = libyuv::I420Scale(
+            static_cast<uint8_t*>(croppedLayout.y), croppedLayout.yStride,
+            static_cast<uint8_t*>(croppedLayout.cb), croppedLayout.cStride,
+            static_cast<uint8_t*>(croppedLayout.cr), croppedLayout.cStride, inputCrop.width,
+            inputCrop.height, static_cast<uint8_t*>(outLayout.y), outLayout.yStride,
+            static_cast<uint8_t*>(outLayout.cb), outLayout.cStride,
+            static_cast<uint8_t*>(outLayout.cr), outLayout.cStride, outSize.width, outSize.height,
+            // TODO: b/72261744 see if we can use better filter without losing too much perf
+            libyuv::FilterMode::kFilterNone);
+    if (ret != 0) {
+        ALOGE("%s: failed to scale buffer from %dx%d to %dx%d. Ret %d", __FUNCTION__,
+              inputCrop.width, inputCrop.height, outSize.width, outSize.height, ret);
+        return ret;
+    }
+
+    level->layout = outLayout;
+    return 0;
+}
+
+void ScaledFrameCache::clear() {
+    std::lock_guard<std::mutex> lk(mLock);
+    mIn.reset();
+    mLevels.clear();
+}
+
+bool ScaledFrameCache::empty() const {
+    std::lock_guard<std::mutex> lk(mLock);
+    return mLevels.empty();
+}
+
+size_t ScaledFrameCache::size() const {
+    std::lock_guard<std::mutex> lk(mLock);
+    return mLevels.size();
+}
+
+ScaledFrameCache::Stats ScaledFrameCache::getStats() const {
+    std::lock_guard<std::mutex> lk(mLock);
+    return mStats;
+}
+
+WorkerPool::WorkerPool(size_t numThreads) {
+    for (size_t i = 0; i < numThreads; i++) {
+        mThreads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lk(mLock);
+        mExit = true;
+    }
+    mCond.notify_all();
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+std::future<int> WorkerPool::submit(std::function<int()> task) {
+    std::packaged_task<int()> packaged(std::move(task));
+    std::future<int> result = packaged.get_future();
+    {
+        std::lock_guard<std::mutex> lk(mLock);
+        mTasks.push_back(std::move(packaged));
+    }
+    mCond.notify_one();
+    return result;
+}
+
+int WorkerPool::parallelFor(size_t count, const std::function<int(size_t)>& task) {
+    // Shared with the workers, which may start after all the tasks are done and this returned
+    struct State {
+        std::function<int(size_t)> task;
+        std::atomic<size_t> next = 0;
+        std::mutex lock;
+        std::condition_variable doneCond;
+        size_t done = 0;  // Protected by lock
+        int result = 0;   // Protected by lock
+    };
+    auto state = std::make_shared<State>();
+    state->task = task;
+    auto runTasks = [state, count] {
+        for (size_t i = state->next++; i < count; i = state->next++) {
+            int ret = state->task(i);
+            std::lock_guard<std::mutex> lk(state->lock);
+            if (state->result == 0) {
+                state->result = ret;
+            }
+            if (++state->done == count) {
+                state->doneCond.notify_all();
+            }
+        }
+        return 0;
+    };
+
+    for (size_t i = 1; i < count && i <= mThreads.size(); i++) {
+        submit(runTasks);
+    }
+    runTasks();
+    std::unique_lock<std::mutex> lk(state->lock);
+    state->doneCond.wait(lk, [&state, count] { return state->done == count; });
+    return state->result;
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        std::packaged_task<int()> task;
+        {
+            std::unique_lock<std::mutex> lk(mLock);
+            mCond.wait(lk, [this] { return mExit || !mTasks.empty(); });
+            if (mTasks.empty()) {
+                return;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
+
 }  // namespace implementation
 }  // namespace device
 }  // namespace camera
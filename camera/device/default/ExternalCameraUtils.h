@@ -29,7 +29,13 @@
 #include <android/hardware/graphics/mapper/3.0/IMapper.h>
 #include <android/hardware/graphics/mapper/4.0/IMapper.h>
 #include <tinyxml2.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
 #include <map>
+#include <optional>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -251,12 +257,177 @@ int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQualit
                    const void* app1Buffer, size_t app1Size, void* out, size_t maxOutSize,
                    size_t& actualCodeSize);
 
+// encodeJpegYU12 with a restart marker every restartInRows MCU rows if restartInRows is not 0
+int encodeJpegYU12Rows(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
+                       const void* app1Buffer, size_t app1Size, int restartInRows, void* out,
+                       size_t maxOutSize, size_t& actualCodeSize);
+
+// Encodes a YU12 image as horizontal strips which can be encoded concurrently, and joins them into
+// one baseline JPEG. A restart marker is inserted after every MCU row, so each strip is an
+// independent run of entropy coded data. The strip buffers are kept for the next image.
+class JpegStripEncoder {
+  public:
+    // Splits the image in at most maxStrips strips for a JPEG of at most maxOutSize bytes. Returns
+    // the number of strips, 1 if the image is too small to be split.
+    size_t init(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
+                size_t maxOutSize, size_t maxStrips);
+    // Encodes the strip at index, different strips can be encoded in parallel
+    int encodeStrip(size_t index);
+    // Writes the JPEG of the encoded strips to out, with the APP1 segment in app1Buffer if any
+    int join(const void* app1Buffer, size_t app1Size, void* out, size_t maxOutSize,
+             size_t& actualCodeSize) const;
+    // Frees the strip buffers
+    void clear();
+
+  private:
+    // The restart markers are numbered modulo 8, so strips of a multiple of 8 MCU rows are joined
+    // with no need to renumber the markers in them.
+    static constexpr int32_t kStripMcuRows = 8;
+
+    struct Strip {
+        int32_t top;
+        int32_t height;
+        std::vector<uint8_t> code;
+        size_t codeSize;
+    };
+
+    Size mSize;
+    YCbCrLayout mLayout;
+    int mQuality;
+    size_t mNumStrips = 0;
+    std::vector<Strip> mStrips;  // The first mNumStrips are used
+};
+
+typedef std::unordered_map<Size, std::shared_ptr<AllocatedFrame>, SizeHasher> IntermediateBuffers;
+
+// The crops and scales of one YU12 frame to the output sizes of a request, each computed once and
+// shared by all the output buffers of its size. A size is scaled from the smallest larger planned
+// size covering its crop, instead of from the whole frame, when there is one. Thread safe, the
+// output buffers of different sizes can be filled in parallel.
+class ScaledFrameCache {
+  public:
+    explicit ScaledFrameCache(CroppingType ct) : mCroppingType(ct) {}
+
+    // Plans the sizes the output buffers of in are cropped and scaled to, chaining the downscales
+    // between them. Sizes that are not planned are scaled from in.
+    void plan(const std::shared_ptr<AllocatedFrame>& in, const IntermediateBuffers& buffers,
+              const std::vector<Size>& sizes);
+    // Returns in cropped to the aspect ratio of outSize and scaled to outSize, in the buffer of
+    // outSize from buffers if it has to be scaled.
+    int get(const std::shared_ptr<AllocatedFrame>& in, const IntermediateBuffers& buffers,
+            const Size& outSize, YCbCrLayout* out);
+    // Forgets the frame, must be called before writing to it or to the intermediate buffers again
+    void clear();
+    bool empty() const;
+    size_t size() const;
+
+    struct Stats {
+        uint64_t fromInput = 0;  // Sizes scaled from the whole frame
+        uint64_t chained = 0;    // Sizes scaled from a larger size
+        uint64_t shared = 0;     // Uses of a size already scaled, by a buffer or a smaller size
+    };
+    Stats getStats() const;
+
+  private:
+    enum class State { PENDING, SCALING, DONE };
+    struct Level {
+        IMapper::Rect crop;  // In the input frame
+        bool needsScale;
+        // The larger size scaled from and the crop in it, the input frame if parent is not set
+        std::optional<Size> parent;
+        IMapper::Rect parentCrop;
+        YCbCrLayout layout;
+        State state = State::PENDING;
+        int result = 0;
+    };
+
+    // Called with mLock held
+    void resetLocked(const std::shared_ptr<AllocatedFrame>& in);
+    int addLevelLocked(const Size& outSize);
+    int scale(const std::shared_ptr<AllocatedFrame>& in, const IntermediateBuffers& buffers,
+              const Size& outSize, Level* level);
+
+    const CroppingType mCroppingType;
+    mutable std::mutex mLock;
+    std::condition_variable mScaledCond;  // Signaled when a size is scaled
+    std::shared_ptr<AllocatedFrame> mIn;
+    std::unordered_map<Size, Level, SizeHasher> mLevels;
+    Stats mStats;
+};
+
 Size getMaxThumbnailResolution(const common::V1_0::helper::CameraMetadata&);
 
 void freeReleaseFences(std::vector<CaptureResult>&);
 
+// Builds result metadata, the request settings with the result tags set on top of them, into a
+// buffer reused from one result to the next. The result is laid out for the tags of the settings,
+// which rarely change within a session. The following results copy their settings and set their
+// result tags at fixed offsets, with no search and no allocation. Not thread safe.
+class ResultMetadataBuilder {
+  public:
+    struct ResultTag {
+        uint32_t tag;
+        size_t count;
+    };
+
+    explicit ResultMetadataBuilder(std::vector<ResultTag> resultTags);
+    ~ResultMetadataBuilder();
+    ResultMetadataBuilder(const ResultMetadataBuilder&) = delete;
+    ResultMetadataBuilder& operator=(const ResultMetadataBuilder&) = delete;
+
+    // Starts a result with a copy of settings. The result is laid out again if the tags of
+    // settings, their types or their counts differ from those of the previous settings.
+    status_t reset(const camera_metadata_t* settings);
+    // Sets the result tag at index in the result tags, data holds count values of its type
+    void set(size_t index, const void* data);
+    // The result, valid until the next reset
+    const camera_metadata_t* get() const { return mResult; }
+
+    // Number of times the result was laid out
+    uint64_t getLayoutCount() const { return mLayoutCount; }
+
+  private:
+    status_t layOut(const camera_metadata_t* settings);
+
+    struct SettingSlot {
+        uint32_t tag;
+        uint8_t type;
+        size_t count;
+        uint8_t* data;  // In mResult, nullptr for a result tag
+        size_t size;
+    };
+
+    const std::vector<ResultTag> mResultTags;
+    std::vector<uint8_t*> mResultData;  // In mResult, for each result tag
+    std::vector<size_t> mResultSizes;
+    std::vector<SettingSlot> mSettings;
+    camera_metadata_t* mResult = nullptr;
+    uint64_t mLayoutCount = 0;
+};
+
+// The result tags set by fillCaptureResultCommon, and the AF state set by the sessions, in the
+// order of getCaptureResultTags()
+enum CaptureResultTag : size_t {
+    RESULT_AF_STATE = 0,
+    RESULT_AE_STATE,
+    RESULT_AE_LOCK,
+    RESULT_AWB_STATE,
+    RESULT_AWB_LOCK,
+    RESULT_FLASH_STATE,
+    RESULT_PIPELINE_DEPTH,
+    RESULT_CROP_REGION,
+    RESULT_SENSOR_TIMESTAMP,
+    RESULT_LENS_SHADING_MAP_MODE,
+    RESULT_SCENE_FLICKER,
+    RESULT_TAG_COUNT,
+};
+
+std::vector<ResultMetadataBuilder::ResultTag> getCaptureResultTags();
+
 status_t fillCaptureResultCommon(common::V1_0::helper::CameraMetadata& md, nsecs_t timestamp,
                                  camera_metadata_ro_entry& activeArraySize);
+status_t fillCaptureResultCommon(ResultMetadataBuilder& builder, nsecs_t timestamp,
+                                 camera_metadata_ro_entry& activeArraySize);
 
 // Interface for OutputThread calling back to parent
 struct OutputThreadInterface {
@@ -297,6 +468,31 @@ class AllocatedV4L2Frame : public Frame {
     std::vector<uint8_t> mData;
 };
 
+// A fixed set of threads running the tasks the output thread fans out for one frame, e.g. the
+// decode of the next frame and the output buffers of different sizes.
+class WorkerPool {
+  public:
+    explicit WorkerPool(size_t numThreads);
+    ~WorkerPool();  // Waits for the queued tasks to finish
+
+    // Queues task, the returned future holds its return value
+    std::future<int> submit(std::function<int()> task);
+    // Runs task(0) to task(count - 1) on the workers and the calling thread, and returns the first
+    // non zero result once they are all done. The calling thread runs the tasks no worker has
+    // started, so this can be called from a task.
+    int parallelFor(size_t count, const std::function<int(size_t)>& task);
+    size_t size() const { return mThreads.size(); }
+
+  private:
+    void workerLoop();
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::deque<std::packaged_task<int()>> mTasks;  // Protected by mLock
+    bool mExit = false;                            // Protected by mLock
+    std::vector<std::thread> mThreads;
+};
+
 }  // namespace implementation
 }  // namespace device
 }  // namespace camera
@@ -0,0 +1,474 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays MJPEG frames captured from a V4L2 camera through the external camera OutputThread, with
+// its threadLoop run on the benchmark thread. The requests are submitted one at a time, or all at
+// once for the decode of the next request to overlap with the outputs of the current one.
+// BM_FillOutputs fills the output buffers of one decoded frame, and BM_JpegCapture measures the
+// still capture of 8 and 12 MP JPEGs from a synthetic frame. The output buffers are gralloc
+// buffers, locked and filled the way the session does it.
+//
+// Each file in $EXTERNAL_CAMERA_REPLAY_DIR (/data/local/tmp/external_camera_replay by default)
+// holds one frame as dequeued from V4L2, e.g. captured with
+//   v4l2-ctl --set-fmt-video=width=1920,height=1080,pixelformat=MJPG --stream-mmap
+//            --stream-count=1 --stream-to=frame0.mjpg
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ExternalCameraDeviceSession.h>
+#include <android/hardware_buffer.h>
+#include <benchmark/benchmark.h>
+#include <linux/videodev2.h>
+#include <vndk/hardware_buffer.h>
+
+#define HAVE_JPEG  // required for libyuv.h to export MJPEG decode APIs
+#include <libyuv.h>
+
+using namespace ::android::hardware::camera::device::implementation;
+using HelperCameraMetadata = ::android::hardware::camera::common::V1_0::helper::CameraMetadata;
+
+namespace {
+
+constexpr char kDefaultReplayDir[] = "/data/local/tmp/external_camera_replay";
+constexpr uint8_t kJpegQuality = 90;
+constexpr Size kThumbSize = {320, 240};
+
+struct ReplayFrames {
+    std::vector<std::vector<uint8_t>> frames;
+    Size size = {0, 0};
+};
+
+const ReplayFrames& getReplayFrames() {
+    static const ReplayFrames replay = [] {
+        ReplayFrames replay;
+        const char* dir = getenv("EXTERNAL_CAMERA_REPLAY_DIR");
+        std::string path = dir != nullptr ? dir : kDefaultReplayDir;
+        DIR* d = opendir(path.c_str());
+        if (d == nullptr) {
+            return replay;
+        }
+        std::vector<std::string> names;
+        while (dirent* entry = readdir(d)) {
+            if (entry->d_type == DT_REG) {
+                names.push_back(entry->d_name);
+            }
+        }
+        closedir(d);
+        std::sort(names.begin(), names.end());
+        for (const auto& name : names) {
+            std::ifstream file(path + "/" + name, std::ios::binary);
+            std::vector<uint8_t> frame((std::istreambuf_iterator<char>(file)),
+                                       std::istreambuf_iterator<char>());
+            int width, height;
+            if (libyuv::MJPGSize(frame.data(), frame.size(), &width, &height) != 0) {
+                continue;
+            }
+            if (replay.frames.empty()) {
+                replay.size = {width, height};
+            } else if (width != replay.size.width || height != replay.size.height) {
+                continue;
+            }
+            replay.frames.push_back(std::move(frame));
+        }
+        return replay;
+    }();
+    return replay;
+}
+
+// A replayed frame, as dequeued from V4L2
+class ReplayFrame : public Frame {
+  public:
+    ReplayFrame(const Size& size, const std::vector<uint8_t>& data)
+        : Frame(size.width, size.height, V4L2_PIX_FMT_MJPEG), mData(data) {}
+
+    int getData(uint8_t** outData, size_t* dataSize) override {
+        *outData = const_cast<uint8_t*>(mData.data());
+        *dataSize = mData.size();
+        return 0;
+    }
+
+  private:
+    const std::vector<uint8_t>& mData;
+};
+
+void closeReleaseFences(HalRequest& req) {
+    for (auto& buf : req.buffers) {
+        if (buf.acquireFence >= 0) {
+            ::close(buf.acquireFence);
+            buf.acquireFence = -1;
+        }
+    }
+}
+
+// Counts the requests returned by the OutputThread. The output buffers are not sent anywhere, the
+// next requests reuse them.
+class ReplayParent : public OutputThreadInterface {
+  public:
+    Status importBuffer(int32_t, uint64_t, buffer_handle_t, buffer_handle_t**) override {
+        return Status::OK;
+    }
+
+    void notifyError(int32_t, int32_t, ErrorCode) override { mErrors++; }
+
+    Status processCaptureRequestError(const std::shared_ptr<HalRequest>& req,
+                                      std::vector<NotifyMsg>*,
+                                      std::vector<CaptureResult>*) override {
+        closeReleaseFences(*req);
+        mErrors++;
+        return Status::OK;
+    }
+
+    Status processCaptureResult(std::shared_ptr<HalRequest>& req) override {
+        closeReleaseFences(*req);
+        mResults++;
+        return Status::OK;
+    }
+
+    // The size of the BLOB buffers is given to allocateIntermediateBuffers
+    ssize_t getJpegBufferSize(int32_t, int32_t) const override { return -1; }
+
+    size_t getReturned() const { return mResults + mErrors; }
+    size_t getErrors() const { return mErrors; }
+
+  private:
+    size_t mResults = 0;
+    size_t mErrors = 0;
+};
+
+// The OutputThread of a session, whose threadLoop is run by the benchmark
+class ReplayOutputThread : public ExternalCameraDeviceSession::OutputThread {
+  public:
+    using OutputThread::OutputThread;
+
+    // Starts the workers threadLoop starts on the first request, for processOutputBuffers to fill
+    // the outputs in parallel
+    void startWorkers() { mWorkerPool = std::make_unique<WorkerPool>(kMaxWorkerThreads); }
+
+    // Decodes the frame of req, the way threadLoop does it for a request that is not prefetched
+    int decode(HalRequest& req) {
+        std::lock_guard<std::mutex> lk(mBufferLock);
+        uint8_t* inData;
+        size_t inDataSize;
+        int ret = req.frameIn->getData(&inData, &inDataSize);
+        return ret != 0 ? ret
+                        : decodeFrameLocked(req, inData, inDataSize, mYu12Frame, mYu12FrameLayout);
+    }
+
+    // Fills the decoded frame with a gradient with some texture, for a realistic amount of entropy
+    // coded data once encoded
+    void fillSyntheticFrame() {
+        std::lock_guard<std::mutex> lk(mBufferLock);
+        for (int32_t y = 0; y < mYu12Frame->mHeight; y++) {
+            uint8_t* row = static_cast<uint8_t*>(mYu12FrameLayout.y) + y * mYu12FrameLayout.yStride;
+            for (int32_t x = 0; x < mYu12Frame->mWidth; x++) {
+                row[x] = static_cast<uint8_t>((x + y) / 16 + ((x * 7) ^ (y * 13)) % 24);
+            }
+        }
+        const size_t chromaSize = mYu12FrameLayout.cStride * mYu12Frame->mHeight / 2;
+        memset(mYu12FrameLayout.cb, 100, chromaSize);
+        memset(mYu12FrameLayout.cr, 150, chromaSize);
+    }
+
+    // Fills the output buffers of req from the decoded frame
+    int processOutputBuffers(HalRequest& req) {
+        std::lock_guard<std::mutex> lk(mBufferLock);
+        int ret = processOutputBuffersLocked(req, nullptr, 0);
+        mScaledYu12Frames.clear();
+        return ret;
+    }
+
+    ScaledFrameCache::Stats getScaleStats() const { return mScaledYu12Frames.getStats(); }
+
+    uint64_t getPrefetchedDecodes() {
+        std::lock_guard<std::mutex> lk(mTimingLock);
+        return mPrefetchedDecodes;
+    }
+};
+
+// A gralloc buffer of an output stream
+class StreamBuffer {
+  public:
+    StreamBuffer(int32_t streamId, const Size& size, PixelFormat format, uint32_t blobSize) {
+        const bool blob = format == PixelFormat::BLOB;
+        const AHardwareBuffer_Desc desc = {
+                .width = blob ? blobSize : static_cast<uint32_t>(size.width),
+                .height = blob ? 1 : static_cast<uint32_t>(size.height),
+                .layers = 1,
+                .format = static_cast<uint32_t>(format),
+                .usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN |
+                         AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN,
+        };
+        if (AHardwareBuffer_allocate(&desc, &mBuffer) == 0) {
+            mHandle = AHardwareBuffer_getNativeHandle(mBuffer);
+        }
+        mHalBuffer = {
+                .streamId = streamId,
+                .bufferId = streamId + 1,
+                .width = size.width,
+                .height = size.height,
+                .format = format,
+                .usage = static_cast<BufferUsage>(desc.usage),
+                .bufPtr = &mHandle,
+                .acquireFence = -1,
+                .fenceTimeout = false,
+        };
+    }
+
+    ~StreamBuffer() {
+        if (mBuffer != nullptr) {
+            AHardwareBuffer_release(mBuffer);
+        }
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    bool isValid() const { return mHandle != nullptr; }
+    const HalStreamBuffer& get() const { return mHalBuffer; }
+
+  private:
+    AHardwareBuffer* mBuffer = nullptr;
+    buffer_handle_t mHandle = nullptr;
+    HalStreamBuffer mHalBuffer;
+};
+
+CroppingType getCroppingType(const Size& captureSize, const std::vector<Size>& sizes) {
+    // Crop the top and bottom of the capture if an output is wider, the sides otherwise
+    for (const auto& size : sizes) {
+        if (ASPECT_RATIO(size) > ASPECT_RATIO(captureSize) &&
+            !isAspectRatioClose(ASPECT_RATIO(size), ASPECT_RATIO(captureSize))) {
+            return VERTICAL;
+        }
+    }
+    return HORIZONTAL;
+}
+
+// A configured session, with a YUV stream of each of yuvSizes and optionally a full size JPEG
+// stream. Each request has a buffer of every stream.
+class ReplaySession {
+  public:
+    ReplaySession(const Size& captureSize, const std::vector<Size>& yuvSizes, bool withJpeg)
+        : mCaptureSize(captureSize) {
+        const uint32_t blobSize = captureSize.width * captureSize.height * 3 / 2;
+        std::vector<Stream> streams;
+        auto addStream = [&](const Size& size, PixelFormat format) {
+            Stream stream;
+            stream.id = static_cast<int32_t>(streams.size());
+            stream.width = size.width;
+            stream.height = size.height;
+            stream.format = format;
+            streams.push_back(stream);
+            mBuffers.push_back(std::make_unique<StreamBuffer>(stream.id, size, format, blobSize));
+        };
+        for (const auto& size : yuvSizes) {
+            addStream(size, PixelFormat::YCBCR_420_888);
+        }
+        if (withJpeg) {
+            addStream(captureSize, PixelFormat::BLOB);
+        }
+
+        const int32_t thumbSize[] = {kThumbSize.width, kThumbSize.height};
+        mSettings.update(ANDROID_JPEG_QUALITY, &kJpegQuality, 1);
+        mSettings.update(ANDROID_JPEG_THUMBNAIL_QUALITY, &kJpegQuality, 1);
+        mSettings.update(ANDROID_JPEG_THUMBNAIL_SIZE, thumbSize, 2);
+
+        mParent = std::make_shared<ReplayParent>();
+        mThread = std::make_shared<ReplayOutputThread>(
+                mParent, getCroppingType(captureSize, yuvSizes),
+                HelperCameraMetadata(), /*bufReqThread*/ nullptr);
+        mValid = mThread->allocateIntermediateBuffers(captureSize, kThumbSize, streams,
+                                                      blobSize) == Status::OK &&
+                 std::all_of(mBuffers.begin(), mBuffers.end(),
+                             [](const auto& buffer) { return buffer->isValid(); });
+    }
+
+    bool isValid() const { return mValid; }
+    ReplayParent& parent() { return *mParent; }
+    ReplayOutputThread& thread() { return *mThread; }
+
+    // frame is not copied, it must outlive the request
+    std::shared_ptr<HalRequest> makeRequest(const std::vector<uint8_t>* frame) {
+        auto req = std::make_shared<HalRequest>();
+        req->frameNumber = mNextFrameNumber++;
+        req->setting = mSettings;
+        if (frame != nullptr) {
+            req->frameIn = std::make_shared<ReplayFrame>(mCaptureSize, *frame);
+        }
+        for (const auto& buffer : mBuffers) {
+            req->buffers.push_back(buffer->get());
+        }
+        return req;
+    }
+
+    void submit(const std::vector<uint8_t>& frame) { mThread->submitRequest(makeRequest(&frame)); }
+
+  private:
+    const Size mCaptureSize;
+    std::vector<std::unique_ptr<StreamBuffer>> mBuffers;
+    HelperCameraMetadata mSettings;
+    std::shared_ptr<ReplayParent> mParent;
+    std::shared_ptr<ReplayOutputThread> mThread;
+    int32_t mNextFrameNumber = 0;
+    bool mValid = false;
+};
+
+// Video at the capture size, preview and YUV analysis streams
+std::vector<Size> getYuvSizes(const Size& captureSize) {
+    return {captureSize, Size{1280, 720}, Size{640, 480}, Size{320, 240}};
+}
+
+void setCounters(benchmark::State& state, const ReplayFrames& replay, ReplaySession& session) {
+    state.counters["fps"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * replay.frames.size()),
+            benchmark::Counter::kIsRate);
+    ScaledFrameCache::Stats stats = session.thread().getScaleStats();
+    state.counters["chained"] = static_cast<double>(stats.chained);
+    state.counters["fromCapture"] = static_cast<double>(stats.fromInput);
+    state.counters["prefetched"] = static_cast<double>(session.thread().getPrefetchedDecodes());
+}
+
+// Each request is submitted once the previous one is returned, so no decode is overlapped
+void BM_SerialReplay(benchmark::State& state) {
+    const ReplayFrames& replay = getReplayFrames();
+    if (replay.frames.empty()) {
+        state.SkipWithError("no MJPEG frames to replay");
+        return;
+    }
+    ReplaySession session(replay.size, getYuvSizes(replay.size), state.range(0) != 0);
+    if (!session.isValid()) {
+        state.SkipWithError("session setup failed");
+        return;
+    }
+    for (auto _ : state) {
+        for (const auto& frame : replay.frames) {
+            session.submit(frame);
+            session.thread().threadLoop();
+        }
+    }
+    if (session.parent().getErrors() != 0) {
+        state.SkipWithError("processing failed");
+        return;
+    }
+    setCounters(state, replay, session);
+}
+
+// All the requests are submitted up front, as the framework keeps the pipeline full, so the next
+// frame is decoded while the outputs of the current one are filled
+void BM_PipelinedReplay(benchmark::State& state) {
+    const ReplayFrames& replay = getReplayFrames();
+    if (replay.frames.empty()) {
+        state.SkipWithError("no MJPEG frames to replay");
+        return;
+    }
+    ReplaySession session(replay.size, getYuvSizes(replay.size), state.range(0) != 0);
+    if (!session.isValid()) {
+        state.SkipWithError("session setup failed");
+        return;
+    }
+    for (auto _ : state) {
+        const size_t returned = session.parent().getReturned() + replay.frames.size();
+        for (const auto& frame : replay.frames) {
+            session.submit(frame);
+        }
+        while (session.parent().getReturned() < returned && session.thread().threadLoop()) {
+        }
+    }
+    if (session.parent().getErrors() != 0) {
+        state.SkipWithError("processing failed");
+        return;
+    }
+    setCounters(state, replay, session);
+}
+
+// The outputs of one decoded frame, filled on the calling thread only or in parallel
+void BM_FillOutputs(benchmark::State& state) {
+    const ReplayFrames& replay = getReplayFrames();
+    if (replay.frames.empty()) {
+        state.SkipWithError("no MJPEG frames to replay");
+        return;
+    }
+    ReplaySession session(replay.size, getYuvSizes(replay.size), /*withJpeg*/ false);
+    if (!session.isValid() ||
+        session.thread().decode(*session.makeRequest(&replay.frames[0])) != 0) {
+        state.SkipWithError("session setup failed");
+        return;
+    }
+    if (state.range(0) != 0) {
+        session.thread().startWorkers();
+    }
+    for (auto _ : state) {
+        std::shared_ptr<HalRequest> req = session.makeRequest(nullptr);
+        int ret = session.thread().processOutputBuffers(*req);
+        closeReleaseFences(*req);
+        if (ret != 0) {
+            state.SkipWithError("processing failed");
+            return;
+        }
+    }
+    ScaledFrameCache::Stats stats = session.thread().getScaleStats();
+    state.counters["chained"] = static_cast<double>(stats.chained);
+    state.counters["fromCapture"] = static_cast<double>(stats.fromInput);
+}
+
+// Capture to result latency of a still capture, the real time of an iteration. Without workers
+// the main image is encoded serially after the thumbnail, with them it is encoded in strips while
+// the thumbnail and EXIF are generated.
+void BM_JpegCapture(benchmark::State& state) {
+    const Size captureSize = state.range(0) == 8 ? Size{3264, 2448} : Size{4000, 3000};
+    ReplaySession session(captureSize, /*yuvSizes*/ {}, /*withJpeg*/ true);
+    if (!session.isValid()) {
+        state.SkipWithError("session setup failed");
+        return;
+    }
+    session.thread().fillSyntheticFrame();
+    if (state.range(1) != 0) {
+        session.thread().startWorkers();
+    }
+    for (auto _ : state) {
+        std::shared_ptr<HalRequest> req = session.makeRequest(nullptr);
+        int ret = session.thread().processOutputBuffers(*req);
+        closeReleaseFences(*req);
+        if (ret != 0) {
+            state.SkipWithError("encoding failed");
+            return;
+        }
+    }
+}
+
+}  // namespace
+
+// The argument is whether each request also has a JPEG output
+BENCHMARK(BM_SerialReplay)->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(BM_PipelinedReplay)->Arg(0)->Arg(1)->UseRealTime();
+// The argument is whether the outputs are filled by the workers
+BENCHMARK(BM_FillOutputs)->Arg(0)->Arg(1)->UseRealTime();
+// The arguments are the megapixels of the capture, 8 or 12, and whether it's encoded in strips
+BENCHMARK(BM_JpegCapture)
+        ->ArgsProduct({{8, 12}, {0, 1}})
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Builds the result metadata of a capture request and writes it to the result FMQ the way the
+// external camera ExternalCameraDeviceSession::processCaptureResult does, with the CameraMetadata
+// helper or with ResultMetadataBuilder. The request settings have the tags a camera app typically
+// sets, which makes results of about 60 tags. A 60 fps stream leaves 16.6 ms per result.
+
+#include <ExternalCameraUtils.h>
+#include <benchmark/benchmark.h>
+#include <convert.h>
+#include <fmq/AidlMessageQueue.h>
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+using namespace ::android::hardware::camera::device::implementation;
+using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
+using ::android::AidlMessageQueue;
+using AidlCameraMetadata = ::aidl::android::hardware::camera::device::CameraMetadata;
+using HelperCameraMetadata = ::android::hardware::camera::common::V1_0::helper::CameraMetadata;
+
+namespace {
+
+// As the size of the result FMQ of the session
+constexpr size_t kResultQueueSize = 1 << 20;
+
+// The settings of a typical preview or still capture request, with the count of each tag
+const std::pair<uint32_t, size_t> kRequestTags[] = {
+        {ANDROID_BLACK_LEVEL_LOCK, 1},
+        {ANDROID_COLOR_CORRECTION_ABERRATION_MODE, 1},
+        {ANDROID_COLOR_CORRECTION_GAINS, 4},
+        {ANDROID_COLOR_CORRECTION_MODE, 1},
+        {ANDROID_COLOR_CORRECTION_TRANSFORM, 9},
+        {ANDROID_CONTROL_AE_ANTIBANDING_MODE, 1},
+        {ANDROID_CONTROL_AE_EXPOSURE_COMPENSATION, 1},
+        {ANDROID_CONTROL_AE_LOCK, 1},
+        {ANDROID_CONTROL_AE_MODE, 1},
+        {ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER, 1},
+        {ANDROID_CONTROL_AE_REGIONS, 5},
+        {ANDROID_CONTROL_AE_TARGET_FPS_RANGE, 2},
+        {ANDROID_CONTROL_AF_MODE, 1},
+        {ANDROID_CONTROL_AF_REGIONS, 5},
+        {ANDROID_CONTROL_AF_TRIGGER, 1},
+        {ANDROID_CONTROL_AWB_LOCK, 1},
+        {ANDROID_CONTROL_AWB_MODE, 1},
+        {ANDROID_CONTROL_AWB_REGIONS, 5},
+        {ANDROID_CONTROL_CAPTURE_INTENT, 1},
+        {ANDROID_CONTROL_EFFECT_MODE, 1},
+        {ANDROID_CONTROL_MODE, 1},
+        {ANDROID_CONTROL_SCENE_MODE, 1},
+        {ANDROID_CONTROL_VIDEO_STABILIZATION_MODE, 1},
+        {ANDROID_CONTROL_ZOOM_RATIO, 1},
+        {ANDROID_DISTORTION_CORRECTION_MODE, 1},
+        {ANDROID_EDGE_MODE, 1},
+        {ANDROID_FLASH_MODE, 1},
+        {ANDROID_HOT_PIXEL_MODE, 1},
+        {ANDROID_JPEG_GPS_COORDINATES, 3},
+        {ANDROID_JPEG_GPS_PROCESSING_METHOD, 32},
+        {ANDROID_JPEG_GPS_TIMESTAMP, 1},
+        {ANDROID_JPEG_ORIENTATION, 1},
+        {ANDROID_JPEG_QUALITY, 1},
+        {ANDROID_JPEG_THUMBNAIL_QUALITY, 1},
+        {ANDROID_JPEG_THUMBNAIL_SIZE, 2},
+        {ANDROID_LENS_APERTURE, 1},
+        {ANDROID_LENS_FILTER_DENSITY, 1},
+        {ANDROID_LENS_FOCAL_LENGTH, 1},
+        {ANDROID_LENS_FOCUS_DISTANCE, 1},
+        {ANDROID_LENS_OPTICAL_STABILIZATION_MODE, 1},
+        {ANDROID_NOISE_REDUCTION_MODE, 1},
+        {ANDROID_REQUEST_ID, 1},
+        {ANDROID_SCALER_CROP_REGION, 4},
+        {ANDROID_SENSOR_EXPOSURE_TIME, 1},
+        {ANDROID_SENSOR_FRAME_DURATION, 1},
+        {ANDROID_SENSOR_PIXEL_MODE, 1},
+        {ANDROID_SENSOR_SENSITIVITY, 1},
+        {ANDROID_SENSOR_TEST_PATTERN_MODE, 1},
+        {ANDROID_SHADING_MODE, 1},
+        {ANDROID_STATISTICS_FACE_DETECT_MODE, 1},
+        {ANDROID_STATISTICS_HOT_PIXEL_MAP_MODE, 1},
+        {ANDROID_STATISTICS_LENS_SHADING_MAP_MODE, 1},
+        {ANDROID_TONEMAP_MODE, 1},
+};
+
+HelperCameraMetadata makeSettings() {
+    std::vector<uint8_t> zeros(256);
+    camera_metadata_t* settings = allocate_camera_metadata(std::size(kRequestTags), 1024);
+    for (const auto& [tag, count] : kRequestTags) {
+        add_camera_metadata_entry(settings, tag, zeros.data(), count);
+    }
+    sort_camera_metadata(settings);
+    return HelperCameraMetadata(settings);
+}
+
+// Reads the result back, as the camera framework does
+bool drainQueue(AidlMessageQueue<int8_t, SynchronizedReadWrite>& queue, std::vector<int8_t>& out,
+                size_t size) {
+    out.resize(size);
+    return queue.read(out.data(), size);
+}
+
+// The argument is whether ResultMetadataBuilder builds the results
+void BM_CaptureResult(benchmark::State& state) {
+    const bool useBuilder = state.range(0) != 0;
+    const HelperCameraMetadata settings = makeSettings();
+    HelperCameraMetadata chars;
+    const int32_t activeArray[] = {0, 0, 1920, 1080};
+    chars.update(ANDROID_SENSOR_INFO_ACTIVE_ARRAY_SIZE, activeArray, 4);
+    camera_metadata_ro_entry activeArraySize = chars.find(ANDROID_SENSOR_INFO_ACTIVE_ARRAY_SIZE);
+
+    AidlMessageQueue<int8_t, SynchronizedReadWrite> queue(kResultQueueSize, false);
+    ResultMetadataBuilder builder(getCaptureResultTags());
+    std::vector<int8_t> readBack;
+    const uint8_t afState = ANDROID_CONTROL_AF_STATE_INACTIVE;
+    nsecs_t timestamp = 0;
+    size_t entryCount = 0;
+    size_t resultSize = 0;
+
+    for (auto _ : state) {
+        // Each request holds its own copy of the settings
+        HelperCameraMetadata request(settings);
+        timestamp += 16666666;
+        bool ok;
+        if (useBuilder) {
+            const camera_metadata_t* rawSettings = request.getAndLock();
+            ok = builder.reset(rawSettings) == OK;
+            request.unlock(rawSettings);
+            builder.set(RESULT_AF_STATE, &afState);
+            ok = ok && fillCaptureResultCommon(builder, timestamp, activeArraySize) == OK;
+            const camera_metadata_t* rawResult = builder.get();
+            resultSize = get_camera_metadata_size(rawResult);
+            entryCount = get_camera_metadata_entry_count(rawResult);
+            ok = ok && queue.write(reinterpret_cast<const int8_t*>(rawResult), resultSize);
+        } else {
+            request.update(ANDROID_CONTROL_AF_STATE, &afState, 1);
+            ok = fillCaptureResultCommon(request, timestamp, activeArraySize) == OK;
+            const camera_metadata_t* rawResult = request.getAndLock();
+            AidlCameraMetadata result;
+            convertToAidl(rawResult, &result);
+            request.unlock(rawResult);
+            resultSize = result.metadata.size();
+            entryCount = request.entryCount();
+            ok = ok && queue.write(reinterpret_cast<const int8_t*>(result.metadata.data()),
+                                   resultSize);
+        }
+        if (!ok || !drainQueue(queue, readBack, resultSize)) {
+            state.SkipWithError("building or sending the result failed");
+            return;
+        }
+    }
+    state.counters["results/s"] = benchmark::Counter(static_cast<double>(state.iterations()),
+                                                     benchmark::Counter::kIsRate);
+    state.counters["tags"] = static_cast<double>(entryCount);
+    state.counters["bytes"] = static_cast<double>(resultSize);
+    state.counters["layouts"] = static_cast<double>(builder.getLayoutCount());
+}
+
+}  // namespace
+
+BENCHMARK(BM_CaptureResult)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
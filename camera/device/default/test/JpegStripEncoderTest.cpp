@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <ExternalCameraUtils.h>
+#include <gtest/gtest.h>
+
+namespace android {
+namespace hardware {
+namespace camera {
+namespace device {
+namespace implementation {
+namespace {
+
+constexpr int kJpegQuality = 90;
+
+// A gradient with noise, so that every MCU has entropy coded data of its own
+std::shared_ptr<AllocatedFrame> makeImage(const Size& size, YCbCrLayout* layout) {
+    auto frame = std::make_shared<AllocatedFrame>(size.width, size.height);
+    if (frame->allocate(layout) != 0) {
+        return nullptr;
+    }
+    std::mt19937 rnd(size.width * size.height);
+    for (int32_t y = 0; y < size.height; y++) {
+        uint8_t* row = static_cast<uint8_t*>(layout->y) + y * layout->yStride;
+        for (int32_t x = 0; x < size.width; x++) {
+            row[x] = static_cast<uint8_t>(x + y + rnd() % 16);
+        }
+    }
+    for (int32_t y = 0; y < size.height / 2; y++) {
+        uint8_t* cb = static_cast<uint8_t*>(layout->cb) + y * layout->cStride;
+        uint8_t* cr = static_cast<uint8_t*>(layout->cr) + y * layout->cStride;
+        for (int32_t x = 0; x < size.width / 2; x++) {
+            cb[x] = static_cast<uint8_t>(96 + rnd() % 64);
+            cr[x] = static_cast<uint8_t>(96 + rnd() % 64);
+        }
+    }
+    return frame;
+}
+
+size_t getMaxCodeSize(const Size& size) {
+    return size.width * size.height * 3 / 2 + 64 * 1024;
+}
+
+// The image encoded in one piece, with the restart markers the strips are joined with
+std::vector<uint8_t> encodeSerial(const Size& size, const YCbCrLayout& layout,
+                                  const std::vector<uint8_t>& app1) {
+    std::vector<uint8_t> code(getMaxCodeSize(size));
+    size_t codeSize = 0;
+    if (encodeJpegYU12Rows(size, layout, kJpegQuality, app1.data(), app1.size(),
+                           /*restartInRows*/ 1, code.data(), code.size(), codeSize) != 0) {
+        return {};
+    }
+    code.resize(codeSize);
+    return code;
+}
+
+std::vector<uint8_t> encodeStrips(JpegStripEncoder& encoder, size_t numStrips,
+                                  const std::vector<uint8_t>& app1, const Size& size) {
+    // The last strip first, the strips don't depend on each other
+    for (size_t i = numStrips; i > 0; i--) {
+        if (encoder.encodeStrip(i - 1) != 0) {
+            return {};
+        }
+    }
+    std::vector<uint8_t> code(getMaxCodeSize(size));
+    size_t codeSize = 0;
+    if (encoder.join(app1.data(), app1.size(), code.data(), code.size(), codeSize) != 0) {
+        return {};
+    }
+    code.resize(codeSize);
+    return code;
+}
+
+void checkStrips(const Size& size, const std::vector<uint8_t>& app1) {
+    YCbCrLayout layout;
+    std::shared_ptr<AllocatedFrame> image = makeImage(size, &layout);
+    ASSERT_NE(nullptr, image);
+    const std::vector<uint8_t> serial = encodeSerial(size, layout, app1);
+    ASSERT_FALSE(serial.empty());
+
+    // The same encoder for all the strip counts, as the OutputThread keeps it between captures
+    JpegStripEncoder encoder;
+    for (size_t maxStrips : {2, 3, 8}) {
+        size_t numStrips =
+                encoder.init(size, layout, kJpegQuality, getMaxCodeSize(size), maxStrips);
+        ASSERT_GT(numStrips, 1u) << "maxStrips " << maxStrips;
+        ASSERT_LE(numStrips, maxStrips);
+        EXPECT_EQ(serial, encodeStrips(encoder, numStrips, app1, size))
+                << size.width << "x" << size.height << " in " << numStrips << " strips";
+    }
+}
+
+TEST(JpegStripEncoderTest, JoinedStripsMatchSerialEncode) {
+    checkStrips({1280, 720}, /*app1*/ {});
+    // 2, 3 and 5 strips, the last of which is 450, 322 and 66 rows high, none of them a multiple
+    // of the 16 rows of an MCU row
+    checkStrips({1920, 1090}, /*app1*/ {});
+}
+
+TEST(JpegStripEncoderTest, JoinsApp1Segment) {
+    const std::vector<uint8_t> app1(3000, 0x45);
+    checkStrips({1282, 722}, app1);
+
+    YCbCrLayout layout;
+    std::shared_ptr<AllocatedFrame> image = makeImage({640, 480}, &layout);
+    ASSERT_NE(nullptr, image);
+    JpegStripEncoder encoder;
+    size_t numStrips = encoder.init({640, 480}, layout, kJpegQuality, getMaxCodeSize({640, 480}),
+                                    /*maxStrips*/ 2);
+    ASSERT_EQ(2u, numStrips);
+    const std::vector<uint8_t> code = encodeStrips(encoder, numStrips, app1, {640, 480});
+    // SOI, the JFIF APP0 segment, then the APP1 segment
+    ASSERT_GT(code.size(), 24 + app1.size());
+    const size_t app0Size = (code[4] << 8) | code[5];
+    const uint8_t* app1Segment = code.data() + 4 + app0Size;
+    EXPECT_EQ(0xFF, app1Segment[0]);
+    EXPECT_EQ(JPEG_APP0 + 1, app1Segment[1]);
+    EXPECT_EQ(app1.size() + 2, static_cast<size_t>((app1Segment[2] << 8) | app1Segment[3]));
+    EXPECT_EQ(0, memcmp(app1.data(), app1Segment + 4, app1.size()));
+}
+
+TEST(JpegStripEncoderTest, SmallImageIsNotSplit) {
+    YCbCrLayout layout;
+    std::shared_ptr<AllocatedFrame> image = makeImage({320, 240}, &layout);
+    ASSERT_NE(nullptr, image);
+    JpegStripEncoder encoder;
+    // 15 MCU rows, less than two strips of 8
+    EXPECT_EQ(1u, encoder.init({320, 240}, layout, kJpegQuality, getMaxCodeSize({320, 240}),
+                               /*maxStrips*/ 8));
+    std::vector<uint8_t> code(getMaxCodeSize({320, 240}));
+    size_t codeSize = 0;
+    EXPECT_NE(0, encoder.join(nullptr, 0, code.data(), code.size(), codeSize));
+}
+
+}  // namespace
+}  // namespace implementation
+}  // namespace device
+}  // namespace camera
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ExternalCameraDeviceSession.h>
+#include <gtest/gtest.h>
+#include <linux/videodev2.h>
+
+namespace android {
+namespace hardware {
+namespace camera {
+namespace device {
+namespace implementation {
+namespace {
+
+constexpr Size kFrameSize = {64, 48};
+constexpr Size kThumbSize = {32, 24};
+constexpr auto kTimeout = std::chrono::seconds(3);
+
+// Records the frame numbers of the requests, in the order they are returned.
+class TestParent : public OutputThreadInterface {
+  public:
+    Status importBuffer(int32_t, uint64_t, buffer_handle_t, buffer_handle_t**) override {
+        return Status::OK;
+    }
+
+    void notifyError(int32_t frameNumber, int32_t, ErrorCode) override {
+        std::lock_guard<std::mutex> lk(mLock);
+        mDeviceErrors.push_back(frameNumber);
+    }
+
+    Status processCaptureRequestError(const std::shared_ptr<HalRequest>& req,
+                                      std::vector<NotifyMsg>*,
+                                      std::vector<CaptureResult>*) override {
+        std::lock_guard<std::mutex> lk(mLock);
+        mRequestErrors.push_back(req->frameNumber);
+        return Status::OK;
+    }
+
+    Status processCaptureResult(std::shared_ptr<HalRequest>& req) override {
+        std::lock_guard<std::mutex> lk(mLock);
+        mResults.push_back(req->frameNumber);
+        return Status::OK;
+    }
+
+    ssize_t getJpegBufferSize(int32_t, int32_t) const override { return 0; }
+
+    std::vector<int32_t> getResults() {
+        std::lock_guard<std::mutex> lk(mLock);
+        return mResults;
+    }
+
+    std::vector<int32_t> getRequestErrors() {
+        std::lock_guard<std::mutex> lk(mLock);
+        return mRequestErrors;
+    }
+
+    std::vector<int32_t> getDeviceErrors() {
+        std::lock_guard<std::mutex> lk(mLock);
+        return mDeviceErrors;
+    }
+
+  private:
+    std::mutex mLock;
+    std::vector<int32_t> mResults;
+    std::vector<int32_t> mRequestErrors;
+    std::vector<int32_t> mDeviceErrors;
+};
+
+// An MJPEG frame as dequeued from V4L2. While it is held, getData blocks, which keeps the decode
+// of its request in progress.
+class TestFrame : public Frame {
+  public:
+    explicit TestFrame(std::vector<uint8_t> data)
+        : Frame(kFrameSize.width, kFrameSize.height, V4L2_PIX_FMT_MJPEG), mData(std::move(data)) {}
+
+    int getData(uint8_t** outData, size_t* dataSize) override {
+        std::unique_lock<std::mutex> lk(mLock);
+        mDataRequested = true;
+        mCond.notify_all();
+        mCond.wait(lk, [this] { return !mHeld; });
+        *outData = mData.data();
+        *dataSize = mData.size();
+        return 0;
+    }
+
+    void hold() {
+        std::lock_guard<std::mutex> lk(mLock);
+        mHeld = true;
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lk(mLock);
+        mHeld = false;
+        mCond.notify_all();
+    }
+
+    bool waitForDataRequested() {
+        std::unique_lock<std::mutex> lk(mLock);
+        return mCond.wait_for(lk, kTimeout, [this] { return mDataRequested; });
+    }
+
+  private:
+    std::vector<uint8_t> mData;
+    std::mutex mLock;
+    std::condition_variable mCond;
+    bool mHeld = false;
+    bool mDataRequested = false;
+};
+
+// Exposes the request list of the OutputThread, whose threadLoop is run by the test.
+class TestOutputThread : public ExternalCameraDeviceSession::OutputThread {
+  public:
+    using OutputThread::OutputThread;
+
+    std::vector<int32_t> getRequestList() {
+        std::lock_guard<std::mutex> lk(mRequestListLock);
+        std::vector<int32_t> frameNumbers;
+        for (const auto& req : mRequestList) {
+            frameNumbers.push_back(req->frameNumber);
+        }
+        return frameNumbers;
+    }
+
+    int32_t getDecodedRequest() {
+        std::lock_guard<std::mutex> lk(mRequestListLock);
+        return mDecodedRequest == nullptr ? -1 : mDecodedRequest->frameNumber;
+    }
+};
+
+std::vector<uint8_t> encodeMjpeg() {
+    AllocatedFrame yu12(kFrameSize.width, kFrameSize.height);
+    YCbCrLayout layout;
+    if (yu12.allocate(&layout) != 0) {
+        return {};
+    }
+    std::vector<uint8_t> code(kFrameSize.width * kFrameSize.height * 3);
+    size_t codeSize = 0;
+    if (encodeJpegYU12(kFrameSize, layout, /*jpegQuality*/ 90, nullptr, 0, code.data(),
+                       code.size(), codeSize) != 0) {
+        return {};
+    }
+    code.resize(codeSize);
+    return code;
+}
+
+class OutputThreadTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mMjpeg = encodeMjpeg();
+        ASSERT_FALSE(mMjpeg.empty());
+        mParent = std::make_shared<TestParent>();
+        mThread = std::make_shared<TestOutputThread>(mParent, HORIZONTAL,
+                                                     common::V1_0::helper::CameraMetadata(),
+                                                     /*bufReqThread*/ nullptr);
+        ASSERT_EQ(Status::OK, mThread->allocateIntermediateBuffers(kFrameSize, kThumbSize,
+                                                                   /*streams*/ {},
+                                                                   /*blobBufferSize*/ 0));
+    }
+
+    // A request without output buffers, only its frame is decoded
+    std::shared_ptr<HalRequest> submit(int32_t frameNumber, std::shared_ptr<Frame> frame) {
+        auto req = std::make_shared<HalRequest>();
+        req->frameNumber = frameNumber;
+        req->frameIn = std::move(frame);
+        mThread->submitRequest(req);
+        return req;
+    }
+
+    std::shared_ptr<TestFrame> makeFrame() { return std::make_shared<TestFrame>(mMjpeg); }
+
+    std::vector<uint8_t> mMjpeg;
+    std::shared_ptr<TestParent> mParent;
+    std::shared_ptr<TestOutputThread> mThread;
+};
+
+TEST_F(OutputThreadTest, NextRequestIsDecodedWhileProcessing) {
+    submit(1, makeFrame());
+    submit(2, makeFrame());
+    submit(3, makeFrame());
+
+    ASSERT_TRUE(mThread->threadLoop());
+    EXPECT_EQ(std::vector<int32_t>({1}), mParent->getResults());
+    EXPECT_EQ(2, mThread->getDecodedRequest());
+    EXPECT_EQ(std::vector<int32_t>({3}), mThread->getRequestList());
+
+    ASSERT_TRUE(mThread->threadLoop());
+    ASSERT_TRUE(mThread->threadLoop());
+    EXPECT_EQ(std::vector<int32_t>({1, 2, 3}), mParent->getResults());
+    EXPECT_EQ(-1, mThread->getDecodedRequest());
+    EXPECT_TRUE(mParent->getRequestErrors().empty());
+}
+
+TEST_F(OutputThreadTest, FlushWhilePrefetchedRequestIsDecoding) {
+    submit(1, makeFrame());
+    std::shared_ptr<TestFrame> next = makeFrame();
+    next->hold();
+    submit(2, next);
+
+    std::thread loop([this] { mThread->threadLoop(); });
+    // The decode of request 2 has started on a worker, and waits for its frame
+    EXPECT_TRUE(next->waitForDataRequested());
+    EXPECT_TRUE(mThread->getRequestList().empty());
+
+    std::thread flush([this] { mThread->flush(); });
+    next->release();
+    loop.join();
+    flush.join();
+
+    // The prefetched request is neither lost nor processed after the flush
+    EXPECT_EQ(std::vector<int32_t>({1}), mParent->getResults());
+    EXPECT_EQ(std::vector<int32_t>({2}), mParent->getRequestErrors());
+    EXPECT_EQ(-1, mThread->getDecodedRequest());
+    EXPECT_TRUE(mThread->getRequestList().empty());
+}
+
+TEST_F(OutputThreadTest, FailedPrefetchIsRequeued) {
+    submit(1, makeFrame());
+    submit(2, std::make_shared<TestFrame>(std::vector<uint8_t>(256, 0)));
+    submit(3, makeFrame());
+
+    ASSERT_TRUE(mThread->threadLoop());
+    EXPECT_EQ(std::vector<int32_t>({1}), mParent->getResults());
+    EXPECT_EQ(-1, mThread->getDecodedRequest());
+    EXPECT_EQ(std::vector<int32_t>({2, 3}), mThread->getRequestList());
+
+    // Request 2 is decoded again and goes through the error handling, in order
+    ASSERT_TRUE(mThread->threadLoop());
+    EXPECT_EQ(std::vector<int32_t>({2}), mParent->getRequestErrors());
+    ASSERT_TRUE(mThread->threadLoop());
+    EXPECT_EQ(std::vector<int32_t>({1, 3}), mParent->getResults());
+    EXPECT_TRUE(mParent->getDeviceErrors().empty());
+}
+
+TEST_F(OutputThreadTest, SwitchToOfflineReturnsDecodedRequestFirst) {
+    submit(1, makeFrame());
+    submit(2, makeFrame());
+    submit(3, makeFrame());
+
+    ASSERT_TRUE(mThread->threadLoop());
+    ASSERT_EQ(2, mThread->getDecodedRequest());
+
+    std::vector<int32_t> offline;
+    for (const auto& req : mThread->switchToOffline()) {
+        offline.push_back(req->frameNumber);
+    }
+    EXPECT_EQ(std::vector<int32_t>({2, 3}), offline);
+    EXPECT_EQ(-1, mThread->getDecodedRequest());
+    EXPECT_TRUE(mThread->getRequestList().empty());
+    EXPECT_TRUE(mParent->getRequestErrors().empty());
+}
+
+}  // namespace
+}  // namespace implementation
+}  // namespace device
+}  // namespace camera
+}  // namespace hardware
+}  // namespace android
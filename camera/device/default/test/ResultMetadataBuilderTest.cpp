@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <vector>
+
+#include <ExternalCameraUtils.h>
+#include <gtest/gtest.h>
+
+namespace android {
+namespace hardware {
+namespace camera {
+namespace device {
+namespace implementation {
+namespace {
+
+constexpr nsecs_t kTimestamp = 123456789;
+const uint8_t kAfState = ANDROID_CONTROL_AF_STATE_PASSIVE_SCAN;
+
+CameraMetadata makeCharacteristics() {
+    CameraMetadata chars;
+    const int32_t activeArray[] = {0, 0, 1920, 1080};
+    chars.update(ANDROID_SENSOR_INFO_ACTIVE_ARRAY_SIZE, activeArray, 4);
+    return chars;
+}
+
+// Settings with entries stored in the entry itself, of 1 to 4 bytes, and entries stored in the
+// data area. requestId tells the values of two requests apart.
+CameraMetadata makeSettings(int32_t requestId) {
+    CameraMetadata settings;
+    const uint8_t aeMode = ANDROID_CONTROL_AE_MODE_ON;
+    settings.update(ANDROID_CONTROL_AE_MODE, &aeMode, 1);
+    settings.update(ANDROID_REQUEST_ID, &requestId, 1);
+    const float zoomRatio = 1.5f;
+    settings.update(ANDROID_CONTROL_ZOOM_RATIO, &zoomRatio, 1);
+    const int32_t targetFpsRange[] = {15, requestId};
+    settings.update(ANDROID_CONTROL_AE_TARGET_FPS_RANGE, targetFpsRange, 2);
+    const int64_t exposureTime = 33'000'000 + requestId;
+    settings.update(ANDROID_SENSOR_EXPOSURE_TIME, &exposureTime, 1);
+    const double gpsCoordinates[] = {37.4, -122.1, static_cast<double>(requestId)};
+    settings.update(ANDROID_JPEG_GPS_COORDINATES, gpsCoordinates, 3);
+    camera_metadata_rational_t transform[9] = {};
+    for (int i = 0; i < 9; i++) {
+        transform[i] = {.numerator = i == 0 ? requestId : i % 4 == 0, .denominator = 1};
+    }
+    settings.update(ANDROID_COLOR_CORRECTION_TRANSFORM, transform, 9);
+    return settings;
+}
+
+// Builds the result as ExternalCameraDeviceSession::processCaptureResult does
+status_t buildResult(ResultMetadataBuilder& builder, const CameraMetadata& settings,
+                     camera_metadata_ro_entry& activeArraySize) {
+    const camera_metadata_t* rawSettings = settings.getAndLock();
+    status_t res = builder.reset(rawSettings);
+    settings.unlock(rawSettings);
+    if (res != OK) {
+        return res;
+    }
+    builder.set(RESULT_AF_STATE, &kAfState);
+    return fillCaptureResultCommon(builder, kTimestamp, activeArraySize);
+}
+
+// Builds the result with CameraMetadata::update, as before ResultMetadataBuilder
+CameraMetadata buildExpectedResult(const CameraMetadata& settings,
+                                   camera_metadata_ro_entry& activeArraySize) {
+    CameraMetadata result(settings);
+    result.update(ANDROID_CONTROL_AF_STATE, &kAfState, 1);
+    EXPECT_EQ(OK, fillCaptureResultCommon(result, kTimestamp, activeArraySize));
+    return result;
+}
+
+void expectSameEntries(const camera_metadata_t* expected, const camera_metadata_t* actual) {
+    ASSERT_NE(nullptr, actual);
+    EXPECT_EQ(OK, validate_camera_metadata_structure(actual, /*expected_size=*/nullptr));
+    ASSERT_EQ(get_camera_metadata_entry_count(expected), get_camera_metadata_entry_count(actual));
+    for (size_t i = 0; i < get_camera_metadata_entry_count(expected); i++) {
+        camera_metadata_ro_entry expectedEntry;
+        ASSERT_EQ(OK, get_camera_metadata_ro_entry(expected, i, &expectedEntry));
+        camera_metadata_ro_entry actualEntry;
+        ASSERT_EQ(OK, find_camera_metadata_ro_entry(actual, expectedEntry.tag, &actualEntry))
+                << "tag 0x" << std::hex << expectedEntry.tag;
+        ASSERT_EQ(expectedEntry.type, actualEntry.type);
+        ASSERT_EQ(expectedEntry.count, actualEntry.count);
+        EXPECT_EQ(0, memcmp(expectedEntry.data.u8, actualEntry.data.u8,
+                            expectedEntry.count * camera_metadata_type_size[expectedEntry.type]))
+                << "tag 0x" << std::hex << expectedEntry.tag;
+    }
+}
+
+TEST(ResultMetadataBuilderTest, MatchesCameraMetadataUpdate) {
+    const CameraMetadata chars = makeCharacteristics();
+    camera_metadata_ro_entry activeArraySize = chars.find(ANDROID_SENSOR_INFO_ACTIVE_ARRAY_SIZE);
+    ResultMetadataBuilder builder(getCaptureResultTags());
+
+    // The second result reuses the layout of the first one
+    for (int32_t requestId : {1, 2}) {
+        const CameraMetadata settings = makeSettings(requestId);
+        ASSERT_EQ(OK, buildResult(builder, settings, activeArraySize));
+        const CameraMetadata expected = buildExpectedResult(settings, activeArraySize);
+        const camera_metadata_t* rawExpected = expected.getAndLock();
+        expectSameEntries(rawExpected, builder.get());
+        expected.unlock(rawExpected);
+    }
+    EXPECT_EQ(1u, builder.getLayoutCount());
+}
+
+TEST(ResultMetadataBuilderTest, LaysOutAgainWhenSettingsChange) {
+    const CameraMetadata chars = makeCharacteristics();
+    camera_metadata_ro_entry activeArraySize = chars.find(ANDROID_SENSOR_INFO_ACTIVE_ARRAY_SIZE);
+    ResultMetadataBuilder builder(getCaptureResultTags());
+
+    CameraMetadata settings = makeSettings(1);
+    ASSERT_EQ(OK, buildResult(builder, settings, activeArraySize));
+    EXPECT_EQ(1u, builder.getLayoutCount());
+
+    // A new value of the same count keeps the layout
+    const int32_t requestId = 7;
+    settings.update(ANDROID_REQUEST_ID, &requestId, 1);
+    ASSERT_EQ(OK, buildResult(builder, settings, activeArraySize));
+    EXPECT_EQ(1u, builder.getLayoutCount());
+    camera_metadata_ro_entry entry;
+    ASSERT_EQ(OK, find_camera_metadata_ro_entry(builder.get(), ANDROID_REQUEST_ID, &entry));
+    EXPECT_EQ(requestId, entry.data.i32[0]);
+
+    // A new count
+    const double gpsCoordinates[] = {37.4, -122.1};
+    settings.update(ANDROID_JPEG_GPS_COORDINATES, gpsCoordinates, 2);
+    ASSERT_EQ(OK, buildResult(builder, settings, activeArraySize));
+    EXPECT_EQ(2u, builder.getLayoutCount());
+
+    // A new tag
+    const uint8_t edgeMode = ANDROID_EDGE_MODE_FAST;
+    settings.update(ANDROID_EDGE_MODE, &edgeMode, 1);
+    ASSERT_EQ(OK, buildResult(builder, settings, activeArraySize));
+    EXPECT_EQ(3u, builder.getLayoutCount());
+
+    // The same entries in another order, so the tags and types at each index differ
+    CameraMetadata reordered;
+    const camera_metadata_t* rawSettings = settings.getAndLock();
+    for (size_t i = get_camera_metadata_entry_count(rawSettings); i > 0; i--) {
+        camera_metadata_ro_entry settingsEntry;
+        get_camera_metadata_ro_entry(rawSettings, i - 1, &settingsEntry);
+        reordered.update(settingsEntry);
+    }
+    settings.unlock(rawSettings);
+    ASSERT_EQ(OK, buildResult(builder, reordered, activeArraySize));
+    EXPECT_EQ(4u, builder.getLayoutCount());
+
+    const CameraMetadata expected = buildExpectedResult(reordered, activeArraySize);
+    const camera_metadata_t* rawExpected = expected.getAndLock();
+    expectSameEntries(rawExpected, builder.get());
+    expected.unlock(rawExpected);
+}
+
+TEST(ResultMetadataBuilderTest, OverwritesResultTagsInSettings) {
+    const CameraMetadata chars = makeCharacteristics();
+    camera_metadata_ro_entry activeArraySize = chars.find(ANDROID_SENSOR_INFO_ACTIVE_ARRAY_SIZE);
+    ResultMetadataBuilder builder(getCaptureResultTags());
+
+    // The crop region and the AE lock are both settings and results
+    CameraMetadata settings = makeSettings(1);
+    const int32_t cropRegion[] = {100, 100, 640, 480};
+    settings.update(ANDROID_SCALER_CROP_REGION, cropRegion, 4);
+    const uint8_t aeLock = ANDROID_CONTROL_AE_LOCK_ON;
+    settings.update(ANDROID_CONTROL_AE_LOCK, &aeLock, 1);
+
+    for (int i = 0; i < 2; i++) {
+        // The settings are copied again for each result, the results then overwrite them
+        ASSERT_EQ(OK, buildResult(builder, settings, activeArraySize));
+        const camera_metadata_t* result = builder.get();
+        ASSERT_NE(nullptr, result);
+        EXPECT_EQ(settings.entryCount() + RESULT_TAG_COUNT - 2,
+                  get_camera_metadata_entry_count(result));
+        camera_metadata_ro_entry entry;
+        ASSERT_EQ(OK, find_camera_metadata_ro_entry(result, ANDROID_SCALER_CROP_REGION, &entry));
+        ASSERT_EQ(4u, entry.count);
+        EXPECT_EQ(0, entry.data.i32[0]);
+        EXPECT_EQ(0, entry.data.i32[1]);
+        EXPECT_EQ(1920, entry.data.i32[2]);
+        EXPECT_EQ(1080, entry.data.i32[3]);
+        ASSERT_EQ(OK, find_camera_metadata_ro_entry(result, ANDROID_CONTROL_AE_LOCK, &entry));
+        EXPECT_EQ(ANDROID_CONTROL_AE_LOCK_OFF, entry.data.u8[0]);
+    }
+    EXPECT_EQ(1u, builder.getLayoutCount());
+
+    const CameraMetadata expected = buildExpectedResult(settings, activeArraySize);
+    const camera_metadata_t* rawExpected = expected.getAndLock();
+    expectSameEntries(rawExpected, builder.get());
+    expected.unlock(rawExpected);
+}
+
+TEST(ResultMetadataBuilderTest, SetDoesNothingAfterFailedLayOut) {
+    // No type is defined for the second tag, so the result cannot be laid out
+    ResultMetadataBuilder builder({{ANDROID_CONTROL_AF_STATE, 1}, {0xfffffff0u, 1}});
+    const CameraMetadata settings = makeSettings(1);
+    const camera_metadata_t* rawSettings = settings.getAndLock();
+    const size_t settingsSize = get_camera_metadata_size(rawSettings);
+    const std::vector<uint8_t> settingsCopy(
+            reinterpret_cast<const uint8_t*>(rawSettings),
+            reinterpret_cast<const uint8_t*>(rawSettings) + settingsSize);
+
+    EXPECT_NE(OK, builder.reset(rawSettings));
+    EXPECT_EQ(nullptr, builder.get());
+    EXPECT_EQ(1u, builder.getLayoutCount());
+    // Nowhere to write to, under ASan a write through a stale slot would be caught here
+    builder.set(0, &kAfState);
+    const uint8_t value = 1;
+    builder.set(1, &value);
+    EXPECT_EQ(nullptr, builder.get());
+    EXPECT_EQ(0, memcmp(settingsCopy.data(), rawSettings, settingsSize));
+
+    // The next reset tries again
+    EXPECT_NE(OK, builder.reset(rawSettings));
+    EXPECT_EQ(2u, builder.getLayoutCount());
+    settings.unlock(rawSettings);
+
+    EXPECT_EQ(BAD_VALUE, builder.reset(nullptr));
+    EXPECT_EQ(nullptr, builder.get());
+}
+
+}  // namespace
+}  // namespace implementation
+}  // namespace device
+}  // namespace camera
+}  // namespace hardware
+}  // namespace android
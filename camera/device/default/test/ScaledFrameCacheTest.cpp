@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <ExternalCameraUtils.h>
+#include <gtest/gtest.h>
+
+namespace android {
+namespace hardware {
+namespace camera {
+namespace device {
+namespace implementation {
+namespace {
+
+// Largest difference between a size scaled from a larger size and scaled from the input. The
+// input is a smooth gradient, so nearest neighbor scaling through one more step only moves each
+// sample by a pixel or so, while a wrong crop moves it by far more.
+constexpr int kMaxPixelDiff = 4;
+
+std::shared_ptr<AllocatedFrame> makeGradient(const Size& size) {
+    auto frame = std::make_shared<AllocatedFrame>(size.width, size.height);
+    YCbCrLayout layout;
+    if (frame->allocate(&layout) != 0) {
+        return nullptr;
+    }
+    for (int32_t y = 0; y < size.height; y++) {
+        uint8_t* row = static_cast<uint8_t*>(layout.y) + y * layout.yStride;
+        for (int32_t x = 0; x < size.width; x++) {
+            row[x] = static_cast<uint8_t>(x * 127 / size.width + y * 127 / size.height);
+        }
+    }
+    for (int32_t y = 0; y < size.height / 2; y++) {
+        uint8_t* cb = static_cast<uint8_t*>(layout.cb) + y * layout.cStride;
+        uint8_t* cr = static_cast<uint8_t*>(layout.cr) + y * layout.cStride;
+        for (int32_t x = 0; x < size.width / 2; x++) {
+            cb[x] = static_cast<uint8_t>(x * 255 / size.width);
+            cr[x] = static_cast<uint8_t>(y * 255 / size.height);
+        }
+    }
+    return frame;
+}
+
+IntermediateBuffers makeBuffers(const std::vector<Size>& sizes) {
+    IntermediateBuffers buffers;
+    for (const auto& size : sizes) {
+        buffers[size] = std::make_shared<AllocatedFrame>(size.width, size.height);
+        buffers[size]->allocate();
+    }
+    return buffers;
+}
+
+int maxPlaneDiff(const uint8_t* a, uint32_t aStride, const uint8_t* b, uint32_t bStride,
+                 int32_t width, int32_t height) {
+    int maxDiff = 0;
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            maxDiff = std::max(maxDiff, std::abs(a[y * aStride + x] - b[y * bStride + x]));
+        }
+    }
+    return maxDiff;
+}
+
+int maxDiff(const YCbCrLayout& a, const YCbCrLayout& b, const Size& size) {
+    return std::max({maxPlaneDiff(static_cast<uint8_t*>(a.y), a.yStride,
+                                  static_cast<uint8_t*>(b.y), b.yStride, size.width, size.height),
+                     maxPlaneDiff(static_cast<uint8_t*>(a.cb), a.cStride,
+                                  static_cast<uint8_t*>(b.cb), b.cStride, size.width / 2,
+                                  size.height / 2),
+                     maxPlaneDiff(static_cast<uint8_t*>(a.cr), a.cStride,
+                                  static_cast<uint8_t*>(b.cr), b.cStride, size.width / 2,
+                                  size.height / 2)});
+}
+
+struct PlanCase {
+    CroppingType croppingType;
+    Size inSize;
+    std::vector<Size> sizes;
+    uint64_t fromInput;
+    uint64_t chained;
+};
+
+// Plans the sizes of c, and checks the scales chained between them against the same sizes scaled
+// from the input.
+void checkPlan(const PlanCase& c) {
+    std::shared_ptr<AllocatedFrame> in = makeGradient(c.inSize);
+    ASSERT_NE(nullptr, in);
+    IntermediateBuffers planned = makeBuffers(c.sizes);
+    IntermediateBuffers direct = makeBuffers(c.sizes);
+    ScaledFrameCache plannedCache(c.croppingType);
+    ScaledFrameCache directCache(c.croppingType);
+
+    plannedCache.plan(in, planned, c.sizes);
+    for (const auto& size : c.sizes) {
+        YCbCrLayout plannedLayout, directLayout;
+        ASSERT_EQ(0, plannedCache.get(in, planned, size, &plannedLayout));
+        ASSERT_EQ(0, directCache.get(in, direct, size, &directLayout));
+        EXPECT_LE(maxDiff(plannedLayout, directLayout, size), kMaxPixelDiff)
+                << size.width << "x" << size.height;
+    }
+
+    ScaledFrameCache::Stats stats = plannedCache.getStats();
+    EXPECT_EQ(c.fromInput, stats.fromInput);
+    EXPECT_EQ(c.chained, stats.chained);
+    EXPECT_EQ(c.sizes.size(), directCache.getStats().fromInput);
+    EXPECT_EQ(0u, directCache.getStats().chained);
+}
+
+TEST(ScaledFrameCacheTest, ChainsHorizontalCrops) {
+    // 640x480 and 320x240 crop the sides of the input, within the whole input 1280x720 covers
+    checkPlan({.croppingType = HORIZONTAL,
+               .inSize = {1920, 1080},
+               .sizes = {{320, 240}, {640, 480}, {1280, 720}},
+               .fromInput = 1,
+               .chained = 2});
+}
+
+TEST(ScaledFrameCacheTest, ChainsVerticalCrops) {
+    // 1280x720 and 640x360 crop the top and bottom of the input, 320x240 doesn't
+    checkPlan({.croppingType = VERTICAL,
+               .inSize = {1920, 1440},
+               .sizes = {{640, 360}, {1280, 720}, {320, 240}, {640, 480}},
+               .fromInput = 2,
+               .chained = 2});
+}
+
+TEST(ScaledFrameCacheTest, DoesNotChainFromNonCoveringCrop) {
+    // The whole input 640x480 needs is not in the crop of 1280x720
+    checkPlan({.croppingType = VERTICAL,
+               .inSize = {1920, 1440},
+               .sizes = {{1280, 720}, {640, 480}},
+               .fromInput = 2,
+               .chained = 0});
+    // 640x480 is upscaled from its crop, so nothing is chained from it
+    checkPlan({.croppingType = HORIZONTAL,
+               .inSize = {640, 360},
+               .sizes = {{640, 480}, {320, 240}},
+               .fromInput = 2,
+               .chained = 0});
+}
+
+TEST(ScaledFrameCacheTest, DoesNotChainWithoutPlan) {
+    std::shared_ptr<AllocatedFrame> in = makeGradient({1920, 1080});
+    ASSERT_NE(nullptr, in);
+    const std::vector<Size> sizes = {{1280, 720}, {640, 360}};
+    IntermediateBuffers buffers = makeBuffers(sizes);
+    ScaledFrameCache cache(HORIZONTAL);
+
+    cache.plan(in, buffers, sizes);
+    YCbCrLayout layout;
+    ASSERT_EQ(0, cache.get(in, buffers, {640, 360}, &layout));
+    EXPECT_EQ(1u, cache.getStats().chained);
+
+    // A cleared cache forgets the plan
+    cache.clear();
+    EXPECT_TRUE(cache.empty());
+    ASSERT_EQ(0, cache.get(in, buffers, {640, 360}, &layout));
+    EXPECT_EQ(1u, cache.getStats().chained);
+    EXPECT_EQ(2u, cache.getStats().fromInput);
+}
+
+TEST(ScaledFrameCacheTest, EachSizeIsScaledOnce) {
+    constexpr size_t kNumThreads = 8;
+    const Size inSize = {1920, 1080};
+    const std::vector<Size> sizes = {{1280, 720}, {640, 360}, {320, 180}};
+    std::shared_ptr<AllocatedFrame> in = makeGradient(inSize);
+    ASSERT_NE(nullptr, in);
+    IntermediateBuffers buffers = makeBuffers(sizes);
+    ScaledFrameCache cache(HORIZONTAL);
+    cache.plan(in, buffers, sizes);
+
+    // Each thread gets the sizes in a different order, so that a size is either pending, being
+    // scaled by another thread, directly or as the parent of a smaller size, or done.
+    std::vector<std::vector<YCbCrLayout>> layouts(kNumThreads,
+                                                  std::vector<YCbCrLayout>(sizes.size()));
+    std::vector<std::vector<int>> results(kNumThreads, std::vector<int>(sizes.size(), -1));
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kNumThreads; t++) {
+        threads.emplace_back([&, t] {
+            for (size_t i = 0; i < sizes.size(); i++) {
+                size_t index = (t + i) % sizes.size();
+                results[t][index] = cache.get(in, buffers, sizes[index], &layouts[t][index]);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ScaledFrameCache::Stats stats = cache.getStats();
+    EXPECT_EQ(1u, stats.fromInput);
+    EXPECT_EQ(sizes.size() - 1, stats.chained);
+    // Each chained size also gets its parent once
+    EXPECT_EQ(kNumThreads * sizes.size() + stats.chained - sizes.size(), stats.shared);
+    for (size_t t = 0; t < kNumThreads; t++) {
+        for (size_t i = 0; i < sizes.size(); i++) {
+            ASSERT_EQ(0, results[t][i]);
+            EXPECT_EQ(layouts[0][i].y, layouts[t][i].y);
+            EXPECT_EQ(layouts[0][i].cb, layouts[t][i].cb);
+            EXPECT_EQ(layouts[0][i].cr, layouts[t][i].cr);
+        }
+    }
+}
+
+}  // namespace
+}  // namespace implementation
+}  // namespace device
+}  // namespace camera
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The present/validate round trip of a composer client: the client writes a frame in which a few
+// of its layers get a new buffer, the composer answers with the results of presentOrValidate, and
+// the client reads them and takes the release fence of every layer. The results are made here the
+// way the binder would unparcel them, so the reader allocations are counted separately.
+
+#include <android/hardware/graphics/composer3/ComposerClientReader.h>
+#include <android/hardware/graphics/composer3/ComposerClientWriter.h>
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "AllocationCount.h"
+
+namespace {
+
+using aidl::android::hardware::graphics::composer3::ComposerClientReader;
+using aidl::android::hardware::graphics::composer3::ComposerClientWriter;
+
+constexpr int64_t kDisplay = 0;
+constexpr int kLayerCount = 32;
+constexpr int kUpdatingLayerCount = 3;
+// One frame in kValidateInterval needs validation, with a layer falling back to client
+// composition
+constexpr int kValidateInterval = 8;
+
+void writeFrame(ComposerClientWriter& writer, int frame) {
+    for (int i = 0; i < kUpdatingLayerCount; i++) {
+        writer.setLayerBuffer(kDisplay, i, static_cast<uint32_t>(frame % 3), nullptr, -1);
+    }
+    writer.presentOrvalidateDisplay(kDisplay, ComposerClientWriter::kNoTimestamp, 8333333);
+}
+
+std::vector<CommandResultPayload> makeResults(int frame) {
+    std::vector<CommandResultPayload> results;
+    if (frame % kValidateInterval == 0) {
+        ChangedCompositionTypes changed;
+        changed.display = kDisplay;
+        changed.layers.push_back({.layer = 0, .composition = Composition::CLIENT});
+        results.emplace_back(std::move(changed));
+        results.emplace_back(PresentOrValidate{.display = kDisplay,
+                                               .result = PresentOrValidate::Result::Validated});
+        return results;
+    }
+    PresentFence presentFence;
+    presentFence.display = kDisplay;
+    results.emplace_back(std::move(presentFence));
+    ReleaseFences releaseFences;
+    releaseFences.display = kDisplay;
+    releaseFences.layers.resize(kLayerCount);
+    for (int i = 0; i < kLayerCount; i++) {
+        releaseFences.layers[i].layer = i;
+    }
+    results.emplace_back(std::move(releaseFences));
+    results.emplace_back(
+            PresentOrValidate{.display = kDisplay, .result = PresentOrValidate::Result::Presented});
+    return results;
+}
+
+// Takes the results with the take functions of a reader parsing them all at once.
+size_t readWhole(ComposerClientReader& reader, std::vector<CommandResultPayload>&& results) {
+    reader.parse(std::move(results));
+    size_t fences = 0;
+    for (auto& layer : reader.takeReleaseFences(kDisplay)) {
+        ndk::ScopedFileDescriptor fence = std::move(layer.fence);
+        fences++;
+    }
+    ndk::ScopedFileDescriptor presentFence = reader.takePresentFence(kDisplay);
+    std::vector<ChangedCompositionLayer> changed = reader.takeChangedCompositionTypes(kDisplay);
+    benchmark::DoNotOptimize(changed.data());
+    return fences;
+}
+
+// Reads the views of each result as soon as it is parsed.
+size_t readIncremental(ComposerClientReader& reader,
+                       std::vector<CommandResultPayload>&& results) {
+    reader.beginParse();
+    size_t fences = 0;
+    for (auto& result : results) {
+        switch (reader.parseResult(std::move(result))) {
+            case CommandResultPayload::Tag::releaseFences:
+                for (auto& layer : reader.getReleaseFences(kDisplay)) {
+                    ndk::ScopedFileDescriptor fence = std::move(layer.fence);
+                    fences++;
+                }
+                break;
+            case CommandResultPayload::Tag::changedCompositionTypes:
+                benchmark::DoNotOptimize(reader.getChangedCompositionTypes(kDisplay).data());
+                break;
+            default:
+                break;
+        }
+    }
+    return fences;
+}
+
+// The argument is whether the client reads the results incrementally through the views
+void BM_PresentRoundTrip(benchmark::State& state) {
+    const bool incremental = state.range(0) != 0;
+    ComposerClientWriter writer(kDisplay, ComposerClientWriter::Mode::kIncremental);
+    ComposerClientReader reader(kDisplay);
+    int frame = 0;
+    size_t fences = 0;
+    size_t readerAllocations = 0;
+
+    for (auto _ : state) {
+        writeFrame(writer, frame);
+        benchmark::DoNotOptimize(writer.getPendingCommands().data());
+        writer.clearPendingCommands();
+        std::vector<CommandResultPayload> results = makeResults(frame++);
+
+        const size_t allocationsBefore = getAllocationCount();
+        fences += incremental ? readIncremental(reader, std::move(results))
+                              : readWhole(reader, std::move(results));
+        readerAllocations += getAllocationCount() - allocationsBefore;
+    }
+
+    const double frames = static_cast<double>(state.iterations());
+    state.counters["frames/s"] = benchmark::Counter(frames, benchmark::Counter::kIsRate);
+    state.counters["releaseFences/frame"] = static_cast<double>(fences) / frames;
+    state.counters["readerAllocations/frame"] = static_cast<double>(readerAllocations) / frames;
+}
+
+}  // namespace
+
+BENCHMARK(BM_PresentRoundTrip)->Arg(0)->Arg(1);
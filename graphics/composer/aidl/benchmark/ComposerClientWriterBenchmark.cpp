@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Writes the commands of a frame the way a composer client does, setting the state of every layer
+// each frame while only a few layers get a new buffer and one layer moves. A 120 Hz panel leaves
+// 8.3 ms per frame.
+
+#include <android/hardware/graphics/composer3/ComposerClientWriter.h>
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "AllocationCount.h"
+
+namespace {
+
+using aidl::android::hardware::graphics::composer3::ComposerClientWriter;
+
+constexpr int64_t kDisplay = 0;
+constexpr int kLayerCount = 32;
+// Layers which get a new buffer each frame, as a video, a game and the status bar
+constexpr int kUpdatingLayerCount = 3;
+
+// The client keeps the regions of its layers, visible is only reused to pass them
+void writeFrame(ComposerClientWriter& writer, int frame, std::vector<Rect>& visible) {
+    for (int i = 0; i < kLayerCount; i++) {
+        const int64_t layer = i;
+        const int32_t top = i * 64 + (i == 0 ? frame % 64 : 0);
+        const Rect frameRect = {.left = 0, .top = top, .right = 1080, .bottom = top + 64};
+        visible.assign(1, frameRect);
+        writer.setLayerCompositionType(kDisplay, layer, Composition::DEVICE);
+        writer.setLayerBlendMode(kDisplay, layer, BlendMode::PREMULTIPLIED);
+        writer.setLayerDataspace(kDisplay, layer, Dataspace::SRGB);
+        writer.setLayerDisplayFrame(kDisplay, layer, frameRect);
+        writer.setLayerPlaneAlpha(kDisplay, layer, 1.0f);
+        writer.setLayerSourceCrop(kDisplay, layer,
+                                  {.left = 0, .top = 0, .right = 1080, .bottom = 64});
+        writer.setLayerTransform(kDisplay, layer, static_cast<Transform>(0));
+        writer.setLayerVisibleRegion(kDisplay, layer, visible);
+        writer.setLayerZOrder(kDisplay, layer, static_cast<uint32_t>(i));
+        writer.setLayerBrightness(kDisplay, layer, 1.0f);
+        if (i < kUpdatingLayerCount) {
+            // Cached slot, no handle to dup
+            writer.setLayerBuffer(kDisplay, layer, static_cast<uint32_t>(frame % 3), nullptr, -1);
+            writer.setLayerSurfaceDamage(kDisplay, layer, visible);
+        }
+    }
+    writer.validateDisplay(kDisplay, ComposerClientWriter::kNoTimestamp, 8333333);
+    writer.presentDisplay(kDisplay);
+}
+
+size_t countLayerCommands(const std::vector<DisplayCommand>& commands) {
+    size_t count = 0;
+    for (const DisplayCommand& command : commands) {
+        count += command.layers.size();
+    }
+    return count;
+}
+
+// The argument is whether the writer is in ComposerClientWriter::Mode::kIncremental and reuses
+// its storage
+void BM_WriteFrame(benchmark::State& state) {
+    const bool incremental = state.range(0) != 0;
+    ComposerClientWriter writer(kDisplay, incremental ? ComposerClientWriter::Mode::kIncremental
+                                                      : ComposerClientWriter::Mode::kFull);
+    for (int i = 0; i < kLayerCount; i++) {
+        writer.onLayerCreated(i);
+    }
+    std::vector<Rect> visible;
+    int frame = 0;
+    size_t layerCommands = 0;
+    // The first frames size the reused storage
+    for (; frame < 2; frame++) {
+        writeFrame(writer, frame, visible);
+        writer.clearPendingCommands();
+    }
+
+    const size_t allocationsBefore = getAllocationCount();
+    for (auto _ : state) {
+        writeFrame(writer, frame++, visible);
+        if (incremental) {
+            const std::vector<DisplayCommand>& commands = writer.getPendingCommands();
+            benchmark::DoNotOptimize(commands.data());
+            layerCommands += countLayerCommands(commands);
+            writer.clearPendingCommands();
+        } else {
+            std::vector<DisplayCommand> commands = writer.takePendingCommands();
+            benchmark::DoNotOptimize(commands.data());
+            layerCommands += countLayerCommands(commands);
+        }
+    }
+    const size_t allocations = getAllocationCount() - allocationsBefore;
+
+    const double frames = static_cast<double>(state.iterations());
+    state.counters["frames/s"] = benchmark::Counter(frames, benchmark::Counter::kIsRate);
+    state.counters["layerCommands/frame"] = static_cast<double>(layerCommands) / frames;
+    state.counters["allocations/frame"] = static_cast<double>(allocations) / frames;
+}
+
+}  // namespace
+
+BENCHMARK(BM_WriteFrame)->Arg(0)->Arg(1);
@@ -17,10 +17,13 @@
 #pragma once
 
 #include <algorithm>
+#include <deque>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <optional>
-#include <unordered_map>
+#include <span>
+#include <utility>
 #include <vector>
 
 #include <inttypes.h>
@@ -52,43 +55,55 @@ class ComposerClientReader {
     // Parse and execute commands from the command queue.  The commands are
     // actually return values from the server and will be saved in ReturnData.
     void parse(std::vector<CommandResultPayload>&& results) {
-        resetData();
+        beginParse();
 
         for (auto& result : results) {
-            switch (result.getTag()) {
-                case CommandResultPayload::Tag::error:
-                    parseSetError(std::move(result.get<CommandResultPayload::Tag::error>()));
-                    break;
-                case CommandResultPayload::Tag::changedCompositionTypes:
-                    parseSetChangedCompositionTypes(std::move(
-                            result.get<CommandResultPayload::Tag::changedCompositionTypes>()));
-                    break;
-                case CommandResultPayload::Tag::displayRequest:
-                    parseSetDisplayRequests(
-                            std::move(result.get<CommandResultPayload::Tag::displayRequest>()));
-                    break;
-                case CommandResultPayload::Tag::presentFence:
-                    parseSetPresentFence(
-                            std::move(result.get<CommandResultPayload::Tag::presentFence>()));
-                    break;
-                case CommandResultPayload::Tag::releaseFences:
-                    parseSetReleaseFences(
-                            std::move(result.get<CommandResultPayload::Tag::releaseFences>()));
-                    break;
-                case CommandResultPayload::Tag::presentOrValidateResult:
-                    parseSetPresentOrValidateDisplayResult(std::move(
-                            result.get<CommandResultPayload::Tag::presentOrValidateResult>()));
-                    break;
-                case CommandResultPayload::Tag::clientTargetProperty:
-                    parseSetClientTargetProperty(std::move(
-                            result.get<CommandResultPayload::Tag::clientTargetProperty>()));
-                    break;
-                case CommandResultPayload::Tag::displayLuts:
-                    parseSetDisplayLuts(
-                            std::move(result.get<CommandResultPayload::Tag::displayLuts>()));
-                    break;
-            }
+            parseResult(std::move(result));
+        }
+    }
+
+    // Incremental form of parse: beginParse drops the data of the previous results, then each
+    // parseResult saves the data of one result, which can be read as soon as it returns. The
+    // storage of the previous results is reused.
+    void beginParse() { resetData(); }
+
+    // Returns the tag of the result parsed, for the caller to know which data is ready.
+    CommandResultPayload::Tag parseResult(CommandResultPayload&& result) {
+        const CommandResultPayload::Tag tag = result.getTag();
+        switch (tag) {
+            case CommandResultPayload::Tag::error:
+                parseSetError(std::move(result.get<CommandResultPayload::Tag::error>()));
+                break;
+            case CommandResultPayload::Tag::changedCompositionTypes:
+                parseSetChangedCompositionTypes(std::move(
+                        result.get<CommandResultPayload::Tag::changedCompositionTypes>()));
+                break;
+            case CommandResultPayload::Tag::displayRequest:
+                parseSetDisplayRequests(
+                        std::move(result.get<CommandResultPayload::Tag::displayRequest>()));
+                break;
+            case CommandResultPayload::Tag::presentFence:
+                parseSetPresentFence(
+                        std::move(result.get<CommandResultPayload::Tag::presentFence>()));
+                break;
+            case CommandResultPayload::Tag::releaseFences:
+                parseSetReleaseFences(
+                        std::move(result.get<CommandResultPayload::Tag::releaseFences>()));
+                break;
+            case CommandResultPayload::Tag::presentOrValidateResult:
+                parseSetPresentOrValidateDisplayResult(std::move(
+                        result.get<CommandResultPayload::Tag::presentOrValidateResult>()));
+                break;
+            case CommandResultPayload::Tag::clientTargetProperty:
+                parseSetClientTargetProperty(std::move(
+                        result.get<CommandResultPayload::Tag::clientTargetProperty>()));
+                break;
+            case CommandResultPayload::Tag::displayLuts:
+                parseSetDisplayLuts(
+                        std::move(result.get<CommandResultPayload::Tag::displayLuts>()));
+                break;
         }
+        return tag;
     }
 
     std::vector<CommandError> takeErrors() { return std::move(mErrors); }
@@ -96,14 +111,14 @@ class ComposerClientReader {
     void hasChanges(int64_t display, uint32_t* outNumChangedCompositionTypes,
                     uint32_t* outNumLayerRequestMasks) const {
         LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        const ReturnData* found = findData(display);
+        if (found == nullptr) {
             *outNumChangedCompositionTypes = 0;
             *outNumLayerRequestMasks = 0;
             return;
         }
 
-        const ReturnData& data = found->second;
+        const ReturnData& data = *found;
 
         *outNumChangedCompositionTypes = static_cast<uint32_t>(data.changedLayers.size());
         *outNumLayerRequestMasks = static_cast<uint32_t>(data.displayRequests.layerRequests.size());
@@ -112,128 +127,237 @@ class ComposerClientReader {
     // Get and clear saved changed composition types.
     std::vector<ChangedCompositionLayer> takeChangedCompositionTypes(int64_t display) {
         LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        ReturnData* found = findData(display);
+        if (found == nullptr) {
             return {};
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.changedLayers);
     }
 
     // Get and clear saved display requests.
     DisplayRequest takeDisplayRequests(int64_t display) {
         LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        ReturnData* found = findData(display);
+        if (found == nullptr) {
             return {};
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.displayRequests);
     }
 
     // Get and clear saved release fences.
     std::vector<ReleaseFences::Layer> takeReleaseFences(int64_t display) {
         LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        ReturnData* found = findData(display);
+        if (found == nullptr) {
             return {};
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.releasedLayers);
     }
 
     // Get and clear saved layer present fences.
     std::vector<PresentFence::LayerPresentFence> takeLayerPresentFences(int64_t display) {
         LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        ReturnData* found = findData(display);
+        if (found == nullptr) {
             return {};
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.layerPresentFences);
     }
 
     // Get and clear saved present fence.
     ndk::ScopedFileDescriptor takePresentFence(int64_t display) {
         LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        ReturnData* found = findData(display);
+        if (found == nullptr) {
             return {};
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.presentFence);
     }
 
     // Get what stage succeeded during PresentOrValidate: Present or Validate
     std::optional<PresentOrValidate::Result> takePresentOrValidateStage(int64_t display) {
         LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        ReturnData* found = findData(display);
+        if (found == nullptr) {
             return std::nullopt;
         }
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return data.presentOrValidateState;
     }
 
     // Get the client target properties requested by hardware composer.
     ClientTargetPropertyWithBrightness takeClientTargetProperty(int64_t display) {
         LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
-        auto found = mReturnData.find(display);
+        ReturnData* found = findData(display);
 
         // If not found, return the default values.
-        if (found == mReturnData.end()) {
-            return ClientTargetPropertyWithBrightness{
-                    .clientTargetProperty = {common::PixelFormat::RGBA_8888, Dataspace::UNKNOWN},
-                    .brightness = 1.f,
-            };
+        if (found == nullptr) {
+            return getDefaultClientTargetProperty();
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.clientTargetProperty);
     }
 
     // Get the lut(s) requested by hardware composer.
     std::vector<DisplayLuts::LayerLut> takeDisplayLuts(int64_t display) {
         LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
-        auto found = mReturnData.find(display);
+        ReturnData* found = findData(display);
 
         // If not found, return the empty vector
-        if (found == mReturnData.end()) {
+        if (found == nullptr) {
             return {};
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.layerLuts);
     }
 
+    // Views of the saved data. Unlike the take functions they leave the storage to the reader for
+    // the next results, the fences can still be moved out of them.
+    //
+    // A view of a display stays valid while results of other displays, and results of other
+    // kinds for the same display, are parsed. It is invalidated by parse, beginParse, the take
+    // function of the same data, and parsing a result of the same kind for the same display,
+    // which replaces the data. The errors view is invalidated by parsing another error.
+    std::span<const CommandError> getErrors() const { return mErrors; }
+
+    std::span<ChangedCompositionLayer> getChangedCompositionTypes(int64_t display) {
+        LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
+        ReturnData* found = findData(display);
+        return found ? std::span(found->changedLayers) : std::span<ChangedCompositionLayer>();
+    }
+
+    // Returns nullptr if there are no results for the display.
+    const DisplayRequest* getDisplayRequests(int64_t display) const {
+        LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
+        const ReturnData* found = findData(display);
+        return found ? &found->displayRequests : nullptr;
+    }
+
+    std::span<ReleaseFences::Layer> getReleaseFences(int64_t display) {
+        LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
+        ReturnData* found = findData(display);
+        return found ? std::span(found->releasedLayers) : std::span<ReleaseFences::Layer>();
+    }
+
+    std::span<PresentFence::LayerPresentFence> getLayerPresentFences(int64_t display) {
+        LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
+        ReturnData* found = findData(display);
+        return found ? std::span(found->layerPresentFences)
+                     : std::span<PresentFence::LayerPresentFence>();
+    }
+
+    std::span<DisplayLuts::LayerLut> getDisplayLuts(int64_t display) {
+        LOG_ALWAYS_FATAL_IF(mDisplay && display != *mDisplay);
+        ReturnData* found = findData(display);
+        return found ? std::span(found->layerLuts) : std::span<DisplayLuts::LayerLut>();
+    }
+
   private:
+    struct ReturnData {
+        int64_t display = 0;
+        DisplayRequest displayRequests;
+        std::vector<ChangedCompositionLayer> changedLayers;
+        ndk::ScopedFileDescriptor presentFence;
+        std::vector<PresentFence::LayerPresentFence> layerPresentFences;
+        std::vector<ReleaseFences::Layer> releasedLayers;
+        PresentOrValidate::Result presentOrValidateState;
+
+        ClientTargetPropertyWithBrightness clientTargetProperty = getDefaultClientTargetProperty();
+        std::vector<DisplayLuts::LayerLut> layerLuts;
+
+        // Clears the data, keeping the storage of the vectors.
+        void clear() {
+            displayRequests.display = 0;
+            displayRequests.mask = 0;
+            displayRequests.layerRequests.clear();
+            changedLayers.clear();
+            presentFence = ndk::ScopedFileDescriptor();
+            layerPresentFences.clear();
+            releasedLayers.clear();
+            presentOrValidateState = {};
+            clientTargetProperty = getDefaultClientTargetProperty();
+            layerLuts.clear();
+        }
+    };
+
+    static ClientTargetPropertyWithBrightness getDefaultClientTargetProperty() {
+        return {
+                .clientTargetProperty = {common::PixelFormat::RGBA_8888, Dataspace::UNKNOWN},
+                .brightness = 1.f,
+        };
+    }
+
     void resetData() {
         mErrors.clear();
-        mReturnData.clear();
+        for (size_t i = 0; i < mReturnDataCount; i++) {
+            mReturnData[i].clear();
+        }
+        mReturnDataCount = 0;
+    }
+
+    // The data of the displays in the results are the first mReturnDataCount slots, in the order
+    // they first appear. There are few displays so they are searched linearly. The slots are in a
+    // deque so that adding the slot of a new display does not move the data the views point to.
+    const ReturnData* findData(int64_t display) const {
+        for (size_t i = 0; i < mReturnDataCount; i++) {
+            if (mReturnData[i].display == display) {
+                return &mReturnData[i];
+            }
+        }
+        return nullptr;
+    }
+
+    ReturnData* findData(int64_t display) {
+        return const_cast<ReturnData*>(std::as_const(*this).findData(display));
+    }
+
+    ReturnData& getData(int64_t display) {
+        if (ReturnData* found = findData(display)) {
+            return *found;
+        }
+        if (mReturnDataCount == mReturnData.size()) {
+            mReturnData.emplace_back();
+        }
+        ReturnData& data = mReturnData[mReturnDataCount++];
+        data.display = display;
+        return data;
     }
 
     void parseSetError(CommandError&& error) { mErrors.emplace_back(error); }
 
     void parseSetChangedCompositionTypes(ChangedCompositionTypes&& changedCompositionTypes) {
         LOG_ALWAYS_FATAL_IF(mDisplay && changedCompositionTypes.display != *mDisplay);
-        auto& data = mReturnData[changedCompositionTypes.display];
-        data.changedLayers = std::move(changedCompositionTypes.layers);
+        auto& data = getData(changedCompositionTypes.display);
+        auto& layers = changedCompositionTypes.layers;
+        data.changedLayers.assign(std::make_move_iterator(layers.begin()),
+                                  std::make_move_iterator(layers.end()));
     }
 
     void parseSetDisplayRequests(DisplayRequest&& displayRequest) {
         LOG_ALWAYS_FATAL_IF(mDisplay && displayRequest.display != *mDisplay);
-        auto& data = mReturnData[displayRequest.display];
-        data.displayRequests = std::move(displayRequest);
+        auto& data = getData(displayRequest.display);
+        data.displayRequests.display = displayRequest.display;
+        data.displayRequests.mask = displayRequest.mask;
+        auto& layerRequests = displayRequest.layerRequests;
+        data.displayRequests.layerRequests.assign(std::make_move_iterator(layerRequests.begin()),
+                                                  std::make_move_iterator(layerRequests.end()));
     }
 
     void parseSetPresentFence(PresentFence&& presentFence) {
         LOG_ALWAYS_FATAL_IF(mDisplay && presentFence.display != *mDisplay);
-        auto& data = mReturnData[presentFence.display];
+        auto& data = getData(presentFence.display);
         data.presentFence = std::move(presentFence.fence);
 
         if (presentFence.layerPresentFences.has_value()) {
@@ -247,26 +371,28 @@ class ComposerClientReader {
 
     void parseSetReleaseFences(ReleaseFences&& releaseFences) {
         LOG_ALWAYS_FATAL_IF(mDisplay && releaseFences.display != *mDisplay);
-        auto& data = mReturnData[releaseFences.display];
-        data.releasedLayers = std::move(releaseFences.layers);
+        auto& data = getData(releaseFences.display);
+        auto& layers = releaseFences.layers;
+        data.releasedLayers.assign(std::make_move_iterator(layers.begin()),
+                                   std::make_move_iterator(layers.end()));
     }
 
     void parseSetPresentOrValidateDisplayResult(const PresentOrValidate&& presentOrValidate) {
         LOG_ALWAYS_FATAL_IF(mDisplay && presentOrValidate.display != *mDisplay);
-        auto& data = mReturnData[presentOrValidate.display];
+        auto& data = getData(presentOrValidate.display);
         data.presentOrValidateState = std::move(presentOrValidate.result);
     }
 
     void parseSetClientTargetProperty(
             const ClientTargetPropertyWithBrightness&& clientTargetProperty) {
         LOG_ALWAYS_FATAL_IF(mDisplay && clientTargetProperty.display != *mDisplay);
-        auto& data = mReturnData[clientTargetProperty.display];
+        auto& data = getData(clientTargetProperty.display);
         data.clientTargetProperty = std::move(clientTargetProperty);
     }
 
     void parseSetDisplayLuts(DisplayLuts&& displayLuts) {
         LOG_ALWAYS_FATAL_IF(mDisplay && displayLuts.display != *mDisplay);
-        auto& data = mReturnData[displayLuts.display];
+        auto& data = getData(displayLuts.display);
         for (auto& [layerId, luts] : displayLuts.layerLuts) {
             if (luts.pfd.get() >= 0) {
                 data.layerLuts.push_back({layerId, std::move(luts)});
@@ -274,23 +400,9 @@ class ComposerClientReader {
         }
     }
 
-    struct ReturnData {
-        DisplayRequest displayRequests;
-        std::vector<ChangedCompositionLayer> changedLayers;
-        ndk::ScopedFileDescriptor presentFence;
-        std::vector<PresentFence::LayerPresentFence> layerPresentFences;
-        std::vector<ReleaseFences::Layer> releasedLayers;
-        PresentOrValidate::Result presentOrValidateState;
-
-        ClientTargetPropertyWithBrightness clientTargetProperty = {
-                .clientTargetProperty = {common::PixelFormat::RGBA_8888, Dataspace::UNKNOWN},
-                .brightness = 1.f,
-        };
-        std::vector<DisplayLuts::LayerLut> layerLuts;
-    };
-
     std::vector<CommandError> mErrors;
-    std::unordered_map<int64_t, ReturnData> mReturnData;
+    std::deque<ReturnData> mReturnData;
+    size_t mReturnDataCount = 0;
     const std::optional<int64_t> mDisplay;
 };
 
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <inttypes.h>
@@ -63,7 +64,23 @@ class ComposerClientWriter final {
   public:
     static constexpr std::optional<ClockMonotonicTimestamp> kNoTimestamp = std::nullopt;
 
-    explicit ComposerClientWriter(int64_t display) : mDisplay(display) { reset(); }
+    enum class Mode {
+        // Every field set is sent.
+        kFull,
+        // The layer properties which keep their value across frames (blend mode, color,
+        // composition type, dataspace, display frame, plane alpha, source crop, transform, visible
+        // region, z order, color transform, brightness and blocking region) are only sent when
+        // they differ from the value in the commands last taken for the layer. The buffer, damage
+        // and the other per frame fields are always sent. Only the layers created with
+        // LayerLifecycleBatchCommandType::CREATE or passed to onLayerCreated are tracked, the
+        // properties of the others are always sent.
+        kIncremental,
+    };
+
+    explicit ComposerClientWriter(int64_t display, Mode mode = Mode::kFull)
+        : mDisplay(display), mMode(mode) {
+        reset();
+    }
 
     ~ComposerClientWriter() { reset(); }
 
@@ -107,6 +124,13 @@ class ComposerClientWriter final {
 
     void setLayerLifecycleBatchCommandType(int64_t display, int64_t layer,
                                            LayerLifecycleBatchCommandType cmd) {
+        // A created layer starts from the default state, and the id of a destroyed one can be
+        // reused.
+        if (cmd == LayerLifecycleBatchCommandType::CREATE) {
+            onLayerCreated(layer);
+        } else if (cmd == LayerLifecycleBatchCommandType::DESTROY) {
+            forgetLayerState(layer);
+        }
         getLayerCommand(display, layer).layerLifecycleBatchCommandType = cmd;
     }
 
@@ -133,6 +157,11 @@ class ComposerClientWriter final {
     }
 
     void acceptDisplayChanges(int64_t display) {
+        // The composer may have changed the composition type of any layer
+        for (auto& [layer, state] : mLayerStates) {
+            state.sent.composition.reset();
+            state.pending.composition.reset();
+        }
         getDisplayCommand(display).acceptDisplayChanges = true;
     }
 
@@ -164,38 +193,51 @@ class ComposerClientWriter final {
     }
 
     void setLayerSurfaceDamage(int64_t display, int64_t layer, const std::vector<Rect>& damage) {
-        getLayerCommand(display, layer).damage.emplace(damage.begin(), damage.end());
+        assignRegion(getLayerCommand(display, layer).damage, damage);
     }
 
     void setLayerBlendMode(int64_t display, int64_t layer, BlendMode mode) {
         ParcelableBlendMode parcelableBlendMode;
         parcelableBlendMode.blendMode = mode;
+        if (isLayerStateUnchanged(display, layer, &LayerCommand::blendMode, parcelableBlendMode)) {
+            return;
+        }
         getLayerCommand(display, layer).blendMode.emplace(std::move(parcelableBlendMode));
     }
 
     void setLayerColor(int64_t display, int64_t layer, Color color) {
+        if (isLayerStateUnchanged(display, layer, &LayerCommand::color, color)) return;
         getLayerCommand(display, layer).color.emplace(std::move(color));
     }
 
     void setLayerCompositionType(int64_t display, int64_t layer, Composition type) {
         ParcelableComposition compositionPayload;
         compositionPayload.composition = type;
+        if (isLayerStateUnchanged(display, layer, &LayerCommand::composition,
+                                  compositionPayload)) {
+            return;
+        }
         getLayerCommand(display, layer).composition.emplace(std::move(compositionPayload));
     }
 
     void setLayerDataspace(int64_t display, int64_t layer, Dataspace dataspace) {
         ParcelableDataspace dataspacePayload;
         dataspacePayload.dataspace = dataspace;
+        if (isLayerStateUnchanged(display, layer, &LayerCommand::dataspace, dataspacePayload)) {
+            return;
+        }
         getLayerCommand(display, layer).dataspace.emplace(std::move(dataspacePayload));
     }
 
     void setLayerDisplayFrame(int64_t display, int64_t layer, const Rect& frame) {
+        if (isLayerStateUnchanged(display, layer, &LayerCommand::displayFrame, frame)) return;
         getLayerCommand(display, layer).displayFrame.emplace(frame);
     }
 
     void setLayerPlaneAlpha(int64_t display, int64_t layer, float alpha) {
         PlaneAlpha planeAlpha;
         planeAlpha.alpha = alpha;
+        if (isLayerStateUnchanged(display, layer, &LayerCommand::planeAlpha, planeAlpha)) return;
         getLayerCommand(display, layer).planeAlpha.emplace(std::move(planeAlpha));
     }
 
@@ -206,22 +248,28 @@ class ComposerClientWriter final {
     }
 
     void setLayerSourceCrop(int64_t display, int64_t layer, const FRect& crop) {
+        if (isLayerStateUnchanged(display, layer, &LayerCommand::sourceCrop, crop)) return;
         getLayerCommand(display, layer).sourceCrop.emplace(crop);
     }
 
     void setLayerTransform(int64_t display, int64_t layer, Transform transform) {
         ParcelableTransform transformPayload;
         transformPayload.transform = transform;
+        if (isLayerStateUnchanged(display, layer, &LayerCommand::transform, transformPayload)) {
+            return;
+        }
         getLayerCommand(display, layer).transform.emplace(std::move(transformPayload));
     }
 
     void setLayerVisibleRegion(int64_t display, int64_t layer, const std::vector<Rect>& visible) {
-        getLayerCommand(display, layer).visibleRegion.emplace(visible.begin(), visible.end());
+        if (isLayerRegionUnchanged(display, layer, &LayerCommand::visibleRegion, visible)) return;
+        assignRegion(getLayerCommand(display, layer).visibleRegion, visible);
     }
 
     void setLayerZOrder(int64_t display, int64_t layer, uint32_t z) {
         ZOrder zorder;
         zorder.z = static_cast<int32_t>(z);
+        if (isLayerStateUnchanged(display, layer, &LayerCommand::z, zorder)) return;
         getLayerCommand(display, layer).z.emplace(std::move(zorder));
     }
 
@@ -232,6 +280,13 @@ class ComposerClientWriter final {
     }
 
     void setLayerColorTransform(int64_t display, int64_t layer, const float* matrix) {
+        if (LayerState* state = getLayerState(display, layer)) {
+            const auto& last = getLastValue(*state, &LayerCommand::colorTransform);
+            if (last.has_value() && std::equal(last->begin(), last->end(), matrix, matrix + 16)) {
+                return;
+            }
+            state->pending.colorTransform.emplace(matrix, matrix + 16);
+        }
         getLayerCommand(display, layer).colorTransform.emplace(matrix, matrix + 16);
     }
 
@@ -242,12 +297,18 @@ class ComposerClientWriter final {
     }
 
     void setLayerBrightness(int64_t display, int64_t layer, float brightness) {
-        getLayerCommand(display, layer)
-                .brightness.emplace(LayerBrightness{.brightness = brightness});
+        const LayerBrightness layerBrightness{.brightness = brightness};
+        if (isLayerStateUnchanged(display, layer, &LayerCommand::brightness, layerBrightness)) {
+            return;
+        }
+        getLayerCommand(display, layer).brightness.emplace(layerBrightness);
     }
 
     void setLayerBlockingRegion(int64_t display, int64_t layer, const std::vector<Rect>& blocking) {
-        getLayerCommand(display, layer).blockingRegion.emplace(blocking.begin(), blocking.end());
+        if (isLayerRegionUnchanged(display, layer, &LayerCommand::blockingRegion, blocking)) {
+            return;
+        }
+        assignRegion(getLayerCommand(display, layer).blockingRegion, blocking);
     }
 
     void setLayerLuts(int64_t display, int64_t layer, Luts& luts) {
@@ -259,19 +320,78 @@ class ComposerClientWriter final {
         getLayerCommand(display, layer).pictureProfileId = pictureProfileId;
     }
 
+    // In Mode::kIncremental, tracks the layer from the default state. Must be called when the
+    // layer is created with IComposerClient::createLayer, whose ids can be reused.
+    void onLayerCreated(int64_t layer) {
+        if (mMode == Mode::kIncremental) mLayerStates[layer] = {};
+    }
+
+    // In Mode::kIncremental, stops tracking the layer so its properties are all sent. Must be
+    // called when the layer is destroyed with IComposerClient::destroyLayer.
+    void forgetLayerState(int64_t layer) { mLayerStates.erase(layer); }
+
+    // In Mode::kIncremental, the layer properties of the commands are the ones the composer has
+    // from then on.
     std::vector<DisplayCommand> takePendingCommands() {
         flushLayerCommand();
         flushDisplayCommand();
+        commitLayerStates();
         std::vector<DisplayCommand> moved = std::move(mCommands);
         mCommands.clear();
         return moved;
     }
 
+    // As takePendingCommands, but the commands stay owned by the writer until
+    // clearPendingCommands, which keeps their storage for the next frame.
+    const std::vector<DisplayCommand>& getPendingCommands() {
+        flushLayerCommand();
+        flushDisplayCommand();
+        commitLayerStates();
+        return mCommands;
+    }
+
+    // Commands written since the last getPendingCommands are dropped, as are the layer properties
+    // they would have sent.
+    void clearPendingCommands() {
+        flushLayerCommand();
+        flushDisplayCommand();
+        for (auto& [layer, state] : mLayerStates) {
+            state.pending = {};
+        }
+        for (DisplayCommand& command : mCommands) {
+            for (LayerCommand& layerCommand : command.layers) {
+                recycleRegion(layerCommand.damage);
+                recycleRegion(layerCommand.visibleRegion);
+                recycleRegion(layerCommand.blockingRegion);
+            }
+            command.layers.clear();
+            if (command.layers.capacity() > mSpareLayers.capacity()) {
+                mSpareLayers = std::move(command.layers);
+            }
+        }
+        mCommands.clear();
+    }
+
   private:
+    using Region = std::vector<std::optional<Rect>>;
+
+    struct LayerState {
+        // The properties the composer has for the layer
+        LayerCommand sent;
+        // The properties set since the commands were last taken
+        LayerCommand pending;
+    };
+
     std::optional<DisplayCommand> mDisplayCommand;
     std::optional<LayerCommand> mLayerCommand;
     std::vector<DisplayCommand> mCommands;
     const int64_t mDisplay;
+    const Mode mMode;
+    // The state of each tracked layer, in Mode::kIncremental.
+    std::unordered_map<int64_t, LayerState> mLayerStates;
+    // Storage of the commands cleared by clearPendingCommands, for the next ones to reuse.
+    std::vector<LayerCommand> mSpareLayers;
+    std::vector<Region> mSpareRegions;
 
     Buffer getBufferCommand(uint32_t slot, const native_handle_t* bufferHandle, int fence) {
         Buffer bufferCommand;
@@ -303,10 +423,110 @@ class ComposerClientWriter final {
             flushDisplayCommand();
             mDisplayCommand.emplace();
             mDisplayCommand->display = display;
+            mDisplayCommand->layers = std::move(mSpareLayers);
+            mSpareLayers.clear();
         }
         return *mDisplayCommand;
     }
 
+    // Returns nullptr in Mode::kFull and for the layers which are not tracked.
+    LayerState* getLayerState(int64_t display, int64_t layer) {
+        if (mMode != Mode::kIncremental) return nullptr;
+        LOG_ALWAYS_FATAL_IF(display != mDisplay, "Expected display %" PRId64 ", got %" PRId64,
+                            mDisplay, display);
+        auto it = mLayerStates.find(layer);
+        return it == mLayerStates.end() ? nullptr : &it->second;
+    }
+
+    // The value of the field once the pending commands are sent
+    template <typename T>
+    static const std::optional<T>& getLastValue(const LayerState& state,
+                                                std::optional<T> LayerCommand::*field) {
+        const std::optional<T>& pending = state.pending.*field;
+        return pending.has_value() ? pending : state.sent.*field;
+    }
+
+    // Returns true if the field of the layer already has value, otherwise records that it is set
+    // to value. Always false for the layers which are not tracked.
+    template <typename T>
+    bool isLayerStateUnchanged(int64_t display, int64_t layer,
+                               std::optional<T> LayerCommand::*field, const T& value) {
+        LayerState* state = getLayerState(display, layer);
+        if (state == nullptr) return false;
+        if (getLastValue(*state, field) == value) return true;
+        state->pending.*field = value;
+        return false;
+    }
+
+    bool isLayerRegionUnchanged(int64_t display, int64_t layer,
+                                std::optional<Region> LayerCommand::*field,
+                                const std::vector<Rect>& region) {
+        LayerState* state = getLayerState(display, layer);
+        if (state == nullptr) return false;
+        const std::optional<Region>& last = getLastValue(*state, field);
+        if (last.has_value() &&
+            std::equal(last->begin(), last->end(), region.begin(), region.end())) {
+            return true;
+        }
+        assignRegion(state->pending.*field, region);
+        return false;
+    }
+
+    template <typename T>
+    static void commitField(LayerState& state, std::optional<T> LayerCommand::*field) {
+        std::optional<T>& pending = state.pending.*field;
+        if (pending.has_value()) {
+            state.sent.*field = std::move(pending);
+            pending.reset();
+        }
+    }
+
+    void commitRegion(LayerState& state, std::optional<Region> LayerCommand::*field) {
+        if ((state.pending.*field).has_value()) {
+            recycleRegion(state.sent.*field);
+            commitField(state, field);
+        }
+    }
+
+    // Called when the commands are taken, the pending properties are then sent
+    void commitLayerStates() {
+        for (auto& [layer, state] : mLayerStates) {
+            commitField(state, &LayerCommand::blendMode);
+            commitField(state, &LayerCommand::color);
+            commitField(state, &LayerCommand::composition);
+            commitField(state, &LayerCommand::dataspace);
+            commitField(state, &LayerCommand::displayFrame);
+            commitField(state, &LayerCommand::planeAlpha);
+            commitField(state, &LayerCommand::sourceCrop);
+            commitField(state, &LayerCommand::transform);
+            commitRegion(state, &LayerCommand::visibleRegion);
+            commitField(state, &LayerCommand::z);
+            commitField(state, &LayerCommand::colorTransform);
+            commitField(state, &LayerCommand::brightness);
+            commitRegion(state, &LayerCommand::blockingRegion);
+        }
+    }
+
+    void assignRegion(std::optional<Region>& field, const std::vector<Rect>& region) {
+        if (!field.has_value()) {
+            if (mSpareRegions.empty()) {
+                field.emplace();
+            } else {
+                field.emplace(std::move(mSpareRegions.back()));
+                mSpareRegions.pop_back();
+            }
+        }
+        field->assign(region.begin(), region.end());
+    }
+
+    void recycleRegion(std::optional<Region>& field) {
+        if (field.has_value()) {
+            field->clear();
+            mSpareRegions.push_back(std::move(*field));
+            field.reset();
+        }
+    }
+
     LayerCommand& getLayerCommand(int64_t display, int64_t layer) {
         getDisplayCommand(display);
         if (!mLayerCommand.has_value() || mLayerCommand->layer != layer) {
@@ -321,6 +541,7 @@ class ComposerClientWriter final {
         mDisplayCommand.reset();
         mLayerCommand.reset();
         mCommands.clear();
+        mLayerStates.clear();
     }
 };
 
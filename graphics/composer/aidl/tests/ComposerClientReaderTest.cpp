@@ -0,0 +1,223 @@
+/*
+ * Copyright 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <android/hardware/graphics/composer3/ComposerClientReader.h>
+#include <gtest/gtest.h>
+
+namespace aidl::android::hardware::graphics::composer3 {
+namespace {
+
+using Tag = CommandResultPayload::Tag;
+
+// More displays than the reader has slots for after the first results, so that new slots are
+// added while views of the first display are held.
+constexpr int64_t kNumDisplays = 16;
+constexpr size_t kNumLayers = 4;
+
+ndk::ScopedFileDescriptor makeFence() {
+    return ndk::ScopedFileDescriptor(::open("/dev/null", O_RDONLY | O_CLOEXEC));
+}
+
+CommandResultPayload makeChangedCompositionTypes(int64_t display) {
+    ChangedCompositionTypes changed;
+    changed.display = display;
+    for (size_t i = 0; i < kNumLayers; i++) {
+        const int64_t layer = static_cast<int64_t>(i);
+        changed.layers.push_back({.layer = layer, .composition = Composition::CLIENT});
+    }
+    return CommandResultPayload::make<Tag::changedCompositionTypes>(std::move(changed));
+}
+
+CommandResultPayload makeDisplayRequest(int64_t display) {
+    DisplayRequest request;
+    request.display = display;
+    request.mask = DisplayRequest::FLIP_CLIENT_TARGET;
+    request.layerRequests.push_back(
+            {.layer = 1, .mask = DisplayRequest::LayerRequest::CLEAR_CLIENT_TARGET});
+    return CommandResultPayload::make<Tag::displayRequest>(std::move(request));
+}
+
+CommandResultPayload makeReleaseFences(int64_t display) {
+    ReleaseFences fences;
+    fences.display = display;
+    for (size_t i = 0; i < kNumLayers; i++) {
+        const int64_t layer = static_cast<int64_t>(i);
+        ReleaseFences::Layer released;
+        released.layer = layer;
+        released.fence = makeFence();
+        fences.layers.push_back(std::move(released));
+    }
+    return CommandResultPayload::make<Tag::releaseFences>(std::move(fences));
+}
+
+CommandResultPayload makePresentFence(int64_t display) {
+    PresentFence present;
+    present.display = display;
+    present.fence = makeFence();
+    present.layerPresentFences.emplace();
+    for (size_t i = 0; i < kNumLayers; i++) {
+        const int64_t layer = static_cast<int64_t>(i);
+        PresentFence::LayerPresentFence layerFence;
+        layerFence.layer = layer;
+        layerFence.bufferFence = makeFence();
+        present.layerPresentFences->push_back(std::move(layerFence));
+    }
+    return CommandResultPayload::make<Tag::presentFence>(std::move(present));
+}
+
+CommandResultPayload makeError(int32_t commandIndex) {
+    return CommandResultPayload::make<Tag::error>(
+            CommandError{.commandIndex = commandIndex, .errorCode = 1});
+}
+
+TEST(ComposerClientReaderTest, ParseResultReturnsTagAndSavesData) {
+    ComposerClientReader reader;
+    reader.beginParse();
+
+    EXPECT_EQ(Tag::changedCompositionTypes, reader.parseResult(makeChangedCompositionTypes(1)));
+    // The data is ready as soon as parseResult returns.
+    EXPECT_EQ(kNumLayers, reader.getChangedCompositionTypes(1).size());
+    EXPECT_EQ(nullptr, reader.getDisplayRequests(2));
+    EXPECT_TRUE(reader.getReleaseFences(1).empty());
+
+    EXPECT_EQ(Tag::displayRequest, reader.parseResult(makeDisplayRequest(1)));
+    const DisplayRequest* requests = reader.getDisplayRequests(1);
+    ASSERT_NE(nullptr, requests);
+    EXPECT_EQ(DisplayRequest::FLIP_CLIENT_TARGET, requests->mask);
+    ASSERT_EQ(1u, requests->layerRequests.size());
+
+    EXPECT_EQ(Tag::releaseFences, reader.parseResult(makeReleaseFences(1)));
+    EXPECT_EQ(Tag::presentFence, reader.parseResult(makePresentFence(1)));
+    EXPECT_EQ(Tag::error, reader.parseResult(makeError(3)));
+
+    ASSERT_EQ(1u, reader.getErrors().size());
+    EXPECT_EQ(3, reader.getErrors()[0].commandIndex);
+    EXPECT_EQ(kNumLayers, reader.getReleaseFences(1).size());
+    EXPECT_EQ(kNumLayers, reader.getLayerPresentFences(1).size());
+
+    uint32_t numChangedCompositionTypes;
+    uint32_t numLayerRequestMasks;
+    reader.hasChanges(1, &numChangedCompositionTypes, &numLayerRequestMasks);
+    EXPECT_EQ(kNumLayers, numChangedCompositionTypes);
+    EXPECT_EQ(1u, numLayerRequestMasks);
+}
+
+TEST(ComposerClientReaderTest, ViewsSurviveResultsOfOtherDisplays) {
+    ComposerClientReader reader;
+    reader.beginParse();
+    reader.parseResult(makeChangedCompositionTypes(0));
+    reader.parseResult(makeDisplayRequest(0));
+    reader.parseResult(makeReleaseFences(0));
+
+    const std::span<ChangedCompositionLayer> changed = reader.getChangedCompositionTypes(0);
+    const DisplayRequest* requests = reader.getDisplayRequests(0);
+    const std::span<ReleaseFences::Layer> released = reader.getReleaseFences(0);
+    std::vector<int> releaseFds;
+    for (const auto& layer : released) {
+        releaseFds.push_back(layer.fence.get());
+    }
+
+    // Each new display takes a new slot of the reader.
+    for (int64_t display = 1; display < kNumDisplays; display++) {
+        reader.parseResult(makeChangedCompositionTypes(display));
+        reader.parseResult(makeDisplayRequest(display));
+        reader.parseResult(makeReleaseFences(display));
+    }
+    // Results of other kinds for the same display.
+    reader.parseResult(makePresentFence(0));
+
+    EXPECT_EQ(changed.data(), reader.getChangedCompositionTypes(0).data());
+    ASSERT_EQ(kNumLayers, changed.size());
+    EXPECT_EQ(Composition::CLIENT, changed[kNumLayers - 1].composition);
+    EXPECT_EQ(requests, reader.getDisplayRequests(0));
+    EXPECT_EQ(0, requests->display);
+    ASSERT_EQ(1u, requests->layerRequests.size());
+    EXPECT_EQ(1, requests->layerRequests[0].layer);
+    ASSERT_EQ(releaseFds.size(), released.size());
+    for (size_t i = 0; i < released.size(); i++) {
+        EXPECT_EQ(releaseFds[i], released[i].fence.get());
+    }
+
+    // The fences can be moved out of a view.
+    ndk::ScopedFileDescriptor fence = std::move(released[0].fence);
+    EXPECT_EQ(releaseFds[0], fence.get());
+    EXPECT_EQ(-1, reader.getReleaseFences(0)[0].fence.get());
+}
+
+TEST(ComposerClientReaderTest, TakeLeavesViewEmpty) {
+    ComposerClientReader reader;
+    reader.beginParse();
+    reader.parseResult(makeReleaseFences(1));
+    reader.parseResult(makePresentFence(1));
+
+    EXPECT_EQ(kNumLayers, reader.takeReleaseFences(1).size());
+    EXPECT_TRUE(reader.getReleaseFences(1).empty());
+    EXPECT_GE(reader.takePresentFence(1).get(), 0);
+    EXPECT_EQ(-1, reader.takePresentFence(1).get());
+    EXPECT_EQ(kNumLayers, reader.getLayerPresentFences(1).size());
+}
+
+TEST(ComposerClientReaderTest, BeginParseDropsDataAndReusesStorage) {
+    ComposerClientReader reader;
+    reader.beginParse();
+    reader.parseResult(makeChangedCompositionTypes(1));
+    reader.parseResult(makeDisplayRequest(1));
+    reader.parseResult(makeReleaseFences(1));
+    reader.parseResult(makePresentFence(1));
+    reader.parseResult(makeError(0));
+    const ChangedCompositionLayer* changedStorage = reader.getChangedCompositionTypes(1).data();
+    const DisplayRequest::LayerRequest* requestStorage =
+            reader.getDisplayRequests(1)->layerRequests.data();
+    const ReleaseFences::Layer* releasedStorage = reader.getReleaseFences(1).data();
+    const PresentFence::LayerPresentFence* storage = reader.getLayerPresentFences(1).data();
+
+    reader.beginParse();
+    EXPECT_TRUE(reader.getErrors().empty());
+    EXPECT_TRUE(reader.getChangedCompositionTypes(1).empty());
+    EXPECT_TRUE(reader.getReleaseFences(1).empty());
+    EXPECT_TRUE(reader.getLayerPresentFences(1).empty());
+    EXPECT_EQ(nullptr, reader.getDisplayRequests(1));
+    EXPECT_FALSE(reader.takePresentOrValidateStage(1).has_value());
+
+    reader.parseResult(makeChangedCompositionTypes(1));
+    reader.parseResult(makeDisplayRequest(1));
+    reader.parseResult(makeReleaseFences(1));
+    reader.parseResult(makePresentFence(1));
+    EXPECT_EQ(changedStorage, reader.getChangedCompositionTypes(1).data());
+    EXPECT_EQ(kNumLayers, reader.getChangedCompositionTypes(1).size());
+    ASSERT_NE(nullptr, reader.getDisplayRequests(1));
+    EXPECT_EQ(requestStorage, reader.getDisplayRequests(1)->layerRequests.data());
+    EXPECT_EQ(DisplayRequest::FLIP_CLIENT_TARGET, reader.getDisplayRequests(1)->mask);
+    EXPECT_EQ(releasedStorage, reader.getReleaseFences(1).data());
+    ASSERT_EQ(kNumLayers, reader.getReleaseFences(1).size());
+    EXPECT_GE(reader.getReleaseFences(1)[0].fence.get(), 0);
+    EXPECT_EQ(storage, reader.getLayerPresentFences(1).data());
+    EXPECT_EQ(kNumLayers, reader.getLayerPresentFences(1).size());
+
+    std::vector<CommandResultPayload> results;
+    results.push_back(makeDisplayRequest(2));
+    reader.parse(std::move(results));
+    EXPECT_TRUE(reader.getLayerPresentFences(1).empty());
+    EXPECT_NE(nullptr, reader.getDisplayRequests(2));
+}
+
+}  // namespace
+}  // namespace aidl::android::hardware::graphics::composer3
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <android/hardware/graphics/composer3/ComposerClientWriter.h>
+#include <gtest/gtest.h>
+
+namespace aidl::android::hardware::graphics::composer3 {
+namespace {
+
+using Mode = ComposerClientWriter::Mode;
+
+constexpr int64_t kDisplay = 0;
+constexpr int64_t kLayer = 1;
+const Rect kFrame = {.left = 0, .top = 0, .right = 100, .bottom = 50};
+const Rect kMovedFrame = {.left = 0, .top = 10, .right = 100, .bottom = 60};
+
+// The properties a client sets on each of its layers every frame
+void writeLayer(ComposerClientWriter& writer, int64_t layer, const Rect& frame) {
+    writer.setLayerCompositionType(kDisplay, layer, Composition::DEVICE);
+    writer.setLayerBlendMode(kDisplay, layer, BlendMode::PREMULTIPLIED);
+    writer.setLayerDisplayFrame(kDisplay, layer, frame);
+    writer.setLayerVisibleRegion(kDisplay, layer, {frame});
+    writer.setLayerZOrder(kDisplay, layer, static_cast<uint32_t>(layer));
+}
+
+// Takes the commands of a frame, they must be of kDisplay.
+std::vector<LayerCommand> takeLayerCommands(ComposerClientWriter& writer) {
+    writer.presentDisplay(kDisplay);
+    std::vector<DisplayCommand> commands = writer.takePendingCommands();
+    EXPECT_EQ(1u, commands.size());
+    return commands.empty() ? std::vector<LayerCommand>() : std::move(commands[0].layers);
+}
+
+TEST(ComposerClientWriterTest, FullModeSendsEveryProperty) {
+    ComposerClientWriter writer(kDisplay, Mode::kFull);
+    for (int frame = 0; frame < 2; frame++) {
+        writer.onLayerCreated(kLayer);
+        writeLayer(writer, kLayer, kFrame);
+        std::vector<LayerCommand> layers = takeLayerCommands(writer);
+        ASSERT_EQ(1u, layers.size());
+        EXPECT_TRUE(layers[0].composition.has_value());
+        EXPECT_TRUE(layers[0].visibleRegion.has_value());
+    }
+}
+
+TEST(ComposerClientWriterTest, UnchangedPropertiesAreNotSent) {
+    ComposerClientWriter writer(kDisplay, Mode::kIncremental);
+    writer.onLayerCreated(kLayer);
+    writeLayer(writer, kLayer, kFrame);
+    std::vector<LayerCommand> layers = takeLayerCommands(writer);
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_EQ(kFrame, layers[0].displayFrame);
+    EXPECT_TRUE(layers[0].z.has_value());
+
+    writeLayer(writer, kLayer, kFrame);
+    EXPECT_TRUE(takeLayerCommands(writer).empty());
+}
+
+TEST(ComposerClientWriterTest, ChangedPropertiesAreSent) {
+    ComposerClientWriter writer(kDisplay, Mode::kIncremental);
+    writer.onLayerCreated(kLayer);
+    writeLayer(writer, kLayer, kFrame);
+    takeLayerCommands(writer);
+
+    writeLayer(writer, kLayer, kMovedFrame);
+    std::vector<LayerCommand> layers = takeLayerCommands(writer);
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_EQ(kMovedFrame, layers[0].displayFrame);
+    ASSERT_TRUE(layers[0].visibleRegion.has_value());
+    EXPECT_EQ(std::vector<std::optional<Rect>>({kMovedFrame}), *layers[0].visibleRegion);
+    EXPECT_FALSE(layers[0].composition.has_value());
+    EXPECT_FALSE(layers[0].z.has_value());
+
+    // Set back within a frame, the last value is the one sent
+    writer.setLayerDisplayFrame(kDisplay, kLayer, kFrame);
+    writer.setLayerDisplayFrame(kDisplay, kLayer, kMovedFrame);
+    layers = takeLayerCommands(writer);
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_EQ(kMovedFrame, layers[0].displayFrame);
+}
+
+TEST(ComposerClientWriterTest, ClearedCommandsAreNotSent) {
+    ComposerClientWriter writer(kDisplay, Mode::kIncremental);
+    writer.onLayerCreated(kLayer);
+    writeLayer(writer, kLayer, kFrame);
+    takeLayerCommands(writer);
+
+    // The commands are dropped before being taken, so the composer still has kFrame
+    writer.setLayerDisplayFrame(kDisplay, kLayer, kMovedFrame);
+    writer.clearPendingCommands();
+    writer.setLayerDisplayFrame(kDisplay, kLayer, kFrame);
+    EXPECT_TRUE(takeLayerCommands(writer).empty());
+
+    writer.setLayerDisplayFrame(kDisplay, kLayer, kMovedFrame);
+    std::vector<LayerCommand> layers = takeLayerCommands(writer);
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_EQ(kMovedFrame, layers[0].displayFrame);
+}
+
+TEST(ComposerClientWriterTest, UntrackedLayersSendEveryProperty) {
+    ComposerClientWriter writer(kDisplay, Mode::kIncremental);
+    // As a layer created with IComposerClient::createLayer without onLayerCreated
+    for (int frame = 0; frame < 2; frame++) {
+        writeLayer(writer, kLayer, kFrame);
+        std::vector<LayerCommand> layers = takeLayerCommands(writer);
+        ASSERT_EQ(1u, layers.size());
+        EXPECT_TRUE(layers[0].composition.has_value());
+        EXPECT_EQ(kFrame, layers[0].displayFrame);
+    }
+}
+
+TEST(ComposerClientWriterTest, ForgottenAndRecreatedLayersSendEveryProperty) {
+    ComposerClientWriter writer(kDisplay, Mode::kIncremental);
+    writer.onLayerCreated(kLayer);
+    writeLayer(writer, kLayer, kFrame);
+    takeLayerCommands(writer);
+
+    writer.forgetLayerState(kLayer);
+    writeLayer(writer, kLayer, kFrame);
+    EXPECT_EQ(1u, takeLayerCommands(writer).size());
+
+    // The id of the destroyed layer is reused by a new layer
+    writer.onLayerCreated(kLayer);
+    writeLayer(writer, kLayer, kFrame);
+    std::vector<LayerCommand> layers = takeLayerCommands(writer);
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_EQ(kFrame, layers[0].displayFrame);
+    writeLayer(writer, kLayer, kFrame);
+    EXPECT_TRUE(takeLayerCommands(writer).empty());
+
+    // A created layer starts from the default state even if the previous one was not forgotten
+    writer.onLayerCreated(kLayer);
+    writeLayer(writer, kLayer, kFrame);
+    EXPECT_EQ(1u, takeLayerCommands(writer).size());
+
+    // The same through the lifecycle of the layer
+    writer.setLayerLifecycleBatchCommandType(kDisplay, kLayer,
+                                             LayerLifecycleBatchCommandType::DESTROY);
+    takeLayerCommands(writer);
+    writer.setLayerLifecycleBatchCommandType(kDisplay, kLayer,
+                                             LayerLifecycleBatchCommandType::CREATE);
+    writeLayer(writer, kLayer, kFrame);
+    layers = takeLayerCommands(writer);
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_EQ(kFrame, layers[0].displayFrame);
+    writeLayer(writer, kLayer, kFrame);
+    EXPECT_TRUE(takeLayerCommands(writer).empty());
+}
+
+TEST(ComposerClientWriterTest, AcceptDisplayChangesDropsCompositionTypes) {
+    ComposerClientWriter writer(kDisplay, Mode::kIncremental);
+    writer.onLayerCreated(kLayer);
+    writeLayer(writer, kLayer, kFrame);
+    writer.validateDisplay(kDisplay, ComposerClientWriter::kNoTimestamp, 0);
+    takeLayerCommands(writer);
+
+    // The composer may have made the layer CLIENT
+    writer.acceptDisplayChanges(kDisplay);
+    takeLayerCommands(writer);
+
+    writeLayer(writer, kLayer, kFrame);
+    std::vector<LayerCommand> layers = takeLayerCommands(writer);
+    ASSERT_EQ(1u, layers.size());
+    ASSERT_TRUE(layers[0].composition.has_value());
+    EXPECT_EQ(Composition::DEVICE, layers[0].composition->composition);
+    EXPECT_FALSE(layers[0].displayFrame.has_value());
+    EXPECT_FALSE(layers[0].z.has_value());
+}
+
+TEST(ComposerClientWriterTest, ClearPendingCommandsReusesStorage) {
+    ComposerClientWriter writer(kDisplay, Mode::kFull);
+    const std::vector<Rect> damage = {kFrame, kMovedFrame};
+    auto writeFrame = [&] {
+        for (int64_t layer = 0; layer < 4; layer++) {
+            writer.setLayerSurfaceDamage(kDisplay, layer, damage);
+        }
+        writer.presentDisplay(kDisplay);
+    };
+
+    writeFrame();
+    const std::vector<DisplayCommand>* commands = &writer.getPendingCommands();
+    ASSERT_EQ(1u, commands->size());
+    ASSERT_EQ(4u, (*commands)[0].layers.size());
+    const LayerCommand* layers = (*commands)[0].layers.data();
+    std::vector<const std::optional<Rect>*> regions;
+    for (const LayerCommand& layer : (*commands)[0].layers) {
+        ASSERT_TRUE(layer.damage.has_value());
+        regions.push_back(layer.damage->data());
+    }
+    writer.clearPendingCommands();
+    EXPECT_TRUE(writer.getPendingCommands().empty());
+
+    writeFrame();
+    commands = &writer.getPendingCommands();
+    ASSERT_EQ(1u, commands->size());
+    ASSERT_EQ(4u, (*commands)[0].layers.size());
+    EXPECT_EQ(layers, (*commands)[0].layers.data());
+    for (const LayerCommand& layer : (*commands)[0].layers) {
+        ASSERT_TRUE(layer.damage.has_value());
+        EXPECT_EQ(damage.size(), layer.damage->size());
+        EXPECT_NE(regions.end(), std::find(regions.begin(), regions.end(), layer.damage->data()));
+    }
+}
+
+}  // namespace
+}  // namespace aidl::android::hardware::graphics::composer3
@@ -23,6 +23,8 @@
 #include <time.h>
 #include <unistd.h>
 #include <utils/Log.h>
+#include <algorithm>
+#include <chrono>
 #include <thread>
 
 #include "Accessor.h"
@@ -34,6 +36,8 @@ namespace aidl::android::hardware::media::bufferpool2::implementation {
 namespace {
     static constexpr nsecs_t kEvictGranularityNs = 1000000000; // 1 sec
     static constexpr nsecs_t kEvictDurationNs = 5000000000; // 5 secs
+    // Bounds a blocking wait for an invalidation, in case a wake is lost.
+    static constexpr nsecs_t kMaxInvalidationWaitNs = 1000000000; // 1 sec
 }
 
 #ifdef __ANDROID_VNDK__
@@ -338,24 +342,33 @@ void Accessor::handleInvalidateAck() {
     }
 }
 
+std::shared_ptr<BufferStatusReader> Accessor::getPendingInvalidationReader() {
+    std::lock_guard<std::mutex> lock(mBufferPool.mMutex);
+    return mBufferPool.getPendingInvalidationReader();
+}
+
 void Accessor::invalidatorThread(
             std::map<uint32_t, const std::weak_ptr<Accessor>> &accessors,
             std::mutex &mutex,
             std::condition_variable &cv,
-            bool &ready) {
-    constexpr uint32_t NUM_SPIN_TO_INCREASE_SLEEP = 1024;
-    constexpr uint32_t NUM_SPIN_TO_LOG = 1024*8;
-    constexpr useconds_t MAX_SLEEP_US = 10000;
-    uint32_t numSpin = 0;
-    useconds_t sleepUs = 1;
+            bool &ready,
+            uint64_t &addCount,
+            std::shared_ptr<BufferStatusReader> &waitingReader,
+            std::atomic<uint64_t> &wakeups) {
+    constexpr uint32_t NUM_POLL_TO_INCREASE_WAIT = 1024;
+    constexpr uint32_t NUM_POLL_TO_LOG = 1024*8;
+    constexpr nsecs_t MIN_POLL_NS = 1000;
+    constexpr nsecs_t MAX_POLL_NS = 10000000;
+    uint32_t numPoll = 0;
+    nsecs_t pollNs = MIN_POLL_NS;
 
     while(true) {
         std::map<uint32_t, const std::weak_ptr<Accessor>> copied;
         {
             std::unique_lock<std::mutex> lock(mutex);
             while (!ready) {
-                numSpin = 0;
-                sleepUs = 1;
+                numPoll = 0;
+                pollNs = MIN_POLL_NS;
                 cv.wait(lock);
             }
             copied.insert(accessors.begin(), accessors.end());
@@ -369,6 +382,9 @@ void Accessor::invalidatorThread(
                 acc->handleInvalidateAck();
             }
         }
+        std::shared_ptr<Accessor> pending;
+        bool onlyPending;
+        uint64_t seenAddCount;
         {
             std::unique_lock<std::mutex> lock(mutex);
             for (auto it = erased.begin(); it != erased.end(); ++it) {
@@ -376,32 +392,65 @@ void Accessor::invalidatorThread(
             }
             if (accessors.size() == 0) {
                 ready = false;
-            } else {
-                // N.B. Since there is not a efficient way to wait over FMQ,
-                // polling over the FMQ is the current way to prevent draining
-                // CPU.
+                continue;
+            }
+            pending = accessors.begin()->second.lock();
+            onlyPending = accessors.size() == 1;
+            seenAddCount = addCount;
+        }
+        // Block until the pending invalidation can make progress. Only the FMQ
+        // of one connection can be waited on, so this blocks only while a
+        // single buffer pool has pending invalidations; addAccessor() wakes the
+        // wait when another invalidation comes in. With several pending buffer
+        // pools, and for clients of older versions which do not wake the
+        // buffer pool, the FMQs are polled with a growing wait to prevent
+        // draining CPU.
+        const std::shared_ptr<BufferStatusReader> reader =
+                pending ? pending->getPendingInvalidationReader() : nullptr;
+        bool progressed = false;
+        if (!reader) {
+            // The buffers are released without a status message, e.g. on close.
+            ::usleep(pollNs / 1000);
+        } else if (onlyPending && reader->clientWakes()) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (addCount == seenAddCount) {
+                waitingReader = reader;
                 lock.unlock();
-                ++numSpin;
-                if (numSpin % NUM_SPIN_TO_INCREASE_SLEEP == 0 &&
-                    sleepUs < MAX_SLEEP_US) {
-                    sleepUs *= 10;
-                }
-                if (numSpin % NUM_SPIN_TO_LOG == 0) {
-                    ALOGW("invalidator thread spinning");
-                }
-                ::usleep(sleepUs);
+                reader->wait(kMaxInvalidationWaitNs);
+                lock.lock();
+                waitingReader.reset();
             }
+            progressed = true;
+        } else {
+            progressed = reader->wait(pollNs);
         }
+        if (progressed) {
+            numPoll = 0;
+            pollNs = MIN_POLL_NS;
+        } else {
+            ++numPoll;
+            if (numPoll % NUM_POLL_TO_INCREASE_WAIT == 0 && pollNs < MAX_POLL_NS) {
+                pollNs *= 10;
+            }
+            if (numPoll % NUM_POLL_TO_LOG == 0) {
+                ALOGW("invalidator thread polling");
+            }
+        }
+        ++wakeups;
     }
 }
 
-Accessor::AccessorInvalidator::AccessorInvalidator() : mReady(false) {
+Accessor::AccessorInvalidator::AccessorInvalidator()
+        : mReady(false), mAddCount(0), mWakeups(0), mCreatedNs(systemTime()) {
     std::thread invalidator(
             invalidatorThread,
             std::ref(mAccessors),
             std::ref(mMutex),
             std::ref(mCv),
-            std::ref(mReady));
+            std::ref(mReady),
+            std::ref(mAddCount),
+            std::ref(mWaitingReader),
+            std::ref(mWakeups));
     invalidator.detach();
 }
 
@@ -417,10 +466,17 @@ void Accessor::AccessorInvalidator::addAccessor(
         mAccessors.emplace(accessorId, accessor);
         ALOGV("buffer invalidation added bp:%u %d", accessorId, notify);
     }
+    // The invalidator thread may be blocked on the FMQ of another pending
+    // invalidation, wake it to look at this one as well.
+    ++mAddCount;
+    const std::shared_ptr<BufferStatusReader> waiting = mWaitingReader;
     lock.unlock();
     if (notify) {
         mCv.notify_one();
     }
+    if (waiting) {
+        waiting->wake();
+    }
 }
 
 void Accessor::AccessorInvalidator::delAccessor(uint32_t accessorId) {
@@ -443,24 +499,30 @@ void Accessor::createInvalidator() {
 void Accessor::evictorThread(
         std::map<const std::weak_ptr<Accessor>, nsecs_t, std::owner_less<>> &accessors,
         std::mutex &mutex,
-        std::condition_variable &cv) {
+        std::condition_variable &cv,
+        std::atomic<uint64_t> &wakeups) {
     std::list<std::weak_ptr<Accessor>> evictList;
     while (true) {
         int expired = 0;
         int evicted = 0;
+        nsecs_t nextEvictNs = 0;
         {
-            nsecs_t now = systemTime();
             std::unique_lock<std::mutex> lock(mutex);
             while (accessors.size() == 0) {
                 cv.wait(lock);
             }
+            nsecs_t now = systemTime();
             auto it = accessors.begin();
             while (it != accessors.end()) {
-                if (now > (it->second + kEvictDurationNs)) {
+                nsecs_t evictNs = it->second + kEvictDurationNs;
+                if (now > evictNs) {
                     ++expired;
                     evictList.push_back(it->first);
                     it = accessors.erase(it);
                 } else {
+                    if (nextEvictNs == 0 || evictNs < nextEvictNs) {
+                        nextEvictNs = evictNs;
+                    }
                     ++it;
                 }
             }
@@ -477,16 +539,25 @@ void Accessor::evictorThread(
             ALOGD("evictor expired: %d, evicted: %d", expired, evicted);
         }
         evictList.clear();
-        ::usleep(kEvictGranularityNs / 1000);
+        if (nextEvictNs != 0) {
+            // Sleep until the earliest accessor expires. Accessors in use push
+            // their expiry later, which only makes this wakeup find nothing to
+            // evict.
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait_for(lock, std::chrono::nanoseconds(
+                    std::max(nextEvictNs - systemTime(), kEvictGranularityNs)));
+        }
+        ++wakeups;
     }
 }
 
-Accessor::AccessorEvictor::AccessorEvictor() {
+Accessor::AccessorEvictor::AccessorEvictor() : mWakeups(0), mCreatedNs(systemTime()) {
     std::thread evictor(
             evictorThread,
             std::ref(mAccessors),
             std::ref(mMutex),
-            std::ref(mCv));
+            std::ref(mCv),
+            std::ref(mWakeups));
     evictor.detach();
 }
 
@@ -513,6 +584,22 @@ void Accessor::createEvictor() {
     }
 }
 
+Accessor::WakeupStats Accessor::getWakeupStats() {
+    WakeupStats stats = {};
+    nsecs_t now = systemTime();
+    nsecs_t createdNs = now;
+    if (sInvalidator) {
+        stats.mInvalidatorWakeups = sInvalidator->mWakeups;
+        createdNs = std::min(createdNs, sInvalidator->mCreatedNs);
+    }
+    if (sEvictor) {
+        stats.mEvictorWakeups = sEvictor->mWakeups;
+        createdNs = std::min(createdNs, sEvictor->mCreatedNs);
+    }
+    stats.mElapsedNs = now - createdNs;
+    return stats;
+}
+
 void Accessor::scheduleEvictIfNeeded() {
     nsecs_t now = systemTime();
 
@@ -20,6 +20,7 @@
 #include <aidl/android/hardware/media/bufferpool2/IObserver.h>
 #include <bufferpool2/BufferPoolTypes.h>
 
+#include <atomic>
 #include <memory>
 #include <map>
 #include <set>
@@ -177,6 +178,32 @@ struct Accessor : public BnAccessor {
      */
     void handleInvalidateAck();
 
+    /**
+     * Returns the buffer status message FMQ of a connection which holds a
+     * buffer of a pending invalidation, nullptr if there is no such
+     * connection. The pending invalidation cannot finish until the connection
+     * posts buffer status messages.
+     */
+    std::shared_ptr<BufferStatusReader> getPendingInvalidationReader();
+
+    /** Wakeup counters of the invalidator and evictor threads. */
+    struct WakeupStats {
+        nsecs_t mElapsedNs;
+        uint64_t mInvalidatorWakeups;
+        uint64_t mEvictorWakeups;
+
+        double invalidatorWakeupsPerSec() const {
+            return mElapsedNs > 0 ? mInvalidatorWakeups * 1e9 / mElapsedNs : 0.;
+        }
+
+        double evictorWakeupsPerSec() const {
+            return mElapsedNs > 0 ? mEvictorWakeups * 1e9 / mElapsedNs : 0.;
+        }
+    };
+
+    /** Returns the wakeups of the invalidator and evictor threads so far. */
+    static WakeupStats getWakeupStats();
+
     /**
      * Gets a death_recipient for remote connection death.
      */
@@ -207,6 +234,13 @@ private:
         std::mutex mMutex;
         std::condition_variable mCv;
         bool mReady;
+        // Counts addAccessor() calls, so that the invalidator thread does not
+        // block when an invalidation came in after it picked the FMQ to wait on.
+        uint64_t mAddCount;
+        // The FMQ the invalidator thread is blocked on, woken by addAccessor().
+        std::shared_ptr<BufferStatusReader> mWaitingReader;
+        std::atomic<uint64_t> mWakeups;
+        const nsecs_t mCreatedNs;
 
         AccessorInvalidator();
         void addAccessor(uint32_t accessorId, const std::weak_ptr<Accessor> &accessor);
@@ -219,12 +253,17 @@ private:
         std::map<uint32_t, const std::weak_ptr<Accessor>> &accessors,
         std::mutex &mutex,
         std::condition_variable &cv,
-        bool &ready);
+        bool &ready,
+        uint64_t &addCount,
+        std::shared_ptr<BufferStatusReader> &waitingReader,
+        std::atomic<uint64_t> &wakeups);
 
     struct AccessorEvictor {
         std::map<const std::weak_ptr<Accessor>, nsecs_t, std::owner_less<>> mAccessors;
         std::mutex mMutex;
         std::condition_variable mCv;
+        std::atomic<uint64_t> mWakeups;
+        const nsecs_t mCreatedNs;
 
         AccessorEvictor();
         void addAccessor(const std::weak_ptr<Accessor> &accessor, nsecs_t ts);
@@ -235,7 +274,8 @@ private:
     static void evictorThread(
         std::map<const std::weak_ptr<Accessor>, nsecs_t, std::owner_less<>> &accessors,
         std::mutex &mutex,
-        std::condition_variable &cv);
+        std::condition_variable &cv,
+        std::atomic<uint64_t> &wakeups);
 
     void scheduleEvictIfNeeded();
 
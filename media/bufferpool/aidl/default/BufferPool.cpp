@@ -22,6 +22,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <utils/Log.h>
+#include <algorithm>
 #include <thread>
 #include "Accessor.h"
 #include "BufferPool.h"
@@ -63,12 +64,18 @@ BufferPool::~BufferPool() {
     ALOGD("Destruction - bufferpool2 %p "
           "cached: %zu/%zuM, %zu/%d%% in use; "
           "allocs: %zu, %d%% recycled; "
-          "transfers: %zu, %d%% unfetched",
+          "transfers: %zu, %d%% unfetched; "
+          "invalidations: %zu, latency %lld/%lld us (avg/max)",
           this, mStats.mBuffersCached, mStats.mSizeCached >> 20,
           mStats.mBuffersInUse, percentage(mStats.mBuffersInUse, mStats.mBuffersCached),
           mStats.mTotalAllocations, percentage(mStats.mTotalRecycles, mStats.mTotalAllocations),
           mStats.mTotalTransfers,
-          percentage(mStats.mTotalTransfers - mStats.mTotalFetches, mStats.mTotalTransfers));
+          percentage(mStats.mTotalTransfers - mStats.mTotalFetches, mStats.mTotalTransfers),
+          mInvalidation.mPostedCount,
+          mInvalidation.mPostedCount
+                  ? (long long)(mInvalidation.mTotalLatencyNs / mInvalidation.mPostedCount / 1000)
+                  : 0LL,
+          (long long)(mInvalidation.mMaxLatencyNs / 1000));
 }
 
 void BufferPool::Invalidation::onConnect(
@@ -95,6 +102,13 @@ void BufferPool::Invalidation::onAck(
     }
 }
 
+void BufferPool::Invalidation::onPosted(nsecs_t requestedNs) {
+    nsecs_t latencyNs = systemTime() - requestedNs;
+    ++mPostedCount;
+    mTotalLatencyNs += latencyNs;
+    mMaxLatencyNs = std::max(mMaxLatencyNs, latencyNs);
+}
+
 void BufferPool::Invalidation::onBufferInvalidated(
         BufferId bufferId,
         BufferInvalidationChannel &channel) {
@@ -109,6 +123,7 @@ void BufferPool::Invalidation::onBufferInvalidated(
                 msgId = ++mInvalidationId;
             }
             channel.postInvalidation(msgId, it->mFrom, it->mTo);
+            onPosted(it->mRequestedNs);
             it = mPendings.erase(it);
             continue;
         }
@@ -134,6 +149,7 @@ void BufferPool::Invalidation::onInvalidationRequest(
     ALOGV("bufferpool2 invalidation requested and queued");
     if (left == 0) {
         channel.postInvalidation(msgId, from, to);
+        onPosted(systemTime());
     } else {
         ALOGV("bufferpoo2 invalidation requested and pending");
         Pending pending(needsAck, from, to, left, impl);
@@ -198,7 +214,7 @@ bool BufferPool::handleReleaseBuffer(
                 iter->second->mTransactionCount == 0) {
             if (!iter->second->mInvalidated) {
                 mStats.onBufferUnused(iter->second->mAllocSize);
-                mFreeBuffers.insert(bufferId);
+                mFreeBuffers.insert(iter->second.get());
             } else {
                 mStats.onBufferUnused(iter->second->mAllocSize);
                 mStats.onBufferEvicted(iter->second->mAllocSize);
@@ -287,7 +303,7 @@ bool BufferPool::handleTransferResult(const BufferStatusMessage &message) {
                 && bufferIter->second->mTransactionCount == 0) {
                 if (!bufferIter->second->mInvalidated) {
                     mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                    mFreeBuffers.insert(message.bufferId);
+                    mFreeBuffers.insert(bufferIter->second.get());
                 } else {
                     mStats.onBufferUnused(bufferIter->second->mAllocSize);
                     mStats.onBufferEvicted(bufferIter->second->mAllocSize);
@@ -366,7 +382,7 @@ bool BufferPool::handleClose(ConnectionId connectionId) {
                     // TODO: handle freebuffer insert fail
                     if (!bufferIter->second->mInvalidated) {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                        mFreeBuffers.insert(bufferId);
+                        mFreeBuffers.insert(bufferIter->second.get());
                     } else {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
                         mStats.onBufferEvicted(bufferIter->second->mAllocSize);
@@ -396,7 +412,7 @@ bool BufferPool::handleClose(ConnectionId connectionId) {
                     // TODO: handle freebuffer insert fail
                     if (!bufferIter->second->mInvalidated) {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                        mFreeBuffers.insert(bufferId);
+                        mFreeBuffers.insert(bufferIter->second.get());
                     } else {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
                         mStats.onBufferEvicted(bufferIter->second->mAllocSize);
@@ -416,20 +432,15 @@ bool BufferPool::getFreeBuffer(
         const std::shared_ptr<BufferPoolAllocator> &allocator,
         const std::vector<uint8_t> &params, BufferId *pId,
         const native_handle_t** handle) {
-    auto bufferIt = mFreeBuffers.begin();
-    for (;bufferIt != mFreeBuffers.end(); ++bufferIt) {
-        BufferId bufferId = *bufferIt;
-        if (allocator->compatible(params, mBuffers[bufferId]->mConfig)) {
-            break;
-        }
-    }
-    if (bufferIt != mFreeBuffers.end()) {
-        BufferId id = *bufferIt;
-        mFreeBuffers.erase(bufferIt);
-        mStats.onBufferRecycled(mBuffers[id]->mAllocSize);
-        *handle = mBuffers[id]->handle();
-        *pId = id;
-        ALOGV("recycle a buffer %u %p", id, *handle);
+    InternalBuffer *buffer = mFreeBuffers.take(
+            params, [&allocator, &params](const std::vector<uint8_t> &config) {
+                return allocator->compatible(params, config);
+            });
+    if (buffer) {
+        mStats.onBufferRecycled(buffer->mAllocSize);
+        *handle = buffer->handle();
+        *pId = buffer->mId;
+        ALOGV("recycle a buffer %u %p", buffer->mId, *handle);
         return true;
     }
     return false;
@@ -477,44 +488,56 @@ void BufferPool::cleanUp(bool clearCache) {
                   mStats.mTotalRecycles, mStats.mTotalAllocations,
                   mStats.mTotalFetches, mStats.mTotalTransfers);
         }
-        for (auto freeIt = mFreeBuffers.begin(); freeIt != mFreeBuffers.end();) {
+        mFreeBuffers.removeIf([this, clearCache](InternalBuffer *buffer) {
             if (!clearCache && mStats.buffersNotInUse() <= kUnusedBufferCountTarget &&
                     (mStats.mSizeCached < kMinAllocBytesForEviction ||
                      mBuffers.size() < kMinBufferCountForEviction)) {
-                break;
+                return false;
             }
-            auto it = mBuffers.find(*freeIt);
-            if (it != mBuffers.end() &&
-                    it->second->mOwnerCount == 0 && it->second->mTransactionCount == 0) {
-                mStats.onBufferEvicted(it->second->mAllocSize);
-                mBuffers.erase(it);
-                freeIt = mFreeBuffers.erase(freeIt);
-            } else {
-                ++freeIt;
-                ALOGW("bufferpool2 inconsistent!");
+            if (buffer->mOwnerCount == 0 && buffer->mTransactionCount == 0) {
+                const BufferId bufferId = buffer->mId;
+                mStats.onBufferEvicted(buffer->mAllocSize);
+                mBuffers.erase(bufferId);
+                return true;
+            }
+            ALOGW("bufferpool2 inconsistent!");
+            return false;
+        });
+    }
+}
+
+std::shared_ptr<BufferStatusReader> BufferPool::getPendingInvalidationReader() {
+    for (auto it = mInvalidation.mPendings.begin(); it != mInvalidation.mPendings.end(); ++it) {
+        for (auto conIt = mUsingConnections.begin(); conIt != mUsingConnections.end(); ++conIt) {
+            if (!conIt->second.empty() && isBufferInRange(it->mFrom, it->mTo, conIt->first)) {
+                return mObserver.getReader(*conIt->second.begin());
+            }
+        }
+        for (auto txIt = mTransactions.begin(); txIt != mTransactions.end(); ++txIt) {
+            if (isBufferInRange(it->mFrom, it->mTo, txIt->second->mBufferId)) {
+                return mObserver.getReader(txIt->second->mReceiver);
             }
         }
     }
+    return nullptr;
 }
 
 void BufferPool::invalidate(
         bool needsAck, BufferId from, BufferId to,
         const std::shared_ptr<Accessor> &impl) {
-    for (auto freeIt = mFreeBuffers.begin(); freeIt != mFreeBuffers.end();) {
-        if (isBufferInRange(from, to, *freeIt)) {
-            auto it = mBuffers.find(*freeIt);
-            if (it != mBuffers.end() &&
-                it->second->mOwnerCount == 0 && it->second->mTransactionCount == 0) {
-                mStats.onBufferEvicted(it->second->mAllocSize);
-                mBuffers.erase(it);
-                freeIt = mFreeBuffers.erase(freeIt);
-                continue;
-            } else {
-                ALOGW("bufferpool2 inconsistent!");
-            }
+    mFreeBuffers.removeIf([this, from, to](InternalBuffer *buffer) {
+        if (!isBufferInRange(from, to, buffer->mId)) {
+            return false;
         }
-        ++freeIt;
-    }
+        if (buffer->mOwnerCount == 0 && buffer->mTransactionCount == 0) {
+            const BufferId bufferId = buffer->mId;
+            mStats.onBufferEvicted(buffer->mAllocSize);
+            mBuffers.erase(bufferId);
+            return true;
+        }
+        ALOGW("bufferpool2 inconsistent!");
+        return false;
+    });
 
     size_t left = 0;
     for (auto it = mBuffers.begin(); it != mBuffers.end(); ++it) {
@@ -18,12 +18,15 @@
 
 #include <map>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <utils/Timers.h>
 
 #include "BufferStatus.h"
+#include "DataHelper.h"
 
 namespace aidl::android::hardware::media::bufferpool2::implementation {
 
@@ -31,8 +34,6 @@ using BufferStatus = aidl::android::hardware::media::bufferpool2::BufferStatus;
 using BufferStatusMessage = aidl::android::hardware::media::bufferpool2::BufferStatusMessage;
 
 struct Accessor;
-struct InternalBuffer;
-struct TransactionStatus;
 
 /**
  * Buffer pool implementation.
@@ -52,21 +53,22 @@ private:
     BufferStatusObserver mObserver;
     BufferInvalidationChannel mInvalidationChannel;
 
-    std::map<ConnectionId, std::set<BufferId>> mUsingBuffers;
-    std::map<BufferId, std::set<ConnectionId>> mUsingConnections;
+    std::unordered_map<ConnectionId, std::unordered_set<BufferId>> mUsingBuffers;
+    std::unordered_map<BufferId, std::unordered_set<ConnectionId>> mUsingConnections;
 
-    std::map<ConnectionId, std::set<TransactionId>> mPendingTransactions;
+    std::unordered_map<ConnectionId, std::unordered_set<TransactionId>> mPendingTransactions;
     // Transactions completed before TRANSFER_TO message arrival.
     // Fetch does not occur for the transactions.
     // Only transaction id is kept for the transactions in short duration.
-    std::set<TransactionId> mCompletedTransactions;
+    std::unordered_set<TransactionId> mCompletedTransactions;
     // Currently active(pending) transations' status & information.
-    std::map<TransactionId, std::unique_ptr<TransactionStatus>>
+    std::unordered_map<TransactionId, std::unique_ptr<TransactionStatus>>
             mTransactions;
 
-    std::map<BufferId, std::unique_ptr<InternalBuffer>> mBuffers;
-    std::set<BufferId> mFreeBuffers;
-    std::set<ConnectionId> mConnectionIds;
+    std::unordered_map<BufferId, std::unique_ptr<InternalBuffer>> mBuffers;
+    // Buffers not owned by any connection nor in a transaction, bucketed by config.
+    FreeBufferList mFreeBuffers;
+    std::unordered_set<ConnectionId> mConnectionIds;
 
     struct Invalidation {
         static std::atomic<std::uint32_t> sInvSeqId;
@@ -77,13 +79,15 @@ private:
             uint32_t mTo;
             size_t mLeft;
             const std::weak_ptr<Accessor> mImpl;
+            const nsecs_t mRequestedNs;
             Pending(bool needsAck, uint32_t from, uint32_t to, size_t left,
                     const std::shared_ptr<Accessor> &impl)
                     : mNeedsAck(needsAck),
                       mFrom(from),
                       mTo(to),
                       mLeft(left),
-                      mImpl(impl)
+                      mImpl(impl),
+                      mRequestedNs(systemTime())
             {}
 
             bool isInvalidated(uint32_t bufferId) {
@@ -97,7 +101,16 @@ private:
         uint32_t mInvalidationId;
         uint32_t mId;
 
-        Invalidation() : mInvalidationId(0), mId(sInvSeqId.fetch_add(1)) {}
+        // Latency from an invalidation request to posting it to the clients.
+        size_t mPostedCount;
+        nsecs_t mTotalLatencyNs;
+        nsecs_t mMaxLatencyNs;
+
+        Invalidation()
+                : mInvalidationId(0), mId(sInvSeqId.fetch_add(1)),
+                  mPostedCount(0), mTotalLatencyNs(0), mMaxLatencyNs(0) {}
+
+        void onPosted(nsecs_t requestedNs);
 
         void onConnect(ConnectionId conId, const std::shared_ptr<IObserver> &observer);
 
@@ -202,6 +215,14 @@ private:
 
     static void createInvalidator();
 
+    /**
+     * Returns the buffer status message FMQ of a connection which holds a
+     * buffer of a pending invalidation, nullptr if there is none. The
+     * invalidation can not finish before the connection posts a buffer status
+     * message, so it is the FMQ to wait on.
+     */
+    std::shared_ptr<BufferStatusReader> getPendingInvalidationReader();
+
 public:
     /** Creates a buffer pool. */
     BufferPool();
@@ -17,6 +17,7 @@
 #define LOG_TAG "AidlBufferPoolStatus"
 //#define LOG_NDEBUG 0
 
+#include <chrono>
 #include <thread>
 #include <time.h>
 #include <aidl/android/hardware/media/bufferpool2/BufferStatus.h>
@@ -50,19 +51,61 @@ bool isBufferInRange(BufferId from, BufferId to, BufferId bufferId) {
 static constexpr int kNumElementsInQueue = 1024*16;
 static constexpr int kMinElementsToSyncInQueue = 128;
 
+// Event flag bits of a buffer status message FMQ.
+static constexpr uint32_t kBufferStatusPosted = 1 << 0;
+static constexpr uint32_t kBufferStatusClosed = 1 << 1;
+
+BufferStatusReader::BufferStatusReader(std::unique_ptr<BufferStatusQueue> queue)
+    : mBufferStatusQueue(std::move(queue)), mEventFlag(nullptr), mClientWakes(false) {
+    if (::android::hardware::EventFlag::createEventFlag(
+            mBufferStatusQueue->getEventFlagWord(), &mEventFlag) != ::android::OK) {
+        ALOGW("buffer status FMQ event flag cannot be created");
+        mEventFlag = nullptr;
+    }
+}
+
+BufferStatusReader::~BufferStatusReader() {
+    if (mEventFlag) {
+        ::android::hardware::EventFlag::deleteEventFlag(&mEventFlag);
+    }
+}
+
+bool BufferStatusReader::wait(nsecs_t timeoutNs) {
+    if (!mEventFlag) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(timeoutNs));
+        return false;
+    }
+    uint32_t state = 0;
+    ::android::status_t status = mEventFlag->wait(
+            kBufferStatusPosted | kBufferStatusClosed, &state, timeoutNs, true /* retry */);
+    if (status != ::android::OK) {
+        return false;
+    }
+    if (state & kBufferStatusPosted) {
+        mClientWakes = true;
+    }
+    return true;
+}
+
+void BufferStatusReader::wake() {
+    if (mEventFlag) {
+        mEventFlag->wake(kBufferStatusClosed);
+    }
+}
+
 BufferPoolStatus BufferStatusObserver::open(
         ConnectionId id, StatusDescriptor* fmqDescPtr) {
     if (mBufferStatusQueues.find(id) != mBufferStatusQueues.end()) {
         ALOGE("connection id collision %lld", (unsigned long long)id);
         return ResultStatus::CRITICAL_ERROR;
     }
-    auto queue = std::make_unique<BufferStatusQueue>(kNumElementsInQueue);
+    auto queue = std::make_unique<BufferStatusQueue>(kNumElementsInQueue, true);
     if (!queue || queue->isValid() == false) {
         return ResultStatus::NO_MEMORY;
     }
     *fmqDescPtr = queue->dupeDesc();
     auto result = mBufferStatusQueues.insert(
-            std::make_pair(id, std::move(queue)));
+            std::make_pair(id, std::make_shared<BufferStatusReader>(std::move(queue))));
     if (!result.second) {
         return ResultStatus::NO_MEMORY;
     }
@@ -70,19 +113,30 @@ BufferPoolStatus BufferStatusObserver::open(
 }
 
 BufferPoolStatus BufferStatusObserver::close(ConnectionId id) {
-    if (mBufferStatusQueues.find(id) == mBufferStatusQueues.end()) {
+    auto it = mBufferStatusQueues.find(id);
+    if (it == mBufferStatusQueues.end()) {
         return ResultStatus::CRITICAL_ERROR;
     }
-    mBufferStatusQueues.erase(id);
+    it->second->wake();
+    mBufferStatusQueues.erase(it);
     return ResultStatus::OK;
 }
 
+std::shared_ptr<BufferStatusReader> BufferStatusObserver::getReader(ConnectionId id) {
+    auto it = mBufferStatusQueues.find(id);
+    if (it == mBufferStatusQueues.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
 void BufferStatusObserver::getBufferStatusChanges(std::vector<BufferStatusMessage> &messages) {
     for (auto it = mBufferStatusQueues.begin(); it != mBufferStatusQueues.end(); ++it) {
         BufferStatusMessage message;
-        size_t avail = it->second->availableToRead();
+        BufferStatusQueue *queue = it->second->queue();
+        size_t avail = queue->availableToRead();
         while (avail > 0) {
-            if (!it->second->read(&message, 1)) {
+            if (!queue->read(&message, 1)) {
                 // Since available # of reads are already confirmed,
                 // this should not happen.
                 // TODO: error handling (spurious client?)
@@ -97,7 +151,7 @@ void BufferStatusObserver::getBufferStatusChanges(std::vector<BufferStatusMessag
 }
 
 BufferStatusChannel::BufferStatusChannel(
-        const StatusDescriptor &fmqDesc) {
+        const StatusDescriptor &fmqDesc) : mEventFlag(nullptr) {
     auto queue = std::make_unique<BufferStatusQueue>(fmqDesc);
     if (!queue || queue->isValid() == false) {
         mValid = false;
@@ -105,6 +159,26 @@ BufferStatusChannel::BufferStatusChannel(
     }
     mValid  = true;
     mBufferStatusQueue = std::move(queue);
+    // Buffer pools of older versions create the FMQ without an event flag, and
+    // poll the FMQ instead.
+    if (mBufferStatusQueue->getEventFlagWord() &&
+            ::android::hardware::EventFlag::createEventFlag(
+                    mBufferStatusQueue->getEventFlagWord(), &mEventFlag) != ::android::OK) {
+        mEventFlag = nullptr;
+    }
+}
+
+BufferStatusChannel::~BufferStatusChannel() {
+    if (mEventFlag) {
+        ::android::hardware::EventFlag::deleteEventFlag(&mEventFlag);
+    }
+}
+
+void BufferStatusChannel::notifyPosted() {
+    // This only costs an atomic or while the buffer pool is not waiting.
+    if (mEventFlag) {
+        mEventFlag->wake(kBufferStatusPosted);
+    }
 }
 
 bool BufferStatusChannel::isValid() {
@@ -141,6 +215,9 @@ void BufferStatusChannel::postBufferRelease(
             pending.pop_front();
             posted.push_back(id);
         }
+        if (avail > 0) {
+            notifyPosted();
+        }
     }
 }
 
@@ -162,6 +239,7 @@ void BufferStatusChannel::postBufferInvalidateAck(
                 ALOGW("FMQ message cannot be sent from %lld", (long long)connectionId);
                 return;
             }
+            notifyPosted();
             *invalidated = true;
         }
     }
@@ -204,6 +282,7 @@ bool BufferStatusChannel::postBufferStatusMessage(
                 ALOGW("FMQ message cannot be sent from %lld", (long long)connectionId);
                 return false;
             }
+            notifyPosted();
             return true;
         }
     }
@@ -17,6 +17,9 @@
 #pragma once
 
 #include <bufferpool2/BufferPoolTypes.h>
+#include <fmq/EventFlag.h>
+#include <utils/Timers.h>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -29,13 +32,48 @@ bool isMessageLater(uint32_t curMsgId, uint32_t prevMsgId);
 
 bool isBufferInRange(BufferId from, BufferId to, BufferId bufferId);
 
+/**
+ * The buffer pool end of a buffer status message FMQ. The client wakes the
+ * event flag of the FMQ after posting messages, so the buffer pool can block
+ * until there are messages instead of polling the FMQ.
+ */
+class BufferStatusReader {
+private:
+    std::unique_ptr<BufferStatusQueue> mBufferStatusQueue;
+    ::android::hardware::EventFlag *mEventFlag;
+    // Clients of older buffer pool versions post messages without waking the
+    // event flag. Set once the client is seen waking it.
+    std::atomic<bool> mClientWakes;
+
+public:
+    BufferStatusReader(std::unique_ptr<BufferStatusQueue> queue);
+
+    ~BufferStatusReader();
+
+    BufferStatusQueue *queue() { return mBufferStatusQueue.get(); }
+
+    /** Returns whether the client wakes the buffer pool after posting messages. */
+    bool clientWakes() const { return mClientWakes; }
+
+    /**
+     * Blocks until the client posts buffer status messages, wake() is called
+     * or timeoutNs passes.
+     *
+     * @return {@code true} when woken, {@code false} otherwise.
+     */
+    bool wait(nsecs_t timeoutNs);
+
+    /** Wakes the thread blocked in wait(), e.g. when the connection is closed. */
+    void wake();
+};
+
 /**
  * A collection of buffer status message FMQ for a buffer pool. buffer
  * ownership/status change messages are sent via the FMQs from the clients.
  */
 class BufferStatusObserver {
 private:
-    std::map<ConnectionId, std::unique_ptr<BufferStatusQueue>>
+    std::map<ConnectionId, std::shared_ptr<BufferStatusReader>>
             mBufferStatusQueues;
 
 public:
@@ -66,6 +104,14 @@ public:
      * @param messages  retrieved pending messages.
      */
     void getBufferStatusChanges(std::vector<BufferStatusMessage> &messages);
+
+    /** Returns the buffer status message FMQ of the specified connection,
+     * nullptr if there is no such connection. The FMQ can be waited on without
+     * holding the buffer pool lock.
+     *
+     * @param connectionId  connection Id of the specified client.
+     */
+    std::shared_ptr<BufferStatusReader> getReader(ConnectionId id);
 };
 
 /**
@@ -76,6 +122,10 @@ class BufferStatusChannel {
 private:
     bool mValid;
     std::unique_ptr<BufferStatusQueue> mBufferStatusQueue;
+    // nullptr when the buffer pool did not create the FMQ with an event flag.
+    ::android::hardware::EventFlag *mEventFlag;
+
+    void notifyPosted();
 
 public:
     /**
@@ -86,6 +136,8 @@ public:
      */
     BufferStatusChannel(const StatusDescriptor &fmqDesc);
 
+    ~BufferStatusChannel();
+
     /** Returns whether the FMQ is connected successfully. */
     bool isValid();
 
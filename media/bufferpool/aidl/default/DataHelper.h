@@ -19,18 +19,25 @@
 #include <aidl/android/hardware/media/bufferpool2/BufferStatusMessage.h>
 #include <bufferpool2/BufferPoolTypes.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
 #include <map>
 #include <set>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace aidl::android::hardware::media::bufferpool2::implementation {
 
 // Helper template methods for handling map of set.
-template<class T, class U>
-bool insert(std::map<T, std::set<U>> *mapOfSet, T key, U value) {
+template<class M, class T, class U>
+bool insert(M *mapOfSet, T key, U value) {
     auto iter = mapOfSet->find(key);
     if (iter == mapOfSet->end()) {
-        std::set<U> valueSet{value};
-        mapOfSet->insert(std::make_pair(key, valueSet));
+        typename M::mapped_type valueSet{value};
+        mapOfSet->insert(std::make_pair(key, std::move(valueSet)));
         return true;
     } else if (iter->second.find(value)  == iter->second.end()) {
         iter->second.insert(value);
@@ -40,8 +47,8 @@ bool insert(std::map<T, std::set<U>> *mapOfSet, T key, U value) {
 }
 
 // Helper template methods for handling map of set.
-template<class T, class U>
-bool erase(std::map<T, std::set<U>> *mapOfSet, T key, U value) {
+template<class M, class T, class U>
+bool erase(M *mapOfSet, T key, U value) {
     bool ret = false;
     auto iter = mapOfSet->find(key);
     if (iter != mapOfSet->end()) {
@@ -56,8 +63,8 @@ bool erase(std::map<T, std::set<U>> *mapOfSet, T key, U value) {
 }
 
 // Helper template methods for handling map of set.
-template<class T, class U>
-bool contains(std::map<T, std::set<U>> *mapOfSet, T key, U value) {
+template<class M, class T, class U>
+bool contains(M *mapOfSet, T key, U value) {
     auto iter = mapOfSet->find(key);
     if (iter != mapOfSet->end()) {
         auto setIter = iter->second.find(value);
@@ -75,6 +82,10 @@ struct InternalBuffer {
     const size_t mAllocSize;
     const std::vector<uint8_t> mConfig;
     bool mInvalidated;
+    // Position in its FreeBufferList bucket, kNotFree when the buffer is not free.
+    size_t mFreeIndex;
+
+    static constexpr size_t kNotFree = SIZE_MAX;
 
     InternalBuffer(
             BufferId id,
@@ -83,7 +94,11 @@ struct InternalBuffer {
             const std::vector<uint8_t> &allocConfig)
             : mId(id), mOwnerCount(0), mTransactionCount(0),
             mAllocation(alloc), mAllocSize(allocSize), mConfig(allocConfig),
-            mInvalidated(false) {}
+            mInvalidated(false), mFreeIndex(kNotFree) {}
+
+    bool isFree() const {
+        return mFreeIndex != kNotFree;
+    }
 
     const native_handle_t *handle() {
         return mAllocation->handle();
@@ -94,6 +109,120 @@ struct InternalBuffer {
     }
 };
 
+// Free buffers of a buffer pool, bucketed by their allocation config.
+//
+// Buffers with the same config are interchangeable for an allocator, so finding a recyclable
+// buffer checks compatibility once per distinct config instead of once per free buffer. Each
+// bucket hands out the most recently freed buffer first.
+class FreeBufferList {
+public:
+    void insert(InternalBuffer *buffer) {
+        if (buffer->isFree()) {
+            return;
+        }
+        std::vector<InternalBuffer *> &bucket = mBuckets[buffer->mConfig];
+        buffer->mFreeIndex = bucket.size();
+        bucket.push_back(buffer);
+        mSize++;
+    }
+
+    void erase(InternalBuffer *buffer) {
+        if (!buffer->isFree()) {
+            return;
+        }
+        auto it = mBuckets.find(buffer->mConfig);
+        if (it != mBuckets.end()) {
+            removeAt(it->second, buffer->mFreeIndex);
+        }
+    }
+
+    // Removes and returns a free buffer whose config is compatible with params, nullptr if there
+    // is none. compatible(config) is the allocator check of config against params.
+    template<class Compatible>
+    InternalBuffer *take(const std::vector<uint8_t> &params, Compatible &&compatible) {
+        auto it = mBuckets.find(params);
+        if (it == mBuckets.end() || it->second.empty() || !compatible(it->first)) {
+            for (it = mBuckets.begin(); it != mBuckets.end(); ++it) {
+                if (!it->second.empty() && compatible(it->first)) {
+                    break;
+                }
+            }
+            if (it == mBuckets.end()) {
+                return nullptr;
+            }
+        }
+        InternalBuffer *buffer = it->second.back();
+        removeAt(it->second, it->second.size() - 1);
+        return buffer;
+    }
+
+    // Removes the free buffers for which shouldRemove(buffer) returns true. The buffers are
+    // visited in increasing BufferId order, so the oldest buffers are evicted first as when the
+    // free buffers were kept in a set of ids. shouldRemove may destroy the buffer when it returns
+    // true. Empty buckets are dropped.
+    template<class ShouldRemove>
+    void removeIf(ShouldRemove &&shouldRemove) {
+        std::vector<std::pair<InternalBuffer *, std::vector<InternalBuffer *> *>> buffers;
+        buffers.reserve(mSize);
+        for (auto &[config, bucket] : mBuckets) {
+            for (InternalBuffer *buffer : bucket) {
+                buffers.emplace_back(buffer, &bucket);
+            }
+        }
+        std::sort(buffers.begin(), buffers.end(), [](const auto &a, const auto &b) {
+            return a.first->mId < b.first->mId;
+        });
+        for (auto &[buffer, bucket] : buffers) {
+            const size_t index = buffer->mFreeIndex;
+            buffer->mFreeIndex = InternalBuffer::kNotFree;
+            if (shouldRemove(buffer)) {
+                (*bucket)[index] = nullptr;
+                mSize--;
+            } else {
+                buffer->mFreeIndex = index;
+            }
+        }
+        // Compact the buckets, keeping the order in which the buffers were freed.
+        for (auto it = mBuckets.begin(); it != mBuckets.end();) {
+            std::vector<InternalBuffer *> &bucket = it->second;
+            size_t kept = 0;
+            for (InternalBuffer *buffer : bucket) {
+                if (buffer != nullptr) {
+                    buffer->mFreeIndex = kept;
+                    bucket[kept++] = buffer;
+                }
+            }
+            bucket.resize(kept);
+            it = bucket.empty() ? mBuckets.erase(it) : std::next(it);
+        }
+    }
+
+    size_t size() const {
+        return mSize;
+    }
+
+private:
+    struct ConfigHash {
+        size_t operator()(const std::vector<uint8_t> &config) const {
+            return std::hash<std::string_view>()(std::string_view(
+                    reinterpret_cast<const char *>(config.data()), config.size()));
+        }
+    };
+
+    // Shifts the later buffers down so that the bucket stays in the order they were freed.
+    void removeAt(std::vector<InternalBuffer *> &bucket, size_t index) {
+        bucket[index]->mFreeIndex = InternalBuffer::kNotFree;
+        bucket.erase(bucket.begin() + index);
+        for (size_t i = index; i < bucket.size(); ++i) {
+            bucket[i]->mFreeIndex = i;
+        }
+        mSize--;
+    }
+
+    std::unordered_map<std::vector<uint8_t>, std::vector<InternalBuffer *>, ConfigHash> mBuckets;
+    size_t mSize = 0;
+};
+
 // Buffer transacion status/message data structure for internal BufferPool use.
 struct TransactionStatus {
     TransactionId mId;
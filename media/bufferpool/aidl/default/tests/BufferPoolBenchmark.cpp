@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "BufferPool.h"
+
+using aidl::android::hardware::media::bufferpool2::BufferId;
+using aidl::android::hardware::media::bufferpool2::ConnectionId;
+using aidl::android::hardware::media::bufferpool2::ResultStatus;
+using aidl::android::hardware::media::bufferpool2::implementation::BufferPool;
+using aidl::android::hardware::media::bufferpool2::implementation::BufferPoolAllocation;
+using aidl::android::hardware::media::bufferpool2::implementation::BufferPoolAllocator;
+using aidl::android::hardware::media::bufferpool2::implementation::BufferPoolStatus;
+
+namespace {
+
+constexpr ConnectionId kConnectionId = 1;
+constexpr size_t kAllocSize = 4096;
+// Buffers of the current config in the config change benchmark.
+constexpr size_t kCurrentConfigBuffers = 8;
+
+// Buffers are compatible when their params are equal, as for codec output buffers of one format.
+class EqualParamsAllocator : public BufferPoolAllocator {
+  public:
+    BufferPoolStatus allocate(const std::vector<uint8_t>& /* params */,
+                              std::shared_ptr<BufferPoolAllocation>* alloc,
+                              size_t* allocSize) override {
+        *alloc = std::make_shared<BufferPoolAllocation>(nullptr);
+        *allocSize = kAllocSize;
+        return ResultStatus::OK;
+    }
+
+    bool compatible(const std::vector<uint8_t>& newParams,
+                    const std::vector<uint8_t>& oldParams) override {
+        return newParams == oldParams;
+    }
+};
+
+std::vector<uint8_t> makeParams(uint32_t width, uint32_t height) {
+    std::vector<uint8_t> params(16);
+    for (int i = 0; i < 4; i++) {
+        params[i] = static_cast<uint8_t>(width >> (8 * i));
+        params[4 + i] = static_cast<uint8_t>(height >> (8 * i));
+    }
+    return params;
+}
+
+// Adds count buffers with params to the pool and leaves them free.
+void addFreeBuffers(BufferPool& pool, BufferPoolAllocator& allocator,
+                    const std::vector<uint8_t>& params, size_t count) {
+    std::vector<BufferId> ids;
+    for (size_t i = 0; i < count; i++) {
+        std::shared_ptr<BufferPoolAllocation> alloc;
+        size_t allocSize;
+        BufferId id;
+        const native_handle_t* handle;
+        allocator.allocate(params, &alloc, &allocSize);
+        pool.addNewBuffer(alloc, allocSize, params, &id, &handle);
+        pool.handleOwnBuffer(kConnectionId, id);
+        ids.push_back(id);
+    }
+    for (BufferId id : ids) {
+        pool.handleReleaseBuffer(kConnectionId, id);
+    }
+}
+
+// One alloc/recycle cycle of a codec: take a free buffer, own it and release it.
+void recycle(benchmark::State& state, BufferPool& pool,
+             const std::shared_ptr<BufferPoolAllocator>& allocator,
+             const std::vector<uint8_t>& params) {
+    for (auto _ : state) {
+        BufferId id;
+        const native_handle_t* handle;
+        if (!pool.getFreeBuffer(allocator, params, &id, &handle)) {
+            state.SkipWithError("no free buffer");
+            return;
+        }
+        pool.handleOwnBuffer(kConnectionId, id);
+        pool.handleReleaseBuffer(kConnectionId, id);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// All the pooled buffers have the requested config.
+void BM_Recycle(benchmark::State& state) {
+    auto allocator = std::make_shared<EqualParamsAllocator>();
+    BufferPool pool;
+    const std::vector<uint8_t> params = makeParams(1920, 1080);
+    addFreeBuffers(pool, *allocator, params, state.range(0));
+    recycle(state, pool, allocator, params);
+}
+
+// After a resolution change, the pooled buffers of the old config wait for eviction while
+// buffers of the new config are recycled.
+void BM_RecycleAfterConfigChange(benchmark::State& state) {
+    auto allocator = std::make_shared<EqualParamsAllocator>();
+    BufferPool pool;
+    addFreeBuffers(pool, *allocator, makeParams(1280, 720), state.range(0));
+    const std::vector<uint8_t> params = makeParams(1920, 1080);
+    addFreeBuffers(pool, *allocator, params, kCurrentConfigBuffers);
+    recycle(state, pool, allocator, params);
+}
+
+// Pooled buffers of many configs, e.g. several codecs sharing a pool.
+void BM_RecycleMixedConfigs(benchmark::State& state) {
+    auto allocator = std::make_shared<EqualParamsAllocator>();
+    BufferPool pool;
+    const size_t count = state.range(0);
+    for (size_t i = 0; i < count / kCurrentConfigBuffers; i++) {
+        addFreeBuffers(pool, *allocator, makeParams(16 * (i + 1), 16 * (i + 1)),
+                       kCurrentConfigBuffers);
+    }
+    recycle(state, pool, allocator, makeParams(16, 16));
+}
+
+}  // namespace
+
+BENCHMARK(BM_Recycle)->Arg(64)->Arg(256)->Arg(1024);
+BENCHMARK(BM_RecycleAfterConfigChange)->Arg(64)->Arg(256)->Arg(1024);
+BENCHMARK(BM_RecycleMixedConfigs)->Arg(64)->Arg(256)->Arg(1024);
+
+BENCHMARK_MAIN();
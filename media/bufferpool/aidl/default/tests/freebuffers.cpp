@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "bufferpool_free_buffers_test"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "DataHelper.h"
+
+using aidl::android::hardware::media::bufferpool2::implementation::BufferId;
+using aidl::android::hardware::media::bufferpool2::implementation::FreeBufferList;
+using aidl::android::hardware::media::bufferpool2::implementation::InternalBuffer;
+
+namespace {
+
+const std::vector<uint8_t> kConfigA = {1};
+const std::vector<uint8_t> kConfigB = {2};
+const std::vector<uint8_t> kConfigC = {3};
+
+// The buffers of a pool, owned by the test as the pool owns them in its buffer map.
+class FreeBufferListTest : public ::testing::Test {
+  protected:
+    InternalBuffer *add(BufferId id, const std::vector<uint8_t> &config) {
+        auto buffer = std::make_unique<InternalBuffer>(id, nullptr, 1, config);
+        InternalBuffer *raw = buffer.get();
+        mBuffers[id] = std::move(buffer);
+        return raw;
+    }
+
+    InternalBuffer *addFree(BufferId id, const std::vector<uint8_t> &config) {
+        InternalBuffer *buffer = add(id, config);
+        mFree.insert(buffer);
+        return buffer;
+    }
+
+    // Takes a buffer of exactly config, as an allocator which only recycles identical configs.
+    InternalBuffer *takeExact(const std::vector<uint8_t> &config) {
+        return mFree.take(config, [&](const std::vector<uint8_t> &free) {
+            return free == config;
+        });
+    }
+
+    std::map<BufferId, std::unique_ptr<InternalBuffer>> mBuffers;
+    FreeBufferList mFree;
+};
+
+TEST_F(FreeBufferListTest, TakeReturnsMostRecentlyFreedOfConfig) {
+    InternalBuffer *a1 = addFree(1, kConfigA);
+    InternalBuffer *b2 = addFree(2, kConfigB);
+    InternalBuffer *a3 = addFree(3, kConfigA);
+    EXPECT_EQ(3u, mFree.size());
+    EXPECT_TRUE(a1->isFree());
+
+    EXPECT_EQ(a3, takeExact(kConfigA));
+    EXPECT_FALSE(a3->isFree());
+    EXPECT_EQ(a1, takeExact(kConfigA));
+    EXPECT_EQ(nullptr, takeExact(kConfigA));
+    EXPECT_EQ(nullptr, takeExact(kConfigC));
+    EXPECT_EQ(1u, mFree.size());
+    EXPECT_EQ(b2, takeExact(kConfigB));
+    EXPECT_EQ(0u, mFree.size());
+}
+
+TEST_F(FreeBufferListTest, TakeFallsBackToCompatibleConfig) {
+    InternalBuffer *b1 = addFree(1, kConfigB);
+    // The allocator can reuse a buffer of any config for kConfigA
+    InternalBuffer *taken = mFree.take(kConfigA, [](const std::vector<uint8_t> &) {
+        return true;
+    });
+    EXPECT_EQ(b1, taken);
+    EXPECT_EQ(0u, mFree.size());
+}
+
+TEST_F(FreeBufferListTest, InsertAndEraseAreIdempotent) {
+    InternalBuffer *a1 = addFree(1, kConfigA);
+    InternalBuffer *a2 = addFree(2, kConfigA);
+    InternalBuffer *a3 = addFree(3, kConfigA);
+    mFree.insert(a1);
+    EXPECT_EQ(3u, mFree.size());
+
+    // Erasing the first buffer of the bucket shifts the later ones down
+    mFree.erase(a1);
+    mFree.erase(a1);
+    EXPECT_EQ(2u, mFree.size());
+    EXPECT_FALSE(a1->isFree());
+    mFree.erase(a3);
+    EXPECT_EQ(a2, takeExact(kConfigA));
+    EXPECT_EQ(nullptr, takeExact(kConfigA));
+}
+
+TEST_F(FreeBufferListTest, EraseKeepsFreedOrder) {
+    InternalBuffer *a1 = addFree(1, kConfigA);
+    InternalBuffer *a2 = addFree(2, kConfigA);
+    InternalBuffer *a3 = addFree(3, kConfigA);
+    InternalBuffer *a4 = addFree(4, kConfigA);
+
+    mFree.erase(a2);
+    EXPECT_EQ(a4, takeExact(kConfigA));
+    EXPECT_EQ(a3, takeExact(kConfigA));
+    EXPECT_EQ(a1, takeExact(kConfigA));
+    EXPECT_EQ(nullptr, takeExact(kConfigA));
+    EXPECT_EQ(0u, mFree.size());
+}
+
+TEST_F(FreeBufferListTest, RemoveIfVisitsOldestBufferFirst) {
+    addFree(5, kConfigA);
+    addFree(1, kConfigB);
+    addFree(4, kConfigC);
+    addFree(3, kConfigA);
+    addFree(2, kConfigB);
+
+    // Evicts the two oldest buffers, as the pool does until it is under its target
+    std::vector<BufferId> visited;
+    size_t evicted = 0;
+    mFree.removeIf([&](InternalBuffer *buffer) {
+        visited.push_back(buffer->mId);
+        if (evicted == 2) {
+            return false;
+        }
+        evicted++;
+        mBuffers.erase(buffer->mId);
+        return true;
+    });
+
+    EXPECT_EQ(std::vector<BufferId>({1, 2, 3, 4, 5}), visited);
+    EXPECT_EQ(3u, mFree.size());
+    EXPECT_EQ(0u, mBuffers.count(1));
+    EXPECT_EQ(0u, mBuffers.count(2));
+    EXPECT_EQ(nullptr, takeExact(kConfigB));
+    // The kept buffers are still handed out most recently freed first
+    EXPECT_EQ(mBuffers[3].get(), takeExact(kConfigA));
+    EXPECT_EQ(mBuffers[5].get(), takeExact(kConfigA));
+    EXPECT_EQ(mBuffers[4].get(), takeExact(kConfigC));
+    EXPECT_EQ(0u, mFree.size());
+}
+
+TEST_F(FreeBufferListTest, RemoveIfKeepsBucketsConsistent) {
+    for (BufferId id = 0; id < 12; id++) {
+        addFree(id, id % 2 ? kConfigA : kConfigB);
+    }
+    // Remove every third buffer, from the middle and the ends of both buckets
+    mFree.removeIf([&](InternalBuffer *buffer) {
+        if (buffer->mId % 3 != 0) {
+            return false;
+        }
+        mBuffers.erase(buffer->mId);
+        return true;
+    });
+    EXPECT_EQ(8u, mFree.size());
+
+    // Each kept buffer can still be erased through its position in its bucket
+    for (auto &[id, buffer] : mBuffers) {
+        EXPECT_TRUE(buffer->isFree()) << id;
+        mFree.erase(buffer.get());
+        EXPECT_FALSE(buffer->isFree()) << id;
+    }
+    EXPECT_EQ(0u, mFree.size());
+    EXPECT_EQ(nullptr, takeExact(kConfigA));
+    EXPECT_EQ(nullptr, takeExact(kConfigB));
+}
+
+}  // namespace
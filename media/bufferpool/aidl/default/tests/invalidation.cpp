@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "bufferpool_invalidation_test"
+
+#include <gtest/gtest.h>
+
+#include <aidl/android/hardware/media/bufferpool2/BnObserver.h>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Accessor.h"
+#include "BufferStatus.h"
+#include "Connection.h"
+#include "allocator.h"
+
+using aidl::android::hardware::media::bufferpool2::BnObserver;
+using aidl::android::hardware::media::bufferpool2::BufferInvalidationMessage;
+using aidl::android::hardware::media::bufferpool2::implementation::Accessor;
+using aidl::android::hardware::media::bufferpool2::implementation::BufferId;
+using aidl::android::hardware::media::bufferpool2::implementation::BufferInvalidationListener;
+using aidl::android::hardware::media::bufferpool2::implementation::BufferStatusChannel;
+using aidl::android::hardware::media::bufferpool2::implementation::Connection;
+using aidl::android::hardware::media::bufferpool2::implementation::ConnectionId;
+using aidl::android::hardware::media::bufferpool2::implementation::InvalidationDescriptor;
+using aidl::android::hardware::media::bufferpool2::implementation::StatusDescriptor;
+
+namespace {
+
+// Well below the 1s the invalidator thread may block on the FMQ of one buffer pool.
+constexpr auto kInvalidationTimeout = std::chrono::milliseconds(200);
+
+// How long the invalidator thread has to stay without wakeups to be considered blocked.
+constexpr auto kBlockedPeriod = std::chrono::milliseconds(50);
+
+// Invalidations are acked through the buffer status FMQ, no message is needed.
+struct NoopObserver : public BnObserver {
+    ::ndk::ScopedAStatus onMessage(int64_t /* connectionId */, int32_t /* msgId */) override {
+        return ::ndk::ScopedAStatus::ok();
+    }
+};
+
+// A buffer pool with a single local client, which talks to the pool through the FMQs.
+struct TestPool {
+    std::shared_ptr<Accessor> mAccessor;
+    std::shared_ptr<Connection> mConnection;
+    ConnectionId mConnectionId;
+    std::unique_ptr<BufferStatusChannel> mStatusChannel;
+    std::unique_ptr<BufferInvalidationListener> mInvalidationListener;
+
+    void init(const std::shared_ptr<NoopObserver>& observer) {
+        mAccessor = ::ndk::SharedRefBase::make<Accessor>(
+                std::make_shared<TestBufferPoolAllocator>());
+        ASSERT_TRUE(mAccessor->isValid());
+        uint32_t msgId;
+        StatusDescriptor statusDesc;
+        InvalidationDescriptor invDesc;
+        ASSERT_EQ(mAccessor->connect(observer, true, &mConnection, &mConnectionId, &msgId,
+                                     &statusDesc, &invDesc),
+                  ResultStatus::OK);
+        mStatusChannel = std::make_unique<BufferStatusChannel>(statusDesc);
+        mInvalidationListener = std::make_unique<BufferInvalidationListener>(invDesc);
+        ASSERT_TRUE(mStatusChannel->isValid());
+        ASSERT_TRUE(mInvalidationListener->isValid());
+    }
+
+    BufferId allocate() {
+        std::vector<uint8_t> params;
+        getTestAllocatorParams(&params);
+        BufferId bufferId = 0;
+        const native_handle_t* handle = nullptr;
+        EXPECT_EQ(mAccessor->allocate(mConnectionId, params, &bufferId, &handle),
+                  ResultStatus::OK);
+        return bufferId;
+    }
+
+    void release(BufferId bufferId) {
+        std::list<BufferId> pending{bufferId};
+        std::list<BufferId> posted;
+        mStatusChannel->postBufferRelease(mConnectionId, pending, posted);
+        ASSERT_TRUE(pending.empty());
+    }
+
+    // Waits until the pool posts an invalidation to its client and acks it.
+    bool waitForInvalidation(std::chrono::milliseconds timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        std::vector<BufferInvalidationMessage> messages;
+        while (messages.empty() && std::chrono::steady_clock::now() < deadline) {
+            mInvalidationListener->getInvalidations(messages);
+            if (messages.empty()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        if (messages.empty()) {
+            return false;
+        }
+        bool acked = false;
+        mStatusChannel->postBufferInvalidateAck(mConnectionId, messages.back().messageId,
+                                                &acked);
+        return true;
+    }
+};
+
+// Waits until the invalidator thread stops waking up, i.e. it blocks on an FMQ.
+void waitForInvalidatorBlocked() {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    uint64_t wakeups = Accessor::getWakeupStats().mInvalidatorWakeups;
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(kBlockedPeriod);
+        const uint64_t current = Accessor::getWakeupStats().mInvalidatorWakeups;
+        if (current == wakeups) {
+            return;
+        }
+        wakeups = current;
+    }
+}
+
+class BufferpoolInvalidationTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        Accessor::createInvalidator();
+        Accessor::createEvictor();
+        mObserver = ::ndk::SharedRefBase::make<NoopObserver>();
+        ASSERT_NO_FATAL_FAILURE(mPoolA.init(mObserver));
+        ASSERT_NO_FATAL_FAILURE(mPoolB.init(mObserver));
+    }
+
+    std::shared_ptr<NoopObserver> mObserver;
+    TestPool mPoolA;
+    TestPool mPoolB;
+};
+
+// An invalidation of one pool must not wait for the invalidation of another pool the
+// invalidator thread is blocked on.
+TEST_F(BufferpoolInvalidationTest, TwoPoolsInvalidateConcurrently) {
+    const BufferId a1 = mPoolA.allocate();
+    const BufferId a2 = mPoolA.allocate();
+    const BufferId b1 = mPoolB.allocate();
+
+    // Pool A stays pending on a2 while its client is seen waking the pool, so the
+    // invalidator thread blocks on the FMQ of pool A.
+    ASSERT_EQ(mPoolA.mAccessor->flush(), ResultStatus::OK);
+    mPoolA.release(a1);
+    waitForInvalidatorBlocked();
+
+    ASSERT_EQ(mPoolB.mAccessor->flush(), ResultStatus::OK);
+    mPoolB.release(b1);
+    EXPECT_TRUE(mPoolB.waitForInvalidation(kInvalidationTimeout));
+
+    mPoolA.release(a2);
+    EXPECT_TRUE(mPoolA.waitForInvalidation(kInvalidationTimeout));
+}
+
+// A second invalidation of the pool the invalidator thread is blocked on is not delayed.
+TEST_F(BufferpoolInvalidationTest, InvalidateWhileBlocked) {
+    const BufferId a1 = mPoolA.allocate();
+    const BufferId a2 = mPoolA.allocate();
+
+    ASSERT_EQ(mPoolA.mAccessor->flush(), ResultStatus::OK);
+    mPoolA.release(a1);
+    waitForInvalidatorBlocked();
+    mPoolA.release(a2);
+    EXPECT_TRUE(mPoolA.waitForInvalidation(kInvalidationTimeout));
+
+    // The new buffer is owned by the client, so the second invalidation is pending
+    // until the release.
+    const BufferId a3 = mPoolA.allocate();
+    ASSERT_EQ(mPoolA.mAccessor->flush(), ResultStatus::OK);
+    mPoolA.release(a3);
+    EXPECT_TRUE(mPoolA.waitForInvalidation(kInvalidationTimeout));
+}
+
+}  // namespace
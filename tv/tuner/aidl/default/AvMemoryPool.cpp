@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AvMemoryPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+void AvMemoryPool::init(uint8_t* base, size_t capacity) {
+    mBase = base;
+    mCapacity = capacity;
+    mHead = 0;
+    mPendingSize = 0;
+    mAllocations.clear();
+    mAllocationCount = 0;
+}
+
+void AvMemoryPool::reset() {
+    init(nullptr, 0);
+}
+
+std::optional<size_t> AvMemoryPool::findSpace(size_t size) const {
+    if (mAllocations.empty()) {
+        // Nothing live, the pending allocation can use the whole memory.
+        if (mHead + size <= mCapacity) {
+            return mHead;
+        }
+        return size <= mCapacity ? std::optional<size_t>(0) : std::nullopt;
+    }
+    const size_t tail = mAllocations.front().offset;
+    if (mHead > tail) {
+        // The free memory is after the head up to the end, then before the tail.
+        if (mHead + size <= mCapacity) {
+            return mHead;
+        }
+        return size <= tail ? std::optional<size_t>(0) : std::nullopt;
+    }
+    // The free memory is between the head and the tail. The memory is full if they are equal.
+    return mHead + size <= tail && mHead < tail ? std::optional<size_t>(mHead) : std::nullopt;
+}
+
+bool AvMemoryPool::append(const int8_t* data, size_t size) {
+    if (mBase == nullptr) {
+        mFailureCount++;
+        return false;
+    }
+    if (mPendingSize == 0 && mAllocations.empty()) {
+        mHead = 0;
+    }
+    const std::optional<size_t> offset = findSpace(mPendingSize + size);
+    if (!offset.has_value()) {
+        mPendingSize = 0;
+        mFailureCount++;
+        return false;
+    }
+    if (*offset != mHead) {
+        // Wrap around, the memory left at the end is skipped until the ring wraps again.
+        memmove(mBase + *offset, mBase + mHead, mPendingSize);
+        mHead = *offset;
+    }
+    memcpy(mBase + mHead + mPendingSize, data, size);
+    mPendingSize += size;
+    return true;
+}
+
+std::optional<AvMemoryPool::Slot> AvMemoryPool::commit(uint64_t id) {
+    if (mPendingSize == 0) {
+        return std::nullopt;
+    }
+    const Slot slot = {.id = id, .offset = mHead, .size = mPendingSize};
+    mAllocations.push_back({.id = id, .offset = mHead, .size = mPendingSize, .released = false});
+    mAllocationCount++;
+    mHead += mPendingSize;
+    mPendingSize = 0;
+    if (mHead == mCapacity) {
+        mHead = 0;
+    }
+    return slot;
+}
+
+bool AvMemoryPool::release(uint64_t id) {
+    auto it = std::find_if(mAllocations.begin(), mAllocations.end(),
+                           [id](const Allocation& allocation) { return allocation.id == id; });
+    if (it == mAllocations.end() || it->released) {
+        return false;
+    }
+    it->released = true;
+    mAllocationCount--;
+    while (!mAllocations.empty() && mAllocations.front().released) {
+        mAllocations.pop_front();
+    }
+    return true;
+}
+
+size_t AvMemoryPool::getUsedBytes() const {
+    if (mAllocations.empty()) {
+        return 0;
+    }
+    const size_t tail = mAllocations.front().offset;
+    const Allocation& newest = mAllocations.back();
+    const size_t end = newest.offset + newest.size;
+    return end > tail ? end - tail : mCapacity - tail + end;
+}
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+/**
+ * Ring allocator over the AV memory of a media filter.
+ *
+ * The filter appends the payload of each PES packet to the pending allocation as the TS packets
+ * arrive, and commits it when a media event is ready. Each allocation is contiguous so a media
+ * event can reference it by offset and length. Allocations are made in ring order and can be
+ * released in any order, the space of released allocations is reused once every older allocation
+ * has been released too.
+ *
+ * Not thread safe.
+ */
+class AvMemoryPool {
+  public:
+    struct Slot {
+        uint64_t id;
+        size_t offset;
+        size_t size;
+    };
+
+    /**
+     * Allocates from the capacity bytes at base. Drops the pending and live allocations.
+     */
+    void init(uint8_t* base, size_t capacity);
+    /**
+     * Drops the memory and all the allocations.
+     */
+    void reset();
+    bool isInitialized() const { return mBase != nullptr; }
+
+    /**
+     * Appends size bytes to the pending allocation, starting one if there is none. If the pending
+     * allocation would reach the end of the memory it is moved to the start, so it stays
+     * contiguous.
+     *
+     * Returns false and drops the pending allocation if there is not enough free memory.
+     */
+    bool append(const int8_t* data, size_t size);
+    size_t getPendingSize() const { return mPendingSize; }
+    /**
+     * Drops the pending allocation.
+     */
+    void cancel() { mPendingSize = 0; }
+
+    /**
+     * Ends the pending allocation and names it id. Returns std::nullopt if it is empty.
+     */
+    std::optional<Slot> commit(uint64_t id);
+    /**
+     * Releases the allocation named id. Returns false if there is no such allocation.
+     */
+    bool release(uint64_t id);
+
+    size_t getCapacity() const { return mCapacity; }
+    // Bytes between the oldest live allocation and the end of the newest one, including the
+    // released allocations and wrap around padding in between.
+    size_t getUsedBytes() const;
+    // Allocations committed and not released yet.
+    size_t getAllocationCount() const { return mAllocationCount; }
+    uint64_t getFailureCount() const { return mFailureCount; }
+
+  private:
+    struct Allocation {
+        uint64_t id;
+        size_t offset;
+        size_t size;
+        bool released;
+    };
+
+    // Returns the offset the pending allocation can grow to size at, std::nullopt if it can't.
+    std::optional<size_t> findSpace(size_t size) const;
+
+    uint8_t* mBase = nullptr;
+    size_t mCapacity = 0;
+    // Where the next allocation starts.
+    size_t mHead = 0;
+    size_t mPendingSize = 0;
+    // Allocations from the oldest live one to the newest, released or not.
+    std::deque<Allocation> mAllocations;
+    size_t mAllocationCount = 0;
+    uint64_t mFailureCount = 0;
+};
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -381,6 +381,10 @@ void Demux::frontendIptvInputThreadLoop(dtv_plugin* interface, dtv_streamer* str
     mPlaybackFilterIds.clear();
     mRecordFilterIds.clear();
     mFilters.clear();
+    {
+        std::lock_guard<std::mutex> lock(mPidTableLock);
+        mPidTable = std::make_shared<PidFilterTable>();
+    }
     mLastUsedFilterId = -1;
     if (mTuner != nullptr) {
         mTuner->removeDemux(mDemuxId);
@@ -410,6 +414,7 @@ void Demux::frontendIptvInputThreadLoop(dtv_plugin* interface, dtv_streamer* str
     if (mDvrPlayback != nullptr) {
         mDvrPlayback->removePlaybackFilter(filterId);
     }
+    removePidFilter(filterId);
     mPlaybackFilterIds.erase(filterId);
     mRecordFilterIds.erase(filterId);
     mFilters.erase(filterId);
@@ -418,25 +423,56 @@ void Demux::frontendIptvInputThreadLoop(dtv_plugin* interface, dtv_streamer* str
 }
 
 void Demux::startBroadcastTsFilter(vector<int8_t> data) {
-    set<int64_t>::iterator it;
-    uint16_t pid = ((data[1] & 0x1f) << 8) | ((data[2] & 0xff));
+    startBroadcastTsFilter(data.data(), data.size(), data.size());
+}
+
+void Demux::startBroadcastTsFilter(const int8_t* data, size_t size, size_t packetSize) {
+    std::shared_ptr<const PidFilterTable> pidTable;
+    {
+        std::lock_guard<std::mutex> lock(mPidTableLock);
+        pidTable = mPidTable;
+    }
     if (DEBUG_DEMUX) {
-        ALOGW("[Demux] start ts filter pid: %d", pid);
+        ALOGW("[Demux] start ts filter on %zu bytes", size);
     }
-    for (it = mPlaybackFilterIds.begin(); it != mPlaybackFilterIds.end(); it++) {
-        if (pid == mFilters[*it]->getTpid()) {
-            mFilters[*it]->updateFilterOutput(data);
-        }
+    pidTable->dispatch(data, size, packetSize,
+                       [](const std::shared_ptr<Filter>& filter, const int8_t* packet,
+                          size_t packetSize) { filter->updateFilterOutput(packet, packetSize); });
+}
+
+void Demux::addPidFilter(int64_t filterId) {
+    if (mPlaybackFilterIds.find(filterId) == mPlaybackFilterIds.end()) {
+        return;
     }
+    std::shared_ptr<Filter> filter = mFilters[filterId];
+    std::lock_guard<std::mutex> lock(mPidTableLock);
+    auto pidTable = std::make_shared<PidFilterTable>(*mPidTable);
+    pidTable->add(filter->getTpid(), filter);
+    mPidTable = std::move(pidTable);
+}
+
+void Demux::removePidFilter(int64_t filterId) {
+    auto it = mFilters.find(filterId);
+    if (it == mFilters.end()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mPidTableLock);
+    auto pidTable = std::make_shared<PidFilterTable>(*mPidTable);
+    pidTable->remove(it->second);
+    mPidTable = std::move(pidTable);
 }
 
 void Demux::sendFrontendInputToRecord(vector<int8_t> data) {
+    sendFrontendInputToRecord(data.data(), data.size());
+}
+
+void Demux::sendFrontendInputToRecord(const int8_t* data, size_t size) {
     set<int64_t>::iterator it;
     if (DEBUG_DEMUX) {
         ALOGW("[Demux] update record filter output");
     }
     for (it = mRecordFilterIds.begin(); it != mRecordFilterIds.end(); it++) {
-        mFilters[*it]->updateRecordOutput(data);
+        mFilters[*it]->updateRecordOutput(data, size);
     }
 }
 
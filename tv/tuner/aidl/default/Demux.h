@@ -31,6 +31,7 @@
 #include "TimeFilter.h"
 #include "Timer.h"
 #include "Tuner.h"
+#include "TsPidTable.h"
 #include "dtv_plugin.h"
 
 using namespace std;
@@ -115,11 +116,23 @@ class Demux : public BnDemux {
      */
     bool startBroadcastFilterDispatcher();
     void startBroadcastTsFilter(vector<int8_t> data);
+    /**
+     * Sends each packet of a batch of TS packets to the started playback filters of its PID.
+     */
+    void startBroadcastTsFilter(const int8_t* data, size_t size, size_t packetSize);
 
     void sendFrontendInputToRecord(vector<int8_t> data);
+    void sendFrontendInputToRecord(const int8_t* data, size_t size);
     void sendFrontendInputToRecord(vector<int8_t> data, uint16_t pid, uint64_t pts);
     bool startRecordFilterDispatcher();
 
+    /**
+     * Keep the PID table used to dispatch the playback packets in sync with the started playback
+     * filters and their TPID.
+     */
+    void addPidFilter(int64_t filterId);
+    void removePidFilter(int64_t filterId);
+
     void getDemuxInfo(DemuxInfo* demuxInfo);
     int32_t getDemuxId();
     bool isInUse();
@@ -185,6 +198,14 @@ class Demux : public BnDemux {
      */
     std::map<int64_t, std::shared_ptr<Filter>> mFilters;
 
+    using PidFilterTable = TsPidTable<std::shared_ptr<Filter>>;
+    /**
+     * The started playback filters per PID. Replaced instead of modified, so that the playback
+     * thread only takes the lock once per batch of packets.
+     */
+    std::mutex mPidTableLock;
+    std::shared_ptr<const PidFilterTable> mPidTable = std::make_shared<PidFilterTable>();
+
     /**
      * Local reference to the opened Timer Filter instance.
      */
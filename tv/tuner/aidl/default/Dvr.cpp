@@ -285,28 +285,46 @@ PlaybackStatus Dvr::checkPlaybackStatusChange(uint32_t availableToWrite, uint32_
 }
 
 bool Dvr::readPlaybackFMQ(bool isVirtualFrontend, bool isRecording) {
-    // Read playback data from the input FMQ
-    size_t size = mDvrMQ->availableToRead();
-    int64_t playbackPacketSize = mDvrSettings.get<DvrSettings::Tag::playback>().packetSize;
-    vector<int8_t> dataOutputBuffer;
-    dataOutputBuffer.resize(playbackPacketSize);
-    // Dispatch the packet to the PID matching filter output buffer
-    for (int i = 0; i < size / playbackPacketSize; i++) {
-        if (!mDvrMQ->read(dataOutputBuffer.data(), playbackPacketSize)) {
-            return false;
-        }
-        if (isVirtualFrontend) {
-            if (isRecording) {
-                mDemux->sendFrontendInputToRecord(dataOutputBuffer);
-            } else {
-                mDemux->startBroadcastTsFilter(dataOutputBuffer);
-            }
+    // Read all the whole packets available in the input FMQ in place, at most one packet wrapping
+    // around the end of the FMQ needs to be copied.
+    const size_t packetSize = mDvrSettings.get<DvrSettings::Tag::playback>().packetSize;
+    if (packetSize == 0) {
+        return false;
+    }
+    const size_t size = mDvrMQ->availableToRead() / packetSize * packetSize;
+    if (size == 0) {
+        return true;
+    }
+    DvrMQ::MemTransaction transaction;
+    if (!mDvrMQ->beginRead(size, &transaction)) {
+        return false;
+    }
+    // Dispatch the packets to the PID matching filter output buffers
+    auto dispatch = [&](const int8_t* data, size_t dataSize) {
+        if (isVirtualFrontend && isRecording) {
+            mDemux->sendFrontendInputToRecord(data, dataSize);
         } else {
-            startTpidFilter(dataOutputBuffer);
+            mDemux->startBroadcastTsFilter(data, dataSize, packetSize);
         }
+    };
+    const auto& firstRegion = transaction.getFirstRegion();
+    const auto& secondRegion = transaction.getSecondRegion();
+    const size_t firstPacketsSize = firstRegion.getLength() / packetSize * packetSize;
+    dispatch(firstRegion.getAddress(), firstPacketsSize);
+    size_t secondOffset = 0;
+    if (const size_t splitSize = firstRegion.getLength() - firstPacketsSize; splitSize > 0) {
+        mSplitPacket.resize(packetSize);
+        memcpy(mSplitPacket.data(), firstRegion.getAddress() + firstPacketsSize, splitSize);
+        secondOffset = packetSize - splitSize;
+        memcpy(mSplitPacket.data() + splitSize, secondRegion.getAddress(), secondOffset);
+        dispatch(mSplitPacket.data(), packetSize);
+    }
+    if (secondRegion.getLength() > secondOffset) {
+        dispatch(secondRegion.getAddress() + secondOffset,
+                 secondRegion.getLength() - secondOffset);
     }
 
-    return true;
+    return mDvrMQ->commitRead(size);
 }
 
 bool Dvr::processEsDataOnPlayback(bool isVirtualFrontend, bool isRecording) {
@@ -429,19 +447,6 @@ void Dvr::getMetaDataValue(int& index, int8_t* dataOutputBuffer, int& value) {
     }
 }
 
-void Dvr::startTpidFilter(vector<int8_t> data) {
-    map<int64_t, std::shared_ptr<Filter>>::iterator it;
-    for (it = mFilters.begin(); it != mFilters.end(); it++) {
-        uint16_t pid = ((data[1] & 0x1f) << 8) | ((data[2] & 0xff));
-        if (DEBUG_DVR) {
-            ALOGW("[Dvr] start ts filter pid: %d", pid);
-        }
-        if (pid == mDemux->getFilterTpid(it->first)) {
-            mDemux->updateFilterOutput(it->first, data);
-        }
-    }
-}
-
 bool Dvr::startFilterDispatcher(bool isVirtualFrontend, bool isRecording) {
     if (isVirtualFrontend) {
         if (isRecording) {
@@ -122,14 +122,11 @@ class Dvr : public BnDvr {
                                              int64_t highThreshold, int64_t lowThreshold);
     RecordStatus checkRecordStatusChange(uint32_t availableToWrite, uint32_t availableToRead,
                                          int64_t highThreshold, int64_t lowThreshold);
-    /**
-     * A dispatcher to read and dispatch input data to all the started filters.
-     * Each filter handler handles the data filtering/output writing/filterEvent updating.
-     */
-    void startTpidFilter(vector<int8_t> data);
     void playbackThreadLoop();
 
     unique_ptr<DvrMQ> mDvrMQ;
+    // A playback packet wrapping around the end of mDvrMQ.
+    vector<int8_t> mSplitPacket;
     EventFlag* mDvrEventFlag;
     /**
      * Demux callbacks used on filter events or IO buffer status
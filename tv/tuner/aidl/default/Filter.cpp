@@ -23,7 +23,11 @@
 #include <aidl/android/hardware/tv/tuner/Result.h>
 #include <aidlcommonsupport/NativeHandle.h>
 #include <inttypes.h>
+#include <sys/mman.h>
 #include <utils/Log.h>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
 
 #include "Filter.h"
 
@@ -35,6 +39,12 @@ namespace tuner {
 
 #define WAIT_TIMEOUT 3000000000
 
+static int64_t getMonotonicTimeNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
 FilterCallbackScheduler::FilterCallbackScheduler(const std::shared_ptr<IFilterCallback>& cb)
     : mCallback(cb),
       mIsConditionMet(false),
@@ -61,6 +71,28 @@ void FilterCallbackScheduler::onFilterEvent(DemuxFilterEvent&& event) {
     }
 }
 
+void FilterCallbackScheduler::onFilterEvents(std::vector<DemuxFilterEvent>&& events,
+                                             int64_t queuedTimeNs) {
+    if (events.empty()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mLock);
+    if (mCallbackBuffer.empty()) {
+        mOldestEventTimeNs = queuedTimeNs;
+    }
+    mCallbackBuffer.reserve(mCallbackBuffer.size() + events.size());
+    for (auto&& event : events) {
+        mDataLength += getDemuxFilterEventDataLength(event);
+        mCallbackBuffer.push_back(std::move(event));
+    }
+
+    if (isDataSizeDelayConditionMetLocked()) {
+        mIsConditionMet = true;
+        lock.unlock();
+        mCv.notify_all();
+    }
+}
+
 void FilterCallbackScheduler::onFilterStatus(const DemuxFilterStatus& status) {
     if (mCallback) {
         mCallback->onFilterStatus(status);
@@ -71,6 +103,16 @@ void FilterCallbackScheduler::flushEvents() {
     std::unique_lock<std::mutex> lock(mLock);
     mCallbackBuffer.clear();
     mDataLength = 0;
+    mOldestEventTimeNs = 0;
+}
+
+void FilterCallbackScheduler::dump(int fd) {
+    std::lock_guard<std::mutex> lock(mLock);
+    dprintf(fd, "      callback count: %" PRId64 "\n", mCallbackCount);
+    if (mCallbackCount > 0) {
+        dprintf(fd, "      event to callback latency avg: %" PRId64 "us, max: %" PRId64 "us\n",
+                mTotalLatencyNs / mCallbackCount / 1000, mMaxLatencyNs / 1000);
+    }
 }
 
 void FilterCallbackScheduler::setTimeDelayHint(int timeDelay) {
@@ -138,8 +180,15 @@ void FilterCallbackScheduler::threadLoopOnce() {
         if (mCallback) {
             mCallback->onFilterEvent(mCallbackBuffer);
         }
+        if (mOldestEventTimeNs > 0) {
+            const int64_t latencyNs = getMonotonicTimeNs() - mOldestEventTimeNs;
+            mCallbackCount++;
+            mTotalLatencyNs += latencyNs;
+            mMaxLatencyNs = std::max(mMaxLatencyNs, latencyNs);
+        }
         mCallbackBuffer.clear();
         mDataLength = 0;
+        mOldestEventTimeNs = 0;
     }
 }
 
@@ -236,6 +285,7 @@ Filter::Filter(DemuxFilterType type, int64_t filterId, uint32_t bufferSize,
 
 Filter::~Filter() {
     close();
+    freeSharedAvHandle();
 }
 
 ::ndk::ScopedAStatus Filter::getId64Bit(int64_t* _aidl_return) {
@@ -303,9 +353,21 @@ Filter::~Filter() {
 
     mFilterSettings = in_settings;
     switch (mType.mainType) {
-        case DemuxFilterMainType::TS:
-            mTpid = in_settings.get<DemuxFilterSettings::Tag::ts>().tpid;
+        case DemuxFilterMainType::TS: {
+            const DemuxTsFilterSettings& tsSettings =
+                    in_settings.get<DemuxFilterSettings::Tag::ts>();
+            mTpid = tsSettings.tpid;
+            if (tsSettings.filterSettings.getTag() ==
+                DemuxTsFilterSettingsFilterSettings::Tag::section) {
+                std::lock_guard<std::mutex> lock(mFilterOutputLock);
+                mSectionAssembler.reset();
+                mSectionAssembler.setCheckCrc(
+                        tsSettings.filterSettings
+                                .get<DemuxTsFilterSettingsFilterSettings::Tag::section>()
+                                .isCheckCrc);
+            }
             break;
+        }
         case DemuxFilterMainType::MMTP:
             break;
         case DemuxFilterMainType::IP:
@@ -317,6 +379,10 @@ Filter::~Filter() {
         default:
             break;
     }
+    if (mFilterThreadRunning) {
+        // Follow the new TPID.
+        mDemux->addPidFilter(mFilterId);
+    }
 
     mConfigured = true;
     return ::ndk::ScopedAStatus::ok();
@@ -329,6 +395,7 @@ Filter::~Filter() {
 
     mFilterCount += 1;
     mDemux->setIptvThreadRunning(true);
+    mDemux->addPidFilter(mFilterId);
 
     // All the filter event callbacks in start are for testing purpose.
     switch (mType.mainType) {
@@ -373,7 +440,17 @@ Filter::~Filter() {
         }
     }
 
-    mFilterThreadRunning = false;
+    mDemux->removePidFilter(mFilterId);
+    {
+        std::lock_guard<std::mutex> lock(mFilterEventsLock);
+        mFilterThreadRunning = false;
+    }
+    mFilterEventsCv.notify_all();
+    if (mFilterEventsFlag != nullptr) {
+        // Do not wait for the client to consume the data, so that a channel change does not
+        // block on the event flag timeout.
+        mFilterEventsFlag->wake(static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_CONSUMED));
+    }
     if (mFilterThread.joinable()) {
         mFilterThread.join();
     }
@@ -399,8 +476,17 @@ Filter::~Filter() {
 ::ndk::ScopedAStatus Filter::releaseAvHandle(const NativeHandle& in_avMemory, int64_t in_avDataId) {
     ALOGV("%s", __FUNCTION__);
 
-    if ((mSharedAvMemHandle != nullptr) && (in_avMemory.fds.size() > 0) &&
-        (sameFile(in_avMemory.fds[0].get(), mSharedAvMemHandle->data[0]))) {
+    bool isSharedAvMemory;
+    {
+        std::lock_guard<std::mutex> lock(mAvMemoryLock);
+        if (mAvMemoryPool.release(in_avDataId)) {
+            return ::ndk::ScopedAStatus::ok();
+        }
+        isSharedAvMemory = mUsingSharedAvMem && (mSharedAvMemHandle != nullptr) &&
+                           (in_avMemory.fds.size() > 0) &&
+                           (sameFile(in_avMemory.fds[0].get(), mSharedAvMemHandle->data[0]));
+    }
+    if (isSharedAvMemory) {
         freeSharedAvHandle();
         return ::ndk::ScopedAStatus::ok();
     }
@@ -442,32 +528,42 @@ Filter::~Filter() {
                 static_cast<int32_t>(Result::INVALID_STATE));
     }
 
+    std::lock_guard<std::mutex> lock(mAvMemoryLock);
+    if (!initAvMemoryPoolLocked()) {
+        *_aidl_return = 0;
+        return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(Result::OUT_OF_MEMORY));
+    }
+    mUsingSharedAvMem = true;
+
+    *out_avMemory = ::android::dupToAidl(mSharedAvMemHandle);
+    *_aidl_return = BUFFER_SIZE;
+    return ::ndk::ScopedAStatus::ok();
+}
+
+bool Filter::initAvMemoryPoolLocked() {
     if (mSharedAvMemHandle != nullptr) {
-        *out_avMemory = ::android::dupToAidl(mSharedAvMemHandle);
-        *_aidl_return = BUFFER_SIZE;
-        mUsingSharedAvMem = true;
-        return ::ndk::ScopedAStatus::ok();
+        return true;
     }
 
     int av_fd = createAvIonFd(BUFFER_SIZE);
     if (av_fd < 0) {
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::OUT_OF_MEMORY));
+        return false;
     }
-
-    mSharedAvMemHandle = createNativeHandle(av_fd);
-    if (mSharedAvMemHandle == nullptr) {
+    uint8_t* avBuffer = getIonBuffer(av_fd, BUFFER_SIZE);
+    if (avBuffer == nullptr) {
         ::close(av_fd);
-        *_aidl_return = 0;
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
+        return false;
     }
+    mSharedAvMemHandle = createNativeHandle(av_fd);
     ::close(av_fd);
-    mUsingSharedAvMem = true;
-
-    *out_avMemory = ::android::dupToAidl(mSharedAvMemHandle);
-    *_aidl_return = BUFFER_SIZE;
-    return ::ndk::ScopedAStatus::ok();
+    if (mSharedAvMemHandle == nullptr) {
+        munmap(avBuffer, BUFFER_SIZE);
+        return false;
+    }
+    mSharedAvMemBuffer = avBuffer;
+    mAvMemoryPool.init(mSharedAvMemBuffer, BUFFER_SIZE);
+    return true;
 }
 
 ::ndk::ScopedAStatus Filter::configureAvStreamType(const AvStreamType& in_avStreamType) {
@@ -580,91 +676,96 @@ void Filter::filterThreadLoop() {
 
     // For the first time of filter output, implementation needs to send the filter
     // Event Callback without waiting for the DATA_CONSUMED to init the process.
-    while (mFilterThreadRunning) {
-        std::unique_lock<std::mutex> lock(mFilterEventsLock);
-        if (mFilterEvents.size() == 0) {
-            lock.unlock();
-            if (DEBUG_FILTER) {
-                ALOGD("[Filter] wait for filter data output.");
+    if (!waitForFilterEvents()) {
+        ALOGD("[Filter] filter thread ended.");
+        return;
+    }
+    if (!mCallbackScheduler.hasCallbackRegistered()) {
+        ALOGD("[Filter] filter callback is not configured yet.");
+        mFilterThreadRunning = false;
+        return;
+    }
+    vector<DemuxFilterEvent> events;
+    if (mConfigured) {
+        events.push_back(DemuxFilterEvent::make<DemuxFilterEvent::Tag::startId>(mStartId++));
+        mConfigured = false;
+    }
+    sendFilterEvents(std::move(events));
+    mFilterStatus = DemuxFilterStatus::DATA_READY;
+    mCallbackScheduler.onFilterStatus(mFilterStatus);
+
+    uint32_t efState = 0;
+    // We do not wait for the last round of written data to be read to finish the thread
+    // because the VTS can verify the reading itself.
+    for (int i = 0; i < SECTION_WRITE_COUNT && mFilterThreadRunning; i++) {
+        while (mFilterThreadRunning && mIsUsingFMQ) {
+            ::android::status_t status = mFilterEventsFlag->wait(
+                    static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_CONSUMED), &efState,
+                    WAIT_TIMEOUT, true /* retry on spurious wake */);
+            if (status != ::android::OK) {
+                ALOGD("[Filter] wait for data consumed");
+                continue;
             }
-            usleep(1000 * 1000);
-            continue;
+            break;
         }
 
-        // After successfully write, send a callback and wait for the read to be done
-        if (mCallbackScheduler.hasCallbackRegistered()) {
-            if (mConfigured) {
-                auto startEvent =
-                        DemuxFilterEvent::make<DemuxFilterEvent::Tag::startId>(mStartId++);
-                mCallbackScheduler.onFilterEvent(std::move(startEvent));
-                mConfigured = false;
-            }
+        maySendFilterStatusCallback();
 
-            // lock is still being held
-            for (auto&& event : mFilterEvents) {
-                mCallbackScheduler.onFilterEvent(std::move(event));
-            }
-        } else {
-            ALOGD("[Filter] filter callback is not configured yet.");
-            mFilterThreadRunning = false;
-            return;
+        if (!waitForFilterEvents()) {
+            break;
         }
+        // All the events written while the previous batch was read are sent in one callback.
+        sendFilterEvents({});
+        // We do not wait for the last read to be done
+        // VTS can verify the read result itself.
+        if (i == SECTION_WRITE_COUNT - 1) {
+            ALOGD("[Filter] filter %" PRIu64 " writing done. Ending thread", mFilterId);
+        }
+    }
+    ALOGD("[Filter] filter thread ended.");
+}
 
-        mFilterEvents.clear();
-        mFilterStatus = DemuxFilterStatus::DATA_READY;
-        mCallbackScheduler.onFilterStatus(mFilterStatus);
-        break;
-    }
-
-    while (mFilterThreadRunning) {
-        uint32_t efState = 0;
-        // We do not wait for the last round of written data to be read to finish the thread
-        // because the VTS can verify the reading itself.
-        for (int i = 0; i < SECTION_WRITE_COUNT; i++) {
-            if (!mFilterThreadRunning) {
-                break;
-            }
-            while (mFilterThreadRunning && mIsUsingFMQ) {
-                ::android::status_t status = mFilterEventsFlag->wait(
-                        static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_CONSUMED), &efState,
-                        WAIT_TIMEOUT, true /* retry on spurious wake */);
-                if (status != ::android::OK) {
-                    ALOGD("[Filter] wait for data consumed");
-                    continue;
-                }
-                break;
-            }
+void Filter::queueFilterEvent(DemuxFilterEvent&& event) {
+    {
+        std::lock_guard<std::mutex> lock(mFilterEventsLock);
+        if (mFilterEvents.empty()) {
+            mFilterEventsTimeNs = getMonotonicTimeNs();
+        }
+        mFilterEvents.push_back(std::move(event));
+    }
+    mFilterEventsCv.notify_one();
+}
 
-            maySendFilterStatusCallback();
+bool Filter::waitForFilterEvents() {
+    std::unique_lock<std::mutex> lock(mFilterEventsLock);
+    mFilterEventsCv.wait(lock,
+                         [this] { return !mFilterEvents.empty() || !mFilterThreadRunning; });
+    return mFilterThreadRunning;
+}
 
-            while (mFilterThreadRunning) {
-                std::lock_guard<std::mutex> lock(mFilterEventsLock);
-                if (mFilterEvents.size() == 0) {
-                    continue;
-                }
-                // After successfully write, send a callback and wait for the read to be done
-                for (auto&& event : mFilterEvents) {
-                    mCallbackScheduler.onFilterEvent(std::move(event));
-                }
-                mFilterEvents.clear();
-                break;
-            }
-            // We do not wait for the last read to be done
-            // VTS can verify the read result itself.
-            if (i == SECTION_WRITE_COUNT - 1) {
-                ALOGD("[Filter] filter %" PRIu64 " writing done. Ending thread", mFilterId);
-                break;
-            }
-        }
-        break;
+void Filter::sendFilterEvents(vector<DemuxFilterEvent>&& events) {
+    int64_t queuedTimeNs;
+    {
+        std::lock_guard<std::mutex> lock(mFilterEventsLock);
+        queuedTimeNs = mFilterEventsTimeNs;
+        events.reserve(events.size() + mFilterEvents.size());
+        std::move(mFilterEvents.begin(), mFilterEvents.end(), std::back_inserter(events));
+        mFilterEvents.clear();
     }
-    ALOGD("[Filter] filter thread ended.");
+    mCallbackScheduler.onFilterEvents(std::move(events), queuedTimeNs);
 }
 
 void Filter::freeSharedAvHandle() {
     if (!mIsMediaFilter) {
         return;
     }
+    std::lock_guard<std::mutex> lock(mAvMemoryLock);
+    if (mSharedAvMemHandle == nullptr) {
+        return;
+    }
+    mAvMemoryPool.reset();
+    munmap(mSharedAvMemBuffer, BUFFER_SIZE);
+    mSharedAvMemBuffer = nullptr;
     native_handle_close(mSharedAvMemHandle);
     native_handle_delete(mSharedAvMemHandle);
     mSharedAvMemHandle = nullptr;
@@ -678,6 +779,23 @@ binder_status_t Filter::dump(int fd, const char** /* args */, uint32_t /* numArg
     dprintf(fd, "      mIsRecordFilter: %d\n", mIsRecordFilter);
     dprintf(fd, "      mIsUsingFMQ: %d\n", mIsUsingFMQ);
     dprintf(fd, "      mFilterThreadRunning: %d\n", (bool)mFilterThreadRunning);
+    if (mType.mainType == DemuxFilterMainType::TS &&
+        mType.subType.get<DemuxFilterSubType::Tag::tsFilterType>() == DemuxTsFilterType::SECTION) {
+        std::lock_guard<std::mutex> lock(mFilterOutputLock);
+        dprintf(fd,
+                "      sections: %" PRIu64 ", repeated sections dropped: %" PRIu64
+                ", CRC errors: %" PRIu64 "\n",
+                mSectionAssembler.getSectionCount(), mSectionAssembler.getDuplicateCount(),
+                mSectionAssembler.getCrcErrorCount());
+    }
+    mCallbackScheduler.dump(fd);
+    if (mIsMediaFilter) {
+        std::lock_guard<std::mutex> lock(mAvMemoryLock);
+        dprintf(fd, "      av memory: %zu/%zu bytes used, %zu buffers, %" PRIu64
+                " allocation failures\n",
+                mAvMemoryPool.getUsedBytes(), mAvMemoryPool.getCapacity(),
+                mAvMemoryPool.getAllocationCount(), mAvMemoryPool.getFailureCount());
+    }
     return STATUS_OK;
 }
 
@@ -718,8 +836,12 @@ uint16_t Filter::getTpid() {
 }
 
 void Filter::updateFilterOutput(vector<int8_t>& data) {
+    updateFilterOutput(data.data(), data.size());
+}
+
+void Filter::updateFilterOutput(const int8_t* data, size_t size) {
     std::lock_guard<std::mutex> lock(mFilterOutputLock);
-    mFilterOutput.insert(mFilterOutput.end(), data.begin(), data.end());
+    mFilterOutput.insert(mFilterOutput.end(), data, data + size);
 }
 
 void Filter::updatePts(uint64_t pts) {
@@ -728,8 +850,12 @@ void Filter::updatePts(uint64_t pts) {
 }
 
 void Filter::updateRecordOutput(vector<int8_t>& data) {
+    updateRecordOutput(data.data(), data.size());
+}
+
+void Filter::updateRecordOutput(const int8_t* data, size_t size) {
     std::lock_guard<std::mutex> lock(mRecordFilterOutputLock);
-    mRecordFilterOutput.insert(mRecordFilterOutput.end(), data.begin(), data.end());
+    mRecordFilterOutput.insert(mRecordFilterOutput.end(), data, data + size);
 }
 
 ::ndk::ScopedAStatus Filter::startFilterHandler() {
@@ -851,10 +977,7 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
             ALOGD("[Filter] assembled pes data length %d", pesEvent.dataLength);
         }
 
-        {
-            std::lock_guard<std::mutex> lock(mFilterEventsLock);
-            mFilterEvents.push_back(DemuxFilterEvent::make<DemuxFilterEvent::Tag::pes>(pesEvent));
-        }
+        queueFilterEvent(DemuxFilterEvent::make<DemuxFilterEvent::Tag::pes>(pesEvent));
 
         mPesOutput.clear();
     }
@@ -889,6 +1012,13 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
         return result;
     }
 
+    std::lock_guard<std::mutex> lock(mAvMemoryLock);
+    if (!initAvMemoryPoolLocked()) {
+        mFilterOutput.clear();
+        return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(Result::OUT_OF_MEMORY));
+    }
+
     for (int i = 0; i < mFilterOutput.size(); i += 188) {
         // Every packet has a 4 Byte TS Header preceding it
         uint32_t headerSize = 4;
@@ -931,20 +1061,31 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
         }
 
         uint32_t endPoint = min(188u - headerSize, mPesSizeLeft);
-        // append data and check size
-        vector<int8_t>::const_iterator first = mFilterOutput.begin() + i + headerSize;
-        vector<int8_t>::const_iterator last = mFilterOutput.begin() + i + headerSize + endPoint;
-        mPesOutput.insert(mPesOutput.end(), first, last);
+        // append data to the A/V memory and check size
+        if (!mDroppingAvData &&
+            !mAvMemoryPool.append(mFilterOutput.data() + i + headerSize, endPoint)) {
+            ALOGW("[Filter] filter %" PRIu64 " out of av memory, dropping frames", mFilterId);
+            // The frames assembled so far were dropped with the pending allocation.
+            mDroppingAvData = true;
+            mAvBufferCopyCount = 0;
+        }
         // size does not match then continue
         mPesSizeLeft -= endPoint;
         if (DEBUG_FILTER) {
             ALOGD("[Filter] pes data left %d", mPesSizeLeft);
         }
-        if (mPesSizeLeft > 0 || mAvBufferCopyCount++ < 10) {
+        if (mPesSizeLeft > 0) {
+            continue;
+        }
+        if (mDroppingAvData) {
+            mDroppingAvData = false;
+            continue;
+        }
+        if (mAvBufferCopyCount++ < 10) {
             continue;
         }
 
-        result = createMediaFilterEventWithIon(mPesOutput);
+        result = createMediaEventFromPoolLocked();
         if (!result.isOk()) {
             mFilterOutput.clear();
             return result;
@@ -957,15 +1098,21 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
 }
 
 ::ndk::ScopedAStatus Filter::createMediaFilterEventWithIon(vector<int8_t>& output) {
-    if (mUsingSharedAvMem) {
-        if (mSharedAvMemHandle == nullptr) {
-            return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                    static_cast<int32_t>(Result::UNKNOWN_ERROR));
-        }
-        return createShareMemMediaEvents(output);
+    std::lock_guard<std::mutex> lock(mAvMemoryLock);
+    if (mUsingSharedAvMem && mSharedAvMemHandle == nullptr) {
+        return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(Result::UNKNOWN_ERROR));
     }
-
-    return createIndependentMediaEvents(output);
+    if (!initAvMemoryPoolLocked()) {
+        return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(Result::OUT_OF_MEMORY));
+    }
+    if (!mAvMemoryPool.append(output.data(), output.size())) {
+        return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(Result::OUT_OF_MEMORY));
+    }
+    output.clear();
+    return createMediaEventFromPoolLocked();
 }
 
 ::ndk::ScopedAStatus Filter::startRecordFilterHandler() {
@@ -987,11 +1134,7 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
             .firstMbInSlice = 0,  // random address
     };
 
-    {
-        std::lock_guard<std::mutex> lock(mFilterEventsLock);
-        mFilterEvents.push_back(
-                DemuxFilterEvent::make<DemuxFilterEvent::Tag::tsRecord>(recordEvent));
-    }
+    queueFilterEvent(DemuxFilterEvent::make<DemuxFilterEvent::Tag::tsRecord>(recordEvent));
 
     mRecordFilterOutput.clear();
     return ::ndk::ScopedAStatus::ok();
@@ -1010,70 +1153,38 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
 // Read PSI (Program Specific Information) Sections from TransportStreams
 // as defined in ISO/IEC 13818-1 Section 2.4.4
 bool Filter::writeSectionsAndCreateEvent(vector<int8_t>& data) {
-    // TODO check how many sections has been read
-    ALOGD("[Filter] section handler");
-
-    // Transport Stream Packets are 188 bytes long, as defined in the
-    // Introduction of ISO/IEC 13818-1
-    for (int i = 0; i < data.size(); i += 188) {
-        if (mSectionSizeLeft == 0) {
-            // Location for sectionSize as defined by Section 2.4.4
-            // Note that the first 4 bytes skipped are the TsHeader
-            mSectionSizeLeft = ((static_cast<uint8_t>(data[i + 5]) & 0x0f) << 8) |
-                               static_cast<uint8_t>(data[i + 6]);
-            mSectionSizeLeft += 3;
-            if (DEBUG_FILTER) {
-                ALOGD("[Filter] section data length %d", mSectionSizeLeft);
-            }
-        }
-
-        // 184 bytes per packet is derived by subtracting the 4 byte length of
-        // the TsHeader from its 188 byte packet size
-        uint32_t endPoint = min(184u, mSectionSizeLeft);
-        // append data and check size
-        vector<int8_t>::const_iterator first = data.begin() + i + 4;
-        vector<int8_t>::const_iterator last = data.begin() + i + 4 + endPoint;
-        mSectionOutput.insert(mSectionOutput.end(), first, last);
-        // size does not match then continue
-        mSectionSizeLeft -= endPoint;
-        if (DEBUG_FILTER) {
-            ALOGD("[Filter] section data left %d", mSectionSizeLeft);
-        }
-        if (mSectionSizeLeft > 0) {
-            continue;
-        }
-
-        if (!writeDataToFilterMQ(mSectionOutput)) {
-            mSectionOutput.clear();
-            return false;
-        }
-
-        DemuxFilterSectionEvent secEvent;
-        secEvent = {
-                // temp dump meta data
-                .tableId = 0,
-                .version = 1,
-                .sectionNum = 1,
-                .dataLength = static_cast<int32_t>(mSectionOutput.size()),
-        };
-        if (DEBUG_FILTER) {
-            ALOGD("[Filter] assembled section data length %" PRIu64, secEvent.dataLength);
-        }
-
-        {
-            std::lock_guard<std::mutex> lock(mFilterEventsLock);
-            mFilterEvents.push_back(
-                    DemuxFilterEvent::make<DemuxFilterEvent::Tag::section>(secEvent));
-        }
-        mSectionOutput.clear();
+    if (DEBUG_FILTER) {
+        ALOGD("[Filter] section handler");
     }
 
-    return true;
+    // Repeated and corrupted sections are dropped by the assembler, only the new ones are
+    // written to the FMQ and reported.
+    return mSectionAssembler.push(
+            data.data(), data.size(), [this](const TsSectionAssembler::Section& section) {
+                if (!writeDataToFilterMQ(section.data, section.size)) {
+                    return false;
+                }
+                DemuxFilterSectionEvent secEvent = {
+                        .tableId = section.tableId,
+                        .version = section.version,
+                        .sectionNum = section.sectionNumber,
+                        .dataLength = static_cast<int64_t>(section.size),
+                };
+                if (DEBUG_FILTER) {
+                    ALOGD("[Filter] assembled section data length %" PRIu64, secEvent.dataLength);
+                }
+                queueFilterEvent(DemuxFilterEvent::make<DemuxFilterEvent::Tag::section>(secEvent));
+                return true;
+            });
 }
 
 bool Filter::writeDataToFilterMQ(const std::vector<int8_t>& data) {
+    return writeDataToFilterMQ(data.data(), data.size());
+}
+
+bool Filter::writeDataToFilterMQ(const int8_t* data, size_t size) {
     std::lock_guard<std::mutex> lock(mWriteLock);
-    if (mFilterMQ->write(data.data(), data.size())) {
+    if (mFilterMQ->write(data, size)) {
         return true;
     }
     return false;
@@ -1131,98 +1242,46 @@ native_handle_t* Filter::createNativeHandle(int fd) {
     return nativeHandle;
 }
 
-::ndk::ScopedAStatus Filter::createIndependentMediaEvents(vector<int8_t>& output) {
-    int av_fd = createAvIonFd(output.size());
-    if (av_fd == -1) {
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
-    }
-    // copy the filtered data to the buffer
-    uint8_t* avBuffer = getIonBuffer(av_fd, output.size());
-    if (avBuffer == NULL) {
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
+::ndk::ScopedAStatus Filter::createMediaEventFromPoolLocked() {
+    // The dataId is the name of the A/V memory allocation, releaseAvHandle recycles it.
+    uint64_t dataId = mLastUsedDataId++ /*createdUID*/;
+    std::optional<AvMemoryPool::Slot> slot = mAvMemoryPool.commit(dataId);
+    if (!slot.has_value()) {
+        return ::ndk::ScopedAStatus::ok();
     }
-    memcpy(avBuffer, output.data(), output.size() * sizeof(uint8_t));
 
-    native_handle_t* nativeHandle = createNativeHandle(av_fd);
+    // With shared memory the handle has numFds == 0, the client already has the memory.
+    // Otherwise the handle carries the A/V memory fd, and the data is at the event offset.
+    native_handle_t* nativeHandle =
+            createNativeHandle(mUsingSharedAvMem ? -1 : mSharedAvMemHandle->data[0]);
     if (nativeHandle == NULL) {
+        mAvMemoryPool.release(dataId);
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::UNKNOWN_ERROR));
     }
 
-    // Create a dataId and add a <dataId, av_fd> pair into the dataId2Avfd map
-    uint64_t dataId = mLastUsedDataId++ /*createdUID*/;
-    mDataId2Avfd[dataId] = dup(av_fd);
-
     // Create mediaEvent and send callback
     auto event = DemuxFilterEvent::make<DemuxFilterEvent::Tag::media>();
     auto& mediaEvent = event.get<DemuxFilterEvent::Tag::media>();
     mediaEvent.avMemory = ::android::dupToAidl(nativeHandle);
-    mediaEvent.dataLength = static_cast<int64_t>(output.size());
+    mediaEvent.offset = static_cast<int64_t>(slot->offset);
+    mediaEvent.dataLength = static_cast<int64_t>(slot->size);
     mediaEvent.avDataId = static_cast<int64_t>(dataId);
     if (mPts) {
         mediaEvent.pts = mPts;
         mPts = 0;
     }
 
-    {
-        std::lock_guard<std::mutex> lock(mFilterEventsLock);
-        mFilterEvents.push_back(std::move(event));
-    }
+    queueFilterEvent(std::move(event));
 
     // Clear and log
     native_handle_close(nativeHandle);
     native_handle_delete(nativeHandle);
-    output.clear();
-    mAvBufferCopyCount = 0;
-    if (DEBUG_FILTER) {
-        ALOGD("[Filter] av data length %d", static_cast<int32_t>(output.size()));
-    }
-    return ::ndk::ScopedAStatus::ok();
-}
-
-::ndk::ScopedAStatus Filter::createShareMemMediaEvents(vector<int8_t>& output) {
-    // copy the filtered data to the shared buffer
-    uint8_t* sharedAvBuffer =
-            getIonBuffer(mSharedAvMemHandle->data[0], output.size() + mSharedAvMemOffset);
-    if (sharedAvBuffer == NULL) {
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
-    }
-    memcpy(sharedAvBuffer + mSharedAvMemOffset, output.data(), output.size() * sizeof(uint8_t));
-
-    // Create a memory handle with numFds == 0
-    native_handle_t* nativeHandle = createNativeHandle(-1);
-    if (nativeHandle == NULL) {
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
+    if (!mUsingSharedAvMem) {
+        mAvBufferCopyCount = 0;
     }
-
-    // Create mediaEvent and send callback
-    auto event = DemuxFilterEvent::make<DemuxFilterEvent::Tag::media>();
-    auto& mediaEvent = event.get<DemuxFilterEvent::Tag::media>();
-    mediaEvent.avMemory = ::android::dupToAidl(nativeHandle);
-    mediaEvent.offset = mSharedAvMemOffset;
-    mediaEvent.dataLength = static_cast<int64_t>(output.size());
-    if (mPts) {
-        mediaEvent.pts = mPts;
-        mPts = 0;
-    }
-
-    {
-        std::lock_guard<std::mutex> lock(mFilterEventsLock);
-        mFilterEvents.push_back(std::move(event));
-    }
-
-    mSharedAvMemOffset += output.size();
-
-    // Clear and log
-    native_handle_close(nativeHandle);
-    native_handle_delete(nativeHandle);
-    output.clear();
     if (DEBUG_FILTER) {
-        ALOGD("[Filter] shared av data length %d", static_cast<int32_t>(output.size()));
+        ALOGD("[Filter] av data offset %zu length %zu", slot->offset, slot->size);
     }
     return ::ndk::ScopedAStatus::ok();
 }
@@ -31,9 +31,11 @@
 #include <set>
 #include <thread>
 
+#include "AvMemoryPool.h"
 #include "Demux.h"
 #include "Dvr.h"
 #include "Frontend.h"
+#include "TsSectionAssembler.h"
 
 using namespace std;
 
@@ -62,6 +64,8 @@ class FilterCallbackScheduler final {
     ~FilterCallbackScheduler();
 
     void onFilterEvent(DemuxFilterEvent&& event);
+    // Queues the events as one batch, queuedTimeNs is when the oldest of them was created.
+    void onFilterEvents(std::vector<DemuxFilterEvent>&& events, int64_t queuedTimeNs);
     void onFilterStatus(const DemuxFilterStatus& status);
 
     void setTimeDelayHint(int timeDelay);
@@ -71,6 +75,8 @@ class FilterCallbackScheduler final {
 
     void flushEvents();
 
+    void dump(int fd);
+
   private:
     void start();
     void stop();
@@ -89,7 +95,7 @@ class FilterCallbackScheduler final {
     std::atomic<bool> mIsRunning;
 
     // mLock protects mCallbackBuffer, mIsConditionMet, mCv, mDataLength,
-    // mTimeDelayInMs, and mDataSizeDelayInBytes
+    // mTimeDelayInMs, mDataSizeDelayInBytes and the callback latency records
     std::mutex mLock;
     std::vector<DemuxFilterEvent> mCallbackBuffer;
     bool mIsConditionMet;
@@ -97,6 +103,13 @@ class FilterCallbackScheduler final {
     int mDataLength;
     int mTimeDelayInMs;
     int mDataSizeDelayInBytes;
+
+    // Creation time of the oldest event in mCallbackBuffer
+    int64_t mOldestEventTimeNs = 0;
+    // Event to callback latency records, measured for the oldest event of each callback
+    int64_t mCallbackCount = 0;
+    int64_t mTotalLatencyNs = 0;
+    int64_t mMaxLatencyNs = 0;
 };
 
 class Filter : public BnFilter {
@@ -137,7 +150,9 @@ class Filter : public BnFilter {
     bool createFilterMQ();
     uint16_t getTpid();
     void updateFilterOutput(vector<int8_t>& data);
+    void updateFilterOutput(const int8_t* data, size_t size);
     void updateRecordOutput(vector<int8_t>& data);
+    void updateRecordOutput(const int8_t* data, size_t size);
     void updatePts(uint64_t pts);
     ::ndk::ScopedAStatus startFilterHandler();
     ::ndk::ScopedAStatus startRecordFilterHandler();
@@ -174,7 +189,7 @@ class Filter : public BnFilter {
     int64_t mPts = 0;
     unique_ptr<FilterMQ> mFilterMQ;
     bool mIsUsingFMQ = false;
-    EventFlag* mFilterEventsFlag;
+    EventFlag* mFilterEventsFlag = nullptr;
     vector<DemuxFilterEvent> mFilterEvents;
 
     // Thread handlers
@@ -210,9 +225,22 @@ class Filter : public BnFilter {
 
     void deleteEventFlag();
     bool writeDataToFilterMQ(const std::vector<int8_t>& data);
+    bool writeDataToFilterMQ(const int8_t* data, size_t size);
     bool readDataFromMQ();
     bool writeSectionsAndCreateEvent(vector<int8_t>& data);
     void maySendFilterStatusCallback();
+    /**
+     * Queues an event for the filter thread to send, and wakes it up.
+     */
+    void queueFilterEvent(DemuxFilterEvent&& event);
+    /**
+     * Waits until an event is queued. Returns false if the filter thread is stopped.
+     */
+    bool waitForFilterEvents();
+    /**
+     * Sends the queued events appended to events to the callback scheduler as one batch.
+     */
+    void sendFilterEvents(vector<DemuxFilterEvent>&& events);
     DemuxFilterStatus checkFilterStatusChange(uint32_t availableToWrite, uint32_t availableToRead,
                                               uint32_t highThreshold, uint32_t lowThreshold);
     /**
@@ -227,8 +255,14 @@ class Filter : public BnFilter {
     uint8_t* getIonBuffer(int fd, int size);
     native_handle_t* createNativeHandle(int fd);
     ::ndk::ScopedAStatus createMediaFilterEventWithIon(vector<int8_t>& output);
-    ::ndk::ScopedAStatus createIndependentMediaEvents(vector<int8_t>& output);
-    ::ndk::ScopedAStatus createShareMemMediaEvents(vector<int8_t>& output);
+    /**
+     * Allocates and maps the AV memory mAvMemoryPool allocates from, if not done yet.
+     */
+    bool initAvMemoryPoolLocked();
+    /**
+     * Commits the pending AV memory allocation and queues a media event for it.
+     */
+    ::ndk::ScopedAStatus createMediaEventFromPoolLocked();
     bool sameFile(int fd1, int fd2);
 
     void createMediaEvent(vector<DemuxFilterEvent>&, bool isAudioPresentation,
@@ -252,6 +286,10 @@ class Filter : public BnFilter {
      */
     // TODO make each filter separate event lock
     std::mutex mFilterEventsLock;
+    // Notified when an event is queued or the filter thread is stopped
+    std::condition_variable mFilterEventsCv;
+    // Creation time of the oldest event in mFilterEvents
+    int64_t mFilterEventsTimeNs = 0;
     /**
      * Lock to protect writes to the input status
      */
@@ -259,9 +297,8 @@ class Filter : public BnFilter {
     std::mutex mFilterOutputLock;
     std::mutex mRecordFilterOutputLock;
 
-    // handle single Section filter
-    uint32_t mSectionSizeLeft = 0;
-    vector<int8_t> mSectionOutput;
+    // handle single Section filter, guarded by mFilterOutputLock
+    TsSectionAssembler mSectionAssembler;
 
     // temp handle single PES filter
     // TODO handle mulptiple Pes filters
@@ -270,13 +307,20 @@ class Filter : public BnFilter {
 
     // A map from data id to ion handle
     std::map<uint64_t, int> mDataId2Avfd;
-    uint64_t mLastUsedDataId = 1;
+    std::atomic<uint64_t> mLastUsedDataId = 1;
     int mAvBufferCopyCount = 0;
 
-    // Shared A/V memory handle
+    // mAvMemoryLock protects the A/V memory and mAvMemoryPool
+    std::mutex mAvMemoryLock;
+    // A/V memory handle, shared with the client once getAvSharedHandle is called
     native_handle_t* mSharedAvMemHandle = nullptr;
+    uint8_t* mSharedAvMemBuffer = nullptr;
     bool mUsingSharedAvMem = false;
-    int64_t mSharedAvMemOffset = 0;
+    // The media filter output is written straight into A/V memory allocated from this pool, and
+    // the allocations are recycled when the client releases their avDataId
+    AvMemoryPool mAvMemoryPool;
+    // Set while dropping the rest of a PES packet that did not fit in mAvMemoryPool
+    bool mDroppingAvData = false;
 
     uint32_t mAudioStreamType;
     uint32_t mVideoStreamType;
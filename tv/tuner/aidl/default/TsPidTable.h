@@ -0,0 +1,125 @@
+/*
+ * Copyright 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+/**
+ * Maps each of the 8192 TS PIDs to the targets, e.g. filters, interested in its packets.
+ *
+ * The PID index is a flat array of slots into a compact list of the PIDs in use, so a lookup is a
+ * single array access however many targets are registered, and copying the table, e.g. to publish
+ * an updated snapshot to a dispatching thread, only copies the PIDs in use and 16KB of index.
+ */
+template <typename T>
+class TsPidTable {
+  public:
+    static constexpr size_t kPidCount = 8192;
+
+    TsPidTable() { mSlots.fill(kNoSlot); }
+
+    static uint16_t getPid(const int8_t* packet) {
+        return ((packet[1] & 0x1f) << 8) | (packet[2] & 0xff);
+    }
+
+    // Registers target for pid. A target is only registered for one PID at a time.
+    void add(uint16_t pid, const T& target) {
+        remove(target);
+        pid %= kPidCount;
+        if (mSlots[pid] == kNoSlot) {
+            mSlots[pid] = mEntries.size();
+            mEntries.push_back({pid, {}});
+        }
+        mEntries[mSlots[pid]].second.push_back(target);
+    }
+
+    void remove(const T& target) {
+        for (size_t slot = 0; slot < mEntries.size(); slot++) {
+            auto& targets = mEntries[slot].second;
+            auto it = std::find(targets.begin(), targets.end(), target);
+            if (it == targets.end()) {
+                continue;
+            }
+            targets.erase(it);
+            if (targets.empty()) {
+                // Keep the entries compact, move the last one into the free slot.
+                mSlots[mEntries[slot].first] = kNoSlot;
+                if (slot != mEntries.size() - 1) {
+                    mEntries[slot] = std::move(mEntries.back());
+                    mSlots[mEntries[slot].first] = slot;
+                }
+                mEntries.pop_back();
+            }
+            return;
+        }
+    }
+
+    void clear() {
+        mSlots.fill(kNoSlot);
+        mEntries.clear();
+    }
+
+    bool empty() const { return mEntries.empty(); }
+
+    // The targets registered for pid, nullptr if none.
+    const std::vector<T>* find(uint16_t pid) const {
+        const uint16_t slot = mSlots[pid % kPidCount];
+        return slot == kNoSlot ? nullptr : &mEntries[slot].second;
+    }
+
+    /**
+     * Calls onPacket(target, packet, packetSize) for each packetSize bytes packet in data and each
+     * target registered for the PID of the packet. A trailing partial packet is ignored.
+     */
+    template <typename OnPacket>
+    void dispatch(const int8_t* data, size_t size, size_t packetSize, OnPacket&& onPacket) const {
+        if (packetSize < 3 || mEntries.empty()) {
+            return;
+        }
+        for (size_t offset = 0; offset + packetSize <= size; offset += packetSize) {
+            const int8_t* packet = data + offset;
+            if (const std::vector<T>* targets = find(getPid(packet))) {
+                for (const T& target : *targets) {
+                    onPacket(target, packet, packetSize);
+                }
+            }
+        }
+    }
+
+  private:
+    static constexpr uint16_t kNoSlot = 0xffff;
+
+    std::array<uint16_t, kPidCount> mSlots;
+    std::vector<std::pair<uint16_t, std::vector<T>>> mEntries;
+};
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TsSectionAssembler.h"
+
+#include <algorithm>
+#include <array>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+namespace {
+
+constexpr uint8_t kSyncByte = 0x47;
+constexpr uint8_t kStuffingByte = 0xff;
+constexpr size_t kSectionHeaderSize = 3;
+// The header up to last_section_number and the CRC_32.
+constexpr size_t kMinLongSectionSize = 12;
+
+// kCrcTables[k][i] is the CRC of byte i followed by k zero bytes, for the MSB first polynomial
+// 0x04C11DB7.
+using CrcTables = std::array<std::array<uint32_t, 256>, 8>;
+
+constexpr CrcTables makeCrcTables() {
+    CrcTables tables{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i << 24;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+        tables[0][i] = crc;
+    }
+    for (size_t k = 1; k < tables.size(); k++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            const uint32_t previous = tables[k - 1][i];
+            tables[k][i] = (previous << 8) ^ tables[0][previous >> 24];
+        }
+    }
+    return tables;
+}
+
+constexpr CrcTables kCrcTables = makeCrcTables();
+
+}  // namespace
+
+TsSectionAssembler::TsSectionAssembler() {
+    mSection.resize(kMaxSectionSize);
+}
+
+void TsSectionAssembler::reset() {
+    mAssembling = false;
+    mLastContinuityCounter = -1;
+    mSectionSize = 0;
+    mVersions.clear();
+}
+
+bool TsSectionAssembler::push(const int8_t* data, size_t size, const OnSection& onSection) {
+    for (size_t offset = 0; offset + kTsPacketSize <= size; offset += kTsPacketSize) {
+        if (!pushPacket(reinterpret_cast<const uint8_t*>(data + offset), onSection)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TsSectionAssembler::pushPacket(const uint8_t* packet, const OnSection& onSection) {
+    // Drop the section on a lost sync or a transport_error_indicator.
+    if (packet[0] != kSyncByte || (packet[1] & 0x80) != 0) {
+        mAssembling = false;
+        mLastContinuityCounter = -1;
+        return true;
+    }
+    const uint8_t adaptationFieldControl = (packet[3] >> 4) & 0x3;
+    if ((adaptationFieldControl & 0x1) == 0) {
+        // No payload, the continuity counter does not increment.
+        return true;
+    }
+    const int continuityCounter = packet[3] & 0x0f;
+    if (mLastContinuityCounter >= 0) {
+        if (continuityCounter == mLastContinuityCounter) {
+            // A duplicate packet.
+            return true;
+        }
+        if (continuityCounter != ((mLastContinuityCounter + 1) & 0x0f)) {
+            mAssembling = false;
+        }
+    }
+    mLastContinuityCounter = continuityCounter;
+
+    size_t offset = 4;
+    if ((adaptationFieldControl & 0x2) != 0) {
+        offset += 1 + packet[4];
+    }
+    if (offset >= kTsPacketSize) {
+        mAssembling = false;
+        return true;
+    }
+    const uint8_t* payload = packet + offset;
+    size_t size = kTsPacketSize - offset;
+
+    if ((packet[1] & 0x40) == 0) {
+        return !mAssembling || assemble(payload, size, false, onSection);
+    }
+
+    // The pointer_field gives the number of bytes that end the previous section.
+    const size_t pointer = payload[0];
+    payload++;
+    size--;
+    if (pointer >= size) {
+        mAssembling = false;
+        return true;
+    }
+    if (mAssembling && mSectionSize > 0 && !assemble(payload, pointer, false, onSection)) {
+        return false;
+    }
+    mAssembling = true;
+    mSectionSize = 0;
+    return assemble(payload + pointer, size - pointer, true, onSection);
+}
+
+bool TsSectionAssembler::assemble(const uint8_t* payload, size_t size, bool canStartSection,
+                                  const OnSection& onSection) {
+    while (size > 0) {
+        if (mSectionSize == 0) {
+            if (!canStartSection || payload[0] == kStuffingByte) {
+                // The rest of the packet is stuffing.
+                mAssembling = false;
+                return true;
+            }
+            mSectionSize = 1;
+            mSection[0] = payload[0];
+            payload++;
+            size--;
+            continue;
+        }
+        size_t needed;
+        if (mSectionSize < kSectionHeaderSize) {
+            needed = kSectionHeaderSize - mSectionSize;
+        } else {
+            const size_t sectionLength = ((mSection[1] & 0x0f) << 8) | mSection[2];
+            needed = kSectionHeaderSize + sectionLength - mSectionSize;
+        }
+        const size_t count = std::min(needed, size);
+        std::copy(payload, payload + count, mSection.begin() + mSectionSize);
+        mSectionSize += count;
+        payload += count;
+        size -= count;
+        if (count < needed) {
+            return true;
+        }
+        const size_t sectionLength = ((mSection[1] & 0x0f) << 8) | mSection[2];
+        if (mSectionSize == kSectionHeaderSize + sectionLength) {
+            const bool result = deliverSection(onSection);
+            mSectionSize = 0;
+            if (!result) {
+                mAssembling = false;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool TsSectionAssembler::deliverSection(const OnSection& onSection) {
+    const uint8_t* data = mSection.data();
+    Section section = {
+            .data = reinterpret_cast<const int8_t*>(data),
+            .size = mSectionSize,
+            .tableId = data[0],
+            .version = 0,
+            .sectionNumber = 0,
+    };
+    const bool isLongForm = (data[1] & 0x80) != 0 && mSectionSize >= kMinLongSectionSize;
+    if (!isLongForm) {
+        if (!onSection(section)) {
+            return false;
+        }
+        mSectionCount++;
+        return true;
+    }
+
+    if (mCheckCrc && crc32(data, mSectionSize) != 0) {
+        mCrcErrorCount++;
+        return true;
+    }
+    section.version = (data[5] >> 1) & 0x1f;
+    section.sectionNumber = data[6];
+    const uint32_t key = (static_cast<uint32_t>(data[0]) << 24) | (data[3] << 16) |
+                         (data[4] << 8) | data[6];
+    auto it = mVersions.find(key);
+    if (it != mVersions.end() && it->second == section.version) {
+        mDuplicateCount++;
+        return true;
+    }
+    if (!onSection(section)) {
+        return false;
+    }
+    mVersions[key] = section.version;
+    mSectionCount++;
+    return true;
+}
+
+uint32_t TsSectionAssembler::crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (; size >= 8; data += 8, size -= 8) {
+        crc ^= (static_cast<uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+        crc = kCrcTables[7][crc >> 24] ^ kCrcTables[6][(crc >> 16) & 0xff] ^
+              kCrcTables[5][(crc >> 8) & 0xff] ^ kCrcTables[4][crc & 0xff] ^
+              kCrcTables[3][data[4]] ^ kCrcTables[2][data[5]] ^ kCrcTables[1][data[6]] ^
+              kCrcTables[0][data[7]];
+    }
+    for (; size > 0; data++, size--) {
+        crc = (crc << 8) ^ kCrcTables[0][(crc >> 24) ^ *data];
+    }
+    return crc;
+}
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+/**
+ * Reassembles the PSI/SI sections, as defined in Section 2.4.4 of ISO/IEC 13818-1, carried in the
+ * TS packets of a single PID.
+ *
+ * The payload_unit_start_indicator and pointer_field are honored, so sections can span packets
+ * and a packet can carry several sections. Packets with a continuity counter gap drop the section
+ * being assembled, duplicate packets are ignored.
+ *
+ * Long form sections are only delivered when their version changes for the table and section
+ * number they belong to, the repeats broadcasters send several times a second are dropped. When
+ * CRC checking is enabled, long form sections with a bad CRC_32 are dropped too.
+ */
+class TsSectionAssembler {
+  public:
+    static constexpr size_t kTsPacketSize = 188;
+    // section_length is 12 bits, private sections can use all of them.
+    static constexpr size_t kMaxSectionSize = 3 + 0xfff;
+
+    struct Section {
+        const int8_t* data;
+        size_t size;
+        int32_t tableId;
+        // Zero for short form sections.
+        int32_t version;
+        int32_t sectionNumber;
+    };
+    // Called with each new section. Returning false stops the assembly of the packets pushed.
+    using OnSection = std::function<bool(const Section&)>;
+
+    TsSectionAssembler();
+
+    void setCheckCrc(bool checkCrc) { mCheckCrc = checkCrc; }
+
+    /**
+     * Drops the section being assembled and forgets the versions seen, e.g. when the filter is
+     * moved to another PID.
+     */
+    void reset();
+
+    /**
+     * Assembles the sections in the kTsPacketSize bytes TS packets in data. A trailing partial
+     * packet is ignored.
+     *
+     * Returns false if onSection returned false.
+     */
+    bool push(const int8_t* data, size_t size, const OnSection& onSection);
+
+    uint64_t getSectionCount() const { return mSectionCount; }
+    uint64_t getDuplicateCount() const { return mDuplicateCount; }
+    uint64_t getCrcErrorCount() const { return mCrcErrorCount; }
+
+    /**
+     * CRC_32 as defined in Annex A of ISO/IEC 13818-1, computed 8 bytes at a time. Applied to a
+     * whole section including its CRC_32 field, the result is 0 if the section is intact.
+     */
+    static uint32_t crc32(const uint8_t* data, size_t size);
+
+  private:
+    bool pushPacket(const uint8_t* packet, const OnSection& onSection);
+    // Appends payload to the sections being assembled. A new section can only start in payload
+    // if canStartSection, i.e. in a packet with payload_unit_start_indicator set.
+    bool assemble(const uint8_t* payload, size_t size, bool canStartSection,
+                  const OnSection& onSection);
+    bool deliverSection(const OnSection& onSection);
+
+    bool mCheckCrc = false;
+    // Whether the bytes of the current packet belong to a section.
+    bool mAssembling = false;
+    int mLastContinuityCounter = -1;
+    std::vector<uint8_t> mSection;
+    size_t mSectionSize = 0;
+
+    // Version of the last section delivered, by table_id, table_id_extension and section_number.
+    std::unordered_map<uint32_t, uint8_t> mVersions;
+
+    uint64_t mSectionCount = 0;
+    uint64_t mDuplicateCount = 0;
+    uint64_t mCrcErrorCount = 0;
+};
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <deque>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "AvMemoryPool.h"
+
+using aidl::android::hardware::tv::tuner::AvMemoryPool;
+
+namespace {
+
+constexpr size_t kCapacity = 1000;
+
+class AvMemoryPoolTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mMemory.resize(kCapacity);
+        mPool.init(mMemory.data(), mMemory.size());
+    }
+
+    // Appends size bytes of value in pieces of at most 184 bytes, like TS payloads.
+    bool appendPayload(size_t size, int8_t value) {
+        std::vector<int8_t> piece(184, value);
+        while (size > 0) {
+            const size_t count = std::min(size, piece.size());
+            if (!mPool.append(piece.data(), count)) {
+                return false;
+            }
+            size -= count;
+        }
+        return true;
+    }
+
+    bool slotHolds(const AvMemoryPool::Slot& slot, int8_t value) {
+        for (size_t i = 0; i < slot.size; i++) {
+            if (static_cast<int8_t>(mMemory[slot.offset + i]) != value) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> mMemory;
+    AvMemoryPool mPool;
+};
+
+}  // namespace
+
+TEST_F(AvMemoryPoolTest, AllocationsAreContiguous) {
+    ASSERT_TRUE(appendPayload(300, 1));
+    auto first = mPool.commit(1);
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(0u, first->offset);
+    EXPECT_EQ(300u, first->size);
+
+    ASSERT_TRUE(appendPayload(400, 2));
+    auto second = mPool.commit(2);
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(300u, second->offset);
+    EXPECT_EQ(400u, second->size);
+
+    EXPECT_TRUE(slotHolds(*first, 1));
+    EXPECT_TRUE(slotHolds(*second, 2));
+    EXPECT_EQ(700u, mPool.getUsedBytes());
+    EXPECT_EQ(2u, mPool.getAllocationCount());
+}
+
+TEST_F(AvMemoryPoolTest, EmptyCommitFails) {
+    EXPECT_FALSE(mPool.commit(1).has_value());
+}
+
+TEST_F(AvMemoryPoolTest, PendingAllocationWrapsAround) {
+    ASSERT_TRUE(appendPayload(400, 1));
+    auto first = mPool.commit(1);
+    ASSERT_TRUE(appendPayload(400, 2));
+    auto second = mPool.commit(2);
+    ASSERT_TRUE(mPool.release(first->id));
+
+    // 300 bytes do not fit before the end, the pending allocation moves to the start.
+    ASSERT_TRUE(appendPayload(300, 3));
+    auto third = mPool.commit(3);
+    ASSERT_TRUE(third.has_value());
+    EXPECT_EQ(0u, third->offset);
+    EXPECT_TRUE(slotHolds(*third, 3));
+    EXPECT_TRUE(slotHolds(*second, 2));
+    // The 200 bytes skipped at the end are in use until the ring wraps again.
+    EXPECT_EQ(900u, mPool.getUsedBytes());
+}
+
+TEST_F(AvMemoryPoolTest, FailsWhenFull) {
+    ASSERT_TRUE(appendPayload(600, 1));
+    auto first = mPool.commit(1);
+    ASSERT_TRUE(appendPayload(300, 2));
+    ASSERT_FALSE(appendPayload(200, 2));
+    EXPECT_EQ(0u, mPool.getPendingSize());
+    EXPECT_EQ(1u, mPool.getFailureCount());
+
+    ASSERT_TRUE(mPool.release(first->id));
+    ASSERT_TRUE(appendPayload(1000, 3));
+    EXPECT_TRUE(mPool.commit(3).has_value());
+    EXPECT_EQ(kCapacity, mPool.getUsedBytes());
+    EXPECT_FALSE(appendPayload(1, 4));
+}
+
+TEST_F(AvMemoryPoolTest, ReleasedSpaceIsReusedInRingOrder) {
+    std::vector<AvMemoryPool::Slot> slots;
+    for (uint64_t id = 1; id <= 4; id++) {
+        ASSERT_TRUE(appendPayload(250, id));
+        slots.push_back(*mPool.commit(id));
+    }
+    EXPECT_FALSE(appendPayload(1, 5));
+
+    // Releasing a newer allocation does not free space while the oldest is live.
+    ASSERT_TRUE(mPool.release(3));
+    ASSERT_TRUE(mPool.release(2));
+    EXPECT_EQ(kCapacity, mPool.getUsedBytes());
+    EXPECT_FALSE(appendPayload(1, 5));
+
+    ASSERT_TRUE(mPool.release(1));
+    EXPECT_EQ(250u, mPool.getUsedBytes());
+    EXPECT_EQ(1u, mPool.getAllocationCount());
+    ASSERT_TRUE(appendPayload(750, 5));
+    auto slot = mPool.commit(5);
+    ASSERT_TRUE(slot.has_value());
+    EXPECT_EQ(0u, slot->offset);
+    EXPECT_TRUE(slotHolds(slots[3], 4));
+}
+
+TEST_F(AvMemoryPoolTest, ReleaseUnknownIdFails) {
+    ASSERT_TRUE(appendPayload(10, 1));
+    mPool.commit(1);
+    EXPECT_FALSE(mPool.release(2));
+    EXPECT_TRUE(mPool.release(1));
+    EXPECT_FALSE(mPool.release(1));
+}
+
+TEST_F(AvMemoryPoolTest, UninitializedPoolFails) {
+    mPool.reset();
+    EXPECT_FALSE(mPool.isInitialized());
+    EXPECT_FALSE(appendPayload(10, 1));
+    EXPECT_EQ(1u, mPool.getFailureCount());
+}
+
+// Random sizes and release order, checking that no live allocation is ever overwritten.
+TEST_F(AvMemoryPoolTest, LiveAllocationsAreNeverOverwritten) {
+    std::mt19937 random(42);
+    std::deque<AvMemoryPool::Slot> live;
+    uint64_t nextId = 1;
+    int failures = 0;
+    for (int i = 0; i < 10000; i++) {
+        if (!live.empty() && random() % 3 == 0) {
+            const size_t index = random() % live.size();
+            ASSERT_TRUE(mPool.release(live[index].id));
+            live.erase(live.begin() + index);
+            continue;
+        }
+        const uint64_t id = nextId++;
+        if (!appendPayload(1 + random() % 400, static_cast<int8_t>(id))) {
+            failures++;
+            continue;
+        }
+        auto slot = mPool.commit(id);
+        ASSERT_TRUE(slot.has_value());
+        ASSERT_LE(slot->offset + slot->size, kCapacity);
+        live.push_back(*slot);
+        for (const auto& other : live) {
+            ASSERT_TRUE(slotHolds(other, static_cast<int8_t>(other.id))) << "slot " << other.id;
+        }
+    }
+    EXPECT_EQ(static_cast<uint64_t>(failures), mPool.getFailureCount());
+    EXPECT_EQ(live.size(), mPool.getAllocationCount());
+}
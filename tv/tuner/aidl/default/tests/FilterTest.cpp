@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <aidl/android/hardware/tv/tuner/BnFilterCallback.h>
+#include <gtest/gtest.h>
+
+#include "Demux.h"
+#include "Filter.h"
+
+using aidl::android::hardware::tv::tuner::BnFilterCallback;
+using aidl::android::hardware::tv::tuner::Demux;
+using aidl::android::hardware::tv::tuner::DemuxFilterEvent;
+using aidl::android::hardware::tv::tuner::DemuxFilterMainType;
+using aidl::android::hardware::tv::tuner::DemuxFilterSectionSettings;
+using aidl::android::hardware::tv::tuner::DemuxFilterSettings;
+using aidl::android::hardware::tv::tuner::DemuxFilterStatus;
+using aidl::android::hardware::tv::tuner::DemuxFilterSubType;
+using aidl::android::hardware::tv::tuner::DemuxFilterType;
+using aidl::android::hardware::tv::tuner::DemuxTsFilterSettings;
+using aidl::android::hardware::tv::tuner::DemuxTsFilterSettingsFilterSettings;
+using aidl::android::hardware::tv::tuner::DemuxTsFilterType;
+using aidl::android::hardware::tv::tuner::Filter;
+using aidl::android::hardware::tv::tuner::IFilter;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kChannelCount = 5;
+constexpr size_t kTsPacketSize = 188;
+constexpr int32_t kFilterBufferSize = 16 * 1024;
+// The filter thread used to poll for events once a second.
+constexpr auto kMaxFirstSectionLatency = std::chrono::milliseconds(100);
+constexpr auto kCallbackTimeout = std::chrono::seconds(5);
+
+class SectionCallback : public BnFilterCallback {
+  public:
+    ::ndk::ScopedAStatus onFilterEvent(const std::vector<DemuxFilterEvent>& events) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (const auto& event : events) {
+            if (event.getTag() == DemuxFilterEvent::Tag::section && !mSectionReceived) {
+                mSectionReceived = true;
+                mFirstSectionTime = Clock::now();
+                mCv.notify_all();
+            }
+        }
+        return ::ndk::ScopedAStatus::ok();
+    }
+
+    ::ndk::ScopedAStatus onFilterStatus(DemuxFilterStatus /* status */) override {
+        return ::ndk::ScopedAStatus::ok();
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mLock);
+        mSectionReceived = false;
+    }
+
+    // Returns the time of the first section event since the last reset, or std::nullopt on
+    // timeout.
+    std::optional<Clock::time_point> waitForFirstSection() {
+        std::unique_lock<std::mutex> lock(mLock);
+        if (!mCv.wait_for(lock, kCallbackTimeout, [this] { return mSectionReceived; })) {
+            return std::nullopt;
+        }
+        return mFirstSectionTime;
+    }
+
+  private:
+    std::mutex mLock;
+    std::condition_variable mCv;
+    bool mSectionReceived = false;
+    Clock::time_point mFirstSectionTime;
+};
+
+// One TS packet carrying a complete 16 byte PAT-like section on pid.
+std::vector<int8_t> makeSectionPacket(int32_t pid) {
+    std::vector<int8_t> packet(kTsPacketSize, static_cast<int8_t>(0xff));
+    packet[0] = 0x47;
+    packet[1] = static_cast<int8_t>(0x40 | ((pid >> 8) & 0x1f));
+    packet[2] = static_cast<int8_t>(pid & 0xff);
+    packet[3] = 0x10;
+    // pointer_field, table_id, then section_syntax_indicator and a 13 byte section_length.
+    packet[4] = 0x00;
+    packet[5] = 0x00;
+    packet[6] = static_cast<int8_t>(0xb0);
+    packet[7] = 13;
+    return packet;
+}
+
+DemuxFilterSettings makeSectionSettings(int32_t pid) {
+    DemuxTsFilterSettings tsSettings{
+            .tpid = pid,
+            .filterSettings = DemuxTsFilterSettingsFilterSettings::make<
+                    DemuxTsFilterSettingsFilterSettings::Tag::section>(
+                    DemuxFilterSectionSettings{}),
+    };
+    return DemuxFilterSettings::make<DemuxFilterSettings::Tag::ts>(tsSettings);
+}
+
+}  // namespace
+
+// A channel change stops the section filter, moves it to the new channel's pid and restarts it.
+// The first section on the new channel has to reach the client without waiting for the filter
+// thread to poll.
+TEST(FilterTest, TimeToFirstSectionOnChannelChange) {
+    auto demux = ndk::SharedRefBase::make<Demux>(0, static_cast<uint32_t>(DemuxFilterMainType::TS));
+    auto callback = ndk::SharedRefBase::make<SectionCallback>();
+    DemuxFilterType type{
+            .mainType = DemuxFilterMainType::TS,
+            .subType = DemuxFilterSubType::make<DemuxFilterSubType::Tag::tsFilterType>(
+                    DemuxTsFilterType::SECTION),
+    };
+    std::shared_ptr<IFilter> iFilter;
+    ASSERT_TRUE(demux->openFilter(type, kFilterBufferSize, callback, &iFilter).isOk());
+    ASSERT_NE(iFilter, nullptr);
+    auto filter = std::static_pointer_cast<Filter>(iFilter);
+
+    for (int channel = 0; channel < kChannelCount; channel++) {
+        const int32_t pid = 0x100 + channel;
+        callback->reset();
+        ASSERT_TRUE(filter->configure(makeSectionSettings(pid)).isOk());
+        ASSERT_TRUE(filter->start().isOk());
+
+        const auto inputTime = Clock::now();
+        demux->startBroadcastTsFilter(makeSectionPacket(pid));
+        ASSERT_TRUE(demux->startBroadcastFilterDispatcher());
+
+        const auto firstSectionTime = callback->waitForFirstSection();
+        ASSERT_TRUE(firstSectionTime.has_value()) << "no section on channel " << channel;
+        const auto latency = *firstSectionTime - inputTime;
+        GTEST_LOG_(INFO) << "channel " << channel << " time to first section: "
+                         << std::chrono::duration_cast<std::chrono::microseconds>(latency).count()
+                         << "us";
+        EXPECT_LT(latency, kMaxFirstSectionLatency);
+
+        ASSERT_TRUE(filter->stop().isOk());
+    }
+
+    ASSERT_TRUE(filter->close().isOk());
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "TsPidTable.h"
+
+using aidl::android::hardware::tv::tuner::TsPidTable;
+
+namespace {
+
+constexpr size_t kPacketSize = 188;
+// About 1MB, a typical DVR FMQ read.
+constexpr size_t kPacketCount = 5600;
+
+// Stands for a Filter: a TPID and an output buffer appended to under a lock.
+struct FakeFilter {
+    uint16_t tpid;
+    std::mutex lock;
+    std::vector<int8_t> output;
+
+    void updateFilterOutput(const int8_t* data, size_t size) {
+        std::lock_guard<std::mutex> guard(lock);
+        output.insert(output.end(), data, data + size);
+    }
+};
+
+// Interleaved packets of the PIDs 0x100 to 0x100 + filterCount, plus as many packets of PIDs
+// without filter, like the other services of a multiplex.
+std::vector<int8_t> makeStream(int filterCount) {
+    std::vector<int8_t> stream(kPacketCount * kPacketSize);
+    for (size_t i = 0; i < kPacketCount; i++) {
+        const uint16_t pid = i % 2 ? 0x100 + (i / 2) % filterCount : 0x1000 + i % 64;
+        int8_t* packet = &stream[i * kPacketSize];
+        packet[0] = 0x47;
+        packet[1] = static_cast<int8_t>((pid >> 8) & 0x1f);
+        packet[2] = static_cast<int8_t>(pid & 0xff);
+    }
+    return stream;
+}
+
+std::map<int64_t, std::shared_ptr<FakeFilter>> makeFilters(int filterCount) {
+    std::map<int64_t, std::shared_ptr<FakeFilter>> filters;
+    for (int i = 0; i < filterCount; i++) {
+        filters[i] = std::make_shared<FakeFilter>();
+        filters[i]->tpid = 0x100 + i;
+        filters[i]->output.reserve(kPacketCount * kPacketSize);
+    }
+    return filters;
+}
+
+void setBitsProcessed(benchmark::State& state) {
+    state.SetBytesProcessed(state.iterations() * kPacketCount * kPacketSize);
+    state.counters["Mbit"] = benchmark::Counter(
+            state.iterations() * kPacketCount * kPacketSize * 8 / 1e6, benchmark::Counter::kIsRate);
+}
+
+void clearOutputs(std::map<int64_t, std::shared_ptr<FakeFilter>>& filters) {
+    for (auto& [id, filter] : filters) {
+        filter->output.clear();
+    }
+}
+
+// The previous dispatch: a packet copied into a vector passed by value, and a map lookup per
+// playback filter id to compare its TPID.
+void BM_DispatchPerPacket(benchmark::State& state) {
+    const int filterCount = state.range(0);
+    const std::vector<int8_t> stream = makeStream(filterCount);
+    std::map<int64_t, std::shared_ptr<FakeFilter>> filters = makeFilters(filterCount);
+    std::set<int64_t> playbackFilterIds;
+    for (const auto& [id, filter] : filters) {
+        playbackFilterIds.insert(id);
+    }
+    auto startBroadcastTsFilter = [&](std::vector<int8_t> data) {
+        uint16_t pid = ((data[1] & 0x1f) << 8) | ((data[2] & 0xff));
+        for (auto it = playbackFilterIds.begin(); it != playbackFilterIds.end(); it++) {
+            if (pid == filters[*it]->tpid) {
+                filters[*it]->updateFilterOutput(data.data(), data.size());
+            }
+        }
+    };
+
+    for (auto _ : state) {
+        std::vector<int8_t> packet(kPacketSize);
+        for (size_t i = 0; i < kPacketCount; i++) {
+            memcpy(packet.data(), &stream[i * kPacketSize], kPacketSize);
+            startBroadcastTsFilter(packet);
+        }
+        state.PauseTiming();
+        clearOutputs(filters);
+        state.ResumeTiming();
+    }
+    setBitsProcessed(state);
+}
+BENCHMARK(BM_DispatchPerPacket)->Arg(1)->Arg(16)->Arg(64);
+
+// The PID table dispatch of a whole batch, as Demux::startBroadcastTsFilter does.
+void BM_DispatchPidTable(benchmark::State& state) {
+    const int filterCount = state.range(0);
+    const std::vector<int8_t> stream = makeStream(filterCount);
+    std::map<int64_t, std::shared_ptr<FakeFilter>> filters = makeFilters(filterCount);
+    std::mutex pidTableLock;
+    auto pidTable = std::make_shared<TsPidTable<std::shared_ptr<FakeFilter>>>();
+    for (const auto& [id, filter] : filters) {
+        pidTable->add(filter->tpid, filter);
+    }
+
+    for (auto _ : state) {
+        std::shared_ptr<const TsPidTable<std::shared_ptr<FakeFilter>>> snapshot;
+        {
+            std::lock_guard<std::mutex> guard(pidTableLock);
+            snapshot = pidTable;
+        }
+        snapshot->dispatch(stream.data(), stream.size(), kPacketSize,
+                           [](const std::shared_ptr<FakeFilter>& filter, const int8_t* packet,
+                              size_t packetSize) {
+                               filter->updateFilterOutput(packet, packetSize);
+                           });
+        state.PauseTiming();
+        clearOutputs(filters);
+        state.ResumeTiming();
+    }
+    setBitsProcessed(state);
+}
+BENCHMARK(BM_DispatchPidTable)->Arg(1)->Arg(16)->Arg(64);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "TsPidTable.h"
+
+using aidl::android::hardware::tv::tuner::TsPidTable;
+
+namespace {
+
+constexpr size_t kTsPacketSize = 188;
+
+// The targets registered for pid, empty if none.
+std::vector<int> findTargets(const TsPidTable<int>& table, uint16_t pid) {
+    const std::vector<int>* targets = table.find(pid);
+    return targets == nullptr ? std::vector<int>() : *targets;
+}
+
+std::vector<int8_t> makePacket(uint16_t pid) {
+    std::vector<int8_t> packet(kTsPacketSize, 0);
+    packet[0] = 0x47;
+    packet[1] = static_cast<int8_t>((pid >> 8) & 0x1f);
+    packet[2] = static_cast<int8_t>(pid & 0xff);
+    return packet;
+}
+
+TEST(TsPidTableTest, AddAndFind) {
+    TsPidTable<int> table;
+    EXPECT_TRUE(table.empty());
+    table.add(0x100, 1);
+    table.add(0x100, 2);
+    table.add(0x1fff, 3);
+
+    EXPECT_FALSE(table.empty());
+    EXPECT_EQ(std::vector<int>({1, 2}), findTargets(table, 0x100));
+    EXPECT_EQ(std::vector<int>({3}), findTargets(table, 0x1fff));
+    EXPECT_EQ(nullptr, table.find(0x101));
+    EXPECT_EQ(nullptr, table.find(0));
+}
+
+TEST(TsPidTableTest, AddMovesTargetToNewPid) {
+    TsPidTable<int> table;
+    table.add(0x100, 1);
+    table.add(0x200, 1);
+
+    EXPECT_EQ(nullptr, table.find(0x100));
+    EXPECT_EQ(std::vector<int>({1}), findTargets(table, 0x200));
+}
+
+TEST(TsPidTableTest, RemoveKeepsOtherTargetsOfPid) {
+    TsPidTable<int> table;
+    table.add(0x100, 1);
+    table.add(0x100, 2);
+    table.remove(1);
+
+    EXPECT_EQ(std::vector<int>({2}), findTargets(table, 0x100));
+    // Not registered
+    table.remove(7);
+    EXPECT_EQ(std::vector<int>({2}), findTargets(table, 0x100));
+}
+
+TEST(TsPidTableTest, RemoveLastEntry) {
+    TsPidTable<int> table;
+    table.add(0x100, 1);
+    table.add(0x200, 2);
+    table.add(0x300, 3);
+    table.remove(3);
+
+    EXPECT_EQ(nullptr, table.find(0x300));
+    EXPECT_EQ(std::vector<int>({1}), findTargets(table, 0x100));
+    EXPECT_EQ(std::vector<int>({2}), findTargets(table, 0x200));
+
+    table.remove(1);
+    table.remove(2);
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(nullptr, table.find(0x100));
+    EXPECT_EQ(nullptr, table.find(0x200));
+}
+
+TEST(TsPidTableTest, RemoveMiddleEntry) {
+    TsPidTable<int> table;
+    table.add(0x100, 1);
+    table.add(0x200, 2);
+    table.add(0x300, 3);
+    table.add(0x300, 4);
+    // The entry of 0x300, the last one, takes the place of the entry of 0x200
+    table.remove(2);
+
+    EXPECT_EQ(nullptr, table.find(0x200));
+    EXPECT_EQ(std::vector<int>({1}), findTargets(table, 0x100));
+    EXPECT_EQ(std::vector<int>({3, 4}), findTargets(table, 0x300));
+
+    // The moved entry is still the one updated and removed for 0x300
+    table.add(0x400, 5);
+    table.remove(3);
+    EXPECT_EQ(std::vector<int>({4}), findTargets(table, 0x300));
+    table.remove(4);
+    EXPECT_EQ(nullptr, table.find(0x300));
+    EXPECT_EQ(std::vector<int>({1}), findTargets(table, 0x100));
+    EXPECT_EQ(std::vector<int>({5}), findTargets(table, 0x400));
+}
+
+TEST(TsPidTableTest, ReAddRemovedPid) {
+    TsPidTable<int> table;
+    table.add(0x100, 1);
+    table.add(0x200, 2);
+    table.remove(1);
+    EXPECT_EQ(nullptr, table.find(0x100));
+
+    table.add(0x100, 3);
+    table.add(0x100, 1);
+    EXPECT_EQ(std::vector<int>({3, 1}), findTargets(table, 0x100));
+    EXPECT_EQ(std::vector<int>({2}), findTargets(table, 0x200));
+
+    table.clear();
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(nullptr, table.find(0x100));
+    table.add(0x100, 1);
+    EXPECT_EQ(std::vector<int>({1}), findTargets(table, 0x100));
+}
+
+TEST(TsPidTableTest, DispatchCallsTargetsOfEachPacket) {
+    TsPidTable<int> table;
+    table.add(0x100, 1);
+    table.add(0x100, 2);
+    table.add(0x200, 3);
+
+    std::vector<int8_t> data;
+    for (uint16_t pid : {0x100, 0x300, 0x200}) {
+        std::vector<int8_t> packet = makePacket(pid);
+        data.insert(data.end(), packet.begin(), packet.end());
+    }
+    // A partial packet of a registered PID
+    std::vector<int8_t> partial = makePacket(0x200);
+    data.insert(data.end(), partial.begin(), partial.begin() + kTsPacketSize / 2);
+
+    std::vector<std::pair<int, size_t>> calls;
+    table.dispatch(data.data(), data.size(), kTsPacketSize,
+                   [&](int target, const int8_t* packet, size_t packetSize) {
+                       EXPECT_EQ(kTsPacketSize, packetSize);
+                       calls.emplace_back(target, (packet - data.data()) / kTsPacketSize);
+                   });
+    EXPECT_EQ((std::vector<std::pair<int, size_t>>({{1, 0}, {2, 0}, {3, 2}})), calls);
+}
+
+}  // namespace
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "TsSectionAssembler.h"
+
+using aidl::android::hardware::tv::tuner::TsSectionAssembler;
+
+namespace {
+
+constexpr uint16_t kPid = 0x100;
+constexpr size_t kTsPacketSize = TsSectionAssembler::kTsPacketSize;
+constexpr size_t kPayloadSize = kTsPacketSize - 4;
+
+uint32_t bitwiseCrc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= static_cast<uint32_t>(data[i]) << 24;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// A long form section with payloadSize bytes of payload and a valid CRC_32.
+std::vector<uint8_t> makeSection(uint8_t tableId, uint16_t tableIdExtension, uint8_t version,
+                                 uint8_t sectionNumber, size_t payloadSize) {
+    const size_t sectionLength = 5 + payloadSize + 4;
+    std::vector<uint8_t> section = {
+            tableId,
+            static_cast<uint8_t>(0xb0 | (sectionLength >> 8)),
+            static_cast<uint8_t>(sectionLength & 0xff),
+            static_cast<uint8_t>(tableIdExtension >> 8),
+            static_cast<uint8_t>(tableIdExtension & 0xff),
+            static_cast<uint8_t>(0xc1 | (version << 1)),
+            sectionNumber,
+            sectionNumber,
+    };
+    for (size_t i = 0; i < payloadSize; i++) {
+        section.push_back(static_cast<uint8_t>(i * 7));
+    }
+    const uint32_t crc = TsSectionAssembler::crc32(section.data(), section.size());
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        section.push_back(static_cast<uint8_t>(crc >> shift));
+    }
+    return section;
+}
+
+// Packetizes sections back to back the way a multiplexer does: a packet where a section starts
+// has payload_unit_start_indicator set and a pointer_field to the first section starting in it.
+class Packetizer {
+  public:
+    std::vector<int8_t> packetize(const std::vector<std::vector<uint8_t>>& sections) {
+        std::vector<uint8_t> stream;
+        std::vector<size_t> starts;
+        for (const auto& section : sections) {
+            starts.push_back(stream.size());
+            stream.insert(stream.end(), section.begin(), section.end());
+        }
+        std::vector<int8_t> packets;
+        size_t position = 0;
+        size_t nextStart = 0;
+        while (position < stream.size()) {
+            while (nextStart < starts.size() && starts[nextStart] < position) {
+                nextStart++;
+            }
+            const size_t start = nextStart < starts.size() ? starts[nextStart] : stream.size();
+            std::vector<uint8_t> packet(kTsPacketSize, 0xff);
+            packet[0] = 0x47;
+            packet[1] = kPid >> 8;
+            packet[2] = kPid & 0xff;
+            packet[3] = 0x10 | (mContinuityCounter++ & 0x0f);
+            size_t offset = 4;
+            size_t count;
+            if (start < position + kPayloadSize - 1) {
+                packet[1] |= 0x40;
+                packet[offset++] = start - position;
+                count = std::min(kPayloadSize - 1, stream.size() - position);
+            } else {
+                count = std::min({kPayloadSize, start - position, stream.size() - position});
+            }
+            std::memcpy(packet.data() + offset, stream.data() + position, count);
+            position += count;
+            packets.insert(packets.end(), packet.begin(), packet.end());
+        }
+        return packets;
+    }
+
+  private:
+    int mContinuityCounter = 0;
+};
+
+class TsSectionAssemblerTest : public ::testing::Test {
+  protected:
+    bool push(const std::vector<int8_t>& packets) {
+        return mAssembler.push(
+                packets.data(), packets.size(), [this](const TsSectionAssembler::Section& section) {
+                    mSections.emplace_back(section.data, section.data + section.size);
+                    mInfos.push_back(section);
+                    return true;
+                });
+    }
+
+    static std::vector<int8_t> toInt8(const std::vector<uint8_t>& data) {
+        return std::vector<int8_t>(data.begin(), data.end());
+    }
+
+    TsSectionAssembler mAssembler;
+    Packetizer mPacketizer;
+    std::vector<std::vector<int8_t>> mSections;
+    std::vector<TsSectionAssembler::Section> mInfos;
+};
+
+}  // namespace
+
+TEST(TsSectionAssemblerCrcTest, MatchesBitwiseCrc) {
+    const char* check = "123456789";
+    EXPECT_EQ(0x0376e6e7u,
+              TsSectionAssembler::crc32(reinterpret_cast<const uint8_t*>(check), strlen(check)));
+
+    std::vector<uint8_t> data(1024);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    for (size_t size = 0; size <= 40; size++) {
+        for (size_t offset = 0; offset < 8; offset++) {
+            EXPECT_EQ(bitwiseCrc32(data.data() + offset, size),
+                      TsSectionAssembler::crc32(data.data() + offset, size))
+                    << "size " << size << " offset " << offset;
+        }
+    }
+    EXPECT_EQ(bitwiseCrc32(data.data(), data.size()),
+              TsSectionAssembler::crc32(data.data(), data.size()));
+}
+
+TEST_F(TsSectionAssemblerTest, SectionInOnePacket) {
+    const auto section = makeSection(0x02, 0x1234, 5, 0, 20);
+    ASSERT_TRUE(push(mPacketizer.packetize({section})));
+
+    ASSERT_EQ(1u, mSections.size());
+    EXPECT_EQ(toInt8(section), mSections[0]);
+    EXPECT_EQ(0x02, mInfos[0].tableId);
+    EXPECT_EQ(5, mInfos[0].version);
+    EXPECT_EQ(0, mInfos[0].sectionNumber);
+}
+
+TEST_F(TsSectionAssemblerTest, SectionSpanningPackets) {
+    const auto section = makeSection(0x4e, 0x0001, 1, 3, 1000);
+    const auto packets = mPacketizer.packetize({section});
+    ASSERT_GT(packets.size(), 5 * kTsPacketSize);
+
+    // Push the packets one at a time, as the demux does.
+    for (size_t offset = 0; offset < packets.size(); offset += kTsPacketSize) {
+        ASSERT_TRUE(push({packets.begin() + offset, packets.begin() + offset + kTsPacketSize}));
+    }
+    ASSERT_EQ(1u, mSections.size());
+    EXPECT_EQ(toInt8(section), mSections[0]);
+    EXPECT_EQ(3, mInfos[0].sectionNumber);
+}
+
+TEST_F(TsSectionAssemblerTest, SeveralSectionsPerPacket) {
+    // The second section ends in the packet where the third one starts, after a pointer_field.
+    std::vector<std::vector<uint8_t>> sections = {
+            makeSection(0x00, 1, 0, 0, 10),
+            makeSection(0x02, 1, 0, 0, 200),
+            makeSection(0x02, 2, 0, 0, 30),
+            makeSection(0x02, 3, 0, 0, 30),
+    };
+    ASSERT_TRUE(push(mPacketizer.packetize(sections)));
+
+    ASSERT_EQ(sections.size(), mSections.size());
+    for (size_t i = 0; i < sections.size(); i++) {
+        EXPECT_EQ(toInt8(sections[i]), mSections[i]) << "section " << i;
+    }
+}
+
+TEST_F(TsSectionAssemblerTest, RepeatedVersionIsDropped) {
+    const auto pat = makeSection(0x00, 1, 3, 0, 8);
+    const auto pmt = makeSection(0x02, 1, 3, 0, 40);
+    for (int repeat = 0; repeat < 10; repeat++) {
+        ASSERT_TRUE(push(mPacketizer.packetize({pat, pmt})));
+    }
+    EXPECT_EQ(2u, mSections.size());
+    EXPECT_EQ(18u, mAssembler.getDuplicateCount());
+
+    // A new version of the PMT is delivered.
+    const auto newPmt = makeSection(0x02, 1, 4, 0, 40);
+    ASSERT_TRUE(push(mPacketizer.packetize({pat, newPmt})));
+    ASSERT_EQ(3u, mSections.size());
+    EXPECT_EQ(toInt8(newPmt), mSections[2]);
+
+    // After a reset, e.g. a channel change, the same versions are delivered again.
+    mAssembler.reset();
+    ASSERT_TRUE(push(mPacketizer.packetize({pat, newPmt})));
+    EXPECT_EQ(5u, mSections.size());
+}
+
+TEST_F(TsSectionAssemblerTest, BadCrcIsDroppedWhenChecked) {
+    auto corrupted = makeSection(0x02, 1, 0, 0, 40);
+    corrupted[20] ^= 0x01;
+    const auto valid = makeSection(0x02, 2, 0, 0, 40);
+
+    mAssembler.setCheckCrc(true);
+    ASSERT_TRUE(push(mPacketizer.packetize({corrupted, valid})));
+    ASSERT_EQ(1u, mSections.size());
+    EXPECT_EQ(toInt8(valid), mSections[0]);
+    EXPECT_EQ(1u, mAssembler.getCrcErrorCount());
+
+    mAssembler.reset();
+    mAssembler.setCheckCrc(false);
+    ASSERT_TRUE(push(mPacketizer.packetize({corrupted})));
+    EXPECT_EQ(2u, mSections.size());
+}
+
+TEST_F(TsSectionAssemblerTest, ContinuityGapDropsPartialSection) {
+    const auto lost = makeSection(0x4e, 1, 0, 0, 500);
+    const auto next = makeSection(0x4e, 1, 0, 1, 20);
+    auto packets = mPacketizer.packetize({lost, next});
+    const size_t packetCount = packets.size() / kTsPacketSize;
+    ASSERT_GE(packetCount, 3u);
+    // Lose the second packet.
+    packets.erase(packets.begin() + kTsPacketSize, packets.begin() + 2 * kTsPacketSize);
+
+    ASSERT_TRUE(push(packets));
+    ASSERT_EQ(1u, mSections.size());
+    EXPECT_EQ(toInt8(next), mSections[0]);
+}
+
+TEST_F(TsSectionAssemblerTest, DuplicatePacketIsIgnored) {
+    const auto section = makeSection(0x4e, 1, 0, 0, 500);
+    auto packets = mPacketizer.packetize({section});
+    // Repeat the second packet, as allowed by ISO/IEC 13818-1.
+    std::vector<int8_t> duplicate(packets.begin() + kTsPacketSize,
+                                  packets.begin() + 2 * kTsPacketSize);
+    packets.insert(packets.begin() + 2 * kTsPacketSize, duplicate.begin(), duplicate.end());
+
+    ASSERT_TRUE(push(packets));
+    ASSERT_EQ(1u, mSections.size());
+    EXPECT_EQ(toInt8(section), mSections[0]);
+}
+
+TEST_F(TsSectionAssemblerTest, StopsWhenSectionIsRejected) {
+    const auto first = makeSection(0x02, 1, 0, 0, 20);
+    const auto second = makeSection(0x02, 2, 0, 0, 20);
+    const auto packets = mPacketizer.packetize({first, second});
+
+    int calls = 0;
+    EXPECT_FALSE(mAssembler.push(packets.data(), packets.size(),
+                                 [&calls](const TsSectionAssembler::Section&) {
+                                     calls++;
+                                     return false;
+                                 }));
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ(0u, mAssembler.getSectionCount());
+}